@@ -0,0 +1,837 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-----------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*! \file binary_log.c
+  \brief Per-thread rings of binary log records and their background thread.
+*/
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "binary_log.h"
+#include "bstrlib.h"
+#include "hashtable.h"
+
+#define BINARY_LOG_RING_MASK (BINARY_LOG_RING_SIZE - 1)
+// Set in the size of the filler written when a record doesn't fit before the
+// end of the ring
+#define BINARY_LOG_PADDING 0x80000000
+#define BINARY_LOG_SLOT_SIZE 8
+#define BINARY_LOG_MAX_MESSAGE_SIZE 4096
+#define BINARY_LOG_CACHE_LINE_SIZE 64
+#define BINARY_LOG_DUMPED_STRINGS_HTBL_SIZE 4096
+
+#define BINARY_LOG_ALIGN(sIzE)                                                 \
+  (((sIzE) + BINARY_LOG_SLOT_SIZE - 1) & ~((size_t) BINARY_LOG_SLOT_SIZE - 1))
+
+typedef enum {
+  LENGTH_NONE = 0,
+  LENGTH_HH,
+  LENGTH_H,
+  LENGTH_L,
+  LENGTH_LL,
+  LENGTH_J,
+  LENGTH_Z,
+  LENGTH_T,
+  LENGTH_LONG_DOUBLE,
+} format_length_t;
+
+typedef enum {
+  ARG_SIGNED = 0,
+  ARG_UNSIGNED,
+  ARG_CHAR,
+  ARG_DOUBLE,
+  ARG_STRING,
+  ARG_POINTER,
+} format_arg_t;
+
+/*! \struct  format_spec_t
+* \brief One conversion specification of a printf format string
+*/
+typedef struct format_spec_s {
+  const char *end; /*!< \brief One past the conversion character */
+  char flags[8];
+  int n_flags;
+  bool has_width;
+  bool is_width_arg; /*!< \brief Width given as an argument with '*' */
+  int width;
+  bool has_precision;
+  bool is_precision_arg; /*!< \brief Precision given as an argument with '.*' */
+  int precision;
+  format_length_t length;
+  char conversion;
+  format_arg_t arg;
+} format_spec_t;
+
+/*! \struct  binary_log_ring_t
+* \brief Single producer single consumer ring of records of one thread
+*/
+typedef struct binary_log_ring_s {
+  uint64_t head; /*!< \brief Written by the producer only */
+  char head_padding[BINARY_LOG_CACHE_LINE_SIZE - sizeof(uint64_t)];
+  uint64_t tail; /*!< \brief Written by the consumer only */
+  char tail_padding[BINARY_LOG_CACHE_LINE_SIZE - sizeof(uint64_t)];
+  // producer state
+  uint32_t dropped; /*!< \brief Records dropped since the last one written */
+  int indent;
+  bool is_closed; /*!< \brief The thread exited, free once drained */
+  // consumer state
+  uint64_t drain_head; /*!< \brief Head snapshot of the current drain */
+  struct binary_log_ring_s *next;
+  uint8_t data[BINARY_LOG_RING_SIZE];
+} binary_log_ring_t;
+
+typedef struct binary_log_s {
+  bool is_running;
+  pthread_t thread;
+  pthread_key_t ring_key;
+  bool is_ring_key_created;
+  pthread_mutex_t rings_mutex; /*!< \brief Guards the insertion and removal of rings */
+  binary_log_ring_t *rings;
+  uint64_t dropped_records;
+  binary_log_output_cb_t output_cb;
+  binary_log_flush_cb_t flush_cb;
+  FILE *dump_fd;
+  hash_table_t *dumped_strings; /*!< \brief Format strings and file names already in the dump */
+} binary_log_t;
+
+static binary_log_t g_binary_log = {.is_running = false,
+                                    .rings_mutex = PTHREAD_MUTEX_INITIALIZER};
+
+// Arguments of messages with conversions that aren't recorded are formatted
+// right away and recorded as a single string
+static const char BINARY_LOG_PREFORMATTED[] = "%s";
+
+static __thread binary_log_ring_t *tls_ring = NULL;
+static __thread uint64_t tls_record[BINARY_LOG_MAX_RECORD_SIZE /
+                                    sizeof(uint64_t)];
+
+//------------------------------------------------------------------------------
+// Parse the conversion specification following a '%'
+static bool parse_format_spec(const char *p, format_spec_t *spec)
+{
+  memset(spec, 0, sizeof(*spec));
+  while (*p && strchr("-+ #0'", *p)) {
+    if (spec->n_flags < (int) sizeof(spec->flags) - 1) {
+      spec->flags[spec->n_flags++] = *p;
+    }
+    p++;
+  }
+  if ('*' == *p) {
+    spec->has_width = true;
+    spec->is_width_arg = true;
+    p++;
+  } else if (('0' <= *p) && ('9' >= *p)) {
+    spec->has_width = true;
+    spec->width = (int) strtol(p, (char **) &p, 10);
+  }
+  if ('.' == *p) {
+    spec->has_precision = true;
+    p++;
+    if ('*' == *p) {
+      spec->is_precision_arg = true;
+      p++;
+    } else {
+      spec->precision = (int) strtol(p, (char **) &p, 10);
+    }
+  }
+  switch (*p) {
+    case 'h':
+      spec->length = ('h' == p[1]) ? LENGTH_HH : LENGTH_H;
+      p += ('h' == p[1]) ? 2 : 1;
+      break;
+    case 'l':
+      spec->length = ('l' == p[1]) ? LENGTH_LL : LENGTH_L;
+      p += ('l' == p[1]) ? 2 : 1;
+      break;
+    case 'q':
+      spec->length = LENGTH_LL;
+      p++;
+      break;
+    case 'j':
+      spec->length = LENGTH_J;
+      p++;
+      break;
+    case 'z':
+      spec->length = LENGTH_Z;
+      p++;
+      break;
+    case 't':
+      spec->length = LENGTH_T;
+      p++;
+      break;
+    case 'L':
+      spec->length = LENGTH_LONG_DOUBLE;
+      p++;
+      break;
+    default:
+      break;
+  }
+  spec->conversion = *p;
+  spec->end = p + 1;
+  switch (*p) {
+    case 'd':
+    case 'i':
+      spec->arg = ARG_SIGNED;
+      return true;
+    case 'o':
+    case 'u':
+    case 'x':
+    case 'X':
+      spec->arg = ARG_UNSIGNED;
+      return true;
+    case 'c':
+      spec->arg = ARG_CHAR;
+      return LENGTH_NONE == spec->length;
+    case 'e':
+    case 'E':
+    case 'f':
+    case 'F':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      spec->arg = ARG_DOUBLE;
+      return true;
+    case 's':
+      spec->arg = ARG_STRING;
+      return LENGTH_NONE == spec->length;
+    case 'p':
+      spec->arg = ARG_POINTER;
+      return true;
+    default:
+      // %n, wide characters, or a malformed format
+      return false;
+  }
+}
+
+//------------------------------------------------------------------------------
+static int64_t get_signed_arg(format_length_t length, va_list *args)
+{
+  switch (length) {
+    case LENGTH_HH: return (signed char) va_arg(*args, int);
+    case LENGTH_H: return (short) va_arg(*args, int);
+    case LENGTH_L: return va_arg(*args, long);
+    case LENGTH_LL: return va_arg(*args, long long);
+    case LENGTH_J: return va_arg(*args, intmax_t);
+    case LENGTH_Z: return va_arg(*args, ssize_t);
+    case LENGTH_T: return va_arg(*args, ptrdiff_t);
+    default: return va_arg(*args, int);
+  }
+}
+
+//------------------------------------------------------------------------------
+static uint64_t get_unsigned_arg(format_length_t length, va_list *args)
+{
+  switch (length) {
+    case LENGTH_HH: return (unsigned char) va_arg(*args, unsigned int);
+    case LENGTH_H: return (unsigned short) va_arg(*args, unsigned int);
+    case LENGTH_L: return va_arg(*args, unsigned long);
+    case LENGTH_LL: return va_arg(*args, unsigned long long);
+    case LENGTH_J: return va_arg(*args, uintmax_t);
+    case LENGTH_Z: return va_arg(*args, size_t);
+    case LENGTH_T: return (uint64_t) va_arg(*args, ptrdiff_t);
+    default: return va_arg(*args, unsigned int);
+  }
+}
+
+//------------------------------------------------------------------------------
+static bool put_slot(uint8_t *buf, size_t size, size_t *offset, uint64_t value)
+{
+  if (*offset + BINARY_LOG_SLOT_SIZE > size) {
+    return false;
+  }
+  memcpy(&buf[*offset], &value, sizeof(value));
+  *offset += BINARY_LOG_SLOT_SIZE;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Strings are truncated to what is left of the record
+static bool put_string(
+  uint8_t *buf,
+  size_t size,
+  size_t *offset,
+  const char *str,
+  size_t max_length)
+{
+  if (*offset + BINARY_LOG_SLOT_SIZE > size) {
+    return false;
+  }
+  if (!str) {
+    str = "(null)";
+  }
+  size_t available = size - *offset - sizeof(uint32_t) - 1;
+  uint32_t length = (uint32_t) strnlen(
+    str, (max_length < available) ? max_length : available);
+  memcpy(&buf[*offset], &length, sizeof(length));
+  memcpy(&buf[*offset + sizeof(length)], str, length);
+  size_t padded = BINARY_LOG_ALIGN(sizeof(length) + length + 1);
+  memset(
+    &buf[*offset + sizeof(length) + length],
+    0,
+    padded - sizeof(length) - length);
+  *offset += padded;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Record the arguments of the format in buf
+// @return false if the format has conversions that can't be recorded
+static bool encode_args(
+  uint8_t *buf,
+  size_t size,
+  size_t *offset,
+  const char *format,
+  va_list args)
+{
+  va_list ap;
+  format_spec_t spec;
+  bool rc = true;
+
+  va_copy(ap, args);
+  for (const char *p = format; *p && rc; p++) {
+    if ('%' != *p) {
+      continue;
+    }
+    if ('%' == p[1]) {
+      p++;
+      continue;
+    }
+    if (!parse_format_spec(p + 1, &spec)) {
+      rc = false;
+      break;
+    }
+    p = spec.end - 1;
+    int width = 0;
+    int precision = -1;
+    if (spec.is_width_arg) {
+      width = va_arg(ap, int);
+      rc = put_slot(buf, size, offset, (uint64_t)(int64_t) width);
+    }
+    if (spec.is_precision_arg) {
+      precision = va_arg(ap, int);
+      rc = rc && put_slot(buf, size, offset, (uint64_t)(int64_t) precision);
+    } else if (spec.has_precision) {
+      precision = spec.precision;
+    }
+    if (!rc) {
+      break;
+    }
+    switch (spec.arg) {
+      case ARG_SIGNED:
+        rc = put_slot(
+          buf, size, offset, (uint64_t) get_signed_arg(spec.length, &ap));
+        break;
+      case ARG_UNSIGNED:
+        rc = put_slot(buf, size, offset, get_unsigned_arg(spec.length, &ap));
+        break;
+      case ARG_CHAR:
+        rc = put_slot(buf, size, offset, (uint64_t) va_arg(ap, int));
+        break;
+      case ARG_DOUBLE: {
+        double value = (LENGTH_LONG_DOUBLE == spec.length) ?
+                         (double) va_arg(ap, long double) :
+                         va_arg(ap, double);
+        uint64_t bits = 0;
+        memcpy(&bits, &value, sizeof(bits));
+        rc = put_slot(buf, size, offset, bits);
+      } break;
+      case ARG_STRING:
+        // A precision bounds strings which may not be NUL terminated
+        rc = put_string(
+          buf,
+          size,
+          offset,
+          va_arg(ap, const char *),
+          (precision >= 0) ? (size_t) precision : SIZE_MAX);
+        break;
+      case ARG_POINTER:
+        rc = put_slot(
+          buf, size, offset, (uint64_t)(uintptr_t) va_arg(ap, void *));
+        break;
+    }
+  }
+  va_end(ap);
+  return rc;
+}
+
+//------------------------------------------------------------------------------
+static void binary_log_ring_closed(void *ring)
+{
+  __atomic_store_n(
+    &((binary_log_ring_t *) ring)->is_closed, true, __ATOMIC_RELEASE);
+}
+
+//------------------------------------------------------------------------------
+static binary_log_ring_t *get_ring(void)
+{
+  if (tls_ring) {
+    return tls_ring;
+  }
+  binary_log_ring_t *ring = calloc(1, sizeof(binary_log_ring_t));
+  if (!ring) {
+    return NULL;
+  }
+  pthread_mutex_lock(&g_binary_log.rings_mutex);
+  ring->next = g_binary_log.rings;
+  g_binary_log.rings = ring;
+  pthread_mutex_unlock(&g_binary_log.rings_mutex);
+  // Let the background thread free the ring once the thread exits
+  pthread_setspecific(g_binary_log.ring_key, ring);
+  tls_ring = ring;
+  return ring;
+}
+
+//------------------------------------------------------------------------------
+static bool ring_push(binary_log_ring_t *ring, const void *record, size_t size)
+{
+  uint64_t head = ring->head;
+  uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  size_t offset = head & BINARY_LOG_RING_MASK;
+  size_t to_end = BINARY_LOG_RING_SIZE - offset;
+  size_t needed = (to_end < size) ? to_end + size : size;
+
+  if (BINARY_LOG_RING_SIZE - (head - tail) < needed) {
+    return false;
+  }
+  if (to_end < size) {
+    // Records are read in place, skip the end of the ring
+    uint32_t padding = (uint32_t) to_end | BINARY_LOG_PADDING;
+    memcpy(&ring->data[offset], &padding, sizeof(padding));
+    head += to_end;
+    offset = 0;
+  }
+  memcpy(&ring->data[offset], record, size);
+  __atomic_store_n(&ring->head, head + size, __ATOMIC_RELEASE);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void binary_log_record(
+  uint8_t level,
+  uint8_t proto,
+  const char *source_file,
+  unsigned int line,
+  const char *format,
+  va_list args)
+{
+  struct timespec now;
+  binary_log_ring_t *ring = get_ring();
+  if (!ring) {
+    __atomic_fetch_add(&g_binary_log.dropped_records, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  uint8_t *buf = (uint8_t *) tls_record;
+  binary_log_record_t *record = (binary_log_record_t *) tls_record;
+  size_t offset = sizeof(binary_log_record_t);
+
+  clock_gettime(CLOCK_REALTIME, &now);
+  record->line = line;
+  record->level = level;
+  record->proto = proto;
+  record->indent = (uint16_t) ring->indent;
+  record->dropped = ring->dropped;
+  record->timestamp_ns =
+    (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+  record->tid = (uint64_t) pthread_self();
+  record->format_id = (uint64_t)(uintptr_t) format;
+  record->file_id = (uint64_t)(uintptr_t) source_file;
+  if (!encode_args(buf, sizeof(tls_record), &offset, format, args)) {
+    char message[BINARY_LOG_MAX_MESSAGE_SIZE];
+    vsnprintf(message, sizeof(message), format, args);
+    record->format_id = (uint64_t)(uintptr_t) BINARY_LOG_PREFORMATTED;
+    offset = sizeof(binary_log_record_t);
+    put_string(buf, sizeof(tls_record), &offset, message, SIZE_MAX);
+  }
+  record->size = (uint32_t) offset;
+
+  if (ring_push(ring, record, offset)) {
+    ring->dropped = 0;
+  } else {
+    ring->dropped++;
+    __atomic_fetch_add(&g_binary_log.dropped_records, 1, __ATOMIC_RELAXED);
+  }
+}
+
+//------------------------------------------------------------------------------
+int binary_log_indent(int delta)
+{
+  binary_log_ring_t *ring = get_ring();
+  if (!ring) {
+    return 0;
+  }
+  ring->indent += delta;
+  if (ring->indent < 0) ring->indent = 0;
+  return ring->indent;
+}
+
+//------------------------------------------------------------------------------
+uint64_t binary_log_dropped_records(void)
+{
+  return __atomic_load_n(&g_binary_log.dropped_records, __ATOMIC_RELAXED);
+}
+
+//------------------------------------------------------------------------------
+static bool get_slot(
+  const binary_log_record_t *record,
+  size_t *offset,
+  uint64_t *value)
+{
+  if (*offset + BINARY_LOG_SLOT_SIZE > record->size) {
+    return false;
+  }
+  memcpy(value, (const uint8_t *) record + *offset, sizeof(*value));
+  *offset += BINARY_LOG_SLOT_SIZE;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+static const char *get_string(const binary_log_record_t *record, size_t *offset)
+{
+  uint32_t length = 0;
+  if (*offset + BINARY_LOG_SLOT_SIZE > record->size) {
+    return NULL;
+  }
+  memcpy(&length, (const uint8_t *) record + *offset, sizeof(length));
+  if (*offset + sizeof(length) + length + 1 > record->size) {
+    return NULL;
+  }
+  const char *str =
+    (const char *) record + *offset + sizeof(length);
+  *offset += BINARY_LOG_ALIGN(sizeof(length) + length + 1);
+  return str;
+}
+
+//------------------------------------------------------------------------------
+int binary_log_format(
+  const binary_log_record_t *record,
+  const char *format,
+  char *message,
+  size_t message_size)
+{
+  size_t offset = sizeof(binary_log_record_t);
+  size_t length = 0;
+  format_spec_t spec;
+  char conversion[32];
+  const char *literal = format;
+  const char *p = format;
+
+// Keeps counting the length once the message is truncated, like snprintf
+#define APPEND(...)                                                            \
+  do {                                                                         \
+    size_t used = (length < message_size) ? length : message_size - 1;        \
+    int n = snprintf(message + used, message_size - used, __VA_ARGS__);        \
+    if (n > 0) length += n;                                                    \
+  } while (0)
+
+  message[0] = '\0';
+  for (; *p; p++) {
+    if ('%' != *p) {
+      continue;
+    }
+    APPEND("%.*s", (int) (p - literal), literal);
+    if ('%' == p[1]) {
+      APPEND("%%");
+      literal = ++p + 1;
+      continue;
+    }
+    if (!parse_format_spec(p + 1, &spec)) {
+      literal = p;
+      break;
+    }
+    p = spec.end - 1;
+    literal = spec.end;
+
+    uint64_t value = 0;
+    int width = spec.width;
+    int precision = spec.precision;
+    bool has_precision = spec.has_precision;
+    bool is_left_justified = false;
+    if (spec.is_width_arg) {
+      if (!get_slot(record, &offset, &value)) break;
+      width = (int) (int64_t) value;
+      if (width < 0) {
+        is_left_justified = true;
+        width = -width;
+      }
+    }
+    if (spec.is_precision_arg) {
+      if (!get_slot(record, &offset, &value)) break;
+      precision = (int) (int64_t) value;
+      has_precision = (precision >= 0);
+    }
+
+    // Rebuild the conversion with the width and precision resolved, and the
+    // length modifier of the recorded 64 bits values
+    int n = snprintf(
+      conversion,
+      sizeof(conversion),
+      "%%%s%s",
+      spec.flags,
+      is_left_justified ? "-" : "");
+    if (spec.has_width) {
+      n += snprintf(conversion + n, sizeof(conversion) - n, "%d", width);
+    }
+    if (has_precision) {
+      n += snprintf(conversion + n, sizeof(conversion) - n, ".%d", precision);
+    }
+    if ((ARG_SIGNED == spec.arg) || (ARG_UNSIGNED == spec.arg)) {
+      n += snprintf(conversion + n, sizeof(conversion) - n, "ll");
+    }
+    snprintf(conversion + n, sizeof(conversion) - n, "%c", spec.conversion);
+
+    if (ARG_STRING == spec.arg) {
+      const char *str = get_string(record, &offset);
+      if (!str) break;
+      APPEND(conversion, str);
+    } else {
+      if (!get_slot(record, &offset, &value)) break;
+      switch (spec.arg) {
+        case ARG_SIGNED: APPEND(conversion, (long long) value); break;
+        case ARG_UNSIGNED: APPEND(conversion, (unsigned long long) value); break;
+        case ARG_CHAR: APPEND(conversion, (int) value); break;
+        case ARG_POINTER: APPEND(conversion, (void *) (uintptr_t) value); break;
+        case ARG_DOUBLE: {
+          double d = 0;
+          memcpy(&d, &value, sizeof(d));
+          APPEND(conversion, d);
+        } break;
+        default: break;
+      }
+    }
+  }
+  APPEND("%s", literal);
+#undef APPEND
+  return (int) length;
+}
+
+//------------------------------------------------------------------------------
+static void dump_string(uint64_t id)
+{
+  if (
+    HASH_TABLE_OK ==
+    hashtable_is_key_exists(g_binary_log.dumped_strings, (hash_key_t) id)) {
+    return;
+  }
+  hashtable_insert(g_binary_log.dumped_strings, (hash_key_t) id, NULL);
+  const char *str = id ? (const char *) (uintptr_t) id : "";
+  uint8_t type = BINARY_LOG_DUMP_STRING;
+  uint32_t length = (uint32_t) strlen(str);
+  fwrite(&type, sizeof(type), 1, g_binary_log.dump_fd);
+  fwrite(&id, sizeof(id), 1, g_binary_log.dump_fd);
+  fwrite(&length, sizeof(length), 1, g_binary_log.dump_fd);
+  fwrite(str, 1, length, g_binary_log.dump_fd);
+}
+
+//------------------------------------------------------------------------------
+static void binary_log_output(const binary_log_record_t *record)
+{
+  if (g_binary_log.dump_fd) {
+    uint8_t type = BINARY_LOG_DUMP_RECORD;
+    dump_string(record->format_id);
+    dump_string(record->file_id);
+    fwrite(&type, sizeof(type), 1, g_binary_log.dump_fd);
+    fwrite(record, 1, record->size, g_binary_log.dump_fd);
+  } else {
+    static char message[BINARY_LOG_MAX_MESSAGE_SIZE];
+    binary_log_format(
+      record,
+      (const char *) (uintptr_t) record->format_id,
+      message,
+      sizeof(message));
+    g_binary_log.output_cb(record, message);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Output the records of all the rings by order of timestamp
+// @return the number of records output
+static size_t drain_rings(void)
+{
+  binary_log_ring_t *rings = NULL;
+  size_t count = 0;
+
+  pthread_mutex_lock(&g_binary_log.rings_mutex);
+  rings = g_binary_log.rings;
+  pthread_mutex_unlock(&g_binary_log.rings_mutex);
+
+  // Only what is in the rings now, so that busy threads can't starve the flush
+  for (binary_log_ring_t *ring = rings; ring; ring = ring->next) {
+    ring->drain_head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  }
+  while (true) {
+    binary_log_ring_t *oldest_ring = NULL;
+    const binary_log_record_t *oldest = NULL;
+    for (binary_log_ring_t *ring = rings; ring; ring = ring->next) {
+      if (ring->tail == ring->drain_head) {
+        continue;
+      }
+      const binary_log_record_t *record =
+        (const binary_log_record_t *) &ring
+          ->data[ring->tail & BINARY_LOG_RING_MASK];
+      if (record->size & BINARY_LOG_PADDING) {
+        __atomic_store_n(
+          &ring->tail,
+          ring->tail + (record->size & ~BINARY_LOG_PADDING),
+          __ATOMIC_RELEASE);
+        record = (const binary_log_record_t *) &ring->data[0];
+        if (ring->tail == ring->drain_head) {
+          continue;
+        }
+      }
+      if (!oldest || record->timestamp_ns < oldest->timestamp_ns) {
+        oldest = record;
+        oldest_ring = ring;
+      }
+    }
+    if (!oldest) {
+      break;
+    }
+    binary_log_output(oldest);
+    __atomic_store_n(
+      &oldest_ring->tail, oldest_ring->tail + oldest->size, __ATOMIC_RELEASE);
+    count++;
+  }
+
+  // Free the rings of the threads that exited
+  pthread_mutex_lock(&g_binary_log.rings_mutex);
+  binary_log_ring_t **prev = &g_binary_log.rings;
+  while (*prev) {
+    binary_log_ring_t *ring = *prev;
+    if (
+      __atomic_load_n(&ring->is_closed, __ATOMIC_ACQUIRE) &&
+      (ring->tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE))) {
+      *prev = ring->next;
+      free(ring);
+    } else {
+      prev = &ring->next;
+    }
+  }
+  pthread_mutex_unlock(&g_binary_log.rings_mutex);
+  return count;
+}
+
+//------------------------------------------------------------------------------
+static void binary_log_flush(void)
+{
+  if (g_binary_log.dump_fd) {
+    fflush(g_binary_log.dump_fd);
+  } else if (g_binary_log.flush_cb) {
+    g_binary_log.flush_cb();
+  }
+}
+
+//------------------------------------------------------------------------------
+static void *binary_log_task(__attribute__((unused)) void *args_p)
+{
+  while (__atomic_load_n(&g_binary_log.is_running, __ATOMIC_ACQUIRE)) {
+    if (drain_rings()) {
+      binary_log_flush();
+    } else {
+      usleep(BINARY_LOG_DRAIN_PERIOD_MICRO_SEC);
+    }
+  }
+  drain_rings();
+  binary_log_flush();
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+int binary_log_start(
+  const char *dump_path,
+  binary_log_output_cb_t output_cb,
+  binary_log_flush_cb_t flush_cb)
+{
+  if (binary_log_is_running()) {
+    return 0;
+  }
+  if (!g_binary_log.is_ring_key_created) {
+    if (pthread_key_create(&g_binary_log.ring_key, binary_log_ring_closed)) {
+      return -1;
+    }
+    g_binary_log.is_ring_key_created = true;
+    // Don't lose the messages still in the rings on exit
+    atexit(binary_log_stop);
+  }
+  g_binary_log.output_cb = output_cb;
+  g_binary_log.flush_cb = flush_cb;
+  if (dump_path) {
+    g_binary_log.dump_fd = fopen(dump_path, "w");
+    if (!g_binary_log.dump_fd) {
+      fprintf(
+        stderr,
+        "Could not open binary log file %s : %s\n",
+        dump_path,
+        strerror(errno));
+      return -1;
+    }
+    fwrite(
+      BINARY_LOG_DUMP_MAGIC,
+      1,
+      strlen(BINARY_LOG_DUMP_MAGIC),
+      g_binary_log.dump_fd);
+    bstring b = bfromcstr("Binary log dumped strings");
+    g_binary_log.dumped_strings = hashtable_create(
+      BINARY_LOG_DUMPED_STRINGS_HTBL_SIZE, NULL, hash_free_int_func, b);
+    bdestroy(b);
+    g_binary_log.dumped_strings->log_enabled = false;
+  } else if (!output_cb) {
+    return -1;
+  }
+  __atomic_store_n(&g_binary_log.is_running, true, __ATOMIC_RELEASE);
+  if (pthread_create(&g_binary_log.thread, NULL, binary_log_task, NULL)) {
+    __atomic_store_n(&g_binary_log.is_running, false, __ATOMIC_RELEASE);
+    return -1;
+  }
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+void binary_log_stop(void)
+{
+  if (!binary_log_is_running()) {
+    return;
+  }
+  __atomic_store_n(&g_binary_log.is_running, false, __ATOMIC_RELEASE);
+  pthread_join(g_binary_log.thread, NULL);
+  if (g_binary_log.dump_fd) {
+    fclose(g_binary_log.dump_fd);
+    g_binary_log.dump_fd = NULL;
+    hashtable_destroy(g_binary_log.dumped_strings);
+    g_binary_log.dumped_strings = NULL;
+  }
+}
+
+//------------------------------------------------------------------------------
+bool binary_log_is_running(void)
+{
+  return __atomic_load_n(&g_binary_log.is_running, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,130 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-----------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*! \file binary_log.h
+  \brief Deferred formatting of log messages.
+  Each thread writes its log messages as compact binary records (format
+  string address, raw arguments, timestamp, thread, level) in its own single
+  producer single consumer ring. A background thread drains the rings and
+  either formats the records or dumps them raw to a file, which
+  lte/gateway/python/scripts/oai_log_decoder.py turns back into text.
+*/
+#ifndef FILE_BINARY_LOG_SEEN
+#define FILE_BINARY_LOG_SEEN
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BINARY_LOG_RING_SIZE (1 << 18)
+#define BINARY_LOG_MAX_RECORD_SIZE 4096
+#define BINARY_LOG_DRAIN_PERIOD_MICRO_SEC 10000
+
+/* First bytes of a raw dump file */
+#define BINARY_LOG_DUMP_MAGIC "OAIBLOG1"
+
+/* Entry types of a raw dump file, each followed by its payload:
+ * - BINARY_LOG_DUMP_STRING: uint64_t id, uint32_t length, the string bytes.
+ *   Defines the format string or file name an id in later records refers to.
+ * - BINARY_LOG_DUMP_RECORD: a binary_log_record_t and its arguments.
+ */
+#define BINARY_LOG_DUMP_STRING 1
+#define BINARY_LOG_DUMP_RECORD 2
+
+/*! \struct  binary_log_record_t
+* \brief Header of a log record, followed by its arguments in 8 bytes slots.
+* Integers are stored sign or zero extended to 64 bits, floating point numbers
+* as doubles, strings as a uint32_t length followed by the NUL terminated
+* characters padded to 8 bytes. The argument types are found again by parsing
+* the format string.
+*/
+typedef struct binary_log_record_s {
+  uint32_t size; /*!< \brief Size of the record with its arguments, multiple of 8 */
+  uint32_t line; /*!< \brief Source line of the log statement */
+  uint8_t level; /*!< \brief log_level_t of the message */
+  uint8_t proto; /*!< \brief log_proto_t of the message */
+  uint16_t indent; /*!< \brief Function call indentation of the thread */
+  uint32_t dropped; /*!< \brief Records of this thread dropped just before this one because its ring was full */
+  uint64_t timestamp_ns; /*!< \brief CLOCK_REALTIME when the message was logged */
+  uint64_t tid; /*!< \brief pthread_self() of the logging thread */
+  uint64_t format_id; /*!< \brief Address of the format string */
+  uint64_t file_id; /*!< \brief Address of the source file name */
+} binary_log_record_t;
+
+/* Called on the background thread with each record and its formatted message */
+typedef void (*binary_log_output_cb_t)(
+  const binary_log_record_t *record,
+  const char *message);
+/* Called on the background thread after each batch of records */
+typedef void (*binary_log_flush_cb_t)(void);
+
+/*
+ * Start the background thread. If dump_path is set, records are written raw
+ * to that file, otherwise they are formatted and passed to output_cb.
+ * @return 0 on success
+ */
+int binary_log_start(
+  const char *dump_path,
+  binary_log_output_cb_t output_cb,
+  binary_log_flush_cb_t flush_cb);
+
+/*
+ * Drain all the rings and stop the background thread
+ */
+void binary_log_stop(void);
+
+bool binary_log_is_running(void);
+
+/*
+ * Write a record in the ring of the calling thread. The record is dropped and
+ * counted if the ring is full. Format strings must outlive the process, i.e.
+ * be string literals, as only their address is recorded.
+ */
+void binary_log_record(
+  uint8_t level,
+  uint8_t proto,
+  const char *source_file,
+  unsigned int line,
+  const char *format,
+  va_list args);
+
+/*
+ * Adjust the function call indentation of the calling thread
+ * @return the new indentation
+ */
+int binary_log_indent(int delta);
+
+/*
+ * Total number of records dropped because of full rings
+ */
+uint64_t binary_log_dropped_records(void);
+
+/*
+ * Format the arguments of a record with its format string
+ * @return the length of the message, which is truncated to message_size
+ */
+int binary_log_format(
+  const binary_log_record_t *record,
+  const char *format,
+  char *message,
+  size_t message_size);
+
+#endif /* FILE_BINARY_LOG_SEEN */
@@ -110,3 +110,7 @@ void log_string(int32_t log_level, const char *str) {
   VLOG(log_level) << str;
   flush_log(log_level);
 }
+
+void log_string_no_flush(int32_t log_level, const char *str) {
+  VLOG(log_level) << str;
+}
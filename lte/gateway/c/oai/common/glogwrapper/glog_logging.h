@@ -41,6 +41,8 @@ extern "C" {
 
   void init_logging(const char *app_name, uint32_t default_verbosity);
   void log_string(int32_t log_level, const char *str);
+  // Leaves the flush to the caller, to flush a batch of strings at once
+  void log_string_no_flush(int32_t log_level, const char *str);
   void flush_log(int32_t log_level);
 
 #ifdef  __cplusplus
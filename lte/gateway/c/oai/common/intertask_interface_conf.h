@@ -47,4 +47,7 @@
 #define ITTI_QUEUE_MAX_ELEMENTS (64 * 1024)
 #define ITTI_DUMP_MAX_CON (5) /* Max connections in parallel */
 
+/* Max number of messages drained from a task queue per eventfd wakeup */
+#define ITTI_RECEIVE_BATCH_MAX (32)
+
 #endif /* FILE_INTERTASK_INTERFACE_CONF_SEEN */
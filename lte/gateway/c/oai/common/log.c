@@ -56,6 +56,7 @@
 
 #include "intertask_interface.h"
 #include "log.h"
+#include "binary_log.h"
 #include "timer.h"
 #include "shared_ts_log.h"
 #include "assertions.h"
@@ -126,6 +127,7 @@ typedef struct oai_log_s {
   bool
     is_output_is_fd; /* We may want to not use syslog even if exe is a daemon */
   bool is_async;     /* We way want no buffering */
+  bool is_binary;    /* Messages are formatted by the binary log thread */
   bool is_ansi_codes;      /* ANSI codes for color in console output */
   bstring bserver_address; /*!< \brief TCP remote (or local) server hostname */
   bstring bserver_port;    /*!< \brief TCP remote (or local) server port     */
@@ -156,6 +158,8 @@ typedef struct oai_log_s {
     log_handler; /*!< \brief Logging handler function pointers */
   oai_shared_log_handler_t
     shared_log_handler; /*!< \brief Logging handler function pointers */
+  bstring
+    binary_line; /*!< \brief Line being formatted by the binary log thread */
 } oai_log_t;
 
 #define _LOG_START_USE g_oai_log.log_handler.log_start_use
@@ -502,6 +506,97 @@ static void log_signal_callback_handler(int signum)
     return;
   }
 }
+//------------------------------------------------------------------------------
+// Called on the binary log thread with the same line layout as log_message_int
+static void log_binary_output(
+  const binary_log_record_t *record,
+  const char *message)
+{
+  char cur_time[26] = {0};
+  size_t filename_length = 0;
+  time_t seconds = (time_t)(record->timestamp_ns / 1000000000ULL);
+  log_level_t log_level = (log_level_t) record->level;
+  log_proto_t proto = (log_proto_t) record->proto;
+
+  if ((MAX_LOG_LEVEL <= log_level) || (MAX_LOG_PROTOS <= proto)) {
+    return;
+  }
+  ctime_r(&seconds, cur_time);
+  strtok(cur_time, "\n");
+  if (record->dropped) {
+    btrunc(g_oai_log.binary_line, 0);
+    bformata(
+      g_oai_log.binary_line,
+      "%06" PRIu64 " %s %08lX %-*.*s %-*.*s %u log messages dropped\n",
+      __sync_fetch_and_add(&g_oai_log.log_message_number, 1),
+      cur_time,
+      (unsigned long) record->tid,
+      LOG_DISPLAYED_LOG_LEVEL_NAME_MAX_LENGTH,
+      LOG_DISPLAYED_LOG_LEVEL_NAME_MAX_LENGTH,
+      &g_oai_log.log_level2str[OAILOG_LEVEL_WARNING][0],
+      LOG_DISPLAYED_PROTO_NAME_MAX_LENGTH,
+      LOG_DISPLAYED_PROTO_NAME_MAX_LENGTH,
+      &g_oai_log.log_proto2str[LOG_UTIL][0],
+      record->dropped);
+    log_string_no_flush(
+      g_oai_log.log_level2syslog[OAILOG_LEVEL_WARNING],
+      bdata(g_oai_log.binary_line));
+  }
+
+  const char *const short_source_fileP =
+    get_short_file_name((const char *) (uintptr_t) record->file_id);
+  filename_length =
+    MIN((strlen(short_source_fileP) - LOG_DISPLAYED_FILENAME_MAX_LENGTH), (0));
+  btrunc(g_oai_log.binary_line, 0);
+  bformata(
+    g_oai_log.binary_line,
+    "%06" PRIu64 " %s %08lX %-*.*s %-*.*s %-*.*s:%04u   %*s%s",
+    __sync_fetch_and_add(&g_oai_log.log_message_number, 1),
+    cur_time,
+    (unsigned long) record->tid,
+    LOG_DISPLAYED_LOG_LEVEL_NAME_MAX_LENGTH,
+    LOG_DISPLAYED_LOG_LEVEL_NAME_MAX_LENGTH,
+    &g_oai_log.log_level2str[log_level][0],
+    LOG_DISPLAYED_PROTO_NAME_MAX_LENGTH,
+    LOG_DISPLAYED_PROTO_NAME_MAX_LENGTH,
+    &g_oai_log.log_proto2str[proto][0],
+    LOG_DISPLAYED_FILENAME_MAX_LENGTH,
+    LOG_DISPLAYED_FILENAME_MAX_LENGTH,
+    &short_source_fileP[filename_length],
+    record->line,
+    (int) record->indent,
+    " ",
+    message);
+  if (g_oai_log.is_ansi_codes) {
+    bformata(g_oai_log.binary_line, "%s", ANSI_COLOR_RESET);
+  }
+  log_string_no_flush(
+    g_oai_log.log_level2syslog[log_level], bdata(g_oai_log.binary_line));
+}
+
+//------------------------------------------------------------------------------
+static void log_binary_flush(void)
+{
+  flush_log(MIN_LOG_LEVEL);
+}
+
+//------------------------------------------------------------------------------
+static void log_init_binary(const log_config_t *const config)
+{
+  if (!config->is_binary || g_oai_log.is_binary) {
+    return;
+  }
+  g_oai_log.binary_line = bfromcstralloc(LOG_MESSAGE_MIN_ALLOC_SIZE, "");
+  if (
+    0 != binary_log_start(
+           bdata(config->binary_dump), log_binary_output, log_binary_flush)) {
+    OAI_FPRINTF_ERR("Could not start binary logging, formatting messages\n");
+    bdestroy_wrapper(&g_oai_log.binary_line);
+    return;
+  }
+  g_oai_log.is_binary = true;
+}
+
 //------------------------------------------------------------------------------
 void log_configure(const log_config_t *const config)
 {
@@ -577,6 +672,7 @@ void log_configure(const log_config_t *const config)
   g_oai_log.is_async = config->is_output_thread_safe;
   g_oai_log.is_ansi_codes = config->color;
   log_init_handler(g_oai_log.is_async);
+  log_init_binary(config);
 
   if (config->output) {
     if (
@@ -919,6 +1015,11 @@ void log_exit(void)
   assert(g_oai_log.is_async);
 
   OAI_FPRINTF_INFO("[TRACE] Entering %s\n", __FUNCTION__);
+  if (g_oai_log.is_binary) {
+    g_oai_log.is_binary = false;
+    binary_log_stop();
+    bdestroy_wrapper(&g_oai_log.binary_line);
+  }
   if (g_oai_log.log_fd) {
     rv = fflush(g_oai_log.log_fd);
 
@@ -1433,6 +1534,31 @@ void log_func(
   hashtable_rc_t hash_rc = HASH_TABLE_OK;
   pthread_t p = pthread_self();
 
+  if (g_oai_log.is_binary) {
+    // The indentation lives in the binary ring of the thread, no context lookup
+    if (is_enteringP) {
+      log_message(
+        NULL,
+        OAILOG_LEVEL_TRACE,
+        protoP,
+        source_fileP,
+        line_numP,
+        "Entering %s()\n",
+        functionP);
+      binary_log_indent(LOG_FUNC_INDENT_SPACES);
+    } else {
+      binary_log_indent(-LOG_FUNC_INDENT_SPACES);
+      log_message(
+        NULL,
+        OAILOG_LEVEL_TRACE,
+        protoP,
+        source_fileP,
+        line_numP,
+        "Leaving %s()\n",
+        functionP);
+    }
+    return;
+  }
   hash_rc = hashtable_ts_get(
     g_oai_log.thread_context_htbl, (hash_key_t) p, (void **) &thread_ctxt);
   if (HASH_TABLE_KEY_NOT_EXISTS == hash_rc) {
@@ -1478,6 +1604,19 @@ void log_func_return(
   hashtable_rc_t hash_rc = HASH_TABLE_OK;
   pthread_t p = pthread_self();
 
+  if (g_oai_log.is_binary) {
+    binary_log_indent(-LOG_FUNC_INDENT_SPACES);
+    log_message(
+      NULL,
+      OAILOG_LEVEL_TRACE,
+      protoP,
+      source_fileP,
+      line_numP,
+      "Leaving %s() (rc=%ld)\n",
+      functionP,
+      return_codeP);
+    return;
+  }
   hash_rc = hashtable_ts_get(
     g_oai_log.thread_context_htbl, (hash_key_t) p, (void **) &thread_ctxt);
   if (HASH_TABLE_KEY_NOT_EXISTS == hash_rc) {
@@ -1514,6 +1653,15 @@ void log_message(
   log_queue_item_t *new_item_p_sync = NULL;
   struct shared_log_queue_item_s *new_item_p_async = NULL;
 
+  if (g_oai_log.is_binary) {
+    if (log_is_enabled(log_levelP, protoP)) {
+      va_start(args, format);
+      binary_log_record(
+        log_levelP, protoP, source_fileP, line_numP, format, args);
+      va_end(args);
+    }
+    return;
+  }
   va_start(args, format);
   log_message_int(
     thread_ctxtP,
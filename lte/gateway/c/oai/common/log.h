@@ -103,6 +103,8 @@ extern int fd_g_debug_lvl;
 #define ANSI_COLOR_CONCEALED_ON "\x1b[8m"
 
 #define LOG_CONFIG_STRING_ASYNC_SYSTEM_LOG_LEVEL "ASYNC_SYSTEM"
+#define LOG_CONFIG_STRING_BINARY "BINARY"
+#define LOG_CONFIG_STRING_BINARY_DUMP "BINARY_DUMP"
 #define LOG_CONFIG_STRING_COLOR "COLOR"
 #define LOG_CONFIG_STRING_OUTPUT_CONSOLE "CONSOLE"
 #define LOG_CONFIG_STRING_GTPV1U_LOG_LEVEL "GTPV1U_LOG_LEVEL"
@@ -239,6 +241,10 @@ typedef struct log_config_s {
   uint8_t
     asn1_verbosity_level; /*!< \brief related to asn1c generated code for S1AP verbosity level */
   bool color; /*!< \brief use of ANSI styling codes or no */
+  bool
+    is_binary; /*!< \brief Tasks record binary messages, formatted later by a background thread */
+  bstring
+    binary_dump; /*!< \brief If set with is_binary, binary messages are dumped to this file instead of being formatted */
 } log_config_t;
 
 inline void nop(int x, ...)
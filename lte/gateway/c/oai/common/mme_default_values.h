@@ -63,6 +63,7 @@
 #define SCTP_OUT_STREAMS (32)
 #define SCTP_IN_STREAMS (32)
 #define SCTP_MAX_ATTEMPTS (5)
+#define SCTP_RECV_WORKERS (1)
 
 /*******************************************************************************
  * MME global definitions
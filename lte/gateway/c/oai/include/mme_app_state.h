@@ -58,6 +58,20 @@ mme_app_desc_t* get_mme_nas_state(bool read_from_db);
 */
 void put_mme_nas_state(mme_app_desc_t** task_state_ptr);
 
+/**
+ * Mark the UE context of mme_ue_s1ap_id as modified. In per-UE persistence
+ * mode only the marked UE contexts are written by put_mme_nas_state(). This is
+ * a thread safe call
+*/
+void mme_nas_state_mark_ue_dirty(mme_ue_s1ap_id_t mme_ue_s1ap_id);
+
+/**
+ * Block until the MME/NAS state modified so far is committed to data store.
+ * Only waits when state writes are write-behind, for detach and purge paths
+ * that must be durable before replying. Called with the state locked
+*/
+int mme_nas_state_sync_to_db(void);
+
 /**
  * Release the memory allocated for the MME NAS state, this does not clean the
  * state persisted in data store
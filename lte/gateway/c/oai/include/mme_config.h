@@ -45,6 +45,7 @@
 #include "3gpp_23.003.h"
 #include "3gpp_24.008.h"
 #include "log.h"
+#include "memory_pools.h"
 #include "service303.h"
 
 #define MAX_GUMMEI 2
@@ -61,6 +62,9 @@
 
 #define MME_CONFIG_STRING_IP_CAPABILITY "IP_CAPABILITY"
 #define MME_CONFIG_STRING_USE_STATELESS "USE_STATELESS"
+#define MME_CONFIG_STRING_USE_STATELESS_PER_UE "USE_STATELESS_PER_UE"
+#define MME_CONFIG_STRING_STATE_WRITE_BEHIND_WINDOW_MS                          \
+  "STATE_WRITE_BEHIND_WINDOW_MS"
 #define MME_CONFIG_STRING_FULL_NETWORK_NAME "FULL_NETWORK_NAME"
 #define MME_CONFIG_STRING_SHORT_NETWORK_NAME "SHORT_NETWORK_NAME"
 #define MME_CONFIG_STRING_DAYLIGHT_SAVING_TIME "DAYLIGHT_SAVING_TIME"
@@ -83,6 +87,12 @@
 
 #define MME_CONFIG_STRING_INTERTASK_INTERFACE_CONFIG "INTERTASK_INTERFACE"
 #define MME_CONFIG_STRING_INTERTASK_INTERFACE_QUEUE_SIZE "ITTI_QUEUE_SIZE"
+#define MME_CONFIG_STRING_INTERTASK_INTERFACE_MEMORY_POOLS "MEMORY_POOLS"
+#define MME_CONFIG_STRING_INTERTASK_INTERFACE_MEMORY_POOL_ITEM_SIZE "ITEM_SIZE"
+#define MME_CONFIG_STRING_INTERTASK_INTERFACE_MEMORY_POOL_ITEMS "ITEMS"
+#define MME_CONFIG_STRING_INTERTASK_INTERFACE_MEMORY_POOLS_GROWTH              \
+  "MEMORY_POOLS_GROWTH"
+#define MAX_ITTI_MEMORY_POOLS 10
 
 #define MME_CONFIG_STRING_S6A_CONFIG "S6A"
 #define MME_CONFIG_STRING_S6A_CONF_FILE_PATH "S6A_CONF"
@@ -91,6 +101,8 @@
 #define MME_CONFIG_STRING_SCTP_CONFIG "SCTP"
 #define MME_CONFIG_STRING_SCTP_INSTREAMS "SCTP_INSTREAMS"
 #define MME_CONFIG_STRING_SCTP_OUTSTREAMS "SCTP_OUTSTREAMS"
+#define MME_CONFIG_STRING_SCTP_SHM_RINGS "SCTP_SHM_RINGS"
+#define MME_CONFIG_STRING_SCTP_RECV_WORKERS "SCTP_RECV_WORKERS"
 
 #define MME_CONFIG_STRING_S1AP_CONFIG "S1AP"
 #define MME_CONFIG_STRING_S1AP_OUTCOME_TIMER "S1AP_OUTCOME_TIMER"
@@ -183,6 +195,10 @@ typedef struct served_tai_s {
 typedef struct sctp_config_s {
   uint16_t in_streams;
   uint16_t out_streams;
+  // Exchange packets with sctpd over shared memory rings instead of GRPC
+  bool use_shm_rings;
+  // Number of sctpd threads receiving from the eNB associations
+  uint16_t recv_workers;
 } sctp_config_t;
 
 typedef struct s1ap_config_s {
@@ -209,6 +225,10 @@ typedef struct s6a_config_s {
 typedef struct itti_config_s {
   uint32_t queue_size;
   bstring log_file;
+  // Layout of the message memory pools, the ITTI default one if none
+  uint32_t memory_pools_number;
+  memory_pool_config_t memory_pools[MAX_ITTI_MEMORY_POOLS];
+  bool memory_pools_growth;
 } itti_config_t;
 
 typedef struct nas_config_s {
@@ -296,6 +316,9 @@ typedef struct mme_config_s {
   lai_t lai;
 
   bool use_stateless;
+  bool use_stateless_per_ue;
+  // Coalescing window for asynchronous state writes, 0 writes synchronously
+  uint32_t state_write_behind_window_ms;
 } mme_config_t;
 
 extern mme_config_t mme_config;
@@ -85,7 +85,7 @@ MESSAGE_DEF(
   s11_release_access_bearers_response)
 MESSAGE_DEF(
   S11_PAGING_REQUEST,
-  MESSAGE_PRIORITY_MED,
+  MESSAGE_PRIORITY_MAX_LEAST,
   itti_s11_paging_request_t,
   s11_paging_request)
 MESSAGE_DEF(
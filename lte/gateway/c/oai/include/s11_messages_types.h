@@ -1212,12 +1212,16 @@ typedef struct itti_s11_delete_bearer_command_s {
   struct in_addr peer_ip;
 } itti_s11_delete_bearer_command_s;
 
+#define S11_PAGING_REQUEST_MAX_IMSIS 16
+
 /**
- * Message used to notify MME that a paging message should be sent to the UE
- * at the given imsi
+ * Message used to notify MME that a paging message should be sent to the UEs
+ * at the given imsis. The imsi strings are allocated by the sender and freed
+ * by MME
  */
 typedef struct itti_s11_paging_request_s {
-  const char *imsi;
+  uint8_t imsis_number;
+  char *imsi[S11_PAGING_REQUEST_MAX_IMSIS];
 } itti_s11_paging_request_t;
 
 /**
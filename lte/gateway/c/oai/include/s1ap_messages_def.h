@@ -158,7 +158,7 @@ MESSAGE_DEF(
   s1ap_enb_initiated_reset_ack)
 MESSAGE_DEF(
   S1AP_PAGING_REQUEST,
-  MESSAGE_PRIORITY_MED,
+  MESSAGE_PRIORITY_MAX_LEAST,
   itti_s1ap_paging_request_t,
   s1ap_paging_request)
 MESSAGE_DEF(
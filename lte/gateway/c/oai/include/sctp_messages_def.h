@@ -41,12 +41,12 @@ MESSAGE_DEF(SCTP_DATA_IND, MESSAGE_PRIORITY_MED, sctp_data_ind_t, sctp_data_ind)
 MESSAGE_DEF(SCTP_DATA_CNF, MESSAGE_PRIORITY_MED, sctp_data_cnf_t, sctp_data_cnf)
 MESSAGE_DEF(
   SCTP_NEW_ASSOCIATION,
-  MESSAGE_PRIORITY_MAX,
+  MESSAGE_PRIORITY_MED,
   sctp_new_peer_t,
   sctp_new_peer)
 MESSAGE_DEF(
   SCTP_CLOSE_ASSOCIATION,
-  MESSAGE_PRIORITY_MAX,
+  MESSAGE_PRIORITY_MED,
   sctp_close_association_t,
   sctp_close_association)
 MESSAGE_DEF(
@@ -88,6 +88,8 @@ typedef struct sctp_init_s {
   struct in6_addr ipv6_address[10];
   uint16_t port;
   uint32_t ppid;
+  /* Number of sctpd receive workers */
+  uint16_t recv_workers;
 } sctp_init_t;
 
 typedef struct sctp_close_association_s {
@@ -152,6 +152,54 @@ void observe_histogram(
   size_t n_labels,
   ...);
 
+/**
+ * Handles to a counter or gauge timeseries, for call sites hot enough that
+ * looking the metric up by name and labels on every update matters. A handle
+ * is resolved once and stays valid for the life of the process, so it can be
+ * kept in a static, resolved under pthread_once. Usage example:
+ *    static pthread_once_t attach_counter_once = PTHREAD_ONCE_INIT;
+ *    static counter_handle_t *attach_counter = NULL;
+ *    static void init_attach_counter(void)
+ *    {
+ *      attach_counter = get_counter_handle("ue_attach", NO_LABELS);
+ *    }
+ *    ...
+ *    pthread_once(&attach_counter_once, init_attach_counter);
+ *    counter_handle_increment(attach_counter, 1);
+ *
+ * Updating a handle is lock free and can be done from any thread.
+ */
+typedef struct counter_handle_s counter_handle_t;
+typedef struct gauge_handle_s gauge_handle_t;
+
+/**
+ * Resolve the counter defined by the name and label set, initializing it if
+ * it doesn't yet exist. Takes the same labels as increment_counter
+ *
+ * @param name: the counter family name
+ * @param n_labels: the number of label pairs used or NO_LABELS
+ * @return the handle of the counter, never NULL
+ */
+counter_handle_t *get_counter_handle(const char *name, size_t n_labels, ...);
+
+void counter_handle_increment(counter_handle_t *handle, double increment);
+
+/**
+ * Resolve the gauge defined by the name and label set, initializing it if it
+ * doesn't yet exist. Takes the same labels as increment_gauge
+ *
+ * @param name: the gauge family name
+ * @param n_labels: the number of label pairs used or NO_LABELS
+ * @return the handle of the gauge, never NULL
+ */
+gauge_handle_t *get_gauge_handle(const char *name, size_t n_labels, ...);
+
+void gauge_handle_increment(gauge_handle_t *handle, double increment);
+
+void gauge_handle_decrement(gauge_handle_t *handle, double decrement);
+
+void gauge_handle_set(gauge_handle_t *handle, double value);
+
 /**
  * Simple helper function to set application health in the service. Only needed
  * to be called from a .c file.
@@ -84,7 +84,7 @@ MESSAGE_DEF(
   sgsap_vlr_reset_ack)
 MESSAGE_DEF(
   SGSAP_PAGING_REQUEST,
-  MESSAGE_PRIORITY_MED,
+  MESSAGE_PRIORITY_MAX_LEAST,
   itti_sgsap_paging_request_t,
   sgsap_paging_request)
 MESSAGE_DEF(
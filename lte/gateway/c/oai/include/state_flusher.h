@@ -0,0 +1,307 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <assertions.h>
+#include <common_defs.h>
+#include <log.h>
+
+#ifdef __cplusplus
+}
+#endif
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <cpp_redis/cpp_redis>
+
+#include "service303.h"
+
+namespace magma {
+namespace lte {
+
+/**
+ * StateFlusher writes serialized task state to db from a background thread,
+ * so that task threads don't block on a db round trip for every message.
+ * Writes to the same key queued within the flush window are coalesced, only
+ * the last value is written, and every batch is committed as one pipeline.
+ * Failed batches are retried, unless a newer write to the key was queued.
+ */
+class StateFlusher {
+ public:
+  /**
+   * @param name task name, used as label of the flusher metrics
+   * @param log_task log protocol of the task owning the flusher
+   * @param flush_window time writes are held for coalescing before a flush
+   */
+  StateFlusher(
+    const std::string& name,
+    log_proto_t log_task,
+    std::chrono::milliseconds flush_window):
+    name_(name),
+    log_task_(log_task),
+    flush_window_(flush_window),
+    running_(false),
+    flush_requested_(false),
+    started_flushes_(0),
+    finished_flushes_(0),
+    last_flush_rc_(RETURNok)
+  {
+  }
+
+  ~StateFlusher() { stop(); }
+
+  StateFlusher(StateFlusher const&) = delete;
+  StateFlusher& operator=(StateFlusher const&) = delete;
+
+  /**
+   * Connects the flusher db client and starts the flusher thread. The
+   * flusher uses its own client, as db clients are not shared across threads.
+   * @return response code of the db connection
+   */
+  int start(const std::string& addr, uint32_t port)
+  {
+    db_client_ = std::make_unique<cpp_redis::client>();
+    db_client_->connect(addr, port, nullptr);
+    if (!db_client_->is_connected()) {
+      OAILOG_ERROR(log_task_, "State flusher failed to connect to redis");
+      return RETURNerror;
+    }
+
+    running_ = true;
+    flusher_thread_ = std::thread(&StateFlusher::run, this);
+    OAILOG_INFO(
+      log_task_,
+      "Started %s state flusher with a %ld ms flush window",
+      name_.c_str(),
+      (long) flush_window_.count());
+    return RETURNok;
+  }
+
+  /**
+   * Flushes all queued writes and stops the flusher thread
+   */
+  void stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!running_) {
+        return;
+      }
+      running_ = false;
+    }
+    cv_.notify_all();
+    flusher_thread_.join();
+    flushed_cv_.notify_all();
+  }
+
+  void set(const std::string& key, const std::string& value)
+  {
+    enqueue(WriteKey(key, std::string()), WriteOp::SET, value);
+  }
+
+  void hset(
+    const std::string& key,
+    const std::string& field,
+    const std::string& value)
+  {
+    enqueue(WriteKey(key, field), WriteOp::HSET, value);
+  }
+
+  void hdel(const std::string& key, const std::string& field)
+  {
+    enqueue(WriteKey(key, field), WriteOp::HDEL, std::string());
+  }
+
+  /**
+   * Barrier for writes which must be durable before the task goes on, e.g.
+   * before replying to a detach. Flushes immediately and blocks until every
+   * write queued before the call is committed.
+   * @return response code of the flushes covering the queued writes
+   */
+  int flush_sync()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_) {
+      return RETURNerror;
+    }
+    if (pending_.empty() && finished_flushes_ == started_flushes_) {
+      // Nothing queued or in flight, failed writes are queued again
+      return RETURNok;
+    }
+    // A flush started after this call covers every write queued before it
+    uint64_t target_flush = started_flushes_ + 1;
+    flush_requested_ = true;
+    cv_.notify_all();
+    flushed_cv_.wait(
+      lock, [&] { return finished_flushes_ >= target_flush || !running_; });
+    return finished_flushes_ >= target_flush ? last_flush_rc_ : RETURNerror;
+  }
+
+ private:
+  enum class WriteOp { SET, HSET, HDEL };
+  struct PendingWrite {
+    WriteOp op;
+    std::string value;
+  };
+  // Pair of key and hash field, the field is empty for plain keys
+  using WriteKey = std::pair<std::string, std::string>;
+  using WriteBatch = std::map<WriteKey, PendingWrite>;
+
+  void enqueue(WriteKey key, WriteOp op, const std::string& value)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_[std::move(key)] = PendingWrite{op, value};
+    }
+    cv_.notify_one();
+  }
+
+  void run()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_ || !pending_.empty()) {
+      cv_.wait(lock, [&] {
+        return !running_ || flush_requested_ || !pending_.empty();
+      });
+      // Hold the first write of a batch for the flush window, so that
+      // following writes to the same keys are coalesced
+      if (running_ && !flush_requested_) {
+        cv_.wait_for(
+          lock, flush_window_, [&] { return !running_ || flush_requested_; });
+      }
+
+      WriteBatch batch;
+      batch.swap(pending_);
+      started_flushes_++;
+      flush_requested_ = false;
+      lock.unlock();
+
+      int rc = RETURNok;
+      if (!batch.empty()) {
+        set_gauge(
+          "state_flush_batch_size", batch.size(), 1, "task", name_.c_str());
+        rc = commit(batch);
+      }
+
+      lock.lock();
+      if (rc != RETURNok && running_) {
+        // Retry on the next flush, newer writes to the same keys win
+        pending_.insert(batch.begin(), batch.end());
+      }
+      // Writes queued during the commit and failed writes wait for the next
+      // flush
+      set_gauge(
+        "state_flush_queue_depth", pending_.size(), 1, "task", name_.c_str());
+      finished_flushes_ = started_flushes_;
+      last_flush_rc_ = rc;
+      flushed_cv_.notify_all();
+    }
+  }
+
+  int commit(const WriteBatch& batch)
+  {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::future<cpp_redis::reply>> db_write_futs;
+    db_write_futs.reserve(batch.size());
+    for (const auto& write : batch) {
+      const auto& key = write.first.first;
+      const auto& field = write.first.second;
+      switch (write.second.op) {
+        case WriteOp::SET:
+          db_write_futs.push_back(db_client_->set(key, write.second.value));
+          break;
+        case WriteOp::HSET:
+          db_write_futs.push_back(
+            db_client_->hset(key, field, write.second.value));
+          break;
+        case WriteOp::HDEL:
+          db_write_futs.push_back(db_client_->hdel(key, {field}));
+          break;
+      }
+    }
+    db_client_->sync_commit();
+
+    int rc = RETURNok;
+    for (auto& db_write_fut : db_write_futs) {
+      if (db_write_fut.get().is_error()) {
+        rc = RETURNerror;
+      }
+    }
+
+    double latency_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    observe_histogram(
+      "state_flush_latency_ms",
+      latency_ms,
+      1,
+      "task",
+      name_.c_str(),
+      (size_t) 5,
+      1.,
+      5.,
+      10.,
+      50.,
+      100.);
+    if (rc != RETURNok) {
+      OAILOG_ERROR(
+        log_task_, "Failed to flush %zu state writes to db", batch.size());
+      increment_counter("state_flush_failures", 1, 1, "task", name_.c_str());
+    } else {
+      OAILOG_DEBUG(log_task_, "Flushed %zu state writes to db", batch.size());
+    }
+    return rc;
+  }
+
+  std::string name_;
+  log_proto_t log_task_;
+  std::chrono::milliseconds flush_window_;
+  std::unique_ptr<cpp_redis::client> db_client_;
+  std::thread flusher_thread_;
+  std::mutex mutex_;
+  // Signals queued writes and flush requests to the flusher thread
+  std::condition_variable cv_;
+  // Signals finished flushes to flush_sync callers
+  std::condition_variable flushed_cv_;
+  bool running_;
+  bool flush_requested_;
+  WriteBatch pending_;
+  // Number of flushes started and finished by the flusher thread
+  uint64_t started_flushes_;
+  uint64_t finished_flushes_;
+  int last_flush_rc_;
+};
+
+} // namespace lte
+} // namespace magma
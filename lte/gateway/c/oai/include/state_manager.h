@@ -34,13 +34,21 @@ extern "C" {
 }
 #endif
 
+#include <string>
+#include <unordered_set>
+#include <vector>
+
 #include <cpp_redis/cpp_redis>
 
 #include "ServiceConfigLoader.h"
+#include "state_flusher.h"
 
 namespace magma {
 namespace lte {
 
+// Number of records requested per HSCAN call when reading records from db
+constexpr std::size_t STATE_RECORDS_SCAN_COUNT = 1000;
+
 template<typename StateType, typename ProtoType, typename StateConverter>
 class StateManager {
  public:
@@ -79,6 +87,10 @@ class StateManager {
       is_initialized,
       "StateManager init() function should be called to initialize state");
 
+    if (persist_state_enabled && persist_records_enabled) {
+      return read_records_from_db();
+    }
+
     if (persist_state_enabled) {
       auto db_read_fut = db_client->get(table_key);
       db_client->sync_commit();
@@ -115,29 +127,53 @@ class StateManager {
       return;
     }
 
-    if (persist_state_enabled) {
-      std::string serialized_state_s;
-      ProtoType state_proto = ProtoType();
-      StateConverter::state_to_proto(state_cache_p, &state_proto);
-
-      if (!state_proto.SerializeToString(&serialized_state_s)) {
-        OAILOG_ERROR(log_task, "Failed to serialize state protobuf");
-        return;
-      }
+    if (persist_state_enabled && write_state(false) != RETURNok) {
+      return;
+    }
 
-      auto db_write_fut = db_client->set(table_key, serialized_state_s);
-      db_client->sync_commit();
-      auto db_write_reply = db_write_fut.get();
+    this->state_dirty = false;
+  }
 
-      if (db_write_reply.is_error()) {
-        OAILOG_ERROR(log_task, "Failed to write state to db");
-        return;
-      }
+  /**
+   * Barrier for state changes which must be durable before the task goes on,
+   * e.g. before replying to a detach. With write-behind enabled, writes the
+   * current state and blocks until the flusher committed it. Otherwise this
+   * is a no-op, as every write_state_to_db call is synchronous. Records stay
+   * marked as dirty, as the task may still change them before the end of the
+   * message.
+   * @return response code of operation
+   */
+  int sync_state_to_db()
+  {
+    if (!persist_state_enabled || !state_flusher) {
+      return RETURNok;
+    }
+    if (write_state(true) != RETURNok) {
+      return RETURNerror;
+    }
+    return state_flusher->flush_sync();
+  }
 
-      OAILOG_DEBUG(log_task, "Finished writing state");
+  /**
+   * Marks the record stored under record_key as modified, so that it is
+   * written to db on the next write_state_to_db call. Only used when state is
+   * persisted as separate records.
+   * @param record_key key of the record in the records hash
+   */
+  void mark_record_dirty(const std::string& record_key)
+  {
+    if (records_persisted()) {
+      dirty_records.insert(record_key);
     }
+  }
 
-    this->state_dirty = false;
+  /**
+   * Lets callers skip building record keys when records aren't persisted
+   * @return true if state is written to db as separate records
+   */
+  bool records_persisted() const
+  {
+    return persist_state_enabled && persist_records_enabled;
   }
 
   /**
@@ -162,6 +198,16 @@ class StateManager {
       return RETURNerror;
     }
 
+    if (persist_state_enabled && write_behind_window_ms > 0) {
+      state_flusher = std::make_unique<StateFlusher>(
+        table_key,
+        log_task,
+        std::chrono::milliseconds(write_behind_window_ms));
+      if (state_flusher->start(addr, port) != RETURNok) {
+        return RETURNerror;
+      }
+    }
+
     OAILOG_INFO(
       log_task, "Connected to redis datastore on %s:%u\n", addr.c_str(), port);
 
@@ -178,6 +224,8 @@ class StateManager {
     is_initialized(false),
     state_dirty(false),
     persist_state_enabled(false),
+    persist_records_enabled(false),
+    write_behind_window_ms(0),
     state_cache_p(nullptr),
     log_task(LOG_MME_APP)
   {
@@ -189,6 +237,239 @@ class StateManager {
    */
   virtual void create_state() = 0;
 
+  /**
+   * Converts the part of the state which is not persisted as records to
+   * proto. Tasks persisting records override this to leave them out.
+   */
+  virtual void global_state_to_proto(ProtoType* state_proto)
+  {
+    StateConverter::state_to_proto(state_cache_p, state_proto);
+  }
+
+  /**
+   * Reads the part of the state which is not persisted as records from proto
+   */
+  virtual void proto_to_global_state(const ProtoType& state_proto)
+  {
+    StateConverter::proto_to_state(state_proto, state_cache_p);
+  }
+
+  /**
+   * Serializes the record stored under record_key in state_cache_p
+   * @return false if the record was removed from the state
+   */
+  virtual bool serialize_record(
+    const std::string& record_key,
+    std::string* serialized_record)
+  {
+    return false;
+  }
+
+  /**
+   * Parses a record read from db and inserts it in state_cache_p
+   */
+  virtual void deserialize_record(
+    const std::string& record_key,
+    const std::string& serialized_record)
+  {
+  }
+
+  /**
+   * Writes the state to db, or queues it on the flusher with write-behind
+   * @param keep_dirty_records keeps the written records marked as dirty
+   * @return response code of operation
+   */
+  int write_state(bool keep_dirty_records)
+  {
+    if (persist_records_enabled) {
+      return write_records_to_db(keep_dirty_records);
+    }
+
+    std::string serialized_state_s;
+    ProtoType state_proto = ProtoType();
+    StateConverter::state_to_proto(state_cache_p, &state_proto);
+
+    if (!state_proto.SerializeToString(&serialized_state_s)) {
+      OAILOG_ERROR(log_task, "Failed to serialize state protobuf");
+      return RETURNerror;
+    }
+
+    if (state_flusher) {
+      state_flusher->set(table_key, serialized_state_s);
+      return RETURNok;
+    }
+
+    auto db_write_fut = db_client->set(table_key, serialized_state_s);
+    db_client->sync_commit();
+    auto db_write_reply = db_write_fut.get();
+
+    if (db_write_reply.is_error()) {
+      OAILOG_ERROR(log_task, "Failed to write state to db");
+      return RETURNerror;
+    }
+
+    OAILOG_DEBUG(log_task, "Finished writing state");
+    return RETURNok;
+  }
+
+  /**
+   * Writes the records marked as dirty and, if it changed, the global state
+   * with a single round trip to db. Records stay marked on failure, so they
+   * are retried on the next write.
+   * @param keep_dirty_records keeps the written records marked as dirty
+   * @return response code of operation
+   */
+  int write_records_to_db(bool keep_dirty_records)
+  {
+    if (state_flusher) {
+      return queue_records(keep_dirty_records);
+    }
+
+    std::string serialized_global_state;
+    ProtoType state_proto = ProtoType();
+    global_state_to_proto(&state_proto);
+    if (!state_proto.SerializeToString(&serialized_global_state)) {
+      OAILOG_ERROR(log_task, "Failed to serialize state protobuf");
+      return RETURNerror;
+    }
+
+    std::vector<std::future<cpp_redis::reply>> db_write_futs;
+    std::vector<std::string> removed_records;
+    std::string serialized_record;
+    for (const auto& record_key : dirty_records) {
+      if (serialize_record(record_key, &serialized_record)) {
+        db_write_futs.push_back(
+          db_client->hset(records_table_key, record_key, serialized_record));
+      } else {
+        removed_records.push_back(record_key);
+      }
+    }
+    if (!removed_records.empty()) {
+      db_write_futs.push_back(
+        db_client->hdel(records_table_key, removed_records));
+    }
+    bool global_state_changed = serialized_global_state != last_global_state;
+    if (global_state_changed) {
+      db_write_futs.push_back(
+        db_client->set(table_key, serialized_global_state));
+    }
+
+    if (db_write_futs.empty()) {
+      return RETURNok;
+    }
+    db_client->sync_commit();
+
+    int rc = RETURNok;
+    for (auto& db_write_fut : db_write_futs) {
+      if (db_write_fut.get().is_error()) {
+        rc = RETURNerror;
+      }
+    }
+    if (rc != RETURNok) {
+      OAILOG_ERROR(log_task, "Failed to write state records to db");
+      last_global_state.clear();
+      return RETURNerror;
+    }
+
+    OAILOG_DEBUG(
+      log_task,
+      "Finished writing %zu state records",
+      dirty_records.size());
+    if (!keep_dirty_records) {
+      dirty_records.clear();
+    }
+    last_global_state = std::move(serialized_global_state);
+    return RETURNok;
+  }
+
+  /**
+   * Queues the records marked as dirty and the global state on the flusher
+   * @param keep_dirty_records keeps the queued records marked as dirty
+   * @return response code of operation
+   */
+  int queue_records(bool keep_dirty_records)
+  {
+    std::string serialized_global_state;
+    ProtoType state_proto = ProtoType();
+    global_state_to_proto(&state_proto);
+    if (!state_proto.SerializeToString(&serialized_global_state)) {
+      OAILOG_ERROR(log_task, "Failed to serialize state protobuf");
+      return RETURNerror;
+    }
+
+    std::string serialized_record;
+    for (const auto& record_key : dirty_records) {
+      if (serialize_record(record_key, &serialized_record)) {
+        state_flusher->hset(records_table_key, record_key, serialized_record);
+      } else {
+        state_flusher->hdel(records_table_key, record_key);
+      }
+    }
+    if (!keep_dirty_records) {
+      dirty_records.clear();
+    }
+    if (serialized_global_state != last_global_state) {
+      state_flusher->set(table_key, serialized_global_state);
+      last_global_state = std::move(serialized_global_state);
+    }
+    return RETURNok;
+  }
+
+  /**
+   * Reads the global state and then scans all records from db
+   * @return response code of operation
+   */
+  int read_records_from_db()
+  {
+    auto db_read_fut = db_client->get(table_key);
+    db_client->sync_commit();
+    auto db_read_reply = db_read_fut.get();
+
+    if (db_read_reply.is_error()) {
+      OAILOG_ERROR(log_task, "Failed to read state from db");
+      return RETURNerror;
+    }
+    if (db_read_reply.is_string()) {
+      ProtoType state_proto = ProtoType();
+      if (!state_proto.ParseFromString(db_read_reply.as_string())) {
+        OAILOG_ERROR(log_task, "Failed to parse state");
+        return RETURNerror;
+      }
+      proto_to_global_state(state_proto);
+      last_global_state = db_read_reply.as_string();
+    }
+
+    std::size_t cursor = 0;
+    std::size_t num_records = 0;
+    do {
+      auto db_scan_fut = db_client->hscan(
+        records_table_key, cursor, STATE_RECORDS_SCAN_COUNT);
+      db_client->sync_commit();
+      auto db_scan_reply = db_scan_fut.get();
+
+      if (
+        db_scan_reply.is_error() || !db_scan_reply.is_array() ||
+        db_scan_reply.as_array().size() != 2) {
+        OAILOG_ERROR(log_task, "Failed to scan state records from db");
+        return RETURNerror;
+      }
+
+      const auto& scan_result = db_scan_reply.as_array();
+      cursor = std::stoull(scan_result[0].as_string());
+      const auto& fields = scan_result[1].as_array();
+      // Record keys and values are interleaved in the reply
+      for (std::size_t i = 0; i + 1 < fields.size(); i += 2) {
+        deserialize_record(fields[i].as_string(), fields[i + 1].as_string());
+        num_records++;
+      }
+    } while (cursor != 0);
+
+    // Records touched while rebuilding the state are already in db
+    dirty_records.clear();
+    OAILOG_INFO(log_task, "Read %zu state records from db", num_records);
+    return RETURNok;
+  }
+
   // TODO: Make this a unique_ptr
   StateType* state_cache_p;
   std::unique_ptr<cpp_redis::client> db_client;
@@ -199,7 +480,18 @@ class StateManager {
   bool state_dirty;
   // Flag for enabling writing and reading to db.
   bool persist_state_enabled;
+  // Flag for persisting the records of the state separately in a hash stored
+  // under records_table_key, instead of the whole state under table_key.
+  bool persist_records_enabled;
   std::string table_key;
+  std::string records_table_key;
+  std::unordered_set<std::string> dirty_records;
+  // Last global state written to db, used to skip unchanged writes
+  std::string last_global_state;
+  // Window for coalescing writes in the flusher, write-behind is disabled
+  // when this is 0 and every write is committed synchronously.
+  uint32_t write_behind_window_ms;
+  std::unique_ptr<StateFlusher> state_flusher;
   log_proto_t log_task;
 };
 
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2015, EURECOM (www.eurecom.fr)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies,
+ * either expressed or implied, of the FreeBSD Project.
+ */
+
+/*! \file hash_slots.c
+  \brief Open addressing storage shared by the hashtable implementations
+
+  Linear probing with Robin Hood displacement: on insert, a key travelling
+  further from its home slot than the resident of a slot takes that slot and
+  the resident continues probing. This bounds the variance of probe lengths,
+  lets lookups stop as soon as they meet a resident closer to its home than
+  the searched key would be, and allows deletions to shift the following run
+  back by one slot instead of leaving tombstones.
+*/
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash_slots.h"
+
+#define HASH_SLOTS_SEED0 0xa0761d6478bd642full
+#define HASH_SLOTS_SEED1 0xe7037ed1a0b428dbull
+#define HASH_SLOTS_SEED2 0x8ebc6af09c88c6e3ull
+
+//------------------------------------------------------------------------------
+// 64x64->128 bits multiply folded back on 64 bits (wyhash mixing primitive)
+static inline uint64_t hash_slots_mum(uint64_t a, uint64_t b)
+{
+  __uint128_t r = (__uint128_t) a * b;
+  return (uint64_t) r ^ (uint64_t)(r >> 64);
+}
+
+//------------------------------------------------------------------------------
+uint64_t hash_slots_mix(uint64_t key)
+{
+  uint64_t a = key ^ HASH_SLOTS_SEED0;
+  uint64_t b = ((key >> 32) | (key << 32)) ^ HASH_SLOTS_SEED1;
+  return hash_slots_mum(hash_slots_mum(a, b) ^ HASH_SLOTS_SEED2, b);
+}
+
+//------------------------------------------------------------------------------
+uint64_t hash_slots_hash_bytes(const void *key, int key_size)
+{
+  const uint8_t *p = key;
+  uint64_t h = HASH_SLOTS_SEED2 ^ (uint64_t) key_size;
+  uint64_t v = 0;
+
+  while (key_size >= 8) {
+    memcpy(&v, p, 8);
+    h = hash_slots_mum(h ^ v ^ HASH_SLOTS_SEED0, HASH_SLOTS_SEED1);
+    p += 8;
+    key_size -= 8;
+  }
+  if (key_size > 0) {
+    v = 0;
+    memcpy(&v, p, key_size);
+    h = hash_slots_mum(h ^ v ^ HASH_SLOTS_SEED0, HASH_SLOTS_SEED1);
+  }
+  return hash_slots_mix(h);
+}
+
+//------------------------------------------------------------------------------
+hash_size_t hash_slots_round_size(hash_size_t size)
+{
+  hash_size_t rounded = HASH_SLOTS_MIN_SIZE;
+
+  while (rounded < size) {
+    rounded <<= 1;
+  }
+  return rounded;
+}
+
+//------------------------------------------------------------------------------
+bool hash_slots_init(hash_slots_t *slots, hash_size_t size, bool obj_keys)
+{
+  slots->size = hash_slots_round_size(size);
+  slots->num_elements = 0;
+  slots->obj_keys = obj_keys;
+  slots->slots = calloc(slots->size, sizeof(hash_slot_t));
+  if (!slots->slots) {
+    slots->size = 0;
+    return false;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+void hash_slots_release(hash_slots_t *slots)
+{
+  free(slots->slots);
+  slots->slots = NULL;
+  slots->size = 0;
+  slots->num_elements = 0;
+}
+
+//------------------------------------------------------------------------------
+static inline bool hash_slots_key_equals(
+  const hash_slots_t *slots,
+  const hash_slot_t *slot,
+  hash_key_t key,
+  int key_size)
+{
+  if (!slots->obj_keys) {
+    return slot->key == key;
+  }
+  return (slot->key_size == key_size) &&
+         (memcmp(
+            (const void *) (uintptr_t) slot->key,
+            (const void *) (uintptr_t) key,
+            key_size) == 0);
+}
+
+//------------------------------------------------------------------------------
+hash_slot_t *hash_slots_find(
+  const hash_slots_t *slots,
+  uint64_t hash,
+  hash_key_t key,
+  int key_size)
+{
+  const hash_size_t mask = slots->size - 1;
+  const uint32_t hash32 = (uint32_t) hash;
+  hash_size_t index = hash32 & mask;
+  uint16_t dist = 1;
+
+  for (;;) {
+    hash_slot_t *slot = &slots->slots[index];
+    // Empty slot, or a resident closer to its home than the key would be
+    if (slot->dist < dist) {
+      return NULL;
+    }
+    if (
+      (slot->hash == hash32) &&
+      hash_slots_key_equals(slots, slot, key, key_size)) {
+      return slot;
+    }
+    index = (index + 1) & mask;
+    dist++;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Place a slot, the table must have a free slot and no copy of the key
+static hash_slot_t *hash_slots_place(hash_slots_t *slots, hash_slot_t entry)
+{
+  const hash_size_t mask = slots->size - 1;
+  hash_size_t index = entry.hash & mask;
+  hash_slot_t *placed = NULL;
+
+  entry.dist = 1;
+  for (;;) {
+    hash_slot_t *slot = &slots->slots[index];
+    if (!slot->dist) {
+      *slot = entry;
+      slots->num_elements++;
+      return placed ? placed : slot;
+    }
+    if (slot->dist < entry.dist) {
+      hash_slot_t resident = *slot;
+      *slot = entry;
+      entry = resident;
+      if (!placed) {
+        placed = slot;
+      }
+    }
+    index = (index + 1) & mask;
+    entry.dist++;
+  }
+}
+
+//------------------------------------------------------------------------------
+bool hash_slots_resize(hash_slots_t *slots, hash_size_t size)
+{
+  hash_slots_t resized = {0};
+  hash_size_t min_size = (slots->num_elements * 100) /
+                           HASH_SLOTS_MAX_LOAD_PERCENT +
+                         1;
+
+  if (!hash_slots_init(
+        &resized, size > min_size ? size : min_size, slots->obj_keys)) {
+    return false;
+  }
+  HASH_SLOTS_FOREACH(slots, slot)
+  {
+    hash_slots_place(&resized, *slot);
+  }
+  free(slots->slots);
+  *slots = resized;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+hash_slot_t *hash_slots_insert(
+  hash_slots_t *slots,
+  uint64_t hash,
+  hash_key_t key,
+  int key_size)
+{
+  hash_slot_t entry = {0};
+
+  if (
+    (slots->num_elements + 1) * 100 >
+    slots->size * HASH_SLOTS_MAX_LOAD_PERCENT) {
+    if (!hash_slots_resize(slots, slots->size << 1)) {
+      return NULL;
+    }
+  }
+  entry.key = key;
+  entry.hash = (uint32_t) hash;
+  entry.key_size = (uint16_t) key_size;
+  return hash_slots_place(slots, entry);
+}
+
+//------------------------------------------------------------------------------
+void hash_slots_erase(hash_slots_t *slots, hash_slot_t *slot)
+{
+  const hash_size_t mask = slots->size - 1;
+  hash_size_t index = slot - slots->slots;
+
+  // Backward shift the following run, no tombstone is left behind
+  for (;;) {
+    hash_size_t next = (index + 1) & mask;
+    if (slots->slots[next].dist <= 1) {
+      break;
+    }
+    slots->slots[index] = slots->slots[next];
+    slots->slots[index].dist--;
+    index = next;
+  }
+  memset(&slots->slots[index], 0, sizeof(hash_slot_t));
+  slots->num_elements--;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2015, EURECOM (www.eurecom.fr)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * The views and conclusions contained in the software and documentation are those
+ * of the authors and should not be interpreted as representing official policies,
+ * either expressed or implied, of the FreeBSD Project.
+ */
+
+/*! \file hash_slots.h
+  \brief Open addressing storage shared by the hashtable implementations
+*/
+#ifndef FILE_HASH_SLOTS_SEEN
+#define FILE_HASH_SLOTS_SEEN
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "hashtable.h"
+
+// Tables grow once they are more than this percent full
+#define HASH_SLOTS_MAX_LOAD_PERCENT 80
+#define HASH_SLOTS_MIN_SIZE 8
+
+// Locking helpers for the thread safe tables, no-ops for single owner tables
+#define HASH_SLOTS_RDLOCK(tBl)                                                 \
+  do {                                                                         \
+    if (!(tBl)->single_owner)                                                  \
+      pthread_rwlock_rdlock((pthread_rwlock_t *) &(tBl)->lock);                \
+  } while (0)
+#define HASH_SLOTS_WRLOCK(tBl)                                                 \
+  do {                                                                         \
+    if (!(tBl)->single_owner)                                                  \
+      pthread_rwlock_wrlock((pthread_rwlock_t *) &(tBl)->lock);                \
+  } while (0)
+#define HASH_SLOTS_UNLOCK(tBl)                                                 \
+  do {                                                                         \
+    if (!(tBl)->single_owner)                                                  \
+      pthread_rwlock_unlock((pthread_rwlock_t *) &(tBl)->lock);                \
+  } while (0)
+
+// Iterate over the occupied slots of a table
+#define HASH_SLOTS_FOREACH(sLoTs, sLoT)                                        \
+  for (hash_slot_t *sLoT = (sLoTs)->slots;                                     \
+       sLoT != NULL && sLoT < (sLoTs)->slots + (sLoTs)->size;                  \
+       sLoT++)                                                                 \
+    if (sLoT->dist)
+
+uint64_t hash_slots_mix(uint64_t key);
+uint64_t hash_slots_hash_bytes(const void *key, int key_size);
+
+hash_size_t hash_slots_round_size(hash_size_t size);
+bool hash_slots_init(hash_slots_t *slots, hash_size_t size, bool obj_keys);
+void hash_slots_release(hash_slots_t *slots);
+
+/*
+ * Lookup a key, for object tables key is a pointer to the key buffer.
+ * Returns NULL when the key is not in the table.
+ */
+hash_slot_t *hash_slots_find(
+  const hash_slots_t *slots,
+  uint64_t hash,
+  hash_key_t key,
+  int key_size);
+
+/*
+ * Insert a key that is not yet in the table, growing the table if needed.
+ * Returns the slot of the key, its data is left to the caller, or NULL if the
+ * table could not grow.
+ */
+hash_slot_t *hash_slots_insert(
+  hash_slots_t *slots,
+  uint64_t hash,
+  hash_key_t key,
+  int key_size);
+
+// Remove an occupied slot returned by hash_slots_find()
+void hash_slots_erase(hash_slots_t *slots, hash_slot_t *slot);
+
+// Rehash the table into at least size slots
+bool hash_slots_resize(hash_slots_t *slots, hash_size_t size);
+
+#endif /* FILE_HASH_SLOTS_SEEN */
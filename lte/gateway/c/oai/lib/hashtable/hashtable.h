@@ -69,23 +69,40 @@ typedef enum hashtable_return_code_e {
     free(key_array_ptr);                                                       \
   } while(0) /*Free the list of keys of a hash table */
 
-typedef struct hash_node_s {
-  hash_key_t key;
-  void *data;
-  struct hash_node_s *next;
-
-} hash_node_t;
-
-typedef struct hash_node_uint64_s {
+/*
+ * All hashtable flavours share the same open addressing storage: slots are
+ * laid out in one array and collisions are resolved by linear probing with
+ * Robin Hood displacement, so lookups walk consecutive slots instead of
+ * chasing one heap node per element. Keys are scrambled with a mixing hash,
+ * on top of the user provided hash function, so that clustered keys (IMSI64,
+ * TEIDs, S1AP UE ids) do not degrade probing. Tables grow automatically.
+ */
+typedef struct hash_slot_s {
+  // integer key, or pointer to the copy of the key of object tables
   hash_key_t key;
-  uint64_t data;
-  struct hash_node_uint64_s *next;
-} hash_node_uint64_t;
+  union {
+    void *ptr;
+    uint64_t uint64;
+  } data;
+  // low half of the mixed hash, compared before the keys
+  uint32_t hash;
+  // size of the key of object tables
+  uint16_t key_size;
+  // 1 + distance from the home slot of the key, 0 for an empty slot
+  uint16_t dist;
+} hash_slot_t;
 
-typedef struct hash_table_s {
+typedef struct hash_slots_s {
+  hash_slot_t *slots;
+  // number of slots, a power of two
   hash_size_t size;
   hash_size_t num_elements;
-  struct hash_node_s **nodes;
+  // keys are copied buffers compared by content
+  bool obj_keys;
+} hash_slots_t;
+
+typedef struct hash_table_s {
+  hash_slots_t table;
   hash_size_t (*hashfunc)(const hash_key_t);
   void (*freefunc)(void **);
   bstring name;
@@ -93,12 +110,15 @@ typedef struct hash_table_s {
   bool log_enabled;
 } hash_table_t;
 
+/*
+ * Thread safe tables are protected by a readers-writer lock. Tables only
+ * accessed by the ITTI task owning them can elide the lock, see
+ * hashtable_ts_set_single_owner().
+ */
 typedef struct hash_table_ts_s {
-  pthread_mutex_t mutex;
-  hash_size_t size;
-  hash_size_t num_elements;
-  struct hash_node_s **nodes;
-  pthread_mutex_t *lock_nodes;
+  pthread_rwlock_t lock;
+  bool single_owner;
+  hash_slots_t table;
   hash_size_t (*hashfunc)(const hash_key_t);
   void (*freefunc)(void **);
   bstring name;
@@ -106,9 +126,7 @@ typedef struct hash_table_ts_s {
   bool log_enabled;
 } hash_table_ts_t;
 typedef struct hash_table_uint64_s {
-  hash_size_t size;
-  hash_size_t num_elements;
-  struct hash_node_uint64_s **nodes;
+  hash_slots_t table;
   hash_size_t (*hashfunc)(const hash_key_t);
   bstring name;
   bool is_allocated_by_malloc;
@@ -116,11 +134,9 @@ typedef struct hash_table_uint64_s {
 } hash_table_uint64_t;
 
 typedef struct hash_table_uint64_ts_s {
-  pthread_mutex_t mutex;
-  hash_size_t size;
-  hash_size_t num_elements;
-  struct hash_node_uint64_s **nodes;
-  pthread_mutex_t *lock_nodes;
+  pthread_rwlock_t lock;
+  bool single_owner;
+  hash_slots_t table;
   hash_size_t (*hashfunc)(const hash_key_t);
   bstring name;
   bool is_allocated_by_malloc;
@@ -235,6 +251,10 @@ hashtable_rc_t hashtable_ts_get(
 hashtable_rc_t hashtable_ts_resize(
   hash_table_ts_t *const hashtbl,
   const hash_size_t size);
+// Elide locking for a table only accessed by the task owning it
+void hashtable_ts_set_single_owner(
+  hash_table_ts_t *const hashtbl,
+  const bool single_owner);
 hash_table_uint64_ts_t *hashtable_uint64_ts_init(
   hash_table_uint64_ts_t *const hashtbl,
   const hash_size_t size,
@@ -281,5 +301,9 @@ hashtable_rc_t hashtable_uint64_ts_get(
 hashtable_rc_t hashtable_uint64_ts_resize(
   hash_table_uint64_ts_t *const hashtbl,
   const hash_size_t size);
+// Elide locking for a table only accessed by the task owning it
+void hashtable_uint64_ts_set_single_owner(
+  hash_table_uint64_ts_t *const hashtbl,
+  const bool single_owner);
 
 #endif
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2017, EURECOM (www.eurecom.fr)
+ * Copyright (c) 2015, EURECOM (www.eurecom.fr)
  * All rights reserved.
  *
  * Redistribution and use in source and binary forms, with or without
@@ -26,6 +26,7 @@
  * of the authors and should not be interpreted as representing official policies,
  * either expressed or implied, of the FreeBSD Project.
  */
+
 /*! \file hashtable_uint64.c
   \brief
   \author Lionel Gauthier
@@ -43,6 +44,7 @@
 #include "bstrlib.h"
 #include "dynamic_memory_check.h"
 #include "hashtable.h"
+#include "hash_slots.h"
 
 #if TRACE_HASHTABLE
 #define PRINT_HASHTABLE(hTbLe, ...)                                            \
@@ -57,7 +59,7 @@
 /*
    Default hash function
    def_hashfunc() is the default used by hashtable_uint64_create() when the user didn't specify one.
-   This is a simple/naive hash function which adds the key's ASCII char values. It will probably generate lots of collisions on large hash tables.
+   The key is used as is, the slot index is derived from it by hash_slots_mix().
 */
 
 static inline hash_size_t def_hashfunc(const uint64_t keyP)
@@ -65,10 +67,18 @@ static inline hash_size_t def_hashfunc(const uint64_t keyP)
   return (hash_size_t) keyP;
 }
 
+//------------------------------------------------------------------------------
+static inline uint64_t hashtable_uint64_hash(
+  hash_size_t (*hashfuncP)(const hash_key_t),
+  const hash_key_t keyP)
+{
+  return hash_slots_mix(hashfuncP(keyP));
+}
+
 //------------------------------------------------------------------------------
 /*
    Initialization
-   hashtable_uint64_init() set up the initial structure of the hash table. The user specified size will be allocated and initialized to NULL.
+   hashtable_uint64_init() set up the initial structure of the hash table. The user specified size is a hint, the table grows when needed.
    The user can also specify a hash function. If the hashfunc argument is NULL, a default hash function is used.
    If an error occurred, NULL is returned. All other values in the returned hash_table_uint64_t pointer should be released with hashtable_uint64_destroy().
 */
@@ -78,43 +88,21 @@ hash_table_uint64_t *hashtable_uint64_init(
   hash_size_t (*hashfuncP)(const hash_key_t),
   bstring display_name_pP)
 {
-  hash_size_t size = sizeP;
-  // upper power of two: http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2Float
-  //  By Sean Eron Anderson
-  // seander@cs.stanford.edu
-  // Individually, the code snippets here are in the public domain (unless otherwise noted) — feel free to use them however you please.
-  // The aggregate collection and descriptions are © 1997-2005 Sean Eron Anderson. The code and descriptions are distributed in the hope
-  // that they will be useful, but WITHOUT ANY WARRANTY and without even the implied warranty of merchantability or fitness for a particular
-  // purpose. As of May 5, 2005, all the code has been tested thoroughly. Thousands of people have read it. Moreover, Professor Randal Bryant,
-  // the Dean of Computer Science at Carnegie Mellon University, has personally tested almost everything with his Uclid code verification system.
-  // What he hasn't tested, I have checked against all possible inputs on a 32-bit machine. To the first person to inform me of a legitimate bug
-  // in the code, I'll pay a bounty of US$10 (by check or Paypal). If directed to a charity, I'll pay US$20.
-  size--;
-  size |= size >> 1;
-  size |= size >> 2;
-  size |= size >> 4;
-  size |= size >> 8;
-  size |= size >> 16;
-  size++;
-
-  if (!(hashtblP->nodes = calloc(size, sizeof(hash_node_uint64_t *)))) {
-    free_wrapper((void **) &hashtblP);
+  if (!hash_slots_init(&hashtblP->table, sizeP, false)) {
     return NULL;
   }
   hashtblP->log_enabled = true;
 
-  PRINT_HASHTABLE(hashtblP, "allocated nodes\n");
-  hashtblP->size = size;
-
   if (hashfuncP)
     hashtblP->hashfunc = hashfuncP;
   else
     hashtblP->hashfunc = def_hashfunc;
 
   if (display_name_pP) {
-    bassign(hashtblP->name, display_name_pP);
+    hashtblP->name = bstrcpy(display_name_pP);
   } else {
-    hashtblP->name = bformat("hashtable%u@%p", size, hashtblP);
+    hashtblP->name =
+      bformat("hashtable%zu@%p", hashtblP->table.size, hashtblP);
   }
   hashtblP->is_allocated_by_malloc = false;
   return hashtblP;
@@ -123,7 +111,7 @@ hash_table_uint64_t *hashtable_uint64_init(
 //------------------------------------------------------------------------------
 /*
    Initialization
-   hashtable_uint64_create() allocate and sets up the initial structure of the hash table. The user specified size will be allocated and initialized to NULL.
+   hashtable_uint64_create() allocate and sets up the initial structure of the hash table.
    The user can also specify a hash function. If the hashfunc argument is NULL, a default hash function is used.
    If an error occurred, NULL is returned. All other values in the returned hash_table_uint64_t pointer should be released with hashtable_uint64_destroy().
 */
@@ -137,7 +125,10 @@ hash_table_uint64_t *hashtable_uint64_create(
   if (!(hashtbl = calloc(1, sizeof(hash_table_uint64_t)))) {
     return NULL;
   }
-  hashtbl = hashtable_uint64_init(hashtbl, sizeP, hashfuncP, display_name_pP);
+  if (!hashtable_uint64_init(hashtbl, sizeP, hashfuncP, display_name_pP)) {
+    free_wrapper((void **) &hashtbl);
+    return NULL;
+  }
   hashtbl->is_allocated_by_malloc = true;
   return hashtbl;
 }
@@ -145,9 +136,9 @@ hash_table_uint64_t *hashtable_uint64_create(
 //------------------------------------------------------------------------------
 /*
    Initialization
-   hashtable_uint64_ts_init() sets up the initial structure of the thread safe hash table. The user specified size will be allocated and initialized to NULL.
+   hashtable_uint64_ts_init() sets up the initial structure of the thread safe hash table. The user specified size is a hint, the table grows when needed.
    The user can also specify a hash function. If the hashfunc argument is NULL, a default hash function is used.
-   If an error occurred, NULL is returned. All other values in the returned hash_table_uint64_t pointer should be released with hashtable_uint64_destroy().
+   If an error occurred, NULL is returned. All other values in the returned hash_table_uint64_ts_t pointer should be released with hashtable_uint64_ts_destroy().
 */
 hash_table_uint64_ts_t *hashtable_uint64_ts_init(
   hash_table_uint64_ts_t *const hashtblP,
@@ -155,45 +146,13 @@ hash_table_uint64_ts_t *hashtable_uint64_ts_init(
   hash_size_t (*hashfuncP)(const hash_key_t),
   bstring display_name_pP)
 {
-  hash_size_t size = sizeP;
-  // upper power of two: http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2Float
-  //  By Sean Eron Anderson
-  // seander@cs.stanford.edu
-  // Individually, the code snippets here are in the public domain (unless otherwise noted) — feel free to use them however you please.
-  // The aggregate collection and descriptions are © 1997-2005 Sean Eron Anderson. The code and descriptions are distributed in the hope
-  // that they will be useful, but WITHOUT ANY WARRANTY and without even the implied warranty of merchantability or fitness for a particular
-  // purpose. As of May 5, 2005, all the code has been tested thoroughly. Thousands of people have read it. Moreover, Professor Randal Bryant,
-  // the Dean of Computer Science at Carnegie Mellon University, has personally tested almost everything with his Uclid code verification system.
-  // What he hasn't tested, I have checked against all possible inputs on a 32-bit machine. To the first person to inform me of a legitimate bug
-  // in the code, I'll pay a bounty of US$10 (by check or Paypal). If directed to a charity, I'll pay US$20.
-  size--;
-  size |= size >> 1;
-  size |= size >> 2;
-  size |= size >> 4;
-  size |= size >> 8;
-  size |= size >> 16;
-  size++;
-
   memset(hashtblP, 0, sizeof(*hashtblP));
 
-  if (!(hashtblP->nodes = calloc(size, sizeof(hash_node_uint64_t *)))) {
-    free_wrapper((void **) &hashtblP);
+  if (!hash_slots_init(&hashtblP->table, sizeP, false)) {
     return NULL;
   }
-
-  if (!(hashtblP->lock_nodes = calloc(size, sizeof(pthread_mutex_t)))) {
-    free_wrapper((void **) &hashtblP->nodes);
-    free_wrapper((void **) &hashtblP->name);
-    free_wrapper((void **) &hashtblP);
-    return NULL;
-  }
-
-  pthread_mutex_init(&hashtblP->mutex, NULL);
-  for (int i = 0; i < size; i++) {
-    pthread_mutex_init(&hashtblP->lock_nodes[i], NULL);
-  }
-
-  hashtblP->size = size;
+  pthread_rwlock_init(&hashtblP->lock, NULL);
+  hashtblP->single_owner = false;
 
   if (hashfuncP)
     hashtblP->hashfunc = hashfuncP;
@@ -209,12 +168,13 @@ hash_table_uint64_ts_t *hashtable_uint64_ts_init(
   hashtblP->log_enabled = true;
   return hashtblP;
 }
+
 //------------------------------------------------------------------------------
 /*
    Initialization
-   hashtable_uint64_ts_create() allocate and sets up the initial structure of the thread safe hash table. The user specified size will be allocated and initialized to NULL.
+   hashtable_uint64_ts_create() allocate and sets up the initial structure of the thread safe hash table.
    The user can also specify a hash function. If the hashfunc argument is NULL, a default hash function is used.
-   If an error occurred, NULL is returned. All other values in the returned hash_table_uint64_t pointer should be released with hashtable_uint64_destroy().
+   If an error occurred, NULL is returned. All other values in the returned hash_table_uint64_ts_t pointer should be released with hashtable_uint64_ts_destroy().
 */
 hash_table_uint64_ts_t *hashtable_uint64_ts_create(
   const hash_size_t sizeP,
@@ -226,37 +186,41 @@ hash_table_uint64_ts_t *hashtable_uint64_ts_create(
   if (!(hashtbl = calloc(1, sizeof(hash_table_uint64_ts_t)))) {
     return NULL;
   }
-  hashtbl =
-    hashtable_uint64_ts_init(hashtbl, sizeP, hashfuncP, display_name_pP);
+  if (!hashtable_uint64_ts_init(hashtbl, sizeP, hashfuncP, display_name_pP)) {
+    free_wrapper((void **) &hashtbl);
+    return NULL;
+  }
   hashtbl->is_allocated_by_malloc = true;
   return hashtbl;
 }
 
+//------------------------------------------------------------------------------
+/*
+   Lock elision
+   A table that is only accessed from the ITTI task owning it does not need
+   to take its lock. Must be set before the table is shared, if ever.
+*/
+void hashtable_uint64_ts_set_single_owner(
+  hash_table_uint64_ts_t *const hashtblP,
+  const bool single_owner)
+{
+  if (hashtblP) {
+    hashtblP->single_owner = single_owner;
+  }
+}
+
 //------------------------------------------------------------------------------
 /*
    Cleanup
-   The hashtable_uint64_destroy() walks through the linked lists for each possible hash value, and releases the elements. It also releases the nodes array and the hash_table_uint64_t.
+   The hashtable_uint64_destroy() releases the slots array and the hash_table_uint64_t.
 */
 hashtable_rc_t hashtable_uint64_destroy(hash_table_uint64_t *hashtblP)
 {
-  hash_size_t n = 0;
-  hash_node_uint64_t *node = NULL, *oldnode = NULL;
-
   if (!hashtblP) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  for (n = 0; n < hashtblP->size; ++n) {
-    node = hashtblP->nodes[n];
-
-    while (node) {
-      oldnode = node;
-      node = node->next;
-      free_wrapper((void **) &oldnode);
-    }
-  }
-
-  free_wrapper((void **) &hashtblP->nodes);
+  hash_slots_release(&hashtblP->table);
   bdestroy_wrapper(&hashtblP->name);
   if (hashtblP->is_allocated_by_malloc) {
     free_wrapper((void **) &hashtblP);
@@ -265,36 +229,18 @@ hashtable_rc_t hashtable_uint64_destroy(hash_table_uint64_t *hashtblP)
 }
 
 //------------------------------------------------------------------------------
-/*
-   Cleanup
-   The hashtable_uint64_destroy() walks through the linked lists for each possible hash value, and releases the elements. It also releases the nodes array and the hash_table_uint64_t.
-*/
 hashtable_rc_t hashtable_uint64_ts_destroy(hash_table_uint64_ts_t *hashtblP)
 {
-  hash_size_t n = 0;
-  hash_node_uint64_t *node = NULL, *oldnode = NULL;
-
   if (!hashtblP) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  for (n = 0; n < hashtblP->size; ++n) {
-    pthread_mutex_lock(&hashtblP->lock_nodes[n]);
-    node = hashtblP->nodes[n];
+  HASH_SLOTS_WRLOCK(hashtblP);
+  hash_slots_release(&hashtblP->table);
+  HASH_SLOTS_UNLOCK(hashtblP);
+  pthread_rwlock_destroy(&hashtblP->lock);
 
-    while (node) {
-      oldnode = node;
-      node = node->next;
-      free_wrapper((void **) &oldnode);
-    }
-
-    pthread_mutex_unlock(&hashtblP->lock_nodes[n]);
-    pthread_mutex_destroy(&hashtblP->lock_nodes[n]);
-  }
-
-  free_wrapper((void **) &hashtblP->nodes);
   bdestroy_wrapper(&hashtblP->name);
-  free_wrapper((void **) &hashtblP->lock_nodes);
   if (hashtblP->is_allocated_by_malloc) {
     free_wrapper((void **) &hashtblP);
   }
@@ -306,28 +252,22 @@ hashtable_rc_t hashtable_uint64_is_key_exists(
   const hash_table_uint64_t *const hashtblP,
   const hash_key_t keyP)
 {
-  hash_node_uint64_t *node = NULL;
-  hash_size_t hash = 0;
-
   if (!hashtblP) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  hash = hashtblP->hashfunc(keyP) % hashtblP->size;
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key 0x%" PRIx64 ") return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP);
-      return HASH_TABLE_OK;
-    }
-
-    node = node->next;
+  if (hash_slots_find(
+        &hashtblP->table,
+        hashtable_uint64_hash(hashtblP->hashfunc, keyP),
+        keyP,
+        0)) {
+    PRINT_HASHTABLE(
+      hashtblP,
+      "%s(%s,key 0x%" PRIx64 ") return OK\n",
+      __FUNCTION__,
+      bdata(hashtblP->name),
+      keyP);
+    return HASH_TABLE_OK;
   }
   PRINT_HASHTABLE(
     hashtblP,
@@ -343,32 +283,26 @@ hashtable_rc_t hashtable_uint64_ts_is_key_exists(
   const hash_table_uint64_ts_t *const hashtblP,
   const hash_key_t keyP)
 {
-  hash_node_uint64_t *node = NULL;
-  hash_size_t hash = 0;
+  hash_slot_t *slot = NULL;
 
   if (!hashtblP) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  hash = hashtblP->hashfunc(keyP) % hashtblP->size;
-  pthread_mutex_lock(&hashtblP->lock_nodes[hash]);
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key 0x%" PRIx64 ") return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP);
-      return HASH_TABLE_OK;
-    }
+  const uint64_t hash = hashtable_uint64_hash(hashtblP->hashfunc, keyP);
+  HASH_SLOTS_RDLOCK(hashtblP);
+  slot = hash_slots_find(&hashtblP->table, hash, keyP, 0);
+  HASH_SLOTS_UNLOCK(hashtblP);
 
-    node = node->next;
+  if (slot) {
+    PRINT_HASHTABLE(
+      hashtblP,
+      "%s(%s,key 0x%" PRIx64 ") return OK\n",
+      __FUNCTION__,
+      bdata(hashtblP->name),
+      keyP);
+    return HASH_TABLE_OK;
   }
-  pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
   PRINT_HASHTABLE(
     hashtblP,
     "%s(%s,key 0x%" PRIx64 ") return KEY_NOT_EXISTS\n",
@@ -389,29 +323,16 @@ hashtable_rc_t hashtable_uint64_apply_callback_on_elements(
   void *parameterP,
   void **resultP)
 {
-  hash_node_uint64_t *node = NULL;
-  unsigned int i = 0;
-  unsigned int num_elements = 0;
-
   if (!hashtblP) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  while ((num_elements < hashtblP->num_elements) && (i < hashtblP->size)) {
-    if (hashtblP->nodes[i] != NULL) {
-      node = hashtblP->nodes[i];
-
-      while (node) {
-        num_elements++;
-        if (funct_cb(node->key, node->data, parameterP, resultP)) {
-          return HASH_TABLE_OK;
-        }
-        node = node->next;
-      }
+  HASH_SLOTS_FOREACH(&hashtblP->table, slot)
+  {
+    if (funct_cb(slot->key, slot->data.uint64, parameterP, resultP)) {
+      return HASH_TABLE_OK;
     }
-    i++;
   }
-
   return HASH_TABLE_OK;
 }
 
@@ -420,28 +341,32 @@ hashtable_rc_t hashtable_uint64_apply_callback_on_elements(
 hashtable_key_array_t *hashtable_uint64_ts_get_keys(
   hash_table_uint64_ts_t *const hashtblP)
 {
-  hash_node_uint64_t *node = NULL;
-  unsigned int i = 0;
   hashtable_key_array_t *ka = NULL;
 
-  if ((!hashtblP) || !(hashtblP->num_elements)) {
+  if (!hashtblP) {
+    return NULL;
+  }
+  HASH_SLOTS_RDLOCK(hashtblP);
+  if (hashtblP->table.num_elements == 0) {
+    HASH_SLOTS_UNLOCK(hashtblP);
     return NULL;
   }
   ka = calloc(1, sizeof(hashtable_key_array_t));
-  ka->keys = calloc(hashtblP->num_elements, sizeof(hash_key_t *));
-
-  while ((ka->num_keys < hashtblP->num_elements) && (i < hashtblP->size)) {
-    pthread_mutex_lock(&hashtblP->lock_nodes[i]);
-    if (hashtblP->nodes[i] != NULL) {
-      node = hashtblP->nodes[i];
-      while (node) {
-        ka->keys[ka->num_keys++] = node->key;
-        node = node->next;
-      }
-    }
-    pthread_mutex_unlock(&hashtblP->lock_nodes[i]);
-    i++;
+  if (ka == NULL) {
+    HASH_SLOTS_UNLOCK(hashtblP);
+    return NULL;
+  }
+  ka->keys = calloc(hashtblP->table.num_elements, sizeof(hash_key_t));
+  if (ka->keys == NULL) {
+    HASH_SLOTS_UNLOCK(hashtblP);
+    free(ka);
+    return NULL;
   }
+  HASH_SLOTS_FOREACH(&hashtblP->table, slot)
+  {
+    ka->keys[ka->num_keys++] = slot->key;
+  }
+  HASH_SLOTS_UNLOCK(hashtblP);
   return ka;
 }
 
@@ -450,36 +375,43 @@ hashtable_key_array_t *hashtable_uint64_ts_get_keys(
 hashtable_uint64_element_array_t *hashtable_uint64_ts_get_elements(
   hash_table_uint64_ts_t *const hashtblP)
 {
-  hash_node_uint64_t *node = NULL;
-  unsigned int i = 0;
   hashtable_uint64_element_array_t *ea = NULL;
 
-  if ((!hashtblP) || !(hashtblP->num_elements)) {
+  if (!hashtblP) {
+    return NULL;
+  }
+  HASH_SLOTS_RDLOCK(hashtblP);
+  if (hashtblP->table.num_elements == 0) {
+    HASH_SLOTS_UNLOCK(hashtblP);
     return NULL;
   }
-
   ea = calloc(1, sizeof(hashtable_uint64_element_array_t));
-  ea->elements = calloc(hashtblP->num_elements, sizeof(uint64_t *));
-
-  while ((ea->num_elements < hashtblP->num_elements) && (i < hashtblP->size)) {
-    pthread_mutex_lock(&hashtblP->lock_nodes[i]);
-    if (hashtblP->nodes[i] != NULL) {
-      node = hashtblP->nodes[i];
-      while (node) {
-        ea->elements[ea->num_elements++] = node->data;
-        node = node->next;
-      }
-    }
-    pthread_mutex_unlock(&hashtblP->lock_nodes[i]);
-    i++;
+  if (ea == NULL) {
+    HASH_SLOTS_UNLOCK(hashtblP);
+    return NULL;
   }
+  ea->elements = calloc(hashtblP->table.num_elements, sizeof(uint64_t));
+  if (ea->elements == NULL) {
+    HASH_SLOTS_UNLOCK(hashtblP);
+    free(ea);
+    return NULL;
+  }
+  HASH_SLOTS_FOREACH(&hashtblP->table, slot)
+  {
+    ea->elements[ea->num_elements++] = slot->data.uint64;
+  }
+  HASH_SLOTS_UNLOCK(hashtblP);
   return ea;
 }
 
 //------------------------------------------------------------------------------
 // may cost a lot CPU...
-// Also useful if we want to find an element in the collection based on compare criteria different than the single key
-// The compare criteria in implemented in the funct_cb function
+// Also useful if we want to find an element in the collection based on compare
+// criteria different than the single key The compare criteria in implemented
+// in the funct_cb function
+// funct_cb runs on a copy of the slots taken under the read lock, so that it
+// may insert in or remove from the table. Elements inserted or removed by
+// other threads meanwhile may be visited or not.
 hashtable_rc_t hashtable_uint64_ts_apply_callback_on_elements(
   hash_table_uint64_ts_t *const hashtblP,
   bool funct_cb(
@@ -490,32 +422,37 @@ hashtable_rc_t hashtable_uint64_ts_apply_callback_on_elements(
   void *parameterP,
   void **resultP)
 {
-  hash_node_uint64_t *node = NULL;
-  unsigned int i = 0;
-  unsigned int num_elements = 0;
+  hash_slot_t *slots;
+  hash_size_t num_elements;
 
   if (!hashtblP) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  while ((num_elements < hashtblP->num_elements) && (i < hashtblP->size)) {
-    pthread_mutex_lock(&hashtblP->lock_nodes[i]);
-    if (hashtblP->nodes[i] != NULL) {
-      node = hashtblP->nodes[i];
-
-      while (node) {
-        num_elements++;
-        if (funct_cb(node->key, node->data, parameterP, resultP)) {
-          pthread_mutex_unlock(&hashtblP->lock_nodes[i]);
-          return HASH_TABLE_OK;
-        }
-        node = node->next;
-      }
-    }
-    pthread_mutex_unlock(&hashtblP->lock_nodes[i]);
-    i++;
+  HASH_SLOTS_RDLOCK(hashtblP);
+  num_elements = hashtblP->table.num_elements;
+  if (num_elements == 0) {
+    HASH_SLOTS_UNLOCK(hashtblP);
+    return HASH_TABLE_OK;
+  }
+  slots = malloc(num_elements * sizeof(hash_slot_t));
+  if (slots == NULL) {
+    HASH_SLOTS_UNLOCK(hashtblP);
+    return HASH_TABLE_SYSTEM_ERROR;
+  }
+  num_elements = 0;
+  HASH_SLOTS_FOREACH(&hashtblP->table, slot)
+  {
+    slots[num_elements++] = *slot;
   }
+  HASH_SLOTS_UNLOCK(hashtblP);
 
+  for (hash_size_t i = 0; i < num_elements; i++) {
+    if (funct_cb(slots[i].key, slots[i].data.uint64, parameterP, resultP)) {
+      break;
+    }
+  }
+  free(slots);
   return HASH_TABLE_OK;
 }
 
@@ -524,34 +461,24 @@ hashtable_rc_t hashtable_uint64_dump_content(
   const hash_table_uint64_t *const hashtblP,
   bstring str)
 {
-  hash_node_uint64_t *node = NULL;
-  unsigned int i = 0;
-
   if (!hashtblP) {
     bcatcstr(str, "HASH_TABLE_BAD_PARAMETER_HASHTABLE");
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  while (i < hashtblP->size) {
-    if (hashtblP->nodes[i] != NULL) {
-      node = hashtblP->nodes[i];
-
-      while (node) {
-        bstring b0 = bformat(
-          "Key 0x%" PRIx64 " Element %" PRIx64 " Node %p\n",
-          node->key,
-          node->data,
-          node);
-        if (!b0) {
-          PRINT_HASHTABLE(hashtblP, "Error while dumping hashtable content");
-        } else {
-          bconcat(str, b0);
-          bdestroy_wrapper(&b0);
-        }
-        node = node->next;
-      }
+  HASH_SLOTS_FOREACH(&hashtblP->table, slot)
+  {
+    bstring b0 = bformat(
+      "Key 0x%" PRIx64 " Element %" PRIx64 " Slot %zu\n",
+      slot->key,
+      slot->data.uint64,
+      (size_t)(slot - hashtblP->table.slots));
+    if (!b0) {
+      PRINT_HASHTABLE(hashtblP, "Error while dumping hashtable content");
+    } else {
+      bconcat(str, b0);
+      bdestroy_wrapper(&b0);
     }
-    i += 1;
   }
   return HASH_TABLE_OK;
 }
@@ -561,431 +488,226 @@ hashtable_rc_t hashtable_uint64_ts_dump_content(
   const hash_table_uint64_ts_t *const hashtblP,
   bstring str)
 {
-  hash_node_uint64_t *node = NULL;
-  unsigned int i = 0;
-
   if (!hashtblP) {
     bcatcstr(str, "HASH_TABLE_BAD_PARAMETER_HASHTABLE");
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  while (i < hashtblP->size) {
-    if (hashtblP->nodes[i] != NULL) {
-      pthread_mutex_lock(&hashtblP->lock_nodes[i]);
-      node = hashtblP->nodes[i];
-
-      while (node) {
-        bstring b0 = bformat(
-          "Key 0x%" PRIx64 " Element %" PRIx64 " Node %p Next %p\n",
-          node->key,
-          node->data,
-          node,
-          node->next);
-        if (!b0) {
-          PRINT_HASHTABLE(hashtblP, "Error while dumping hashtable content");
-        } else {
-          bconcat(str, b0);
-          bdestroy_wrapper(&b0);
-        }
-        node = node->next;
-      }
-      pthread_mutex_unlock(&hashtblP->lock_nodes[i]);
+  HASH_SLOTS_RDLOCK(hashtblP);
+  HASH_SLOTS_FOREACH(&hashtblP->table, slot)
+  {
+    bstring b0 = bformat(
+      "Key 0x%" PRIx64 " Element %" PRIx64 " Slot %zu Probe %u\n",
+      slot->key,
+      slot->data.uint64,
+      (size_t)(slot - hashtblP->table.slots),
+      slot->dist - 1);
+    if (!b0) {
+      PRINT_HASHTABLE(hashtblP, "Error while dumping hashtable content");
+    } else {
+      bconcat(str, b0);
+      bdestroy_wrapper(&b0);
     }
-    i += 1;
   }
+  HASH_SLOTS_UNLOCK(hashtblP);
   return HASH_TABLE_OK;
 }
 
 //------------------------------------------------------------------------------
 /*
-   Adding a new element
-   To make sure the hash value is not bigger than size, the result of the user provided hash function is used modulo size.
+   Adding a new element, or replacing the value of an existing key
 */
-hashtable_rc_t hashtable_uint64_insert(
-  hash_table_uint64_t *const hashtblP,
+static hashtable_rc_t hashtable_uint64_insert_slot(
+  hash_slots_t *const table,
+  const uint64_t hash,
   const hash_key_t keyP,
   const uint64_t dataP)
 {
-  hash_node_uint64_t *node = NULL;
-  hash_size_t hash = 0;
+  hash_slot_t *slot = hash_slots_find(table, hash, keyP, 0);
 
-  if (!hashtblP) {
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-
-  hash = hashtblP->hashfunc(keyP) % hashtblP->size;
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      if (node->data != dataP) {
-        node->data = dataP;
-        PRINT_HASHTABLE(
-          hashtblP,
-          "%s(%s,key 0x%" PRIx64 " data %" PRIx64
-          ") return INSERT_OVERWRITTEN_DATA\n",
-          __FUNCTION__,
-          bdata(hashtblP->name),
-          keyP,
-          dataP);
-        return HASH_TABLE_INSERT_OVERWRITTEN_DATA;
-      }
-      node->data = dataP;
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key 0x%" PRIx64 " data %" PRIx64 ") return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        dataP);
-      return HASH_TABLE_OK;
+  if (slot) {
+    if (slot->data.uint64 != dataP) {
+      slot->data.uint64 = dataP;
+      return HASH_TABLE_INSERT_OVERWRITTEN_DATA;
     }
-
-    node = node->next;
+    return HASH_TABLE_OK;
   }
+  if (!(slot = hash_slots_insert(table, hash, keyP, 0))) {
+    return HASH_TABLE_SYSTEM_ERROR;
+  }
+  slot->data.uint64 = dataP;
+  return HASH_TABLE_OK;
+}
 
-  if (!(node = malloc(sizeof(hash_node_uint64_t)))) return -1;
-
-  node->key = keyP;
-  node->data = dataP;
+//------------------------------------------------------------------------------
+hashtable_rc_t hashtable_uint64_insert(
+  hash_table_uint64_t *const hashtblP,
+  const hash_key_t keyP,
+  const uint64_t dataP)
+{
+  hashtable_rc_t rc = HASH_TABLE_OK;
 
-  if (hashtblP->nodes[hash]) {
-    node->next = hashtblP->nodes[hash];
-  } else {
-    node->next = NULL;
+  if (!hashtblP) {
+    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  hashtblP->nodes[hash] = node;
-  hashtblP->num_elements += 1;
-
+  rc = hashtable_uint64_insert_slot(
+    &hashtblP->table,
+    hashtable_uint64_hash(hashtblP->hashfunc, keyP),
+    keyP,
+    dataP);
   PRINT_HASHTABLE(
     hashtblP,
-    "%s(%s,key 0x%" PRIx64 " data %" PRIx64 ") return OK\n",
+    "%s(%s,key 0x%" PRIx64 " data %" PRIx64 ") return %s\n",
     __FUNCTION__,
     bdata(hashtblP->name),
     keyP,
-    dataP);
-  return HASH_TABLE_OK;
+    dataP,
+    hashtable_rc_code2string(rc));
+  return rc;
 }
 
 //------------------------------------------------------------------------------
-/*
-   Adding a new element
-   To make sure the hash value is not bigger than size, the result of the user provided hash function is used modulo size.
-*/
 hashtable_rc_t hashtable_uint64_ts_insert(
   hash_table_uint64_ts_t *const hashtblP,
   const hash_key_t keyP,
   const uint64_t dataP)
 {
-  hash_node_uint64_t *node = NULL;
-  hash_size_t hash = 0;
+  hashtable_rc_t rc = HASH_TABLE_OK;
 
   if (!hashtblP) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  hash = hashtblP->hashfunc(keyP) % hashtblP->size;
-  pthread_mutex_lock(&hashtblP->lock_nodes[hash]);
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      if (node->data != dataP) {
-        node->data = dataP;
-        pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-        PRINT_HASHTABLE(
-          hashtblP,
-          "%s(%s,key 0x%" PRIx64 " data %" PRIx64
-          ") return INSERT_OVERWRITTEN_DATA\n",
-          __FUNCTION__,
-          bdata(hashtblP->name),
-          keyP,
-          dataP);
-        return HASH_TABLE_INSERT_OVERWRITTEN_DATA;
-      }
-      node->data = dataP;
-      pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key 0x%" PRIx64 " data %" PRIx64 ") return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        dataP);
-      return HASH_TABLE_OK;
-    }
-
-    node = node->next;
-  }
-
-  if (!(node = malloc(sizeof(hash_node_uint64_t)))) return -1;
-
-  node->key = keyP;
-  node->data = dataP;
-
-  if (hashtblP->nodes[hash]) {
-    node->next = hashtblP->nodes[hash];
-  } else {
-    node->next = NULL;
-  }
-
-  hashtblP->nodes[hash] = node;
-  __sync_fetch_and_add(&hashtblP->num_elements, 1);
-  pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
+  const uint64_t hash = hashtable_uint64_hash(hashtblP->hashfunc, keyP);
+  HASH_SLOTS_WRLOCK(hashtblP);
+  rc = hashtable_uint64_insert_slot(&hashtblP->table, hash, keyP, dataP);
+  HASH_SLOTS_UNLOCK(hashtblP);
   PRINT_HASHTABLE(
     hashtblP,
-    "%s(%s,key 0x%" PRIx64 " data %p) next %p return OK\n",
+    "%s(%s,key 0x%" PRIx64 " data %" PRIx64 ") return %s\n",
     __FUNCTION__,
     bdata(hashtblP->name),
     keyP,
     dataP,
-    node->next);
-  return HASH_TABLE_OK;
+    hashtable_rc_code2string(rc));
+  return rc;
 }
 
 //------------------------------------------------------------------------------
 /*
-   To free_wrapper an element from the hash table, we just search for it in the linked list for that hash value,
-   and free_wrapper it if it is found. If it was not found, it is an error and -1 is returned.
+   To remove an element from the hash table, we just search for it in the
+   slots, and remove it if it is found. Values are stored in the slots, there
+   is nothing else to free. If it was not found, HASH_TABLE_KEY_NOT_EXISTS is
+   returned.
 */
+static hashtable_rc_t hashtable_uint64_remove_slot(
+  hash_slots_t *const table,
+  const uint64_t hash,
+  const hash_key_t keyP)
+{
+  hash_slot_t *slot = hash_slots_find(table, hash, keyP, 0);
+
+  if (!slot) {
+    return HASH_TABLE_KEY_NOT_EXISTS;
+  }
+  hash_slots_erase(table, slot);
+  return HASH_TABLE_OK;
+}
+
+//------------------------------------------------------------------------------
 hashtable_rc_t hashtable_uint64_free(
   hash_table_uint64_t *const hashtblP,
   const hash_key_t keyP)
 {
-  hash_node_uint64_t *node, *prevnode = NULL;
-  hash_size_t hash = 0;
+  hashtable_rc_t rc = HASH_TABLE_OK;
 
   if (!hashtblP) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  hash = hashtblP->hashfunc(keyP) % hashtblP->size;
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      if (prevnode)
-        prevnode->next = node->next;
-      else
-        hashtblP->nodes[hash] = node->next;
-
-      free_wrapper((void **) &node);
-      __sync_fetch_and_sub(&hashtblP->num_elements, 1);
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key 0x%" PRIx64 ") return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP);
-      return HASH_TABLE_OK;
-    }
-
-    prevnode = node;
-    node = node->next;
-  }
-
+  rc = hashtable_uint64_remove_slot(
+    &hashtblP->table, hashtable_uint64_hash(hashtblP->hashfunc, keyP), keyP);
   PRINT_HASHTABLE(
     hashtblP,
-    "%s(%s,key 0x%" PRIx64 ") return KEY_NOT_EXISTS\n",
+    "%s(%s,key 0x%" PRIx64 ") return %s\n",
     __FUNCTION__,
     bdata(hashtblP->name),
-    keyP);
-  return HASH_TABLE_KEY_NOT_EXISTS;
+    keyP,
+    hashtable_rc_code2string(rc));
+  return rc;
 }
 
 //------------------------------------------------------------------------------
-/*
-   To free_wrapper an element from the hash table, we just search for it in the linked list for that hash value,
-   and free_wrapper it if it is found. If it was not found, it is an error and -1 is returned.
-*/
 hashtable_rc_t hashtable_uint64_ts_free(
   hash_table_uint64_ts_t *const hashtblP,
   const hash_key_t keyP)
 {
-  hash_node_uint64_t *node, *prevnode = NULL;
-  hash_size_t hash = 0;
-
-  if (!hashtblP) {
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-
-  hash = hashtblP->hashfunc(keyP) % hashtblP->size;
-  pthread_mutex_lock(&hashtblP->lock_nodes[hash]);
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      if (prevnode)
-        prevnode->next = node->next;
-      else
-        hashtblP->nodes[hash] = node->next;
-
-      free_wrapper((void **) &node);
-      __sync_fetch_and_sub(&hashtblP->num_elements, 1);
-      pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key 0x%" PRIx64 ") return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP);
-      return HASH_TABLE_OK;
-    }
-
-    prevnode = node;
-    node = node->next;
-  }
-
-  pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-  PRINT_HASHTABLE(
-    hashtblP,
-    "%s(%s,key 0x%" PRIx64 ") return KEY_NOT_EXISTS\n",
-    __FUNCTION__,
-    bdata(hashtblP->name),
-    keyP);
-  return HASH_TABLE_KEY_NOT_EXISTS;
+  return hashtable_uint64_ts_remove(hashtblP, keyP);
 }
 
 //------------------------------------------------------------------------------
-/*
-   To remove an element from the hash table, we just search for it in the linked list for that hash value,
-   and remove it if it is found. If it was not found, it is an error and -1 is returned.
-*/
 hashtable_rc_t hashtable_uint64_remove(
   hash_table_uint64_t *const hashtblP,
   const hash_key_t keyP)
 {
-  hash_node_uint64_t *node, *prevnode = NULL;
-  hash_size_t hash = 0;
-
-  if (!hashtblP) {
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-
-  hash = hashtblP->hashfunc(keyP) % hashtblP->size;
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      if (prevnode)
-        prevnode->next = node->next;
-      else
-        hashtblP->nodes[hash] = node->next;
-
-      free_wrapper((void **) &node);
-      __sync_fetch_and_sub(&hashtblP->num_elements, 1);
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key 0x%" PRIx64 ") return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP);
-      return HASH_TABLE_OK;
-    }
-
-    prevnode = node;
-    node = node->next;
-  }
-
-  PRINT_HASHTABLE(
-    hashtblP,
-    "%s(%s,key 0x%" PRIx64 ") return KEY_NOT_EXISTS\n",
-    __FUNCTION__,
-    bdata(hashtblP->name),
-    keyP);
-  return HASH_TABLE_KEY_NOT_EXISTS;
+  return hashtable_uint64_free(hashtblP, keyP);
 }
 
 //------------------------------------------------------------------------------
-/*
-   To remove an element from the hash table, we just search for it in the linked list for that hash value,
-   and remove it if it is found. If it was not found, it is an error and -1 is returned.
-*/
 hashtable_rc_t hashtable_uint64_ts_remove(
   hash_table_uint64_ts_t *const hashtblP,
   const hash_key_t keyP)
 {
-  hash_node_uint64_t *node, *prevnode = NULL;
-  hash_size_t hash = 0;
+  hashtable_rc_t rc = HASH_TABLE_OK;
 
   if (!hashtblP) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  hash = hashtblP->hashfunc(keyP) % hashtblP->size;
-  pthread_mutex_lock(&hashtblP->lock_nodes[hash]);
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      if (prevnode)
-        prevnode->next = node->next;
-      else
-        hashtblP->nodes[hash] = node->next;
-
-      free_wrapper((void **) &node);
-      __sync_fetch_and_sub(&hashtblP->num_elements, 1);
-      pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key 0x%" PRIx64 ") return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP);
-      return HASH_TABLE_OK;
-    }
-
-    prevnode = node;
-    node = node->next;
-  }
-  pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-
+  const uint64_t hash = hashtable_uint64_hash(hashtblP->hashfunc, keyP);
+  HASH_SLOTS_WRLOCK(hashtblP);
+  rc = hashtable_uint64_remove_slot(&hashtblP->table, hash, keyP);
+  HASH_SLOTS_UNLOCK(hashtblP);
   PRINT_HASHTABLE(
     hashtblP,
-    "%s(%s,key 0x%" PRIx64 ") return KEY_NOT_EXISTS\n",
+    "%s(%s,key 0x%" PRIx64 ") return %s\n",
     __FUNCTION__,
     bdata(hashtblP->name),
-    keyP);
-  return HASH_TABLE_KEY_NOT_EXISTS;
+    keyP,
+    hashtable_rc_code2string(rc));
+  return rc;
 }
 
 //------------------------------------------------------------------------------
 /*
-   Searching for an element is easy. We just search through the linked list for the corresponding hash value.
-   NULL is returned if we didn't find it.
+   Searching for an element is easy. We just probe the slots from the home slot of the key.
+   dataP is left untouched if we didn't find it.
 */
 hashtable_rc_t hashtable_uint64_get(
   const hash_table_uint64_t *const hashtblP,
   const hash_key_t keyP,
   uint64_t *const dataP)
 {
-  hash_node_uint64_t *node = NULL;
-  hash_size_t hash = 0;
+  hash_slot_t *slot = NULL;
 
   if (!hashtblP) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  hash = hashtblP->hashfunc(keyP) % hashtblP->size;
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      *dataP = node->data;
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key 0x%" PRIx64 " data %p) return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        *dataP);
-      return HASH_TABLE_OK;
-    }
-
-    node = node->next;
+  slot = hash_slots_find(
+    &hashtblP->table, hashtable_uint64_hash(hashtblP->hashfunc, keyP), keyP, 0);
+  if (slot) {
+    *dataP = slot->data.uint64;
+    PRINT_HASHTABLE(
+      hashtblP,
+      "%s(%s,key 0x%" PRIx64 " data %" PRIx64 ") return OK\n",
+      __FUNCTION__,
+      bdata(hashtblP->name),
+      keyP,
+      *dataP);
+    return HASH_TABLE_OK;
   }
-
   PRINT_HASHTABLE(
     hashtblP,
     "%s(%s,key 0x%" PRIx64 ") return KEY_NOT_EXISTS\n",
@@ -996,44 +718,35 @@ hashtable_rc_t hashtable_uint64_get(
 }
 
 //------------------------------------------------------------------------------
-/*
-   Searching for an element is easy. We just search through the linked list for the corresponding hash value.
-   NULL is returned if we didn't find it.
-*/
 hashtable_rc_t hashtable_uint64_ts_get(
   const hash_table_uint64_ts_t *const hashtblP,
   const hash_key_t keyP,
   uint64_t *const dataP)
 {
-  hash_node_uint64_t *node = NULL;
-  hash_size_t hash = 0;
+  hash_slot_t *slot = NULL;
 
   if (!hashtblP) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  hash = hashtblP->hashfunc(keyP) % hashtblP->size;
-
-  pthread_mutex_lock(&hashtblP->lock_nodes[hash]);
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      *dataP = node->data;
-      pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key 0x%" PRIx64 " data %p) return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        *dataP);
-      return HASH_TABLE_OK;
-    }
+  const uint64_t hash = hashtable_uint64_hash(hashtblP->hashfunc, keyP);
+  HASH_SLOTS_RDLOCK(hashtblP);
+  slot = hash_slots_find(&hashtblP->table, hash, keyP, 0);
+  if (slot) {
+    *dataP = slot->data.uint64;
+  }
+  HASH_SLOTS_UNLOCK(hashtblP);
 
-    node = node->next;
+  if (slot) {
+    PRINT_HASHTABLE(
+      hashtblP,
+      "%s(%s,key 0x%" PRIx64 " data %" PRIx64 ") return OK\n",
+      __FUNCTION__,
+      bdata(hashtblP->name),
+      keyP,
+      *dataP);
+    return HASH_TABLE_OK;
   }
-  pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
   PRINT_HASHTABLE(
     hashtblP,
     "%s(%s,key 0x%" PRIx64 ") return KEY_NOT_EXISTS\n",
@@ -1046,135 +759,35 @@ hashtable_rc_t hashtable_uint64_ts_get(
 //------------------------------------------------------------------------------
 /*
    Resizing
-   The number of elements in a hash table is not always known when creating the table.
-   If the number of elements grows too large, it will seriously reduce the performance of most hash table operations.
-   If the number of elements are reduced, the hash table will waste memory. That is why we provide a function for resizing the table.
-   Resizing a hash table is not as easy as a realloc(). All hash values must be recalculated and each element must be inserted into its new position.
-   We create a temporary hash_table_uint64_t object (newtbl) to be used while building the new hashes.
-   This allows us to reuse hashtable_uint64_insert() and hashtable_uint64_free(), when moving the elements to the new table.
-   After that, we can just free_wrapper the old table and copy the elements from newtbl to hashtbl.
+   Tables grow automatically when their load factor gets too high, resizing is
+   only useful to reserve room ahead of a known number of insertions, or to
+   give back memory after a lot of removals.
 */
-
 hashtable_rc_t hashtable_uint64_resize(
   hash_table_uint64_t *const hashtblP,
   const hash_size_t sizeP)
 {
-  hash_table_uint64_t newtbl;
-  hash_size_t n;
-  hash_node_uint64_t *node, *next;
-
   if (!hashtblP) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
-  hash_size_t size = sizeP;
-  // upper power of two: http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2Float
-  //  By Sean Eron Anderson
-  // seander@cs.stanford.edu
-  // Individually, the code snippets here are in the public domain (unless otherwise noted) — feel free to use them however you please.
-  // The aggregate collection and descriptions are © 1997-2005 Sean Eron Anderson. The code and descriptions are distributed in the hope
-  // that they will be useful, but WITHOUT ANY WARRANTY and without even the implied warranty of merchantability or fitness for a particular
-  // purpose. As of May 5, 2005, all the code has been tested thoroughly. Thousands of people have read it. Moreover, Professor Randal Bryant,
-  // the Dean of Computer Science at Carnegie Mellon University, has personally tested almost everything with his Uclid code verification system.
-  // What he hasn't tested, I have checked against all possible inputs on a 32-bit machine. To the first person to inform me of a legitimate bug
-  // in the code, I'll pay a bounty of US$10 (by check or Paypal). If directed to a charity, I'll pay US$20.
-  size--;
-  size |= size >> 1;
-  size |= size >> 2;
-  size |= size >> 4;
-  size |= size >> 8;
-  size |= size >> 16;
-  size++;
-
-  newtbl.size = size;
-  newtbl.hashfunc = hashtblP->hashfunc;
-
-  if (!(newtbl.nodes = calloc(size, sizeof(hash_node_uint64_t *)))) return -1;
-
-  for (n = 0; n < hashtblP->size; ++n) {
-    for (node = hashtblP->nodes[n]; node; node = next) {
-      next = node->next;
-      hashtable_uint64_remove(hashtblP, node->key);
-      hashtable_uint64_insert(&newtbl, node->key, node->data);
-    }
+  if (!hash_slots_resize(&hashtblP->table, sizeP)) {
+    return HASH_TABLE_SYSTEM_ERROR;
   }
-
-  free_wrapper((void **) &hashtblP->nodes);
-  hashtblP->nodes = newtbl.nodes;
-  hashtblP->size = newtbl.size;
   return HASH_TABLE_OK;
 }
 
 //------------------------------------------------------------------------------
-/*
-   Resizing
-   The number of elements in a hash table is not always known when creating the table.
-   If the number of elements grows too large, it will seriously reduce the performance of most hash table operations.
-   If the number of elements are reduced, the hash table will waste memory. That is why we provide a function for resizing the table.
-   Resizing a hash table is not as easy as a realloc(). All hash values must be recalculated and each element must be inserted into its new position.
-   We create a temporary hash_table_uint64_t object (newtbl) to be used while building the new hashes.
-   This allows us to reuse hashtable_uint64_insert() and hashtable_uint64_free(), when moving the elements to the new table.
-   After that, we can just free_wrapper the old table and copy the elements from newtbl to hashtbl.
-   Dangerous not really thread safe.
-*/
-
 hashtable_rc_t hashtable_uint64_ts_resize(
   hash_table_uint64_ts_t *const hashtblP,
   const hash_size_t sizeP)
 {
-  hash_table_uint64_ts_t newtbl = {.mutex = PTHREAD_MUTEX_INITIALIZER, 0};
-  hash_size_t n = 0;
-  hash_node_uint64_t *node = NULL, *next = NULL;
+  bool resized = false;
 
   if (!hashtblP) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
-  hash_size_t size = sizeP;
-  // upper power of two: http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2Float
-  //  By Sean Eron Anderson
-  // seander@cs.stanford.edu
-  // Individually, the code snippets here are in the public domain (unless otherwise noted) — feel free to use them however you please.
-  // The aggregate collection and descriptions are © 1997-2005 Sean Eron Anderson. The code and descriptions are distributed in the hope
-  // that they will be useful, but WITHOUT ANY WARRANTY and without even the implied warranty of merchantability or fitness for a particular
-  // purpose. As of May 5, 2005, all the code has been tested thoroughly. Thousands of people have read it. Moreover, Professor Randal Bryant,
-  // the Dean of Computer Science at Carnegie Mellon University, has personally tested almost everything with his Uclid code verification system.
-  // What he hasn't tested, I have checked against all possible inputs on a 32-bit machine. To the first person to inform me of a legitimate bug
-  // in the code, I'll pay a bounty of US$10 (by check or Paypal). If directed to a charity, I'll pay US$20.
-  size--;
-  size |= size >> 1;
-  size |= size >> 2;
-  size |= size >> 4;
-  size |= size >> 8;
-  size |= size >> 16;
-  size++;
-
-  newtbl.size = size;
-  newtbl.hashfunc = hashtblP->hashfunc;
-
-  if (!(newtbl.nodes = calloc(size, sizeof(hash_node_uint64_t *))))
-    return HASH_TABLE_SYSTEM_ERROR;
-
-  if (!(newtbl.lock_nodes = calloc(size, sizeof(pthread_mutex_t)))) {
-    free_wrapper((void **) &newtbl.nodes);
-    return HASH_TABLE_SYSTEM_ERROR;
-  }
-  for (n = 0; n < hashtblP->size; ++n) {
-    pthread_mutex_init(&newtbl.lock_nodes[n], NULL);
-  }
-
-  pthread_mutex_lock(&hashtblP->mutex);
-  for (n = 0; n < hashtblP->size; ++n) {
-    for (node = hashtblP->nodes[n]; node; node = next) {
-      next = node->next;
-      hashtable_uint64_ts_remove(hashtblP, node->key);
-      hashtable_uint64_ts_insert(&newtbl, node->key, node->data);
-    }
-  }
-
-  free_wrapper((void **) &hashtblP->nodes);
-  free_wrapper((void **) &hashtblP->lock_nodes);
-  hashtblP->size = newtbl.size;
-  hashtblP->nodes = newtbl.nodes;
-  hashtblP->lock_nodes = newtbl.lock_nodes;
-  pthread_mutex_unlock(&hashtblP->mutex);
-  return HASH_TABLE_OK;
+  HASH_SLOTS_WRLOCK(hashtblP);
+  resized = hash_slots_resize(&hashtblP->table, sizeP);
+  HASH_SLOTS_UNLOCK(hashtblP);
+  return resized ? HASH_TABLE_OK : HASH_TABLE_SYSTEM_ERROR;
 }
@@ -41,6 +41,7 @@
 
 #include "bstrlib.h"
 #include "obj_hashtable.h"
+#include "hash_slots.h"
 #include "dynamic_memory_check.h"
 
 #if TRACE_HASHTABLE
@@ -52,6 +53,8 @@
 #define PRINT_HASHTABLE(...)
 #endif
 
+#define OBJ_HASHTABLE_KEY(sLoT) ((void *) (uintptr_t)(sLoT)->key)
+
 //------------------------------------------------------------------------------
 // Free function selected if we do not want to free_wrapper the key when removing an entry
 void obj_hashtable_no_free_key_callback(void *param)
@@ -63,34 +66,37 @@ void obj_hashtable_no_free_key_callback(void *param)
 /*
    Default hash function
    def_hashfunc() is the default used by hashtable_create() when the user didn't specify one.
-   This is a simple/naive hash function which adds the key's ASCII char values. It will probably generate lots of collisions on large hash tables.
+   Hashes all the bytes of the key, 8 at a time.
 */
-
 static hash_size_t def_hashfunc(const void *const keyP, const int key_sizeP)
 {
-  hash_size_t hash = 0;
-  int key_size = key_sizeP;
+  return (hash_size_t) hash_slots_hash_bytes(keyP, key_sizeP);
+}
 
-  // may use MD4 ?
-  while (key_size > 0) {
-    uint32_t val = 0;
-    int size = sizeof(val);
-    while ((size > 0) && (key_size > 0)) {
-      val = val << 8;
-      val |= ((uint8_t *) keyP)[key_size - 1];
-      size--;
-      key_size--;
-    }
-    hash ^= val;
+//------------------------------------------------------------------------------
+static inline uint64_t obj_hashtable_hash(
+  const obj_hash_table_t *const hashtblP,
+  const void *const keyP,
+  const int key_sizeP)
+{
+  if (hashtblP->hashfunc == def_hashfunc) {
+    return hash_slots_hash_bytes(keyP, key_sizeP);
   }
+  return hash_slots_mix(hashtblP->hashfunc(keyP, key_sizeP));
+}
 
-  return hash;
+//------------------------------------------------------------------------------
+static inline bool obj_hashtable_valid_key(
+  const void *const keyP,
+  const int key_sizeP)
+{
+  return (keyP != NULL) && (key_sizeP > 0) && (key_sizeP <= UINT16_MAX);
 }
 
 //------------------------------------------------------------------------------
 /*
  *    Initialization
- *    obj_hashtable_init() sets up the initial structure of the hash table. The user specified size will be allocated and initialized to NULL.
+ *    obj_hashtable_init() sets up the initial structure of the hash table. The user specified size is a hint, the table grows when needed.
  *    The user can also specify a hash function. If the hashfunc argument is NULL, a default hash function is used.
  *    If an error occurred, NULL is returned. All other values in the returned obj_hash_table_t pointer should be released with hashtable_destroy().
  *
@@ -103,31 +109,13 @@ obj_hash_table_t *obj_hashtable_init(
   void (*freedatafuncP)(void **),
   bstring display_name_pP)
 {
-  hash_size_t size = sizeP;
-  // upper power of two: http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2Float
-  //  By Sean Eron Anderson
-  // seander@cs.stanford.edu
-  // Individually, the code snippets here are in the public domain (unless otherwise noted) — feel free to use them however you please.
-  // The aggregate collection and descriptions are © 1997-2005 Sean Eron Anderson. The code and descriptions are distributed in the hope
-  // that they will be useful, but WITHOUT ANY WARRANTY and without even the implied warranty of merchantability or fitness for a particular
-  // purpose. As of May 5, 2005, all the code has been tested thoroughly. Thousands of people have read it. Moreover, Professor Randal Bryant,
-  // the Dean of Computer Science at Carnegie Mellon University, has personally tested almost everything with his Uclid code verification system.
-  // What he hasn't tested, I have checked against all possible inputs on a 32-bit machine. To the first person to inform me of a legitimate bug
-  // in the code, I'll pay a bounty of US$10 (by check or Paypal). If directed to a charity, I'll pay US$20.
-  size--;
-  size |= size >> 1;
-  size |= size >> 2;
-  size |= size >> 4;
-  size |= size >> 8;
-  size |= size >> 16;
-  size++;
-
-  if (!(hashtblP->nodes = calloc(size, sizeof(obj_hash_node_t *)))) {
+  if (!hash_slots_init(&hashtblP->table, sizeP, true)) {
     free_wrapper((void **) &hashtblP);
     return NULL;
   }
-
-  hashtblP->size = size;
+  pthread_rwlock_init(&hashtblP->lock, NULL);
+  // Tables created through the non thread safe API never take the lock
+  hashtblP->single_owner = true;
 
   if (hashfuncP)
     hashtblP->hashfunc = hashfuncP;
@@ -147,9 +135,8 @@ obj_hash_table_t *obj_hashtable_init(
   if (display_name_pP) {
     hashtblP->name = bstrcpy(display_name_pP);
   } else {
-    hashtblP->name = bfromcstr("");
-    btrunc(hashtblP->name, 0);
-    bassignformat(hashtblP->name, "obj_hashtable%u@%p", size, hashtblP);
+    hashtblP->name =
+      bformat("obj_hashtable%zu@%p", hashtblP->table.size, hashtblP);
   }
   hashtblP->log_enabled = true;
   return hashtblP;
@@ -158,7 +145,7 @@ obj_hash_table_t *obj_hashtable_init(
 //------------------------------------------------------------------------------
 /*
    Initialization
-   obj_hashtable_create() allocate and set up the initial structure of the hash table. The user specified size will be allocated and initialized to NULL.
+   obj_hashtable_create() allocate and set up the initial structure of the hash table.
    The user can also specify a hash function. If the hashfunc argument is NULL, a default hash function is used.
    If an error occurred, NULL is returned. All other values in the returned obj_hash_table_t pointer should be released with hashtable_destroy().
 */
@@ -180,7 +167,7 @@ obj_hash_table_t *obj_hashtable_create(
 //------------------------------------------------------------------------------
 /*
    Initialization
-   obj_hashtable_ts_init() sets up the initial structure of the hash table. The user specified size will be allocated and initialized to NULL.
+   obj_hashtable_ts_init() sets up the initial structure of the thread safe hash table. The user specified size is a hint, the table grows when needed.
    The user can also specify a hash function. If the hashfunc argument is NULL, a default hash function is used.
    If an error occurred, NULL is returned. All other values in the returned obj_hash_table_t pointer should be released with hashtable_destroy().
 */
@@ -192,45 +179,23 @@ obj_hash_table_t *obj_hashtable_ts_init(
   void (*freedatafuncP)(void **),
   bstring display_name_pP)
 {
-  hash_size_t size = sizeP;
-  // upper power of two: http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2Float
-  //  By Sean Eron Anderson
-  // seander@cs.stanford.edu
-  // Individually, the code snippets here are in the public domain (unless otherwise noted) — feel free to use them however you please.
-  // The aggregate collection and descriptions are © 1997-2005 Sean Eron Anderson. The code and descriptions are distributed in the hope
-  // that they will be useful, but WITHOUT ANY WARRANTY and without even the implied warranty of merchantability or fitness for a particular
-  // purpose. As of May 5, 2005, all the code has been tested thoroughly. Thousands of people have read it. Moreover, Professor Randal Bryant,
-  // the Dean of Computer Science at Carnegie Mellon University, has personally tested almost everything with his Uclid code verification system.
-  // What he hasn't tested, I have checked against all possible inputs on a 32-bit machine. To the first person to inform me of a legitimate bug
-  // in the code, I'll pay a bounty of US$10 (by check or Paypal). If directed to a charity, I'll pay US$20.
-  size--;
-  size |= size >> 1;
-  size |= size >> 2;
-  size |= size >> 4;
-  size |= size >> 8;
-  size |= size >> 16;
-  size++;
-
-  if (!(hashtblP->lock_nodes = calloc(size, sizeof(pthread_mutex_t)))) {
-    free_wrapper((void **) &hashtblP->nodes);
-    free_wrapper((void **) &hashtblP->name);
-    free_wrapper((void **) &hashtblP);
+  if (!obj_hashtable_init(
+        hashtblP,
+        sizeP,
+        hashfuncP,
+        freekeyfuncP,
+        freedatafuncP,
+        display_name_pP)) {
     return NULL;
   }
-
-  pthread_mutex_init(&hashtblP->mutex, NULL);
-  for (int i = 0; i < size; i++) {
-    pthread_mutex_init(&hashtblP->lock_nodes[i], NULL);
-  }
-
-  hashtblP->log_enabled = true;
+  hashtblP->single_owner = false;
   return hashtblP;
 }
 
 //------------------------------------------------------------------------------
 /*
    Initialisation
-   obj_hashtable_ts_create() allocate and sets up the initial structure of the hash table. The user specified size will be allocated and initialized to NULL.
+   obj_hashtable_ts_create() allocate and sets up the initial structure of the thread safe hash table.
    The user can also specify a hash function. If the hashfunc argument is NULL, a default hash function is used.
    If an error occurred, NULL is returned. All other values in the returned obj_hash_table_t pointer should be released with hashtable_destroy().
 */
@@ -243,216 +208,110 @@ obj_hash_table_t *obj_hashtable_ts_create(
 {
   obj_hash_table_t *hashtbl = NULL;
 
-  hash_size_t size = sizeP;
-  // upper power of two: http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2Float
-  //  By Sean Eron Anderson
-  // seander@cs.stanford.edu
-  // Individually, the code snippets here are in the public domain (unless otherwise noted) — feel free to use them however you please.
-  // The aggregate collection and descriptions are © 1997-2005 Sean Eron Anderson. The code and descriptions are distributed in the hope
-  // that they will be useful, but WITHOUT ANY WARRANTY and without even the implied warranty of merchantability or fitness for a particular
-  // purpose. As of May 5, 2005, all the code has been tested thoroughly. Thousands of people have read it. Moreover, Professor Randal Bryant,
-  // the Dean of Computer Science at Carnegie Mellon University, has personally tested almost everything with his Uclid code verification system.
-  // What he hasn't tested, I have checked against all possible inputs on a 32-bit machine. To the first person to inform me of a legitimate bug
-  // in the code, I'll pay a bounty of US$10 (by check or Paypal). If directed to a charity, I'll pay US$20.
-  size--;
-  size |= size >> 1;
-  size |= size >> 2;
-  size |= size >> 4;
-  size |= size >> 8;
-  size |= size >> 16;
-  size++;
-
-  if (!(hashtbl = obj_hashtable_create(
-          size, hashfuncP, freekeyfuncP, freedatafuncP, display_name_pP))) {
-    return NULL;
-  }
+  if (!(hashtbl = calloc(1, sizeof(obj_hash_table_t)))) return NULL;
 
   return obj_hashtable_ts_init(
-    hashtbl, size, hashfuncP, freekeyfuncP, freedatafuncP, display_name_pP);
+    hashtbl, sizeP, hashfuncP, freekeyfuncP, freedatafuncP, display_name_pP);
 }
 
 //------------------------------------------------------------------------------
 /*
-   Cleanup
-   The hashtable_destroy() walks through the linked lists for each possible hash value, and releases the elements. It also releases the nodes array and the obj_hash_table_t.
+   Lock elision
+   A table that is only accessed from the ITTI task owning it does not need
+   to take its lock. Must be set before the table is shared, if ever.
 */
-hashtable_rc_t obj_hashtable_destroy(obj_hash_table_t *const hashtblP)
+void obj_hashtable_ts_set_single_owner(
+  obj_hash_table_t *const hashtblP,
+  const bool single_owner)
 {
-  hash_size_t n;
-  obj_hash_node_t *node, *oldnode;
-
-  for (n = 0; n < hashtblP->size; ++n) {
-    node = hashtblP->nodes[n];
-
-    while (node) {
-      oldnode = node;
-      node = node->next;
-      hashtblP->freekeyfunc(&oldnode->key);
-      hashtblP->freedatafunc(&oldnode->data);
-      free_wrapper((void **) &oldnode);
-    }
+  if (hashtblP) {
+    hashtblP->single_owner = single_owner;
   }
-
-  free_wrapper((void **) &hashtblP->nodes);
-  free_wrapper((void **) &hashtblP->lock_nodes); // mmm....
-  bdestroy_wrapper(&hashtblP->name);
-  free_wrapper((void **) &hashtblP);
-  return HASH_TABLE_OK;
 }
 
 //------------------------------------------------------------------------------
 /*
    Cleanup
-   The hashtable_destroy() walks through the linked lists for each possible hash value, and releases the elements. It also releases the nodes array and the obj_hash_table_t.
+   The hashtable_destroy() walks through the slots, and releases the keys and the elements. It also releases the slots array and the obj_hash_table_t.
 */
-hashtable_rc_t obj_hashtable_ts_destroy(obj_hash_table_t *const hashtblP)
+hashtable_rc_t obj_hashtable_destroy(obj_hash_table_t *const hashtblP)
 {
-  hash_size_t n;
-  obj_hash_node_t *node, *oldnode;
-
-  for (n = 0; n < hashtblP->size; ++n) {
-    pthread_mutex_lock(&hashtblP->lock_nodes[n]);
-    node = hashtblP->nodes[n];
+  if (!hashtblP) {
+    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
+  }
 
-    while (node) {
-      oldnode = node;
-      node = node->next;
-      hashtblP->freekeyfunc(&oldnode->key);
-      hashtblP->freedatafunc(&oldnode->data);
-      free_wrapper((void **) &oldnode);
-    }
-    pthread_mutex_unlock(&hashtblP->lock_nodes[n]);
-    pthread_mutex_destroy(&hashtblP->lock_nodes[n]);
+  HASH_SLOTS_WRLOCK(hashtblP);
+  HASH_SLOTS_FOREACH(&hashtblP->table, slot)
+  {
+    void *key = OBJ_HASHTABLE_KEY(slot);
+    hashtblP->freekeyfunc(&key);
+    hashtblP->freedatafunc(&slot->data.ptr);
   }
+  hash_slots_release(&hashtblP->table);
+  HASH_SLOTS_UNLOCK(hashtblP);
+  pthread_rwlock_destroy(&hashtblP->lock);
 
-  free_wrapper((void **) &hashtblP->nodes);
-  free_wrapper((void **) &hashtblP->lock_nodes);
   bdestroy_wrapper(&hashtblP->name);
   free_wrapper((void **) &hashtblP);
   return HASH_TABLE_OK;
 }
 
+//------------------------------------------------------------------------------
+hashtable_rc_t obj_hashtable_ts_destroy(obj_hash_table_t *const hashtblP)
+{
+  return obj_hashtable_destroy(hashtblP);
+}
+
 //------------------------------------------------------------------------------
 hashtable_rc_t obj_hashtable_is_key_exists(
   const obj_hash_table_t *const hashtblP,
   const void *const keyP,
   const int key_sizeP)
 {
-  obj_hash_node_t *node;
-  hash_size_t hash;
+  hash_slot_t *slot = NULL;
 
   if (hashtblP == NULL) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  if (keyP == NULL) {
+  if (!obj_hashtable_valid_key(keyP, key_sizeP)) {
     PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
     return HASH_TABLE_BAD_PARAMETER_KEY;
   }
 
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p klen %u) hash %lx return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        key_sizeP,
-        hash);
-      return HASH_TABLE_OK;
-    } else if (node->key_size == key_sizeP) {
-      if (memcmp(node->key, keyP, key_sizeP) == 0) {
-        PRINT_HASHTABLE(
-          hashtblP,
-          "%s(%s,key %p klen %u) hash %lx return OK\n",
-          __FUNCTION__,
-          bdata(hashtblP->name),
-          keyP,
-          key_sizeP,
-          hash);
-        return HASH_TABLE_OK;
-      }
-    }
+  const uint64_t hash = obj_hashtable_hash(hashtblP, keyP, key_sizeP);
+  HASH_SLOTS_RDLOCK(hashtblP);
+  slot = hash_slots_find(
+    &hashtblP->table, hash, (hash_key_t)(uintptr_t) keyP, key_sizeP);
+  HASH_SLOTS_UNLOCK(hashtblP);
 
-    node = node->next;
+  if (slot) {
+    PRINT_HASHTABLE(
+      hashtblP,
+      "%s(%s,key %p klen %u) return OK\n",
+      __FUNCTION__,
+      bdata(hashtblP->name),
+      keyP,
+      key_sizeP);
+    return HASH_TABLE_OK;
   }
-
   PRINT_HASHTABLE(
     hashtblP,
-    "%s(%s,key %p klen %u) hash %lx return KEY_NOT_EXISTS\n",
+    "%s(%s,key %p klen %u) return KEY_NOT_EXISTS\n",
     __FUNCTION__,
     bdata(hashtblP->name),
     keyP,
-    key_sizeP,
-    hash);
+    key_sizeP);
   return HASH_TABLE_KEY_NOT_EXISTS;
 }
+
 //------------------------------------------------------------------------------
 hashtable_rc_t obj_hashtable_ts_is_key_exists(
   const obj_hash_table_t *const hashtblP,
   const void *const keyP,
   const int key_sizeP)
 {
-  obj_hash_node_t *node;
-  hash_size_t hash;
-
-  if (hashtblP == NULL) {
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-
-  if (keyP == NULL) {
-    PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
-    return HASH_TABLE_BAD_PARAMETER_KEY;
-  }
-
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  pthread_mutex_lock(&hashtblP->lock_nodes[hash]);
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p klen %u) hash %lx return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        key_sizeP,
-        hash);
-      return HASH_TABLE_OK;
-    } else if (node->key_size == key_sizeP) {
-      if (memcmp(node->key, keyP, key_sizeP) == 0) {
-        pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-        PRINT_HASHTABLE(
-          hashtblP,
-          "%s(%s,key %p klen %u) hash %lx return OK\n",
-          __FUNCTION__,
-          bdata(hashtblP->name),
-          keyP,
-          key_sizeP,
-          hash);
-        return HASH_TABLE_OK;
-      }
-    }
-
-    node = node->next;
-  }
-  pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-
-  PRINT_HASHTABLE(
-    hashtblP,
-    "%s(%s,key %p klen %u) hash %lx return KEY_NOT_EXISTS\n",
-    __FUNCTION__,
-    bdata(hashtblP->name),
-    keyP,
-    key_sizeP,
-    hash);
-  return HASH_TABLE_KEY_NOT_EXISTS;
+  return obj_hashtable_is_key_exists(hashtblP, keyP, key_sizeP);
 }
 
 //------------------------------------------------------------------------------
@@ -460,83 +319,39 @@ hashtable_rc_t obj_hashtable_dump_content(
   const obj_hash_table_t *const hashtblP,
   bstring str)
 {
-  obj_hash_node_t *node = NULL;
-  unsigned int i = 0;
-
-  if (hashtblP == NULL) {
+  if (!hashtblP) {
     bcatcstr(str, "HASH_TABLE_BAD_PARAMETER_HASHTABLE");
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  while (i < hashtblP->size) {
-    if (hashtblP->nodes[i] != NULL) {
-      node = hashtblP->nodes[i];
-
-      while (node) {
-        bstring b0 = bformat(
-          "Hash %x Key %p Key length %d Element %p\n",
-          i,
-          node->key,
-          node->key_size,
-          node->data);
-        if (!b0) {
-          PRINT_HASHTABLE(hashtblP, "Error while dumping hashtable content");
-        } else {
-          bconcat(str, b0);
-          bdestroy_wrapper(&b0);
-        }
-        node = node->next;
-      }
-    }
-    i += 1;
+  HASH_SLOTS_RDLOCK(hashtblP);
+  HASH_SLOTS_FOREACH(&hashtblP->table, slot)
+  {
+    bformata(
+      str,
+      "Hash %zu Key %p Key length %u Element %p\n",
+      (size_t)(slot - hashtblP->table.slots),
+      OBJ_HASHTABLE_KEY(slot),
+      slot->key_size,
+      slot->data.ptr);
   }
-
+  HASH_SLOTS_UNLOCK(hashtblP);
   return HASH_TABLE_OK;
 }
+
 //------------------------------------------------------------------------------
 hashtable_rc_t obj_hashtable_ts_dump_content(
   const obj_hash_table_t *const hashtblP,
   bstring str)
 {
-  obj_hash_node_t *node = NULL;
-  unsigned int i = 0;
-
-  if (hashtblP == NULL) {
-    bcatcstr(str, "HASH_TABLE_BAD_PARAMETER_HASHTABLE");
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-
-  while (i < hashtblP->size) {
-    if (hashtblP->nodes[i] != NULL) {
-      pthread_mutex_lock(&hashtblP->lock_nodes[i]);
-      node = hashtblP->nodes[i];
-
-      while (node) {
-        bstring b0 = bformat(
-          "Hash %x Key %p Key length %d Element %p\n",
-          i,
-          node->key,
-          node->key_size,
-          node->data);
-        if (!b0) {
-          PRINT_HASHTABLE(hashtblP, "Error while dumping hashtable content");
-        } else {
-          bconcat(str, b0);
-          bdestroy_wrapper(&b0);
-        }
-        node = node->next;
-      }
-      pthread_mutex_unlock(&hashtblP->lock_nodes[i]);
-    }
-    i += 1;
-  }
-  return HASH_TABLE_OK;
+  return obj_hashtable_dump_content(hashtblP, str);
 }
 
 //------------------------------------------------------------------------------
 /*
    Adding a new element
-   To make sure the hash value is not bigger than size, the result of the user provided hash function is used modulo size.
+   The key is copied in the table, an existing key keeps its copy and gets its
+   element replaced.
 */
 hashtable_rc_t obj_hashtable_insert(
   obj_hash_table_t *const hashtblP,
@@ -544,438 +359,171 @@ hashtable_rc_t obj_hashtable_insert(
   const int key_sizeP,
   void *dataP)
 {
-  obj_hash_node_t *node;
-  hash_size_t hash;
+  hashtable_rc_t rc = HASH_TABLE_OK;
+  hash_slot_t *slot = NULL;
+  void *key = NULL;
 
   if (hashtblP == NULL) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  if (keyP == NULL) {
+  if (!obj_hashtable_valid_key(keyP, key_sizeP)) {
     PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
     return HASH_TABLE_BAD_PARAMETER_KEY;
   }
 
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      if (node->data) {
-        hashtblP->freedatafunc(&node->data);
-      }
-
-      node->data = dataP;
-      node->key_size = key_sizeP;
-      // waste of memory here (keyP is lost) we should free_wrapper it now
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p data %p) hash %lx return INSERT_OVERWRITTEN_DATA\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        dataP,
-        hash);
-      return HASH_TABLE_INSERT_OVERWRITTEN_DATA;
+  const uint64_t hash = obj_hashtable_hash(hashtblP, keyP, key_sizeP);
+  HASH_SLOTS_WRLOCK(hashtblP);
+  slot = hash_slots_find(
+    &hashtblP->table, hash, (hash_key_t)(uintptr_t) keyP, key_sizeP);
+  if (slot) {
+    if ((slot->data.ptr) && (slot->data.ptr != dataP)) {
+      hashtblP->freedatafunc(&slot->data.ptr);
+      rc = HASH_TABLE_INSERT_OVERWRITTEN_DATA;
     }
-
-    node = node->next;
-  }
-
-  if (!(node = malloc(sizeof(obj_hash_node_t)))) {
-    PRINT_HASHTABLE(
-      hashtblP,
-      "%s(%s,key %p) hash %lx return SYSTEM_ERROR\n",
-      __FUNCTION__,
-      bdata(hashtblP->name),
-      keyP,
-      hash);
-    return HASH_TABLE_SYSTEM_ERROR;
-  }
-
-  if (!(node->key = malloc(key_sizeP))) {
-    PRINT_HASHTABLE(
-      hashtblP,
-      "%s(%s,key %p) hash %lx return SYSTEM_ERROR\n",
-      __FUNCTION__,
-      bdata(hashtblP->name),
-      keyP,
-      hash);
-    free_wrapper((void **) &node);
-    return -1;
-  }
-
-  memcpy(node->key, keyP, key_sizeP);
-  node->data = dataP;
-  node->key_size = key_sizeP;
-
-  if (hashtblP->nodes[hash]) {
-    node->next = hashtblP->nodes[hash];
+    slot->data.ptr = dataP;
+  } else if (!(key = malloc(key_sizeP))) {
+    rc = HASH_TABLE_SYSTEM_ERROR;
   } else {
-    node->next = NULL;
+    memcpy(key, keyP, key_sizeP);
+    slot = hash_slots_insert(
+      &hashtblP->table, hash, (hash_key_t)(uintptr_t) key, key_sizeP);
+    if (slot) {
+      slot->data.ptr = dataP;
+    } else {
+      free_wrapper(&key);
+      rc = HASH_TABLE_SYSTEM_ERROR;
+    }
   }
+  HASH_SLOTS_UNLOCK(hashtblP);
 
-  hashtblP->nodes[hash] = node;
-  __sync_fetch_and_add(&hashtblP->num_elements, 1);
   PRINT_HASHTABLE(
     hashtblP,
-    "%s(%s,key %p klen %u data %p) hash %lx return OK\n",
+    "%s(%s,key %p klen %u data %p) hash %lx return %s\n",
     __FUNCTION__,
     bdata(hashtblP->name),
     keyP,
     key_sizeP,
     dataP,
-    hash);
-  return HASH_TABLE_OK;
+    hash,
+    hashtable_rc_code2string(rc));
+  return rc;
 }
 
 //------------------------------------------------------------------------------
-/*
-   Adding a new element
-   To make sure the hash value is not bigger than size, the result of the user provided hash function is used modulo size.
-*/
 hashtable_rc_t obj_hashtable_ts_insert(
   obj_hash_table_t *const hashtblP,
   const void *const keyP,
   const int key_sizeP,
   void *dataP)
 {
-  obj_hash_node_t *node;
-  hash_size_t hash;
+  return obj_hashtable_insert(hashtblP, keyP, key_sizeP, dataP);
+}
+
+//------------------------------------------------------------------------------
+/*
+   To remove an element from the hash table, we just search for it in the
+   slots, and remove it if it is found. If freeP is set the key copy and the
+   element are freed, otherwise only the key copy is freed and the element is
+   returned in dataP. If it was not found, HASH_TABLE_KEY_NOT_EXISTS is
+   returned.
+*/
+static hashtable_rc_t obj_hashtable_take(
+  obj_hash_table_t *const hashtblP,
+  const void *const keyP,
+  const int key_sizeP,
+  bool freeP,
+  void **dataP)
+{
+  hash_slot_t *slot = NULL;
+  void *key = NULL;
 
   if (hashtblP == NULL) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  if (keyP == NULL) {
+  if (!obj_hashtable_valid_key(keyP, key_sizeP)) {
     PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
     return HASH_TABLE_BAD_PARAMETER_KEY;
   }
 
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  pthread_mutex_lock(&hashtblP->lock_nodes[hash]);
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      if ((node->data) && (node->data != dataP)) {
-        hashtblP->freedatafunc(&node->data);
-
-        node->data = dataP;
-        node->key_size = key_sizeP;
-        // no waste of memory here because if node->key == keyP, it is a reuse of the same key
-        pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-        PRINT_HASHTABLE(
-          hashtblP,
-          "%s(%s,key %p data %p) hash %lx return INSERT_OVERWRITTEN_DATA\n",
-          __FUNCTION__,
-          bdata(hashtblP->name),
-          keyP,
-          dataP,
-          hash);
-        return HASH_TABLE_INSERT_OVERWRITTEN_DATA;
-      }
-      node->data = dataP;
-      pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p data %p) hash %lx return ok\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        dataP,
-        hash);
-      return HASH_TABLE_OK;
-    }
-
-    node = node->next;
-  }
-
-  if (!(node = calloc(1, sizeof(obj_hash_node_t)))) {
-    pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-    PRINT_HASHTABLE(
-      hashtblP,
-      "%s(%s,key %p) hash %lx return SYSTEM_ERROR\n",
-      __FUNCTION__,
-      bdata(hashtblP->name),
-      keyP,
-      hash);
-    return HASH_TABLE_SYSTEM_ERROR;
-  }
-
-  if (!(node->key = calloc(1, key_sizeP))) {
-    free_wrapper((void **) &node);
-    pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
+  const uint64_t hash = obj_hashtable_hash(hashtblP, keyP, key_sizeP);
+  HASH_SLOTS_WRLOCK(hashtblP);
+  slot = hash_slots_find(
+    &hashtblP->table, hash, (hash_key_t)(uintptr_t) keyP, key_sizeP);
+  if (!slot) {
+    HASH_SLOTS_UNLOCK(hashtblP);
     PRINT_HASHTABLE(
       hashtblP,
-      "%s(%s,key %p) hash %lx return SYSTEM_ERROR\n",
+      "%s(%s,key %p klen %u) return KEY_NOT_EXISTS\n",
       __FUNCTION__,
       bdata(hashtblP->name),
       keyP,
-      hash);
-    return HASH_TABLE_SYSTEM_ERROR;
+      key_sizeP);
+    return HASH_TABLE_KEY_NOT_EXISTS;
   }
-
-  memcpy(node->key, keyP, key_sizeP);
-  node->data = dataP;
-  node->key_size = key_sizeP;
-
-  if (hashtblP->nodes[hash]) {
-    node->next = hashtblP->nodes[hash];
+  key = OBJ_HASHTABLE_KEY(slot);
+  hashtblP->freekeyfunc(&key);
+  if (freeP) {
+    hashtblP->freedatafunc(&slot->data.ptr);
   } else {
-    node->next = NULL;
+    *dataP = slot->data.ptr;
   }
+  hash_slots_erase(&hashtblP->table, slot);
+  HASH_SLOTS_UNLOCK(hashtblP);
 
-  hashtblP->nodes[hash] = node;
-  __sync_fetch_and_add(&hashtblP->num_elements, 1);
-  pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
   PRINT_HASHTABLE(
     hashtblP,
-    "%s(%s,key %p klen %u data %p) hash %lx return OK\n",
+    "%s(%s,key %p klen %u) hash %lx return OK\n",
     __FUNCTION__,
     bdata(hashtblP->name),
     keyP,
     key_sizeP,
-    dataP,
     hash);
   return HASH_TABLE_OK;
 }
 
 //------------------------------------------------------------------------------
-/*
-   To remove an element from the hash table, we just search for it in the linked list for that hash value,
-   and remove it if it is found. If it was not found, it is an error and -1 is returned.
-*/
 hashtable_rc_t obj_hashtable_free(
   obj_hash_table_t *const hashtblP,
   const void *const keyP,
   const int key_sizeP)
 {
-  obj_hash_node_t *node, *prevnode = NULL;
-  hash_size_t hash;
-
-  if (hashtblP == NULL) {
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-
-  if (keyP == NULL) {
-    PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
-    return HASH_TABLE_BAD_PARAMETER_KEY;
-  }
-
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (
-      (node->key == keyP) || ((node->key_size == key_sizeP) &&
-                              (memcmp(node->key, keyP, key_sizeP) == 0))) {
-      if (prevnode) {
-        prevnode->next = node->next;
-      } else {
-        hashtblP->nodes[hash] = node->next;
-      }
-
-      hashtblP->freekeyfunc(&node->key);
-      hashtblP->freedatafunc(&node->data);
-      free_wrapper((void **) &node);
-      hashtblP->num_elements -= 1;
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p) hash %lx return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        hash);
-      return HASH_TABLE_OK;
-    }
-
-    prevnode = node;
-    node = node->next;
-  }
-
-  return HASH_TABLE_KEY_NOT_EXISTS;
+  return obj_hashtable_take(hashtblP, keyP, key_sizeP, true, NULL);
 }
 
 //------------------------------------------------------------------------------
-/*
-   To remove an element from the hash table, we just search for it in the linked list for that hash value,
-   and remove it if it is found. If it was not found, it is an error and -1 is returned.
-*/
 hashtable_rc_t obj_hashtable_ts_free(
   obj_hash_table_t *const hashtblP,
   const void *const keyP,
   const int key_sizeP)
 {
-  obj_hash_node_t *node, *prevnode = NULL;
-  hash_size_t hash;
-
-  if (hashtblP == NULL) {
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-
-  if (keyP == NULL) {
-    PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
-    return HASH_TABLE_BAD_PARAMETER_KEY;
-  }
-
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  pthread_mutex_lock(&hashtblP->lock_nodes[hash]);
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (
-      (node->key == keyP) || ((node->key_size == key_sizeP) &&
-                              (memcmp(node->key, keyP, key_sizeP) == 0))) {
-      if (prevnode) {
-        prevnode->next = node->next;
-      } else {
-        hashtblP->nodes[hash] = node->next;
-      }
-
-      hashtblP->freekeyfunc(&node->key);
-      hashtblP->freedatafunc(&node->data);
-      free_wrapper((void **) &node);
-      __sync_fetch_and_sub(&hashtblP->num_elements, 1);
-      pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p) hash %lx return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        hash);
-      return HASH_TABLE_OK;
-    }
-
-    prevnode = node;
-    node = node->next;
-  }
-  pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-
-  return HASH_TABLE_KEY_NOT_EXISTS;
+  return obj_hashtable_take(hashtblP, keyP, key_sizeP, true, NULL);
 }
 
 //------------------------------------------------------------------------------
-/*
-   To remove an element from the hash table, we just search for it in the linked list for that hash value,
-   and remove it if it is found. If it was not found, it is an error and -1 is returned.
-*/
 hashtable_rc_t obj_hashtable_remove(
   obj_hash_table_t *const hashtblP,
   const void *const keyP,
   const int key_sizeP,
   void **dataP)
 {
-  obj_hash_node_t *node, *prevnode = NULL;
-  hash_size_t hash;
-
-  if (hashtblP == NULL) {
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-
-  if (keyP == NULL) {
-    PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
-    return HASH_TABLE_BAD_PARAMETER_KEY;
-  }
-
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (
-      (node->key == keyP) || ((node->key_size == key_sizeP) &&
-                              (memcmp(node->key, keyP, key_sizeP) == 0))) {
-      if (prevnode) {
-        prevnode->next = node->next;
-      } else {
-        hashtblP->nodes[hash] = node->next;
-      }
-
-      hashtblP->freekeyfunc(&node->key);
-      *dataP = node->data;
-      free_wrapper((void **) &node);
-      hashtblP->num_elements -= 1;
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p) hash %lx return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        hash);
-      return HASH_TABLE_OK;
-    }
-
-    prevnode = node;
-    node = node->next;
-  }
-
-  return HASH_TABLE_KEY_NOT_EXISTS;
+  return obj_hashtable_take(hashtblP, keyP, key_sizeP, false, dataP);
 }
 
 //------------------------------------------------------------------------------
-/*
-   To remove an element from the hash table, we just search for it in the linked list for that hash value,
-   and remove it if it is found. If it was not found, it is an error and -1 is returned.
-*/
 hashtable_rc_t obj_hashtable_ts_remove(
   obj_hash_table_t *const hashtblP,
   const void *const keyP,
   const int key_sizeP,
   void **dataP)
 {
-  obj_hash_node_t *node, *prevnode = NULL;
-  hash_size_t hash;
-
-  if (hashtblP == NULL) {
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-
-  if (keyP == NULL) {
-    PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
-    return HASH_TABLE_BAD_PARAMETER_KEY;
-  }
-
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  pthread_mutex_lock(&hashtblP->lock_nodes[hash]);
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (
-      (node->key == keyP) || ((node->key_size == key_sizeP) &&
-                              (memcmp(node->key, keyP, key_sizeP) == 0))) {
-      if (prevnode) {
-        prevnode->next = node->next;
-      } else {
-        hashtblP->nodes[hash] = node->next;
-      }
-
-      hashtblP->freekeyfunc(&node->key);
-      *dataP = node->data;
-      free_wrapper((void **) &node);
-      __sync_fetch_and_sub(&hashtblP->num_elements, 1);
-      pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p) hash %lx return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        hash);
-      return HASH_TABLE_OK;
-    }
-
-    prevnode = node;
-    node = node->next;
-  }
-  pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-
-  return HASH_TABLE_KEY_NOT_EXISTS;
+  return obj_hashtable_take(hashtblP, keyP, key_sizeP, false, dataP);
 }
 
 //------------------------------------------------------------------------------
 /*
-   Searching for an element is easy. We just search through the linked list for the corresponding hash value.
+   Searching for an element is easy. We just probe the slots from the home slot of the key.
    NULL is returned if we didn't find it.
 */
 hashtable_rc_t obj_hashtable_get(
@@ -984,346 +532,125 @@ hashtable_rc_t obj_hashtable_get(
   const int key_sizeP,
   void **dataP)
 {
-  obj_hash_node_t *node;
-  hash_size_t hash;
+  hash_slot_t *slot = NULL;
 
   if (hashtblP == NULL) {
     *dataP = NULL;
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  if (keyP == NULL) {
+  if (!obj_hashtable_valid_key(keyP, key_sizeP)) {
+    *dataP = NULL;
     PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
     return HASH_TABLE_BAD_PARAMETER_KEY;
   }
 
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      *dataP = node->data;
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p data %p) hash %lx return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        *dataP,
-        hash);
-      return HASH_TABLE_OK;
-    } else if (node->key_size == key_sizeP) {
-      if (memcmp(node->key, keyP, key_sizeP) == 0) {
-        *dataP = node->data;
-        PRINT_HASHTABLE(
-          hashtblP,
-          "%s(%s,key %p data %p) hash %lx return OK\n",
-          __FUNCTION__,
-          bdata(hashtblP->name),
-          keyP,
-          *dataP,
-          hash);
-        return HASH_TABLE_OK;
-      }
-    }
+  const uint64_t hash = obj_hashtable_hash(hashtblP, keyP, key_sizeP);
+  HASH_SLOTS_RDLOCK(hashtblP);
+  slot = hash_slots_find(
+    &hashtblP->table, hash, (hash_key_t)(uintptr_t) keyP, key_sizeP);
+  *dataP = slot ? slot->data.ptr : NULL;
+  HASH_SLOTS_UNLOCK(hashtblP);
 
-    node = node->next;
+  if (slot) {
+    PRINT_HASHTABLE(
+      hashtblP,
+      "%s(%s,key %p klen %u data %p) hash %lx return OK\n",
+      __FUNCTION__,
+      bdata(hashtblP->name),
+      keyP,
+      key_sizeP,
+      *dataP,
+      hash);
+    return HASH_TABLE_OK;
   }
-
-  *dataP = NULL;
   PRINT_HASHTABLE(
     hashtblP,
-    "%s(%s,key %p) hash %lx return KEY_NOT_EXISTS\n",
+    "%s(%s,key %p klen %u) hash %lx return KEY_NOT_EXISTS\n",
     __FUNCTION__,
     bdata(hashtblP->name),
     keyP,
+    key_sizeP,
     hash);
   return HASH_TABLE_KEY_NOT_EXISTS;
 }
 
 //------------------------------------------------------------------------------
-/*
-   Searching for an element is easy. We just search through the linked list for the corresponding hash value.
-   NULL is returned if we didn't find it.
-*/
 hashtable_rc_t obj_hashtable_ts_get(
   const obj_hash_table_t *const hashtblP,
   const void *const keyP,
   const int key_sizeP,
   void **dataP)
 {
-  obj_hash_node_t *node;
-  hash_size_t hash;
-
-  if (hashtblP == NULL) {
-    *dataP = NULL;
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-
-  if (keyP == NULL) {
-    PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
-    return HASH_TABLE_BAD_PARAMETER_KEY;
-  }
-
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  pthread_mutex_lock(&hashtblP->lock_nodes[hash]);
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      *dataP = node->data;
-      pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p klen %u data %p) hash %lx return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        key_sizeP,
-        *dataP,
-        hash);
-      return HASH_TABLE_OK;
-    } else if (node->key_size == key_sizeP) {
-      if (memcmp(node->key, keyP, key_sizeP) == 0) {
-        *dataP = node->data;
-        pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-        PRINT_HASHTABLE(
-          hashtblP,
-          "%s(%s,key %p klen %u data %p) hash %lx return OK\n",
-          __FUNCTION__,
-          bdata(hashtblP->name),
-          keyP,
-          key_sizeP,
-          *dataP,
-          hash);
-        return HASH_TABLE_OK;
-      }
-    }
-
-    node = node->next;
-  }
-
-  *dataP = NULL;
-  pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-  PRINT_HASHTABLE(
-    hashtblP,
-    "%s(%s,key %p klen %u) hash %lx return KEY_NOT_EXISTS\n",
-    __FUNCTION__,
-    bdata(hashtblP->name),
-    keyP,
-    key_sizeP,
-    hash);
-  return HASH_TABLE_KEY_NOT_EXISTS;
+  return obj_hashtable_get(hashtblP, keyP, key_sizeP, dataP);
 }
 
 //------------------------------------------------------------------------------
 /*
    Function to return all keys of an object hash table
+   keysP is an array allocated by the caller, large enough for all the keys of
+   the table, it receives pointers to the keys stored in the table. With a NULL
+   keysP only the number of keys is returned in sizeP.
 */
 hashtable_rc_t obj_hashtable_get_keys(
   const obj_hash_table_t *const hashtblP,
   void **keysP,
   unsigned int *sizeP)
 {
-  size_t n = 0;
-  obj_hash_node_t *node = NULL;
-  obj_hash_node_t *next = NULL;
-
   if (hashtblP == NULL) {
-    keysP = NULL;
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  *sizeP = 0;
-  keysP = calloc(hashtblP->num_elements, sizeof(void *));
-
-  if (keysP) {
-    for (n = 0; n < hashtblP->size; ++n) {
-      for (node = hashtblP->nodes[n]; node; node = next) {
-        keysP[*sizeP++] = node->key;
-        next = node->next;
-      }
+  HASH_SLOTS_RDLOCK(hashtblP);
+  if (!keysP) {
+    *sizeP = hashtblP->table.num_elements;
+  } else {
+    *sizeP = 0;
+    HASH_SLOTS_FOREACH(&hashtblP->table, slot)
+    {
+      keysP[(*sizeP)++] = OBJ_HASHTABLE_KEY(slot);
     }
-
-    PRINT_HASHTABLE(hashtblP, "return OK\n");
-    return HASH_TABLE_OK;
   }
-  PRINT_HASHTABLE(hashtblP, "return SYSTEM_ERROR\n");
-  return HASH_TABLE_SYSTEM_ERROR;
+  HASH_SLOTS_UNLOCK(hashtblP);
+  PRINT_HASHTABLE(hashtblP, "return OK\n");
+  return HASH_TABLE_OK;
 }
 
 //------------------------------------------------------------------------------
-/*
-   Function to return all keys of an object hash table
-*/
 hashtable_rc_t obj_hashtable_ts_get_keys(
   const obj_hash_table_t *const hashtblP,
   void **keysP,
   unsigned int *sizeP)
 {
-  size_t n = 0;
-  obj_hash_node_t *node = NULL;
-  obj_hash_node_t *next = NULL;
-
-  if (hashtblP == NULL) {
-    keysP = NULL;
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-
-  *sizeP = 0;
-  keysP = calloc(hashtblP->num_elements, sizeof(void *));
-
-  if (keysP) {
-    for (n = 0; n < hashtblP->size; ++n) {
-      pthread_mutex_lock(&hashtblP->lock_nodes[n]);
-      for (node = hashtblP->nodes[n]; node; node = next) {
-        keysP[*sizeP++] = node->key;
-        next = node->next;
-      }
-      pthread_mutex_unlock(&hashtblP->lock_nodes[n]);
-    }
-
-    PRINT_HASHTABLE(hashtblP, "return OK\n");
-    return HASH_TABLE_OK;
-  }
-  PRINT_HASHTABLE(hashtblP, "return SYSTEM_ERROR\n");
-  return HASH_TABLE_SYSTEM_ERROR;
+  return obj_hashtable_get_keys(hashtblP, keysP, sizeP);
 }
 
 //------------------------------------------------------------------------------
 /*
    Resizing
-   The number of elements in a hash table is not always known when creating the table.
-   If the number of elements grows too large, it will seriously reduce the performance of most hash table operations.
-   If the number of elements are reduced, the hash table will waste memory. That is why we provide a function for resizing the table.
-   Resizing a hash table is not as easy as a realloc(). All hash values must be recalculated and each element must be inserted into its new position.
-   We create a temporary obj_hash_table_t object (newtbl) to be used while building the new hashes.
-   This allows us to reuse hashtable_insert() and hashtable_free(), when moving the elements to the new table.
-   After that, we can just free_wrapper the old table and copy the elements from newtbl to hashtbl.
+   Tables grow automatically when their load factor gets too high, resizing is
+   only useful to reserve room ahead of a known number of insertions, or to
+   give back memory after a lot of removals.
 */
 hashtable_rc_t obj_hashtable_resize(
   obj_hash_table_t *const hashtblP,
   const hash_size_t sizeP)
 {
-  obj_hash_table_t newtbl = {.mutex = PTHREAD_MUTEX_INITIALIZER, 0};
-  hash_size_t n;
-  obj_hash_node_t *node, *next;
-  void *dummy = NULL;
+  bool resized = false;
 
   if (hashtblP == NULL) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
-  hash_size_t size = sizeP;
-  // upper power of two: http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2Float
-  //  By Sean Eron Anderson
-  // seander@cs.stanford.edu
-  // Individually, the code snippets here are in the public domain (unless otherwise noted) — feel free to use them however you please.
-  // The aggregate collection and descriptions are © 1997-2005 Sean Eron Anderson. The code and descriptions are distributed in the hope
-  // that they will be useful, but WITHOUT ANY WARRANTY and without even the implied warranty of merchantability or fitness for a particular
-  // purpose. As of May 5, 2005, all the code has been tested thoroughly. Thousands of people have read it. Moreover, Professor Randal Bryant,
-  // the Dean of Computer Science at Carnegie Mellon University, has personally tested almost everything with his Uclid code verification system.
-  // What he hasn't tested, I have checked against all possible inputs on a 32-bit machine. To the first person to inform me of a legitimate bug
-  // in the code, I'll pay a bounty of US$10 (by check or Paypal). If directed to a charity, I'll pay US$20.
-  size--;
-  size |= size >> 1;
-  size |= size >> 2;
-  size |= size >> 4;
-  size |= size >> 8;
-  size |= size >> 16;
-  size++;
-
-  newtbl.size = size;
-  newtbl.hashfunc = hashtblP->hashfunc;
-
-  if (!(newtbl.nodes = calloc(size, sizeof(obj_hash_node_t *))))
-    return HASH_TABLE_SYSTEM_ERROR;
-
-  for (n = 0; n < hashtblP->size; ++n) {
-    for (node = hashtblP->nodes[n]; node; node = next) {
-      next = node->next;
-      obj_hashtable_remove(hashtblP, node->key, node->key_size, &dummy);
-      obj_hashtable_insert(&newtbl, node->key, node->key_size, node->data);
-    }
-  }
-
-  free_wrapper((void **) &hashtblP->nodes);
-  hashtblP->size = newtbl.size;
-  hashtblP->nodes = newtbl.nodes;
-  PRINT_HASHTABLE(hashtblP, "return OK\n");
-  return HASH_TABLE_OK;
+  HASH_SLOTS_WRLOCK(hashtblP);
+  resized = hash_slots_resize(&hashtblP->table, sizeP);
+  HASH_SLOTS_UNLOCK(hashtblP);
+  return resized ? HASH_TABLE_OK : HASH_TABLE_SYSTEM_ERROR;
 }
 
 //------------------------------------------------------------------------------
-/*
-   Resizing
-   The number of elements in a hash table is not always known when creating the table.
-   If the number of elements grows too large, it will seriously reduce the performance of most hash table operations.
-   If the number of elements are reduced, the hash table will waste memory. That is why we provide a function for resizing the table.
-   Resizing a hash table is not as easy as a realloc(). All hash values must be recalculated and each element must be inserted into its new position.
-   We create a temporary obj_hash_table_t object (newtbl) to be used while building the new hashes.
-   This allows us to reuse hashtable_insert() and hashtable_free(), when moving the elements to the new table.
-   After that, we can just free_wrapper the old table and copy the elements from newtbl to hashtbl.
-*/
 hashtable_rc_t obj_hashtable_ts_resize(
   obj_hash_table_t *const hashtblP,
   const hash_size_t sizeP)
 {
-  obj_hash_table_t newtbl = {.mutex = PTHREAD_MUTEX_INITIALIZER, 0};
-  hash_size_t n;
-  obj_hash_node_t *node, *next;
-  void *dummy = NULL;
-
-  if (hashtblP == NULL) {
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-  hash_size_t size = sizeP;
-  // upper power of two: http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2Float
-  //  By Sean Eron Anderson
-  // seander@cs.stanford.edu
-  // Individually, the code snippets here are in the public domain (unless otherwise noted) — feel free to use them however you please.
-  // The aggregate collection and descriptions are © 1997-2005 Sean Eron Anderson. The code and descriptions are distributed in the hope
-  // that they will be useful, but WITHOUT ANY WARRANTY and without even the implied warranty of merchantability or fitness for a particular
-  // purpose. As of May 5, 2005, all the code has been tested thoroughly. Thousands of people have read it. Moreover, Professor Randal Bryant,
-  // the Dean of Computer Science at Carnegie Mellon University, has personally tested almost everything with his Uclid code verification system.
-  // What he hasn't tested, I have checked against all possible inputs on a 32-bit machine. To the first person to inform me of a legitimate bug
-  // in the code, I'll pay a bounty of US$10 (by check or Paypal). If directed to a charity, I'll pay US$20.
-  size--;
-  size |= size >> 1;
-  size |= size >> 2;
-  size |= size >> 4;
-  size |= size >> 8;
-  size |= size >> 16;
-  size++;
-
-  newtbl.size = size;
-  newtbl.hashfunc = hashtblP->hashfunc;
-
-  if (!(newtbl.nodes = calloc(size, sizeof(obj_hash_node_t *))))
-    return HASH_TABLE_SYSTEM_ERROR;
-
-  if (!(newtbl.lock_nodes = calloc(size, sizeof(pthread_mutex_t)))) {
-    free_wrapper((void **) &newtbl.nodes);
-    return HASH_TABLE_SYSTEM_ERROR;
-  }
-  for (n = 0; n < hashtblP->size; ++n) {
-    pthread_mutex_init(&newtbl.lock_nodes[n], NULL);
-  }
-
-  pthread_mutex_lock(&hashtblP->mutex);
-  for (n = 0; n < hashtblP->size; ++n) {
-    for (node = hashtblP->nodes[n]; node; node = next) {
-      next = node->next;
-      obj_hashtable_ts_remove(hashtblP, node->key, node->key_size, &dummy);
-      obj_hashtable_insert(&newtbl, node->key, node->key_size, node->data);
-    }
-  }
-
-  free_wrapper((void **) &hashtblP->nodes);
-  free_wrapper((void **) &hashtblP->nodes);
-  hashtblP->size = newtbl.size;
-  hashtblP->nodes = newtbl.nodes;
-  hashtblP->lock_nodes = newtbl.lock_nodes;
-  pthread_mutex_unlock(&hashtblP->mutex);
-  PRINT_HASHTABLE(hashtblP, "return OK\n");
-  return HASH_TABLE_OK;
+  return obj_hashtable_resize(hashtblP, sizeP);
 }
@@ -50,26 +50,11 @@
     free(key_array_ptr);                                                       \
   } while(0) /*Free the list of keys of an object hash table */
 
-typedef struct obj_hash_node_s {
-  int key_size;
-  void *key;
-  void *data;
-  struct obj_hash_node_s *next;
-} obj_hash_node_t;
-
-typedef struct obj_hash_node_uint64_s {
-  int key_size;
-  void *key;
-  uint64_t data;
-  struct obj_hash_node_uint64_s *next;
-} obj_hash_node_uint64_t;
-
+// Object tables copy the keys on insert and compare them by content
 typedef struct obj_hash_table_s {
-  pthread_mutex_t mutex;
-  hash_size_t size;
-  hash_size_t num_elements;
-  struct obj_hash_node_s **nodes;
-  pthread_mutex_t *lock_nodes;
+  pthread_rwlock_t lock;
+  bool single_owner;
+  hash_slots_t table;
   hash_size_t (*hashfunc)(const void *, int);
   void (*freekeyfunc)(void **);
   void (*freedatafunc)(void **);
@@ -77,11 +62,9 @@ typedef struct obj_hash_table_s {
   bool log_enabled;
 } obj_hash_table_t;
 typedef struct obj_hash_table_uint64_s {
-  pthread_mutex_t mutex;
-  hash_size_t size;
-  hash_size_t num_elements;
-  struct obj_hash_node_uint64_s **nodes;
-  pthread_mutex_t *lock_nodes;
+  pthread_rwlock_t lock;
+  bool single_owner;
+  hash_slots_t table;
   hash_size_t (*hashfunc)(const void *, int);
   void (*freekeyfunc)(void **);
   bstring name;
@@ -185,6 +168,10 @@ hashtable_rc_t obj_hashtable_ts_get_keys(
 hashtable_rc_t obj_hashtable_ts_resize(
   obj_hash_table_t *const hashtblP,
   const hash_size_t sizeP);
+// Elide locking for a table only accessed by the task owning it
+void obj_hashtable_ts_set_single_owner(
+  obj_hash_table_t *const hashtblP,
+  const bool single_owner);
 obj_hash_table_uint64_t *obj_hashtable_uint64_init(
   obj_hash_table_uint64_t *const hashtblP,
   const hash_size_t sizeP,
@@ -277,5 +264,9 @@ hashtable_rc_t obj_hashtable_uint64_ts_get_keys(
 hashtable_rc_t obj_hashtable_uint64_ts_resize(
   obj_hash_table_uint64_t *const hashtblP,
   const hash_size_t sizeP);
+// Elide locking for a table only accessed by the task owning it
+void obj_hashtable_uint64_ts_set_single_owner(
+  obj_hash_table_uint64_t *const hashtblP,
+  const bool single_owner);
 
 #endif
@@ -27,26 +27,23 @@
  * either expressed or implied, of the FreeBSD Project.
  */
 
-/*! \file obj_hashtable.c
+/*! \file obj_hashtable_uint64.c
   \brief
   \author Lionel Gauthier
   \company Eurecom
   \email: lionel.gauthier@eurecom.fr
 */
-
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <inttypes.h>
 #include <stdbool.h>
+#include <inttypes.h>
 #include <pthread.h>
-#include <stdint.h>
 
-#include "assertions.h"
 #include "bstrlib.h"
 #include "obj_hashtable.h"
+#include "hash_slots.h"
 #include "dynamic_memory_check.h"
-#include "hashtable.h"
 
 #if TRACE_HASHTABLE
 #define PRINT_HASHTABLE(hTbLe, ...)                                            \
@@ -57,40 +54,45 @@
 #define PRINT_HASHTABLE(...)
 #endif
 
+#define OBJ_HASHTABLE_KEY(sLoT) ((void *) (uintptr_t)(sLoT)->key)
+
 //------------------------------------------------------------------------------
 /*
    Default hash function
    def_hashfunc() is the default used by hashtable_create() when the user didn't specify one.
-   This is a simple/naive hash function which adds the key's ASCII char values. It will probably generate lots of collisions on large hash tables.
+   Hashes all the bytes of the key, 8 at a time.
 */
-
 static hash_size_t def_hashfunc(const void *const keyP, const int key_sizeP)
 {
-  hash_size_t hash = 0;
-  int key_size = key_sizeP;
+  return (hash_size_t) hash_slots_hash_bytes(keyP, key_sizeP);
+}
 
-  // may use MD4 ?
-  while (key_size > 0) {
-    uint32_t val = 0;
-    int size = sizeof(val);
-    while ((size > 0) && (key_size > 0)) {
-      val = val << 8;
-      val |= ((uint8_t *) keyP)[key_size - 1];
-      size--;
-      key_size--;
-    }
-    hash ^= val;
+//------------------------------------------------------------------------------
+static inline uint64_t obj_hashtable_uint64_hash(
+  const obj_hash_table_uint64_t *const hashtblP,
+  const void *const keyP,
+  const int key_sizeP)
+{
+  if (hashtblP->hashfunc == def_hashfunc) {
+    return hash_slots_hash_bytes(keyP, key_sizeP);
   }
+  return hash_slots_mix(hashtblP->hashfunc(keyP, key_sizeP));
+}
 
-  return hash;
+//------------------------------------------------------------------------------
+static inline bool obj_hashtable_uint64_valid_key(
+  const void *const keyP,
+  const int key_sizeP)
+{
+  return (keyP != NULL) && (key_sizeP > 0) && (key_sizeP <= UINT16_MAX);
 }
 
 //------------------------------------------------------------------------------
 /*
  *    Initialization
- *    obj_hashtable_uint64_init() sets up the initial structure of the hash table. The user specified size will be allocated and initialized to NULL.
+ *    obj_hashtable_uint64_init() sets up the initial structure of the hash table. The user specified size is a hint, the table grows when needed.
  *    The user can also specify a hash function. If the hashfunc argument is NULL, a default hash function is used.
- *    If an error occurred, NULL is returned. All other values in the returned obj_hash_table_uint64_t pointer should be released with hashtable_destroy().
+ *    If an error occurred, NULL is returned. All other values in the returned obj_hash_table_uint64_t pointer should be released with obj_hashtable_uint64_destroy().
  *
  */
 obj_hash_table_uint64_t *obj_hashtable_uint64_init(
@@ -100,32 +102,13 @@ obj_hash_table_uint64_t *obj_hashtable_uint64_init(
   void (*freekeyfuncP)(void **),
   bstring display_name_pP)
 {
-  hash_size_t size = sizeP;
-  // upper power of two: http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2Float
-  //  By Sean Eron Anderson
-  // seander@cs.stanford.edu
-  // Individually, the code snippets here are in the public domain (unless
-  // otherwise noted) - feel free to use them however you please.
-  // The aggregate collection and descriptions are copyright 1997-2005 Sean Eron
-  // Anderson. The code and descriptions are distributed in the hope that they
-  // will be useful, but WITHOUT ANY WARRANTY and without even the implied
-  // warranty of merchantability or fitness for a particular purpose. As of May
-  // 5, 2005, all the code has been tested thoroughly. Thousands of people have
-  // read it. Moreover, Professor Randal Bryant, the Dean of Computer Science at
-  // Carnegie Mellon University, has personally tested almost everything with
-  // his Uclid code verification system.  What he hasn't tested, I have checked
-  // against all possible inputs on a 32-bit machine. To the first person to
-  // inform me of a legitimate bug in the code, I'll pay a bounty of US$10 (by
-  // check or Paypal). If directed to a charity, I'll pay US$20.
-  size--; size |= size >> 1; size |= size >> 2; size |= size >> 4; size |= size
-    >> 8; size |= size >> 16; size++;
-
-  if (!(hashtblP->nodes = calloc(size, sizeof(obj_hash_node_uint64_t *)))) {
+  if (!hash_slots_init(&hashtblP->table, sizeP, true)) {
     free_wrapper((void **) &hashtblP);
     return NULL;
   }
-
-  hashtblP->size = size;
+  pthread_rwlock_init(&hashtblP->lock, NULL);
+  // Tables created through the non thread safe API never take the lock
+  hashtblP->single_owner = true;
 
   if (hashfuncP)
     hashtblP->hashfunc = hashfuncP;
@@ -140,9 +123,8 @@ obj_hash_table_uint64_t *obj_hashtable_uint64_init(
   if (display_name_pP) {
     hashtblP->name = bstrcpy(display_name_pP);
   } else {
-    hashtblP->name = bfromcstr("");
-    btrunc(hashtblP->name, 0);
-    bassignformat(hashtblP->name, "obj_hashtable%u@%p", size, hashtblP);
+    hashtblP->name =
+      bformat("obj_hashtable%zu@%p", hashtblP->table.size, hashtblP);
   }
   hashtblP->log_enabled = true;
   return hashtblP;
@@ -151,9 +133,9 @@ obj_hash_table_uint64_t *obj_hashtable_uint64_init(
 //------------------------------------------------------------------------------
 /*
    Initialization
-   obj_hashtable_uint64_create() allocate and set up the initial structure of the hash table. The user specified size will be allocated and initialized to NULL.
+   obj_hashtable_uint64_create() allocate and set up the initial structure of the hash table.
    The user can also specify a hash function. If the hashfunc argument is NULL, a default hash function is used.
-   If an error occurred, NULL is returned. All other values in the returned obj_hash_table_uint64_t pointer should be released with hashtable_destroy().
+   If an error occurred, NULL is returned. All other values in the returned obj_hash_table_uint64_t pointer should be released with obj_hashtable_uint64_destroy().
 */
 obj_hash_table_uint64_t *obj_hashtable_uint64_create(
   const hash_size_t sizeP,
@@ -172,9 +154,9 @@ obj_hash_table_uint64_t *obj_hashtable_uint64_create(
 //------------------------------------------------------------------------------
 /*
    Initialization
-   obj_hashtable_uint64_ts_init() sets up the initial structure of the hash table. The user specified size will be allocated and initialized to NULL.
+   obj_hashtable_uint64_ts_init() sets up the initial structure of the thread safe hash table. The user specified size is a hint, the table grows when needed.
    The user can also specify a hash function. If the hashfunc argument is NULL, a default hash function is used.
-   If an error occurred, NULL is returned. All other values in the returned obj_hash_table_uint64_t pointer should be released with obj_hashtable_uint64_destroy().
+   If an error occurred, NULL is returned. All other values in the returned obj_hash_table_uint64_t pointer should be released with obj_hashtable_uint64_ts_destroy().
 */
 obj_hash_table_uint64_t *obj_hashtable_uint64_ts_init(
   obj_hash_table_uint64_t *const hashtblP,
@@ -183,48 +165,20 @@ obj_hash_table_uint64_t *obj_hashtable_uint64_ts_init(
   void (*freekeyfuncP)(void **),
   bstring display_name_pP)
 {
-  hash_size_t size = sizeP;
-  // upper power of two: http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2Float
-  //  By Sean Eron Anderson
-  // seander@cs.stanford.edu
-  // Individually, the code snippets here are in the public domain (unless
-  // otherwise noted) - feel free to use them however you please.
-  // The aggregate collection and descriptions are copyright 1997-2005 Sean Eron
-  // Anderson. The code and descriptions are distributed in the hope that they
-  // will be useful, but WITHOUT ANY WARRANTY and without even the implied
-  // warranty of merchantability or fitness for a particular purpose. As of May
-  // 5, 2005, all the code has been tested thoroughly. Thousands of people have
-  // read it. Moreover, Professor Randal Bryant, the Dean of Computer Science at
-  // Carnegie Mellon University, has personally tested almost everything with
-  // his Uclid code verification system.  What he hasn't tested, I have checked
-  // against all possible inputs on a 32-bit machine. To the first person to
-  // inform me of a legitimate bug in the code, I'll pay a bounty of US$10 (by
-  // check or Paypal). If directed to a charity, I'll pay US$20.
-  size--; size |= size >> 1; size |= size >> 2; size |= size >> 4; size |= size
-    >> 8; size |= size >> 16; size++;
-
-  if (!(hashtblP->lock_nodes = calloc(size, sizeof(pthread_mutex_t)))) {
-    free_wrapper((void **) &hashtblP->nodes);
-    free_wrapper((void **) &hashtblP->name);
-    free_wrapper((void **) &hashtblP);
+  if (!obj_hashtable_uint64_init(
+        hashtblP, sizeP, hashfuncP, freekeyfuncP, display_name_pP)) {
     return NULL;
   }
-
-  pthread_mutex_init(&hashtblP->mutex, NULL);
-  for (int i = 0; i < size; i++) {
-    pthread_mutex_init(&hashtblP->lock_nodes[i], NULL);
-  }
-
-  hashtblP->log_enabled = true;
+  hashtblP->single_owner = false;
   return hashtblP;
 }
 
 //------------------------------------------------------------------------------
 /*
    Initialisation
-   obj_hashtable_uint64_ts_create() allocate and sets up the initial structure of the hash table. The user specified size will be allocated and initialized to NULL.
+   obj_hashtable_uint64_ts_create() allocate and sets up the initial structure of the thread safe hash table.
    The user can also specify a hash function. If the hashfunc argument is NULL, a default hash function is used.
-   If an error occurred, NULL is returned. All other values in the returned obj_hash_table_uint64_t pointer should be released with obj_hashtable_uint64_destroy().
+   If an error occurred, NULL is returned. All other values in the returned obj_hash_table_uint64_t pointer should be released with obj_hashtable_uint64_ts_destroy().
 */
 obj_hash_table_uint64_t *obj_hashtable_uint64_ts_create(
   const hash_size_t sizeP,
@@ -234,216 +188,111 @@ obj_hash_table_uint64_t *obj_hashtable_uint64_ts_create(
 {
   obj_hash_table_uint64_t *hashtbl = NULL;
 
-  hash_size_t size = sizeP;
-  // upper power of two: http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2Float
-  //  By Sean Eron Anderson
-  // seander@cs.stanford.edu
-  // Individually, the code snippets here are in the public domain (unless
-  // otherwise noted) - feel free to use them however you please.  The aggregate
-  // collection and descriptions are copyright 1997-2005 Sean Eron Anderson. The
-  // code and descriptions are distributed in the hope that they will be useful,
-  // but WITHOUT ANY WARRANTY and without even the implied warranty of
-  // merchantability or fitness for a particular purpose. As of May 5, 2005, all
-  // the code has been tested thoroughly. Thousands of people have read it.
-  // Moreover, Professor Randal Bryant, the Dean of Computer Science at Carnegie
-  // Mellon University, has personally tested almost everything with his Uclid
-  // code verification system.  What he hasn't tested, I have checked against
-  // all possible inputs on a 32-bit machine. To the first person to inform me
-  // of a legitimate bug in the code, I'll pay a bounty of US$10 (by check or
-  // Paypal). If directed to a charity, I'll pay US$20.
-  size--; size |= size >> 1; size |= size >> 2; size |= size >> 4; size |= size
-    >> 8; size |= size >> 16; size++;
-
-  if (!(hashtbl = obj_hashtable_uint64_create(
-          size, hashfuncP, freekeyfuncP, display_name_pP))) {
-    return NULL;
-  }
+  if (!(hashtbl = calloc(1, sizeof(obj_hash_table_uint64_t)))) return NULL;
 
   return obj_hashtable_uint64_ts_init(
-    hashtbl, size, hashfuncP, freekeyfuncP, display_name_pP);
+    hashtbl, sizeP, hashfuncP, freekeyfuncP, display_name_pP);
 }
 
 //------------------------------------------------------------------------------
 /*
-   Cleanup
-   The obj_hashtable_uint64_destroy() walks through the linked lists for each possible hash value, and releases the elements. It also releases the nodes array and the obj_hash_table_uint64_t.
+   Lock elision
+   A table that is only accessed from the ITTI task owning it does not need
+   to take its lock. Must be set before the table is shared, if ever.
 */
-hashtable_rc_t obj_hashtable_uint64_destroy(
-  obj_hash_table_uint64_t *const hashtblP)
+void obj_hashtable_uint64_ts_set_single_owner(
+  obj_hash_table_uint64_t *const hashtblP,
+  const bool single_owner)
 {
-  hash_size_t n;
-  obj_hash_node_uint64_t *node, *oldnode;
-
-  for (n = 0; n < hashtblP->size; ++n) {
-    node = hashtblP->nodes[n];
-
-    while (node) {
-      oldnode = node;
-      node = node->next;
-      hashtblP->freekeyfunc(&oldnode->key);
-      free_wrapper((void **) &oldnode);
-    }
+  if (hashtblP) {
+    hashtblP->single_owner = single_owner;
   }
-
-  free_wrapper((void **) &hashtblP->nodes);
-  bdestroy_wrapper(&hashtblP->name);
-  free_wrapper((void **) &hashtblP);
-  return HASH_TABLE_OK;
 }
 
 //------------------------------------------------------------------------------
 /*
    Cleanup
-   The hashtable_destroy() walks through the linked lists for each possible hash value, and releases the elements. It also releases the nodes array and the obj_hash_table_uint64_t.
+   The obj_hashtable_uint64_destroy() walks through the slots, and releases the keys. It also releases the slots array and the obj_hash_table_uint64_t.
 */
-hashtable_rc_t obj_hashtable_uint64_ts_destroy(
+hashtable_rc_t obj_hashtable_uint64_destroy(
   obj_hash_table_uint64_t *const hashtblP)
 {
-  hash_size_t n;
-  obj_hash_node_uint64_t *node, *oldnode;
-
-  for (n = 0; n < hashtblP->size; ++n) {
-    pthread_mutex_lock(&hashtblP->lock_nodes[n]);
-    node = hashtblP->nodes[n];
+  if (!hashtblP) {
+    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
+  }
 
-    while (node) {
-      oldnode = node;
-      node = node->next;
-      hashtblP->freekeyfunc(&oldnode->key);
-      free_wrapper((void **) &oldnode);
-    }
-    pthread_mutex_unlock(&hashtblP->lock_nodes[n]);
-    pthread_mutex_destroy(&hashtblP->lock_nodes[n]);
+  HASH_SLOTS_WRLOCK(hashtblP);
+  HASH_SLOTS_FOREACH(&hashtblP->table, slot)
+  {
+    void *key = OBJ_HASHTABLE_KEY(slot);
+    hashtblP->freekeyfunc(&key);
   }
+  hash_slots_release(&hashtblP->table);
+  HASH_SLOTS_UNLOCK(hashtblP);
+  pthread_rwlock_destroy(&hashtblP->lock);
 
-  free_wrapper((void **) &hashtblP->nodes);
-  free_wrapper((void **) &hashtblP->lock_nodes);
   bdestroy_wrapper(&hashtblP->name);
   free_wrapper((void **) &hashtblP);
   return HASH_TABLE_OK;
 }
 
+//------------------------------------------------------------------------------
+hashtable_rc_t obj_hashtable_uint64_ts_destroy(
+  obj_hash_table_uint64_t *const hashtblP)
+{
+  return obj_hashtable_uint64_destroy(hashtblP);
+}
+
 //------------------------------------------------------------------------------
 hashtable_rc_t obj_hashtable_uint64_is_key_exists(
   const obj_hash_table_uint64_t *const hashtblP,
   const void *const keyP,
   const int key_sizeP)
 {
-  obj_hash_node_uint64_t *node;
-  hash_size_t hash;
+  hash_slot_t *slot = NULL;
 
   if (hashtblP == NULL) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  if (keyP == NULL) {
+  if (!obj_hashtable_uint64_valid_key(keyP, key_sizeP)) {
     PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
     return HASH_TABLE_BAD_PARAMETER_KEY;
   }
 
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p klen %u) hash %lx return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        key_sizeP,
-        hash);
-      return HASH_TABLE_OK;
-    } else if (node->key_size == key_sizeP) {
-      if (memcmp(node->key, keyP, key_sizeP) == 0) {
-        PRINT_HASHTABLE(
-          hashtblP,
-          "%s(%s,key %p klen %u) hash %lx return OK\n",
-          __FUNCTION__,
-          bdata(hashtblP->name),
-          keyP,
-          key_sizeP,
-          hash);
-        return HASH_TABLE_OK;
-      }
-    }
+  const uint64_t hash = obj_hashtable_uint64_hash(hashtblP, keyP, key_sizeP);
+  HASH_SLOTS_RDLOCK(hashtblP);
+  slot = hash_slots_find(
+    &hashtblP->table, hash, (hash_key_t)(uintptr_t) keyP, key_sizeP);
+  HASH_SLOTS_UNLOCK(hashtblP);
 
-    node = node->next;
+  if (slot) {
+    PRINT_HASHTABLE(
+      hashtblP,
+      "%s(%s,key %p klen %u) return OK\n",
+      __FUNCTION__,
+      bdata(hashtblP->name),
+      keyP,
+      key_sizeP);
+    return HASH_TABLE_OK;
   }
-
   PRINT_HASHTABLE(
     hashtblP,
-    "%s(%s,key %p klen %u) hash %lx return KEY_NOT_EXISTS\n",
+    "%s(%s,key %p klen %u) return KEY_NOT_EXISTS\n",
     __FUNCTION__,
     bdata(hashtblP->name),
     keyP,
-    key_sizeP,
-    hash);
+    key_sizeP);
   return HASH_TABLE_KEY_NOT_EXISTS;
 }
+
 //------------------------------------------------------------------------------
 hashtable_rc_t obj_hashtable_uint64_ts_is_key_exists(
   const obj_hash_table_uint64_t *const hashtblP,
   const void *const keyP,
   const int key_sizeP)
 {
-  obj_hash_node_uint64_t *node;
-  hash_size_t hash;
-
-  if (hashtblP == NULL) {
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-
-  if (keyP == NULL) {
-    PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
-    return HASH_TABLE_BAD_PARAMETER_KEY;
-  }
-
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  pthread_mutex_lock(&hashtblP->lock_nodes[hash]);
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p klen %u) hash %lx return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        key_sizeP,
-        hash);
-      return HASH_TABLE_OK;
-    } else if (node->key_size == key_sizeP) {
-      if (memcmp(node->key, keyP, key_sizeP) == 0) {
-        pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-        PRINT_HASHTABLE(
-          hashtblP,
-          "%s(%s,key %p klen %u) hash %lx return OK\n",
-          __FUNCTION__,
-          bdata(hashtblP->name),
-          keyP,
-          key_sizeP,
-          hash);
-        return HASH_TABLE_OK;
-      }
-    }
-
-    node = node->next;
-  }
-  pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-
-  PRINT_HASHTABLE(
-    hashtblP,
-    "%s(%s,key %p klen %u) hash %lx return KEY_NOT_EXISTS\n",
-    __FUNCTION__,
-    bdata(hashtblP->name),
-    keyP,
-    key_sizeP,
-    hash);
-  return HASH_TABLE_KEY_NOT_EXISTS;
+  return obj_hashtable_uint64_is_key_exists(hashtblP, keyP, key_sizeP);
 }
 
 //------------------------------------------------------------------------------
@@ -451,83 +300,39 @@ hashtable_rc_t obj_hashtable_uint64_dump_content(
   const obj_hash_table_uint64_t *const hashtblP,
   bstring str)
 {
-  obj_hash_node_uint64_t *node = NULL;
-  unsigned int i = 0;
-
-  if (hashtblP == NULL) {
+  if (!hashtblP) {
     bcatcstr(str, "HASH_TABLE_BAD_PARAMETER_HASHTABLE");
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  while (i < hashtblP->size) {
-    if (hashtblP->nodes[i] != NULL) {
-      node = hashtblP->nodes[i];
-
-      while (node) {
-        bstring b0 = bformat(
-          "Hash %x Key %p Key length %d Element %" PRIx64 "\n",
-          i,
-          node->key,
-          node->key_size,
-          node->data);
-        if (!b0) {
-          PRINT_HASHTABLE(hashtblP, "Error while dumping hashtable content");
-        } else {
-          bconcat(str, b0);
-          bdestroy_wrapper(&b0);
-        }
-        node = node->next;
-      }
-    }
-    i += 1;
+  HASH_SLOTS_RDLOCK(hashtblP);
+  HASH_SLOTS_FOREACH(&hashtblP->table, slot)
+  {
+    bformata(
+      str,
+      "Hash %zu Key %p Key length %u Element %" PRIx64 "\n",
+      (size_t)(slot - hashtblP->table.slots),
+      OBJ_HASHTABLE_KEY(slot),
+      slot->key_size,
+      slot->data.uint64);
   }
-
+  HASH_SLOTS_UNLOCK(hashtblP);
   return HASH_TABLE_OK;
 }
+
 //------------------------------------------------------------------------------
 hashtable_rc_t obj_hashtable_uint64_ts_dump_content(
   const obj_hash_table_uint64_t *const hashtblP,
   bstring str)
 {
-  obj_hash_node_uint64_t *node = NULL;
-  unsigned int i = 0;
-
-  if (hashtblP == NULL) {
-    bcatcstr(str, "HASH_TABLE_BAD_PARAMETER_HASHTABLE");
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-
-  while (i < hashtblP->size) {
-    if (hashtblP->nodes[i] != NULL) {
-      pthread_mutex_lock(&hashtblP->lock_nodes[i]);
-      node = hashtblP->nodes[i];
-
-      while (node) {
-        bstring b0 = bformat(
-          "Hash %x Key %p Key length %d Element %" PRIx64 "\n",
-          i,
-          node->key,
-          node->key_size,
-          node->data);
-        if (!b0) {
-          PRINT_HASHTABLE(hashtblP, "Error while dumping hashtable content");
-        } else {
-          bconcat(str, b0);
-          bdestroy_wrapper(&b0);
-        }
-        node = node->next;
-      }
-      pthread_mutex_unlock(&hashtblP->lock_nodes[i]);
-    }
-    i += 1;
-  }
-  return HASH_TABLE_OK;
+  return obj_hashtable_uint64_dump_content(hashtblP, str);
 }
 
 //------------------------------------------------------------------------------
 /*
    Adding a new element
-   To make sure the hash value is not bigger than size, the result of the user provided hash function is used modulo size.
+   The key is copied in the table, an existing key keeps its copy and gets its
+   value replaced.
 */
 hashtable_rc_t obj_hashtable_uint64_insert(
   obj_hash_table_uint64_t *const hashtblP,
@@ -535,428 +340,149 @@ hashtable_rc_t obj_hashtable_uint64_insert(
   const int key_sizeP,
   const uint64_t dataP)
 {
-  obj_hash_node_uint64_t *node;
-  hash_size_t hash;
+  hashtable_rc_t rc = HASH_TABLE_OK;
+  hash_slot_t *slot = NULL;
+  void *key = NULL;
 
   if (hashtblP == NULL) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  if (keyP == NULL) {
+  if (!obj_hashtable_uint64_valid_key(keyP, key_sizeP)) {
     PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
     return HASH_TABLE_BAD_PARAMETER_KEY;
   }
 
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      node->data = dataP;
-      node->key_size = key_sizeP;
-      // waste of memory here (keyP is lost) we should free_wrapper it now
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p data %" PRIx64
-        ") hash %lx return INSERT_OVERWRITTEN_DATA\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        dataP,
-        hash);
-      return HASH_TABLE_INSERT_OVERWRITTEN_DATA;
-    }
-
-    node = node->next;
-  }
-
-  if (!(node = malloc(sizeof(obj_hash_node_uint64_t)))) {
-    PRINT_HASHTABLE(
-      hashtblP,
-      "%s(%s,key %p) hash %lx return SYSTEM_ERROR\n",
-      __FUNCTION__,
-      bdata(hashtblP->name),
-      keyP,
-      hash);
-    return HASH_TABLE_SYSTEM_ERROR;
-  }
-
-  if (!(node->key = malloc(key_sizeP))) {
-    PRINT_HASHTABLE(
-      hashtblP,
-      "%s(%s,key %p) hash %lx return SYSTEM_ERROR\n",
-      __FUNCTION__,
-      bdata(hashtblP->name),
-      keyP,
-      hash);
-    free_wrapper((void **) &node);
-    return -1;
-  }
-
-  memcpy(node->key, keyP, key_sizeP);
-  node->data = dataP;
-  node->key_size = key_sizeP;
-
-  if (hashtblP->nodes[hash]) {
-    node->next = hashtblP->nodes[hash];
+  const uint64_t hash = obj_hashtable_uint64_hash(hashtblP, keyP, key_sizeP);
+  HASH_SLOTS_WRLOCK(hashtblP);
+  slot = hash_slots_find(
+    &hashtblP->table, hash, (hash_key_t)(uintptr_t) keyP, key_sizeP);
+  if (slot) {
+    slot->data.uint64 = dataP;
+    rc = HASH_TABLE_INSERT_OVERWRITTEN_DATA;
+  } else if (!(key = malloc(key_sizeP))) {
+    rc = HASH_TABLE_SYSTEM_ERROR;
   } else {
-    node->next = NULL;
+    memcpy(key, keyP, key_sizeP);
+    slot = hash_slots_insert(
+      &hashtblP->table, hash, (hash_key_t)(uintptr_t) key, key_sizeP);
+    if (slot) {
+      slot->data.uint64 = dataP;
+    } else {
+      free_wrapper(&key);
+      rc = HASH_TABLE_SYSTEM_ERROR;
+    }
   }
+  HASH_SLOTS_UNLOCK(hashtblP);
 
-  hashtblP->nodes[hash] = node;
-  __sync_fetch_and_add(&hashtblP->num_elements, 1);
   PRINT_HASHTABLE(
     hashtblP,
-    "%s(%s,key %p klen %u data %" PRIx64 ") hash %lx return OK\n",
+    "%s(%s,key %p klen %u data %" PRIx64 ") hash %lx return %s\n",
     __FUNCTION__,
     bdata(hashtblP->name),
     keyP,
     key_sizeP,
     dataP,
-    hash);
-  return HASH_TABLE_OK;
+    hash,
+    hashtable_rc_code2string(rc));
+  return rc;
 }
 
 //------------------------------------------------------------------------------
-/*
-   Adding a new element
-   To make sure the hash value is not bigger than size, the result of the user provided hash function is used modulo size.
-*/
 hashtable_rc_t obj_hashtable_uint64_ts_insert(
   obj_hash_table_uint64_t *const hashtblP,
   const void *const keyP,
   const int key_sizeP,
   const uint64_t dataP)
 {
-  obj_hash_node_uint64_t *node;
-  hash_size_t hash;
+  return obj_hashtable_uint64_insert(hashtblP, keyP, key_sizeP, dataP);
+}
+
+//------------------------------------------------------------------------------
+/*
+   To remove an element from the hash table, we just search for it in the
+   slots, and remove it if it is found, the key copy is freed. If it was not
+   found, HASH_TABLE_KEY_NOT_EXISTS is returned.
+*/
+hashtable_rc_t obj_hashtable_uint64_remove(
+  obj_hash_table_uint64_t *const hashtblP,
+  const void *const keyP,
+  const int key_sizeP)
+{
+  hash_slot_t *slot = NULL;
+  void *key = NULL;
 
   if (hashtblP == NULL) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  if (keyP == NULL) {
+  if (!obj_hashtable_uint64_valid_key(keyP, key_sizeP)) {
     PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
     return HASH_TABLE_BAD_PARAMETER_KEY;
   }
 
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  pthread_mutex_lock(&hashtblP->lock_nodes[hash]);
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      if (node->data != dataP) {
-        node->data = dataP;
-        node->key_size = key_sizeP;
-        // no waste of memory here because if node->key == keyP, it is a reuse of the same key
-        pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-        PRINT_HASHTABLE(
-          hashtblP,
-          "%s(%s,key %p data %p) hash %lx return INSERT_OVERWRITTEN_DATA\n",
-          __FUNCTION__,
-          bdata(hashtblP->name),
-          keyP,
-          dataP,
-          hash);
-        return HASH_TABLE_INSERT_OVERWRITTEN_DATA;
-      }
-      node->data = dataP;
-      pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p data %p) hash %lx return ok\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        dataP,
-        hash);
-      return HASH_TABLE_OK;
-    }
-
-    node = node->next;
-  }
-
-  if (!(node = calloc(1, sizeof(obj_hash_node_uint64_t)))) {
-    pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-    PRINT_HASHTABLE(
-      hashtblP,
-      "%s(%s,key %p) hash %lx return SYSTEM_ERROR\n",
-      __FUNCTION__,
-      bdata(hashtblP->name),
-      keyP,
-      hash);
-    return HASH_TABLE_SYSTEM_ERROR;
-  }
-
-  if (!(node->key = calloc(1, key_sizeP))) {
-    free_wrapper((void **) &node);
-    pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
+  const uint64_t hash = obj_hashtable_uint64_hash(hashtblP, keyP, key_sizeP);
+  HASH_SLOTS_WRLOCK(hashtblP);
+  slot = hash_slots_find(
+    &hashtblP->table, hash, (hash_key_t)(uintptr_t) keyP, key_sizeP);
+  if (!slot) {
+    HASH_SLOTS_UNLOCK(hashtblP);
     PRINT_HASHTABLE(
       hashtblP,
-      "%s(%s,key %p) hash %lx return SYSTEM_ERROR\n",
+      "%s(%s,key %p klen %u) return KEY_NOT_EXISTS\n",
       __FUNCTION__,
       bdata(hashtblP->name),
       keyP,
-      hash);
-    return HASH_TABLE_SYSTEM_ERROR;
-  }
-
-  memcpy(node->key, keyP, key_sizeP);
-  node->data = dataP;
-  node->key_size = key_sizeP;
-
-  if (hashtblP->nodes[hash]) {
-    node->next = hashtblP->nodes[hash];
-  } else {
-    node->next = NULL;
+      key_sizeP);
+    return HASH_TABLE_KEY_NOT_EXISTS;
   }
+  key = OBJ_HASHTABLE_KEY(slot);
+  hashtblP->freekeyfunc(&key);
+  hash_slots_erase(&hashtblP->table, slot);
+  HASH_SLOTS_UNLOCK(hashtblP);
 
-  hashtblP->nodes[hash] = node;
-  __sync_fetch_and_add(&hashtblP->num_elements, 1);
-  pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
   PRINT_HASHTABLE(
     hashtblP,
-    "%s(%s,key %p klen %u data %" PRIx64 ") hash %lx return OK\n",
+    "%s(%s,key %p klen %u) hash %lx return OK\n",
     __FUNCTION__,
     bdata(hashtblP->name),
     keyP,
     key_sizeP,
-    dataP,
     hash);
   return HASH_TABLE_OK;
 }
 
 //------------------------------------------------------------------------------
-/*
-   To remove an element from the hash table, we just search for it in the linked list for that hash value,
-   and remove it if it is found. If it was not found, it is an error and -1 is returned.
-*/
-hashtable_rc_t obj_hashtable_uint64_free(
+hashtable_rc_t obj_hashtable_uint64_ts_remove(
   obj_hash_table_uint64_t *const hashtblP,
   const void *const keyP,
   const int key_sizeP)
 {
-  obj_hash_node_uint64_t *node, *prevnode = NULL;
-  hash_size_t hash;
-
-  if (hashtblP == NULL) {
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-
-  if (keyP == NULL) {
-    PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
-    return HASH_TABLE_BAD_PARAMETER_KEY;
-  }
-
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (
-      (node->key == keyP) || ((node->key_size == key_sizeP) &&
-                              (memcmp(node->key, keyP, key_sizeP) == 0))) {
-      if (prevnode) {
-        prevnode->next = node->next;
-      } else {
-        hashtblP->nodes[hash] = node->next;
-      }
-
-      hashtblP->freekeyfunc(&node->key);
-      free_wrapper((void **) &node);
-      hashtblP->num_elements -= 1;
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p) hash %lx return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        hash);
-      return HASH_TABLE_OK;
-    }
-
-    prevnode = node;
-    node = node->next;
-  }
-
-  return HASH_TABLE_KEY_NOT_EXISTS;
+  return obj_hashtable_uint64_remove(hashtblP, keyP, key_sizeP);
 }
 
 //------------------------------------------------------------------------------
-/*
-   To remove an element from the hash table, we just search for it in the linked list for that hash value,
-   and remove it if it is found. If it was not found, it is an error and -1 is returned.
-*/
-hashtable_rc_t obj_hashtable_uint64_ts_free(
+hashtable_rc_t obj_hashtable_uint64_free(
   obj_hash_table_uint64_t *const hashtblP,
   const void *const keyP,
   const int key_sizeP)
 {
-  obj_hash_node_uint64_t *node, *prevnode = NULL;
-  hash_size_t hash;
-
-  if (hashtblP == NULL) {
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-
-  if (keyP == NULL) {
-    PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
-    return HASH_TABLE_BAD_PARAMETER_KEY;
-  }
-
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  pthread_mutex_lock(&hashtblP->lock_nodes[hash]);
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (
-      (node->key == keyP) || ((node->key_size == key_sizeP) &&
-                              (memcmp(node->key, keyP, key_sizeP) == 0))) {
-      if (prevnode) {
-        prevnode->next = node->next;
-      } else {
-        hashtblP->nodes[hash] = node->next;
-      }
-
-      hashtblP->freekeyfunc(&node->key);
-      free_wrapper((void **) &node);
-      __sync_fetch_and_sub(&hashtblP->num_elements, 1);
-      pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p) hash %lx return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        hash);
-      return HASH_TABLE_OK;
-    }
-
-    prevnode = node;
-    node = node->next;
-  }
-  pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-
-  return HASH_TABLE_KEY_NOT_EXISTS;
+  return obj_hashtable_uint64_remove(hashtblP, keyP, key_sizeP);
 }
 
 //------------------------------------------------------------------------------
-/*
-   To remove an element from the hash table, we just search for it in the linked list for that hash value,
-   and remove it if it is found. If it was not found, it is an error and -1 is returned.
-*/
-hashtable_rc_t obj_hashtable_uint64_remove(
+hashtable_rc_t obj_hashtable_uint64_ts_free(
   obj_hash_table_uint64_t *const hashtblP,
   const void *const keyP,
   const int key_sizeP)
 {
-  obj_hash_node_uint64_t *node, *prevnode = NULL;
-  hash_size_t hash;
-
-  if (hashtblP == NULL) {
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-
-  if (keyP == NULL) {
-    PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
-    return HASH_TABLE_BAD_PARAMETER_KEY;
-  }
-
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (
-      (node->key == keyP) || ((node->key_size == key_sizeP) &&
-                              (memcmp(node->key, keyP, key_sizeP) == 0))) {
-      if (prevnode) {
-        prevnode->next = node->next;
-      } else {
-        hashtblP->nodes[hash] = node->next;
-      }
-
-      hashtblP->freekeyfunc(&node->key);
-      free_wrapper((void **) &node);
-      hashtblP->num_elements -= 1;
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p) hash %lx return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        hash);
-      return HASH_TABLE_OK;
-    }
-
-    prevnode = node;
-    node = node->next;
-  }
-
-  return HASH_TABLE_KEY_NOT_EXISTS;
+  return obj_hashtable_uint64_remove(hashtblP, keyP, key_sizeP);
 }
 
 //------------------------------------------------------------------------------
 /*
-   To remove an element from the hash table, we just search for it in the linked list for that hash value,
-   and remove it if it is found. If it was not found, it is an error and -1 is returned.
-*/
-hashtable_rc_t obj_hashtable_uint64_ts_remove(
-  obj_hash_table_uint64_t *const hashtblP,
-  const void *const keyP,
-  const int key_sizeP)
-{
-  obj_hash_node_uint64_t *node, *prevnode = NULL;
-  hash_size_t hash;
-
-  if (hashtblP == NULL) {
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-
-  if (keyP == NULL) {
-    PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
-    return HASH_TABLE_BAD_PARAMETER_KEY;
-  }
-
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  pthread_mutex_lock(&hashtblP->lock_nodes[hash]);
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (
-      (node->key == keyP) || ((node->key_size == key_sizeP) &&
-                              (memcmp(node->key, keyP, key_sizeP) == 0))) {
-      if (prevnode) {
-        prevnode->next = node->next;
-      } else {
-        hashtblP->nodes[hash] = node->next;
-      }
-
-      hashtblP->freekeyfunc(&node->key);
-      free_wrapper((void **) &node);
-      __sync_fetch_and_sub(&hashtblP->num_elements, 1);
-      pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p) hash %lx return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        hash);
-      return HASH_TABLE_OK;
-    }
-
-    prevnode = node;
-    node = node->next;
-  }
-  pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-
-  return HASH_TABLE_KEY_NOT_EXISTS;
-}
-
-//------------------------------------------------------------------------------
-/*
-   Searching for an element is easy. We just search through the linked list for the corresponding hash value.
-   NULL is returned if we didn't find it.
+   Searching for an element is easy. We just probe the slots from the home slot of the key.
+   dataP is left untouched if we didn't find it.
 */
 hashtable_rc_t obj_hashtable_uint64_get(
   const obj_hash_table_uint64_t *const hashtblP,
@@ -964,206 +490,125 @@ hashtable_rc_t obj_hashtable_uint64_get(
   const int key_sizeP,
   uint64_t *const dataP)
 {
-  obj_hash_node_uint64_t *node;
-  hash_size_t hash;
+  hash_slot_t *slot = NULL;
 
   if (hashtblP == NULL) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  if (keyP == NULL) {
+  if (!obj_hashtable_uint64_valid_key(keyP, key_sizeP)) {
     PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
     return HASH_TABLE_BAD_PARAMETER_KEY;
   }
 
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      *dataP = node->data;
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p data %" PRIx64 ") hash %lx return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        *dataP,
-        hash);
-      return HASH_TABLE_OK;
-    } else if (node->key_size == key_sizeP) {
-      if (memcmp(node->key, keyP, key_sizeP) == 0) {
-        *dataP = node->data;
-        PRINT_HASHTABLE(
-          hashtblP,
-          "%s(%s,key %p data %" PRIx64 ") hash %lx return OK\n",
-          __FUNCTION__,
-          bdata(hashtblP->name),
-          keyP,
-          *dataP,
-          hash);
-        return HASH_TABLE_OK;
-      }
-    }
-
-    node = node->next;
+  const uint64_t hash = obj_hashtable_uint64_hash(hashtblP, keyP, key_sizeP);
+  HASH_SLOTS_RDLOCK(hashtblP);
+  slot = hash_slots_find(
+    &hashtblP->table, hash, (hash_key_t)(uintptr_t) keyP, key_sizeP);
+  if (slot) {
+    *dataP = slot->data.uint64;
   }
+  HASH_SLOTS_UNLOCK(hashtblP);
 
+  if (slot) {
+    PRINT_HASHTABLE(
+      hashtblP,
+      "%s(%s,key %p klen %u data %" PRIx64 ") hash %lx return OK\n",
+      __FUNCTION__,
+      bdata(hashtblP->name),
+      keyP,
+      key_sizeP,
+      *dataP,
+      hash);
+    return HASH_TABLE_OK;
+  }
   PRINT_HASHTABLE(
     hashtblP,
-    "%s(%s,key %p) hash %lx return KEY_NOT_EXISTS\n",
+    "%s(%s,key %p klen %u) hash %lx return KEY_NOT_EXISTS\n",
     __FUNCTION__,
     bdata(hashtblP->name),
     keyP,
+    key_sizeP,
     hash);
   return HASH_TABLE_KEY_NOT_EXISTS;
 }
 
 //------------------------------------------------------------------------------
-/*
-   Searching for an element is easy. We just search through the linked list for the corresponding hash value.
-   NULL is returned if we didn't find it.
-*/
 hashtable_rc_t obj_hashtable_uint64_ts_get(
   const obj_hash_table_uint64_t *const hashtblP,
   const void *const keyP,
   const int key_sizeP,
   uint64_t *const dataP)
 {
-  obj_hash_node_uint64_t *node;
-  hash_size_t hash;
-
-  if (hashtblP == NULL) {
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-
-  if (keyP == NULL) {
-    PRINT_HASHTABLE(hashtblP, "return HASH_TABLE_BAD_PARAMETER_KEY\n");
-    return HASH_TABLE_BAD_PARAMETER_KEY;
-  }
-
-  hash = hashtblP->hashfunc(keyP, key_sizeP) % hashtblP->size;
-  pthread_mutex_lock(&hashtblP->lock_nodes[hash]);
-  node = hashtblP->nodes[hash];
-
-  while (node) {
-    if (node->key == keyP) {
-      *dataP = node->data;
-      pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-      PRINT_HASHTABLE(
-        hashtblP,
-        "%s(%s,key %p klen %u data %" PRIx64 ") hash %lx return OK\n",
-        __FUNCTION__,
-        bdata(hashtblP->name),
-        keyP,
-        key_sizeP,
-        *dataP,
-        hash);
-      return HASH_TABLE_OK;
-    } else if (node->key_size == key_sizeP) {
-      if (memcmp(node->key, keyP, key_sizeP) == 0) {
-        *dataP = node->data;
-        pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-        PRINT_HASHTABLE(
-          hashtblP,
-          "%s(%s,key %p klen %u data %" PRIx64 ") hash %lx return OK\n",
-          __FUNCTION__,
-          bdata(hashtblP->name),
-          keyP,
-          key_sizeP,
-          *dataP,
-          hash);
-        return HASH_TABLE_OK;
-      }
-    }
-
-    node = node->next;
-  }
-
-  pthread_mutex_unlock(&hashtblP->lock_nodes[hash]);
-  PRINT_HASHTABLE(
-    hashtblP,
-    "%s(%s,key %p klen %u) hash %lx return KEY_NOT_EXISTS\n",
-    __FUNCTION__,
-    bdata(hashtblP->name),
-    keyP,
-    key_sizeP,
-    hash);
-  return HASH_TABLE_KEY_NOT_EXISTS;
+  return obj_hashtable_uint64_get(hashtblP, keyP, key_sizeP, dataP);
 }
 
 //------------------------------------------------------------------------------
 /*
    Function to return all keys of an object hash table
+   keysP is an array allocated by the caller, large enough for all the keys of
+   the table, it receives pointers to the keys stored in the table. With a NULL
+   keysP only the number of keys is returned in sizeP.
 */
 hashtable_rc_t obj_hashtable_uint64_get_keys(
   const obj_hash_table_uint64_t *const hashtblP,
   void **keysP,
   unsigned int *sizeP)
 {
-  size_t n = 0;
-  obj_hash_node_uint64_t *node = NULL;
-  obj_hash_node_uint64_t *next = NULL;
-
   if (hashtblP == NULL) {
-    keysP = NULL;
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
-  *sizeP = 0;
-  keysP = calloc(hashtblP->num_elements, sizeof(void *));
-
-  if (keysP) {
-    for (n = 0; n < hashtblP->size; ++n) {
-      for (node = hashtblP->nodes[n]; node; node = next) {
-        keysP[*sizeP++] = node->key;
-        next = node->next;
-      }
+  HASH_SLOTS_RDLOCK(hashtblP);
+  if (!keysP) {
+    *sizeP = hashtblP->table.num_elements;
+  } else {
+    *sizeP = 0;
+    HASH_SLOTS_FOREACH(&hashtblP->table, slot)
+    {
+      keysP[(*sizeP)++] = OBJ_HASHTABLE_KEY(slot);
     }
-
-    PRINT_HASHTABLE(hashtblP, "return OK\n");
-    return HASH_TABLE_OK;
   }
-  PRINT_HASHTABLE(hashtblP, "return SYSTEM_ERROR\n");
-  return HASH_TABLE_SYSTEM_ERROR;
+  HASH_SLOTS_UNLOCK(hashtblP);
+  PRINT_HASHTABLE(hashtblP, "return OK\n");
+  return HASH_TABLE_OK;
 }
 
 //------------------------------------------------------------------------------
 /*
    Function to return all keys of an object hash table
+   The array of keys is allocated by this function and must be freed by the
+   caller, the keys themselves still belong to the table.
 */
 hashtable_rc_t obj_hashtable_uint64_ts_get_keys(
   const obj_hash_table_uint64_t *const hashtblP,
   void ***keysP,
   unsigned int *sizeP)
 {
-  size_t n = 0;
-  obj_hash_node_uint64_t *node = NULL;
-  obj_hash_node_uint64_t *next = NULL;
+  if (!hashtblP) {
+    *keysP = NULL;
+    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
+  }
 
-  if ((!hashtblP) || !(hashtblP->num_elements)) {
+  HASH_SLOTS_RDLOCK(hashtblP);
+  if (!hashtblP->table.num_elements) {
+    HASH_SLOTS_UNLOCK(hashtblP);
     *keysP = NULL;
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
 
   *sizeP = 0;
-  *keysP = calloc(hashtblP->num_elements, sizeof(void *));
-
+  *keysP = calloc(hashtblP->table.num_elements, sizeof(void *));
   if (*keysP) {
-    for (n = 0; n < hashtblP->size; ++n) {
-      pthread_mutex_lock(&hashtblP->lock_nodes[n]);
-      for (node = hashtblP->nodes[n]; node; node = next) {
-        (*keysP)[(*sizeP)++] = node->key;
-        PRINT_HASHTABLE(hashtblP, "At index %u Saving key %p into %p \n",
-            (*sizeP)-1, node->key, *keysP[(*sizeP)-1]);
-        next = node->next;
-      }
-      pthread_mutex_unlock(&hashtblP->lock_nodes[n]);
+    HASH_SLOTS_FOREACH(&hashtblP->table, slot)
+    {
+      (*keysP)[(*sizeP)++] = OBJ_HASHTABLE_KEY(slot);
     }
-
+    HASH_SLOTS_UNLOCK(hashtblP);
     PRINT_HASHTABLE(hashtblP, "return OK\n");
     return HASH_TABLE_OK;
   }
+  HASH_SLOTS_UNLOCK(hashtblP);
   PRINT_HASHTABLE(hashtblP, "return SYSTEM_ERROR\n");
   return HASH_TABLE_SYSTEM_ERROR;
 }
@@ -1171,139 +616,29 @@ hashtable_rc_t obj_hashtable_uint64_ts_get_keys(
 //------------------------------------------------------------------------------
 /*
    Resizing
-   The number of elements in a hash table is not always known when creating the table.
-   If the number of elements grows too large, it will seriously reduce the performance of most hash table operations.
-   If the number of elements are reduced, the hash table will waste memory. That is why we provide a function for resizing the table.
-   Resizing a hash table is not as easy as a realloc(). All hash values must be recalculated and each element must be inserted into its new position.
-   We create a temporary obj_hash_table_uint64_t object (newtbl) to be used while building the new hashes.
-   This allows us to reuse obj_hashtable_uint64_insert() and obj_hashtable_uint64_free(), when moving the elements to the new table.
-   After that, we can just free_wrapper the old table and copy the elements from newtbl to hashtbl.
+   Tables grow automatically when their load factor gets too high, resizing is
+   only useful to reserve room ahead of a known number of insertions, or to
+   give back memory after a lot of removals.
 */
 hashtable_rc_t obj_hashtable_uint64_resize(
   obj_hash_table_uint64_t *const hashtblP,
   const hash_size_t sizeP)
 {
-  obj_hash_table_uint64_t newtbl = {.mutex = PTHREAD_MUTEX_INITIALIZER, 0};
-  hash_size_t n;
-  obj_hash_node_uint64_t *node, *next;
+  bool resized = false;
 
   if (hashtblP == NULL) {
     return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
   }
-  hash_size_t size = sizeP;
-  // upper power of two: http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2Float
-  //  By Sean Eron Anderson
-  // seander@cs.stanford.edu
-  // Individually, the code snippets here are in the public domain (unless
-  // otherwise noted) - feel free to use them however you please.  The aggregate
-  // collection and descriptions are copyright 1997-2005 Sean Eron Anderson. The
-  // code and descriptions are distributed in the hope that they will be useful,
-  // but WITHOUT ANY WARRANTY and without even the implied warranty of
-  // merchantability or fitness for a particular purpose. As of May 5, 2005, all
-  // the code has been tested thoroughly. Thousands of people have read it.
-  // Moreover, Professor Randal Bryant, the Dean of Computer Science at Carnegie
-  // Mellon University, has personally tested almost everything with his Uclid
-  // code verification system.  What he hasn't tested, I have checked against
-  // all possible inputs on a 32-bit machine. To the first person to inform me
-  // of a legitimate bug in the code, I'll pay a bounty of US$10 (by check or
-  // Paypal). If directed to a charity, I'll pay US$20.
-  size--; size |= size >> 1; size |= size >> 2; size |= size >> 4; size |= size
-    >> 8; size |= size >> 16; size++;
-
-  newtbl.size = size;
-  newtbl.hashfunc = hashtblP->hashfunc;
-
-  if (!(newtbl.nodes = calloc(size, sizeof(obj_hash_node_uint64_t *))))
-    return HASH_TABLE_SYSTEM_ERROR;
-
-  for (n = 0; n < hashtblP->size; ++n) {
-    for (node = hashtblP->nodes[n]; node; node = next) {
-      next = node->next;
-      obj_hashtable_uint64_remove(hashtblP, node->key, node->key_size);
-      obj_hashtable_uint64_insert(
-        &newtbl, node->key, node->key_size, node->data);
-    }
-  }
-
-  free_wrapper((void **) &hashtblP->nodes);
-  hashtblP->size = newtbl.size;
-  hashtblP->nodes = newtbl.nodes;
-  PRINT_HASHTABLE(hashtblP, "return OK\n");
-  return HASH_TABLE_OK;
+  HASH_SLOTS_WRLOCK(hashtblP);
+  resized = hash_slots_resize(&hashtblP->table, sizeP);
+  HASH_SLOTS_UNLOCK(hashtblP);
+  return resized ? HASH_TABLE_OK : HASH_TABLE_SYSTEM_ERROR;
 }
 
 //------------------------------------------------------------------------------
-/*
-   Resizing
-   The number of elements in a hash table is not always known when creating the table.
-   If the number of elements grows too large, it will seriously reduce the performance of most hash table operations.
-   If the number of elements are reduced, the hash table will waste memory. That is why we provide a function for resizing the table.
-   Resizing a hash table is not as easy as a realloc(). All hash values must be recalculated and each element must be inserted into its new position.
-   We create a temporary obj_hash_table_uint64_t object (newtbl) to be used while building the new hashes.
-   This allows us to reuse obj_hashtable_uint64_insert() and obj_hashtable_uint64_free(), when moving the elements to the new table.
-   After that, we can just free_wrapper the old table and copy the elements from newtbl to hashtbl.
-*/
 hashtable_rc_t obj_hashtable_uint64_ts_resize(
   obj_hash_table_uint64_t *const hashtblP,
   const hash_size_t sizeP)
 {
-  obj_hash_table_uint64_t newtbl = {.mutex = PTHREAD_MUTEX_INITIALIZER, 0};
-  hash_size_t n;
-  obj_hash_node_uint64_t *node, *next;
-
-  if (hashtblP == NULL) {
-    return HASH_TABLE_BAD_PARAMETER_HASHTABLE;
-  }
-  hash_size_t size = sizeP;
-  // upper power of two: http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2Float
-  //  By Sean Eron Anderson
-  // seander@cs.stanford.edu
-  // Individually, the code snippets here are in the public domain (unless
-  // otherwise noted) - feel free to use them however you please.  The aggregate
-  // collection and descriptions are copyright 1997-2005 Sean Eron Anderson. The
-  // code and descriptions are distributed in the hope that they will be useful,
-  // but WITHOUT ANY WARRANTY and without even the implied warranty of
-  // merchantability or fitness for a particular purpose. As of May 5, 2005, all
-  // the code has been tested thoroughly. Thousands of people have read it.
-  // Moreover, Professor Randal Bryant, the Dean of Computer Science at Carnegie
-  // Mellon University, has personally tested almost everything with his Uclid
-  // code verification system.  What he hasn't tested, I have checked against
-  // all possible inputs on a 32-bit machine. To the first person to inform me
-  // of a legitimate bug in the code, I'll pay a bounty of US$10 (by check or
-  // Paypal). If directed to a charity, I'll pay US$20.
-  size--; size |= size >> 1; size |= size >> 2; size |= size >> 4; size |= size
-    >> 8; size |= size >> 16; size++;
-
-  newtbl.size = size;
-  newtbl.hashfunc = hashtblP->hashfunc;
-
-  if (!(newtbl.nodes = calloc(size, sizeof(obj_hash_node_uint64_t *))))
-    return HASH_TABLE_SYSTEM_ERROR;
-
-  if (!(newtbl.lock_nodes = calloc(size, sizeof(pthread_mutex_t)))) {
-    free_wrapper((void **) &newtbl.nodes);
-    return HASH_TABLE_SYSTEM_ERROR;
-  }
-  for (n = 0; n < hashtblP->size; ++n) {
-    pthread_mutex_init(&newtbl.lock_nodes[n], NULL);
-  }
-
-  pthread_mutex_lock(&hashtblP->mutex);
-  for (n = 0; n < hashtblP->size; ++n) {
-    for (node = hashtblP->nodes[n]; node; node = next) {
-      next = node->next;
-      obj_hashtable_uint64_ts_remove(hashtblP, node->key, node->key_size);
-      obj_hashtable_uint64_insert(
-        &newtbl, node->key, node->key_size, node->data);
-    }
-  }
-
-  free_wrapper((void **) &hashtblP->nodes);
-  free_wrapper((void **) &hashtblP->nodes);
-  hashtblP->size = newtbl.size;
-  hashtblP->nodes = newtbl.nodes;
-  hashtblP->lock_nodes = newtbl.lock_nodes;
-  pthread_mutex_unlock(&hashtblP->mutex);
-  PRINT_HASHTABLE(hashtblP, "return OK\n");
-  return HASH_TABLE_OK;
+  return obj_hashtable_uint64_resize(hashtblP, sizeP);
 }
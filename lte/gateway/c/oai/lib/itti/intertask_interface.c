@@ -89,13 +89,33 @@ typedef volatile enum task_state_s {
   TASK_STATE_MAX,
 } task_state_t;
 
-/* This list acts as a FIFO of messages received by tasks (RRC, NAS, ...) */
-typedef struct message_list_s {
-  MessageDef *msg; ///< Pointer to the message
+/* Messages with at least this priority overtake the others in task queues */
+#define ITTI_HIGH_PRIORITY_MIN MESSAGE_PRIORITY_MAX_LEAST
 
-  message_number_t message_number; ///< Unique message number
-  uint32_t message_priority;       ///< Message priority
-} message_list_t;
+typedef enum message_queue_lane_e {
+  MESSAGE_QUEUE_LANE_HIGH = 0,
+  MESSAGE_QUEUE_LANE_NORMAL,
+  MESSAGE_QUEUE_LANE_MAX,
+} message_queue_lane_t;
+
+/*
+ * FIFO of messages received by a task, many senders and a single receiver.
+ * Messages are linked through their header so that sending does not allocate
+ * (intrusive MPSC queue of D. Vyukov). A message pushed by a sender still
+ * between its two steps hides the messages pushed after it for a while.
+ */
+typedef struct message_queue_s {
+  /* Last message pushed, shared by the senders */
+  MessageHeader *tail
+    __attribute__((aligned(LFDS710_PAL_ATOMIC_ISOLATION_IN_BYTES)));
+  /* Next message to pop, only accessed by the receiver */
+  MessageHeader *head
+    __attribute__((aligned(LFDS710_PAL_ATOMIC_ISOLATION_IN_BYTES)));
+  /* Messages sent and not received yet, at most ITTI_QUEUE_MAX_ELEMENTS */
+  uint32_t length
+    __attribute__((aligned(LFDS710_PAL_ATOMIC_ISOLATION_IN_BYTES)));
+  MessageHeader stub;
+} message_queue_t;
 
 typedef struct thread_desc_s {
   /*
@@ -112,15 +132,24 @@ typedef struct thread_desc_s {
    * The thread fd
    */
   int task_event_fd;
+
+  /*
+   * If set, senders only write task_event_fd when consumer_waiting is set
+   */
+  bool coalesce_wakeups;
+
+  /*
+   * Set by the consumer before blocking on task_event_fd, cleared by the
+   * first sender that wakes it up
+   */
+  volatile uint32_t consumer_waiting;
 } thread_desc_t;
 
 typedef struct task_desc_s {
   /*
-   * Queue of messages belonging to the task
+   * Queues of messages belonging to the task, by priority
    */
-  struct lfds710_queue_bmm_state message_queue
-    __attribute__((aligned(LFDS710_PAL_ATOMIC_ISOLATION_IN_BYTES)));
-  struct lfds710_queue_bmm_element *qbmme;
+  message_queue_t message_queues[MESSAGE_QUEUE_LANE_MAX];
 } task_desc_t;
 
 typedef struct itti_desc_s {
@@ -152,6 +181,18 @@ typedef struct itti_desc_s {
 
 static itti_desc_t itti_desc;
 
+/* Message pools until itti_configure_memory_pools is called */
+static const memory_pool_config_t itti_default_memory_pools[] = {
+  {1000 + ITTI_QUEUE_MAX_ELEMENTS, 50},
+  {1000 + (2 * ITTI_QUEUE_MAX_ELEMENTS), 100},
+  {10000, 1000},
+  {400, 20050},
+  {100, 30050},
+};
+
+#define ITTI_DEFAULT_MEMORY_POOLS_NUMBER                                       \
+  (sizeof(itti_default_memory_pools) / sizeof(itti_default_memory_pools[0]))
+
 /** \brief Alloc and memset(0) a new itti message.
  * \param origin_task_id Task ID of the sending task
  * \param message_id Message ID
@@ -217,6 +258,97 @@ static inline message_number_t itti_increment_message_number(void)
   return __sync_fetch_and_add(&itti_desc.message_number, 1);
 }
 
+static inline bool itti_wakeup_needed(thread_id_t thread_id)
+{
+  thread_desc_t *thread = &itti_desc.threads[thread_id];
+
+  if (!thread->coalesce_wakeups) {
+    return true;
+  }
+  /*
+   * Only the first sender after the consumer went to sleep writes the fd
+   */
+  return __atomic_exchange_n(&thread->consumer_waiting, 0, __ATOMIC_SEQ_CST) !=
+         0;
+}
+
+static void message_queue_init(message_queue_t *queue)
+{
+  queue->stub.ittiNext = NULL;
+  queue->head = &queue->stub;
+  queue->tail = &queue->stub;
+  queue->length = 0;
+}
+
+/*
+ * Take a place in the queue for a message to push
+ * @returns false if the queue already holds ITTI_QUEUE_MAX_ELEMENTS messages
+ */
+static bool message_queue_reserve(message_queue_t *queue)
+{
+  if (
+    __atomic_add_fetch(&queue->length, 1, __ATOMIC_RELAXED) >
+    ITTI_QUEUE_MAX_ELEMENTS) {
+    __atomic_sub_fetch(&queue->length, 1, __ATOMIC_RELAXED);
+    return false;
+  }
+
+  return true;
+}
+
+static void message_queue_push(message_queue_t *queue, MessageHeader *header)
+{
+  MessageHeader *prev;
+
+  __atomic_store_n(&header->ittiNext, NULL, __ATOMIC_RELAXED);
+  prev = __atomic_exchange_n(&queue->tail, header, __ATOMIC_ACQ_REL);
+  /*
+   * Until this store, the receiver can not reach header and those after it
+   */
+  __atomic_store_n(&prev->ittiNext, header, __ATOMIC_RELEASE);
+}
+
+/*
+ * @returns the oldest message, NULL if the queue is empty or its oldest
+ * message is not linked yet
+ */
+static MessageHeader *message_queue_pop(message_queue_t *queue)
+{
+  MessageHeader *head = queue->head;
+  MessageHeader *next = __atomic_load_n(&head->ittiNext, __ATOMIC_ACQUIRE);
+
+  if (head == &queue->stub) {
+    if (next == NULL) {
+      return NULL;
+    }
+    queue->head = next;
+    head = next;
+    next = __atomic_load_n(&head->ittiNext, __ATOMIC_ACQUIRE);
+  }
+
+  if (next != NULL) {
+    queue->head = next;
+    return head;
+  }
+
+  if (head != __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE)) {
+    return NULL;
+  }
+
+  /*
+   * Last message of the queue, push the stub back behind it to detach it
+   */
+  message_queue_push(queue, &queue->stub);
+  next = __atomic_load_n(&head->ittiNext, __ATOMIC_ACQUIRE);
+
+  if (next != NULL) {
+    queue->head = next;
+    return head;
+  }
+
+  return NULL;
+}
+
 static inline uint32_t itti_get_message_priority(MessagesIds message_id)
 {
   AssertFatal(
@@ -370,8 +502,9 @@ int itti_send_msg_to_task(
 {
   thread_id_t destination_thread_id;
   task_id_t origin_task_id;
-  message_list_t *new;
   uint32_t priority;
+  message_queue_lane_t lane;
+  message_queue_t *queue;
   message_number_t message_number;
   uint32_t message_id;
 
@@ -430,27 +563,37 @@ int itti_send_msg_to_task(
         itti_desc.tasks_info[destination_thread_id].name,
         destination_thread_id,
         itti_desc.threads[destination_thread_id].task_state);
-      /*
-       * Allocate new list element
-       */
-      new = (message_list_t *) itti_malloc(
-        origin_task_id, destination_task_id, sizeof(struct message_list_s));
-      /*
-       * Fill in members
-       */
-      new->msg = message;
-      new->message_number = message_number;
-      new->message_priority = priority;
+      message->ittiMsgHeader.ittiMsgNumber = message_number;
+      message->ittiMsgHeader.ittiMsgPriority = priority;
+      lane = (priority >= ITTI_HIGH_PRIORITY_MIN) ? MESSAGE_QUEUE_LANE_HIGH :
+                                                    MESSAGE_QUEUE_LANE_NORMAL;
+      queue = &itti_desc.tasks[destination_task_id].message_queues[lane];
+
+      if (!message_queue_reserve(queue)) {
+        OAILOG_ERROR(
+          LOG_ITTI,
+          " Message %s, number %lu can not be sent from %s to queue (%u:%s), "
+          "the queue is full!\n",
+          itti_desc.messages_info[message_id].name,
+          message_number,
+          itti_get_task_name(origin_task_id),
+          destination_task_id,
+          itti_get_task_name(destination_task_id));
+        itti_free(origin_task_id, message);
+        return -1;
+      }
+
       /*
        * Enqueue message in destination task queue
        */
-      lfds710_queue_bmm_enqueue(
-        &itti_desc.tasks[destination_task_id].message_queue, NULL, new);
+      message_queue_push(queue, (MessageHeader *) message);
 
       /*
         * Only use event fd for tasks, subtasks will pool the queue
         */
-      if (TASK_GET_PARENT_TASK_ID(destination_task_id) == TASK_UNKNOWN) {
+      if (
+        TASK_GET_PARENT_TASK_ID(destination_task_id) == TASK_UNKNOWN &&
+        itti_wakeup_needed(destination_thread_id)) {
         ssize_t write_ret;
         eventfd_t sem_counter = 1;
 
@@ -490,23 +633,11 @@ int itti_send_msg_to_task(
   return 0;
 }
 
-void itti_receive_msg(task_id_t task_id, MessageDef **received_msg)
+static eventfd_t itti_wait_events(thread_id_t thread_id)
 {
-  thread_id_t thread_id;
-  struct message_list_s *message = NULL;
   eventfd_t sem_counter;
   ssize_t n_read;
 
-  AssertFatal(
-    task_id < itti_desc.task_max,
-    "Task id (%d) is out of range (%d)!\n",
-    task_id,
-    itti_desc.task_max);
-  AssertFatal(received_msg != NULL, "Received message is NULL!\n");
-
-  thread_id = TASK_GET_THREAD_ID(task_id);
-  *received_msg = NULL;
-
   n_read = read(
     itti_desc.threads[thread_id].task_event_fd,
     &sem_counter,
@@ -518,21 +649,160 @@ void itti_receive_msg(task_id_t task_id, MessageDef **received_msg)
     n_read,
     sizeof(sem_counter));
 
-  if (
-    lfds710_queue_bmm_dequeue(
-      &itti_desc.tasks[task_id].message_queue, NULL, (void **) &message) == 0) {
-    OAILOG_WARNING(LOG_ITTI,
-      "No message in queue for task %d while there are %zu and some "
-      "for the messages queue!\n",
-      task_id,
-      sem_counter);
+  return sem_counter;
+}
+
+static size_t itti_dequeue_msgs(
+  task_id_t task_id,
+  MessageDef **received_msgs,
+  size_t max_msgs)
+{
+  MessageHeader *header;
+  message_queue_t *queue;
+  size_t n_msgs = 0;
+  size_t lane_msgs;
+  int lane;
+
+  /*
+   * High priority messages first
+   */
+  for (lane = 0; lane < MESSAGE_QUEUE_LANE_MAX; lane++) {
+    queue = &itti_desc.tasks[task_id].message_queues[lane];
+    lane_msgs = n_msgs;
+    while (n_msgs < max_msgs && (header = message_queue_pop(queue)) != NULL) {
+      received_msgs[n_msgs++] = (MessageDef *) header;
+    }
+    lane_msgs = n_msgs - lane_msgs;
+    if (lane_msgs > 0) {
+      __atomic_sub_fetch(&queue->length, lane_msgs, __ATOMIC_RELAXED);
+    }
   }
 
-  AssertFatal(message != NULL, "Message from message queue is NULL!\n");
+  return n_msgs;
+}
+
+size_t itti_receive_msg_batch(
+  task_id_t task_id,
+  MessageDef **received_msgs,
+  size_t max_msgs)
+{
+  thread_id_t thread_id;
+  thread_desc_t *thread;
+  size_t n_msgs = 0;
 
-  *received_msg = message->msg;
+  AssertFatal(
+    task_id < itti_desc.task_max,
+    "Task id (%d) is out of range (%d)!\n",
+    task_id,
+    itti_desc.task_max);
+  AssertFatal(received_msgs != NULL, "Received message array is NULL!\n");
+  AssertFatal(max_msgs > 0, "Cannot receive an empty batch!\n");
 
-  itti_free(ITTI_MSG_ORIGIN_ID(message->msg), message);
+  thread_id = TASK_GET_THREAD_ID(task_id);
+  thread = &itti_desc.threads[thread_id];
+
+  if (thread->coalesce_wakeups) {
+    /*
+     * Drain what is already queued, only sleep on the eventfd once the
+     * queue has been seen empty after advertising that we are waiting.
+     */
+    while ((n_msgs = itti_dequeue_msgs(task_id, received_msgs, max_msgs)) ==
+           0) {
+      __atomic_store_n(&thread->consumer_waiting, 1, __ATOMIC_SEQ_CST);
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+      n_msgs = itti_dequeue_msgs(task_id, received_msgs, max_msgs);
+      if (n_msgs > 0) {
+        __atomic_store_n(&thread->consumer_waiting, 0, __ATOMIC_SEQ_CST);
+        break;
+      }
+      itti_wait_events(thread_id);
+      __atomic_store_n(&thread->consumer_waiting, 0, __ATOMIC_SEQ_CST);
+    }
+    return n_msgs;
+  }
+
+  /*
+   * The eventfd only tells that messages were sent since the last read: a
+   * message can be received before its event is read, and a message whose
+   * event was read can still be hidden by a sender that did not link its own
+   * one yet. Sleep only when nothing can be dequeued.
+   */
+  while ((n_msgs = itti_dequeue_msgs(task_id, received_msgs, max_msgs)) == 0) {
+    itti_wait_events(thread_id);
+  }
+
+  return n_msgs;
+}
+
+void itti_receive_msg(task_id_t task_id, MessageDef **received_msg)
+{
+  AssertFatal(received_msg != NULL, "Received message is NULL!\n");
+
+  *received_msg = NULL;
+  itti_receive_msg_batch(task_id, received_msg, 1);
+}
+
+void itti_configure_memory_pools(
+  const memory_pool_config_t *pools,
+  uint32_t pools_number,
+  bool growth)
+{
+  uint32_t i;
+
+  AssertFatal(
+    ITTI_DEFAULT_MEMORY_POOLS_NUMBER + pools_number <= MEMORY_POOLS_MAX_NUMBER,
+    "Too many memory pools configured (%u/%u)!\n",
+    pools_number,
+    (uint32_t)(MEMORY_POOLS_MAX_NUMBER - ITTI_DEFAULT_MEMORY_POOLS_NUMBER));
+
+  if (pools_number > 0) {
+    /*
+     * The configured pools are in use before the default ones are retired,
+     * tasks already running always find a pool
+     */
+    for (i = 0; i < pools_number; i++) {
+      memory_pools_add_pool(
+        itti_desc.memory_pools_handle,
+        pools[i].items_number,
+        pools[i].item_size);
+    }
+    memory_pools_retire_pools(
+      itti_desc.memory_pools_handle, ITTI_DEFAULT_MEMORY_POOLS_NUMBER);
+  }
+
+  memory_pools_set_growth(itti_desc.memory_pools_handle, growth);
+  {
+    char *statistics = memory_pools_statistics(itti_desc.memory_pools_handle);
+
+    OAILOG_INFO(LOG_ITTI, " Memory pools statistics:\n%s", statistics);
+    free_wrapper((void **) &statistics);
+  }
+}
+
+uint32_t itti_get_memory_pools_statistics(
+  memory_pool_statistics_t *statistics,
+  uint32_t statistics_number)
+{
+  return memory_pools_get_statistics(
+    itti_desc.memory_pools_handle, statistics, statistics_number);
+}
+
+void itti_set_wakeup_coalescing(task_id_t task_id, bool enable)
+{
+  thread_id_t thread_id = TASK_GET_THREAD_ID(task_id);
+
+  AssertFatal(
+    thread_id < itti_desc.thread_max,
+    "Thread id (%d) is out of range (%d)!\n",
+    thread_id,
+    itti_desc.thread_max);
+  AssertFatal(
+    itti_desc.threads[thread_id].task_state != TASK_STATE_READY,
+    "Wakeup coalescing of task %s must be set before it is ready!\n",
+    itti_get_task_name(task_id));
+
+  itti_desc.threads[thread_id].coalesce_wakeups = enable;
+  itti_desc.threads[thread_id].consumer_waiting = 0;
 }
 
 int itti_create_task(
@@ -625,6 +895,7 @@ int itti_init(
 {
   task_id_t task_id;
   thread_id_t thread_id;
+  uint32_t i;
 
   itti_desc.message_number = 1;
   ITTI_DEBUG(
@@ -670,22 +941,9 @@ int itti_init(
       itti_desc.tasks_info[task_id].parent_task != TASK_UNKNOWN ?
         itti_get_task_name(itti_desc.tasks_info[task_id].parent_task) :
         "");
-    ITTI_DEBUG(
-      ITTI_DEBUG_INIT,
-      " Creating queue of message of size %u\n",
-      itti_desc.tasks_info[task_id].queue_size);
-    printf(
-      " Creating queue of message of size %u\n",
-      itti_desc.tasks_info[task_id].queue_size);
-
-    itti_desc.tasks[task_id].qbmme = calloc(
-      itti_desc.tasks_info[task_id].queue_size,
-      sizeof(struct lfds710_queue_bmm_element));
-    lfds710_queue_bmm_init_valid_on_current_logical_core(
-      &itti_desc.tasks[task_id].message_queue,
-      itti_desc.tasks[task_id].qbmme,
-      itti_desc.tasks_info[task_id].queue_size,
-      NULL);
+    for (i = 0; i < MESSAGE_QUEUE_LANE_MAX; i++) {
+      message_queue_init(&itti_desc.tasks[task_id].message_queues[i]);
+    }
   }
 
   /*
@@ -695,7 +953,9 @@ int itti_init(
        thread_id++) {
     itti_desc.threads[thread_id].task_state = TASK_STATE_NOT_CONFIGURED;
 
-    itti_desc.threads[thread_id].task_event_fd = eventfd(0, EFD_SEMAPHORE);
+    itti_desc.threads[thread_id].task_event_fd = eventfd(0, 0);
+    itti_desc.threads[thread_id].coalesce_wakeups = false;
+    itti_desc.threads[thread_id].consumer_waiting = 0;
 
     if (itti_desc.threads[thread_id].task_event_fd == -1) {
       Fatal("eventfd failed: %s!\n", strerror(errno));
@@ -712,14 +972,13 @@ int itti_init(
   itti_desc.created_tasks = 0;
   itti_desc.ready_tasks = 0;
 
-  itti_desc.memory_pools_handle = memory_pools_create(5);
-  memory_pools_add_pool(
-    itti_desc.memory_pools_handle, 1000 + ITTI_QUEUE_MAX_ELEMENTS, 50);
-  memory_pools_add_pool(
-    itti_desc.memory_pools_handle, 1000 + (2 * ITTI_QUEUE_MAX_ELEMENTS), 100);
-  memory_pools_add_pool(itti_desc.memory_pools_handle, 10000, 1000);
-  memory_pools_add_pool(itti_desc.memory_pools_handle, 400, 20050);
-  memory_pools_add_pool(itti_desc.memory_pools_handle, 100, 30050);
+  itti_desc.memory_pools_handle = memory_pools_create(MEMORY_POOLS_MAX_NUMBER);
+  for (i = 0; i < ITTI_DEFAULT_MEMORY_POOLS_NUMBER; i++) {
+    memory_pools_add_pool(
+      itti_desc.memory_pools_handle,
+      itti_default_memory_pools[i].items_number,
+      itti_default_memory_pools[i].item_size);
+  }
   {
     char *statistics = memory_pools_statistics(itti_desc.memory_pools_handle);
 
@@ -808,10 +1067,6 @@ void itti_wait_tasks_end(void)
     free_wrapper((void **) &statistics);
   }
 
-  for (task_id = TASK_FIRST; task_id < itti_desc.task_max; task_id++) {
-    free_wrapper((void **) &itti_desc.tasks[task_id].qbmme);
-  }
-
   free_wrapper((void **) &itti_desc.tasks);
   free_wrapper((void **) &itti_desc.threads);
 
@@ -40,11 +40,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <sys/types.h>
 
 #include "intertask_interface_conf.h"
 #include "intertask_interface_types.h"
 #include "itti_types.h"
+#include "memory_pools.h"
 
 struct epoll_event;
 
@@ -59,10 +61,6 @@ struct epoll_event;
 #define ITTI_MSG_DESTINATION_NAME(mSGpTR)                                      \
   itti_get_task_name(ITTI_MSG_DESTINATION_ID(mSGpTR))
 
-/* Make the message number platform specific */
-typedef unsigned long message_number_t;
-#define MESSAGE_NUMBER_SIZE (sizeof(unsigned long))
-
 typedef enum message_priorities_e {
   MESSAGE_PRIORITY_MAX = 100,
   MESSAGE_PRIORITY_MAX_LEAST = 85,
@@ -105,7 +103,8 @@ typedef struct task_info_s {
  \param task_id Task ID
  \param instance Instance of the task used for virtualization
  \param message Pointer to the message to send
- @returns -1 on failure, 0 otherwise
+ @returns -1 on failure, 0 otherwise. The message is freed when the queue of
+ the task is full, it holds ITTI_QUEUE_MAX_ELEMENTS messages per priority lane
  **/
 int itti_send_msg_to_task(
   task_id_t task_id,
@@ -119,6 +118,27 @@ int itti_send_msg_to_task(
  **/
 void itti_receive_msg(task_id_t task_id, MessageDef **received_msg);
 
+/** \brief Retrieves up to max_msgs messages in the queue associated to task_id.
+ * If the queue is empty, the thread is blocked till a new message arrives.
+ * The task eventfd is consumed once for the whole batch.
+ \param task_id Task ID of the receiving task
+ \param received_msgs Array of at least max_msgs message pointers
+ \param max_msgs Maximum number of messages to dequeue
+ @returns number of messages stored in received_msgs, always > 0
+ **/
+size_t itti_receive_msg_batch(
+  task_id_t task_id,
+  MessageDef **received_msgs,
+  size_t max_msgs);
+
+/** \brief Enable or disable eventfd write coalescing for a task.
+ * When enabled, senders only write the task eventfd if the receiving task is
+ * blocked waiting for messages. Must be called before itti_mark_task_ready.
+ \param task_id Task ID of the receiving task
+ \param enable true to skip wakeups while the task is draining its queue
+ **/
+void itti_set_wakeup_coalescing(task_id_t task_id, bool enable);
+
 /** \brief Start thread associated to the task
  * \param task_id task to start
  * \param start_routine entry point for the task
@@ -175,5 +195,27 @@ void *itti_malloc(
 
 void itti_free(task_id_t task_id, void *ptr);
 
+/** \brief Replace the default layout of the message memory pools.
+ * Must be called once, after itti_init. Messages allocated from the default
+ * pools can still be freed.
+ \param pools Layout of the pools, the default one is kept if pools_number is 0
+ \param pools_number Number of pools
+ \param growth Add items to an exhausted pool instead of aborting
+ **/
+void itti_configure_memory_pools(
+  const memory_pool_config_t *pools,
+  uint32_t pools_number,
+  bool growth);
+
+/** \brief Read the statistics of the message memory pools and restart their
+ * high water marks.
+ \param statistics Filled with the statistics of each pool
+ \param statistics_number Number of elements of statistics
+ @returns the number of pools filled
+ **/
+uint32_t itti_get_memory_pools_statistics(
+  memory_pool_statistics_t *statistics,
+  uint32_t statistics_number);
+
 #endif /* INTERTASK_INTERFACE_H_ */
 /* @} */
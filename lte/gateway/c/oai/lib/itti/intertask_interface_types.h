@@ -126,6 +126,10 @@ typedef union msg_s {
 
 typedef uint16_t MessageHeaderSize;
 
+/* Make the message number platform specific */
+typedef unsigned long message_number_t;
+#define MESSAGE_NUMBER_SIZE (sizeof(unsigned long))
+
 /** @struct MessageHeader
  *  @brief Message Header structure for inter-task communication.
  */
@@ -139,14 +143,22 @@ typedef struct MessageHeader_s {
 
   MessageHeaderSize
     ittiMsgSize; /**< Message size (not including header size) */
+
+  /* Set by itti_send_msg_to_task, the message is then owned by ITTI until it
+   * is received */
+  struct MessageHeader_s
+    *ittiNext; /**< Next message in the destination task queue */
+  message_number_t ittiMsgNumber; /**< Unique message number */
+  uint32_t ittiMsgPriority;       /**< Priority of the message id */
 } MessageHeader;
 
 /** @struct MessageDef
  *  @brief Message structure for inter-task communication.
  *  \internal
  *  The attached attribute \c __packed__ is neccessary, because the memory allocation code expects \ref ittiMsg directly following \ref ittiMsgHeader.
+ *  Messages are allocated 8 bytes aligned, as their header is linked in task queues.
  */
-typedef struct __attribute__((__packed__)) MessageDef_s {
+typedef struct __attribute__((__packed__, aligned(8))) MessageDef_s {
   MessageHeader ittiMsgHeader; /**< Message header */
   msg_t
     ittiMsg; /**< Union of payloads as defined in x_messages_def.h headers */
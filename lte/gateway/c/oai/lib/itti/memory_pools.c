@@ -27,8 +27,10 @@
  * either expressed or implied, of the FreeBSD Project.
  */
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 #include "assertions.h"
@@ -49,27 +51,33 @@ const static int mp_debug = 0;
 
 #define MEMORY_POOL_ITEM_INFO_NUMBER 2
 
-/*------------------------------------------------------------------------------*/
-typedef int32_t items_group_position_t;
-typedef int32_t items_group_index_t;
+/* Items, and the data handed out, are aligned to 8 bytes */
+#define MEMORY_POOL_ITEM_ALIGNMENT 8
 
-typedef union items_group_positions_u {
-  uint64_t all;
-  struct {
-    items_group_position_t put;
-    items_group_position_t get;
-  } ind;
-} items_group_positions_t;
+#define MAX_POOLS_NUMBER MEMORY_POOLS_MAX_NUMBER
+#define MAX_POOL_ITEM_SIZE (100 * 1000)
 
-typedef struct items_group_s {
-  items_group_position_t number_plus_one;
-  volatile uint32_t minimum;
-  volatile items_group_positions_t positions;
-  volatile items_group_index_t *indexes;
-} items_group_t;
+/*
+ * Free items each thread keeps per pool. A thread refills an empty magazine
+ * and flushes a full one by half a magazine, so that the pool lock is taken
+ * once every half magazine of allocations or frees at most.
+ */
+#define MEMORY_POOL_MAGAZINE_SIZE 32
+
+/*
+ * A magazine holds at most this fraction of the items of its pool, so that
+ * the items cached by idle threads can't empty a small pool. Pools too small
+ * for a magazine of 2 items are used without magazines.
+ */
+#define MEMORY_POOL_MAGAZINE_SHARE 64
+
+/* Allocation sizes are rounded up to memory_pool_data_t for the lookup */
+#define SIZE_CLASS(sIZE)                                                       \
+  (((sIZE) + sizeof(memory_pool_data_t) - 1) / sizeof(memory_pool_data_t))
+#define SIZE_CLASSES_NUMBER (SIZE_CLASS(MAX_POOL_ITEM_SIZE) + 1)
 
 /*------------------------------------------------------------------------------*/
-static const items_group_index_t ITEMS_GROUP_INDEX_INVALID = -1;
+typedef int32_t items_group_index_t;
 
 /*------------------------------------------------------------------------------*/
 typedef uint32_t pool_item_start_mark_t;
@@ -90,7 +98,7 @@ typedef struct memory_pool_item_start_s {
   pool_id_t pool_id;
   item_status_t item_status;
   uint16_t info[MEMORY_POOL_ITEM_INFO_NUMBER];
-} memory_pool_item_start_t;
+} __attribute__((aligned(MEMORY_POOL_ITEM_ALIGNMENT))) memory_pool_item_start_t;
 
 typedef struct memory_pool_item_end_s {
   pool_item_end_mark_t end_mark;
@@ -102,12 +110,31 @@ typedef struct memory_pool_item_s {
   memory_pool_item_end_t end;
 } memory_pool_item_t;
 
+/*
+ * Stack of the free items of a pool, the most recently freed on top so that
+ * items still in cache are reused first. Items are initialized the first time
+ * they are allocated, pool memory is only touched as the load requires it.
+ */
+typedef struct items_group_s {
+  pthread_mutex_t lock;
+  uint32_t number; /* Items of the pool, grown ones included */
+  uint32_t grown_number;
+  uint32_t free_number;
+  uint32_t minimum; /* Least free items since the pool was added */
+  uint32_t period_minimum; /* Least free items since the last statistics */
+  uint64_t misses;
+  memory_pool_item_t **free_items;
+} items_group_t;
+
 typedef struct memory_pool_s {
   pool_start_mark_t start_mark;
 
   pool_id_t pool_id;
+  bool retired;
   uint32_t item_data_number;
   uint32_t pool_item_size;
+  uint32_t pool_items_number; /* Items of the initial block */
+  uint32_t magazine_size; /* 0 when the threads don't cache items */
   items_group_t items_group_free;
   memory_pool_item_t *items;
 } memory_pool_t;
@@ -116,14 +143,33 @@ typedef struct memory_pools_s {
   pools_start_mark_t start_mark;
 
   uint32_t pools_number;
-  uint32_t pools_defined;
+  volatile uint32_t pools_defined;
   memory_pool_t *pools;
+
+  bool growth;
+  /* Serializes the pools layout changes */
+  pthread_mutex_t layout_lock;
+  /* Smallest pool in use whose items fit each size class */
+  volatile pool_id_t size_class_pools[SIZE_CLASSES_NUMBER];
+  /* Next pool in use to try when a pool is empty, by increasing item size */
+  volatile pool_id_t next_pools[MAX_POOLS_NUMBER];
 } memory_pools_t;
 
+typedef struct memory_pool_magazine_s {
+  uint32_t items_number;
+  memory_pool_item_t *items[MEMORY_POOL_MAGAZINE_SIZE];
+} memory_pool_magazine_t;
+
+/* Free items cached by a thread, for one memory pools handle */
+typedef struct memory_pools_thread_cache_s {
+  memory_pools_t *memory_pools;
+  memory_pool_magazine_t magazines[MAX_POOLS_NUMBER];
+} memory_pools_thread_cache_t;
+
 //------------------------------------------------------------------------------
-static const uint32_t MAX_POOLS_NUMBER = 20;
 static const uint32_t MAX_POOL_ITEMS_NUMBER = 200 * 1000;
-static const uint32_t MAX_POOL_ITEM_SIZE = 100 * 1000;
+
+static const pool_id_t POOL_ID_NONE = 0xFF;
 
 static const pool_item_start_mark_t POOL_ITEM_START_MARK =
   CHARS_TO_UINT32('P', 'I', 's', 't');
@@ -139,122 +185,78 @@ static const pool_start_mark_t POOL_START_MARK =
 static const pools_start_mark_t POOLS_START_MARK =
   CHARS_TO_UINT32('P', 'S', 's', 't');
 
+static __thread memory_pools_thread_cache_t *thread_cache = NULL;
+static pthread_key_t thread_cache_key;
+static pthread_once_t thread_cache_key_once = PTHREAD_ONCE_INIT;
+
 /*------------------------------------------------------------------------------*/
-static inline uint32_t items_group_number_items(items_group_t *items_group)
+static inline void items_group_update_minimum(items_group_t *items_group)
 {
-  return items_group->number_plus_one - 1;
-}
+  if (items_group->free_number < items_group->minimum) {
+    items_group->minimum = items_group->free_number;
+  }
 
-//------------------------------------------------------------------------------
-static inline uint32_t items_group_free_items(items_group_t *items_group)
-{
-  items_group_positions_t positions;
-  uint32_t free_items;
-
-  positions.all = items_group->positions.all;
-  free_items =
-    items_group->number_plus_one + positions.ind.put - positions.ind.get;
-  free_items %= items_group->number_plus_one;
-  return free_items;
+  if (items_group->free_number < items_group->period_minimum) {
+    items_group->period_minimum = items_group->free_number;
+  }
 }
 
 //------------------------------------------------------------------------------
-static inline items_group_index_t items_group_get_free_item(
-  items_group_t *items_group)
+static uint32_t items_group_get_free_items(
+  items_group_t *items_group,
+  memory_pool_item_t **items,
+  uint32_t items_number)
 {
-  items_group_position_t get_raw;
-  items_group_position_t put;
-  items_group_position_t get;
-  items_group_position_t free_items;
-  items_group_index_t index = ITEMS_GROUP_INDEX_INVALID;
+  pthread_mutex_lock(&items_group->lock);
 
-  /*
-   * Get current put position
-   */
-  put = items_group->positions.ind.put % items_group->number_plus_one;
-  /*
-   * Get current get position and increase it
-   */
-  get_raw = __sync_fetch_and_add(&items_group->positions.ind.get, 1);
-  get = get_raw % items_group->number_plus_one;
+  if (items_number > items_group->free_number) {
+    items_number = items_group->free_number;
+  }
 
-  if (put == get) {
-    /*
-     * No more item free, restore previous position
-     */
-    __sync_fetch_and_sub(&items_group->positions.ind.get, 1);
+  if (items_number == 0) {
+    items_group->misses++;
   } else {
-    /*
-     * Get index at current get position
-     */
-    index = items_group->indexes[get];
-
-    if (index <= ITEMS_GROUP_INDEX_INVALID) {
-      /*
-       * Index has not yet been completely freed, restore previous get position
-       */
-      __sync_fetch_and_sub(&items_group->positions.ind.get, 1);
-    } else {
-      if (get_raw == items_group->number_plus_one) {
-        /*
-         * Wrap get position
-         */
-        __sync_fetch_and_sub(
-          &items_group->positions.ind.get, items_group->number_plus_one);
-      }
-
-      free_items = items_group_free_items(items_group);
-
-      /*
-       * Updates minimum free items if needed
-       */
-      while (items_group->minimum > free_items) {
-        items_group->minimum = free_items;
-      }
-
-      /*
-       * Clear index at current get position to indicate that item is free
-       */
-      items_group->indexes[get] = ITEMS_GROUP_INDEX_INVALID;
-    }
+    items_group->free_number -= items_number;
+    memcpy(
+      items,
+      &items_group->free_items[items_group->free_number],
+      items_number * sizeof(memory_pool_item_t *));
+    items_group_update_minimum(items_group);
   }
 
-  return (index);
+  pthread_mutex_unlock(&items_group->lock);
+  return items_number;
 }
 
 //------------------------------------------------------------------------------
-static inline int items_group_put_free_item(
+static int items_group_put_free_items(
   items_group_t *items_group,
-  items_group_index_t index)
+  memory_pool_item_t *const *items,
+  uint32_t items_number)
 {
-  items_group_position_t put_raw;
-  items_group_position_t put;
+  int result = EXIT_SUCCESS;
 
-  /*
-   * Get current put position and increase it
-   */
-  put_raw = __sync_fetch_and_add(&items_group->positions.ind.put, 1);
-  put = put_raw % items_group->number_plus_one;
+  pthread_mutex_lock(&items_group->lock);
 
-  if (put_raw == items_group->number_plus_one) {
-    /*
-     * Wrap position
-     */
-    __sync_fetch_and_sub(
-      &items_group->positions.ind.put, items_group->number_plus_one);
+  if (items_group->free_number + items_number > items_group->number) {
+    result = EXIT_FAILURE;
+  } else {
+    memcpy(
+      &items_group->free_items[items_group->free_number],
+      items,
+      items_number * sizeof(memory_pool_item_t *));
+    items_group->free_number += items_number;
   }
 
+  pthread_mutex_unlock(&items_group->lock);
   AssertError(
-    items_group->indexes[put] <= ITEMS_GROUP_INDEX_INVALID,
-    return (EXIT_FAILURE),
-    "Index at current put position (%d) is not marked as free (%d)!\n",
-    put,
-    items_group->number_plus_one);
-  /*
-   * Save freed item index at current put position
-   */
-  items_group->indexes[put] = index;
-  return (EXIT_SUCCESS);
+    result == EXIT_SUCCESS,
+    {},
+    "More items freed (%u + %u) than the pool has (%u)!\n",
+    items_group->free_number,
+    items_number,
+    items_group->number);
+  return result;
 }
 
 //------------------------------------------------------------------------------
@@ -314,6 +316,279 @@ static inline memory_pool_item_t *memory_pool_item_from_index(
   return (address);
 }
 
+//------------------------------------------------------------------------------
+static inline items_group_index_t memory_pool_item_index(
+  memory_pool_t *memory_pool,
+  memory_pool_item_t *memory_pool_item)
+{
+  void *items = (void *) memory_pool->items;
+  void *address = (void *) memory_pool_item;
+
+  if (
+    (address < items) ||
+    (address >= items + ((size_t) memory_pool->pool_items_number *
+                         memory_pool->pool_item_size))) {
+    /*
+     * Item of a slab added by growth
+     */
+    return -1;
+  }
+
+  return (address - items) / memory_pool->pool_item_size;
+}
+
+//------------------------------------------------------------------------------
+static void memory_pool_item_check(
+  memory_pool_t *memory_pool,
+  memory_pool_item_t *memory_pool_item,
+  item_status_t item_status)
+{
+  items_group_index_t item_index;
+
+  item_index = memory_pool_item_index(memory_pool, memory_pool_item);
+  /*
+   * Sanity check on calculated item index
+   */
+  AssertFatal(
+    (item_index < 0) || (memory_pool_item == memory_pool_item_from_index(
+                                               memory_pool, item_index)),
+    "Incorrect memory pool item address (%p, %p) for pool %u, item %d!\n",
+    memory_pool_item,
+    memory_pool_item_from_index(memory_pool, item_index),
+    memory_pool->pool_id,
+    item_index);
+  /*
+   * Sanity check on end marker, must still be present (no write overflow)
+   */
+  AssertFatal(
+    memory_pool_item->data[memory_pool->item_data_number] ==
+      POOL_ITEM_END_MARK,
+    "Memory pool item is corrupted, end mark is not present for pool %u, item "
+    "%d!\n",
+    memory_pool->pool_id,
+    item_index);
+  /*
+   * Sanity check on item status
+   */
+  AssertFatal(
+    memory_pool_item->start.item_status == item_status,
+    "Memory pool item status is %x instead of %x (pool %u, item %d)!\n",
+    memory_pool_item->start.item_status,
+    item_status,
+    memory_pool->pool_id,
+    item_index);
+}
+
+//------------------------------------------------------------------------------
+static void memory_pools_thread_cache_free(void *cache)
+{
+  memory_pools_thread_cache_t *thread_cache_p = cache;
+  memory_pools_t *memory_pools = thread_cache_p->memory_pools;
+  pool_id_t pool;
+
+  /*
+   * Give the items cached by the exiting thread back to their pools
+   */
+  for (pool = 0; pool < memory_pools->pools_defined; pool++) {
+    memory_pool_magazine_t *magazine = &thread_cache_p->magazines[pool];
+
+    if (magazine->items_number > 0) {
+      items_group_put_free_items(
+        &memory_pools->pools[pool].items_group_free,
+        magazine->items,
+        magazine->items_number);
+    }
+  }
+
+  free(thread_cache_p);
+}
+
+//------------------------------------------------------------------------------
+static void memory_pools_thread_cache_key_create(void)
+{
+  pthread_key_create(&thread_cache_key, memory_pools_thread_cache_free);
+}
+
+//------------------------------------------------------------------------------
+static memory_pools_thread_cache_t *memory_pools_thread_cache(
+  memory_pools_t *memory_pools)
+{
+  if (thread_cache == NULL) {
+    pthread_once(&thread_cache_key_once, memory_pools_thread_cache_key_create);
+    thread_cache = calloc(1, sizeof(memory_pools_thread_cache_t));
+
+    if (thread_cache == NULL) {
+      return NULL;
+    }
+
+    thread_cache->memory_pools = memory_pools;
+    pthread_setspecific(thread_cache_key, thread_cache);
+  }
+
+  /*
+   * A thread caches the items of a single memory pools handle, the others
+   * go to their pools directly
+   */
+  return (thread_cache->memory_pools == memory_pools) ? thread_cache : NULL;
+}
+
+//------------------------------------------------------------------------------
+static memory_pool_item_t *memory_pool_get_item(
+  memory_pool_t *memory_pool,
+  memory_pool_magazine_t *magazine)
+{
+  memory_pool_item_t *memory_pool_item = NULL;
+
+  if ((magazine == NULL) || (memory_pool->magazine_size == 0)) {
+    items_group_get_free_items(
+      &memory_pool->items_group_free, &memory_pool_item, 1);
+    return memory_pool_item;
+  }
+
+  if (magazine->items_number == 0) {
+    magazine->items_number = items_group_get_free_items(
+      &memory_pool->items_group_free,
+      magazine->items,
+      memory_pool->magazine_size / 2);
+  }
+
+  if (magazine->items_number > 0) {
+    memory_pool_item = magazine->items[--magazine->items_number];
+  }
+
+  return memory_pool_item;
+}
+
+//------------------------------------------------------------------------------
+static int memory_pool_put_item(
+  memory_pool_t *memory_pool,
+  memory_pool_magazine_t *magazine,
+  memory_pool_item_t *memory_pool_item)
+{
+  uint32_t half = memory_pool->magazine_size / 2;
+  int result = EXIT_SUCCESS;
+
+  if ((magazine == NULL) || (memory_pool->magazine_size == 0)) {
+    return items_group_put_free_items(
+      &memory_pool->items_group_free, &memory_pool_item, 1);
+  }
+
+  if (magazine->items_number == memory_pool->magazine_size) {
+    /*
+     * Give back the oldest half, the last freed items are the hottest
+     */
+    result = items_group_put_free_items(
+      &memory_pool->items_group_free, magazine->items, half);
+    magazine->items_number -= half;
+    memmove(
+      magazine->items,
+      &magazine->items[half],
+      magazine->items_number * sizeof(memory_pool_item_t *));
+  }
+
+  magazine->items[magazine->items_number++] = memory_pool_item;
+  return result;
+}
+
+//------------------------------------------------------------------------------
+static bool memory_pool_grow(memory_pool_t *memory_pool)
+{
+  items_group_t *items_group = &memory_pool->items_group_free;
+  memory_pool_item_t **free_items;
+  void *slab;
+  uint32_t items_number;
+  uint32_t item;
+  bool grown = true;
+
+  items_number = memory_pool->pool_items_number / 4;
+
+  if (items_number < MEMORY_POOL_MAGAZINE_SIZE) {
+    items_number = MEMORY_POOL_MAGAZINE_SIZE;
+  }
+
+  pthread_mutex_lock(&items_group->lock);
+
+  if (items_group->free_number == 0) {
+    /*
+     * Not grown concurrently by another thread
+     */
+    slab = calloc(items_number, memory_pool->pool_item_size);
+    free_items = realloc(
+      items_group->free_items,
+      (items_group->number + items_number) * sizeof(memory_pool_item_t *));
+
+    if (free_items != NULL) {
+      items_group->free_items = free_items;
+    }
+
+    if ((slab == NULL) || (free_items == NULL)) {
+      free(slab);
+      grown = false;
+    } else {
+      for (item = 0; item < items_number; item++) {
+        free_items[item] = slab + (items_number - 1 - item) *
+                                    (size_t) memory_pool->pool_item_size;
+      }
+
+      items_group->number += items_number;
+      items_group->grown_number += items_number;
+      items_group->free_number = items_number;
+    }
+  }
+
+  pthread_mutex_unlock(&items_group->lock);
+  return grown;
+}
+
+//------------------------------------------------------------------------------
+static void memory_pools_update_lookup(memory_pools_t *memory_pools)
+{
+  pool_id_t order[MAX_POOLS_NUMBER];
+  uint32_t order_number = 0;
+  uint32_t size_class = 0;
+  uint32_t rank;
+  uint32_t i;
+  pool_id_t pool;
+
+  /*
+   * Pools in use by increasing item size, the first added first among equals
+   */
+  for (pool = 0; pool < memory_pools->pools_defined; pool++) {
+    if (memory_pools->pools[pool].retired) {
+      continue;
+    }
+
+    for (i = order_number; (i > 0) &&
+                           (memory_pools->pools[order[i - 1]].item_data_number >
+                            memory_pools->pools[pool].item_data_number);
+         i--) {
+      order[i] = order[i - 1];
+    }
+
+    order[i] = pool;
+    order_number++;
+  }
+
+  for (rank = 0; rank < order_number; rank++) {
+    memory_pools->next_pools[order[rank]] =
+      (rank + 1 < order_number) ? order[rank + 1] : POOL_ID_NONE;
+  }
+
+  __sync_synchronize();
+
+  for (rank = 0; rank < order_number; rank++) {
+    for (; size_class <=
+           memory_pools->pools[order[rank]].item_data_number;
+         size_class++) {
+      memory_pools->size_class_pools[size_class] = order[rank];
+    }
+  }
+
+  for (; size_class < SIZE_CLASSES_NUMBER; size_class++) {
+    memory_pools->size_class_pools[size_class] = POOL_ID_NONE;
+  }
+}
+
 //------------------------------------------------------------------------------
 memory_pools_handle_t memory_pools_create(uint32_t pools_number)
 {
@@ -338,6 +613,12 @@ memory_pools_handle_t memory_pools_create(uint32_t pools_number)
     memory_pools->start_mark = POOLS_START_MARK;
     memory_pools->pools_number = pools_number;
     memory_pools->pools_defined = 0;
+    memory_pools->growth = false;
+    pthread_mutex_init(&memory_pools->layout_lock, NULL);
+    memset(
+      (void *) memory_pools->size_class_pools,
+      POOL_ID_NONE,
+      sizeof(memory_pools->size_class_pools));
     /*
      * Allocate pools
      */
@@ -376,33 +657,38 @@ char *memory_pools_statistics(memory_pools_handle_t memory_pools_handle)
     memory_pools != NULL,
     "Failed to retrieve memory pool for handle %p!\n",
     memory_pools_handle);
-  statistics_len = memory_pools->pools_defined * 200;
+  statistics_len = (memory_pools->pools_defined + 1) * 200;
   statistics = malloc(statistics_len);
   printed_chars = snprintf(
     &statistics[0],
     statistics_len,
-    "Pool:   size, number, minimum,   free, address space and memory used in "
-    "Kbytes\n");
+    "Pool:   size, number, minimum,   free,  grown, misses, address space and "
+    "memory used in Kbytes\n");
 
   for (pool = 0; pool < memory_pools->pools_defined; pool++) {
     items_group = &memory_pools->pools[pool].items_group_free;
-    allocated_pool_memory = items_group_number_items(items_group) *
-                            memory_pools->pools[pool].pool_item_size;
+    allocated_pool_memory =
+      items_group->number * memory_pools->pools[pool].pool_item_size;
     allocated_pools_memory += allocated_pool_memory;
     pool_items_size =
       memory_pools->pools[pool].item_data_number * sizeof(memory_pool_data_t);
     printed_chars += snprintf(
       &statistics[printed_chars],
       statistics_len - printed_chars,
-      "  %2u: %6u, %6u,  %6u, %6u, [%p-%p] %6u\n",
+      "  %2u: %6u, %6u,  %6u, %6u, %6u, %6lu, [%p-%p] %6u%s\n",
       pool,
       pool_items_size,
-      items_group_number_items(items_group),
+      items_group->number,
       items_group->minimum,
-      items_group_free_items(items_group),
+      items_group->free_number,
+      items_group->grown_number,
+      (unsigned long) items_group->misses,
       memory_pools->pools[pool].items,
-      ((void *) memory_pools->pools[pool].items) + allocated_pool_memory,
-      allocated_pool_memory / (1024));
+      ((void *) memory_pools->pools[pool].items) +
+        memory_pools->pools[pool].pool_items_number *
+          memory_pools->pools[pool].pool_item_size,
+      allocated_pool_memory / (1024),
+      memory_pools->pools[pool].retired ? " retired" : "");
   }
 
   printed_chars = snprintf(
@@ -413,6 +699,45 @@ char *memory_pools_statistics(memory_pools_handle_t memory_pools_handle)
   return (statistics);
 }
 
+//------------------------------------------------------------------------------
+uint32_t memory_pools_get_statistics(
+  memory_pools_handle_t memory_pools_handle,
+  memory_pool_statistics_t *statistics,
+  uint32_t statistics_number)
+{
+  memory_pools_t *memory_pools;
+  items_group_t *items_group;
+  pool_id_t pool;
+
+  memory_pools = memory_pools_from_handler(memory_pools_handle);
+  AssertError(
+    memory_pools != NULL,
+    return 0,
+    "Failed to retrieve memory pool for handle %p!\n",
+    memory_pools_handle);
+
+  for (pool = 0;
+       (pool < memory_pools->pools_defined) && (pool < statistics_number);
+       pool++) {
+    items_group = &memory_pools->pools[pool].items_group_free;
+
+    pthread_mutex_lock(&items_group->lock);
+    statistics[pool].item_size =
+      memory_pools->pools[pool].item_data_number * sizeof(memory_pool_data_t);
+    statistics[pool].items_number = items_group->number;
+    statistics[pool].grown_items_number = items_group->grown_number;
+    statistics[pool].free_items_number = items_group->free_number;
+    statistics[pool].high_water_mark =
+      items_group->number - items_group->period_minimum;
+    statistics[pool].misses = items_group->misses;
+    statistics[pool].retired = memory_pools->pools[pool].retired;
+    items_group->period_minimum = items_group->free_number;
+    pthread_mutex_unlock(&items_group->lock);
+  }
+
+  return pool;
+}
+
 //------------------------------------------------------------------------------
 int memory_pools_add_pool(
   memory_pools_handle_t memory_pools_handle,
@@ -423,7 +748,6 @@ int memory_pools_add_pool(
   memory_pool_t *memory_pool;
   pool_id_t pool;
   items_group_index_t item_index;
-  memory_pool_item_t *memory_pool_item;
 
   AssertFatal(
     pool_items_number <= MAX_POOL_ITEMS_NUMBER,
@@ -443,6 +767,7 @@ int memory_pools_add_pool(
     memory_pools != NULL,
     "Failed to retrieve memory pool for handle %p!\n",
     memory_pools_handle);
+  pthread_mutex_lock(&memory_pools->layout_lock);
   /*
    * Check number of already created pools
    */
@@ -460,64 +785,107 @@ int memory_pools_add_pool(
    */
   {
     memory_pool->pool_id = pool;
+    memory_pool->retired = false;
     /*
-     * Item size in memory_pool_data_t items by excess
+     * Item size in memory_pool_data_t items by excess, keeping items aligned
      */
     memory_pool->item_data_number =
-      (pool_item_size + sizeof(memory_pool_data_t) - 1) /
-      sizeof(memory_pool_data_t);
+      ((pool_item_size + MEMORY_POOL_ITEM_ALIGNMENT - 1) /
+       MEMORY_POOL_ITEM_ALIGNMENT) *
+      (MEMORY_POOL_ITEM_ALIGNMENT / sizeof(memory_pool_data_t));
     memory_pool->pool_item_size =
       (memory_pool->item_data_number * sizeof(memory_pool_data_t)) +
       sizeof(memory_pool_item_t);
-    memory_pool->items_group_free.number_plus_one = pool_items_number + 1;
-    memory_pool->items_group_free.minimum = pool_items_number;
-    memory_pool->items_group_free.positions.ind.put = pool_items_number;
-    memory_pool->items_group_free.positions.ind.get = 0;
-    /*
-     * Allocate free indexes
-     */
-    memory_pool->items_group_free.indexes = malloc(
-      memory_pool->items_group_free.number_plus_one *
-      sizeof(items_group_index_t));
-    AssertFatal(
-      memory_pool->items_group_free.indexes != NULL,
-      "Memory pool indexes allocation failed!\n");
+    memory_pool->pool_items_number = pool_items_number;
+    memory_pool->magazine_size = pool_items_number / MEMORY_POOL_MAGAZINE_SHARE;
 
-    /*
-     * Initialize free indexes
-     */
-    for (item_index = 0; item_index < pool_items_number; item_index++) {
-      memory_pool->items_group_free.indexes[item_index] = item_index;
+    if (memory_pool->magazine_size > MEMORY_POOL_MAGAZINE_SIZE) {
+      memory_pool->magazine_size = MEMORY_POOL_MAGAZINE_SIZE;
+    } else if (memory_pool->magazine_size < 2) {
+      memory_pool->magazine_size = 0;
     }
 
+    pthread_mutex_init(&memory_pool->items_group_free.lock, NULL);
+    memory_pool->items_group_free.number = pool_items_number;
+    memory_pool->items_group_free.grown_number = 0;
+    memory_pool->items_group_free.free_number = pool_items_number;
+    memory_pool->items_group_free.minimum = pool_items_number;
+    memory_pool->items_group_free.period_minimum = pool_items_number;
+    memory_pool->items_group_free.misses = 0;
     /*
-     * Last index is not allocated
-     */
-    memory_pool->items_group_free.indexes[item_index] =
-      ITEMS_GROUP_INDEX_INVALID;
-    /*
-     * Allocate items
+     * Allocate items, they are initialized on their first allocation
      */
     memory_pool->items = calloc(pool_items_number, memory_pool->pool_item_size);
     AssertFatal(
       memory_pool->items != NULL, "Memory pool items allocation failed!\n");
-
     /*
-     * Initialize items
+     * Allocate free items, first items on top
      */
+    memory_pool->items_group_free.free_items =
+      malloc(pool_items_number * sizeof(memory_pool_item_t *));
+    AssertFatal(
+      memory_pool->items_group_free.free_items != NULL,
+      "Memory pool free items allocation failed!\n");
+
     for (item_index = 0; item_index < pool_items_number; item_index++) {
-      memory_pool_item = memory_pool_item_from_index(memory_pool, item_index);
-      memory_pool_item->start.start_mark = POOL_ITEM_START_MARK;
-      memory_pool_item->start.pool_id = pool;
-      memory_pool_item->start.item_status = ITEM_STATUS_FREE;
-      memory_pool_item->data[memory_pool->item_data_number] =
-        POOL_ITEM_END_MARK;
+      memory_pool->items_group_free
+        .free_items[pool_items_number - 1 - item_index] =
+        memory_pool_item_from_index(memory_pool, item_index);
     }
   }
+  /*
+   * Publish the pool once initialized
+   */
+  __sync_synchronize();
   memory_pools->pools_defined++;
+  memory_pools_update_lookup(memory_pools);
+  pthread_mutex_unlock(&memory_pools->layout_lock);
   return (0);
 }
 
+//------------------------------------------------------------------------------
+void memory_pools_retire_pools(
+  memory_pools_handle_t memory_pools_handle,
+  uint32_t pools_number)
+{
+  memory_pools_t *memory_pools;
+  pool_id_t pool;
+
+  memory_pools = memory_pools_from_handler(memory_pools_handle);
+  AssertFatal(
+    memory_pools != NULL,
+    "Failed to retrieve memory pool for handle %p!\n",
+    memory_pools_handle);
+  pthread_mutex_lock(&memory_pools->layout_lock);
+  AssertFatal(
+    pools_number <= memory_pools->pools_defined,
+    "Can not retire more memory pools than defined (%u/%u)!\n",
+    pools_number,
+    memory_pools->pools_defined);
+
+  for (pool = 0; pool < pools_number; pool++) {
+    memory_pools->pools[pool].retired = true;
+  }
+
+  memory_pools_update_lookup(memory_pools);
+  pthread_mutex_unlock(&memory_pools->layout_lock);
+}
+
+//------------------------------------------------------------------------------
+void memory_pools_set_growth(
+  memory_pools_handle_t memory_pools_handle,
+  bool growth)
+{
+  memory_pools_t *memory_pools;
+
+  memory_pools = memory_pools_from_handler(memory_pools_handle);
+  AssertFatal(
+    memory_pools != NULL,
+    "Failed to retrieve memory pool for handle %p!\n",
+    memory_pools_handle);
+  memory_pools->growth = growth;
+}
+
 //------------------------------------------------------------------------------
 memory_pool_item_handle_t memory_pools_allocate(
   memory_pools_handle_t memory_pools_handle,
@@ -526,10 +894,12 @@ memory_pool_item_handle_t memory_pools_allocate(
   uint16_t info_1)
 {
   memory_pools_t *memory_pools;
-  memory_pool_item_t *memory_pool_item;
+  memory_pools_thread_cache_t *cache;
+  memory_pool_t *memory_pool = NULL;
+  memory_pool_item_t *memory_pool_item = NULL;
   memory_pool_item_handle_t memory_pool_item_handle = NULL;
+  pool_id_t first_pool = POOL_ID_NONE;
   pool_id_t pool;
-  items_group_index_t item_index = ITEMS_GROUP_INDEX_INVALID;
 
   /*
    * Recover memory_pools
@@ -537,51 +907,63 @@ memory_pool_item_handle_t memory_pools_allocate(
   memory_pools = memory_pools_from_handler(memory_pools_handle);
   AssertError(
     memory_pools != NULL,
-    {},
+    return NULL,
     "Failed to retrieve memory pool for handle %p!\n",
     memory_pools_handle);
 
-  for (pool = 0; pool < memory_pools->pools_defined; pool++) {
-    if (
-      (memory_pools->pools[pool].item_data_number *
-       sizeof(memory_pool_data_t)) < item_size) {
-      /*
-       * This memory pool has too small items, skip it
-       */
-      continue;
-    }
+  if (item_size <= MAX_POOL_ITEM_SIZE) {
+    first_pool = memory_pools->size_class_pools[SIZE_CLASS(item_size)];
+  }
 
-    item_index =
-      items_group_get_free_item(&memory_pools->pools[pool].items_group_free);
+  cache = memory_pools_thread_cache(memory_pools);
 
-    if (item_index <= ITEMS_GROUP_INDEX_INVALID) {
-      /*
-       * Allocation failed, skip this pool
-       */
-      continue;
-    } else {
-      /*
-       * Allocation succeed, exit searching loop
-       */
+  for (pool = first_pool; pool != POOL_ID_NONE;
+       pool = memory_pools->next_pools[pool]) {
+    memory_pool = &memory_pools->pools[pool];
+    memory_pool_item = memory_pool_get_item(
+      memory_pool, (cache != NULL) ? &cache->magazines[pool] : NULL);
+
+    if (memory_pool_item != NULL) {
       break;
     }
   }
 
-  if (item_index > ITEMS_GROUP_INDEX_INVALID) {
+  if (
+    (memory_pool_item == NULL) && (first_pool != POOL_ID_NONE) &&
+    memory_pools->growth) {
     /*
-     * Convert item index into memory_pool_item address
+     * All the fitting pools are empty, add items to the smallest one
      */
-    memory_pool_item =
-      memory_pool_item_from_index(&memory_pools->pools[pool], item_index);
+    pool = first_pool;
+    memory_pool = &memory_pools->pools[pool];
+
+    if (memory_pool_grow(memory_pool)) {
+      memory_pool_item = memory_pool_get_item(
+        memory_pool, (cache != NULL) ? &cache->magazines[pool] : NULL);
+    }
+  }
+
+  if (memory_pool_item != NULL) {
+    if (memory_pool_item->start.start_mark != POOL_ITEM_START_MARK) {
+      /*
+       * First allocation of this item
+       */
+      memory_pool_item->start.start_mark = POOL_ITEM_START_MARK;
+      memory_pool_item->start.pool_id = pool;
+      memory_pool_item->start.item_status = ITEM_STATUS_FREE;
+      memory_pool_item->data[memory_pool->item_data_number] =
+        POOL_ITEM_END_MARK;
+    }
+
     /*
      * Sanity check on item status, must be free
      */
     AssertFatal(
       memory_pool_item->start.item_status == ITEM_STATUS_FREE,
-      "Item status is not set to free (%d) in pool %u, item %d!\n",
+      "Item status is not set to free (%d) in pool %u, item %p!\n",
       memory_pool_item->start.item_status,
       pool,
-      item_index);
+      memory_pool_item);
     memory_pool_item->start.item_status = ITEM_STATUS_ALLOCATED;
     memory_pool_item->start.info[0] = info_0;
     memory_pool_item->start.info[1] = info_1;
@@ -589,12 +971,12 @@ memory_pool_item_handle_t memory_pools_allocate(
     MP_DEBUG(
       " Alloc [%2u][%6d]{%6d}, %3u %3u, %6u, %p, %p, %p\n",
       pool,
-      item_index,
-      items_group_free_items(&memory_pools->pools[pool].items_group_free),
+      memory_pool_item_index(memory_pool, memory_pool_item),
+      memory_pool->items_group_free.free_number,
       info_0,
       info_1,
       item_size,
-      memory_pools->pools[pool].items,
+      memory_pool->items,
       memory_pool_item,
       memory_pool_item_handle);
   } else {
@@ -615,12 +997,10 @@ int memory_pools_free(
   uint16_t info_0)
 {
   memory_pools_t *memory_pools;
+  memory_pools_thread_cache_t *cache;
+  memory_pool_t *memory_pool;
   memory_pool_item_t *memory_pool_item;
   pool_id_t pool;
-  items_group_index_t item_index;
-  uint32_t item_size;
-  uint32_t pool_item_size;
-  uint16_t info_1;
   int result;
 
   /*
@@ -641,7 +1021,6 @@ int memory_pools_free(
     return (EXIT_FAILURE),
     "Failed to retrieve memory pool item for handle %p!\n",
     memory_pool_item_handle);
-  info_1 = memory_pool_item->start.info[1];
 
   /*
    * Recover pool index
@@ -652,61 +1031,31 @@ int memory_pools_free(
     "Pool index is invalid (%u/%u)!\n",
     pool,
     memory_pools->pools_defined);
-  item_size = memory_pools->pools[pool].item_data_number;
-  pool_item_size = memory_pools->pools[pool].pool_item_size;
-  item_index =
-    (((void *) memory_pool_item) - ((void *) memory_pools->pools[pool].items)) /
-    pool_item_size;
+  memory_pool = &memory_pools->pools[pool];
   MP_DEBUG(
     " Free  [%2u][%6d]{%6d}, %3u %3u,         %p, %p, %p, %u\n",
     pool,
-    item_index,
-    items_group_free_items(&memory_pools->pools[pool].items_group_free),
+    memory_pool_item_index(memory_pool, memory_pool_item),
+    memory_pool->items_group_free.free_number,
     memory_pool_item->start.info[0],
-    info_1,
+    memory_pool_item->start.info[1],
     memory_pool_item_handle,
     memory_pool_item,
-    memory_pools->pools[pool].items,
-    ((uint32_t)(item_size * sizeof(memory_pool_data_t))));
-  /*
-   * Sanity check on calculated item index
-   */
-  AssertFatal(
-    memory_pool_item ==
-      memory_pool_item_from_index(&memory_pools->pools[pool], item_index),
-    "Incorrect memory pool item address (%p, %p) for pool %u, item %d!\n",
-    memory_pool_item,
-    memory_pool_item_from_index(&memory_pools->pools[pool], item_index),
-    pool,
-    item_index);
-  /*
-   * Sanity check on end marker, must still be present (no write overflow)
-   */
-  AssertFatal(
-    memory_pool_item->data[item_size] == POOL_ITEM_END_MARK,
-    "Memory pool item is corrupted, end mark is not present for pool %u, item "
-    "%d!\n",
-    pool,
-    item_index);
-  /*
-   * Sanity check on item status, must be allocated
-   */
-  AssertFatal(
-    memory_pool_item->start.item_status == ITEM_STATUS_ALLOCATED,
-    "Trying to free a non allocated (%x) memory pool item (pool %u, item "
-    "%d)!\n",
-    memory_pool_item->start.item_status,
-    pool,
-    item_index);
+    memory_pool->items,
+    ((uint32_t)(memory_pool->item_data_number * sizeof(memory_pool_data_t))));
+  memory_pool_item_check(memory_pool, memory_pool_item, ITEM_STATUS_ALLOCATED);
   memory_pool_item->start.item_status = ITEM_STATUS_FREE;
-  result = items_group_put_free_item(
-    &memory_pools->pools[pool].items_group_free, item_index);
+  cache = memory_pools_thread_cache(memory_pools);
+  result = memory_pool_put_item(
+    memory_pool,
+    (cache != NULL) ? &cache->magazines[pool] : NULL,
+    memory_pool_item);
   AssertError(
     result == EXIT_SUCCESS,
     {},
-    "Failed to free memory pool item (pool %u, item %d)!\n",
+    "Failed to free memory pool item (pool %u, item %p)!\n",
     pool,
-    item_index);
+    memory_pool_item);
 
   return result;
 }
@@ -719,11 +1068,9 @@ void memory_pools_set_info(
   uint16_t info)
 {
   memory_pools_t *memory_pools;
+  memory_pool_t *memory_pool;
   memory_pool_item_t *memory_pool_item;
   pool_id_t pool;
-  items_group_index_t item_index;
-  uint32_t item_size;
-  uint32_t pool_item_size;
 
   AssertFatal(
     index < MEMORY_POOL_ITEM_INFO_NUMBER,
@@ -764,51 +1111,19 @@ void memory_pools_set_info(
       "Pool index is invalid (%u/%u)!\n",
       pool,
       memory_pools->pools_defined);
-    item_size = memory_pools->pools[pool].item_data_number;
-    pool_item_size = memory_pools->pools[pool].pool_item_size;
-    item_index = (((void *) memory_pool_item) -
-                  ((void *) memory_pools->pools[pool].items)) /
-                 pool_item_size;
+    memory_pool = &memory_pools->pools[pool];
     MP_DEBUG(
       " Info  [%2u][%6d]{%6d}, %3u %3u,         %p, %p, %p, %u\n",
       pool,
-      item_index,
-      items_group_free_items(&memory_pools->pools[pool].items_group_free),
+      memory_pool_item_index(memory_pool, memory_pool_item),
+      memory_pool->items_group_free.free_number,
       memory_pool_item->start.info[0],
       memory_pool_item->start.info[1],
       memory_pool_item_handle,
       memory_pool_item,
-      memory_pools->pools[pool].items,
-      ((uint32_t)(item_size * sizeof(memory_pool_data_t))));
-    /*
-     * Sanity check on calculated item index
-     */
-    AssertFatal(
-      memory_pool_item ==
-        memory_pool_item_from_index(&memory_pools->pools[pool], item_index),
-      "Incorrect memory pool item address (%p, %p) for pool %u, item %d!\n",
-      memory_pool_item,
-      memory_pool_item_from_index(&memory_pools->pools[pool], item_index),
-      pool,
-      item_index);
-    /*
-     * Sanity check on end marker, must still be present (no write overflow)
-     */
-    AssertFatal(
-      memory_pool_item->data[item_size] == POOL_ITEM_END_MARK,
-      "Memory pool item is corrupted, end mark is not present for pool %u, "
-      "item %d!\n",
-      pool,
-      item_index);
-    /*
-     * Sanity check on item status, must be allocated
-     */
-    AssertFatal(
-      memory_pool_item->start.item_status == ITEM_STATUS_ALLOCATED,
-      "Trying to free a non allocated (%x) memory pool item (pool %u, item "
-      "%d)\n",
-      memory_pool_item->start.item_status,
-      pool,
-      item_index);
+      memory_pool->items,
+      ((uint32_t)(memory_pool->item_data_number * sizeof(memory_pool_data_t))));
+    memory_pool_item_check(
+      memory_pool, memory_pool_item, ITEM_STATUS_ALLOCATED);
   }
 }
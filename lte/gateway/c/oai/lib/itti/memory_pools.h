@@ -30,20 +30,67 @@
 #ifndef MEMORY_POOLS_H_
 #define MEMORY_POOLS_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
+/* Upper bound of the pools_number of memory_pools_create */
+#define MEMORY_POOLS_MAX_NUMBER 20
+
 typedef void *memory_pools_handle_t;
 typedef void *memory_pool_item_handle_t;
 
+/* Layout of one pool: items_number items of item_size bytes */
+typedef struct memory_pool_config_s {
+  uint32_t items_number;
+  uint32_t item_size;
+} memory_pool_config_t;
+
+typedef struct memory_pool_statistics_s {
+  uint32_t item_size;
+  uint32_t items_number; /* Including the items added by growth */
+  uint32_t grown_items_number;
+  uint32_t free_items_number; /* Items cached by threads are not counted */
+  uint32_t high_water_mark; /* Most items in use since the previous read */
+  uint64_t misses; /* Allocations that found the pool empty */
+  bool retired;
+} memory_pool_statistics_t;
+
 memory_pools_handle_t memory_pools_create(uint32_t pools_number);
 
 char *memory_pools_statistics(memory_pools_handle_t memory_pools_handle);
 
+/*
+ * Fill statistics with the counters of at most statistics_number pools and
+ * restart the high water marks.
+ * @return the number of pools filled
+ */
+uint32_t memory_pools_get_statistics(
+  memory_pools_handle_t memory_pools_handle,
+  memory_pool_statistics_t *statistics,
+  uint32_t statistics_number);
+
 int memory_pools_add_pool(
   memory_pools_handle_t memory_pools_handle,
   uint32_t pool_items_number,
   uint32_t pool_item_size);
 
+/*
+ * Stop allocating from the pools_number first pools added, e.g. to replace a
+ * default layout with pools added afterwards. Their allocated items can still
+ * be freed.
+ */
+void memory_pools_retire_pools(
+  memory_pools_handle_t memory_pools_handle,
+  uint32_t pools_number);
+
+/*
+ * When growth is enabled, an allocation that finds all the fitting pools
+ * empty adds a slab of items to the smallest one instead of failing.
+ */
+void memory_pools_set_growth(
+  memory_pools_handle_t memory_pools_handle,
+  bool growth);
+
 memory_pool_item_handle_t memory_pools_allocate(
   memory_pools_handle_t memory_pools_handle,
   uint32_t item_size,
@@ -27,40 +27,83 @@
  * either expressed or implied, of the FreeBSD Project.
  */
 
+/*! \file timer.c
+  \brief ITTI timers on a hashed hierarchical timer wheel
+
+  All timers share one wheel advanced by a single thread woken up by a
+  timerfd every TIMER_WHEEL_TICK_MS. The wheel has TIMER_WHEEL_LEVELS levels
+  of TIMER_WHEEL_SLOTS slots, level n covering TIMER_WHEEL_SLOTS^(n+1) ticks.
+  A timer is queued in the slot of the lowest level covering its expiry and is
+  cascaded to the lower levels as the wheel turns, so arming and cancelling a
+  timer are O(1). Timers are looked up by id through a hashtable.
+*/
+#define _GNU_SOURCE
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
-#include <signal.h>
 #include <time.h>
 #include <errno.h>
-#include <sys/time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
 
 #include "intertask_interface.h"
 #include "timer.h"
 #include "log.h"
 #include "queue.h"
+#include "hashtable.h"
 #include "dynamic_memory_check.h"
 #include "assertions.h"
 #include "timer_messages_types.h"
 
-int timer_handle_signal(siginfo_t *info);
+#define TIMER_WHEEL_TICK_MS 10
+#define TIMER_WHEEL_TICK_NS ((uint64_t) TIMER_WHEEL_TICK_MS * 1000000)
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOT_BITS 8
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+#define TIMER_WHEEL_SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+// Longest delay the wheel can hold (about 497 days), longer ones are clamped
+#define TIMER_WHEEL_MAX_TICKS                                                  \
+  ((1ull << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOT_BITS)) - 1)
+#define TIMER_HASH_INITIAL_SIZE 1024
 
 struct timer_elm_s {
-  task_id_t task_id; ///< Task ID which has requested the timer
-  int32_t instance;  ///< Instance of the task which has requested the timer
-  timer_t timer;     ///< Unique timer id
-  timer_type_t type; ///< Timer type
+  long timer_id;      ///< Unique timer id
+  task_id_t task_id;  ///< Task ID which has requested the timer
+  int32_t instance;   ///< Instance of the task which has requested the timer
+  timer_type_t type;  ///< Timer type
   void *timer_arg; ///< Optional argument that will be passed when timer expires
-  STAILQ_ENTRY(timer_elm_s) entries; ///< Pointer to next element
+  uint64_t expires;        ///< Wheel tick at which the timer expires
+  uint64_t period_ticks;   ///< Period of a periodic timer
+  bool armed;              ///< Whether the timer is queued on the wheel
+  LIST_ENTRY(timer_elm_s) entries; ///< Pointers to siblings in the wheel slot
 };
 
+LIST_HEAD(timer_slot_s, timer_elm_s);
+
+// Expiry collected under the lock, notified once the lock is released
+typedef struct timer_expiry_s {
+  long timer_id;
+  task_id_t task_id;
+  int32_t instance;
+  void *timer_arg;
+} timer_expiry_t;
+
 typedef struct timer_desc_s {
-  STAILQ_HEAD(timer_list_head, timer_elm_s) timer_queue;
   pthread_mutex_t timer_list_mutex;
-  struct timespec timeout;
+  struct timer_slot_s wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+  uint64_t current;       ///< Next wheel tick to process
+  uint32_t armed_timers;  ///< Number of timers queued on the wheel
+  hash_table_t *timers;   ///< timer_id -> struct timer_elm_s
+  long last_timer_id;
+  struct timespec start;  ///< Time of wheel tick 0
+  int timer_fd;
+  bool timer_fd_armed;
+  pthread_t thread;
+  timer_expiry_t *expired; ///< Scratch buffer of the timer thread
+  size_t expired_size;
 } timer_desc_t;
 
 static timer_desc_t timer_desc;
@@ -68,46 +111,207 @@ static timer_desc_t timer_desc;
 static int _timer_delete_helper(struct timer_elm_s *timer_p);
 static struct timer_elm_s *_find_timer(long timer_id);
 
-#define TIMER_SEARCH(vAR, tIMERfIELD, tIMERvALUE, tIMERqUEUE)                  \
-  do {                                                                         \
-    STAILQ_FOREACH(vAR, tIMERqUEUE, entries)                                   \
-    {                                                                          \
-      if (((vAR)->tIMERfIELD == tIMERvALUE)) break;                            \
-    }                                                                          \
-  } while (0)
+static uint64_t _timer_elapsed_ns(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)(now.tv_sec - timer_desc.start.tv_sec) * 1000000000 +
+         now.tv_nsec - timer_desc.start.tv_nsec;
+}
+
+// Start or stop the wheel tick, timer_list_mutex must be held
+static void _timer_fd_arm(bool arm)
+{
+  struct itimerspec its = {0};
+
+  if (arm == timer_desc.timer_fd_armed) {
+    return;
+  }
+  if (arm) {
+    uint64_t first_tick_ns = timer_desc.current * TIMER_WHEEL_TICK_NS;
+    its.it_value.tv_sec =
+      timer_desc.start.tv_sec + first_tick_ns / 1000000000;
+    its.it_value.tv_nsec =
+      timer_desc.start.tv_nsec + first_tick_ns % 1000000000;
+    if (its.it_value.tv_nsec >= 1000000000) {
+      its.it_value.tv_sec++;
+      its.it_value.tv_nsec -= 1000000000;
+    }
+    its.it_interval.tv_nsec = TIMER_WHEEL_TICK_NS;
+  }
+  if (
+    timerfd_settime(timer_desc.timer_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+    OAILOG_ERROR(
+      LOG_ITTI, "Failed to set timerfd: (%s:%d)\n", strerror(errno), errno);
+    return;
+  }
+  timer_desc.timer_fd_armed = arm;
+}
+
+// Queue a timer in the wheel slot covering its expiry
+static void _timer_wheel_insert(struct timer_elm_s *timer_p)
+{
+  uint64_t delta;
+  int level = 0;
+
+  if (timer_p->expires < timer_desc.current) {
+    timer_p->expires = timer_desc.current;
+  }
+  delta = timer_p->expires - timer_desc.current;
+  if (delta > TIMER_WHEEL_MAX_TICKS) {
+    delta = TIMER_WHEEL_MAX_TICKS;
+    timer_p->expires = timer_desc.current + delta;
+  }
+  while (
+    level < TIMER_WHEEL_LEVELS - 1 &&
+    delta >= (1ull << ((level + 1) * TIMER_WHEEL_SLOT_BITS))) {
+    level++;
+  }
+  LIST_INSERT_HEAD(
+    &timer_desc.wheel[level][(timer_p->expires >>
+                              (level * TIMER_WHEEL_SLOT_BITS)) &
+                             TIMER_WHEEL_SLOT_MASK],
+    timer_p,
+    entries);
+  timer_p->armed = true;
+  timer_desc.armed_timers++;
+}
+
+static void _timer_wheel_unlink(struct timer_elm_s *timer_p)
+{
+  if (timer_p->armed) {
+    LIST_REMOVE(timer_p, entries);
+    timer_p->armed = false;
+    timer_desc.armed_timers--;
+  }
+}
 
-int timer_handle_signal(siginfo_t *info)
+// Take all the timers out of a slot, into a list head owned by the caller
+static void _timer_slot_detach(
+  struct timer_slot_s *slot_p,
+  struct timer_slot_s *detached_p)
 {
+  *detached_p = *slot_p;
+  LIST_INIT(slot_p);
+  if (LIST_FIRST(detached_p)) {
+    LIST_FIRST(detached_p)->entries.le_prev = &LIST_FIRST(detached_p);
+  }
+}
+
+// Move the timers of a slot down to the lower levels, returns the slot index
+static int _timer_wheel_cascade(int level)
+{
+  int index = (timer_desc.current >> (level * TIMER_WHEEL_SLOT_BITS)) &
+              TIMER_WHEEL_SLOT_MASK;
+  struct timer_slot_s slot;
+  struct timer_elm_s *timer_p;
+
+  _timer_slot_detach(&timer_desc.wheel[level][index], &slot);
+  while ((timer_p = LIST_FIRST(&slot))) {
+    _timer_wheel_unlink(timer_p);
+    _timer_wheel_insert(timer_p);
+  }
+  return index;
+}
+
+static void _timer_expired_push(size_t *count, struct timer_elm_s *timer_p)
+{
+  if (*count == timer_desc.expired_size) {
+    size_t size = timer_desc.expired_size ? timer_desc.expired_size * 2 : 64;
+    timer_expiry_t *expired =
+      realloc(timer_desc.expired, size * sizeof(timer_expiry_t));
+    AssertFatal(expired, "Failed to grow timer expiry buffer\n");
+    timer_desc.expired = expired;
+    timer_desc.expired_size = size;
+  }
+  timer_desc.expired[*count].timer_id = timer_p->timer_id;
+  timer_desc.expired[*count].task_id = timer_p->task_id;
+  timer_desc.expired[*count].instance = timer_p->instance;
+  timer_desc.expired[*count].timer_arg = timer_p->timer_arg;
+  (*count)++;
+}
+
+// Process one wheel tick, timer_list_mutex must be held
+static void _timer_wheel_tick(size_t *count)
+{
+  struct timer_slot_s slot;
   struct timer_elm_s *timer_p;
+  int level = 1;
+
+  if ((timer_desc.current & TIMER_WHEEL_SLOT_MASK) == 0) {
+    while (level < TIMER_WHEEL_LEVELS && _timer_wheel_cascade(level) == 0) {
+      level++;
+    }
+  }
+  // Periodic timers may be queued back in this very slot
+  _timer_slot_detach(
+    &timer_desc.wheel[0][timer_desc.current & TIMER_WHEEL_SLOT_MASK], &slot);
+  timer_desc.current++;
+  while ((timer_p = LIST_FIRST(&slot))) {
+    _timer_wheel_unlink(timer_p);
+    _timer_expired_push(count, timer_p);
+    // One shot timers stay known until the task handles the expiry
+    if (timer_p->type == TIMER_PERIODIC) {
+      timer_p->expires += timer_p->period_ticks;
+      _timer_wheel_insert(timer_p);
+    }
+  }
+}
+
+static void _timer_notify_expired(const timer_expiry_t *expiry)
+{
   MessageDef *message_p;
   timer_has_expired_t *timer_expired_p;
-  task_id_t task_id;
-  int32_t instance;
 
-  /*
-   * Get back pointer to timer list element
-   */
-  timer_p = (struct timer_elm_s *) info->si_ptr;
-  // LG: To many traces for msc timer:
-  // TMR_DEBUG("Timer with id 0x%lx has expired", (long)timer_p->timer);
-  task_id = timer_p->task_id;
-  instance = timer_p->instance;
   message_p = itti_alloc_new_message(TASK_TIMER, TIMER_HAS_EXPIRED);
   timer_expired_p = &message_p->ittiMsg.timer_has_expired;
-  timer_expired_p->timer_id = (long) timer_p->timer;
-  timer_expired_p->arg = timer_p->timer_arg;
+  timer_expired_p->timer_id = expiry->timer_id;
+  timer_expired_p->arg = expiry->timer_arg;
 
   /*
    * Notify task of timer expiry
    */
-  if (itti_send_msg_to_task(task_id, instance, message_p) < 0) {
+  if (itti_send_msg_to_task(expiry->task_id, expiry->instance, message_p) < 0) {
     OAILOG_DEBUG(
-      LOG_ITTI, "Failed to send msg TIMER_HAS_EXPIRED to task %u\n", task_id);
+      LOG_ITTI,
+      "Failed to send msg TIMER_HAS_EXPIRED to task %u\n",
+      expiry->task_id);
     itti_free(TASK_TIMER, message_p);
-    return -1;
   }
+}
 
-  return 0;
+static void *_timer_thread(void *args)
+{
+  uint64_t ticks;
+  uint64_t now;
+  size_t count;
+
+  while (true) {
+    if (read(timer_desc.timer_fd, &ticks, sizeof(ticks)) < 0) {
+      if (errno != EINTR && errno != EAGAIN) {
+        OAILOG_ERROR(
+          LOG_ITTI, "Failed to read timerfd: (%s:%d)\n", strerror(errno), errno);
+      }
+      continue;
+    }
+    count = 0;
+    pthread_mutex_lock(&timer_desc.timer_list_mutex);
+    // Catch up with every tick elapsed, the timerfd may report several
+    now = _timer_elapsed_ns() / TIMER_WHEEL_TICK_NS;
+    while (timer_desc.armed_timers && timer_desc.current <= now) {
+      _timer_wheel_tick(&count);
+    }
+    if (!timer_desc.armed_timers) {
+      _timer_fd_arm(false);
+    }
+    pthread_mutex_unlock(&timer_desc.timer_list_mutex);
+
+    for (size_t i = 0; i < count; i++) {
+      _timer_notify_expired(&timer_desc.expired[i]);
+    }
+  }
+  return NULL;
 }
 
 int timer_setup(
@@ -120,10 +324,8 @@ int timer_setup(
   size_t arg_size,
   long *timer_id)
 {
-  struct sigevent se;
-  struct itimerspec its;
   struct timer_elm_s *timer_p;
-  timer_t timer;
+  uint64_t interval_ns;
 
   if (timer_id == NULL) {
     return -1;
@@ -144,8 +346,6 @@ int timer_setup(
     return -1;
   }
 
-  memset(&timer, 0, sizeof(timer_t));
-  memset(&se, 0, sizeof(struct sigevent));
   timer_p->task_id = task_id;
   timer_p->instance = instance;
   timer_p->type = type;
@@ -161,53 +361,44 @@ int timer_setup(
     timer_p->timer_arg = arg_copy;
   }
 
-  /*
-   * Setting up alarm
-   */
-  /*
-   * Set and enable alarm
-   */
-  se.sigev_notify = SIGEV_SIGNAL;
-  se.sigev_signo = SIGTIMER;
-  se.sigev_value.sival_ptr = timer_p;
+  interval_ns = (uint64_t) interval_sec * 1000000000 +
+                (uint64_t) interval_us * 1000;
+  if (type == TIMER_PERIODIC) {
+    timer_p->period_ticks =
+      (interval_ns + TIMER_WHEEL_TICK_NS - 1) / TIMER_WHEEL_TICK_NS;
+    if (!timer_p->period_ticks) {
+      timer_p->period_ticks = 1;
+    }
+  }
 
-  /*
-   * At the timer creation, the timer structure will be filled in with timer_id,
-   * * * which is unique for this process. This id is allocated by kernel and the
-   * * * value might be used to distinguish timers.
-   */
-  if (timer_create(CLOCK_REALTIME, &se, &timer) < 0) {
-    OAILOG_ERROR(
-      LOG_ITTI, "Failed to create timer: (%s:%d)\n", strerror(errno), errno);
+  pthread_mutex_lock(&timer_desc.timer_list_mutex);
+  if (!timer_desc.armed_timers) {
+    // The wheel is idle, skip the ticks elapsed since it stopped
+    timer_desc.current = _timer_elapsed_ns() / TIMER_WHEEL_TICK_NS + 1;
+  }
+  // Round up so that the timer never expires before the requested interval
+  timer_p->expires = (_timer_elapsed_ns() + interval_ns + TIMER_WHEEL_TICK_NS -
+                      1) /
+                     TIMER_WHEEL_TICK_NS;
+  timer_p->timer_id = ++timer_desc.last_timer_id;
+  if (
+    hashtable_insert(
+      timer_desc.timers, (hash_key_t) timer_p->timer_id, timer_p) !=
+    HASH_TABLE_OK) {
+    pthread_mutex_unlock(&timer_desc.timer_list_mutex);
+    OAILOG_ERROR(LOG_ITTI, "Failed to register new timer\n");
+    free_wrapper(&timer_p->timer_arg);
     free_wrapper((void **) &timer_p);
     return -1;
   }
+  _timer_wheel_insert(timer_p);
+  _timer_fd_arm(true);
+  pthread_mutex_unlock(&timer_desc.timer_list_mutex);
 
-  /*
-   * Fill in the first expiration value.
-   */
-  its.it_value.tv_sec = interval_sec;
-  its.it_value.tv_nsec = interval_us * 1000;
-
-  if (type == TIMER_PERIODIC) {
-    /*
-     * Asked for periodic timer. We set the interval time
-     */
-    its.it_interval.tv_sec = interval_sec;
-    its.it_interval.tv_nsec = interval_us * 1000;
-  } else {
-    /*
-     * Asked for one-shot timer. Do not set the interval field
-     */
-    its.it_interval.tv_sec = 0;
-    its.it_interval.tv_nsec = 0;
-  }
-
-  timer_settime(timer, 0, &its, NULL);
   /*
    * Simply set the timer_id argument. so it can be used by caller
    */
-  *timer_id = (long) timer;
+  *timer_id = timer_p->timer_id;
   OAILOG_INFO(
     LOG_ITTI,
     "Requesting new %s timer with id 0x%lx that expires within "
@@ -216,42 +407,31 @@ int timer_setup(
     *timer_id,
     interval_sec,
     interval_us);
-  timer_p->timer = timer;
-  /*
-   * Lock the queue and insert the timer at the tail
-   */
-  pthread_mutex_lock(&timer_desc.timer_list_mutex);
-  STAILQ_INSERT_TAIL(&timer_desc.timer_queue, timer_p, entries);
-  pthread_mutex_unlock(&timer_desc.timer_list_mutex);
   return 0;
 }
 
 // Helper function to delete a timer from queue and cleanup associated resources
 static int _timer_delete_helper(struct timer_elm_s *timer_p)
 {
-  int rc = TIMER_OK;
+  void *unused = NULL;
+
   pthread_mutex_lock(&timer_desc.timer_list_mutex);
-  STAILQ_REMOVE(&timer_desc.timer_queue, timer_p, timer_elm_s, entries);
+  hashtable_remove(
+    timer_desc.timers, (hash_key_t) timer_p->timer_id, &unused);
+  _timer_wheel_unlink(timer_p);
   pthread_mutex_unlock(&timer_desc.timer_list_mutex);
 
-  if (timer_delete(timer_p->timer) < 0) {
-    OAILOG_ERROR(
-      LOG_ITTI, "Failed to delete timer 0x%lx\n", (long) timer_p->timer);
-    rc = TIMER_ERR;
-  }
-
   free_wrapper(&timer_p->timer_arg);
   free_wrapper((void **) &timer_p);
-  timer_p = NULL;
-  return rc;
+  return TIMER_OK;
 }
 
-// Helper function to find a timer in the queue
+// Helper function to find a timer
 static struct timer_elm_s *_find_timer(long timer_id)
 {
   struct timer_elm_s *timer_p = NULL;
   pthread_mutex_lock(&timer_desc.timer_list_mutex);
-  TIMER_SEARCH(timer_p, timer, ((timer_t) timer_id), &timer_desc.timer_queue);
+  hashtable_get(timer_desc.timers, (hash_key_t) timer_id, (void **) &timer_p);
 
   if (timer_p == NULL) {
     OAILOG_ERROR(LOG_ITTI, "Didn't find timer 0x%lx in list\n", timer_id);
@@ -293,15 +473,15 @@ bool timer_exists(long timer_id)
 
 int timer_remove(long timer_id, void **arg)
 {
-  int rc = 0;
-  struct timer_elm_s *timer_p;
+  struct timer_elm_s *timer_p = NULL;
 
   OAILOG_DEBUG(LOG_ITTI, "Removing timer 0x%lx\n", timer_id);
   pthread_mutex_lock(&timer_desc.timer_list_mutex);
-  TIMER_SEARCH(timer_p, timer, ((timer_t) timer_id), &timer_desc.timer_queue);
+  hashtable_remove(
+    timer_desc.timers, (hash_key_t) timer_id, (void **) &timer_p);
 
   /*
-   * We didn't find the timer in list
+   * We didn't find the timer
    */
   if (timer_p == NULL) {
     pthread_mutex_unlock(&timer_desc.timer_list_mutex);
@@ -310,28 +490,52 @@ int timer_remove(long timer_id, void **arg)
     return -1;
   }
 
-  STAILQ_REMOVE(&timer_desc.timer_queue, timer_p, timer_elm_s, entries);
+  _timer_wheel_unlink(timer_p);
   pthread_mutex_unlock(&timer_desc.timer_list_mutex);
 
   // let user of API get back arg that can be an allocated memory (memory leak).
 
   if (arg) *arg = timer_p->timer_arg;
-  if (timer_delete(timer_p->timer) < 0) {
-    OAILOG_ERROR(
-      LOG_ITTI, "Failed to delete timer 0x%lx\n", (long) timer_p->timer);
-    rc = -1;
-  }
-
   free_wrapper((void **) &timer_p);
-  return rc;
+  return 0;
 }
 
 int timer_init(void)
 {
   OAILOG_DEBUG(LOG_ITTI, "Initializing TIMER task interface\n");
   memset(&timer_desc, 0, sizeof(timer_desc_t));
-  STAILQ_INIT(&timer_desc.timer_queue);
+  for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+    for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+      LIST_INIT(&timer_desc.wheel[level][slot]);
+    }
+  }
   pthread_mutex_init(&timer_desc.timer_list_mutex, NULL);
+  clock_gettime(CLOCK_MONOTONIC, &timer_desc.start);
+  timer_desc.current = 1;
+
+  // Timer elements are owned by the wheel, the table only indexes them
+  bstring b = bfromcstr("itti_timers");
+  timer_desc.timers =
+    hashtable_create(TIMER_HASH_INITIAL_SIZE, NULL, hash_free_int_func, b);
+  bdestroy_wrapper(&b);
+  if (!timer_desc.timers) {
+    OAILOG_ERROR(LOG_ITTI, "Failed to create timer table\n");
+    return -1;
+  }
+  timer_desc.timers->log_enabled = false;
+
+  timer_desc.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+  if (timer_desc.timer_fd < 0) {
+    OAILOG_ERROR(
+      LOG_ITTI, "Failed to create timerfd: (%s:%d)\n", strerror(errno), errno);
+    return -1;
+  }
+  if (pthread_create(&timer_desc.thread, NULL, _timer_thread, NULL) != 0) {
+    OAILOG_ERROR(LOG_ITTI, "Failed to create timer thread\n");
+    return -1;
+  }
+  pthread_setname_np(timer_desc.thread, "ITTI_TIMER");
+  pthread_detach(timer_desc.thread);
   OAILOG_DEBUG(LOG_ITTI, "Initializing TIMER task interface: DONE\n");
   return 0;
 }
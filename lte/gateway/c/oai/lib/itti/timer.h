@@ -30,7 +30,6 @@
 #ifndef TIMER_H_
 #define TIMER_H_
 
-#include <signal.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -38,8 +37,6 @@
 
 #include "intertask_interface_types.h"
 
-#define SIGTIMER SIGRTMIN
-
 typedef enum timer_type_s {
   TIMER_PERIODIC,
   TIMER_ONE_SHOT,
@@ -52,9 +49,9 @@ typedef enum {
   TIMER_ERR = -2,
 } timer_result_t;
 
-int timer_handle_signal(siginfo_t *info);
-
 /** \brief Request a new timer
+ *  Expiry is delivered to the task as a TIMER_HAS_EXPIRED message, with a
+ *  resolution of 10 milliseconds.
  *  \param interval_sec timer interval in seconds
  *  \param interval_us  timer interval in micro seconds
  *  \param task_id      task id of the task requesting the timer
@@ -87,10 +87,16 @@ SwitchUpEvent::SwitchUpEvent(
   fluid_base::OFHandler &ofhandler,
   const void *data,
   const size_t len):
-  DataEvent(ofconn, ofhandler, data, len, EVENT_SWITCH_UP)
+  DataEvent(ofconn, ofhandler, data, len, EVENT_SWITCH_UP),
+  time_(std::chrono::steady_clock::now())
 {
 }
 
+std::chrono::steady_clock::time_point SwitchUpEvent::get_time() const
+{
+  return time_;
+}
+
 SwitchDownEvent::SwitchDownEvent(fluid_base::OFConnection *ofconn):
   ControllerEvent(ofconn, EVENT_SWITCH_DOWN)
 {
@@ -99,8 +105,19 @@ SwitchDownEvent::SwitchDownEvent(fluid_base::OFConnection *ofconn):
 ErrorEvent::ErrorEvent(
   fluid_base::OFConnection *ofconn,
   const struct ofp_error_msg *error_msg):
+  ErrorEvent(ofconn, error_msg, nullptr, {})
+{
+}
+
+ErrorEvent::ErrorEvent(
+  fluid_base::OFConnection *ofconn,
+  const struct ofp_error_msg *error_msg,
+  std::shared_ptr<ExternalEvent> origin,
+  const std::vector<uint8_t> &rejected_msg):
   error_type_(ntohs(error_msg->type)),
   error_code_(ntohs(error_msg->code)),
+  origin_(origin),
+  rejected_msg_(rejected_msg),
   ControllerEvent(ofconn, EVENT_ERROR)
 {
 }
@@ -115,7 +132,19 @@ const uint16_t ErrorEvent::get_error_code() const
   return error_code_;
 }
 
+const std::shared_ptr<ExternalEvent> &ErrorEvent::get_origin() const
+{
+  return origin_;
+}
+
+const std::vector<uint8_t> &ErrorEvent::get_rejected_msg() const
+{
+  return rejected_msg_;
+}
+
 ExternalEvent::ExternalEvent(const ControllerEventType type):
+  retries_(0),
+  generation_(0),
   ControllerEvent(NULL, type)
 {
 }
@@ -125,6 +154,26 @@ void ExternalEvent::set_of_connection(fluid_base::OFConnection *ofconn)
   ofconn_ = ofconn;
 }
 
+const uint32_t ExternalEvent::get_retries() const
+{
+  return retries_;
+}
+
+void ExternalEvent::increment_retries()
+{
+  retries_++;
+}
+
+const uint64_t ExternalEvent::get_generation() const
+{
+  return generation_;
+}
+
+void ExternalEvent::set_generation(uint64_t generation) const
+{
+  generation_ = generation;
+}
+
 AddGTPTunnelEvent::AddGTPTunnelEvent(
     const struct in_addr ue_ip,
     const struct in_addr enb_ip,
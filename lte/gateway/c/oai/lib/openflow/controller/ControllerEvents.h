@@ -22,6 +22,9 @@
 #pragma once
 
 #include <arpa/inet.h>
+#include <chrono>
+#include <memory>
+#include <vector>
 #include <fluid/OFServer.hh>
 #include <fluid/ofcommon/openflow-common.hh>
 #include "gtpv1u.h"
@@ -110,6 +113,12 @@ class SwitchUpEvent : public DataEvent {
     fluid_base::OFHandler &ofhandler,
     const void *data,
     const size_t len);
+
+  // When the switch came up, to measure how long reconciliation takes
+  std::chrono::steady_clock::time_point get_time() const;
+
+ private:
+  const std::chrono::steady_clock::time_point time_;
 };
 
 /**
@@ -120,6 +129,37 @@ class SwitchDownEvent : public ControllerEvent {
   SwitchDownEvent(fluid_base::OFConnection *ofconn);
 };
 
+/*
+ * Event triggered externally, so it allows for delayed assignment of the
+ * openflow connection. This way, the controller can set the latest known
+ * connection, instead of an external file
+ */
+class ExternalEvent : public ControllerEvent {
+ public:
+  ExternalEvent(const ControllerEventType type);
+
+  void set_of_connection(fluid_base::OFConnection *ofconn);
+
+  /*
+   * Number of times the event was handled again after the switch rejected
+   * one of its messages
+   */
+  const uint32_t get_retries() const;
+  void increment_retries();
+
+  /*
+   * Generation of the application state the event left behind when it was
+   * handled, so that a retry can tell whether a later event superseded it.
+   * Applications stamp it while handling the event, hence the const setter
+   */
+  const uint64_t get_generation() const;
+  void set_generation(uint64_t generation) const;
+
+ private:
+  uint32_t retries_;
+  mutable uint64_t generation_;
+};
+
 /**
  * Event triggered when there is an openflow error reported from the switch
  */
@@ -129,24 +169,34 @@ class ErrorEvent : public ControllerEvent {
     fluid_base::OFConnection *ofconn,
     const struct ofp_error_msg *error_msg);
 
+  /*
+   * @param origin - external event that sent the rejected message
+   * @param rejected_msg - packed rejected message
+   */
+  ErrorEvent(
+    fluid_base::OFConnection *ofconn,
+    const struct ofp_error_msg *error_msg,
+    std::shared_ptr<ExternalEvent> origin,
+    const std::vector<uint8_t> &rejected_msg);
+
   const uint16_t get_error_type() const;
   const uint16_t get_error_code() const;
+  /*
+   * Returns the external event that sent the rejected message, or nullptr if
+   * the message was not sent on behalf of one
+   */
+  const std::shared_ptr<ExternalEvent> &get_origin() const;
+  /*
+   * Returns the packed message the switch rejected, or an empty buffer if it
+   * is not known
+   */
+  const std::vector<uint8_t> &get_rejected_msg() const;
 
  private:
   const uint16_t error_type_;
   const uint16_t error_code_;
-};
-
-/*
- * Event triggered externally, so it allows for delayed assignment of the
- * openflow connection. This way, the controller can set the latest known
- * connection, instead of an external file
- */
-class ExternalEvent : public ControllerEvent {
- public:
-  ExternalEvent(const ControllerEventType type);
-
-  void set_of_connection(fluid_base::OFConnection *ofconn);
+  const std::shared_ptr<ExternalEvent> origin_;
+  const std::vector<uint8_t> rejected_msg_;
 };
 
 /*
@@ -41,7 +41,8 @@ int start_of_controller(void)
   static openflow::GTPApplication gtp_app(
     std::string(bdata(spgw_config.sgw_config.ovs_config.uplink_mac)),
     spgw_config.sgw_config.ovs_config.gtp_port_num);
-  // Base app registers first, because it deletes/creates default flow
+  // Base app registers first, because it deletes/creates default flow. The GTP
+  // app reinstalls the tunnel flows it knows about after that
   ctrl.register_for_event(&base_app, openflow::EVENT_SWITCH_UP);
   ctrl.register_for_event(&base_app, openflow::EVENT_ERROR);
   ctrl.register_for_event(&paging_app, openflow::EVENT_PACKET_IN);
@@ -50,6 +51,8 @@ int start_of_controller(void)
   ctrl.register_for_event(&gtp_app, openflow::EVENT_DELETE_GTP_TUNNEL);
   ctrl.register_for_event(&gtp_app, openflow::EVENT_DISCARD_DATA_ON_GTP_TUNNEL);
   ctrl.register_for_event(&gtp_app, openflow::EVENT_FORWARD_DATA_ON_GTP_TUNNEL);
+  ctrl.register_for_event(&gtp_app, openflow::EVENT_ERROR);
+  ctrl.register_for_event(&gtp_app, openflow::EVENT_SWITCH_UP);
   ctrl.start();
   OAILOG_INFO(LOG_GTPV1U, "Started openflow controller\n");
   return 0;
@@ -21,11 +21,15 @@
 
 #include <netinet/ip.h>
 #include <arpa/inet.h>
+#include <chrono>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "GTPApplication.h"
 #include "IMSIEncoder.h"
 #include "gtpv1u.h"
+#include "service303.h"
 
 extern "C" {
 #include "log.h"
@@ -42,7 +46,8 @@ GTPApplication::GTPApplication(
   const std::string &uplink_mac,
   uint32_t gtp_port_num):
   uplink_mac_(uplink_mac),
-  gtp_port_num_(gtp_port_num)
+  gtp_port_num_(gtp_port_num),
+  last_generation_(0)
 {
 }
 
@@ -50,6 +55,7 @@ void GTPApplication::event_callback(
   const ControllerEvent &ev,
   const OpenflowMessenger &messenger)
 {
+  update_shadow_table(ev);
   if (ev.get_type() == EVENT_ADD_GTP_TUNNEL) {
     auto add_tunnel_event = static_cast<const AddGTPTunnelEvent &>(ev);
     add_uplink_tunnel_flow(add_tunnel_event, messenger);
@@ -68,9 +74,176 @@ void GTPApplication::event_callback(
       static_cast<const HandleDataOnGTPTunnelEvent &>(ev);
     forward_uplink_tunnel_flow(forward_tunnel_flow, messenger);
     forward_downlink_tunnel_flow(forward_tunnel_flow, messenger);
+  } else if (ev.get_type() == EVENT_ERROR) {
+    retry_tunnel_event(static_cast<const ErrorEvent &>(ev), messenger);
+  } else if (ev.get_type() == EVENT_SWITCH_UP) {
+    reinstall_tunnel_flows(static_cast<const SwitchUpEvent &>(ev), messenger);
   }
 }
 
+void GTPApplication::update_shadow_table(const ControllerEvent &ev)
+{
+  std::lock_guard<std::mutex> lock(tunnels_mutex_);
+  if (ev.get_type() == EVENT_ADD_GTP_TUNNEL) {
+    auto &add_tunnel_event = static_cast<const AddGTPTunnelEvent &>(ev);
+    TunnelFlows &tunnel = tunnels_[add_tunnel_event.get_in_tei()];
+    tunnel.ue_ip = add_tunnel_event.get_ue_ip();
+    tunnel.enb_ip = add_tunnel_event.get_enb_ip();
+    tunnel.out_tei = add_tunnel_event.get_out_tei();
+    tunnel.imsi = IMSIEncoder::compact_imsi(add_tunnel_event.get_imsi());
+    tunnel.dl_flow_valid = add_tunnel_event.is_dl_flow_valid();
+    if (tunnel.dl_flow_valid) {
+      tunnel.dl_flow = add_tunnel_event.get_dl_flow();
+    }
+    tunnel.discarding = false;
+    tunnel.generation = ++last_generation_;
+    add_tunnel_event.set_generation(tunnel.generation);
+  } else if (ev.get_type() == EVENT_DELETE_GTP_TUNNEL) {
+    auto &del_tunnel_event = static_cast<const DeleteGTPTunnelEvent &>(ev);
+    tunnels_.erase(del_tunnel_event.get_in_tei());
+    del_tunnel_event.set_generation(0);
+  } else if (
+    ev.get_type() == EVENT_DISCARD_DATA_ON_GTP_TUNNEL ||
+    ev.get_type() == EVENT_FORWARD_DATA_ON_GTP_TUNNEL) {
+    auto &tunnel_flow = static_cast<const HandleDataOnGTPTunnelEvent &>(ev);
+    auto it = tunnels_.find(tunnel_flow.get_in_tei());
+    if (it != tunnels_.end()) {
+      it->second.discarding =
+        ev.get_type() == EVENT_DISCARD_DATA_ON_GTP_TUNNEL;
+      it->second.generation = ++last_generation_;
+      tunnel_flow.set_generation(it->second.generation);
+    } else {
+      tunnel_flow.set_generation(0);
+    }
+  }
+}
+
+void GTPApplication::reinstall_tunnel_flows(
+  const SwitchUpEvent &ev,
+  const OpenflowMessenger &messenger)
+{
+  std::lock_guard<std::mutex> lock(tunnels_mutex_);
+  fluid_base::OFConnection *ofconn = ev.get_connection();
+  for (auto it = tunnels_.begin(); it != tunnels_.end(); it++) {
+    const TunnelFlows &tunnel = it->second;
+    std::string imsi = IMSIEncoder::expand_imsi(tunnel.imsi);
+    std::unique_ptr<AddGTPTunnelEvent> add_tunnel(
+      tunnel.dl_flow_valid ?
+        new AddGTPTunnelEvent(
+          tunnel.ue_ip,
+          tunnel.enb_ip,
+          it->first,
+          tunnel.out_tei,
+          imsi.c_str(),
+          &tunnel.dl_flow) :
+        new AddGTPTunnelEvent(
+          tunnel.ue_ip,
+          tunnel.enb_ip,
+          it->first,
+          tunnel.out_tei,
+          imsi.c_str()));
+    add_tunnel->set_of_connection(ofconn);
+    add_uplink_tunnel_flow(*add_tunnel, messenger);
+    add_downlink_tunnel_flow(*add_tunnel, messenger);
+
+    if (tunnel.discarding) {
+      std::unique_ptr<HandleDataOnGTPTunnelEvent> discard_tunnel(
+        tunnel.dl_flow_valid ?
+          new HandleDataOnGTPTunnelEvent(
+            tunnel.ue_ip,
+            it->first,
+            EVENT_DISCARD_DATA_ON_GTP_TUNNEL,
+            &tunnel.dl_flow) :
+          new HandleDataOnGTPTunnelEvent(
+            tunnel.ue_ip, it->first, EVENT_DISCARD_DATA_ON_GTP_TUNNEL));
+      discard_tunnel->set_of_connection(ofconn);
+      discard_uplink_tunnel_flow(*discard_tunnel, messenger);
+      discard_downlink_tunnel_flow(*discard_tunnel, messenger);
+    }
+  }
+  size_t tunnels_number = tunnels_.size();
+  set_gauge("openflow_reconciled_tunnels", tunnels_number, NO_LABELS);
+  // The switch has processed every flow once it replies to the barrier
+  auto switch_up_time = ev.get_time();
+  messenger.call_after_barrier(ofconn, [switch_up_time, tunnels_number]() {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - switch_up_time);
+    OAILOG_INFO(
+      LOG_GTPV1U,
+      "Reinstalled flows of %zu tunnels in %lld ms\n",
+      tunnels_number,
+      (long long) elapsed.count());
+    set_gauge("openflow_reconciliation_ms", elapsed.count(), NO_LABELS);
+  });
+}
+
+void GTPApplication::retry_tunnel_event(
+  const ErrorEvent &ev,
+  const OpenflowMessenger &messenger)
+{
+  const std::shared_ptr<ExternalEvent> &origin = ev.get_origin();
+  if (origin == nullptr) {
+    return;
+  }
+  uint32_t in_tei;
+  switch (origin->get_type()) {
+    case EVENT_ADD_GTP_TUNNEL:
+      in_tei = static_cast<const AddGTPTunnelEvent &>(*origin).get_in_tei();
+      break;
+    case EVENT_DELETE_GTP_TUNNEL:
+      in_tei = static_cast<const DeleteGTPTunnelEvent &>(*origin).get_in_tei();
+      break;
+    case EVENT_DISCARD_DATA_ON_GTP_TUNNEL:
+    case EVENT_FORWARD_DATA_ON_GTP_TUNNEL:
+      in_tei =
+        static_cast<const HandleDataOnGTPTunnelEvent &>(*origin).get_in_tei();
+      break;
+    default: return;
+  }
+  // Only the flow mod the switch rejected is sent again
+  std::vector<uint8_t> rejected_msg = ev.get_rejected_msg();
+  if (
+    rejected_msg.size() < sizeof(struct ofp_header) ||
+    reinterpret_cast<struct ofp_header *>(rejected_msg.data())->type !=
+      of13::OFPT_FLOW_MOD) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(tunnels_mutex_);
+  auto it = tunnels_.find(in_tei);
+  uint64_t generation = it == tunnels_.end() ? 0 : it->second.generation;
+  if (generation != origin->get_generation()) {
+    // Sending the flow again would undo the later event
+    OAILOG_DEBUG(
+      LOG_GTPV1U,
+      "Dropping retry of tunnel event %d superseded on TEID %u\n",
+      origin->get_type(),
+      in_tei);
+    return;
+  }
+  if (origin->get_retries() >= MAX_TUNNEL_RETRIES) {
+    OAILOG_ERROR(
+      LOG_GTPV1U,
+      "Giving up on tunnel event %d after %u retries\n",
+      origin->get_type(),
+      origin->get_retries());
+    increment_counter("openflow_tunnel_failure", 1, NO_LABELS);
+    return;
+  }
+  origin->increment_retries();
+  OAILOG_WARNING(
+    LOG_GTPV1U,
+    "Retrying tunnel event %d rejected by the switch, retry %u\n",
+    origin->get_type(),
+    origin->get_retries());
+  of13::FlowMod flow_mod;
+  if (flow_mod.unpack(rejected_msg.data()) != 0) {
+    return;
+  }
+  // The flow is sent on the error connection, the tunnel one may be gone
+  messenger.send_of_msg(flow_mod, ev.get_connection());
+}
+
 /*
  * Helper method to add matching for adding/deleting the uplink flow
  */
@@ -22,6 +22,8 @@
 #pragma once
 
 #include <gmp.h> // gross but necessary to link spgw_config.h
+#include <mutex>
+#include <unordered_map>
 
 #include "OpenflowController.h"
 
@@ -29,7 +31,8 @@ namespace openflow {
 
 /**
  * GTPApplication handles external callbacks to add/delete tunnel flows for a
- * UE when it connects
+ * UE when it connects. It keeps a shadow of the tunnels it installed, so that
+ * they can be reinstalled at once when the switch reconnects
  */
 class GTPApplication : public Application {
  public:
@@ -109,13 +112,62 @@ class GTPApplication : public Application {
     const HandleDataOnGTPTunnelEvent &ev,
     const OpenflowMessenger &messenger);
 
+  /*
+   * Record the tunnel flows added, deleted or suspended by an event in the
+   * shadow table, and stamp the event with the new generation of its tunnel
+   * @param ev - tunnel event that was just handled
+   */
+  void update_shadow_table(const ControllerEvent &ev);
+
+  /*
+   * Reinstall all the tunnel flows of the shadow table on a switch which lost
+   * them, e.g. after it restarted. The flows go out in a single write when
+   * the switch up event is flushed, and reconciliation is over when the
+   * switch replies to the barrier closing that write
+   * @param ev - SwitchUpEvent of the switch that came up
+   */
+  void reinstall_tunnel_flows(
+    const SwitchUpEvent &ev,
+    const OpenflowMessenger &messenger);
+
+  /*
+   * Send a rejected flow of a tunnel event again, up to MAX_TUNNEL_RETRIES
+   * times per event. The retry is dropped if a later event changed the
+   * tunnel since, e.g. deleted it
+   * @param ev - ErrorEvent carrying the tunnel event that sent the flow
+   */
+  void retry_tunnel_event(
+    const ErrorEvent &ev,
+    const OpenflowMessenger &messenger);
+
  private:
   static const uint32_t DEFAULT_PRIORITY = 10;
+  static const uint32_t MAX_TUNNEL_RETRIES = 3;
   static const std::string GTP_PORT_MAC;
   static const uint16_t NEXT_TABLE = 1;
 
+  /*
+   * Flows of a tunnel, the uplink one matching its incoming TEID and the
+   * downlink one matching the UE IP or the dedicated bearer flow
+   */
+  struct TunnelFlows {
+    struct in_addr ue_ip;
+    struct in_addr enb_ip;
+    uint32_t out_tei;
+    uint64_t imsi; // compacted by IMSIEncoder
+    struct ipv4flow_dl dl_flow;
+    bool dl_flow_valid;
+    bool discarding; // data is dropped while the UE is suspended
+    uint64_t generation; // bumped by every event on the tunnel
+  };
+
   const std::string uplink_mac_;
   const uint32_t gtp_port_num_;
+  // Shadow table of the installed tunnels, by incoming TEID
+  std::mutex tunnels_mutex_;
+  std::unordered_map<uint32_t, TunnelFlows> tunnels_;
+  // Generations are never reused, 0 stands for a tunnel not in the table
+  uint64_t last_generation_;
   /* cookie is added to identify the rules enforced for the flow controller
    * Initialising with 1
    */
@@ -29,6 +29,12 @@ using namespace fluid_msg;
 
 namespace openflow {
 
+namespace {
+// Set while the event loop thread handles a batch of external events, whose
+// messages are flushed once the whole batch is handled
+thread_local bool handling_pending_events = false;
+} // namespace
+
 OpenflowController::OpenflowController(
   const char *address,
   const int port,
@@ -90,18 +96,44 @@ void OpenflowController::message_callback(
     // Save OF connection for external events
     latest_ofconn_ = ofconn;
     dispatch_event(SwitchUpEvent(ofconn, *this, data, len));
+    // Events injected while the switch was down were scheduled on the lost
+    // connection
+    std::lock_guard<std::mutex> lock(pending_events_mutex_);
+    if (not pending_events_.empty()) {
+      ofconn->add_immediate_event(
+        handle_pending_events, std::shared_ptr<void>(this, [](void *) {}));
+    }
   } else if (type == OFPT_ERROR) {
-    dispatch_event(
-      ErrorEvent(ofconn, reinterpret_cast<struct ofp_error_msg *>(data)));
+    dispatch_error(ofconn, reinterpret_cast<struct ofp_error_msg *>(data));
+    free_data(data);
+  } else if (type == OFPT_BARRIER_REPLY_TYPE) {
+    auto header = reinterpret_cast<struct ofp_header *>(data);
+    messenger_->complete_transactions(ofconn, ntohl(header->xid));
+    free_data(data);
   }
 }
 
+void OpenflowController::dispatch_error(
+  OFConnection *ofconn,
+  const struct ofp_error_msg *error_msg)
+{
+  // The switch echoes the xid of the message it rejected
+  uint32_t xid = ntohl(error_msg->header.xid);
+  auto origin = messenger_->get_origin(ofconn, xid);
+  auto rejected_msg = messenger_->get_message(ofconn, xid);
+  // Messages sent again while handling the error belong to the same event
+  messenger_->set_origin(origin);
+  dispatch_event(ErrorEvent(ofconn, error_msg, origin, rejected_msg));
+  messenger_->set_origin(nullptr);
+}
+
 void OpenflowController::connection_callback(
   OFConnection *ofconn,
   OFConnection::Event type)
 {
   if (type == OFConnection::EVENT_CLOSED || type == OFConnection::EVENT_DEAD) {
     OAILOG_ERROR(LOG_GTPV1U, "Openflow controller lost connection to switch\n");
+    messenger_->remove_connection(ofconn);
     dispatch_event(SwitchDownEvent(ofconn));
   }
 }
@@ -117,6 +149,9 @@ void OpenflowController::dispatch_event(const ControllerEvent &ev)
   for (auto it = listeners.begin(); it != listeners.end(); it++) {
     ((Application *) (*it))->event_callback(ev, *messenger_);
   }
+  if (not handling_pending_events) {
+    messenger_->flush();
+  }
 }
 
 void OpenflowController::inject_external_event(
@@ -126,8 +161,33 @@ void OpenflowController::inject_external_event(
   if (latest_ofconn_ == NULL) {
     throw std::runtime_error("Controller not connected to switch\n");
   }
-  ev->set_of_connection(latest_ofconn_);
-  latest_ofconn_->add_immediate_event(cb, ev);
+  std::lock_guard<std::mutex> lock(pending_events_mutex_);
+  pending_events_.emplace_back(ev, cb);
+  if (pending_events_.size() == 1) {
+    // The controller outlives its event loop, so the event does not own it
+    latest_ofconn_->add_immediate_event(
+      handle_pending_events, std::shared_ptr<void>(this, [](void *) {}));
+  }
+}
+
+void *OpenflowController::handle_pending_events(std::shared_ptr<void> data)
+{
+  auto ctrl = static_cast<OpenflowController *>(data.get());
+  std::vector<PendingEvent> events;
+  {
+    std::lock_guard<std::mutex> lock(ctrl->pending_events_mutex_);
+    events.swap(ctrl->pending_events_);
+  }
+  handling_pending_events = true;
+  for (auto it = events.begin(); it != events.end(); it++) {
+    it->first->set_of_connection(ctrl->latest_ofconn_);
+    ctrl->messenger_->set_origin(it->first);
+    it->second(it->first);
+  }
+  ctrl->messenger_->set_origin(nullptr);
+  handling_pending_events = false;
+  ctrl->messenger_->flush();
+  return NULL;
 }
 
 } // namespace openflow
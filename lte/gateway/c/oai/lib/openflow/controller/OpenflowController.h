@@ -23,6 +23,8 @@
 
 #include <unordered_map>
 #include <list>
+#include <mutex>
+#include <vector>
 
 #include <fluid/OFServer.hh>
 
@@ -46,7 +48,8 @@ class Application {
 enum OF_MESSAGE_TYPES {
   OFPT_ERROR = 1,
   OFPT_FEATURES_REPLY_TYPE = 6,
-  OFPT_PACKET_IN_TYPE = 10
+  OFPT_PACKET_IN_TYPE = 10,
+  OFPT_BARRIER_REPLY_TYPE = 21
 };
 
 class OpenflowController : public fluid_base::OFServer {
@@ -113,7 +116,9 @@ class OpenflowController : public fluid_base::OFServer {
 
   /**
    * Send an event to all applications. This can be used outside of the event
-   * loop as well to trigger external events.
+   * loop as well to trigger external events. The messages sent by the
+   * applications are flushed to the switch once they all handled the event,
+   * unless the event is part of a batch of external events.
    *
    * @param ev - reference to ControllerEvent subclass that just occurred
    */
@@ -122,7 +127,9 @@ class OpenflowController : public fluid_base::OFServer {
   /**
    * This function can be called by another thread to inject an external event
    * into the main event loop. This can be used for non-standard openflow events
-   * like adding a gtp tunnel flow
+   * like adding a gtp tunnel flow. The events injected before the event loop
+   * gets to them are handled as one batch, whose messages are flushed to the
+   * switch in a single write.
    * @param ev - shared_ptr to ExternalEvent subclass that is to be handled by
    *             the event loop. This needs to be a pointer because it will be
    *             handled indirectly by another thread.
@@ -134,11 +141,33 @@ class OpenflowController : public fluid_base::OFServer {
     std::shared_ptr<ExternalEvent> ev,
     void *(*cb)(std::shared_ptr<void>) );
 
+ private:
+  typedef std::pair<
+    std::shared_ptr<ExternalEvent>,
+    void *(*) (std::shared_ptr<void>)>
+    PendingEvent;
+
+  /**
+   * Event loop callback handling all the injected external events, with data
+   * pointing to the controller
+   */
+  static void *handle_pending_events(std::shared_ptr<void> data);
+
+  /**
+   * Dispatch an OFPT_ERROR to the applications, along with the external event
+   * that sent the rejected message if it is still known
+   */
+  void dispatch_error(
+    fluid_base::OFConnection *ofconn,
+    const struct ofp_error_msg *error_msg);
+
  private:
   std::shared_ptr<OpenflowMessenger> messenger_;
   std::unordered_map<uint32_t, std::vector<Application *>> event_listeners;
   bool running_;
   fluid_base::OFConnection *latest_ofconn_;
+  std::mutex pending_events_mutex_;
+  std::vector<PendingEvent> pending_events_;
 };
 
 } // namespace openflow
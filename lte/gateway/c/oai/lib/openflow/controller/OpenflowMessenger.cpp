@@ -23,6 +23,8 @@
 
 namespace openflow {
 
+DefaultMessenger::DefaultMessenger(): xid_(0) {}
+
 fluid_msg::of13::FlowMod DefaultMessenger::create_default_flow_mod(
   uint8_t table_id,
   fluid_msg::of13::ofp_flow_mod_command command,
@@ -30,7 +32,7 @@ fluid_msg::of13::FlowMod DefaultMessenger::create_default_flow_mod(
 {
   fluid_msg::of13::FlowMod fm;
   // Defaults
-  fm.xid(1);                          // Transaction id, can be anything
+  fm.xid(1);                          // Transaction id, set on send
   fm.cookie(0);                       // Not used
   fm.cookie_mask(0xffffffffffffffff); // Not used
   fm.buffer_id(OFP_NO_BUFFER);        // Not used
@@ -45,15 +47,152 @@ fluid_msg::of13::FlowMod DefaultMessenger::create_default_flow_mod(
   return fm;
 }
 
+uint32_t DefaultMessenger::next_xid() const
+{
+  // 0 is left out so that it never names a transaction
+  if (++xid_ == 0) {
+    ++xid_;
+  }
+  return xid_;
+}
+
 void DefaultMessenger::send_of_msg(
   fluid_msg::OFMsg &of_msg,
   fluid_base::OFConnection *ofconn) const
 {
-  uint8_t *buffer;
-  buffer = of_msg.pack();
-  ofconn->send(buffer, of_msg.length());
-  // TODO OF_ERROR_HANDLING - check if OF message successfully installed
+  std::lock_guard<std::mutex> lock(mutex_);
+  of_msg.xid(next_xid());
+  uint8_t *buffer = of_msg.pack();
+  if (origin_ != nullptr) {
+    transactions_[of_msg.xid()] = {
+      ofconn, origin_, {buffer, buffer + of_msg.length()}};
+  }
+  auto &pending = pending_[ofconn];
+  pending.insert(pending.end(), buffer, buffer + of_msg.length());
   fluid_msg::OFMsg::free_buffer(buffer);
 }
 
+void DefaultMessenger::set_origin(std::shared_ptr<ExternalEvent> origin) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  origin_ = origin;
+}
+
+void DefaultMessenger::flush() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &it : pending_) {
+    auto callbacks = flush_callbacks_.find(it.first);
+    // A barrier is still sent without messages if someone waits for it
+    if (it.second.empty() && callbacks == flush_callbacks_.end()) {
+      continue;
+    }
+    fluid_msg::of13::BarrierRequest barrier(next_xid());
+    if (callbacks != flush_callbacks_.end()) {
+      for (auto &callback : callbacks->second) {
+        barrier_callbacks_.push_back(
+          {it.first, barrier.xid(), std::move(callback)});
+      }
+      flush_callbacks_.erase(callbacks);
+    }
+    uint8_t *buffer = barrier.pack();
+    it.second.insert(it.second.end(), buffer, buffer + barrier.length());
+    fluid_msg::OFMsg::free_buffer(buffer);
+
+    it.first->send(it.second.data(), it.second.size());
+    it.second.clear();
+  }
+}
+
+std::shared_ptr<ExternalEvent> DefaultMessenger::get_origin(
+  fluid_base::OFConnection *ofconn,
+  uint32_t xid) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = transactions_.find(xid);
+  if (it == transactions_.end() || it->second.ofconn != ofconn) {
+    return nullptr;
+  }
+  return it->second.origin;
+}
+
+std::vector<uint8_t> DefaultMessenger::get_message(
+  fluid_base::OFConnection *ofconn,
+  uint32_t xid) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = transactions_.find(xid);
+  if (it == transactions_.end() || it->second.ofconn != ofconn) {
+    return {};
+  }
+  return it->second.message;
+}
+
+void DefaultMessenger::complete_transactions(
+  fluid_base::OFConnection *ofconn,
+  uint32_t barrier_xid) const
+{
+  std::vector<std::function<void()>> callbacks;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = transactions_.begin(); it != transactions_.end();) {
+      // Compare modulo 2^32, the xids wrap around
+      if (
+        it->second.ofconn == ofconn &&
+        static_cast<int32_t>(it->first - barrier_xid) < 0) {
+        it = transactions_.erase(it);
+      } else {
+        it++;
+      }
+    }
+    for (auto it = barrier_callbacks_.begin();
+         it != barrier_callbacks_.end();) {
+      if (
+        it->ofconn == ofconn &&
+        static_cast<int32_t>(it->barrier_xid - barrier_xid) <= 0) {
+        callbacks.push_back(std::move(it->callback));
+        it = barrier_callbacks_.erase(it);
+      } else {
+        it++;
+      }
+    }
+  }
+  // The callbacks may send messages, which takes the lock again
+  for (auto &callback : callbacks) {
+    callback();
+  }
+}
+
+void DefaultMessenger::call_after_barrier(
+  fluid_base::OFConnection *ofconn,
+  std::function<void()> callback) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Make sure flush visits the connection even if nothing else is queued
+  pending_[ofconn];
+  flush_callbacks_[ofconn].push_back(std::move(callback));
+}
+
+void DefaultMessenger::remove_connection(
+  fluid_base::OFConnection *ofconn) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_.erase(ofconn);
+  for (auto it = transactions_.begin(); it != transactions_.end();) {
+    if (it->second.ofconn == ofconn) {
+      it = transactions_.erase(it);
+    } else {
+      it++;
+    }
+  }
+  flush_callbacks_.erase(ofconn);
+  for (auto it = barrier_callbacks_.begin(); it != barrier_callbacks_.end();) {
+    if (it->ofconn == ofconn) {
+      it = barrier_callbacks_.erase(it);
+    } else {
+      it++;
+    }
+  }
+}
+
 } // namespace openflow
@@ -21,10 +21,18 @@
 
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 #include <fluid/of10msg.hh>
 #include <fluid/of13msg.hh>
 #include <fluid/OFServer.hh>
 
+#include "ControllerEvents.h"
+
 namespace openflow {
 /**
  * Abstract helper class with libfluid message utilities
@@ -48,7 +56,8 @@ class OpenflowMessenger {
   }
 
   /**
-   * Sends a completed flow modification to OVS
+   * Sends a completed flow modification to OVS. The message may be queued
+   * until the next flush.
    *
    * @param flow_mod - a flow modification (add/delete) to make
    * @param ofconn - the connection to send the flow mod to
@@ -58,13 +67,95 @@ class OpenflowMessenger {
     fluid_base::OFConnection *ofconn) const
   {
   }
+
+  /**
+   * Attribute the messages sent from now on to an external event, so that an
+   * error reported by the switch for one of them can be traced back to it
+   *
+   * @param origin - event being handled, or nullptr once it is done
+   */
+  virtual void set_origin(std::shared_ptr<ExternalEvent> origin) const {}
+
+  /**
+   * Write out all the queued messages, one write per connection terminated by
+   * a barrier request
+   */
+  virtual void flush() const {}
+
+  /**
+   * Look up the event that sent a message which has not been acknowledged by
+   * a barrier reply yet
+   *
+   * @param ofconn - the connection the message was sent on
+   * @param xid - transaction id of the message, e.g. from an OFPT_ERROR
+   * @return the originating event, or nullptr if there is none
+   */
+  virtual std::shared_ptr<ExternalEvent> get_origin(
+    fluid_base::OFConnection *ofconn,
+    uint32_t xid) const
+  {
+    return nullptr;
+  }
+
+  /**
+   * Look up a message sent on behalf of an external event which has not been
+   * acknowledged by a barrier reply yet
+   *
+   * @param ofconn - the connection the message was sent on
+   * @param xid - transaction id of the message, e.g. from an OFPT_ERROR
+   * @return the packed message, or an empty buffer if there is none
+   */
+  virtual std::vector<uint8_t> get_message(
+    fluid_base::OFConnection *ofconn,
+    uint32_t xid) const
+  {
+    return {};
+  }
+
+  /**
+   * Forget the messages answered by a barrier reply. The switch reports the
+   * errors of a message before replying to a later barrier, so they have all
+   * been installed.
+   *
+   * @param ofconn - the connection the barrier reply was received on
+   * @param barrier_xid - transaction id of the barrier reply
+   */
+  virtual void complete_transactions(
+    fluid_base::OFConnection *ofconn,
+    uint32_t barrier_xid) const
+  {
+  }
+
+  /**
+   * Call back once the switch replied to the barrier closing the messages
+   * queued on the connection so far, i.e. once it processed all of them. The
+   * callback runs on the event loop thread, from complete_transactions
+   *
+   * @param ofconn - the connection the messages are queued on
+   * @param callback - function to call on the barrier reply
+   */
+  virtual void call_after_barrier(
+    fluid_base::OFConnection *ofconn,
+    std::function<void()> callback) const
+  {
+  }
+
+  /**
+   * Drop the queued messages, transactions and barrier callbacks of a closed
+   * connection
+   */
+  virtual void remove_connection(fluid_base::OFConnection *ofconn) const {}
 };
 
 /**
- * Implemented messenger class
+ * Implemented messenger class. Messages are packed into a per connection
+ * buffer and written out by flush(), so that all the flow mods of an event
+ * loop iteration cost a single write and a single barrier.
  */
 class DefaultMessenger : public OpenflowMessenger {
  public:
+  DefaultMessenger();
+
   fluid_msg::of13::FlowMod create_default_flow_mod(
     uint8_t table_id,
     fluid_msg::of13::ofp_flow_mod_command command,
@@ -72,6 +163,61 @@ class DefaultMessenger : public OpenflowMessenger {
 
   void send_of_msg(fluid_msg::OFMsg &of_msg, fluid_base::OFConnection *ofconn)
     const;
+
+  void set_origin(std::shared_ptr<ExternalEvent> origin) const;
+
+  void flush() const;
+
+  std::shared_ptr<ExternalEvent> get_origin(
+    fluid_base::OFConnection *ofconn,
+    uint32_t xid) const;
+
+  std::vector<uint8_t> get_message(
+    fluid_base::OFConnection *ofconn,
+    uint32_t xid) const;
+
+  void complete_transactions(
+    fluid_base::OFConnection *ofconn,
+    uint32_t barrier_xid) const;
+
+  void call_after_barrier(
+    fluid_base::OFConnection *ofconn,
+    std::function<void()> callback) const;
+
+  void remove_connection(fluid_base::OFConnection *ofconn) const;
+
+ private:
+  struct Transaction {
+    fluid_base::OFConnection *ofconn;
+    std::shared_ptr<ExternalEvent> origin;
+    // Kept so that the message alone can be sent again if it is rejected
+    std::vector<uint8_t> message;
+  };
+
+  struct BarrierCallback {
+    fluid_base::OFConnection *ofconn;
+    uint32_t barrier_xid;
+    std::function<void()> callback;
+  };
+
+  uint32_t next_xid() const;
+
+  // The messenger is shared as const by all the applications, the sending
+  // state below is not part of its logical value
+  mutable std::mutex mutex_;
+  mutable uint32_t xid_;
+  mutable std::shared_ptr<ExternalEvent> origin_;
+  mutable std::unordered_map<fluid_base::OFConnection *, std::vector<uint8_t>>
+    pending_;
+  // Messages sent on behalf of an external event, by xid
+  mutable std::unordered_map<uint32_t, Transaction> transactions_;
+  // Callbacks waiting for the next flush of their connection
+  mutable std::unordered_map<
+    fluid_base::OFConnection *,
+    std::vector<std::function<void()>>>
+    flush_callbacks_;
+  // Callbacks waiting for the reply to a barrier already sent
+  mutable std::vector<BarrierCallback> barrier_callbacks_;
 };
 
 } // namespace openflow
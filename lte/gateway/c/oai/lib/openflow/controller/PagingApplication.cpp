@@ -24,6 +24,7 @@
 #include "OpenflowController.h"
 #include "PagingApplication.h"
 #include "rpc_client.h"
+#include "service303.h"
 
 extern "C" {
 #include "log.h"
@@ -43,6 +44,15 @@ uint32_t prefix2mask(int prefix)
   }
 }
 
+PagingApplication::PagingApplication():
+  recent_pagings_(std::chrono::seconds(CLAMPING_TIMEOUT)),
+  suppressed_pagings_(0),
+  send_scheduled_(false),
+  pending_ofconn_(NULL),
+  pending_messenger_(NULL)
+{
+}
+
 void PagingApplication::event_callback(
   const ControllerEvent &ev,
   const OpenflowMessenger &messenger)
@@ -55,6 +65,15 @@ void PagingApplication::event_callback(
     handle_paging_message(
       ev.get_connection(), static_cast<uint8_t *>(ofpi.data()), messenger);
   } else if (ev.get_type() == EVENT_SWITCH_UP) {
+    {
+      // The clamping flows are gone with the previous switch, and the pending
+      // pagings may have been scheduled on its connection. Packet-ins will
+      // come again for the UEs still idle
+      std::lock_guard<std::mutex> lock(pagings_mutex_);
+      recent_pagings_.clear();
+      pending_pagings_.clear();
+      send_scheduled_ = false;
+    }
     install_default_flow(ev.get_connection(), messenger);
   }
 }
@@ -64,15 +83,68 @@ void PagingApplication::handle_paging_message(
   uint8_t *data,
   const OpenflowMessenger &messenger)
 {
-  // send paging request to MME
   struct ip *ip_header = (struct ip *) (data + ETH_HEADER_LENGTH);
   struct in_addr dest_ip;
   memcpy(&dest_ip, &ip_header->ip_dst, sizeof(struct in_addr));
-  char *dest_ip_str = inet_ntoa(dest_ip);
+
+  std::lock_guard<std::mutex> lock(pagings_mutex_);
+  if (recent_pagings_.add(dest_ip.s_addr, RecentPagingSet::clock::now())) {
+    pending_pagings_.push_back(dest_ip);
+  } else {
+    suppressed_pagings_++;
+  }
+  pending_ofconn_ = ofconn;
+  pending_messenger_ = &messenger;
+  if (not send_scheduled_) {
+    send_scheduled_ = true;
+    // The application outlives the event loop, so the event does not own it
+    ofconn->add_immediate_event(
+      send_pending_pagings, std::shared_ptr<void>(this, [](void *) {}));
+  }
+}
+
+void *PagingApplication::send_pending_pagings(std::shared_ptr<void> data)
+{
+  auto app = static_cast<PagingApplication *>(data.get());
+  std::vector<struct in_addr> pagings;
+  uint32_t suppressed_pagings;
+  fluid_base::OFConnection *ofconn;
+  const OpenflowMessenger *messenger;
+  {
+    std::lock_guard<std::mutex> lock(app->pagings_mutex_);
+    pagings.swap(app->pending_pagings_);
+    suppressed_pagings = app->suppressed_pagings_;
+    app->suppressed_pagings_ = 0;
+    app->send_scheduled_ = false;
+    ofconn = app->pending_ofconn_;
+    messenger = app->pending_messenger_;
+  }
+
+  if (suppressed_pagings) {
+    increment_counter(
+      "openflow_paging_suppressed", suppressed_pagings, NO_LABELS);
+  }
+  if (pagings.empty()) {
+    return NULL;
+  }
+  // send paging requests to MME
   OAILOG_DEBUG(
-    LOG_GTPV1U, "Initiating paging procedure for IP %s\n", dest_ip_str);
-  sgw_send_paging_request(&dest_ip);
+    LOG_GTPV1U, "Initiating paging procedure for %zu IPs\n", pagings.size());
+  sgw_send_paging_requests(pagings.data(), pagings.size());
+  increment_counter("openflow_paging_requests", pagings.size(), NO_LABELS);
+
+  for (auto it = pagings.begin(); it != pagings.end(); it++) {
+    app->install_clamping_flow(ofconn, *it, *messenger);
+  }
+  messenger->flush();
+  return NULL;
+}
 
+void PagingApplication::install_clamping_flow(
+  fluid_base::OFConnection *ofconn,
+  const struct in_addr &dest_ip,
+  const OpenflowMessenger &messenger)
+{
   /*
    * Clamp on this ip for configured amount of time
    * Priority is above default paging flow, but below gtp flow. This way when
@@ -91,7 +163,6 @@ void PagingApplication::handle_paging_message(
 
   // No actions mean packet is dropped
   messenger.send_of_msg(fm, ofconn);
-  return;
 }
 
 void PagingApplication::install_default_flow(
@@ -21,12 +21,24 @@
 
 #pragma once
 
+#include <mutex>
+#include <vector>
+
 #include "OpenflowController.h"
+#include "RecentPagingSet.h"
 
 namespace openflow {
 #define ETH_HEADER_LENGTH 14
 
+/**
+ * PagingApplication pages idle UEs when downlink data reaches the switch for
+ * them. The packet-ins received during an event loop iteration are paged in
+ * one batch, and a UE is not paged again while its clamping flow is installed
+ */
 class PagingApplication : public Application {
+ public:
+  PagingApplication();
+
  private:
   static const int MID_PRIORITY = 5;
   // TODO: move to config file
@@ -43,9 +55,9 @@ class PagingApplication : public Application {
     const OpenflowMessenger &messenger);
 
   /**
-   * Handles downlink data intended for a UE in idle mode, then forwards the
-   * paging request to SPGW. After initiating the paging process, it also clamps
-   * on the destination IP, to prevent multiple packet-in messages
+   * Handles downlink data intended for a UE in idle mode. Unless the UE is
+   * already being paged, the paging is queued until the end of the event loop
+   * iteration
    *
    * @param ofconn (in) - given connection to OVS switch
    * @param data (in) - the ethernet packet received by the switch
@@ -55,6 +67,21 @@ class PagingApplication : public Application {
     uint8_t *data,
     const OpenflowMessenger &messenger);
 
+  /**
+   * Event loop callback, with data pointing to the application. Forwards the
+   * queued paging requests to SPGW in one go, then clamps on their
+   * destination IPs, to prevent multiple packet-in messages
+   */
+  static void *send_pending_pagings(std::shared_ptr<void> data);
+
+  /**
+   * Drop the packets to a UE being paged for CLAMPING_TIMEOUT seconds
+   */
+  void install_clamping_flow(
+    fluid_base::OFConnection *ofconn,
+    const struct in_addr &dest_ip,
+    const OpenflowMessenger &messenger);
+
   /**
    * Creates the default paging flow, which sends a packet intended for an
    * idle UE to this application
@@ -62,6 +89,15 @@ class PagingApplication : public Application {
   void install_default_flow(
     fluid_base::OFConnection *ofconn,
     const OpenflowMessenger &messenger);
+
+ private:
+  std::mutex pagings_mutex_;
+  RecentPagingSet recent_pagings_;
+  std::vector<struct in_addr> pending_pagings_;
+  uint32_t suppressed_pagings_;
+  bool send_scheduled_;
+  fluid_base::OFConnection *pending_ofconn_;
+  const OpenflowMessenger *pending_messenger_;
 };
 
 } // namespace openflow
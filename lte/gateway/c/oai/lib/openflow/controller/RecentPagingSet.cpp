@@ -0,0 +1,69 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+#include "RecentPagingSet.h"
+
+namespace openflow {
+
+RecentPagingSet::RecentPagingSet(clock::duration window):
+  window_(window),
+  last_expiry_()
+{
+}
+
+bool RecentPagingSet::add(uint32_t ue_ip, clock::time_point now)
+{
+  auto it = paged_.find(ue_ip);
+  if (it != paged_.end() && now - it->second < window_) {
+    return false;
+  }
+  paged_[ue_ip] = now;
+  // Sweep the whole set once per window, so that its size stays bounded by
+  // the UEs paged in the last two windows
+  if (now - last_expiry_ >= window_) {
+    remove_expired(now);
+  }
+  return true;
+}
+
+void RecentPagingSet::clear()
+{
+  paged_.clear();
+}
+
+size_t RecentPagingSet::size() const
+{
+  return paged_.size();
+}
+
+void RecentPagingSet::remove_expired(clock::time_point now)
+{
+  for (auto it = paged_.begin(); it != paged_.end();) {
+    if (now - it->second >= window_) {
+      it = paged_.erase(it);
+    } else {
+      it++;
+    }
+  }
+  last_expiry_ = now;
+}
+
+} // namespace openflow
@@ -0,0 +1,67 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+#include <unordered_map>
+
+namespace openflow {
+
+/**
+ * Set of the UE IPs paged recently. Packet-ins keep coming for a UE until its
+ * clamping flow is installed, the set tells which of them are duplicates of a
+ * paging still in progress
+ */
+class RecentPagingSet {
+ public:
+  typedef std::chrono::steady_clock clock;
+
+  /*
+   * @param window - time during which a UE is not paged again
+   */
+  RecentPagingSet(clock::duration window);
+
+  /*
+   * Record a paging for the UE, unless it was already paged within the window
+   * @param ue_ip - UE IP address, in network order
+   * @param now - time of the packet-in
+   * @return true if the UE should be paged, false for a duplicate
+   */
+  bool add(uint32_t ue_ip, clock::time_point now);
+
+  /*
+   * Forget all the pagings, e.g. when the clamping flows are lost
+   */
+  void clear();
+
+  size_t size() const;
+
+ private:
+  void remove_expired(clock::time_point now);
+
+  const clock::duration window_;
+  std::unordered_map<uint32_t, clock::time_point> paged_;
+  clock::time_point last_expiry_;
+};
+
+} // namespace openflow
@@ -0,0 +1,74 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under 
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.  
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <nettle/aes.h>
+
+#include "assertions.h"
+#include "secu_defs.h"
+
+/* Multiply by x in GF(2^128), see RFC 4493 section 2.3 */
+static void _cmac_double(const uint8_t in[16], uint8_t out[16])
+{
+  uint8_t carry = in[0] >> 7;
+  int i = 0;
+
+  for (i = 0; i < 15; i++) {
+    out[i] = (in[i] << 1) | (in[i + 1] >> 7);
+  }
+  out[15] = (in[15] << 1) ^ (carry ? 0x87 : 0);
+}
+
+static void _nas_aes128_key_expand(
+  const uint8_t *key,
+  nas_aes128_key_t *const expanded)
+{
+  uint8_t l[16] = {0};
+
+  memcpy(expanded->key, key, sizeof(expanded->key));
+  aes_set_encrypt_key(&expanded->ctx, sizeof(expanded->key), key);
+  aes_encrypt(&expanded->ctx, sizeof(l), l, l);
+  _cmac_double(l, expanded->cmac_k1);
+  _cmac_double(expanded->cmac_k1, expanded->cmac_k2);
+  expanded->is_set = true;
+}
+
+const nas_aes128_key_t *nas_stream_aes128_key(
+  const nas_stream_cipher_t *const stream_cipher,
+  nas_aes128_key_t *const local)
+{
+  nas_aes128_key_t *cache = stream_cipher->key_cache;
+
+  DevAssert(stream_cipher->key != NULL);
+  DevAssert(stream_cipher->key_length == 16);
+
+  if (!cache) {
+    _nas_aes128_key_expand(stream_cipher->key, local);
+    return local;
+  }
+  if (
+    !cache->is_set ||
+    memcmp(cache->key, stream_cipher->key, sizeof(cache->key))) {
+    _nas_aes128_key_expand(stream_cipher->key, cache);
+  }
+  return cache;
+}
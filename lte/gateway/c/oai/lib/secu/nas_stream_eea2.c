@@ -19,29 +19,25 @@
  *      contact@openairinterface.org
  */
 
-#include <stdlib.h>
-#include <stdio.h>
 #include <stdint.h>
 #include <string.h>
-#include <nettle/nettle-meta.h>
+#include <nettle/aes.h>
 #include <nettle/ctr.h>
 
 #include "assertions.h"
 #include "conversions.h"
 #include "secu_defs.h"
-#include "dynamic_memory_check.h"
 
 int nas_stream_encrypt_eea2(
   nas_stream_cipher_t *const stream_cipher,
   uint8_t *const out)
 {
-  uint8_t m[16];
+  uint8_t m[AES_BLOCK_SIZE];
   uint32_t local_count;
-  void *ctx;
-  uint8_t *data;
+  nas_aes128_key_t local_key;
+  const nas_aes128_key_t *aes = NULL;
   uint32_t zero_bit = 0;
   uint32_t byte_length;
-  uint32_t len = 0;
 
   DevAssert(stream_cipher != NULL);
   DevAssert(out != NULL);
@@ -50,8 +46,7 @@ int nas_stream_encrypt_eea2(
 
   if (zero_bit > 0) byte_length += 1;
 
-  ctx = malloc(nettle_aes128.context_size);
-  data = calloc(1, byte_length);
+  aes = nas_stream_aes128_key(stream_cipher, &local_key);
   local_count = hton_int32(stream_cipher->count);
   memset(m, 0, sizeof(m));
   memcpy(&m[0], &local_count, 4);
@@ -60,26 +55,18 @@ int nas_stream_encrypt_eea2(
   /*
    * Other bits are 0
    */
-  nettle_aes128.set_encrypt_key(
-    ctx, stream_cipher->key_length, stream_cipher->key);
-
-  nettle_ctr_crypt(
-    ctx,
-    nettle_aes128.encrypt,
-    nettle_aes128.block_size,
+  ctr_crypt(
+    (void *) &aes->ctx,
+    (nettle_crypt_func *) aes_encrypt,
+    AES_BLOCK_SIZE,
     m,
     byte_length,
-    data,
+    out,
     stream_cipher->message);
 
   if (zero_bit > 0)
-    data[byte_length - 1] =
-      data[byte_length - 1] & (uint8_t)(0xFF << (8 - zero_bit));
+    out[byte_length - 1] =
+      out[byte_length - 1] & (uint8_t)(0xFF << (8 - zero_bit));
 
-  len = sizeof(out);
-  memset(out, 0, len);
-  memcpy(out, data, byte_length);
-  free_wrapper((void **) &data);
-  free_wrapper((void **) &ctx);
   return 0;
 }
@@ -21,89 +21,88 @@
 
 #include <stdint.h>
 #include <string.h>
-#include <math.h> // double ceil(double x);
 
 #include "secu_defs.h"
 #include "conversions.h"
 #include "snow3g.h"
 
-uint64_t MUL64x(uint64_t V, uint64_t c);
-uint64_t MUL64xPOW(uint64_t V, uint32_t i, uint64_t c);
-uint64_t MUL64(uint64_t V, uint64_t P, uint64_t c);
 int nas_stream_encrypt_eia1(
   nas_stream_cipher_t *const stream_cipher,
   uint8_t const out[4]);
 
 // see spec 3GPP Confidentiality and Integrity Algorithms UEA2&UIA2. Document 1: UEA2 and UIA2 Specification. Version 1.1
 
+#define EIA1_C 0x1b
+
 /* MUL64x.
    Input V: a 64-bit input.
    Input c: a 64-bit input.
    Output : a 64-bit output.
-   A 64-bit memory is allocated which is to be free_wrapperd by the calling
-   function.
    See section 4.3.2 for details.
 */
-uint64_t MUL64x(uint64_t V, uint64_t c)
+static inline uint64_t _MUL64x(uint64_t V, uint64_t c)
 {
-  if (V & 0x8000000000000000)
-    return (V << 1) ^ c;
-  else
-    return V << 1;
+  return (V << 1) ^ (c & (0 - (V >> 63)));
 }
 
-/* MUL64xPOW.
+/* MUL64.
    Input V: a 64-bit input.
-   Input i: a positive integer.
+   Input P: a 64-bit input.
    Input c: a 64-bit input.
    Output : a 64-bit output.
-   A 64-bit memory is allocated which is to be free_wrapperd by the calling
-  function.
-   See section 4.3.3 for details.
+   Horner's rule on the bits of V, from the most significant one, instead of
+   summing the MUL64xPOW(P, i, c) of section 4.3.4, which is the same product.
 */
-uint64_t MUL64xPOW(uint64_t V, uint32_t i, uint64_t c)
+static uint64_t _MUL64(uint64_t V, uint64_t P, uint64_t c)
 {
-  if (i == 0)
-    return V;
-  else
-    return MUL64x(MUL64xPOW(V, i - 1, c), c);
+  uint64_t result = 0;
+  int i = 0;
+
+  for (i = 63; i >= 0; i--) {
+    result = _MUL64x(result, c) ^ (P & (0 - ((V >> i) & 0x1)));
+  }
+
+  return result;
 }
 
-/* MUL64.
-   Input V: a 64-bit input.
-   Input P: a 64-bit input.
-   Input c: a 64-bit input.
-   Output : a 64-bit output.
-   A 64-bit memory is allocated which is to be free_wrapperd by the calling
-   function.
-   See section 4.3.4 for details.
+/* MUL64 by a P used for all the blocks of a message.
+   P_x_pow[i] = MUL64xPOW(P, i, c) is computed once per message, each product
+   is then the sum of the entries for the bits set in V.
 */
-uint64_t MUL64(uint64_t V, uint64_t P, uint64_t c)
+static inline uint64_t _MUL64_table(uint64_t V, const uint64_t P_x_pow[64])
 {
   uint64_t result = 0;
   int i = 0;
 
   for (i = 0; i < 64; i++) {
-    if ((P >> i) & 0x1) result ^= MUL64xPOW(V, i, c);
+    result ^= P_x_pow[i] & (0 - ((V >> i) & 0x1));
   }
 
   return result;
 }
 
-/* mask32bit.
-  Input n: an integer in 1-32.
-  Output : a 32 bit mask.
-  Prepares a 32 bit mask with required number of 1 bits on the MSB side.
+/* Load the block-th 64 bits of the message, big endian, with the bits past
+   the end of the message cleared.
 */
-uint32_t mask32bit(int n)
+static uint64_t _eia1_block(
+  const uint8_t *message,
+  uint32_t blength,
+  uint32_t block)
 {
-  uint32_t mask = 0x0;
-
-  if (n % 32 == 0) return 0xffffffff;
-
-  while (n--) mask = (mask >> 1) ^ 0x80000000;
+  uint32_t first_bit = block * 64;
+  uint32_t bits = blength - first_bit;
+  uint32_t length;
+  uint64_t M = 0;
+  uint32_t i;
+
+  if (bits > 64) bits = 64;
+  length = (bits + 7) >> 3;
+  for (i = 0; i < length; i++) {
+    M |= ((uint64_t) message[(first_bit >> 3) + i]) << (56 - 8 * i);
+  }
+  if (bits < 64) M &= ~(((uint64_t) -1) >> bits);
 
-  return mask;
+  return M;
 }
 
 /*!
@@ -117,21 +116,13 @@ int nas_stream_encrypt_eia1(
 {
   snow_3g_context_t snow_3g_context;
   uint32_t K[4], IV[4], z[5];
-  int i = 0, D;
+  uint32_t i = 0, D;
   uint32_t MAC_I = 0;
   uint64_t EVAL;
-  uint64_t V;
   uint64_t P;
   uint64_t Q;
-  uint64_t c;
-  uint64_t M_D_2;
-  int rem_bits;
-  uint32_t mask = 0;
-  uint32_t *message;
-
-  message =
-    (uint32_t *)
-      stream_cipher->message; /* To operate 32 bit message internally. */
+  uint64_t P_x_pow[64];
+
   /*
    * Load the Integrity Key for SNOW3G initialization as in section 4.4.
    */
@@ -157,69 +148,33 @@ int nas_stream_encrypt_eia1(
           ((uint32_t)(stream_cipher->direction) << 31);
   IV[0] = ((((uint32_t) stream_cipher->bearer) & 0x0000001F) << 27) ^
           ((uint32_t)(stream_cipher->direction & 0x00000001) << 15);
-  //printf ("K:\n");
-  //hexprint(K, 16);
-  //printf ("K[0]:%08X\n",K[0]);
-  //printf ("K[1]:%08X\n",K[1]);
-  //printf ("K[2]:%08X\n",K[2]);
-  //printf ("K[3]:%08X\n",K[3]);
-  //printf ("IV:\n");
-  //hexprint(IV, 16);
-  //printf ("IV[0]:%08X\n",IV[0]);
-  //printf ("IV[1]:%08X\n",IV[1]);
-  //printf ("IV[2]:%08X\n",IV[2]);
-  //printf ("IV[3]:%08X\n",IV[3]);
   z[0] = z[1] = z[2] = z[3] = z[4] = 0;
   /*
    * Run SNOW 3G to produce 5 keystream words z_1, z_2, z_3, z_4 and z_5.
    */
   snow3g_initialize(K, IV, &snow_3g_context);
   snow3g_generate_key_stream(5, z, &snow_3g_context);
-  //printf ("z[0]:%08X\n",z[0]);
-  //printf ("z[1]:%08X\n",z[1]);
-  //printf ("z[2]:%08X\n",z[2]);
-  //printf ("z[3]:%08X\n",z[3]);
-  //printf ("z[4]:%08X\n",z[4]);
   P = ((uint64_t) z[0] << 32) | (uint64_t) z[1];
   Q = ((uint64_t) z[2] << 32) | (uint64_t) z[3];
-  //printf ("P:%16lX\n",P);
-  //printf ("Q:%16lX\n",Q);
   /*
    * Calculation
    */
-  D = ceil(stream_cipher->blength / 64.0) + 1;
-  //printf ("D:%d\n",D);
-  EVAL = 0;
-  c = 0x1b;
-
-  /*
-   * for 0 <= i <= D-3
-   */
-  for (i = 0; i < D - 2; i++) {
-    V = EVAL ^ ((uint64_t) hton_int32(message[2 * i]) << 32 |
-                (uint64_t) hton_int32(message[2 * i + 1]));
-    EVAL = MUL64(V, P, c);
-    //printf ("Mi: %16X %16X\tEVAL: %16lX\n",hton_int32(message[2*i]),hton_int32(message[2*i+1]), EVAL);
+  D = (stream_cipher->blength + 63) / 64 + 1;
+  P_x_pow[0] = P;
+  for (i = 1; i < 64; i++) {
+    P_x_pow[i] = _MUL64x(P_x_pow[i - 1], EIA1_C);
   }
+  EVAL = 0;
 
   /*
-   * for D-2
+   * for 0 <= i <= D-2, the last block being padded with zeros
    */
-  rem_bits = stream_cipher->blength % 64;
-
-  if (rem_bits == 0) rem_bits = 64;
-
-  mask = mask32bit(rem_bits % 32);
-
-  if (rem_bits > 32) {
-    M_D_2 = ((uint64_t) hton_int32(message[2 * (D - 2)]) << 32) |
-            (uint64_t)(hton_int32(message[2 * (D - 2) + 1]) & mask);
-  } else {
-    M_D_2 = ((uint64_t) hton_int32(message[2 * (D - 2)]) & mask) << 32;
+  for (i = 0; i + 2 <= D; i++) {
+    EVAL = _MUL64_table(
+      EVAL ^ _eia1_block(stream_cipher->message, stream_cipher->blength, i),
+      P_x_pow);
   }
 
-  V = EVAL ^ M_D_2;
-  EVAL = MUL64(V, P, c);
   /*
    * for D-1
    */
@@ -227,9 +182,8 @@ int nas_stream_encrypt_eia1(
   /*
    * Multiply by Q
    */
-  EVAL = MUL64(EVAL, Q, c);
+  EVAL = _MUL64(EVAL, Q, EIA1_C);
   MAC_I = (uint32_t)(EVAL >> 32) ^ z[4];
-  //printf ("MAC_I:%16X\n",MAC_I);
   MAC_I = hton_int32(MAC_I);
   memcpy((void *) out, &MAC_I, 4);
   return 0;
@@ -19,22 +19,47 @@
  *      contact@openairinterface.org
  */
 
-#include <stdlib.h>
-#include <stdio.h>
 #include <stdint.h>
 #include <string.h>
-#include <openssl/cmac.h>
-#include <openssl/evp.h>
-#include <openssl/ossl_typ.h>
+#include <nettle/aes.h>
 
 #include "secu_defs.h"
 #include "assertions.h"
 #include "conversions.h"
-#include "dynamic_memory_check.h"
-#include "log.h"
+
+/*
+ * Copy the block-th 16 bytes of COUNT || BEARER || DIRECTION || 0^26 || M
+ * into m, padded with zeros past the end of the message
+ */
+static void _eia2_block(
+  const uint8_t header[8],
+  const uint8_t *message,
+  uint32_t message_length,
+  uint32_t block,
+  uint8_t m[AES_BLOCK_SIZE])
+{
+  uint8_t *dst = m;
+  uint32_t offset = 0;
+  uint32_t length = AES_BLOCK_SIZE;
+
+  memset(m, 0, AES_BLOCK_SIZE);
+  if (block == 0) {
+    memcpy(m, header, 8);
+    dst = &m[8];
+    length = 8;
+  } else {
+    offset = block * AES_BLOCK_SIZE - 8;
+  }
+  if (offset < message_length) {
+    if (length > message_length - offset) length = message_length - offset;
+    memcpy(dst, message + offset, length);
+  }
+}
 
 /*!
    @brief Create integrity cmac t for a given message.
+   AES-CMAC of RFC 4493 on a bit string, with the key schedule and subkeys of
+   the key cache of the stream cipher when it is set.
    @param[in] stream_cipher Structure containing various variables to setup encoding
    @param[out] out For EIA2 the output string is 32 bits long
 */
@@ -42,51 +67,57 @@ int nas_stream_encrypt_eia2(
   nas_stream_cipher_t *const stream_cipher,
   uint8_t const out[4])
 {
-  uint8_t *m = NULL;
+  uint8_t header[8] = {0};
+  uint8_t m[AES_BLOCK_SIZE];
+  uint8_t x[AES_BLOCK_SIZE] = {0};
   uint32_t local_count = 0;
-  size_t size = 4;
-  uint8_t data[16] = {0};
-  CMAC_CTX *cmac_ctx = NULL;
-  const EVP_CIPHER *cipher = EVP_aes_128_cbc();
-  uint32_t zero_bit = 0;
+  nas_aes128_key_t local_key;
+  const nas_aes128_key_t *aes = NULL;
+  const uint8_t *subkey = NULL;
   uint32_t m_length;
+  uint32_t total_bits;
+  uint32_t last_bits;
+  uint32_t n_blocks;
+  uint32_t block;
+  int i;
 
   DevAssert(stream_cipher != NULL);
   DevAssert(stream_cipher->key != NULL);
   DevAssert(stream_cipher->key_length > 0);
   DevAssert(out != NULL);
-  zero_bit = stream_cipher->blength & 0x7;
-  m_length = stream_cipher->blength >> 3;
-
-  if (zero_bit > 0) m_length += 1;
+  m_length = (stream_cipher->blength + 7) >> 3;
 
+  aes = nas_stream_aes128_key(stream_cipher, &local_key);
   local_count = hton_int32(stream_cipher->count);
-  m = calloc(1, m_length + 8);
-  memcpy(&m[0], &local_count, 4);
-  m[4] = ((stream_cipher->bearer & 0x1F) << 3) |
-         ((stream_cipher->direction & 0x01) << 2);
-  memcpy(&m[8], stream_cipher->message, m_length);
+  memcpy(&header[0], &local_count, 4);
+  header[4] = ((stream_cipher->bearer & 0x1F) << 3) |
+              ((stream_cipher->direction & 0x01) << 2);
+
+  total_bits = 64 + stream_cipher->blength;
+  n_blocks = (total_bits + 127) / 128;
+  last_bits = total_bits - (n_blocks - 1) * 128;
+
+  for (block = 0; block < n_blocks - 1; block++) {
+    _eia2_block(header, stream_cipher->message, m_length, block, m);
+    for (i = 0; i < AES_BLOCK_SIZE; i++) x[i] ^= m[i];
+    aes_encrypt(&aes->ctx, AES_BLOCK_SIZE, x, x);
+  }
 
-  OAILOG_TRACE(
-    LOG_NAS, "Byte length: %u, Zero bits: %u:\n", m_length + 8, zero_bit);
-  OAILOG_STREAM_HEX(OAILOG_LEVEL_TRACE, LOG_NAS, "m:", m, m_length + 8);
-  OAILOG_STREAM_HEX(
-    OAILOG_LEVEL_TRACE,
-    LOG_NAS,
-    "Key:",
-    stream_cipher->key,
-    stream_cipher->key_length);
-  OAILOG_STREAM_HEX(
-    OAILOG_LEVEL_TRACE, LOG_NAS, "Message:", stream_cipher->message, m_length);
+  /*
+   * Last block, complete or padded with 10^i
+   */
+  _eia2_block(header, stream_cipher->message, m_length, block, m);
+  if (last_bits == 128) {
+    subkey = aes->cmac_k1;
+  } else {
+    if (last_bits & 0x7)
+      m[last_bits >> 3] &= (uint8_t)(0xFF << (8 - (last_bits & 0x7)));
+    m[last_bits >> 3] |= 0x80 >> (last_bits & 0x7);
+    subkey = aes->cmac_k2;
+  }
+  for (i = 0; i < AES_BLOCK_SIZE; i++) x[i] ^= m[i] ^ subkey[i];
+  aes_encrypt(&aes->ctx, AES_BLOCK_SIZE, x, x);
 
-  cmac_ctx = CMAC_CTX_new();
-  CMAC_Init(
-    cmac_ctx, stream_cipher->key, stream_cipher->key_length, cipher, NULL);
-  CMAC_Update(cmac_ctx, m, m_length + 8);
-  CMAC_Final(cmac_ctx, data, &size);
-  CMAC_CTX_free(cmac_ctx);
-  OAILOG_STREAM_HEX(OAILOG_LEVEL_TRACE, LOG_NAS, "Out:", data, size);
-  memcpy((void *) out, data, 4);
-  free_wrapper((void **) &m);
+  memcpy((void *) out, x, 4);
   return 0;
 }
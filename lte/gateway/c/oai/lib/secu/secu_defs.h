@@ -22,7 +22,9 @@
 #ifndef FILE_SECU_DEFS_SEEN
 #define FILE_SECU_DEFS_SEEN
 
+#include <stdbool.h>
 #include <stdint.h>
+#include <nettle/aes.h>
 
 #include "security_types.h"
 
@@ -75,9 +77,23 @@ int derive_NH(
 #define SECU_DIRECTION_UPLINK 0
 #define SECU_DIRECTION_DOWNLINK 1
 
+/* AES-128 key schedule and CMAC subkeys of a NAS key. It is expanded on the
+ * first message protected with the key and reused as long as the key does not
+ * change, which is checked on every message.
+ */
+typedef struct nas_aes128_key_s {
+  bool is_set;
+  uint8_t key[16];
+  struct aes_ctx ctx;
+  uint8_t cmac_k1[16]; /* CMAC subkeys, see RFC 4493 */
+  uint8_t cmac_k2[16];
+} nas_aes128_key_t;
+
 typedef struct {
   uint8_t *key;
   uint32_t key_length;
+  /* optional, cache of the expanded key for EEA2 and EIA2 */
+  nas_aes128_key_t *key_cache;
   uint32_t count;
   uint8_t bearer;
   uint8_t direction;
@@ -86,6 +102,14 @@ typedef struct {
   uint32_t blength;
 } nas_stream_cipher_t;
 
+/*
+ * Return the expanded key of the stream cipher, from its key cache when set,
+ * expanding it there first if the key changed, from local otherwise.
+ */
+const nas_aes128_key_t *nas_stream_aes128_key(
+  const nas_stream_cipher_t *const stream_cipher,
+  nas_aes128_key_t *const local);
+
 int nas_stream_encrypt_eea1(
   nas_stream_cipher_t *const stream_cipher,
   uint8_t *const out);
@@ -19,31 +19,35 @@
  *      contact@openairinterface.org
  */
 
+#include <pthread.h>
 #include <stdint.h>
 
 #include "rijndael.h"
 #include "snow3g.h"
 
+/* Tables filled once by _snow3g_init_tables:
+  _MULalpha_table[c] = MULalpha(c), _DIValpha_table[c] = DIValpha(c),
+  S1(w) = _S1_T0[w0] ^ _S1_T1[w1] ^ _S1_T2[w2] ^ _S1_T3[w3] and the same for S2,
+  w0 being the most and w3 the least significant byte of w.
+*/
+static uint32_t _MULalpha_table[256];
+static uint32_t _DIValpha_table[256];
+static uint32_t _S1_T0[256], _S1_T1[256], _S1_T2[256], _S1_T3[256];
+static uint32_t _S2_T0[256], _S2_T1[256], _S2_T2[256], _S2_T3[256];
+static pthread_once_t _snow3g_tables_once = PTHREAD_ONCE_INIT;
+
 static uint8_t _MULx(uint8_t V, uint8_t c);
 static uint8_t _MULxPOW(uint8_t V, uint8_t i, uint8_t c);
-static uint32_t _MULalpha(uint8_t c);
-static uint32_t _DIValpha(uint8_t c);
+static void _snow3g_init_tables(void);
 static uint32_t _S1(uint32_t w);
 static uint32_t _S2(uint32_t w);
-static void _snow3g_clock_LFSR_initialization_mode(
+static uint32_t _snow3g_clock_LFSR(
   uint32_t F,
-  snow_3g_context_t *s3g_ctx_pP);
-static void _snow3g_clock_LFSR_key_stream_mode(
   snow_3g_context_t *snow_3g_context_pP);
 static uint32_t _snow3g_clock_fsm(snow_3g_context_t *snow_3g_context_pP);
-void snow3g_initialize(
-  uint32_t k[4],
-  uint32_t IV[4],
-  snow_3g_context_t *snow_3g_context_pP);
-void snow3g_generate_key_stream(
-  uint32_t n,
-  uint32_t *ks,
-  snow_3g_context_t *snow_3g_context_pP);
+
+#define LFSR_S(sNOW3GcTX, i)                                                   \
+  (sNOW3GcTX)->LFSR[((sNOW3GcTX)->LFSR_head + (i)) & 15]
 
 /* _MULx.
   Input V: an 8-bit input.
@@ -71,40 +75,50 @@ static uint8_t _MULx(uint8_t V, uint8_t c)
 
 static uint8_t _MULxPOW(uint8_t V, uint8_t i, uint8_t c)
 {
-  if (i == 0)
-    return V;
-  else
-    return _MULx(_MULxPOW(V, i - 1, c), c);
-}
-
-/* The function _MULalpha.
-  Input c: 8-bit input.
-  Output : 32-bit output.
-  maps 8 bits to 32 bits.
-*/
-
-static uint32_t _MULalpha(uint8_t c)
-{
-  return (
-    (((uint32_t) _MULxPOW(c, 23, 0xa9)) << 24) |
-    (((uint32_t) _MULxPOW(c, 245, 0xa9)) << 16) |
-    (((uint32_t) _MULxPOW(c, 48, 0xa9)) << 8) |
-    (((uint32_t) _MULxPOW(c, 239, 0xa9))));
+  while (i--) {
+    V = _MULx(V, c);
+  }
+  return V;
 }
 
-/* The function DIV alpha.
-  Input c: 8-bit input.
-  Output : 32-bit output.
-  maps 8 bits to 32 bit.
+/* Fill the MULalpha, DIValpha and S-Box tables.
+  See sections 3.4.2, 3.4.3 and 3.1.3 for MULalpha, DIValpha, S1 and S2.
 */
 
-static uint32_t _DIValpha(uint8_t c)
+static void _snow3g_init_tables(void)
 {
-  return (
-    (((uint32_t) _MULxPOW(c, 16, 0xa9)) << 24) |
-    (((uint32_t) _MULxPOW(c, 39, 0xa9)) << 16) |
-    (((uint32_t) _MULxPOW(c, 6, 0xa9)) << 8) |
-    (((uint32_t) _MULxPOW(c, 64, 0xa9))));
+  int c = 0;
+
+  for (c = 0; c < 256; c++) {
+    uint8_t srw = SR[c];
+    uint8_t sqw = SQ[c];
+    uint32_t s = srw;
+    uint32_t m = _MULx(srw, 0x1b);
+    uint32_t q = sqw;
+    uint32_t n = _MULx(sqw, 0x69);
+
+    _MULalpha_table[c] = (((uint32_t) _MULxPOW(c, 23, 0xa9)) << 24) |
+                         (((uint32_t) _MULxPOW(c, 245, 0xa9)) << 16) |
+                         (((uint32_t) _MULxPOW(c, 48, 0xa9)) << 8) |
+                         (((uint32_t) _MULxPOW(c, 239, 0xa9)));
+    _DIValpha_table[c] = (((uint32_t) _MULxPOW(c, 16, 0xa9)) << 24) |
+                         (((uint32_t) _MULxPOW(c, 39, 0xa9)) << 16) |
+                         (((uint32_t) _MULxPOW(c, 6, 0xa9)) << 8) |
+                         (((uint32_t) _MULxPOW(c, 64, 0xa9)));
+    /*
+     * Contribution of each input byte to r0 || r1 || r2 || r3, e.g. for the
+     * most significant byte: r0 ^= MULx(SR[w0]), r1 ^= MULx(SR[w0]) ^ SR[w0],
+     * r2 ^= SR[w0], r3 ^= SR[w0]
+     */
+    _S1_T0[c] = (m << 24) | ((m ^ s) << 16) | (s << 8) | s;
+    _S1_T1[c] = (s << 24) | (m << 16) | ((m ^ s) << 8) | s;
+    _S1_T2[c] = (s << 24) | (s << 16) | (m << 8) | (m ^ s);
+    _S1_T3[c] = ((m ^ s) << 24) | (s << 16) | (s << 8) | m;
+    _S2_T0[c] = (n << 24) | ((n ^ q) << 16) | (q << 8) | q;
+    _S2_T1[c] = (q << 24) | (n << 16) | ((n ^ q) << 8) | q;
+    _S2_T2[c] = (q << 24) | (q << 16) | (n << 8) | (n ^ q);
+    _S2_T3[c] = ((n ^ q) << 24) | (q << 16) | (q << 8) | n;
+  }
 }
 
 /* The 32x32-bit S-Box S1
@@ -115,21 +129,10 @@ static uint32_t _DIValpha(uint8_t c)
   S1(w)= r0 || r1 || r2 || r3 with r0 the most and r3 the least significant byte.
 */
 
-static uint32_t _S1(uint32_t w)
+static inline uint32_t _S1(uint32_t w)
 {
-  uint8_t r0 = 0, r1 = 0, r2 = 0, r3 = 0;
-  uint8_t srw0 = SR[(uint8_t)((w >> 24) & 0xff)];
-  uint8_t srw1 = SR[(uint8_t)((w >> 16) & 0xff)];
-  uint8_t srw2 = SR[(uint8_t)((w >> 8) & 0xff)];
-  uint8_t srw3 = SR[(uint8_t)((w) &0xff)];
-
-  r0 = ((_MULx(srw0, 0x1b)) ^ (srw1) ^ (srw2) ^ ((_MULx(srw3, 0x1b)) ^ srw3));
-  r1 = (((_MULx(srw0, 0x1b)) ^ srw0) ^ (_MULx(srw1, 0x1b)) ^ (srw2) ^ (srw3));
-  r2 = ((srw0) ^ ((_MULx(srw1, 0x1b)) ^ srw1) ^ (_MULx(srw2, 0x1b)) ^ (srw3));
-  r3 = ((srw0) ^ (srw1) ^ ((_MULx(srw2, 0x1b)) ^ srw2) ^ (_MULx(srw3, 0x1b)));
-  return (
-    (((uint32_t) r0) << 24) | (((uint32_t) r1) << 16) | (((uint32_t) r2) << 8) |
-    (((uint32_t) r3)));
+  return _S1_T0[(w >> 24) & 0xff] ^ _S1_T1[(w >> 16) & 0xff] ^
+         _S1_T2[(w >> 8) & 0xff] ^ _S1_T3[w & 0xff];
 }
 
 /* The 32x32-bit S-Box S2
@@ -140,87 +143,36 @@ static uint32_t _S1(uint32_t w)
   Let S2(w)= r0 || r1 || r2 || r3 with r0 the most and r3 the least significant byte.
 */
 
-static uint32_t _S2(uint32_t w)
+static inline uint32_t _S2(uint32_t w)
 {
-  uint8_t r0 = 0, r1 = 0, r2 = 0, r3 = 0;
-  uint8_t sqw0 = SQ[(uint8_t)((w >> 24) & 0xff)];
-  uint8_t sqw1 = SQ[(uint8_t)((w >> 16) & 0xff)];
-  uint8_t sqw2 = SQ[(uint8_t)((w >> 8) & 0xff)];
-  uint8_t sqw3 = SQ[(uint8_t)((w) &0xff)];
-
-  r0 = ((_MULx(sqw0, 0x69)) ^ (sqw1) ^ (sqw2) ^ ((_MULx(sqw3, 0x69)) ^ sqw3));
-  r1 = (((_MULx(sqw0, 0x69)) ^ sqw0) ^ (_MULx(sqw1, 0x69)) ^ (sqw2) ^ (sqw3));
-  r2 = ((sqw0) ^ ((_MULx(sqw1, 0x69)) ^ sqw1) ^ (_MULx(sqw2, 0x69)) ^ (sqw3));
-  r3 = ((sqw0) ^ (sqw1) ^ ((_MULx(sqw2, 0x69)) ^ sqw2) ^ (_MULx(sqw3, 0x69)));
-  return (
-    (((uint32_t) r0) << 24) | (((uint32_t) r1) << 16) | (((uint32_t) r2) << 8) |
-    (((uint32_t) r3)));
+  return _S2_T0[(w >> 24) & 0xff] ^ _S2_T1[(w >> 16) & 0xff] ^
+         _S2_T2[(w >> 8) & 0xff] ^ _S2_T3[w & 0xff];
 }
 
-/* Clocking LFSR in initialization mode.
+/* Clocking LFSR.
   LFSR Registers S0 to S15 are updated as the LFSR receives a single clock.
-  Input F: a 32-bit word comes from output of FSM.
-  See section 3.4.4.
+  Input F: a 32-bit word comes from output of FSM in initialization mode,
+  0 in keystream mode.
+  Output: s0 before the clock.
+  See sections 3.4.4 and 3.4.5.
 */
 
-static void _snow3g_clock_LFSR_initialization_mode(
+static inline uint32_t _snow3g_clock_LFSR(
   uint32_t F,
-  snow_3g_context_t *s3g_ctx_pP)
-{
-  uint32_t v =
-    (((s3g_ctx_pP->LFSR_S0 << 8) & 0xffffff00) ^
-     (_MULalpha((uint8_t)((s3g_ctx_pP->LFSR_S0 >> 24) & 0xff))) ^
-     (s3g_ctx_pP->LFSR_S2) ^ ((s3g_ctx_pP->LFSR_S11 >> 8) & 0x00ffffff) ^
-     (_DIValpha((uint8_t)((s3g_ctx_pP->LFSR_S11) & 0xff))) ^ (F));
-
-  s3g_ctx_pP->LFSR_S0 = s3g_ctx_pP->LFSR_S1;
-  s3g_ctx_pP->LFSR_S1 = s3g_ctx_pP->LFSR_S2;
-  s3g_ctx_pP->LFSR_S2 = s3g_ctx_pP->LFSR_S3;
-  s3g_ctx_pP->LFSR_S3 = s3g_ctx_pP->LFSR_S4;
-  s3g_ctx_pP->LFSR_S4 = s3g_ctx_pP->LFSR_S5;
-  s3g_ctx_pP->LFSR_S5 = s3g_ctx_pP->LFSR_S6;
-  s3g_ctx_pP->LFSR_S6 = s3g_ctx_pP->LFSR_S7;
-  s3g_ctx_pP->LFSR_S7 = s3g_ctx_pP->LFSR_S8;
-  s3g_ctx_pP->LFSR_S8 = s3g_ctx_pP->LFSR_S9;
-  s3g_ctx_pP->LFSR_S9 = s3g_ctx_pP->LFSR_S10;
-  s3g_ctx_pP->LFSR_S10 = s3g_ctx_pP->LFSR_S11;
-  s3g_ctx_pP->LFSR_S11 = s3g_ctx_pP->LFSR_S12;
-  s3g_ctx_pP->LFSR_S12 = s3g_ctx_pP->LFSR_S13;
-  s3g_ctx_pP->LFSR_S13 = s3g_ctx_pP->LFSR_S14;
-  s3g_ctx_pP->LFSR_S14 = s3g_ctx_pP->LFSR_S15;
-  s3g_ctx_pP->LFSR_S15 = v;
-}
-
-/* Clocking LFSR in keystream mode.
-  LFSR Registers S0 to S15 are updated as the LFSR receives a single clock.
-  See section 3.4.5.
-*/
-static void _snow3g_clock_LFSR_key_stream_mode(
   snow_3g_context_t *snow_3g_context_pP)
 {
-  uint32_t v =
-    (((snow_3g_context_pP->LFSR_S0 << 8) & 0xffffff00) ^
-     (_MULalpha((uint8_t)((snow_3g_context_pP->LFSR_S0 >> 24) & 0xff))) ^
-     (snow_3g_context_pP->LFSR_S2) ^
-     ((snow_3g_context_pP->LFSR_S11 >> 8) & 0x00ffffff) ^
-     (_DIValpha((uint8_t)((snow_3g_context_pP->LFSR_S11) & 0xff))));
-
-  snow_3g_context_pP->LFSR_S0 = snow_3g_context_pP->LFSR_S1;
-  snow_3g_context_pP->LFSR_S1 = snow_3g_context_pP->LFSR_S2;
-  snow_3g_context_pP->LFSR_S2 = snow_3g_context_pP->LFSR_S3;
-  snow_3g_context_pP->LFSR_S3 = snow_3g_context_pP->LFSR_S4;
-  snow_3g_context_pP->LFSR_S4 = snow_3g_context_pP->LFSR_S5;
-  snow_3g_context_pP->LFSR_S5 = snow_3g_context_pP->LFSR_S6;
-  snow_3g_context_pP->LFSR_S6 = snow_3g_context_pP->LFSR_S7;
-  snow_3g_context_pP->LFSR_S7 = snow_3g_context_pP->LFSR_S8;
-  snow_3g_context_pP->LFSR_S8 = snow_3g_context_pP->LFSR_S9;
-  snow_3g_context_pP->LFSR_S9 = snow_3g_context_pP->LFSR_S10;
-  snow_3g_context_pP->LFSR_S10 = snow_3g_context_pP->LFSR_S11;
-  snow_3g_context_pP->LFSR_S11 = snow_3g_context_pP->LFSR_S12;
-  snow_3g_context_pP->LFSR_S12 = snow_3g_context_pP->LFSR_S13;
-  snow_3g_context_pP->LFSR_S13 = snow_3g_context_pP->LFSR_S14;
-  snow_3g_context_pP->LFSR_S14 = snow_3g_context_pP->LFSR_S15;
-  snow_3g_context_pP->LFSR_S15 = v;
+  uint32_t s0 = LFSR_S(snow_3g_context_pP, 0);
+  uint32_t s11 = LFSR_S(snow_3g_context_pP, 11);
+  uint32_t v = (s0 << 8) ^ _MULalpha_table[s0 >> 24] ^
+               LFSR_S(snow_3g_context_pP, 2) ^ (s11 >> 8) ^
+               _DIValpha_table[s11 & 0xff] ^ F;
+
+  /*
+   * s0 leaves the register and the new s15 takes its place
+   */
+  snow_3g_context_pP->LFSR[snow_3g_context_pP->LFSR_head] = v;
+  snow_3g_context_pP->LFSR_head = (snow_3g_context_pP->LFSR_head + 1) & 15;
+  return s0;
 }
 
 /* Clocking FSM.
@@ -229,14 +181,13 @@ static void _snow3g_clock_LFSR_key_stream_mode(
   See Section 3.4.6.
 */
 
-static uint32_t _snow3g_clock_fsm(snow_3g_context_t *snow_3g_context_pP)
+static inline uint32_t _snow3g_clock_fsm(snow_3g_context_t *snow_3g_context_pP)
 {
   uint32_t F =
-    ((snow_3g_context_pP->LFSR_S15 + snow_3g_context_pP->FSM_R1) & 0xffffffff) ^
+    (LFSR_S(snow_3g_context_pP, 15) + snow_3g_context_pP->FSM_R1) ^
     snow_3g_context_pP->FSM_R2;
-  uint32_t r = (snow_3g_context_pP->FSM_R2 +
-                (snow_3g_context_pP->FSM_R3 ^ snow_3g_context_pP->LFSR_S5)) &
-               0xffffffff;
+  uint32_t r = snow_3g_context_pP->FSM_R2 +
+               (snow_3g_context_pP->FSM_R3 ^ LFSR_S(snow_3g_context_pP, 5));
 
   snow_3g_context_pP->FSM_R3 = _S2(snow_3g_context_pP->FSM_R2);
   snow_3g_context_pP->FSM_R2 = _S1(snow_3g_context_pP->FSM_R1);
@@ -259,30 +210,38 @@ void snow3g_initialize(
   uint8_t i = 0;
   uint32_t F = 0x0;
 
-  snow_3g_context_pP->LFSR_S15 = k[3] ^ IV[0];
-  snow_3g_context_pP->LFSR_S14 = k[2];
-  snow_3g_context_pP->LFSR_S13 = k[1];
-  snow_3g_context_pP->LFSR_S12 = k[0] ^ IV[1];
-  snow_3g_context_pP->LFSR_S11 = k[3] ^ 0xffffffff;
-  snow_3g_context_pP->LFSR_S10 = k[2] ^ 0xffffffff ^ IV[2];
-  snow_3g_context_pP->LFSR_S9 = k[1] ^ 0xffffffff ^ IV[3];
-  snow_3g_context_pP->LFSR_S8 = k[0] ^ 0xffffffff;
-  snow_3g_context_pP->LFSR_S7 = k[3];
-  snow_3g_context_pP->LFSR_S6 = k[2];
-  snow_3g_context_pP->LFSR_S5 = k[1];
-  snow_3g_context_pP->LFSR_S4 = k[0];
-  snow_3g_context_pP->LFSR_S3 = k[3] ^ 0xffffffff;
-  snow_3g_context_pP->LFSR_S2 = k[2] ^ 0xffffffff;
-  snow_3g_context_pP->LFSR_S1 = k[1] ^ 0xffffffff;
-  snow_3g_context_pP->LFSR_S0 = k[0] ^ 0xffffffff;
+  pthread_once(&_snow3g_tables_once, _snow3g_init_tables);
+
+  snow_3g_context_pP->LFSR_head = 0;
+  snow_3g_context_pP->LFSR[15] = k[3] ^ IV[0];
+  snow_3g_context_pP->LFSR[14] = k[2];
+  snow_3g_context_pP->LFSR[13] = k[1];
+  snow_3g_context_pP->LFSR[12] = k[0] ^ IV[1];
+  snow_3g_context_pP->LFSR[11] = k[3] ^ 0xffffffff;
+  snow_3g_context_pP->LFSR[10] = k[2] ^ 0xffffffff ^ IV[2];
+  snow_3g_context_pP->LFSR[9] = k[1] ^ 0xffffffff ^ IV[3];
+  snow_3g_context_pP->LFSR[8] = k[0] ^ 0xffffffff;
+  snow_3g_context_pP->LFSR[7] = k[3];
+  snow_3g_context_pP->LFSR[6] = k[2];
+  snow_3g_context_pP->LFSR[5] = k[1];
+  snow_3g_context_pP->LFSR[4] = k[0];
+  snow_3g_context_pP->LFSR[3] = k[3] ^ 0xffffffff;
+  snow_3g_context_pP->LFSR[2] = k[2] ^ 0xffffffff;
+  snow_3g_context_pP->LFSR[1] = k[1] ^ 0xffffffff;
+  snow_3g_context_pP->LFSR[0] = k[0] ^ 0xffffffff;
   snow_3g_context_pP->FSM_R1 = 0x0;
   snow_3g_context_pP->FSM_R2 = 0x0;
   snow_3g_context_pP->FSM_R3 = 0x0;
 
   for (i = 0; i < 32; i++) {
     F = _snow3g_clock_fsm(snow_3g_context_pP);
-    _snow3g_clock_LFSR_initialization_mode(F, snow_3g_context_pP);
+    _snow3g_clock_LFSR(F, snow_3g_context_pP);
   }
+
+  _snow3g_clock_fsm(
+    snow_3g_context_pP); /* Clock FSM once. Discard the output. */
+  _snow3g_clock_LFSR(
+    0, snow_3g_context_pP); /* Clock LFSR in keystream mode once. */
 }
 
 /*  Generation of Keystream.
@@ -301,17 +260,11 @@ void snow3g_generate_key_stream(
   uint32_t t = 0;
   uint32_t F = 0x0;
 
-  _snow3g_clock_fsm(
-    snow_3g_context_pP); /* Clock FSM once. Discard the output. */
-  _snow3g_clock_LFSR_key_stream_mode(
-    snow_3g_context_pP); /* Clock LFSR in keystream mode once. */
-
   for (t = 0; t < n; t++) {
     F = _snow3g_clock_fsm(snow_3g_context_pP); /* STEP 1 */
-    ks[t] = F ^ snow_3g_context_pP->LFSR_S0;   /* STEP 2 */
     /*
-     * Note that ks[t] corresponds to z_{t+1} in section 4.2
+     * STEP 2 and 3, ks[t] corresponds to z_{t+1} in section 4.2
      */
-    _snow3g_clock_LFSR_key_stream_mode(snow_3g_context_pP); /* STEP 3 */
+    ks[t] = F ^ _snow3g_clock_LFSR(0, snow_3g_context_pP);
   }
 }
@@ -36,22 +36,12 @@
 #include <stdint.h>
 
 typedef struct snow_3g_context_s {
-  uint32_t LFSR_S0;
-  uint32_t LFSR_S1;
-  uint32_t LFSR_S2;
-  uint32_t LFSR_S3;
-  uint32_t LFSR_S4;
-  uint32_t LFSR_S5;
-  uint32_t LFSR_S6;
-  uint32_t LFSR_S7;
-  uint32_t LFSR_S8;
-  uint32_t LFSR_S9;
-  uint32_t LFSR_S10;
-  uint32_t LFSR_S11;
-  uint32_t LFSR_S12;
-  uint32_t LFSR_S13;
-  uint32_t LFSR_S14;
-  uint32_t LFSR_S15;
+  /* LFSR : The sixteen 32-bit stages s0 to s15 are kept in a circular buffer,
+  * s0 being LFSR[LFSR_head] and si being LFSR[(LFSR_head + i) & 15], so a
+  * clock only replaces s0 with the new s15 instead of shifting all the stages.
+  */
+  uint32_t LFSR[16];
+  uint32_t LFSR_head;
 
   /* FSM : The Finite State Machine has three 32-bit registers R1, R2 and R3.
   */
@@ -63,7 +53,8 @@ typedef struct snow_3g_context_s {
 /* Initialization.
 * Input k[4]: Four 32-bit words making up 128-bit key.
 * Input IV[4]: Four 32-bit words making 128-bit initialization variable.
-* Output: All the LFSRs and FSM are initialized for key generation.
+* Output: All the LFSRs and FSM are initialized for key generation, the first
+* keystream clock whose output is discarded is already done.
 */
 void snow3g_initialize(
   uint32_t k[4],
@@ -75,6 +66,8 @@ void snow3g_initialize(
 * input z: space for the generated keystream, assumes
 * memory is allocated already.
 * output: generated keystream which is filled in z
+* Successive calls continue the same keystream, so a long keystream can be
+* generated in chunks.
 */
 
 void snow3g_generate_key_stream(
@@ -95,6 +95,10 @@ int main(int argc, char *argv[])
    */
   // Intialize loggers and configured log levels.
   OAILOG_LOG_CONFIGURE(&mme_config.log_config);
+  itti_configure_memory_pools(
+    mme_config.itti_config.memory_pools,
+    mme_config.itti_config.memory_pools_number,
+    mme_config.itti_config.memory_pools_growth);
   CHECK_INIT_RETURN(service303_init(&(mme_config.service303_config)));
 
   // Service started, but not healthy yet
@@ -104,7 +108,11 @@ int main(int argc, char *argv[])
   CHECK_INIT_RETURN(nas_init(&mme_config));
   CHECK_INIT_RETURN(sctp_init(&mme_config));
 #if EMBEDDED_SGW
-  CHECK_INIT_RETURN(sgw_init(&spgw_config, mme_config.use_stateless));
+  CHECK_INIT_RETURN(sgw_init(
+    &spgw_config,
+    mme_config.use_stateless,
+    mme_config.use_stateless_per_ue,
+    mme_config.state_write_behind_window_ms));
   CHECK_INIT_RETURN(pgw_init(&spgw_config));
 #else
   CHECK_INIT_RETURN(s11_mme_init(&mme_config));
@@ -155,6 +155,8 @@ int lock_ue_contexts(ue_mm_context_t *const ue_mm_context)
         LOG_MME_APP,
         "Locked UE context mutex for " MME_UE_S1AP_ID_FMT "\n",
         ue_mm_context->mme_ue_s1ap_id);
+      // Every UE context locked while handling a message may be modified
+      mme_nas_state_mark_ue_dirty(ue_mm_context->mme_ue_s1ap_id);
 #if DEBUG_MUTEX
       OAILOG_TRACE(
         LOG_MME_APP,
@@ -764,6 +766,7 @@ void mme_ue_context_update_coll_keys(
       ue_context_p->emm_context._guti = *guti_p;
     }
   }
+  mme_nas_state_mark_ue_dirty(ue_context_p->mme_ue_s1ap_id);
   OAILOG_FUNC_OUT(LOG_MME_APP);
 }
 
@@ -1057,9 +1060,15 @@ void mme_remove_ue_context(
     _directoryd_remove_location(
       ue_context_p->emm_context._imsi64,
       ue_context_p->emm_context._imsi.length);
+    mme_nas_state_mark_ue_dirty(ue_context_p->mme_ue_s1ap_id);
     mme_app_ue_context_free_content(ue_context_p);
     unlock_ue_contexts(ue_context_p);
     free_wrapper((void **) &ue_context_p);
+    // Detach and purge must not be lost on restart before they are answered
+    if (mme_nas_state_sync_to_db() != RETURNok) {
+      OAILOG_ERROR(
+        LOG_MME_APP, "Failed to sync MME NAS state after removing UE context");
+    }
   }
   OAILOG_FUNC_OUT(LOG_MME_APP);
 }
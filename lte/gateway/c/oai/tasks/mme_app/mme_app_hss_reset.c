@@ -33,6 +33,7 @@
 
 #include "assertions.h"
 #include "common_defs.h"
+#include "dynamic_memory_check.h"
 #include "log.h"
 #include "mme_app_ue_context.h"
 #include "mme_app_defs.h"
@@ -46,10 +47,8 @@ int mme_app_handle_s6a_reset_req(mme_app_desc_t *mme_app_desc_p,
 {
   int rc = RETURNok;
   struct ue_mm_context_s *ue_context_p = NULL;
-  hash_node_t *node = NULL;
-  unsigned int i = 0;
-  unsigned int num_elements = 0;
   hash_table_ts_t *hashtblP = NULL;
+  hashtable_element_array_t *ea = NULL;
 
   OAILOG_FUNC_IN(LOG_MME_APP);
   DevAssert(rsr_pP);
@@ -61,43 +60,37 @@ int mme_app_handle_s6a_reset_req(mme_app_desc_t *mme_app_desc_p,
     OAILOG_INFO(LOG_MME_APP, "There is no Ue Context in the MME context \n");
     OAILOG_FUNC_RETURN(LOG_MME_APP, RETURNok);
   }
-  while ((num_elements < hashtblP->num_elements) && (i < hashtblP->size)) {
-    pthread_mutex_lock(&hashtblP->lock_nodes[i]);
-    if (hashtblP->nodes[i] != NULL) {
-      node = hashtblP->nodes[i];
-    }
-    pthread_mutex_unlock(&hashtblP->lock_nodes[i]);
-    while (node) {
-      num_elements++;
-      hashtable_ts_get(
-        hashtblP, (const hash_key_t) node->key, (void **) &ue_context_p);
-      if (ue_context_p != NULL) {
-        if (ue_context_p->mm_state == UE_REGISTERED) {
-          /*
-          * set the flag: location_info_confirmed_in_hss to indicate that,
-          * hss has restarted and MME shall send ULR to hss
-          */
-          ue_context_p->location_info_confirmed_in_hss = true;
+  ea = hashtable_ts_get_elements(hashtblP);
+  for (int i = 0; ea && (i < ea->num_elements); i++) {
+    ue_context_p = ea->elements[i];
+    if (ue_context_p != NULL) {
+      if (ue_context_p->mm_state == UE_REGISTERED) {
+        /*
+        * set the flag: location_info_confirmed_in_hss to indicate that,
+        * hss has restarted and MME shall send ULR to hss
+        */
+        ue_context_p->location_info_confirmed_in_hss = true;
+        /*
+        * set the sgs context flag: neaf to indicate that,
+        * hss has restarted and MME shall send SGS Ue Activity Indication to MSC/VLR
+        * to indicate that activity from a UE has been detected
+        */
+        if (ue_context_p->sgs_context != NULL) {
+          ue_context_p->sgs_context->neaf = true;
+        }
+
+        if (ue_context_p->ecm_state == ECM_CONNECTED) {
           /*
-          * set the sgs context flag: neaf to indicate that,
-          * hss has restarted and MME shall send SGS Ue Activity Indication to MSC/VLR
-          * to indicate that activity from a UE has been detected
+          * hss has restarted and MME shall send ULR to hss for connected Ue
           */
-          if (ue_context_p->sgs_context != NULL) {
-            ue_context_p->sgs_context->neaf = true;
-          }
-
-          if (ue_context_p->ecm_state == ECM_CONNECTED) {
-            /*
-            * hss has restarted and MME shall send ULR to hss for connected Ue
-            */
-            rc = mme_app_send_s6a_update_location_req(ue_context_p);
-          }
+          rc = mme_app_send_s6a_update_location_req(ue_context_p);
         }
       }
-      node = node->next;
     }
-    i++;
+  }
+  if (ea) {
+    free_wrapper((void **) &ea->elements);
+    free_wrapper((void **) &ea);
   }
   OAILOG_FUNC_RETURN(LOG_MME_APP, rc);
 }
@@ -74,6 +74,11 @@ static bool _is_mme_app_healthy(void);
 void *mme_app_thread(void *args)
 {
   struct ue_mm_context_s *ue_context_p = NULL;
+  MessageDef *received_messages[ITTI_RECEIVE_BATCH_MAX];
+  size_t n_received = 0;
+  size_t next_received = 0;
+
+  itti_set_wakeup_coalescing(TASK_MME_APP, true);
   itti_mark_task_ready(TASK_MME_APP);
   mme_app_desc_t *mme_app_desc_p;
 
@@ -81,11 +86,15 @@ void *mme_app_thread(void *args)
     MessageDef *received_message_p = NULL;
 
     /*
-     * Trying to fetch a message from the message queue.
-     * If the queue is empty, this function will block till a
-     * message is sent to the task.
+     * Messages are fetched from the queue in batches, this only blocks
+     * once the previous batch is handled and the queue is empty.
      */
-    itti_receive_msg(TASK_MME_APP, &received_message_p);
+    if (next_received == n_received) {
+      n_received = itti_receive_msg_batch(
+        TASK_MME_APP, received_messages, ITTI_RECEIVE_BATCH_MAX);
+      next_received = 0;
+    }
+    received_message_p = received_messages[next_received++];
     DevAssert(received_message_p);
     OAILOG_DEBUG(LOG_MME_APP, "Getting mme_nas_state");
     mme_app_desc_p = get_locked_mme_nas_state(false);
@@ -282,15 +291,20 @@ void *mme_app_thread(void *args)
       } break;
 
       case S11_PAGING_REQUEST: {
-        const char *imsi = received_message_p->ittiMsg.s11_paging_request.imsi;
-        OAILOG_DEBUG(
-          TASK_MME_APP, "MME handling paging request for IMSI%s\n", imsi);
-        if (mme_app_handle_initial_paging_request(mme_app_desc_p, imsi)!=
-            RETURNok) {
-          OAILOG_ERROR(
-            TASK_MME_APP,
-            "Failed to send paging request to S1AP for IMSI%s\n",
-            imsi);
+        itti_s11_paging_request_t *paging_request_p =
+          &received_message_p->ittiMsg.s11_paging_request;
+        for (int i = 0; i < paging_request_p->imsis_number; i++) {
+          char *imsi = paging_request_p->imsi[i];
+          OAILOG_DEBUG(
+            TASK_MME_APP, "MME handling paging request for IMSI%s\n", imsi);
+          if (mme_app_handle_initial_paging_request(mme_app_desc_p, imsi)!=
+              RETURNok) {
+            OAILOG_ERROR(
+              TASK_MME_APP,
+              "Failed to send paging request to S1AP for IMSI%s\n",
+              imsi);
+          }
+          free_wrapper((void **) &imsi);
         }
       } break;
 
@@ -73,6 +73,23 @@ void put_mme_nas_state(mme_app_desc_t** task_state_ptr)
     task_state_ptr);
 }
 
+/**
+ * Block until the MME/NAS state modified so far is committed to data store
+ */
+int mme_nas_state_sync_to_db(void)
+{
+  return magma::lte::MmeNasStateManager::getInstance().sync_state_to_db();
+}
+
+/**
+ * Mark the UE context of mme_ue_s1ap_id as modified, so that it is written to
+ * the data store by the next put_mme_nas_state() in per-UE persistence mode
+ */
+void mme_nas_state_mark_ue_dirty(mme_ue_s1ap_id_t mme_ue_s1ap_id)
+{
+  magma::lte::MmeNasStateManager::getInstance().mark_ue_dirty(mme_ue_s1ap_id);
+}
+
 /**
  * Release the memory allocated for the MME NAS state, this does not clean the
  * state persisted in data store
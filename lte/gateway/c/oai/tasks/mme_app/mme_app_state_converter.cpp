@@ -566,6 +566,7 @@ void MmeNasStateConverter::ue_context_to_proto(
     &state_ue_context->emm_context, emm_ctx);
   ue_context_proto->set_sctp_assoc_id_key(state_ue_context->sctp_assoc_id_key);
   ue_context_proto->set_enb_ue_s1ap_id(state_ue_context->enb_ue_s1ap_id);
+  ue_context_proto->set_enb_s1ap_id_key(state_ue_context->enb_s1ap_id_key);
   ue_context_proto->set_mme_ue_s1ap_id(state_ue_context->mme_ue_s1ap_id);
 
   ue_context_proto->set_attach_type(state_ue_context->attach_type);
@@ -737,7 +738,7 @@ void MmeNasStateConverter::proto_to_ue_mm_context(
 * Functions to serialize/desearialize MME app state      *
 * The caller is responsible for all memory management    *
 **********************************************************/
-void MmeNasStateConverter::mme_nas_state_to_proto(
+void MmeNasStateConverter::mme_nas_global_state_to_proto(
   mme_app_desc_t* mme_nas_state_p,
   MmeNasState* state_proto)
 {
@@ -760,7 +761,15 @@ void MmeNasStateConverter::mme_nas_state_to_proto(
     mme_nas_state_p->mme_ue_contexts.nb_ue_since_last_stat);
   mme_ue_ctxts_proto->set_nb_bearers_since_last_stat(
     mme_nas_state_p->mme_ue_contexts.nb_bearers_since_last_stat);
+}
+
+void MmeNasStateConverter::mme_nas_state_to_proto(
+  mme_app_desc_t* mme_nas_state_p,
+  MmeNasState* state_proto)
+{
+  mme_nas_global_state_to_proto(mme_nas_state_p, state_proto);
 
+  auto mme_ue_ctxts_proto = state_proto->mutable_mme_ue_contexts();
   hashtable_uint64_ts_to_proto(
     mme_nas_state_p->mme_ue_contexts.imsi_ue_context_htbl,
     mme_ue_ctxts_proto->mutable_imsi_ue_id_htbl(),
@@ -783,11 +792,10 @@ void MmeNasStateConverter::mme_nas_state_to_proto(
   return;
 }
 
-void MmeNasStateConverter::mme_nas_proto_to_state(
+void MmeNasStateConverter::mme_nas_global_proto_to_state(
   MmeNasState* state_proto,
   mme_app_desc_t* mme_nas_state_p)
 {
-  OAILOG_INFO(LOG_MME_APP, "Converting proto to state");
   mme_nas_state_p->nb_enb_connected = state_proto->nb_enb_connected();
   mme_nas_state_p->nb_ue_attached = state_proto->nb_ue_attached();
   mme_nas_state_p->nb_ue_connected = state_proto->nb_ue_connected();
@@ -808,7 +816,16 @@ void MmeNasStateConverter::mme_nas_proto_to_state(
   mme_nas_state_p->mme_ue_contexts.nb_bearers_since_last_stat =
     mme_ue_ctxts_proto.nb_bearers_since_last_stat();
   OAILOG_INFO(LOG_MME_APP, "Read MME UE context statistics from data store");
+}
 
+void MmeNasStateConverter::mme_nas_proto_to_state(
+  MmeNasState* state_proto,
+  mme_app_desc_t* mme_nas_state_p)
+{
+  OAILOG_INFO(LOG_MME_APP, "Converting proto to state");
+  mme_nas_global_proto_to_state(state_proto, mme_nas_state_p);
+
+  const MmeUeContext& mme_ue_ctxts_proto = state_proto->mme_ue_contexts();
   mme_ue_context_t* mme_ue_ctxt_state = &mme_nas_state_p->mme_ue_contexts;
   // copy maps to hashtables
   OAILOG_INFO(LOG_MME_APP, "Hashtable 0");
@@ -835,5 +852,63 @@ void MmeNasStateConverter::mme_nas_proto_to_state(
     mme_ue_ctxts_proto.guti_ue_id_htbl(),
     mme_ue_ctxt_state->guti_ue_context_htbl);*/
 }
+
+void MmeNasStateConverter::mme_ue_context_to_proto(
+  ue_mm_context_t* ue_context_p,
+  UeContext* ue_context_proto)
+{
+  ue_context_to_proto(ue_context_p, ue_context_proto);
+}
+
+void MmeNasStateConverter::proto_to_mme_ue_context(
+  const UeContext& ue_context_proto,
+  mme_app_desc_t* mme_nas_state_p)
+{
+  mme_ue_context_t* mme_ue_ctxt_state = &mme_nas_state_p->mme_ue_contexts;
+  ue_mm_context_t* ue_context_p = mme_create_new_ue_context();
+  if (!ue_context_p) {
+    OAILOG_ERROR(LOG_MME_APP, "Could not allocate new UE context");
+    return;
+  }
+  proto_to_ue_mm_context(ue_context_proto, ue_context_p);
+
+  mme_ue_s1ap_id_t mme_ue_id = ue_context_p->mme_ue_s1ap_id;
+  hashtable_rc_t ht_rc = hashtable_ts_insert(
+    mme_ue_ctxt_state->mme_ue_s1ap_id_ue_context_htbl,
+    (const hash_key_t) mme_ue_id,
+    (void*) ue_context_p);
+  if (ht_rc != HASH_TABLE_OK) {
+    OAILOG_ERROR(
+      LOG_MME_APP,
+      "Failed to insert ue_context for mme_ue_s1ap_id %u, error: %s\n",
+      mme_ue_id,
+      hashtable_rc_code2string(ht_rc));
+    unlock_ue_contexts(ue_context_p);
+    mme_app_state_free_ue_context((void**) &ue_context_p);
+    free(ue_context_p);
+    return;
+  }
+
+  // The secondary indexes are not persisted per UE, rebuild them
+  if (ue_context_p->enb_s1ap_id_key != INVALID_ENB_UE_S1AP_ID_KEY) {
+    hashtable_uint64_ts_insert(
+      mme_ue_ctxt_state->enb_ue_s1ap_id_ue_context_htbl,
+      (const hash_key_t) ue_context_p->enb_s1ap_id_key,
+      mme_ue_id);
+  }
+  if (ue_context_p->emm_context._imsi64) {
+    hashtable_uint64_ts_insert(
+      mme_ue_ctxt_state->imsi_ue_context_htbl,
+      (const hash_key_t) ue_context_p->emm_context._imsi64,
+      mme_ue_id);
+  }
+  if (ue_context_p->mme_teid_s11) {
+    hashtable_uint64_ts_insert(
+      mme_ue_ctxt_state->tun11_ue_context_htbl,
+      (const hash_key_t) ue_context_p->mme_teid_s11,
+      mme_ue_id);
+  }
+  unlock_ue_contexts(ue_context_p);
+}
 } // namespace lte
 } // namespace magma
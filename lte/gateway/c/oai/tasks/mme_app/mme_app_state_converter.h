@@ -58,6 +58,29 @@ class MmeNasStateConverter : StateConverter {
     MmeNasState* state_proto,
     mme_app_desc_t* mme_nas_state_p);
 
+  // Serialize the MME-global part of mme_app_desc_t, without UE contexts
+  static void mme_nas_global_state_to_proto(
+    mme_app_desc_t* mme_nas_state_p,
+    MmeNasState* state_proto);
+
+  // Deserialize the MME-global part of mme_app_desc_t
+  static void mme_nas_global_proto_to_state(
+    MmeNasState* state_proto,
+    mme_app_desc_t* mme_nas_state_p);
+
+  // Serialize a single UE context, the caller holds the UE context lock
+  static void mme_ue_context_to_proto(
+    ue_mm_context_t* ue_context_p,
+    UeContext* ue_context_proto);
+
+  /**
+   * Deserialize a single UE context and insert it in the MME UE collections,
+   * rebuilding the IMSI, S11 TEID and eNB UE S1AP ID indexes from it
+   */
+  static void proto_to_mme_ue_context(
+    const UeContext& ue_context_proto,
+    mme_app_desc_t* mme_nas_state_p);
+
  private:
   /***********************************************************
     *                 Hashtable <-> Proto
@@ -32,6 +32,8 @@ extern "C" {
 namespace {
 const char* LOCALHOST = "127.0.0.1";
 const char* MME_NAS_STATE_KEY = "mme_nas_state";
+const char* MME_NAS_UE_STATE_KEY = "mme_nas_ue_state";
+const int UE_STATE_SCAN_COUNT = 1000;
 const int NUM_MAX_UE_HTBL_LISTS = 6;
 const char* UE_ID_UE_CTXT_TABLE_NAME = "mme_app_mme_ue_s1ap_id_ue_context_htbl";
 const char* IMSI_UE_ID_TABLE_NAME = "mme_app_imsi_ue_context_htbl";
@@ -60,9 +62,11 @@ MmeNasStateManager::MmeNasStateManager():
   mme_nas_state_p_(nullptr),
   mme_nas_state_dirty_(false),
   persist_state_(false),
+  persist_per_ue_(false),
   mme_nas_db_client_(nullptr),
   max_ue_htbl_lists_(NUM_MAX_UE_HTBL_LISTS),
-  mme_statistic_timer_(10)
+  mme_statistic_timer_(10),
+  write_behind_window_ms_(0)
 {
 }
 
@@ -75,8 +79,10 @@ MmeNasStateManager::~MmeNasStateManager()
 int MmeNasStateManager::initialize_state(const mme_config_t* mme_config_p)
 {
   persist_state_ = mme_config_p->use_stateless;
+  persist_per_ue_ = mme_config_p->use_stateless_per_ue;
   max_ue_htbl_lists_ = mme_config_p->max_ues;
   mme_statistic_timer_ = mme_config_p->mme_statistic_timer;
+  write_behind_window_ms_ = mme_config_p->state_write_behind_window_ms;
 
   // Allocate the local mme state
   create_mme_nas_state();
@@ -130,39 +136,66 @@ void MmeNasStateManager::write_state_to_db(mme_app_desc_t** task_state_ptr)
   // clear up the local ptr of the task holding the state pointer
   *task_state_ptr = nullptr;
 
-  if (persist_state_) {
-    std::string serialized_state;
-    // convert the in-memory state to proto message
-    MmeNasState state_proto = MmeNasState();
-    MmeNasStateConverter::mme_nas_state_to_proto(
-      mme_nas_state_p_, &state_proto);
-
-    if (!state_proto.SerializeToString(&serialized_state)) {
-      OAILOG_ERROR(LOG_MME_APP, "Failed to serialize MME state");
-      goto error;
-      return;
-    }
-
-    OAILOG_DEBUG(LOG_MME_APP, "Writing serialized MME state to redis");
-    // write the proto to redis store
-    auto db_write =
-      mme_nas_db_client_->set(MME_NAS_STATE_KEY, serialized_state);
-    mme_nas_db_client_->sync_commit();
-    auto reply = db_write.get();
-
-    if (reply.is_error()) {
-      OAILOG_ERROR(LOG_MME_APP, "Failed to write to data store");
-      goto error;
-      return;
-    }
-
-    OAILOG_DEBUG(LOG_MME_APP, "MME NAS state written to redis");
+  if (persist_state_ && write_state(false) != RETURNok) {
+    goto error;
   }
   mme_nas_state_dirty_ = false;
 error:
   unlock_mme_nas_state();
 }
 
+int MmeNasStateManager::write_state(bool keep_dirty_ues)
+{
+  if (persist_per_ue_) {
+    return write_per_ue_state_to_db(keep_dirty_ues);
+  }
+
+  std::string serialized_state;
+  // convert the in-memory state to proto message
+  MmeNasState state_proto = MmeNasState();
+  MmeNasStateConverter::mme_nas_state_to_proto(mme_nas_state_p_, &state_proto);
+
+  if (!state_proto.SerializeToString(&serialized_state)) {
+    OAILOG_ERROR(LOG_MME_APP, "Failed to serialize MME state");
+    return RETURNerror;
+  }
+
+  if (state_flusher_) {
+    state_flusher_->set(MME_NAS_STATE_KEY, serialized_state);
+    return RETURNok;
+  }
+
+  OAILOG_DEBUG(LOG_MME_APP, "Writing serialized MME state to redis");
+  // write the proto to redis store
+  auto db_write = mme_nas_db_client_->set(MME_NAS_STATE_KEY, serialized_state);
+  mme_nas_db_client_->sync_commit();
+  auto reply = db_write.get();
+
+  if (reply.is_error()) {
+    OAILOG_ERROR(LOG_MME_APP, "Failed to write to data store");
+    return RETURNerror;
+  }
+
+  OAILOG_DEBUG(LOG_MME_APP, "MME NAS state written to redis");
+  return RETURNok;
+}
+
+int MmeNasStateManager::sync_state_to_db()
+{
+  AssertFatal(
+    is_initialized_, "Calling sync without initializing MME state manager");
+  // Synchronous writes are already committed when write_state_to_db returns
+  if (!persist_state_ || !state_flusher_) {
+    return RETURNok;
+  }
+  // UE contexts locked by the current message stay dirty, they may change
+  // after the sync and must be written again by write_state_to_db
+  if (write_state(true) != RETURNok) {
+    return RETURNerror;
+  }
+  return state_flusher_->flush_sync();
+}
+
 /**
  * Getter function to lock the state before returning the pointer to in-memory
  * user state. The read_from_db flag is a bebug flag to force read from the
@@ -232,6 +265,17 @@ int MmeNasStateManager::initialize_db_connection()
     return RETURNerror;
   }
 
+  if (write_behind_window_ms_ > 0) {
+    state_flusher_ = std::make_unique<StateFlusher>(
+      MME_NAS_STATE_KEY,
+      LOG_MME_APP,
+      std::chrono::milliseconds(write_behind_window_ms_));
+    if (state_flusher_->start(LOCALHOST, port) != RETURNok) {
+      OAILOG_ERROR(LOG_MME_APP, "Failed to start the MME NAS state flusher");
+      return RETURNerror;
+    }
+  }
+
   OAILOG_DEBUG(
     LOG_MME_APP, "Connected to redis datastore on %s:%u\n", LOCALHOST, port);
 
@@ -245,6 +289,7 @@ void MmeNasStateManager::clear_db_state()
   OAILOG_DEBUG(LOG_MME_APP, "Clearing state in data store");
   std::vector<std::string> keys_to_del;
   keys_to_del.push_back(MME_NAS_STATE_KEY);
+  keys_to_del.push_back(MME_NAS_UE_STATE_KEY);
   auto db_write = mme_nas_db_client_->del(keys_to_del);
   mme_nas_db_client_->sync_commit();
   auto reply = db_write.get();
@@ -287,6 +332,9 @@ void MmeNasStateManager::mme_nas_state_init_local_state()
 int MmeNasStateManager::read_state_from_db()
 {
   OAILOG_FUNC_IN(LOG_MME_APP);
+  if (persist_per_ue_) {
+    return read_per_ue_state_from_db();
+  }
   // convert the datastore proto message to in-memory state
 
   OAILOG_DEBUG(LOG_MME_APP, "Reading MME NAS state from redis");
@@ -317,6 +365,190 @@ int MmeNasStateManager::read_state_from_db()
   return RETURNok;
 }
 
+void MmeNasStateManager::mark_ue_dirty(mme_ue_s1ap_id_t mme_ue_s1ap_id)
+{
+  if (
+    !persist_state_ || !persist_per_ue_ ||
+    mme_ue_s1ap_id == INVALID_MME_UE_S1AP_ID) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(dirty_ue_ids_mutex_);
+  dirty_ue_ids_.insert(mme_ue_s1ap_id);
+}
+
+int MmeNasStateManager::write_per_ue_state_to_db(bool keep_dirty_ues)
+{
+  std::unordered_set<mme_ue_s1ap_id_t> dirty_ue_ids;
+  {
+    std::lock_guard<std::mutex> lock(dirty_ue_ids_mutex_);
+    if (keep_dirty_ues) {
+      dirty_ue_ids = dirty_ue_ids_;
+    } else {
+      dirty_ue_ids.swap(dirty_ue_ids_);
+    }
+  }
+
+  std::vector<std::future<cpp_redis::reply>> db_writes;
+  std::vector<std::string> removed_ue_ids;
+  std::string serialized_ue_context;
+  UeContext ue_context_proto;
+  for (auto mme_ue_id : dirty_ue_ids) {
+    ue_mm_context_t* ue_context_p = nullptr;
+    hashtable_ts_get(
+      mme_nas_state_p_->mme_ue_contexts.mme_ue_s1ap_id_ue_context_htbl,
+      (const hash_key_t) mme_ue_id,
+      (void**) &ue_context_p);
+    if (!ue_context_p) {
+      // UE context was released while handling the message
+      removed_ue_ids.push_back(std::to_string(mme_ue_id));
+      continue;
+    }
+    MmeNasStateConverter::mme_ue_context_to_proto(
+      ue_context_p, &ue_context_proto);
+    if (!ue_context_proto.SerializeToString(&serialized_ue_context)) {
+      OAILOG_ERROR(
+        LOG_MME_APP,
+        "Failed to serialize UE context " MME_UE_S1AP_ID_FMT,
+        mme_ue_id);
+      continue;
+    }
+    if (state_flusher_) {
+      state_flusher_->hset(
+        MME_NAS_UE_STATE_KEY, std::to_string(mme_ue_id), serialized_ue_context);
+      continue;
+    }
+    db_writes.push_back(mme_nas_db_client_->hset(
+      MME_NAS_UE_STATE_KEY, std::to_string(mme_ue_id), serialized_ue_context));
+  }
+  if (state_flusher_) {
+    for (const auto& mme_ue_id : removed_ue_ids) {
+      state_flusher_->hdel(MME_NAS_UE_STATE_KEY, mme_ue_id);
+    }
+  } else if (!removed_ue_ids.empty()) {
+    db_writes.push_back(
+      mme_nas_db_client_->hdel(MME_NAS_UE_STATE_KEY, removed_ue_ids));
+  }
+
+  // The MME-global part is small, only write it when it changed
+  std::string serialized_state;
+  MmeNasState state_proto = MmeNasState();
+  MmeNasStateConverter::mme_nas_global_state_to_proto(
+    mme_nas_state_p_, &state_proto);
+  if (!state_proto.SerializeToString(&serialized_state)) {
+    OAILOG_ERROR(LOG_MME_APP, "Failed to serialize MME state");
+    return RETURNerror;
+  }
+  if (state_flusher_) {
+    // The flusher retries failed batches itself
+    if (serialized_state != last_global_state_) {
+      state_flusher_->set(MME_NAS_STATE_KEY, serialized_state);
+      last_global_state_ = serialized_state;
+    }
+    return RETURNok;
+  }
+  if (serialized_state != last_global_state_) {
+    db_writes.push_back(
+      mme_nas_db_client_->set(MME_NAS_STATE_KEY, serialized_state));
+  }
+
+  if (db_writes.empty()) {
+    return RETURNok;
+  }
+
+  OAILOG_DEBUG(
+    LOG_MME_APP,
+    "Writing %zu UE contexts and removing %zu from redis",
+    dirty_ue_ids.size() - removed_ue_ids.size(),
+    removed_ue_ids.size());
+  mme_nas_db_client_->sync_commit();
+
+  int rc = RETURNok;
+  for (auto& db_write : db_writes) {
+    if (db_write.get().is_error()) {
+      rc = RETURNerror;
+    }
+  }
+  if (rc != RETURNok) {
+    OAILOG_ERROR(LOG_MME_APP, "Failed to write to data store");
+    // Keep the records dirty so that they are written on the next put
+    std::lock_guard<std::mutex> lock(dirty_ue_ids_mutex_);
+    dirty_ue_ids_.insert(dirty_ue_ids.begin(), dirty_ue_ids.end());
+    last_global_state_.clear();
+    return RETURNerror;
+  }
+
+  last_global_state_ = serialized_state;
+  OAILOG_DEBUG(LOG_MME_APP, "MME NAS state written to redis");
+  return RETURNok;
+}
+
+int MmeNasStateManager::read_per_ue_state_from_db()
+{
+  OAILOG_DEBUG(LOG_MME_APP, "Reading MME NAS global state from redis");
+  auto db_read = mme_nas_db_client_->get(MME_NAS_STATE_KEY);
+  mme_nas_db_client_->sync_commit();
+  auto reply = db_read.get();
+
+  if (reply.is_error()) {
+    OAILOG_ERROR(LOG_MME_APP, "Reading MME NAS state from DB gave an error");
+    return RETURNerror;
+  }
+  if (reply.is_string()) {
+    MmeNasState state_proto;
+    if (!state_proto.ParseFromString(reply.as_string())) {
+      return RETURNerror;
+    }
+    MmeNasStateConverter::mme_nas_global_proto_to_state(
+      &state_proto, mme_nas_state_p_);
+    last_global_state_ = reply.as_string();
+  }
+
+  OAILOG_DEBUG(LOG_MME_APP, "Scanning MME NAS UE contexts from redis");
+  std::size_t cursor = 0;
+  std::size_t num_ue_contexts = 0;
+  do {
+    auto db_scan = mme_nas_db_client_->hscan(
+      MME_NAS_UE_STATE_KEY, cursor, UE_STATE_SCAN_COUNT);
+    mme_nas_db_client_->sync_commit();
+    auto scan_reply = db_scan.get();
+
+    if (
+      scan_reply.is_error() || !scan_reply.is_array() ||
+      scan_reply.as_array().size() != 2) {
+      OAILOG_ERROR(LOG_MME_APP, "Scanning UE contexts from DB gave an error");
+      return RETURNerror;
+    }
+
+    const auto& scan_result = scan_reply.as_array();
+    cursor = std::stoull(scan_result[0].as_string());
+    const auto& fields = scan_result[1].as_array();
+    // Fields and values are interleaved in the reply
+    for (std::size_t i = 0; i + 1 < fields.size(); i += 2) {
+      UeContext ue_context_proto;
+      if (!ue_context_proto.ParseFromString(fields[i + 1].as_string())) {
+        OAILOG_ERROR(
+          LOG_MME_APP,
+          "Failed to parse UE context %s",
+          fields[i].as_string().c_str());
+        continue;
+      }
+      MmeNasStateConverter::proto_to_mme_ue_context(
+        ue_context_proto, mme_nas_state_p_);
+      num_ue_contexts++;
+    }
+  } while (cursor != 0);
+
+  // Contexts locked while rebuilding the state are already in the data store
+  {
+    std::lock_guard<std::mutex> lock(dirty_ue_ids_mutex_);
+    dirty_ue_ids_.clear();
+  }
+
+  OAILOG_INFO(
+    LOG_MME_APP, "Read %zu UE contexts from data store", num_ue_contexts);
+  return RETURNok;
+}
+
 // Create the hashtables for MME NAS state
 void MmeNasStateManager::create_hashtables()
 {
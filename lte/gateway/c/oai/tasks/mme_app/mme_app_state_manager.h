@@ -25,10 +25,14 @@ extern "C" {
 #include "mme_config.h"
 }
 
+#include <mutex>
+#include <unordered_set>
+
 #include <cpp_redis/cpp_redis>
 
 #include "mme_app_state_converter.h"
 #include "ServiceConfigLoader.h"
+#include "state_flusher.h"
 
 namespace magma {
 namespace lte {
@@ -55,6 +59,14 @@ class MmeNasStateManager {
    */
   void write_state_to_db(mme_app_desc_t** task_state_ptr);
 
+  /**
+   * Block until the MME NAS state modified so far is committed to redis. In
+   * write-behind mode, the state is queued to the flusher and the flusher
+   * commits it before returning. Used on detach and purge paths that must be
+   * durable before replying. The calling thread must hold the state lock.
+   */
+  int sync_state_to_db();
+
   /**
     * This is a thread-safe call to lock the state and retrieve the pointer to
     * MME Nas state from state manager. The read_from_db flag is a debug flag;
@@ -76,6 +88,13 @@ class MmeNasStateManager {
 
   void free_in_memory_mme_nas_state();
 
+  /**
+    * Mark the UE context of mme_ue_s1ap_id as modified. In per-UE persistence
+    * mode, write_state_to_db only serializes the marked UE contexts. This is a
+    * thread-safe call.
+    */
+  void mark_ue_dirty(mme_ue_s1ap_id_t mme_ue_s1ap_id);
+
   /**
    * Copy constructor and assignment operator are marked as deleted functions.
    * Making them public for better debugging/logging.
@@ -98,6 +117,16 @@ class MmeNasStateManager {
   int max_ue_htbl_lists_;
   uint32_t mme_statistic_timer_;
   bool mme_nas_state_dirty_; // TODO: convert this to version numbers
+  // Persist every UE context as a separate field of a redis hash
+  bool persist_per_ue_;
+  // UE contexts modified since the last write, in per-UE persistence mode
+  std::unordered_set<mme_ue_s1ap_id_t> dirty_ue_ids_;
+  std::mutex dirty_ue_ids_mutex_;
+  // Last MME-global state written in per-UE persistence mode
+  std::string last_global_state_;
+  // Coalescing window of the write-behind flusher, 0 writes synchronously
+  uint32_t write_behind_window_ms_;
+  std::unique_ptr<StateFlusher> state_flusher_;
 
   // Initialize state that is non-persistent, e.g. mutex locks and timers
   void mme_nas_state_init_local_state();
@@ -123,6 +152,25 @@ class MmeNasStateManager {
    */
   int read_state_from_db();
 
+  /**
+   * Serialize the state and write it to redis, or queue it to the flusher.
+   * keep_dirty_ues keeps the written UE contexts marked dirty, for writes in
+   * the middle of a message, as the UE contexts still locked may change.
+   */
+  int write_state(bool keep_dirty_ues);
+
+  /**
+   * Write the MME-global state and the UE contexts marked dirty since the
+   * last write, pipelined in a single commit
+   */
+  int write_per_ue_state_to_db(bool keep_dirty_ues);
+
+  /**
+   * Read the MME-global state and scan the per-UE hash to rebuild the UE
+   * context collections
+   */
+  int read_per_ue_state_from_db();
+
   /**
    * Initialize memory for MME state before reading from data-store, the state
    * manager owns the memory allocated for MME state and frees it when the
@@ -123,6 +123,8 @@ void log_config_init(log_config_t *log_conf)
   log_conf->output = NULL;
   log_conf->is_output_thread_safe = false;
   log_conf->color = false;
+  log_conf->is_binary = false;
+  log_conf->binary_dump = NULL;
 
   log_conf->udp_log_level = MAX_LOG_LEVEL; // Means invalid TODO wtf
   log_conf->gtpv1u_log_level = MAX_LOG_LEVEL;
@@ -178,12 +180,16 @@ void itti_config_init(itti_config_t *itti_conf)
 {
   itti_conf->queue_size = ITTI_QUEUE_MAX_ELEMENTS;
   itti_conf->log_file = NULL;
+  itti_conf->memory_pools_number = 0;
+  itti_conf->memory_pools_growth = false;
 }
 
 void sctp_config_init(sctp_config_t *sctp_conf)
 {
   sctp_conf->in_streams = SCTP_IN_STREAMS;
   sctp_conf->out_streams = SCTP_OUT_STREAMS;
+  sctp_conf->use_shm_rings = false;
+  sctp_conf->recv_workers = SCTP_RECV_WORKERS;
 }
 
 void nas_config_init(nas_config_t *nas_conf)
@@ -267,6 +273,7 @@ void mme_config_exit(void)
 {
   pthread_rwlock_destroy(&mme_config.rw_lock);
   bdestroy_wrapper(&mme_config.log_config.output);
+  bdestroy_wrapper(&mme_config.log_config.binary_dump);
   bdestroy_wrapper(&mme_config.realm);
   bdestroy_wrapper(&mme_config.config_file);
 
@@ -368,6 +375,24 @@ int mme_config_parse_file(mme_config_t *config_pP)
         }
       }
 
+      if (config_setting_lookup_string(
+            setting, LOG_CONFIG_STRING_BINARY, (const char **) &astring)) {
+        if (astring != NULL) {
+          config_pP->log_config.is_binary = parse_bool(astring);
+        }
+      }
+
+      if (config_setting_lookup_string(
+            setting, LOG_CONFIG_STRING_BINARY_DUMP, (const char **) &astring)) {
+        if ((astring != NULL) && (strlen(astring) > 0)) {
+          if (config_pP->log_config.binary_dump) {
+            bassigncstr(config_pP->log_config.binary_dump, astring);
+          } else {
+            config_pP->log_config.binary_dump = bfromcstr(astring);
+          }
+        }
+      }
+
       if (config_setting_lookup_string(
             setting, LOG_CONFIG_STRING_COLOR, (const char **) &astring)) {
         if (0 == strcasecmp("yes", astring))
@@ -535,6 +560,20 @@ int mme_config_parse_file(mme_config_t *config_pP)
       config_pP->use_stateless = parse_bool(astring);
     }
 
+    if ((config_setting_lookup_string(
+          setting_mme,
+          MME_CONFIG_STRING_USE_STATELESS_PER_UE,
+          (const char **) &astring))) {
+      config_pP->use_stateless_per_ue = parse_bool(astring);
+    }
+
+    if ((config_setting_lookup_int(
+          setting_mme,
+          MME_CONFIG_STRING_STATE_WRITE_BEHIND_WINDOW_MS,
+          &aint))) {
+      config_pP->state_write_behind_window_ms = (uint32_t) aint;
+    }
+
     if ((config_setting_lookup_string(
           setting_mme,
           EPS_NETWORK_FEATURE_SUPPORT_EMERGENCY_BEARER_SERVICES_IN_S1_MODE,
@@ -582,6 +621,49 @@ int mme_config_parse_file(mme_config_t *config_pP)
             &aint))) {
         config_pP->itti_config.queue_size = (uint32_t) aint;
       }
+
+      subsetting = config_setting_get_member(
+        setting, MME_CONFIG_STRING_INTERTASK_INTERFACE_MEMORY_POOLS);
+
+      if (subsetting != NULL) {
+        num = config_setting_length(subsetting);
+        AssertFatal(
+          num <= MAX_ITTI_MEMORY_POOLS,
+          "Too many ITTI memory pools configured (%d/%d)",
+          num,
+          MAX_ITTI_MEMORY_POOLS);
+        config_pP->itti_config.memory_pools_number = num;
+
+        for (i = 0; i < num; i++) {
+          sub2setting = config_setting_get_elem(subsetting, i);
+          AssertFatal(
+            (sub2setting != NULL) &&
+              config_setting_lookup_int(
+                sub2setting,
+                MME_CONFIG_STRING_INTERTASK_INTERFACE_MEMORY_POOL_ITEM_SIZE,
+                &aint) &&
+              (aint > 0),
+            "Bad ITTI memory pool %d item size",
+            i);
+          config_pP->itti_config.memory_pools[i].item_size = (uint32_t) aint;
+          AssertFatal(
+            config_setting_lookup_int(
+              sub2setting,
+              MME_CONFIG_STRING_INTERTASK_INTERFACE_MEMORY_POOL_ITEMS,
+              &aint) &&
+              (aint >= 0),
+            "Bad ITTI memory pool %d items number",
+            i);
+          config_pP->itti_config.memory_pools[i].items_number = (uint32_t) aint;
+        }
+      }
+
+      if ((config_setting_lookup_string(
+            setting,
+            MME_CONFIG_STRING_INTERTASK_INTERFACE_MEMORY_POOLS_GROWTH,
+            (const char **) &astring))) {
+        config_pP->itti_config.memory_pools_growth = parse_bool(astring);
+      }
     }
     // S6A SETTING
     setting =
@@ -633,6 +715,18 @@ int mme_config_parse_file(mme_config_t *config_pP)
             setting, MME_CONFIG_STRING_SCTP_OUTSTREAMS, &aint))) {
         config_pP->sctp_config.out_streams = (uint16_t) aint;
       }
+
+      if ((config_setting_lookup_string(
+            setting,
+            MME_CONFIG_STRING_SCTP_SHM_RINGS,
+            (const char **) &astring))) {
+        config_pP->sctp_config.use_shm_rings = parse_bool(astring);
+      }
+
+      if ((config_setting_lookup_int(
+            setting, MME_CONFIG_STRING_SCTP_RECV_WORKERS, &aint))) {
+        config_pP->sctp_config.recv_workers = (uint16_t) aint;
+      }
     }
     // S1AP SETTING
     setting =
@@ -1285,6 +1379,14 @@ void mme_config_display(mme_config_t *config_pP)
     LOG_CONFIG,
     "- Use Stateless ........................: %s\n\n",
     config_pP->use_stateless ? "true" : "false");
+  OAILOG_INFO(
+    LOG_CONFIG,
+    "- Use Stateless per UE .................: %s\n\n",
+    config_pP->use_stateless_per_ue ? "true" : "false");
+  OAILOG_INFO(
+    LOG_CONFIG,
+    "- State write-behind window ............: %u (ms)\n\n",
+    config_pP->state_write_behind_window_ms);
   OAILOG_INFO(LOG_CONFIG, "- CSFB:\n");
   OAILOG_INFO(
     LOG_CONFIG,
@@ -1323,6 +1425,17 @@ void mme_config_display(mme_config_t *config_pP)
     LOG_CONFIG,
     "    log file .........: %s\n",
     bdata(config_pP->itti_config.log_file));
+  for (j = 0; j < config_pP->itti_config.memory_pools_number; j++) {
+    OAILOG_INFO(
+      LOG_CONFIG,
+      "    memory pool ......: %u items of %u bytes\n",
+      config_pP->itti_config.memory_pools[j].items_number,
+      config_pP->itti_config.memory_pools[j].item_size);
+  }
+  OAILOG_INFO(
+    LOG_CONFIG,
+    "    memory pool growth: %s\n",
+    config_pP->itti_config.memory_pools_growth ? "true" : "false");
   OAILOG_INFO(LOG_CONFIG, "- SCTP:\n");
   OAILOG_INFO(
     LOG_CONFIG,
@@ -1332,6 +1445,14 @@ void mme_config_display(mme_config_t *config_pP)
     LOG_CONFIG,
     "    out streams ......: %u\n",
     config_pP->sctp_config.out_streams);
+  OAILOG_INFO(
+    LOG_CONFIG,
+    "    shm rings ........: %s\n",
+    config_pP->sctp_config.use_shm_rings ? "true" : "false");
+  OAILOG_INFO(
+    LOG_CONFIG,
+    "    recv workers .....: %u\n",
+    config_pP->sctp_config.recv_workers);
   OAILOG_INFO(LOG_CONFIG, "- GUMMEIs (PLMN|MMEGI|MMEC):\n");
   for (j = 0; j < config_pP->gummei.nb; j++) {
     OAILOG_INFO(
@@ -1452,6 +1573,16 @@ void mme_config_display(mme_config_t *config_pP)
     LOG_CONFIG,
     "    Output with color ...: %s\n",
     (config_pP->log_config.color) ? "true" : "false");
+  OAILOG_INFO(
+    LOG_CONFIG,
+    "    Binary ..............: %s\n",
+    (config_pP->log_config.is_binary) ? "true" : "false");
+  if (config_pP->log_config.binary_dump) {
+    OAILOG_INFO(
+      LOG_CONFIG,
+      "    Binary dump .........: %s\n",
+      bdata(config_pP->log_config.binary_dump));
+  }
   OAILOG_INFO(
     LOG_CONFIG,
     "    UDP log level........: %s\n",
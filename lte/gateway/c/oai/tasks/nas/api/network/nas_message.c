@@ -1241,6 +1241,7 @@ static int _nas_message_decrypt(
               count);
             stream_cipher.key = emm_security_context->knas_enc;
             stream_cipher.key_length = AUTH_KNAS_ENC_SIZE;
+            stream_cipher.key_cache = &emm_security_context->knas_enc_aes;
             stream_cipher.count = count;
             stream_cipher.bearer = 0x00; //33.401 section 8.1.1
             stream_cipher.direction = direction;
@@ -1423,6 +1424,7 @@ static int _nas_message_encrypt(
             count);
           stream_cipher.key = emm_security_context->knas_enc;
           stream_cipher.key_length = AUTH_KNAS_ENC_SIZE;
+          stream_cipher.key_cache = &emm_security_context->knas_enc_aes;
           stream_cipher.count = count;
           stream_cipher.bearer = 0x00; //33.401 section 8.1.1
           stream_cipher.direction = direction;
@@ -1509,7 +1511,7 @@ static uint32_t _nas_message_get_mac(
   switch (emm_security_context->selected_algorithms.integrity) {
     case NAS_SECURITY_ALGORITHMS_EIA1: {
       uint8_t mac[4];
-      nas_stream_cipher_t stream_cipher;
+      nas_stream_cipher_t stream_cipher = {0};
       uint32_t count;
       uint32_t *mac32;
 
@@ -1560,7 +1562,7 @@ static uint32_t _nas_message_get_mac(
 
     case NAS_SECURITY_ALGORITHMS_EIA2: {
       uint8_t mac[4];
-      nas_stream_cipher_t stream_cipher;
+      nas_stream_cipher_t stream_cipher = {0};
       uint32_t count;
       uint32_t *mac32;
 
@@ -1584,6 +1586,7 @@ static uint32_t _nas_message_get_mac(
         count);
       stream_cipher.key = emm_security_context->knas_int;
       stream_cipher.key_length = AUTH_KNAS_INT_SIZE;
+      stream_cipher.key_cache = &emm_security_context->knas_int_aes;
       stream_cipher.count = count;
       stream_cipher.bearer = 0x00; //33.401 section 8.1.1
       stream_cipher.direction = direction;
@@ -56,6 +56,7 @@ Description Defines internal private data handled by EPS Mobility
 #include "EpsNetworkFeatureSupport.h"
 #include "MobileStationClassmark2.h"
 #include "esm_data.h"
+#include "secu_defs.h"
 
 /****************************************************************************/
 /*********************  G L O B A L    C O N S T A N T S  *******************/
@@ -80,6 +81,9 @@ typedef struct emm_security_context_s {
   int vector_index;                     /* Pointer on vector */
   uint8_t knas_enc[AUTH_KNAS_ENC_SIZE]; /* NAS cyphering key               */
   uint8_t knas_int[AUTH_KNAS_INT_SIZE]; /* NAS integrity key               */
+  /* Expanded knas_enc and knas_int for EEA2 and EIA2, not persisted */
+  nas_aes128_key_t knas_enc_aes;
+  nas_aes128_key_t knas_int_aes;
 
   struct count_s {
     uint32_t spare : 8;
@@ -19,6 +19,7 @@
  *      contact@openairinterface.org
  */
 
+#include <pthread.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
@@ -62,6 +63,30 @@
 /*******************  L O C A L    D E F I N I T I O N S  *******************/
 /****************************************************************************/
 
+/*
+ * Counters updated for every attach or service request, resolved only once.
+ * NAS messages can be handled from more than one thread, hence the once.
+ */
+static pthread_once_t _emm_counters_once = PTHREAD_ONCE_INIT;
+static counter_handle_t *attach_counter = NULL;
+static counter_handle_t *eps_attach_counter = NULL;
+static counter_handle_t *combined_attach_counter = NULL;
+static counter_handle_t *emergency_attach_counter = NULL;
+static counter_handle_t *service_request_counter = NULL;
+
+static void _emm_init_counters(void)
+{
+  attach_counter = get_counter_handle("ue_attach", NO_LABELS);
+  eps_attach_counter =
+    get_counter_handle("ue_attach", 1, "attach_type", "eps_attach");
+  combined_attach_counter = get_counter_handle(
+    "ue_attach", 1, "attach_type", "combined_eps_imsi_attach");
+  emergency_attach_counter =
+    get_counter_handle("ue_attach", 1, "attach_type", "emergency_attach");
+  service_request_counter =
+    get_counter_handle("service_request", 1, "result", "success");
+}
+
 /****************************************************************************/
 /******************  E X P O R T E D    F U N C T I O N S  ******************/
 /****************************************************************************/
@@ -147,9 +172,10 @@ int emm_recv_attach_request(
 {
   OAILOG_FUNC_IN(LOG_NAS_EMM);
   int rc = RETURNok;
+  pthread_once(&_emm_counters_once, _emm_init_counters);
 
   OAILOG_INFO(LOG_NAS_EMM, "EMMAS-SAP - Received Attach Request message\n");
-  increment_counter("ue_attach", 1, NO_LABELS);
+  counter_handle_increment(attach_counter, 1);
   /*
    * Message checking
    */
@@ -191,16 +217,15 @@ int emm_recv_attach_request(
    */
   params->type = EMM_ATTACH_TYPE_RESERVED;
   if (msg->epsattachtype == EPS_ATTACH_TYPE_EPS) {
-    increment_counter("ue_attach", 1, 1, "attach_type", "eps_attach");
+    counter_handle_increment(eps_attach_counter, 1);
     params->type = EMM_ATTACH_TYPE_EPS;
 
   } else if (msg->epsattachtype == EPS_ATTACH_TYPE_COMBINED_EPS_IMSI) {
-    increment_counter(
-      "ue_attach", 1, 1, "attach_type", "combined_eps_imsi_attach");
+    counter_handle_increment(combined_attach_counter, 1);
     params->type = EMM_ATTACH_TYPE_COMBINED_EPS_IMSI;
   } else if (msg->epsattachtype == EPS_ATTACH_TYPE_EMERGENCY) {
     params->type = EMM_ATTACH_TYPE_EMERGENCY;
-    increment_counter("ue_attach", 1, 1, "attach_type", "emergency_attach");
+    counter_handle_increment(emergency_attach_counter, 1);
   } else if (msg->epsattachtype == EPS_ATTACH_TYPE_RESERVED) {
     params->type = EMM_ATTACH_TYPE_RESERVED;
   } else {
@@ -822,7 +847,8 @@ int emm_recv_service_request(
   rc = _emm_initiate_default_bearer_re_establishment(emm_ctx);
   if (rc == RETURNok) {
     *emm_cause = EMM_CAUSE_SUCCESS;
-    increment_counter("service_request", 1, 1, "result", "success");
+    pthread_once(&_emm_counters_once, _emm_init_counters);
+    counter_handle_increment(service_request_counter, 1);
   } else {
     increment_counter(
       "service_request",
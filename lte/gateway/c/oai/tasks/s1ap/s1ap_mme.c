@@ -101,6 +101,8 @@ static int s1ap_send_init_sctp(void)
   message_p = itti_alloc_new_message(TASK_S1AP, SCTP_INIT_MSG);
   message_p->ittiMsg.sctpInit.port = S1AP_PORT_NUMBER;
   message_p->ittiMsg.sctpInit.ppid = S1AP_SCTP_PPID;
+  message_p->ittiMsg.sctpInit.recv_workers =
+    mme_config.sctp_config.recv_workers;
   message_p->ittiMsg.sctpInit.ipv4 = 1;
   message_p->ittiMsg.sctpInit.ipv6 = 0;
   message_p->ittiMsg.sctpInit.nb_ipv4_addr = 1;
@@ -119,18 +121,26 @@ static int s1ap_send_init_sctp(void)
 void *s1ap_mme_thread(__attribute__((unused)) void *args)
 {
   s1ap_state_t *state;
+  MessageDef *received_messages[ITTI_RECEIVE_BATCH_MAX];
+  size_t n_received = 0;
+  size_t next_received = 0;
 
+  itti_set_wakeup_coalescing(TASK_S1AP, true);
   itti_mark_task_ready(TASK_S1AP);
 
   while (1) {
     MessageDef *received_message_p = NULL;
     MessagesIds message_id = MESSAGES_ID_MAX;
     /*
-     * Trying to fetch a message from the message queue.
-     * * * * If the queue is empty, this function will block till a
-     * * * * message is sent to the task.
+     * Messages are fetched from the queue in batches, this only blocks
+     * once the previous batch is handled and the queue is empty.
      */
-    itti_receive_msg(TASK_S1AP, &received_message_p);
+    if (next_received == n_received) {
+      n_received = itti_receive_msg_batch(
+        TASK_S1AP, received_messages, ITTI_RECEIVE_BATCH_MAX);
+      next_received = 0;
+    }
+    received_message_p = received_messages[next_received++];
 
     state = s1ap_state_get();
     AssertFatal(state != NULL, "failed to retrieve s1ap state (was null)");
@@ -523,6 +533,7 @@ enb_description_t *s1ap_new_enb(s1ap_state_t *state)
   hashtable_ts_init(
     &enb_ref->ue_coll, mme_config.max_ues, NULL, free_wrapper, bs);
   bdestroy_wrapper(&bs);
+  hashtable_ts_set_single_owner(&enb_ref->ue_coll, true);
   enb_ref->nb_ue_associated = 0;
   enb_ref->s1ap_enb_assoc_clean_up_timer.sec = S1ap_TimeToWait_v20s;
   enb_ref->s1ap_enb_assoc_clean_up_timer.id = S1AP_TIMER_INACTIVE_ID;
@@ -562,6 +573,8 @@ ue_description_t *s1ap_new_ue(
   }
   // Increment number of UE
   enb_ref->nb_ue_associated++;
+  s1ap_state_mark_enb_dirty(enb_ref);
+  s1ap_state_mark_ue_dirty(ue_ref);
   return ue_ref;
 }
 
@@ -582,6 +595,7 @@ void s1ap_remove_ue(s1ap_state_t *state, ue_description_t *ue_ref)
    */
   DevAssert(enb_ref->nb_ue_associated > 0);
   enb_ref->nb_ue_associated--;
+  s1ap_state_mark_enb_dirty(enb_ref);
 
   /*
    * Remove any attached timer
@@ -607,12 +621,15 @@ void s1ap_remove_ue(s1ap_state_t *state, ue_description_t *ue_ref)
     enb_ref->enb_id);
 
   ue_ref->s1_ue_state = S1AP_UE_INVALID_STATE;
+  s1ap_state_mark_ue_dirty(ue_ref);
+  s1ap_state_remove_ue_mmeid(state, ue_ref);
   hashtable_ts_free(&enb_ref->ue_coll, ue_ref->enb_ue_s1ap_id);
   hashtable_ts_free(&state->mmeid2associd, mme_ue_s1ap_id);
   if (!enb_ref->nb_ue_associated) {
     if (enb_ref->s1_state == S1AP_RESETING) {
       OAILOG_INFO(LOG_S1AP, "Moving eNB state to S1AP_INIT \n");
       enb_ref->s1_state = S1AP_INIT;
+      s1ap_state_mark_enb_dirty(enb_ref);
       update_mme_app_stats_connected_enb_sub();
     } else if (enb_ref->s1_state == S1AP_SHUTDOWN) {
       OAILOG_INFO(LOG_S1AP, "Deleting eNB \n");
@@ -645,6 +662,9 @@ void s1ap_remove_enb(s1ap_state_t *state, enb_description_t *enb_ref)
     enb_ref->s1ap_enb_assoc_clean_up_timer.id = S1AP_TIMER_INACTIVE_ID;
   }
   enb_ref->s1_state = S1AP_INIT;
+  s1ap_state_mark_enb_dirty(enb_ref);
+  s1ap_state_mark_enb_ues_dirty(enb_ref);
+  s1ap_state_remove_enb_ues_mmeid(state, enb_ref);
   hashtable_ts_destroy(&enb_ref->ue_coll);
   hashtable_ts_free(&state->enbs, enb_ref->sctp_assoc_id);
   state->num_enbs--;
@@ -511,6 +511,7 @@ int s1ap_mme_handle_s1_setup_request(
       s1SetupRequest_p->eNBname.size);
     enb_association->enb_name[s1SetupRequest_p->eNBname.size] = '\0';
   }
+  s1ap_state_mark_enb_dirty(enb_association);
 
   s1ap_dump_enb(enb_association);
   rc = s1ap_generate_s1_setup_response(state, enb_association);
@@ -608,6 +609,7 @@ static int s1ap_generate_s1_setup_response(
      * Consider the response as sent. S1AP is ready to accept UE contexts
      */
     enb_association->s1_state = S1AP_READY;
+    s1ap_state_mark_enb_dirty(enb_association);
   }
 
   /*
@@ -758,6 +760,7 @@ int s1ap_mme_handle_initial_context_setup_response(
   }
 
   ue_ref_p->s1_ue_state = S1AP_UE_CONNECTED;
+  s1ap_state_mark_ue_dirty(ue_ref_p);
   message_p =
     itti_alloc_new_message(TASK_S1AP, MME_APP_INITIAL_CONTEXT_SETUP_RSP);
   AssertFatal(message_p != NULL, "itti_alloc_new_message Failed");
@@ -1012,17 +1015,17 @@ static int s1ap_mme_generate_ue_context_release_command(
 
   bstring b = blk2bstr(buffer, length);
   free(buffer);
-  rc = s1ap_mme_itti_send_sctp_request(
-    &b,
-    ue_ref_p->enb->sctp_assoc_id,
-    ue_ref_p->sctp_stream_send,
-    ue_ref_p->mme_ue_s1ap_id);
+  sctp_assoc_id_t assoc_id = ue_ref_p->enb->sctp_assoc_id;
+  sctp_stream_id_t stream = ue_ref_p->sctp_stream_send;
+  mme_ue_s1ap_id_t mme_ue_s1ap_id = ue_ref_p->mme_ue_s1ap_id;
   ue_ref_p->s1_ue_state = S1AP_UE_WAITING_CRR;
 
   // Start timer to track UE context release complete from eNB
 
-  // We can safely remove UE context now, no need for timer
+  // We can safely remove UE context now, no need for timer. The removal is
+  // durable before the command reaches the eNB.
   s1ap_mme_release_ue_context(state, ue_ref_p);
+  rc = s1ap_mme_itti_send_sctp_request(&b, assoc_id, stream, mme_ue_s1ap_id);
 
   free_s1ap_uecontextreleasecommand(ueContextReleaseCommandIEs_p);
   OAILOG_FUNC_RETURN(LOG_S1AP, rc);
@@ -1641,6 +1644,13 @@ int s1ap_mme_handle_path_switch_request(
     if (new_ue_ref_p->enb->next_sctp_stream >= new_ue_ref_p->enb->instreams) {
       new_ue_ref_p->enb->next_sctp_stream = 1;
     }
+    s1ap_state_mark_enb_dirty(new_ue_ref_p->enb);
+    s1ap_state_mark_ue_dirty(new_ue_ref_p);
+    /*
+     * Index the new ue description first, the source one is then only
+     * removed from the index if it is still indexed
+     */
+    s1ap_state_add_ue_mmeid(state, new_ue_ref_p);
     /* Remove ue description from source eNB */
     s1ap_remove_ue(state, ue_ref_p);
 
@@ -1835,6 +1845,7 @@ int s1ap_handle_sctp_disconnection(
   if (!enb_association->nb_ue_associated) {
     if (reset) {
       enb_association->s1_state = S1AP_INIT;
+      s1ap_state_mark_enb_dirty(enb_association);
       OAILOG_INFO(
         LOG_S1AP,
         "SCTP reset request for association id %u. No Connected UEs.  = %u \n",
@@ -1882,6 +1893,7 @@ int s1ap_handle_sctp_disconnection(
   // Mark the eNB's s1 state as appopriate, the eNB will be deleted or moved to init state when the last UE's s1
   // state is cleaned up or clean-up timer expires
   enb_association->s1_state = reset ? S1AP_RESETING : S1AP_SHUTDOWN;
+  s1ap_state_mark_enb_dirty(enb_association);
   OAILOG_INFO(
     LOG_S1AP,
     "Marked enb s1 status to %s, attached to assoc_id: %d\n",
@@ -1994,6 +2006,7 @@ int s1ap_handle_new_association(
    */
   enb_association->next_sctp_stream = 1;
   enb_association->s1_state = S1AP_INIT;
+  s1ap_state_mark_enb_dirty(enb_association);
   OAILOG_FUNC_RETURN(LOG_S1AP, RETURNok);
 }
 
@@ -2006,6 +2019,7 @@ void s1ap_mme_handle_ue_context_rel_comp_timer_expiry(
   OAILOG_FUNC_IN(LOG_S1AP);
   DevAssert(ue_ref_p != NULL);
   ue_ref_p->s1ap_ue_context_rel_timer.id = S1AP_TIMER_INACTIVE_ID;
+  s1ap_state_mark_ue_dirty(ue_ref_p);
   OAILOG_DEBUG(
     LOG_S1AP,
     "Expired- UE Context Release Timer for UE id  %d \n",
@@ -2040,13 +2054,26 @@ void s1ap_mme_release_ue_context(
   MessageDef *message_p = NULL;
   OAILOG_FUNC_IN(LOG_S1AP);
   DevAssert(ue_ref_p != NULL);
+  mme_ue_s1ap_id_t mme_ue_s1ap_id = ue_ref_p->mme_ue_s1ap_id;
   OAILOG_DEBUG(
-    LOG_S1AP,
-    "Releasing UE Context for UE id  %d \n",
-    ue_ref_p->mme_ue_s1ap_id);
+    LOG_S1AP, "Releasing UE Context for UE id  %d \n", mme_ue_s1ap_id);
   /*
    * Remove UE context and inform MME_APP.
    */
+  DevAssert(ue_ref_p->s1_ue_state == S1AP_UE_WAITING_CRR);
+  s1ap_remove_ue(state, ue_ref_p);
+  OAILOG_DEBUG(
+    LOG_S1AP,
+    "Removed S1AP UE " MME_UE_S1AP_ID_FMT "\n",
+    (uint32_t) mme_ue_s1ap_id);
+  // The removal must be durable before the release goes on
+  if (s1ap_state_sync() != RETURNok) {
+    OAILOG_ERROR(
+      LOG_S1AP,
+      "Failed to sync state after removing UE " MME_UE_S1AP_ID_FMT "\n",
+      (uint32_t) mme_ue_s1ap_id);
+  }
+
   message_p =
     itti_alloc_new_message(TASK_S1AP, S1AP_UE_CONTEXT_RELEASE_COMPLETE);
   AssertFatal(message_p != NULL, "itti_alloc_new_message Failed");
@@ -2054,15 +2081,8 @@ void s1ap_mme_release_ue_context(
     (void *) &message_p->ittiMsg.s1ap_ue_context_release_complete,
     0,
     sizeof(itti_s1ap_ue_context_release_complete_t));
-  S1AP_UE_CONTEXT_RELEASE_COMPLETE(message_p).mme_ue_s1ap_id =
-    ue_ref_p->mme_ue_s1ap_id;
+  S1AP_UE_CONTEXT_RELEASE_COMPLETE(message_p).mme_ue_s1ap_id = mme_ue_s1ap_id;
   itti_send_msg_to_task(TASK_MME_APP, INSTANCE_DEFAULT, message_p);
-  DevAssert(ue_ref_p->s1_ue_state == S1AP_UE_WAITING_CRR);
-  OAILOG_DEBUG(
-    LOG_S1AP,
-    "Removed S1AP UE " MME_UE_S1AP_ID_FMT "\n",
-    (uint32_t) ue_ref_p->mme_ue_s1ap_id);
-  s1ap_remove_ue(state, ue_ref_p);
   OAILOG_FUNC_OUT(LOG_S1AP);
 }
 
@@ -2463,6 +2483,7 @@ void s1ap_enb_assoc_clean_up_timer_expiry(
   OAILOG_FUNC_IN(LOG_S1AP);
   DevAssert(enb_ref_p != NULL);
   enb_ref_p->s1ap_enb_assoc_clean_up_timer.id = S1AP_TIMER_INACTIVE_ID;
+  s1ap_state_mark_enb_dirty(enb_ref_p);
   OAILOG_INFO(
     LOG_S1AP,
     "Expired Timer: wait_for_ue_cleanup timer for eNB association id  %u \n",
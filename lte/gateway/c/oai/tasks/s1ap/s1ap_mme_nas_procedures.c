@@ -165,6 +165,8 @@ int s1ap_mme_handle_initial_ue_message(
     if (ue_ref->enb->next_sctp_stream >= ue_ref->enb->instreams) {
       ue_ref->enb->next_sctp_stream = 1;
     }
+    s1ap_state_mark_enb_dirty(ue_ref->enb);
+    s1ap_state_mark_ue_dirty(ue_ref);
     s1ap_dump_enb(ue_ref->enb);
     // TAI mandatory IE
     OCTET_STRING_TO_TAC(&initialUEMessage_p->tai.tAC, tai.tac);
@@ -453,6 +455,7 @@ int s1ap_generate_downlink_nas_transport(
       OAILOG_FUNC_RETURN(LOG_S1AP, RETURNerror);
     } else {
     ue_ref->s1_ue_state = S1AP_UE_CONNECTED;
+    s1ap_state_mark_ue_dirty(ue_ref);
     }
     downlinkNasTransport = &message.msg.s1ap_DownlinkNASTransportIEs;
     /*
@@ -544,6 +547,7 @@ int s1ap_generate_s1ap_e_rab_setup_req(
     message.procedureCode = S1ap_ProcedureCode_id_E_RABSetup;
     message.direction = S1AP_PDU_PR_initiatingMessage;
     ue_ref->s1_ue_state = S1AP_UE_CONNECTED;
+    s1ap_state_mark_ue_dirty(ue_ref);
     e_rabsetuprequesties = &message.msg.s1ap_E_RABSetupRequestIEs;
     /*
      * Setting UE information with the ones found in ue_ref
@@ -932,7 +936,10 @@ void s1ap_handle_mme_ue_id_notification(
     ue_description_t *ue_ref =
       s1ap_state_get_ue_enbid(state, enb_ref, enb_ue_s1ap_id);
     if (ue_ref) {
+      s1ap_state_remove_ue_mmeid(state, ue_ref);
       ue_ref->mme_ue_s1ap_id = mme_ue_s1ap_id;
+      s1ap_state_mark_ue_dirty(ue_ref);
+      s1ap_state_add_ue_mmeid(state, ue_ref);
       hashtable_rc_t h_rc = hashtable_ts_insert(
         &state->mmeid2associd,
         (const hash_key_t) mme_ue_s1ap_id,
@@ -1006,6 +1013,7 @@ int s1ap_generate_s1ap_e_rab_rel_cmd(
     message.procedureCode = S1ap_ProcedureCode_id_E_RABRelease;
     message.direction = S1AP_PDU_PR_initiatingMessage;
     ue_ref->s1_ue_state = S1AP_UE_CONNECTED;
+    s1ap_state_mark_ue_dirty(ue_ref);
     e_rabreleasecmdies = &message.msg.s1ap_E_RABReleaseCommandIEs;
     /*
      * Setting UE information with the ones found in ue_ref
@@ -36,6 +36,9 @@ typedef struct s1ap_state_s {
   hash_table_ts_t enbs;
   // contains sctp association id, key is mme_ue_s1ap_id
   hash_table_ts_t mmeid2associd;
+  // contains ue_description_s, key is mme_ue_s1ap_id. The UEs are owned by
+  // the ue_coll of their eNB
+  hash_table_ts_t mmeid2ue;
   uint32_t num_enbs;
 } s1ap_state_t;
 
@@ -44,6 +47,8 @@ void s1ap_state_exit(void);
 
 s1ap_state_t *s1ap_state_get(void);
 void s1ap_state_put(s1ap_state_t *state);
+// Blocks until the s1ap state changes so far are committed to db
+int s1ap_state_sync(void);
 
 enb_description_t *s1ap_state_get_enb(
   s1ap_state_t *state,
@@ -56,6 +61,20 @@ ue_description_t *s1ap_state_get_ue_mmeid(
   s1ap_state_t *state,
   mme_ue_s1ap_id_t mme_ue_s1ap_id);
 
+// Maintain the mme_ue_s1ap_id index used by s1ap_state_get_ue_mmeid. A UE is
+// added once its mme_ue_s1ap_id is known and removed before it is freed.
+void s1ap_state_add_ue_mmeid(s1ap_state_t *state, ue_description_t *ue);
+void s1ap_state_remove_ue_mmeid(s1ap_state_t *state, ue_description_t *ue);
+void s1ap_state_remove_enb_ues_mmeid(
+  s1ap_state_t *state,
+  enb_description_t *enb);
+
+// Mark eNB and UE descriptions as modified, to be written on next put.
+// The getters above already mark the descriptions they return.
+void s1ap_state_mark_enb_dirty(enb_description_t *enb);
+void s1ap_state_mark_ue_dirty(ue_description_t *ue);
+void s1ap_state_mark_enb_ues_dirty(enb_description_t *enb);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,308 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+#include "s1ap_state_converter.h"
+
+#include <string.h>
+
+extern "C" {
+#include "bstrlib.h"
+
+#include "assertions.h"
+#include "common_defs.h"
+#include "dynamic_memory_check.h"
+#include "log.h"
+
+#include "mme_config.h"
+}
+
+using magma::lte::gateway::s1ap::EnbDescription;
+using magma::lte::gateway::s1ap::S1apState;
+using magma::lte::gateway::s1ap::UeDescription;
+
+namespace magma {
+namespace lte {
+
+S1apStateConverter::S1apStateConverter() = default;
+S1apStateConverter::~S1apStateConverter() = default;
+
+void S1apStateConverter::state_to_proto(s1ap_state_t* state, S1apState* proto)
+{
+  int i;
+  hashtable_rc_t ht_rc;
+  hashtable_key_array_t* keys;
+
+  mme_ue_s1ap_id_t mmeid;
+  sctp_assoc_id_t associd;
+  enb_description_t* enb;
+
+  EnbDescription enb_proto;
+
+  proto->Clear();
+
+  // copy over enbs
+  auto enbs = proto->mutable_enbs();
+  keys = hashtable_ts_get_keys(&state->enbs);
+  if (!keys) {
+    OAILOG_DEBUG(LOG_S1AP, "No keys in the enb hashtable");
+  } else {
+    for (i = 0; i < keys->num_keys; i++) {
+      associd = (sctp_assoc_id_t) keys->keys[i];
+      ht_rc =
+        hashtable_ts_get(&state->enbs, (hash_key_t) associd, (void**) &enb);
+      AssertFatal(ht_rc == HASH_TABLE_OK, "associd not in enbs");
+
+      enb_to_proto(enb, &enb_proto, true);
+      (*enbs)[associd] = enb_proto;
+    }
+    FREE_HASHTABLE_KEY_ARRAY(keys);
+  }
+
+  ue_description_t* ue;
+
+  // copy over mmeid2associd
+  auto mmeid2associd = proto->mutable_mmeid2associd();
+  keys = hashtable_ts_get_keys(&state->mmeid2associd);
+  if (!keys) {
+    OAILOG_DEBUG(LOG_S1AP, "No keys in mmeid2associd hashtable");
+  } else {
+    for (i = 0; i < keys->num_keys; i++) {
+      mmeid = (mme_ue_s1ap_id_t) keys->keys[i];
+      ht_rc = hashtable_ts_get(
+        &state->mmeid2associd, (hash_key_t) mmeid, (void**) &associd);
+      AssertFatal(ht_rc == HASH_TABLE_OK, "mmeid not in mmeid2associd");
+
+      (*mmeid2associd)[mmeid] = associd;
+    }
+    FREE_HASHTABLE_KEY_ARRAY(keys);
+  }
+
+  // the mmeid2ue index is saved by the UE key within its eNB
+  auto mmeid2enbueid = proto->mutable_mmeid2enbueid();
+  keys = hashtable_ts_get_keys(&state->mmeid2ue);
+  if (!keys) {
+    OAILOG_DEBUG(LOG_S1AP, "No keys in mmeid2ue hashtable");
+  } else {
+    for (i = 0; i < keys->num_keys; i++) {
+      mmeid = (mme_ue_s1ap_id_t) keys->keys[i];
+      ht_rc =
+        hashtable_ts_get(&state->mmeid2ue, (hash_key_t) mmeid, (void**) &ue);
+      AssertFatal(ht_rc == HASH_TABLE_OK, "mmeid not in mmeid2ue");
+
+      (*mmeid2enbueid)[mmeid] = ue->enb_ue_s1ap_id;
+    }
+    FREE_HASHTABLE_KEY_ARRAY(keys);
+  }
+
+  proto->set_num_enbs(state->num_enbs);
+}
+
+void S1apStateConverter::proto_to_state(
+  const S1apState& proto,
+  s1ap_state_t* state)
+{
+  hashtable_rc_t ht_rc;
+  enb_description_t* enb;
+
+  auto enbs = proto.enbs();
+  for (auto const& kv : enbs) {
+    sctp_assoc_id_t associd = kv.first;
+
+    enb = (enb_description_t*) malloc(sizeof(*enb));
+    AssertFatal(enb != NULL, "failed to alloc new enb_desc");
+
+    proto_to_enb(kv.second, enb);
+    ht_rc = hashtable_ts_insert(&state->enbs, (hash_key_t) associd, enb);
+    AssertFatal(ht_rc == HASH_TABLE_OK, "failed to insert enb");
+  }
+
+  auto mmeid2associd = proto.mmeid2associd();
+  for (auto const& kv : mmeid2associd) {
+    mme_ue_s1ap_id_t mmeid = (mme_ue_s1ap_id_t) kv.first;
+    sctp_assoc_id_t associd = (sctp_assoc_id_t) kv.second;
+
+    ht_rc = hashtable_ts_insert(
+      &state->mmeid2associd, (hash_key_t) mmeid, (void*) (uintptr_t) associd);
+    AssertFatal(ht_rc == HASH_TABLE_OK, "failed to insert associd");
+  }
+
+  // resolve the mmeid2ue index to the UEs restored in their eNBs
+  auto mmeid2enbueid = proto.mmeid2enbueid();
+  for (auto const& kv : mmeid2enbueid) {
+    mme_ue_s1ap_id_t mmeid = (mme_ue_s1ap_id_t) kv.first;
+    enb_ue_s1ap_id_t enbueid = (enb_ue_s1ap_id_t) kv.second;
+    ue_description_t* ue = nullptr;
+
+    auto associd = mmeid2associd.find(mmeid);
+    if (
+      associd == mmeid2associd.end() ||
+      hashtable_ts_get(
+        &state->enbs, (hash_key_t) associd->second, (void**) &enb) !=
+        HASH_TABLE_OK ||
+      hashtable_ts_get(&enb->ue_coll, (hash_key_t) enbueid, (void**) &ue) !=
+        HASH_TABLE_OK) {
+      OAILOG_ERROR(
+        LOG_S1AP,
+        "UE of mme_ue_s1ap_id " MME_UE_S1AP_ID_FMT " not found in state",
+        mmeid);
+      continue;
+    }
+    ht_rc = hashtable_ts_insert(&state->mmeid2ue, (hash_key_t) mmeid, ue);
+    AssertFatal(ht_rc == HASH_TABLE_OK, "failed to insert ue");
+  }
+
+  state->num_enbs = proto.num_enbs();
+}
+
+void S1apStateConverter::enb_to_proto(
+  enb_description_t* enb,
+  EnbDescription* proto,
+  bool include_ues)
+{
+  int i;
+  hashtable_rc_t ht_rc;
+  hashtable_key_array_t* keys;
+
+  enb_ue_s1ap_id_t enbueid;
+  ue_description_t* ue;
+
+  UeDescription ue_proto;
+
+  proto->Clear();
+
+  proto->set_enb_id(enb->enb_id);
+  proto->set_s1_state(enb->s1_state);
+  proto->set_enb_name(enb->enb_name);
+  proto->set_default_paging_drx(enb->default_paging_drx);
+  proto->set_nb_ue_associated(enb->nb_ue_associated);
+  proto->mutable_s1ap_enb_assoc_clean_up_timer()->set_id(
+    enb->s1ap_enb_assoc_clean_up_timer.id);
+  proto->mutable_s1ap_enb_assoc_clean_up_timer()->set_sec(
+    enb->s1ap_enb_assoc_clean_up_timer.sec);
+  proto->set_sctp_assoc_id(enb->sctp_assoc_id);
+  proto->set_next_sctp_stream(enb->next_sctp_stream);
+  proto->set_instreams(enb->instreams);
+  proto->set_outstreams(enb->outstreams);
+
+  if (!include_ues) {
+    return;
+  }
+
+  // store ues
+  auto ues = proto->mutable_ues();
+  keys = hashtable_ts_get_keys(&enb->ue_coll);
+  if (!keys) {
+    OAILOG_DEBUG(LOG_S1AP, "No keys in ue_coll hashtable");
+  } else {
+    for (i = 0; i < keys->num_keys; i++) {
+      enbueid = (mme_ue_s1ap_id_t) keys->keys[i];
+      ht_rc =
+        hashtable_ts_get(&enb->ue_coll, (hash_key_t) enbueid, (void**) &ue);
+      AssertFatal(ht_rc == HASH_TABLE_OK, "enbueid not in ue_coll");
+      AssertFatal(ue->enb == enb, "tried to commit ue assigned to wrong enb");
+
+      ue_to_proto(ue, &ue_proto);
+      (*ues)[enbueid] = ue_proto;
+    }
+    FREE_HASHTABLE_KEY_ARRAY(keys);
+  }
+}
+
+void S1apStateConverter::proto_to_enb(
+  const EnbDescription& proto,
+  enb_description_t* enb)
+{
+  hashtable_rc_t ht_rc;
+  ue_description_t* ue;
+
+  memset(enb, 0, sizeof(*enb));
+
+  enb->enb_id = proto.enb_id();
+  enb->s1_state = (mme_s1_enb_state_s) proto.s1_state();
+  strncpy(enb->enb_name, proto.enb_name().c_str(), sizeof(enb->enb_name));
+  enb->default_paging_drx = proto.default_paging_drx();
+  enb->nb_ue_associated = proto.nb_ue_associated();
+  enb->s1ap_enb_assoc_clean_up_timer.id =
+    proto.s1ap_enb_assoc_clean_up_timer().id();
+  enb->s1ap_enb_assoc_clean_up_timer.sec =
+    proto.s1ap_enb_assoc_clean_up_timer().sec();
+  enb->sctp_assoc_id = proto.sctp_assoc_id();
+  enb->next_sctp_stream = proto.next_sctp_stream();
+  enb->instreams = proto.instreams();
+  enb->outstreams = proto.outstreams();
+
+  // load ues
+  auto ht_name = bfromcstr("s1ap_ue_coll");
+  auto ht = hashtable_ts_init(
+    &enb->ue_coll, mme_config.max_ues, NULL, free_wrapper, ht_name);
+  bdestroy(ht_name);
+  AssertFatal(ht != NULL, "failed to init ue_coll");
+  hashtable_ts_set_single_owner(&enb->ue_coll, true);
+
+  auto ues = proto.ues();
+  for (auto const& kv : ues) {
+    enb_ue_s1ap_id_t enbueid = kv.first;
+
+    ue = (ue_description_t*) malloc(sizeof(*ue));
+    AssertFatal(ue != NULL, "failed to alloc new ue description");
+
+    proto_to_ue(kv.second, ue);
+    ue->enb = enb; // ue's are linked to parent enb
+
+    ht_rc = hashtable_ts_insert(&enb->ue_coll, (hash_key_t) enbueid, ue);
+    AssertFatal(ht_rc == HASH_TABLE_OK, "failed to insert ue");
+  }
+}
+
+void S1apStateConverter::ue_to_proto(
+  const ue_description_t* ue,
+  UeDescription* proto)
+{
+  proto->Clear();
+
+  proto->set_s1_ue_state(ue->s1_ue_state);
+  proto->set_enb_ue_s1ap_id(ue->enb_ue_s1ap_id);
+  proto->set_mme_ue_s1ap_id(ue->mme_ue_s1ap_id);
+  proto->set_sctp_stream_recv(ue->sctp_stream_recv);
+  proto->set_sctp_stream_send(ue->sctp_stream_send);
+  proto->mutable_s1ap_ue_context_rel_timer()->set_id(
+    ue->s1ap_ue_context_rel_timer.id);
+  proto->mutable_s1ap_ue_context_rel_timer()->set_sec(
+    ue->s1ap_ue_context_rel_timer.sec);
+}
+
+void S1apStateConverter::proto_to_ue(
+  const UeDescription& proto,
+  ue_description_t* ue)
+{
+  memset(ue, 0, sizeof(*ue));
+
+  ue->s1_ue_state = (s1_ue_state_s) proto.s1_ue_state();
+  ue->enb_ue_s1ap_id = proto.enb_ue_s1ap_id();
+  ue->mme_ue_s1ap_id = proto.mme_ue_s1ap_id();
+  ue->sctp_stream_recv = proto.sctp_stream_recv();
+  ue->sctp_stream_send = proto.sctp_stream_send();
+  ue->s1ap_ue_context_rel_timer.id = proto.s1ap_ue_context_rel_timer().id();
+  ue->s1ap_ue_context_rel_timer.sec = proto.s1ap_ue_context_rel_timer().sec();
+}
+
+} // namespace lte
+} // namespace magma
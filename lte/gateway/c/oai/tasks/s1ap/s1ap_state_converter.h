@@ -0,0 +1,109 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "hashtable.h"
+
+#include "s1ap_state.h"
+#include "s1ap_types.h"
+
+#ifdef __cplusplus
+}
+#endif
+
+#include "lte/protos/s1ap_state.pb.h"
+
+namespace magma {
+namespace lte {
+
+/**
+ * Class for S1AP task state conversion helper functions.
+ */
+class S1apStateConverter {
+ public:
+  /**
+   * Converts S1AP state to proto, memory is owned by the caller
+   * @param state s1ap state struct
+   * @param proto S1apState proto object to be written to
+   */
+  static void state_to_proto(
+    s1ap_state_t* state,
+    gateway::s1ap::S1apState* proto);
+
+  /**
+   * Converts S1AP proto to state, expects hashtables in state to be created
+   * @param proto S1apState proto object to read from
+   * @param state s1ap state struct to write to
+   */
+  static void proto_to_state(
+    const gateway::s1ap::S1apState& proto,
+    s1ap_state_t* state);
+
+  /**
+   * Converts eNB description to proto, memory is owned by the caller
+   * @param enb eNB description struct
+   * @param proto EnbDescription proto object to be written to
+   * @param include_ues also converts the UEs associated with the eNB
+   */
+  static void enb_to_proto(
+    enb_description_t* enb,
+    gateway::s1ap::EnbDescription* proto,
+    bool include_ues);
+
+  /**
+   * Converts proto to eNB description, creating its UE collection
+   * @param proto EnbDescription proto object to read from
+   * @param enb eNB description struct to write to
+   */
+  static void proto_to_enb(
+    const gateway::s1ap::EnbDescription& proto,
+    enb_description_t* enb);
+
+  /**
+   * Converts UE description to proto, memory is owned by the caller
+   * @param ue UE description struct
+   * @param proto UeDescription proto object to be written to
+   */
+  static void ue_to_proto(
+    const ue_description_t* ue,
+    gateway::s1ap::UeDescription* proto);
+
+  /**
+   * Converts proto to UE description, the parent eNB is not set
+   * @param proto UeDescription proto object to read from
+   * @param ue UE description struct to write to
+   */
+  static void proto_to_ue(
+    const gateway::s1ap::UeDescription& proto,
+    ue_description_t* ue);
+
+ private:
+  S1apStateConverter();
+  ~S1apStateConverter();
+};
+
+} // namespace lte
+} // namespace magma
@@ -0,0 +1,346 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+#include "s1ap_state_manager.h"
+
+#include <string.h>
+
+extern "C" {
+#include "bstrlib.h"
+
+#include "dynamic_memory_check.h"
+
+#include "mme_config.h"
+}
+
+namespace {
+const char* LOCALHOST = "127.0.0.1";
+
+std::string enb_record_key(sctp_assoc_id_t assoc_id)
+{
+  return S1AP_ENB_RECORD_PREFIX + std::to_string(assoc_id);
+}
+
+std::string ue_record_key(
+  sctp_assoc_id_t assoc_id,
+  enb_ue_s1ap_id_t enb_ue_s1ap_id)
+{
+  return S1AP_UE_RECORD_PREFIX + std::to_string(assoc_id) + ":" +
+         std::to_string(enb_ue_s1ap_id);
+}
+
+// Parses the sctp association id and enb_ue_s1ap_id out of a UE record key
+bool parse_ue_record_key(
+  const std::string& record_key,
+  sctp_assoc_id_t* assoc_id,
+  enb_ue_s1ap_id_t* enb_ue_s1ap_id)
+{
+  auto separator = record_key.find(':', strlen(S1AP_UE_RECORD_PREFIX));
+  if (separator == std::string::npos) {
+    return false;
+  }
+  *assoc_id = std::stoul(record_key.substr(
+    strlen(S1AP_UE_RECORD_PREFIX),
+    separator - strlen(S1AP_UE_RECORD_PREFIX)));
+  *enb_ue_s1ap_id = std::stoul(record_key.substr(separator + 1));
+  return true;
+}
+} // namespace
+
+namespace magma {
+namespace lte {
+
+S1apStateManager::S1apStateManager() {}
+
+S1apStateManager::~S1apStateManager()
+{
+  free_state();
+}
+
+S1apStateManager& S1apStateManager::getInstance()
+{
+  static S1apStateManager instance;
+  return instance;
+}
+
+int S1apStateManager::init(
+  bool persist_state,
+  bool persist_records,
+  uint32_t write_behind_window_ms)
+{
+  log_task = LOG_S1AP;
+  table_key = S1AP_STATE_TABLE;
+  records_table_key = S1AP_STATE_RECORDS_TABLE;
+  persist_state_enabled = persist_state;
+  persist_records_enabled = persist_records;
+  this->write_behind_window_ms = write_behind_window_ms;
+  create_state();
+  is_initialized = true;
+
+  if (persist_state_enabled) {
+    if (init_db_connection(LOCALHOST) != RETURNok) {
+      return RETURNerror;
+    }
+    return read_state_from_db();
+  }
+  return RETURNok;
+}
+
+void S1apStateManager::create_state()
+{
+  hash_table_ts_t* ht;
+  bstring ht_name;
+
+  state_cache_p = (s1ap_state_t*) calloc(1, sizeof(s1ap_state_t));
+  AssertFatal(state_cache_p != nullptr, "Failed to allocate s1ap state");
+
+  ht_name = bfromcstr(S1AP_ENB_COLL);
+  ht = hashtable_ts_init(
+    &state_cache_p->enbs, mme_config.max_enbs, NULL, free_wrapper, ht_name);
+  AssertFatal(ht != nullptr, "Failed to init s1ap eNB hashtable");
+
+  bassigncstr(ht_name, S1AP_MME_ID2ASSOC_ID_COLL);
+  ht = hashtable_ts_init(
+    &state_cache_p->mmeid2associd,
+    mme_config.max_ues,
+    NULL,
+    hash_free_int_func,
+    ht_name);
+  AssertFatal(ht != nullptr, "Failed to init s1ap mmeid2associd hashtable");
+
+  // UEs are freed through the ue_coll of their eNB
+  bassigncstr(ht_name, S1AP_MME_ID2UE_COLL);
+  ht = hashtable_ts_init(
+    &state_cache_p->mmeid2ue,
+    mme_config.max_ues,
+    NULL,
+    hash_free_int_func,
+    ht_name);
+  AssertFatal(ht != nullptr, "Failed to init s1ap mmeid2ue hashtable");
+  bdestroy(ht_name);
+
+  // S1AP state is only ever accessed from the S1AP task
+  hashtable_ts_set_single_owner(&state_cache_p->enbs, true);
+  hashtable_ts_set_single_owner(&state_cache_p->mmeid2associd, true);
+  hashtable_ts_set_single_owner(&state_cache_p->mmeid2ue, true);
+
+  state_cache_p->num_enbs = 0;
+}
+
+void S1apStateManager::free_state()
+{
+  int i;
+  hashtable_rc_t ht_rc;
+  hashtable_key_array_t* keys;
+  sctp_assoc_id_t assoc_id;
+  enb_description_t* enb;
+
+  if (state_cache_p == nullptr) {
+    return;
+  }
+
+  keys = hashtable_ts_get_keys(&state_cache_p->enbs);
+  if (!keys) {
+    OAILOG_DEBUG(LOG_S1AP, "No keys in the enb hashtable");
+  } else {
+    for (i = 0; i < keys->num_keys; i++) {
+      assoc_id = (sctp_assoc_id_t) keys->keys[i];
+      ht_rc = hashtable_ts_get(
+        &state_cache_p->enbs, (hash_key_t) assoc_id, (void**) &enb);
+      AssertFatal(ht_rc == HASH_TABLE_OK, "enbueid not in assoc_id");
+
+      if (hashtable_ts_destroy(&enb->ue_coll) != HASH_TABLE_OK) {
+        OAI_FPRINTF_ERR("An error occured while destroying UE coll hash table");
+      }
+    }
+    FREE_HASHTABLE_KEY_ARRAY(keys);
+  }
+
+  if (hashtable_ts_destroy(&state_cache_p->enbs) != HASH_TABLE_OK) {
+    OAI_FPRINTF_ERR("An error occured while destroying s1 eNB hash table");
+  }
+  if (hashtable_ts_destroy(&state_cache_p->mmeid2associd) != HASH_TABLE_OK) {
+    OAI_FPRINTF_ERR("An error occured while destroying assoc_id hash table");
+  }
+  if (hashtable_ts_destroy(&state_cache_p->mmeid2ue) != HASH_TABLE_OK) {
+    OAI_FPRINTF_ERR("An error occured while destroying mmeid2ue hash table");
+  }
+  free(state_cache_p);
+  state_cache_p = nullptr;
+}
+
+int S1apStateManager::read_state_from_db()
+{
+  pending_ues_.clear();
+  int rc = StateManager::read_state_from_db();
+
+  for (const auto& pending_ue : pending_ues_) {
+    if (!insert_ue(pending_ue.first, pending_ue.second)) {
+      OAILOG_ERROR(
+        LOG_S1AP,
+        "Dropping UE record of unknown sctp_assoc_id %u",
+        pending_ue.first);
+    }
+  }
+  pending_ues_.clear();
+  return rc;
+}
+
+void S1apStateManager::mark_enb_dirty(const enb_description_t* enb)
+{
+  if (!records_persisted()) {
+    return;
+  }
+  mark_record_dirty(enb_record_key(enb->sctp_assoc_id));
+}
+
+void S1apStateManager::mark_ue_dirty(const ue_description_t* ue)
+{
+  if (!records_persisted()) {
+    return;
+  }
+  mark_record_dirty(
+    ue_record_key(ue->enb->sctp_assoc_id, ue->enb_ue_s1ap_id));
+}
+
+void S1apStateManager::global_state_to_proto(S1apState* state_proto)
+{
+  // eNBs and UEs are records, mmeid2associd and mmeid2ue are rebuilt from
+  // the UE records
+  state_proto->Clear();
+  state_proto->set_num_enbs(state_cache_p->num_enbs);
+}
+
+bool S1apStateManager::serialize_record(
+  const std::string& record_key,
+  std::string* serialized_record)
+{
+  bool serialized = false;
+  if (record_key.rfind(S1AP_ENB_RECORD_PREFIX, 0) == 0) {
+    sctp_assoc_id_t assoc_id =
+      std::stoul(record_key.substr(strlen(S1AP_ENB_RECORD_PREFIX)));
+    enb_description_t* enb = nullptr;
+    if (
+      hashtable_ts_get(
+        &state_cache_p->enbs, (const hash_key_t) assoc_id, (void**) &enb) !=
+      HASH_TABLE_OK) {
+      return false;
+    }
+    EnbDescription enb_proto;
+    S1apStateConverter::enb_to_proto(enb, &enb_proto, false);
+    serialized = enb_proto.SerializeToString(serialized_record);
+  } else if (record_key.rfind(S1AP_UE_RECORD_PREFIX, 0) == 0) {
+    sctp_assoc_id_t assoc_id;
+    enb_ue_s1ap_id_t enb_ue_s1ap_id;
+    if (!parse_ue_record_key(record_key, &assoc_id, &enb_ue_s1ap_id)) {
+      OAILOG_ERROR(LOG_S1AP, "Invalid UE record %s", record_key.c_str());
+      return false;
+    }
+    enb_description_t* enb = nullptr;
+    ue_description_t* ue = nullptr;
+    if (
+      hashtable_ts_get(
+        &state_cache_p->enbs, (const hash_key_t) assoc_id, (void**) &enb) !=
+        HASH_TABLE_OK ||
+      hashtable_ts_get(
+        &enb->ue_coll, (const hash_key_t) enb_ue_s1ap_id, (void**) &ue) !=
+        HASH_TABLE_OK) {
+      return false;
+    }
+    UeDescription ue_proto;
+    S1apStateConverter::ue_to_proto(ue, &ue_proto);
+    serialized = ue_proto.SerializeToString(serialized_record);
+  } else {
+    OAILOG_ERROR(LOG_S1AP, "Unknown S1AP record %s", record_key.c_str());
+    return false;
+  }
+  AssertFatal(serialized, "Failed to serialize S1AP record");
+  return true;
+}
+
+void S1apStateManager::deserialize_record(
+  const std::string& record_key,
+  const std::string& serialized_record)
+{
+  if (record_key.rfind(S1AP_ENB_RECORD_PREFIX, 0) == 0) {
+    EnbDescription enb_proto;
+    if (!enb_proto.ParseFromString(serialized_record)) {
+      OAILOG_ERROR(LOG_S1AP, "Failed to parse record %s", record_key.c_str());
+      return;
+    }
+    auto enb = (enb_description_t*) malloc(sizeof(enb_description_t));
+    AssertFatal(enb != nullptr, "failed to alloc new enb_desc");
+    S1apStateConverter::proto_to_enb(enb_proto, enb);
+    hashtable_rc_t ht_rc = hashtable_ts_insert(
+      &state_cache_p->enbs, (const hash_key_t) enb->sctp_assoc_id, enb);
+    AssertFatal(ht_rc == HASH_TABLE_OK, "failed to insert enb");
+  } else if (record_key.rfind(S1AP_UE_RECORD_PREFIX, 0) == 0) {
+    sctp_assoc_id_t assoc_id;
+    enb_ue_s1ap_id_t enb_ue_s1ap_id;
+    UeDescription ue_proto;
+    if (
+      !parse_ue_record_key(record_key, &assoc_id, &enb_ue_s1ap_id) ||
+      !ue_proto.ParseFromString(serialized_record)) {
+      OAILOG_ERROR(LOG_S1AP, "Failed to parse record %s", record_key.c_str());
+      return;
+    }
+    if (!insert_ue(assoc_id, ue_proto)) {
+      pending_ues_.emplace_back(assoc_id, ue_proto);
+    }
+  } else {
+    OAILOG_ERROR(LOG_S1AP, "Unknown S1AP record %s", record_key.c_str());
+  }
+}
+
+bool S1apStateManager::insert_ue(
+  sctp_assoc_id_t assoc_id,
+  const UeDescription& ue_proto)
+{
+  enb_description_t* enb = nullptr;
+  if (
+    hashtable_ts_get(
+      &state_cache_p->enbs, (const hash_key_t) assoc_id, (void**) &enb) !=
+    HASH_TABLE_OK) {
+    return false;
+  }
+
+  auto ue = (ue_description_t*) malloc(sizeof(ue_description_t));
+  AssertFatal(ue != nullptr, "failed to alloc new ue description");
+  S1apStateConverter::proto_to_ue(ue_proto, ue);
+  ue->enb = enb; // ue's are linked to parent enb
+
+  hashtable_rc_t ht_rc = hashtable_ts_insert(
+    &enb->ue_coll, (const hash_key_t) ue->enb_ue_s1ap_id, ue);
+  AssertFatal(ht_rc == HASH_TABLE_OK, "failed to insert ue");
+
+  if (ue->mme_ue_s1ap_id != INVALID_MME_UE_S1AP_ID) {
+    ht_rc = hashtable_ts_insert(
+      &state_cache_p->mmeid2associd,
+      (const hash_key_t) ue->mme_ue_s1ap_id,
+      (void*) (uintptr_t) assoc_id);
+    AssertFatal(ht_rc == HASH_TABLE_OK, "failed to insert associd");
+    s1ap_state_add_ue_mmeid(state_cache_p, ue);
+  }
+  return true;
+}
+
+} // namespace lte
+} // namespace magma
@@ -0,0 +1,133 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "state_manager.h"
+#include "s1ap_state.h"
+#include "s1ap_state_converter.h"
+
+namespace {
+constexpr char S1AP_STATE_TABLE[] = "s1ap_state";
+constexpr char S1AP_STATE_RECORDS_TABLE[] = "s1ap_state_records";
+constexpr char S1AP_ENB_RECORD_PREFIX[] = "enb:";
+constexpr char S1AP_UE_RECORD_PREFIX[] = "ue:";
+constexpr char S1AP_ENB_COLL[] = "s1ap_eNB_coll";
+constexpr char S1AP_MME_ID2ASSOC_ID_COLL[] = "s1ap_mme_id2assoc_id_coll";
+constexpr char S1AP_MME_ID2UE_COLL[] = "s1ap_mme_id2ue_coll";
+} // namespace
+
+using magma::lte::gateway::s1ap::EnbDescription;
+using magma::lte::gateway::s1ap::S1apState;
+using magma::lte::gateway::s1ap::UeDescription;
+
+namespace magma {
+namespace lte {
+
+class S1apStateManager :
+  public StateManager<s1ap_state_t, S1apState, S1apStateConverter> {
+ public:
+  /**
+   * Returns an instance of S1apStateManager, guaranteed to be thread safe and
+   * initialized only once.
+   * @return S1apStateManager instance.
+   */
+  static S1apStateManager& getInstance();
+
+  /**
+   * Initialization function to initialize member variables.
+   * @param persist_state should read and write state from db
+   * @param persist_records persists each eNB and UE description as a
+   * separate record, only writing the modified ones to db
+   * @param write_behind_window_ms coalescing window of the write-behind
+   * flusher, writes are synchronous when 0
+   * @return response code of the db connection
+   */
+  int init(
+    bool persist_state,
+    bool persist_records,
+    uint32_t write_behind_window_ms);
+
+  /**
+   * Singleton class, copy constructor and assignment operator are marked
+   * as deleted functions.
+   */
+  S1apStateManager(S1apStateManager const&) = delete;
+  S1apStateManager& operator=(S1apStateManager const&) = delete;
+
+  /**
+   * Frees all memory allocated on s1ap_state_t.
+   */
+  void free_state() override;
+
+  /**
+   * Reads the state from db, attaching UE records to their eNBs once all
+   * records are read.
+   */
+  int read_state_from_db() override;
+
+  /**
+   * Marks the eNB description as modified
+   * @param enb eNB description, keyed by its sctp association id
+   */
+  void mark_enb_dirty(const enb_description_t* enb);
+
+  /**
+   * Marks the UE description as modified
+   * @param ue UE description, keyed by its eNB and enb_ue_s1ap_id
+   */
+  void mark_ue_dirty(const ue_description_t* ue);
+
+ private:
+  S1apStateManager();
+  ~S1apStateManager();
+
+  /**
+   * Allocates a new s1ap_state_t struct, and inits its hashtables
+   */
+  void create_state() override;
+
+  void global_state_to_proto(S1apState* state_proto) override;
+
+  bool serialize_record(
+    const std::string& record_key,
+    std::string* serialized_record) override;
+
+  void deserialize_record(
+    const std::string& record_key,
+    const std::string& serialized_record) override;
+
+  /**
+   * Inserts a UE read from db in the UE collection of its eNB
+   * @return false if the eNB was not read yet
+   */
+  bool insert_ue(sctp_assoc_id_t assoc_id, const UeDescription& ue_proto);
+
+  // UE records read before the record of their eNB
+  std::vector<std::pair<sctp_assoc_id_t, UeDescription>> pending_ues_;
+};
+
+} // namespace lte
+} // namespace magma
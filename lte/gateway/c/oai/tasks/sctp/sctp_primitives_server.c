@@ -52,6 +52,7 @@
 #include "sctp_itti_messaging.h"
 #include "sctp_messages_types.h"
 #include "sctpd_downlink_client.h"
+#include "sctpd_ring_client.h"
 #include "sctpd_uplink_server.h"
 
 static void sctp_exit(void);
@@ -80,6 +81,13 @@ static void* sctp_intertask_interface(__attribute__((unused)) void* args_p)
           Fatal("Failed to init sctpd\n");
         }
 
+        if (
+          mme_config.sctp_config.use_shm_rings &&
+          start_sctpd_ring_client() < 0) {
+          OAILOG_ERROR(
+            LOG_SCTP, "Failed to attach sctpd rings, relaying over GRPC\n");
+        }
+
         MessageDef* msg;
 
         msg = itti_alloc_new_message(TASK_S1AP, SCTP_MME_SERVER_INITIALIZED);
@@ -96,7 +104,23 @@ static void* sctp_intertask_interface(__attribute__((unused)) void* args_p)
         uint16_t stream = SCTP_DATA_REQ(recv_msg).stream;
         bstring payload = SCTP_DATA_REQ(recv_msg).payload;
 
-        if (sctpd_send_dl(assoc_id, stream, payload) < 0) {
+        if (
+          sctpd_ring_send_dl(
+            recv_msg->ittiMsgHeader.originTaskId,
+            assoc_id,
+            stream,
+            SCTP_DATA_REQ(recv_msg).mme_ue_s1ap_id,
+            payload) == 0) {
+          break;
+        }
+
+        if (
+          sctpd_queue_dl(
+            recv_msg->ittiMsgHeader.originTaskId,
+            assoc_id,
+            stream,
+            SCTP_DATA_REQ(recv_msg).mme_ue_s1ap_id,
+            payload) < 0) {
           sctp_itti_send_lower_layer_conf(
             recv_msg->ittiMsgHeader.originTaskId,
             assoc_id,
@@ -153,6 +177,8 @@ int sctp_init(const mme_config_t* mme_config_p)
 
 static void sctp_exit(void)
 {
+  stop_sctpd_ring_client();
+  stop_sctpd_downlink_client();
   stop_sctpd_uplink_server();
   OAI_FPRINTF_INFO("TASK_SCTP terminated\n");
 }
@@ -28,9 +28,17 @@ extern "C" {
 #include "log.h"
 
 #include "sctp_defs.h"
+#include "sctp_itti_messaging.h"
 }
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
 #include <memory.h>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include <grpcpp/grpcpp.h>
 
@@ -41,10 +49,13 @@ namespace lte {
 
 using grpc::Channel;
 using grpc::ClientContext;
+using grpc::ClientReaderWriter;
 
 using magma::sctpd::InitReq;
 using magma::sctpd::InitRes;
 using magma::sctpd::SctpdDownlink;
+using magma::sctpd::SendDlBatch;
+using magma::sctpd::SendDlBatchRes;
 using magma::sctpd::SendDlReq;
 using magma::sctpd::SendDlRes;
 
@@ -103,22 +114,318 @@ int SctpdDownlinkClient::sendDl(SendDlReq& req, SendDlRes* res)
   return status.ok() ? 0 : -1;
 }
 
+// Sender of a pipelined downlink packet, notified when the packet is lost
+struct DlOrigin {
+  task_id_t origin_task_id;
+  uint32_t assoc_id;
+  uint16_t stream;
+  uint32_t mme_ue_s1ap_id;
+};
+
+// Pipelines downlink packets to sctpd over a SctpdDownlink.SendDlStream call
+//
+// Packets are queued by the sctp task and written by a separate thread in
+// batches, each batch being acknowledged by sctpd with the packets it failed
+// to send. Lost packets are reported to their sender with a lower layer
+// conf, as for a failed unary sendDl. While the stream is down, or if sctpd
+// does not implement it, packets are sent with unary calls.
+class SctpdDownlinkStream {
+ public:
+  SctpdDownlinkStream(
+    const std::shared_ptr<Channel>& channel,
+    SctpdDownlinkClient& fallback);
+  ~SctpdDownlinkStream();
+
+  void start();
+  // Send the queued packets and stop the stream - blocking call
+  void stop();
+
+  // Queue a packet, blocks while the queue is full
+  void push(SendDlReq&& req, const DlOrigin& origin);
+
+  // Whether the writer thread runs, queued packets are only sent once it does
+  bool running() const { return _writer != nullptr; }
+
+ private:
+  void run();
+  void read_acks(ClientReaderWriter<SendDlBatch, SendDlBatchRes>* stream);
+  void open_stream();
+  void close_stream();
+  void send_unary(SendDlReq& req, const DlOrigin& origin);
+
+  static void notify_lost(const std::vector<DlOrigin>& lost);
+
+  // Maximum number of packets written in a single batch
+  static constexpr int kMaxBatchPdus = 64;
+  // Maximum number of packets waiting to be written
+  static constexpr size_t kMaxQueuedPdus = 65536;
+  // Delay before a failed stream is opened again
+  static constexpr std::chrono::seconds kStreamRetryInterval =
+    std::chrono::seconds(1);
+
+  std::unique_ptr<SctpdDownlink::Stub> _stub;
+  SctpdDownlinkClient& _fallback;
+
+  std::mutex _mutex;
+  std::condition_variable _not_empty;
+  std::condition_variable _not_full;
+  std::deque<std::pair<SendDlReq, DlOrigin>> _queue;
+  // Packets written and not acknowledged yet, by sequence number
+  std::map<uint64_t, DlOrigin> _in_flight;
+  bool _done = false;
+  // Set by the ack reader once the stream is closed by sctpd
+  bool _broken = false;
+
+  // Stream state, only used by the writer thread
+  std::unique_ptr<ClientContext> _context;
+  std::unique_ptr<ClientReaderWriter<SendDlBatch, SendDlBatchRes>> _rw;
+  std::unique_ptr<std::thread> _reader;
+  uint64_t _next_seq = 0;
+  bool _stream_supported = true;
+  std::chrono::steady_clock::time_point _retry_at;
+
+  std::unique_ptr<std::thread> _writer;
+};
+
+constexpr int SctpdDownlinkStream::kMaxBatchPdus;
+constexpr size_t SctpdDownlinkStream::kMaxQueuedPdus;
+constexpr std::chrono::seconds SctpdDownlinkStream::kStreamRetryInterval;
+
+SctpdDownlinkStream::SctpdDownlinkStream(
+  const std::shared_ptr<Channel>& channel,
+  SctpdDownlinkClient& fallback):
+  _stub(SctpdDownlink::NewStub(channel)),
+  _fallback(fallback)
+{
+}
+
+SctpdDownlinkStream::~SctpdDownlinkStream()
+{
+  stop();
+}
+
+void SctpdDownlinkStream::start()
+{
+  if (_writer != nullptr) return;
+
+  _done = false;
+  _writer = std::make_unique<std::thread>(&SctpdDownlinkStream::run, this);
+}
+
+void SctpdDownlinkStream::stop()
+{
+  if (_writer == nullptr) return;
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _done = true;
+  }
+  _not_empty.notify_one();
+  _writer->join();
+  _writer = nullptr;
+}
+
+void SctpdDownlinkStream::push(SendDlReq&& req, const DlOrigin& origin)
+{
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _not_full.wait(lock, [this] { return _queue.size() < kMaxQueuedPdus; });
+    _queue.emplace_back(std::move(req), origin);
+  }
+  _not_empty.notify_one();
+}
+
+void SctpdDownlinkStream::run()
+{
+  while (true) {
+    std::vector<std::pair<SendDlReq, DlOrigin>> pdus;
+    bool broken;
+
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _not_empty.wait(
+        lock, [this] { return _done || _broken || !_queue.empty(); });
+      broken = _broken;
+      while (!_queue.empty() && pdus.size() < kMaxBatchPdus) {
+        pdus.push_back(std::move(_queue.front()));
+        _queue.pop_front();
+      }
+    }
+    _not_full.notify_all();
+
+    if (broken) close_stream();
+    // Stop only once every queued packet has been sent
+    if (pdus.empty()) {
+      if (_done) break;
+      continue;
+    }
+
+    if (_rw == nullptr) open_stream();
+    if (_rw != nullptr) {
+      SendDlBatch batch;
+
+      batch.set_first_seq(_next_seq);
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto& pdu : pdus) {
+          _in_flight.emplace(_next_seq++, pdu.second);
+        }
+      }
+      for (auto& pdu : pdus) {
+        batch.add_pdus()->Swap(&pdu.first);
+      }
+      if (_rw->Write(batch)) continue;
+
+      // The batch did not make it to sctpd, send it with unary calls
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _in_flight.erase(
+          _in_flight.lower_bound(batch.first_seq()), _in_flight.end());
+      }
+      for (int i = 0; i < batch.pdus_size(); i++) {
+        pdus[i].first.Swap(batch.mutable_pdus(i));
+      }
+      close_stream();
+    }
+
+    for (auto& pdu : pdus) {
+      send_unary(pdu.first, pdu.second);
+    }
+  }
+
+  close_stream();
+}
+
+void SctpdDownlinkStream::read_acks(
+  ClientReaderWriter<SendDlBatch, SendDlBatchRes>* stream)
+{
+  SendDlBatchRes res;
+
+  while (stream->Read(&res)) {
+    std::vector<DlOrigin> lost;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      for (auto seq : res.failed_seqs()) {
+        auto it = _in_flight.find(seq);
+        if (it != _in_flight.end()) lost.push_back(it->second);
+      }
+      _in_flight.erase(
+        _in_flight.lower_bound(res.first_seq()),
+        _in_flight.lower_bound(res.first_seq() + res.count()));
+    }
+    notify_lost(lost);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _broken = true;
+  }
+  _not_empty.notify_one();
+}
+
+void SctpdDownlinkStream::open_stream()
+{
+  if (!_stream_supported) return;
+  if (std::chrono::steady_clock::now() < _retry_at) return;
+
+  _context = std::make_unique<ClientContext>();
+  _rw = _stub->SendDlStream(_context.get());
+  _reader = std::make_unique<std::thread>(
+    &SctpdDownlinkStream::read_acks, this, _rw.get());
+}
+
+void SctpdDownlinkStream::close_stream()
+{
+  std::vector<DlOrigin> lost;
+
+  if (_rw == nullptr) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _broken = false;
+    return;
+  }
+
+  _rw->WritesDone();
+  _reader->join();
+  auto status = _rw->Finish();
+
+  if (status.error_code() == grpc::StatusCode::UNIMPLEMENTED) {
+    OAILOG_INFO(
+      LOG_SCTP, "sctpdl.senddlstream unsupported, using unary calls\n");
+    _stream_supported = false;
+  } else if (!status.ok()) {
+    OAILOG_ERROR(
+      LOG_SCTP,
+      "sctpdl.senddlstream error = %s\n",
+      status.error_message().c_str());
+  }
+
+  _reader = nullptr;
+  _rw = nullptr;
+  _context = nullptr;
+  _retry_at = std::chrono::steady_clock::now() + kStreamRetryInterval;
+
+  // Packets never acknowledged by sctpd are reported as lost
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto& in_flight : _in_flight) {
+      lost.push_back(in_flight.second);
+    }
+    _in_flight.clear();
+    _broken = false;
+  }
+  notify_lost(lost);
+}
+
+void SctpdDownlinkStream::send_unary(SendDlReq& req, const DlOrigin& origin)
+{
+  SendDlRes res;
+
+  auto rc = _fallback.sendDl(req, &res);
+  if (rc < 0 || res.result() != SendDlRes::SEND_DL_OK) {
+    notify_lost({origin});
+  }
+}
+
+void SctpdDownlinkStream::notify_lost(const std::vector<DlOrigin>& lost)
+{
+  for (const auto& origin : lost) {
+    sctp_itti_send_lower_layer_conf(
+      origin.origin_task_id,
+      origin.assoc_id,
+      origin.stream,
+      origin.mme_ue_s1ap_id,
+      false);
+  }
+}
+
 } // namespace lte
 } // namespace magma
 
+using magma::lte::DlOrigin;
 using magma::lte::SctpdDownlinkClient;
+using magma::lte::SctpdDownlinkStream;
 using magma::sctpd::InitReq;
 using magma::sctpd::InitRes;
 using magma::sctpd::SendDlReq;
 using magma::sctpd::SendDlRes;
 
 std::unique_ptr<SctpdDownlinkClient> _client = nullptr;
+std::unique_ptr<SctpdDownlinkStream> _stream = nullptr;
 
 int init_sctpd_downlink_client(bool force_restart)
 {
   auto channel =
     grpc::CreateChannel(DOWNSTREAM_SOCK, grpc::InsecureChannelCredentials());
   _client = std::make_unique<SctpdDownlinkClient>(channel, force_restart);
+  _stream = std::make_unique<SctpdDownlinkStream>(channel, *_client);
+  return 0;
+}
+
+void stop_sctpd_downlink_client(void)
+{
+  if (_stream != nullptr) {
+    _stream->stop();
+  }
 }
 
 // init
@@ -155,12 +462,17 @@ int sctpd_init(sctp_init_t* init)
 
   req.set_port(init->port);
   req.set_ppid(init->ppid);
+  req.set_recv_workers(init->recv_workers);
 
   req.set_force_restart(_client->should_force_restart);
 
   auto rc = _client->init(req, &res);
   auto init_ok = res.result() == InitRes::INIT_OK;
 
+  if ((rc == 0) && init_ok) {
+    _stream->start();
+  }
+
   return (rc == 0) && init_ok ? 0 : -1;
 }
 
@@ -180,3 +492,28 @@ int sctpd_send_dl(uint32_t assoc_id, uint16_t stream, bstring payload)
 
   return rc == 0 && res.result() == SendDlRes::SEND_DL_OK ? 0 : -1;
 }
+
+// sendDl over the downlink stream
+int sctpd_queue_dl(
+  task_id_t origin_task_id,
+  uint32_t assoc_id,
+  uint16_t stream,
+  uint32_t mme_ue_s1ap_id,
+  bstring payload)
+{
+  SendDlReq req;
+  DlOrigin origin = {origin_task_id, assoc_id, stream, mme_ue_s1ap_id};
+
+  // Without a writer, e.g. when sctpd_init failed, a queued packet would never
+  // be sent and the queue would end up blocking the sctp task
+  if (!_stream->running()) {
+    return sctpd_send_dl(assoc_id, stream, payload);
+  }
+
+  req.set_assoc_id(assoc_id);
+  req.set_stream(stream);
+  req.set_payload(bdata(payload), blength(payload));
+
+  _stream->push(std::move(req), origin);
+  return 0;
+}
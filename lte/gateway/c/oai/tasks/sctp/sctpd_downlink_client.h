@@ -26,11 +26,24 @@
 #include "bstrlib.h"
 
 #include "sctp_messages_types.h"
+#include "intertask_interface_types.h"
 
 int init_sctpd_downlink_client(bool force_restart);
+void stop_sctpd_downlink_client(void);
 
 // init
 int sctpd_init(sctp_init_t* init);
 
 // sendDl
 int sctpd_send_dl(uint32_t assoc_id, uint16_t stream, bstring payload);
+
+// sendDl pipelined over the downlink stream, a packet that cannot be sent is
+// reported to origin_task_id with a lower layer conf. Until the stream is
+// started by sctpd_init, falls back to a blocking sendDl and returns -1 if
+// the packet could not be sent
+int sctpd_queue_dl(
+  task_id_t origin_task_id,
+  uint32_t assoc_id,
+  uint16_t stream,
+  uint32_t mme_ue_s1ap_id,
+  bstring payload);
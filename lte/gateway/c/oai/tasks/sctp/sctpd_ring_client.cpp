@@ -0,0 +1,387 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+extern "C" {
+#include "sctpd_ring_client.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "log.h"
+
+#include "sctp_defs.h"
+#include "sctp_itti_messaging.h"
+}
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "sctpd_ring.h"
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+namespace magma {
+namespace lte {
+
+using magma::sctpd::kRingCapacity;
+using magma::sctpd::kRingMagic;
+using magma::sctpd::kRingVersion;
+using magma::sctpd::RingHandoff;
+using magma::sctpd::RingRecord;
+using magma::sctpd::RingRecordType;
+using magma::sctpd::SpscRing;
+
+// Time waited between two attempts to write to a full downlink ring
+#define RING_FULL_SLEEP_US 50
+
+// Shared memory rings handed over to sctpd (see sctpd_ring.h)
+//
+// The sctp task is the only producer of the downlink ring. A separate thread
+// consumes the uplink ring and forwards its events to the S1AP task, the
+// payload being copied once from the ring into the bstring handed to S1AP.
+class SctpdRingClient {
+ public:
+  ~SctpdRingClient();
+
+  int start();
+  // Stop the uplink thread and unmap the rings - blocking call
+  void stop();
+
+  int send_dl(
+    task_id_t origin_task_id,
+    uint32_t assoc_id,
+    uint16_t stream,
+    uint32_t mme_ue_s1ap_id,
+    bstring payload);
+
+ private:
+  int create_rings();
+  int hand_over();
+  void run();
+  void dispatch(const RingRecord* record);
+
+  void* _base = nullptr;
+  size_t _size = 0;
+  int _mem_fd = -1;
+  int _ul_efd = -1;
+  int _dl_efd = -1;
+  int _conn_sd = -1;
+  SpscRing _ul_ring;
+  SpscRing _dl_ring;
+
+  // Cleared by the uplink thread once sctpd closes the handoff socket, or
+  // once the uplink ring is found corrupted
+  std::atomic<bool> _attached{false};
+  std::atomic<bool> _done{false};
+  std::unique_ptr<std::thread> _thread;
+};
+
+SctpdRingClient::~SctpdRingClient()
+{
+  stop();
+}
+
+int SctpdRingClient::start()
+{
+  if (create_rings() < 0 || hand_over() < 0) {
+    stop();
+    return -1;
+  }
+
+  _done = false;
+  _attached = true;
+  _thread = std::make_unique<std::thread>(&SctpdRingClient::run, this);
+
+  OAILOG_INFO(LOG_SCTP, "sctpd attached to shared memory rings\n");
+  return 0;
+}
+
+void SctpdRingClient::stop()
+{
+  _attached = false;
+  if (_thread != nullptr) {
+    _done = true;
+    _thread->join();
+    _thread = nullptr;
+  }
+
+  if (_conn_sd >= 0) close(_conn_sd);
+  if (_ul_efd >= 0) close(_ul_efd);
+  if (_dl_efd >= 0) close(_dl_efd);
+  if (_mem_fd >= 0) close(_mem_fd);
+  if (_base != nullptr) munmap(_base, _size);
+  _conn_sd = _ul_efd = _dl_efd = _mem_fd = -1;
+  _base = nullptr;
+  _size = 0;
+}
+
+int SctpdRingClient::create_rings()
+{
+  size_t region_size = SpscRing::RegionSize(kRingCapacity);
+
+  _size = 2 * region_size;
+  _mem_fd = syscall(SYS_memfd_create, "sctpd_rings", MFD_CLOEXEC);
+  if (_mem_fd < 0 || ftruncate(_mem_fd, _size) < 0) {
+    OAILOG_ERROR(
+      LOG_SCTP, "failed to create ring memory: %s\n", strerror(errno));
+    return -1;
+  }
+
+  _base =
+    mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, _mem_fd, 0);
+  if (_base == MAP_FAILED) {
+    OAILOG_ERROR(LOG_SCTP, "failed to map ring memory: %s\n", strerror(errno));
+    _base = nullptr;
+    return -1;
+  }
+
+  auto dl_base = static_cast<char*>(_base) + region_size;
+  SpscRing::Format(_base, kRingCapacity);
+  SpscRing::Format(dl_base, kRingCapacity);
+  _ul_ring.Attach(_base, kRingCapacity);
+  _dl_ring.Attach(dl_base, kRingCapacity);
+
+  _ul_efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  _dl_efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (_ul_efd < 0 || _dl_efd < 0) {
+    OAILOG_ERROR(LOG_SCTP, "failed to create ring eventfd: %s\n", strerror(errno));
+    return -1;
+  }
+
+  return 0;
+}
+
+int SctpdRingClient::hand_over()
+{
+  struct sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, SCTPD_RING_SOCK, sizeof(addr.sun_path) - 1);
+
+  _conn_sd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (
+    _conn_sd < 0 ||
+    connect(_conn_sd, (struct sockaddr*) &addr, sizeof(addr)) < 0) {
+    OAILOG_ERROR(
+      LOG_SCTP,
+      "failed to connect to %s: %s\n",
+      SCTPD_RING_SOCK,
+      strerror(errno));
+    return -1;
+  }
+
+  RingHandoff handoff = {kRingMagic, kRingVersion, kRingCapacity};
+  int fds[3] = {_mem_fd, _ul_efd, _dl_efd};
+  struct iovec iov = {&handoff, sizeof(handoff)};
+  char control[CMSG_SPACE(sizeof(fds))] = {};
+  struct msghdr msg = {};
+
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+  if (sendmsg(_conn_sd, &msg, 0) != sizeof(handoff)) {
+    OAILOG_ERROR(LOG_SCTP, "failed to hand rings over: %s\n", strerror(errno));
+    return -1;
+  }
+
+  // sctpd holds its own mapping now
+  close(_mem_fd);
+  _mem_fd = -1;
+  return 0;
+}
+
+int SctpdRingClient::send_dl(
+  task_id_t origin_task_id,
+  uint32_t assoc_id,
+  uint16_t stream,
+  uint32_t mme_ue_s1ap_id,
+  bstring payload)
+{
+  RingRecord* record;
+
+  if (!_attached || (uint32_t) blength(payload) > _dl_ring.MaxPayload()) {
+    return -1;
+  }
+
+  // Wait for sctpd to make room, unless it goes away meanwhile
+  while ((record = _dl_ring.Reserve(blength(payload))) == nullptr) {
+    if (!_attached) return -1;
+    usleep(RING_FULL_SLEEP_US);
+  }
+
+  record->type = RingRecordType::DATA;
+  record->stream = stream;
+  record->assoc_id = assoc_id;
+  record->origin = origin_task_id;
+  record->tag = mme_ue_s1ap_id;
+  memcpy(record->payload(), bdata(payload), blength(payload));
+
+  if (_dl_ring.Commit(record)) {
+    uint64_t one = 1;
+    if (write(_dl_efd, &one, sizeof(one)) < 0) {
+      OAILOG_ERROR(LOG_SCTP, "failed to signal sctpd: %s\n", strerror(errno));
+    }
+  }
+
+  return 0;
+}
+
+void SctpdRingClient::run()
+{
+  while (!_done) {
+    const RingRecord* record;
+
+    while ((record = _ul_ring.Peek()) != nullptr) {
+      dispatch(record);
+      _ul_ring.Release(record);
+    }
+    if (_ul_ring.Corrupted()) {
+      // The ring can't be read past a bad record, fall back to GRPC on both
+      // sides: sctpd detaches once it sees the handoff socket shut down
+      OAILOG_ERROR(
+        LOG_SCTP, "uplink record overflowing the ring, relaying over GRPC\n");
+      _attached = false;
+      shutdown(_conn_sd, SHUT_RDWR);
+      break;
+    }
+    // Nothing is written to the uplink ring once sctpd is gone
+    if (!_attached) break;
+
+    struct pollfd fds[2] = {{_ul_efd, POLLIN, 0}, {_conn_sd, POLLIN, 0}};
+    int timeout = _ul_ring.PrepareWait() ? 100 : 0; // milliseconds = .1s
+    int rc = poll(fds, 2, timeout);
+    _ul_ring.FinishWait();
+
+    if (rc < 0 && errno != EINTR) {
+      OAILOG_ERROR(LOG_SCTP, "ring poll error: %s\n", strerror(errno));
+      continue;
+    }
+    if (fds[0].revents & POLLIN) {
+      uint64_t count;
+      if (read(_ul_efd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        OAILOG_ERROR(LOG_SCTP, "ring eventfd error: %s\n", strerror(errno));
+      }
+    }
+    if (fds[1].revents & (POLLIN | POLLHUP | POLLERR)) {
+      // sctpd only ever closes the handoff socket, events then come over GRPC
+      OAILOG_ERROR(LOG_SCTP, "sctpd detached from shared memory rings\n");
+      _attached = false;
+    }
+  }
+}
+
+void SctpdRingClient::dispatch(const RingRecord* record)
+{
+  switch (record->type) {
+    case RingRecordType::DATA: {
+      bstring payload = blk2bstr(record->payload(), record->length);
+      if (payload == NULL) {
+        OAILOG_ERROR(LOG_SCTP, "failed to allocate bstr for ring packet\n");
+        break;
+      }
+      if (
+        sctp_itti_send_new_message_ind(
+          &payload, record->assoc_id, record->stream) < 0) {
+        OAILOG_ERROR(LOG_SCTP, "failed to send new_message_ind for ring\n");
+      }
+    } break;
+    case RingRecordType::NEW_ASSOC: {
+      if (
+        sctp_itti_send_new_association(
+          record->assoc_id, record->instreams, record->outstreams) < 0) {
+        OAILOG_ERROR(LOG_SCTP, "failed to send new_association for ring\n");
+      }
+    } break;
+    case RingRecordType::CLOSE_ASSOC:
+    case RingRecordType::RESET_ASSOC: {
+      bool reset = record->type == RingRecordType::RESET_ASSOC;
+      if (sctp_itti_send_com_down_ind(record->assoc_id, reset) < 0) {
+        OAILOG_ERROR(LOG_SCTP, "failed to send com_down_ind for ring\n");
+      }
+    } break;
+    case RingRecordType::SEND_FAILED: {
+      sctp_itti_send_lower_layer_conf(
+        (task_id_t) record->origin,
+        record->assoc_id,
+        record->stream,
+        record->tag,
+        false);
+    } break;
+    default: {
+      OAILOG_ERROR(
+        LOG_SCTP, "unexpected uplink record type %d\n", (int) record->type);
+    } break;
+  }
+}
+
+} // namespace lte
+} // namespace magma
+
+using magma::lte::SctpdRingClient;
+
+std::unique_ptr<SctpdRingClient> _ring_client = nullptr;
+
+int start_sctpd_ring_client(void)
+{
+  _ring_client = std::make_unique<SctpdRingClient>();
+
+  if (_ring_client->start() < 0) {
+    _ring_client = nullptr;
+    return -1;
+  }
+  return 0;
+}
+
+void stop_sctpd_ring_client(void)
+{
+  _ring_client = nullptr;
+}
+
+int sctpd_ring_send_dl(
+  task_id_t origin_task_id,
+  uint32_t assoc_id,
+  uint16_t stream,
+  uint32_t mme_ue_s1ap_id,
+  bstring payload)
+{
+  if (_ring_client == nullptr) return -1;
+
+  return _ring_client->send_dl(
+    origin_task_id, assoc_id, stream, mme_ue_s1ap_id, payload);
+}
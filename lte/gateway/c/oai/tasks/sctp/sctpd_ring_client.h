@@ -0,0 +1,42 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "bstrlib.h"
+
+#include "intertask_interface_types.h"
+
+// Hand shared memory rings over to sctpd, uplink events are then read from
+// the uplink ring instead of the uplink server
+int start_sctpd_ring_client(void);
+void stop_sctpd_ring_client(void);
+
+// sendDl over the downlink ring, returns -1 if sctpd is not attached. A packet
+// that cannot be sent is reported to origin_task_id with a lower layer conf
+int sctpd_ring_send_dl(
+  task_id_t origin_task_id,
+  uint32_t assoc_id,
+  uint16_t stream,
+  uint32_t mme_ue_s1ap_id,
+  bstring payload);
@@ -30,7 +30,9 @@ extern "C" {
 #include "sctp_itti_messaging.h"
 }
 
+#include <algorithm>
 #include <memory>
+#include <mutex>
 
 #include <grpcpp/grpcpp.h>
 
@@ -40,6 +42,7 @@ namespace magma {
 namespace mme {
 
 using grpc::ServerContext;
+using grpc::ServerReaderWriter;
 using grpc::Status;
 
 using magma::sctpd::CloseAssocReq;
@@ -47,8 +50,11 @@ using magma::sctpd::CloseAssocRes;
 using magma::sctpd::NewAssocReq;
 using magma::sctpd::NewAssocRes;
 using magma::sctpd::SctpdUplink;
+using magma::sctpd::SendUlBatch;
+using magma::sctpd::SendUlBatchRes;
 using magma::sctpd::SendUlReq;
 using magma::sctpd::SendUlRes;
+using magma::sctpd::UlEvent;
 
 class SctpdUplinkImpl final : public SctpdUplink::Service {
  public:
@@ -64,6 +70,19 @@ class SctpdUplinkImpl final : public SctpdUplink::Service {
     ServerContext *context,
     const CloseAssocReq *req,
     CloseAssocRes *res) override;
+  Status SendUlStream(
+    ServerContext *context,
+    ServerReaderWriter<SendUlBatchRes, SendUlBatch> *stream) override;
+
+ private:
+  // Number of leading events of batch already relayed, these were sent again
+  // by sctpd after a stream broke before they were acknowledged
+  int relayed_events(const SendUlBatch &batch);
+
+  std::mutex _seq_mutex;
+  // Numbering session of sctpd and sequence number of the next event to relay
+  uint64_t _session_id = 0;
+  uint64_t _next_seq = 0;
 };
 
 SctpdUplinkImpl::SctpdUplinkImpl() {}
@@ -136,6 +155,64 @@ Status SctpdUplinkImpl::CloseAssoc(
   return Status::OK;
 }
 
+int SctpdUplinkImpl::relayed_events(const SendUlBatch &batch)
+{
+  std::lock_guard<std::mutex> lock(_seq_mutex);
+  uint64_t end_seq = batch.first_seq() + batch.events_size();
+
+  if (batch.session_id() != _session_id) {
+    // sctpd restarted, its numbering too
+    _session_id = batch.session_id();
+    _next_seq = end_seq;
+    return 0;
+  }
+  auto relayed = std::min<uint64_t>(
+    _next_seq - std::min(_next_seq, batch.first_seq()), batch.events_size());
+  _next_seq = std::max(_next_seq, end_seq);
+  return relayed;
+}
+
+Status SctpdUplinkImpl::SendUlStream(
+  ServerContext *context,
+  ServerReaderWriter<SendUlBatchRes, SendUlBatch> *stream)
+{
+  SendUlBatch batch;
+
+  // Events of a stream are relayed in order, as they would be with the unary
+  // calls
+  while (stream->Read(&batch)) {
+    int relayed = relayed_events(batch);
+    for (int i = relayed; i < batch.events_size(); i++) {
+      const auto &event = batch.events(i);
+      switch (event.event_case()) {
+        case UlEvent::kSendUl: {
+          SendUlRes send_ul_res;
+          SendUl(context, &event.send_ul(), &send_ul_res);
+        } break;
+        case UlEvent::kNewAssoc: {
+          NewAssocRes new_assoc_res;
+          NewAssoc(context, &event.new_assoc(), &new_assoc_res);
+        } break;
+        case UlEvent::kCloseAssoc: {
+          CloseAssocRes close_assoc_res;
+          CloseAssoc(context, &event.close_assoc(), &close_assoc_res);
+        } break;
+        default: {
+          OAILOG_ERROR(LOG_SCTP, "empty event in SendUlStream\n");
+        } break;
+      }
+    }
+
+    // Events are handed to the sctp task, sctpd no longer needs to keep them
+    SendUlBatchRes res;
+    res.set_first_seq(batch.first_seq());
+    res.set_count(batch.events_size());
+    if (!stream->Write(res)) break;
+  }
+
+  return Status::OK;
+}
+
 } // namespace mme
 } // namespace magma
 
@@ -28,8 +28,11 @@
 #include "bstrlib.h"
 #include "orc8r/protos/service303.pb.h"
 
+using magma::service303::CounterHandle;
+using magma::service303::GaugeHandle;
 using magma::service303::MagmaService;
 using magma::service303::MetricsSingleton;
+using magma::service303::ShardedMetric;
 
 static MagmaService *magma_service;
 
@@ -92,6 +95,52 @@ void observe_histogram(
   va_end(ap);
 }
 
+// The C handles are the sharded metrics the C++ handles wrap
+counter_handle_t *get_counter_handle(const char *name, size_t n_labels, ...)
+{
+  va_list ap;
+  va_start(ap, n_labels);
+  auto handle = MetricsSingleton::Instance().GetCounter(name, n_labels, ap);
+  va_end(ap);
+  return reinterpret_cast<counter_handle_t *>(handle.get());
+}
+
+void counter_handle_increment(counter_handle_t *handle, double increment)
+{
+  CounterHandle(reinterpret_cast<ShardedMetric<prometheus::Counter> *>(handle))
+    .Increment(increment);
+}
+
+gauge_handle_t *get_gauge_handle(const char *name, size_t n_labels, ...)
+{
+  va_list ap;
+  va_start(ap, n_labels);
+  auto handle = MetricsSingleton::Instance().GetGauge(name, n_labels, ap);
+  va_end(ap);
+  return reinterpret_cast<gauge_handle_t *>(handle.get());
+}
+
+static GaugeHandle to_gauge_handle(gauge_handle_t *handle)
+{
+  return GaugeHandle(
+    reinterpret_cast<ShardedMetric<prometheus::Gauge> *>(handle));
+}
+
+void gauge_handle_increment(gauge_handle_t *handle, double increment)
+{
+  to_gauge_handle(handle).Increment(increment);
+}
+
+void gauge_handle_decrement(gauge_handle_t *handle, double decrement)
+{
+  to_gauge_handle(handle).Decrement(decrement);
+}
+
+void gauge_handle_set(gauge_handle_t *handle, double value)
+{
+  to_gauge_handle(handle).Set(value);
+}
+
 void service303_set_application_health(application_health_t health)
 {
   ServiceInfo::ApplicationHealth appHealthEnum;
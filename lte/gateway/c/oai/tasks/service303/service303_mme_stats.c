@@ -21,7 +21,10 @@
 #define SERVICE303
 
 #include <stddef.h>
+#include <stdio.h>
 
+#include "binary_log.h"
+#include "intertask_interface.h"
 #include "mme_app_state.h"
 #include "service303.h"
 
@@ -36,8 +39,63 @@ static void service303_mme_statistics_read(void)
   return;
 }
 
+static void service303_memory_pools_statistics_read(void)
+{
+  static uint64_t reported_misses[MEMORY_POOLS_MAX_NUMBER] = {0};
+  memory_pool_statistics_t statistics[MEMORY_POOLS_MAX_NUMBER];
+  uint32_t pools_number;
+  uint32_t pool;
+  char item_size[16];
+
+  pools_number =
+    itti_get_memory_pools_statistics(statistics, MEMORY_POOLS_MAX_NUMBER);
+  for (pool = 0; pool < pools_number; pool++) {
+    if (statistics[pool].retired) {
+      continue;
+    }
+    snprintf(item_size, sizeof(item_size), "%u", statistics[pool].item_size);
+    set_gauge(
+      "itti_memory_pool_items",
+      statistics[pool].items_number,
+      1,
+      "item_size",
+      item_size);
+    set_gauge(
+      "itti_memory_pool_high_water_mark",
+      statistics[pool].high_water_mark,
+      1,
+      "item_size",
+      item_size);
+    if (statistics[pool].misses > reported_misses[pool]) {
+      increment_counter(
+        "itti_memory_pool_misses",
+        statistics[pool].misses - reported_misses[pool],
+        1,
+        "item_size",
+        item_size);
+      reported_misses[pool] = statistics[pool].misses;
+    }
+  }
+}
+
+static void service303_log_statistics_read(void)
+{
+  static uint64_t reported_dropped_records = 0;
+  uint64_t dropped_records = binary_log_dropped_records();
+
+  if (dropped_records > reported_dropped_records) {
+    increment_counter(
+      "binary_log_dropped_records",
+      dropped_records - reported_dropped_records,
+      NO_LABELS);
+    reported_dropped_records = dropped_records;
+  }
+}
+
 void service303_statistics_read(void)
 {
   service303_mme_statistics_read();
+  service303_memory_pools_statistics_read();
+  service303_log_statistics_read();
   return;
 }
@@ -48,6 +48,7 @@
 #include "3gpp_24.008.h"
 #include "3gpp_29.274.h"
 #include "common_types.h"
+#include "dynamic_memory_check.h"
 #include "hashtable.h"
 #include "intertask_interface_types.h"
 #include "ip_forward_messages_types.h"
@@ -85,10 +86,8 @@ int pgw_handle_create_bearer_request(
     "Rx S5_CREATE_BEARER_REQUEST, Context S-GW S11 teid %u, EPS bearer id %u\n",
     bearer_req_p->context_teid,
     bearer_req_p->eps_bearer_id);
-  hash_rc = hashtable_ts_get(
-    spgw_state->sgw_state.s11_bearer_context_information,
-    bearer_req_p->context_teid,
-    (void **) &new_bearer_ctxt_info_p);
+  hash_rc = sgw_cm_get_bearer_context_information(
+    spgw_state, bearer_req_p->context_teid, &new_bearer_ctxt_info_p);
 
   if (HASH_TABLE_OK == hash_rc) {
     memset(
@@ -431,12 +430,10 @@ uint32_t pgw_handle_nw_initiated_bearer_actv_req(
 {
   OAILOG_FUNC_IN(LOG_PGW_APP);
   MessageDef *message_p = NULL;
-  uint32_t i = 0;
   uint32_t rc = RETURNok;
   hash_table_ts_t *hashtblP = NULL;
-  uint32_t num_elements = 0;
+  hashtable_element_array_t *ea = NULL;
   s_plus_p_gw_eps_bearer_context_information_t *spgw_ctxt_p = NULL;
-  hash_node_t *node = NULL;
   itti_s5_nw_init_actv_bearer_request_t *itti_s5_actv_bearer_req = NULL;
   bool is_imsi_found = false;
   bool is_lbi_found = false;
@@ -478,37 +475,30 @@ uint32_t pgw_handle_nw_initiated_bearer_actv_req(
   }
 
   // Fetch S11 MME TEID using IMSI and LBI
-  while ((num_elements < hashtblP->num_elements) && (i < hashtblP->size)) {
-    pthread_mutex_lock(&hashtblP->lock_nodes[i]);
-    if (hashtblP->nodes[i] != NULL) {
-      node = hashtblP->nodes[i];
-    }
-    pthread_mutex_unlock(&hashtblP->lock_nodes[i]);
-    while (node) {
-      num_elements++;
-      hashtable_ts_get(
-        hashtblP, (const hash_key_t) node->key, (void **) &spgw_ctxt_p);
-      if (spgw_ctxt_p != NULL) {
-        if (!strncmp(
-          (const char *)
-          spgw_ctxt_p->sgw_eps_bearer_context_information.imsi.digit,
-          (const char *) bearer_req_p->imsi,
-          strlen((const char *) bearer_req_p->imsi))) {
-          is_imsi_found = true;
-          if (
-            spgw_ctxt_p->sgw_eps_bearer_context_information.pdn_connection
-              .default_bearer == bearer_req_p->lbi) {
-            is_lbi_found = true;
-            itti_s5_actv_bearer_req->lbi = bearer_req_p->lbi;
-            itti_s5_actv_bearer_req->mme_teid_S11 =
-              spgw_ctxt_p->sgw_eps_bearer_context_information.mme_teid_S11;
-            break;
-          }
+  ea = hashtable_ts_get_elements(hashtblP);
+  for (int i = 0; ea && (i < ea->num_elements) && (!is_lbi_found); i++) {
+    spgw_ctxt_p = ea->elements[i];
+    if (spgw_ctxt_p != NULL) {
+      if (!strncmp(
+        (const char *)
+        spgw_ctxt_p->sgw_eps_bearer_context_information.imsi.digit,
+        (const char *) bearer_req_p->imsi,
+        strlen((const char *) bearer_req_p->imsi))) {
+        is_imsi_found = true;
+        if (
+          spgw_ctxt_p->sgw_eps_bearer_context_information.pdn_connection
+            .default_bearer == bearer_req_p->lbi) {
+          is_lbi_found = true;
+          itti_s5_actv_bearer_req->lbi = bearer_req_p->lbi;
+          itti_s5_actv_bearer_req->mme_teid_S11 =
+            spgw_ctxt_p->sgw_eps_bearer_context_information.mme_teid_S11;
         }
       }
-      node = node->next;
     }
-    i++;
+  }
+  if (ea) {
+    free_wrapper((void **) &ea->elements);
+    free_wrapper((void **) &ea);
   }
   if ((!is_imsi_found) || (!is_lbi_found)) {
     OAILOG_INFO(
@@ -548,12 +538,10 @@ uint32_t pgw_handle_nw_initiated_bearer_deactv_req(
   uint32_t rc = RETURNok;
   OAILOG_FUNC_IN(LOG_PGW_APP);
   MessageDef *message_p = NULL;
-  uint32_t i = 0;
   uint32_t itrn = 0;
   hash_table_ts_t *hashtblP = NULL;
-  uint32_t num_elements = 0;
+  hashtable_element_array_t *ea = NULL;
   s_plus_p_gw_eps_bearer_context_information_t *spgw_ctxt_p = NULL;
-  hash_node_t *node = NULL;
   itti_s5_nw_init_deactv_bearer_request_t *itti_s5_deactv_ded_bearer_req = NULL;
   bool is_lbi_found = false;
   bool is_imsi_found = false;
@@ -576,56 +564,51 @@ uint32_t pgw_handle_nw_initiated_bearer_deactv_req(
   }
 
   // Check if valid LBI and EBI recvd
-  while ((num_elements < hashtblP->num_elements) && (i < hashtblP->size) &&
-         (!is_imsi_found)) {
-    pthread_mutex_lock(&hashtblP->lock_nodes[i]);
-    if (hashtblP->nodes[i] != NULL) {
-      node = hashtblP->nodes[i];
-      spgw_ctxt_p = node->data;
-      num_elements++;
-      if (spgw_ctxt_p != NULL) {
-        if (!strcmp(
-          (const char *)
-          spgw_ctxt_p->sgw_eps_bearer_context_information.imsi.digit,
-          (const char *) bearer_req_p->imsi)) {
-          is_imsi_found = true;
-          s11_mme_teid =
-            spgw_ctxt_p->sgw_eps_bearer_context_information.mme_teid_S11;
-          if ((bearer_req_p->lbi != 0) &&
-            (bearer_req_p->lbi ==
-            spgw_ctxt_p->sgw_eps_bearer_context_information.pdn_connection
-              .default_bearer)) {
-            is_lbi_found = true;
-            // Check if the received EBI is valid
-            for (itrn = 0; itrn < bearer_req_p->no_of_bearers; itrn ++) {
-              if(sgw_cm_get_eps_bearer_entry(
-                &spgw_ctxt_p->sgw_eps_bearer_context_information.pdn_connection,
-                bearer_req_p->ebi[itrn])) {
-                is_ebi_found = true;
-                ebi_to_be_deactivated[no_of_bearers_to_be_deact] =
-                  bearer_req_p->ebi[itrn];
-                no_of_bearers_to_be_deact++;
-              } else {
-                invalid_bearer_id[no_of_bearers_rej] = bearer_req_p->ebi[itrn];
-                no_of_bearers_rej++;
-              }
+  ea = hashtable_ts_get_elements(hashtblP);
+  for (int i = 0; ea && (i < ea->num_elements) && (!is_imsi_found); i++) {
+    spgw_ctxt_p = ea->elements[i];
+    if (spgw_ctxt_p != NULL) {
+      if (!strcmp(
+        (const char *)
+        spgw_ctxt_p->sgw_eps_bearer_context_information.imsi.digit,
+        (const char *) bearer_req_p->imsi)) {
+        is_imsi_found = true;
+        s11_mme_teid =
+          spgw_ctxt_p->sgw_eps_bearer_context_information.mme_teid_S11;
+        if ((bearer_req_p->lbi != 0) &&
+          (bearer_req_p->lbi ==
+          spgw_ctxt_p->sgw_eps_bearer_context_information.pdn_connection
+            .default_bearer)) {
+          is_lbi_found = true;
+          // Check if the received EBI is valid
+          for (itrn = 0; itrn < bearer_req_p->no_of_bearers; itrn ++) {
+            if(sgw_cm_get_eps_bearer_entry(
+              &spgw_ctxt_p->sgw_eps_bearer_context_information.pdn_connection,
+              bearer_req_p->ebi[itrn])) {
+              is_ebi_found = true;
+              ebi_to_be_deactivated[no_of_bearers_to_be_deact] =
+                bearer_req_p->ebi[itrn];
+              no_of_bearers_to_be_deact++;
+            } else {
+              invalid_bearer_id[no_of_bearers_rej] = bearer_req_p->ebi[itrn];
+              no_of_bearers_rej++;
             }
-          } else {
-            invalid_bearer_id[no_of_bearers_rej] = bearer_req_p->lbi;
-            no_of_bearers_rej++;
-            OAILOG_ERROR(
-              LOG_PGW_APP,
-              "Unknown LBI (%d) received in pgw_nw_init_deactv_bearer_request"
-              "\n",
-              bearer_req_p->lbi);
-            pthread_mutex_unlock(&hashtblP->lock_nodes[i]);
-            break;
           }
+        } else {
+          invalid_bearer_id[no_of_bearers_rej] = bearer_req_p->lbi;
+          no_of_bearers_rej++;
+          OAILOG_ERROR(
+            LOG_PGW_APP,
+            "Unknown LBI (%d) received in pgw_nw_init_deactv_bearer_request"
+            "\n",
+            bearer_req_p->lbi);
         }
       }
     }
-    pthread_mutex_unlock(&hashtblP->lock_nodes[i]);
-    i++;
+  }
+  if (ea) {
+    free_wrapper((void **) &ea->elements);
+    free_wrapper((void **) &ea);
   }
 
   /* Send reject to NW if we did not find ebi/lbi/imsi.
@@ -218,6 +218,7 @@ mme_sgw_tunnel_t *sgw_cm_create_s11_tunnel(
    * * * * If collision_p is not NULL (0), it means tunnel is already present.
    */
   hashtable_ts_insert(state->sgw_state.s11teid2mme, local_teid, new_tunnel);
+  spgw_state_mark_s11_tunnel_dirty(local_teid);
   return new_tunnel;
 }
 
@@ -228,6 +229,7 @@ int sgw_cm_remove_s11_tunnel(spgw_state_t *state, teid_t local_teid)
   int temp = 0;
 
   temp = hashtable_ts_free(state->sgw_state.s11teid2mme, local_teid);
+  spgw_state_mark_s11_tunnel_dirty(local_teid);
   return temp;
 }
 
@@ -286,6 +288,7 @@ sgw_cm_create_bearer_context_information_in_collection(
     state->sgw_state.s11_bearer_context_information,
     teid,
     new_bearer_context_information);
+  spgw_state_mark_bearer_context_dirty(teid);
   OAILOG_DEBUG(
     LOG_SPGW_APP,
     "Added new s_plus_p_gw_eps_bearer_context_information_t in "
@@ -301,9 +304,27 @@ int sgw_cm_remove_bearer_context_information(spgw_state_t *state, teid_t teid)
 
   temp =
     hashtable_ts_free(state->sgw_state.s11_bearer_context_information, teid);
+  spgw_state_mark_bearer_context_dirty(teid);
   return temp;
 }
 
+//-----------------------------------------------------------------------------
+hashtable_rc_t sgw_cm_get_bearer_context_information(
+  spgw_state_t *state,
+  teid_t teid,
+  s_plus_p_gw_eps_bearer_context_information_t **bearer_context_information)
+{
+  hashtable_rc_t hash_rc = hashtable_ts_get(
+    state->sgw_state.s11_bearer_context_information,
+    teid,
+    (void **) bearer_context_information);
+  if (hash_rc == HASH_TABLE_OK) {
+    // The caller may modify the context, write it on next put
+    spgw_state_mark_bearer_context_dirty(teid);
+  }
+  return hash_rc;
+}
+
 //--- EPS Bearer Entry
 
 //-----------------------------------------------------------------------------
@@ -52,6 +52,10 @@ sgw_cm_create_bearer_context_information_in_collection(
   spgw_state_t *state,
   teid_t teid);
 int sgw_cm_remove_bearer_context_information(spgw_state_t *state, teid_t teid);
+hashtable_rc_t sgw_cm_get_bearer_context_information(
+  spgw_state_t *state,
+  teid_t teid,
+  s_plus_p_gw_eps_bearer_context_information_t **bearer_context_information);
 sgw_eps_bearer_ctxt_t *sgw_cm_create_eps_bearer_ctxt_in_collection(
   sgw_pdn_connection_t *const sgw_pdn_connection,
   const ebi_t eps_bearer_idP);
@@ -29,6 +29,10 @@
 #ifndef FILE_SGW_DEFS_SEEN
 #define FILE_SGW_DEFS_SEEN
 #include "spgw_config.h"
-int sgw_init(spgw_config_t *spgw_config_pP, bool persist_state);
+int sgw_init(
+  spgw_config_t *spgw_config_pP,
+  bool persist_state,
+  bool persist_records,
+  uint32_t write_behind_window_ms);
 
 #endif /* FILE_SGW_DEFS_SEEN */
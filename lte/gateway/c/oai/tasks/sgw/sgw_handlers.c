@@ -34,6 +34,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <netinet/in.h>
+#include <pthread.h>
 
 #include "bstrlib.h"
 #include "dynamic_memory_check.h"
@@ -77,6 +78,15 @@ extern void print_bearer_ids_helper(const ebi_t*, uint32_t);
 #define TASK_MME TASK_S11
 #endif
 
+// Resolved once, create session requests are counted on every request
+static pthread_once_t create_session_counter_once = PTHREAD_ONCE_INIT;
+static counter_handle_t *create_session_counter = NULL;
+
+static void init_create_session_counter(void)
+{
+  create_session_counter = get_counter_handle("spgw_create_session", NO_LABELS);
+}
+
 //------------------------------------------------------------------------------
 uint32_t sgw_get_new_s1u_teid(spgw_state_t *state)
 {
@@ -95,7 +105,8 @@ int sgw_handle_create_session_request(
   sgw_eps_bearer_ctxt_t *eps_bearer_ctxt_p = NULL;
 
   OAILOG_FUNC_IN(LOG_SPGW_APP);
-  increment_counter("spgw_create_session", 1, NO_LABELS);
+  pthread_once(&create_session_counter_once, init_create_session_counter);
+  counter_handle_increment(create_session_counter, 1);
   OAILOG_INFO(
     LOG_SPGW_APP, "Received S11 CREATE SESSION REQUEST from MME_APP\n");
   /*
@@ -354,10 +365,8 @@ int sgw_handle_sgi_endpoint_created(
     resp_pP->sgw_S1u_teid,
     resp_pP->eps_bearer_id);
 
-  hash_rc = hashtable_ts_get(
-    state->sgw_state.s11_bearer_context_information,
-    resp_pP->context_teid,
-    (void **) &new_bearer_ctxt_info_p);
+  hash_rc = sgw_cm_get_bearer_context_information(
+    state, resp_pP->context_teid, &new_bearer_ctxt_info_p);
 
   message_p =
     itti_alloc_new_message(TASK_SPGW_APP, S11_CREATE_SESSION_RESPONSE);
@@ -484,10 +493,8 @@ int sgw_handle_gtpv1uCreateTunnelResp(
     endpoint_created_pP->eps_bearer_id,
     endpoint_created_pP->status);
 
-  hash_rc = hashtable_ts_get(
-    state->sgw_state.s11_bearer_context_information,
-    endpoint_created_pP->context_teid,
-    (void **) &new_bearer_ctxt_info_p);
+  hash_rc = sgw_cm_get_bearer_context_information(
+    state, endpoint_created_pP->context_teid, &new_bearer_ctxt_info_p);
 
   if (HASH_TABLE_OK == hash_rc) {
     eps_bearer_ctxt_p = sgw_cm_get_eps_bearer_entry(
@@ -740,10 +747,8 @@ int sgw_handle_gtpv1uUpdateTunnelResp(
     endpoint_updated_pP->eps_bearer_id,
     endpoint_updated_pP->status);
 
-  hash_rc = hashtable_ts_get(
-    state->sgw_state.s11_bearer_context_information,
-    endpoint_updated_pP->context_teid,
-    (void **) &new_bearer_ctxt_info_p);
+  hash_rc = sgw_cm_get_bearer_context_information(
+    state, endpoint_updated_pP->context_teid, &new_bearer_ctxt_info_p);
 
   if (HASH_TABLE_OK == hash_rc) {
     eps_bearer_ctxt_p = sgw_cm_get_eps_bearer_entry(
@@ -859,10 +864,8 @@ int sgw_handle_sgi_endpoint_updated(
 
   modify_response_p = &message_p->ittiMsg.s11_modify_bearer_response;
 
-  hash_rc = hashtable_ts_get(
-    state->sgw_state.s11_bearer_context_information,
-    resp_pP->context_teid,
-    (void **) &new_bearer_ctxt_info_p);
+  hash_rc = sgw_cm_get_bearer_context_information(
+    state, resp_pP->context_teid, &new_bearer_ctxt_info_p);
   hash_rc2 = hashtable_ts_get(
     state->sgw_state.s11teid2mme, resp_pP->context_teid, (void **) &tun_pair_p);
 
@@ -1017,10 +1020,8 @@ int sgw_handle_sgi_endpoint_deleted(
     resp_pP->sgw_S1u_teid,
     resp_pP->eps_bearer_id);
 
-  hash_rc = hashtable_ts_get(
-    state->sgw_state.s11_bearer_context_information,
-    resp_pP->context_teid,
-    (void **) &new_bearer_ctxt_info_p);
+  hash_rc = sgw_cm_get_bearer_context_information(
+    state, resp_pP->context_teid, &new_bearer_ctxt_info_p);
 
   if (HASH_TABLE_OK == hash_rc) {
     eps_bearer_ctxt_p = sgw_cm_get_eps_bearer_entry(
@@ -1122,10 +1123,8 @@ int sgw_handle_modify_bearer_request(
     modify_bearer_pP->teid);
   sgw_display_s11teid2mme_mappings(state);
 
-  hash_rc = hashtable_ts_get(
-    state->sgw_state.s11_bearer_context_information,
-    modify_bearer_pP->teid,
-    (void **) &new_bearer_ctxt_info_p);
+  hash_rc = sgw_cm_get_bearer_context_information(
+    state, modify_bearer_pP->teid, &new_bearer_ctxt_info_p);
 
   if (HASH_TABLE_OK == hash_rc) {
     new_bearer_ctxt_info_p->sgw_eps_bearer_context_information.pdn_connection
@@ -1281,10 +1280,8 @@ int sgw_handle_delete_session_request(
       "should be forwarded to P-GW entity\n");
   }
 
-  hash_rc = hashtable_ts_get(
-    state->sgw_state.s11_bearer_context_information,
-    delete_session_req_pP->teid,
-    (void **) &ctx_p);
+  hash_rc = sgw_cm_get_bearer_context_information(
+    state, delete_session_req_pP->teid, &ctx_p);
 
   if (HASH_TABLE_OK == hash_rc) {
     if (
@@ -1435,6 +1432,13 @@ int sgw_handle_delete_session_request(
     delete_session_resp_p->trxn = delete_session_req_pP->trxn;
     delete_session_resp_p->peer_ip.s_addr =
       delete_session_req_pP->peer_ip.s_addr;
+    // The deletion must be durable before the response goes out
+    if (sync_spgw_state() != RETURNok) {
+      OAILOG_ERROR(
+        LOG_SPGW_APP,
+        "Failed to sync state after deleting session for teid %u\n",
+        delete_session_req_pP->teid);
+    }
     rv = itti_send_msg_to_task(TASK_MME, INSTANCE_DEFAULT, message_p);
     OAILOG_FUNC_RETURN(LOG_SPGW_APP, rv);
 
@@ -1520,10 +1524,8 @@ int sgw_handle_release_access_bearers_request(
   release_access_bearers_resp_p =
     &message_p->ittiMsg.s11_release_access_bearers_response;
 
-  hash_rc = hashtable_ts_get(
-    state->sgw_state.s11_bearer_context_information,
-    release_access_bearers_req_pP->teid,
-    (void **) &ctx_p);
+  hash_rc = sgw_cm_get_bearer_context_information(
+    state, release_access_bearers_req_pP->teid, &ctx_p);
 
   if (HASH_TABLE_OK == hash_rc) {
     release_access_bearers_resp_p->cause.cause_value = REQUEST_ACCEPTED;
@@ -1601,10 +1603,8 @@ int sgw_handle_s5_create_bearer_response(
     "status %u\n",
     sgi_create_endpoint_resp.status);
 
-  hashtable_ts_get(
-    state->sgw_state.s11_bearer_context_information,
-    bearer_resp_p->context_teid,
-    (void **) &new_bearer_ctxt_info_p);
+  sgw_cm_get_bearer_context_information(
+    state, bearer_resp_p->context_teid, &new_bearer_ctxt_info_p);
 
   if (bearer_resp_p->failure_cause == S5_OK) {
     switch (sgi_create_endpoint_resp.status) {
@@ -1750,10 +1750,8 @@ int sgw_handle_suspend_notification(
   suspend_acknowledge_p = &message_p->ittiMsg.s11_suspend_acknowledge;
   memset(
     (void *) suspend_acknowledge_p, 0, sizeof(itti_s11_suspend_acknowledge_t));
-  hash_rc = hashtable_ts_get(
-    state->sgw_state.s11_bearer_context_information,
-    suspend_notification_pP->teid,
-    (void **) &ctx_p);
+  hash_rc = sgw_cm_get_bearer_context_information(
+    state, suspend_notification_pP->teid, &ctx_p);
   if (hash_rc == HASH_TABLE_OK) {
     ctx_p->sgw_eps_bearer_context_information.pdn_connection
       .ue_suspended_for_ps_handover = true;
@@ -1821,10 +1819,8 @@ int sgw_no_pcef_create_dedicated_bearer(spgw_state_t *state, s11_teid_t teid)
     *s_plus_p_gw_eps_bearer_ctxt_info_p = NULL;
   hashtable_rc_t hash_rc = HASH_TABLE_OK;
 
-  hash_rc = hashtable_ts_get(
-    state->sgw_state.s11_bearer_context_information,
-    teid,
-    (void **) &s_plus_p_gw_eps_bearer_ctxt_info_p);
+  hash_rc = sgw_cm_get_bearer_context_information(
+    state, teid, &s_plus_p_gw_eps_bearer_ctxt_info_p);
 
   if (HASH_TABLE_OK == hash_rc) {
     MessageDef *message_p =
@@ -1957,10 +1953,8 @@ int sgw_handle_create_bearer_response(
   s_plus_p_gw_eps_bearer_context_information_t *ctx_p = NULL;
   int rv = RETURNok;
 
-  hash_rc = hashtable_ts_get(
-    state->sgw_state.s11_bearer_context_information,
-    create_bearer_response_pP->teid,
-    (void **) &ctx_p);
+  hash_rc = sgw_cm_get_bearer_context_information(
+    state, create_bearer_response_pP->teid, &ctx_p);
 
   if (HASH_TABLE_OK == hash_rc) {
     if (
@@ -2222,10 +2216,8 @@ int sgw_handle_nw_initiated_actv_bearer_rsp(
     s11_actv_bearer_rsp->bearer_contexts.bearer_contexts[msg_bearer_index]
       .eps_bearer_id);
   hashtable_rc_t hash_rc = HASH_TABLE_OK;
-  hash_rc = hashtable_ts_get(
-    state->sgw_state.s11_bearer_context_information,
-    s11_actv_bearer_rsp->sgw_s11_teid,
-    (void **) &spgw_context);
+  hash_rc = sgw_cm_get_bearer_context_information(
+    state, s11_actv_bearer_rsp->sgw_s11_teid, &spgw_context);
   if ((spgw_context == NULL) || (hash_rc != HASH_TABLE_OK)) {
     OAILOG_ERROR(LOG_SPGW_APP, "Error in retrieving s_plus_p_gw context\n");
     OAILOG_FUNC_RETURN(LOG_SPGW_APP, RETURNerror);
@@ -2424,10 +2416,8 @@ int sgw_handle_nw_initiated_deactv_bearer_rsp(
   //--------------------------------------
   // Get EPS bearer entry
   //--------------------------------------
-  hash_rc = hashtable_ts_get(
-    state->sgw_state.s11_bearer_context_information,
-    s11_pcrf_ded_bearer_deactv_rsp->s_gw_teid_s11_s4,
-    (void **) &spgw_ctxt);
+  hash_rc = sgw_cm_get_bearer_context_information(
+    state, s11_pcrf_ded_bearer_deactv_rsp->s_gw_teid_s11_s4, &spgw_ctxt);
   if (HASH_TABLE_OK != hash_rc) {
     OAILOG_ERROR(
       LOG_SPGW_APP,
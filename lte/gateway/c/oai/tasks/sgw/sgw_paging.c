@@ -33,27 +33,63 @@
 #include "itti_types.h"
 #include "s11_messages_types.h"
 
-int sgw_send_paging_request(const struct in_addr *dest_ip)
+static int sgw_send_paging_request(MessageDef *message_p)
 {
-  char *imsi;
-  int ret = get_subscriber_id_from_ipv4(dest_ip, &imsi);
-  if (ret > 0) {
-    char ip_str[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &(dest_ip->s_addr), ip_str, INET_ADDRSTRLEN);
-    OAILOG_ERROR(
-      TASK_SPGW_APP, "Subscriber could not be found for ip %s\n", ip_str);
-    return ret;
+  itti_s11_paging_request_t *paging_request_p =
+    &message_p->ittiMsg.s11_paging_request;
+  uint8_t imsis_number = paging_request_p->imsis_number;
+  char *imsis[S11_PAGING_REQUEST_MAX_IMSIS];
+
+  // ITTI frees the message if it cannot be queued, but not the imsis
+  memcpy(imsis, paging_request_p->imsi, imsis_number * sizeof(char *));
+  int rc = itti_send_msg_to_task(TASK_MME_APP, INSTANCE_DEFAULT, message_p);
+  if (rc != 0) {
+    for (uint8_t i = 0; i < imsis_number; i++) {
+      free(imsis[i]);
+    }
   }
-  OAILOG_DEBUG(TASK_SPGW_APP, "Paging procedure initiated for IMSI%s\n", imsi);
+  return rc;
+}
+
+int sgw_send_paging_requests(
+  const struct in_addr *dest_ips,
+  uint32_t dest_ips_number)
+{
   MessageDef *message_p = NULL;
   itti_s11_paging_request_t *paging_request_p = NULL;
+  int ret = 0;
 
-  message_p = itti_alloc_new_message(TASK_SPGW_APP, S11_PAGING_REQUEST);
-  paging_request_p = &message_p->ittiMsg.s11_paging_request;
-  memset((void *) paging_request_p, 0, sizeof(itti_s11_paging_request_t));
-  paging_request_p->imsi = strdup(imsi);
-  free(imsi);
+  for (uint32_t i = 0; i < dest_ips_number; i++) {
+    char *imsi = NULL;
+    int rc = get_subscriber_id_from_ipv4(&dest_ips[i], &imsi);
+    if (rc != 0 || imsi == NULL) {
+      char ip_str[INET_ADDRSTRLEN];
+      inet_ntop(AF_INET, &(dest_ips[i].s_addr), ip_str, INET_ADDRSTRLEN);
+      OAILOG_ERROR(
+        TASK_SPGW_APP, "Subscriber could not be found for ip %s\n", ip_str);
+      free(imsi);
+      ret = rc ? rc : -1;
+      continue;
+    }
+    OAILOG_DEBUG(
+      TASK_SPGW_APP, "Paging procedure initiated for IMSI%s\n", imsi);
 
-  ret = itti_send_msg_to_task(TASK_MME_APP, INSTANCE_DEFAULT, message_p);
+    if (message_p == NULL) {
+      message_p = itti_alloc_new_message(TASK_SPGW_APP, S11_PAGING_REQUEST);
+      paging_request_p = &message_p->ittiMsg.s11_paging_request;
+      memset((void *) paging_request_p, 0, sizeof(itti_s11_paging_request_t));
+    }
+    // The imsi is handed over to MME, which frees it
+    paging_request_p->imsi[paging_request_p->imsis_number++] = imsi;
+    if (paging_request_p->imsis_number == S11_PAGING_REQUEST_MAX_IMSIS) {
+      rc = sgw_send_paging_request(message_p);
+      ret = rc ? rc : ret;
+      message_p = NULL;
+    }
+  }
+  if (message_p) {
+    int rc = sgw_send_paging_request(message_p);
+    ret = rc ? rc : ret;
+  }
   return ret;
 }
@@ -21,9 +21,17 @@
 #ifndef FILE_SGW_PAGING_SEEN
 #define FILE_SGW_PAGING_SEEN
 #include <netinet/ip.h>
+#include <stdint.h>
 
 struct in_addr;
 
-int sgw_send_paging_request(const struct in_addr *dest_ip);
+/*
+ * Ask MME to page the UEs the given IPs are allocated to, batching up to
+ * S11_PAGING_REQUEST_MAX_IMSIS UEs per S11_PAGING_REQUEST message
+ * @return 0 if all the UEs could be paged
+ */
+int sgw_send_paging_requests(
+  const struct in_addr *dest_ips,
+  uint32_t dest_ips_number);
 
 #endif
@@ -59,12 +59,22 @@ static void sgw_exit(void);
 //------------------------------------------------------------------------------
 static void *sgw_intertask_interface(void *args_p)
 {
+  MessageDef *received_messages[ITTI_RECEIVE_BATCH_MAX];
+  size_t n_received = 0;
+  size_t next_received = 0;
+
+  itti_set_wakeup_coalescing(TASK_SPGW_APP, true);
   itti_mark_task_ready(TASK_SPGW_APP);
   spgw_state_t *spgw_state_p;
 
   while (1) {
     MessageDef *received_message_p = NULL;
-    itti_receive_msg(TASK_SPGW_APP, &received_message_p);
+    if (next_received == n_received) {
+      n_received = itti_receive_msg_batch(
+        TASK_SPGW_APP, received_messages, ITTI_RECEIVE_BATCH_MAX);
+      next_received = 0;
+    }
+    received_message_p = received_messages[next_received++];
 
     spgw_state_p = get_spgw_state(true);
 
@@ -201,11 +211,18 @@ static void *sgw_intertask_interface(void *args_p)
 }
 
 //------------------------------------------------------------------------------
-int sgw_init(spgw_config_t *spgw_config_pP, bool persist_state)
+int sgw_init(
+  spgw_config_t *spgw_config_pP,
+  bool persist_state,
+  bool persist_records,
+  uint32_t write_behind_window_ms)
 {
   OAILOG_DEBUG(LOG_SPGW_APP, "Initializing SPGW-APP  task interface\n");
 
-  if (spgw_state_init(persist_state, spgw_config_pP) < 0) {
+  if (
+    spgw_state_init(
+      persist_state, persist_records, write_behind_window_ms, spgw_config_pP) <
+    0) {
     OAILOG_ALERT(LOG_SPGW_APP, "Error while initializing SGW state\n");
     return RETURNerror;
   }
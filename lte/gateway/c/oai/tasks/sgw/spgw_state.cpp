@@ -34,9 +34,14 @@ extern "C" {
 using magma::lte::SpgwStateManager;
 
 
-int spgw_state_init(bool persist_state, const spgw_config_t* config)
+int spgw_state_init(
+  bool persist_state,
+  bool persist_records,
+  uint32_t write_behind_window_ms,
+  const spgw_config_t* config)
 {
-  SpgwStateManager::getInstance().init(persist_state, config);
+  SpgwStateManager::getInstance().init(
+    persist_state, persist_records, write_behind_window_ms, config);
   return SpgwStateManager::getInstance().read_state_from_db();
 }
 
@@ -55,6 +60,21 @@ void put_spgw_state()
   SpgwStateManager::getInstance().write_state_to_db();
 }
 
+int sync_spgw_state()
+{
+  return SpgwStateManager::getInstance().sync_state_to_db();
+}
+
+void spgw_state_mark_s11_tunnel_dirty(teid_t teid)
+{
+  SpgwStateManager::getInstance().mark_s11_tunnel_dirty(teid);
+}
+
+void spgw_state_mark_bearer_context_dirty(teid_t teid)
+{
+  SpgwStateManager::getInstance().mark_bearer_context_dirty(teid);
+}
+
 void sgw_free_s11_bearer_context_information(
   s_plus_p_gw_eps_bearer_context_information_t** context_p)
 {
@@ -62,13 +62,23 @@ typedef struct spgw_state_s {
 } spgw_state_t;
 
 // Initializes SGW state struct when task process starts.
-int spgw_state_init(bool persist_state, const spgw_config_t* spgw_config_p);
+int spgw_state_init(
+  bool persist_state,
+  bool persist_records,
+  uint32_t write_behind_window_ms,
+  const spgw_config_t* spgw_config_p);
 // Function that frees spgw_state.
 void spgw_state_exit(void);
 // Function that returns a pointer to spgw_state.
 spgw_state_t *get_spgw_state(bool read_from_db);
 // Function that writes the spgw_state struct into db.
 void put_spgw_state(void);
+// Blocks until the spgw_state changes so far are committed to db.
+int sync_spgw_state(void);
+// Marks the S11 tunnel of teid as modified, to be written on next put.
+void spgw_state_mark_s11_tunnel_dirty(teid_t teid);
+// Marks the S11 bearer context of teid as modified, to be written on next put.
+void spgw_state_mark_bearer_context_dirty(teid_t teid);
 
 /**
  * Callback function for s11_bearer_context_information hashtable freefunc
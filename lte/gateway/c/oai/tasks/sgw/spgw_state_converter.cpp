@@ -53,6 +53,17 @@ void SpgwStateConverter::state_to_proto(
   pgw_state_to_proto(&spgw_state->pgw_state, proto->mutable_pgw_state());
 }
 
+void SpgwStateConverter::global_state_to_proto(
+  const spgw_state_t* spgw_state,
+  SpgwState* proto)
+{
+  proto->Clear();
+
+  sgw_global_state_to_proto(
+    &spgw_state->sgw_state, proto->mutable_sgw_state());
+  pgw_state_to_proto(&spgw_state->pgw_state, proto->mutable_pgw_state());
+}
+
 void SpgwStateConverter::proto_to_state(
   const SpgwState& proto,
   spgw_state_t* spgw_state)
@@ -72,6 +83,13 @@ void SpgwStateConverter::sgw_state_to_proto(const sgw_state_t* sgw_state,
   s11bearer_context_ht_to_proto(sgw_state->s11_bearer_context_information,
                                 proto->mutable_s11_bearer_context_info());
 
+  sgw_global_state_to_proto(sgw_state, proto);
+}
+
+void SpgwStateConverter::sgw_global_state_to_proto(
+  const sgw_state_t* sgw_state,
+  SgwState* proto)
+{
   proto->set_sgw_ip_address_s1u_s12_s4_up(
       sgw_state->sgw_ip_address_S1u_S12_S4_up.s_addr);
 
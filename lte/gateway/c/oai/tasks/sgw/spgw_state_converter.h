@@ -69,6 +69,51 @@ class SpgwStateConverter : StateConverter {
     const gateway::spgw::SpgwState& proto,
     spgw_state_t* spgw_state);
 
+  /**
+   * Converts SPGW state to proto, leaving out the S11 tunnel and bearer
+   * context hashtables, which are persisted as separate records
+   * @param spgw_state const pointer to spgw_state struct
+   * @param spgw_proto SpgwState proto object to be written to
+   */
+  static void global_state_to_proto(
+    const spgw_state_t* spgw_state,
+    gateway::spgw::SpgwState* spgw_proto);
+
+  /**
+   * Converts mme sgw tunnel struct to proto, memory is owned by the caller
+   * @param tunnel
+   * @param proto
+   */
+  static void mme_sgw_tunnel_to_proto(const mme_sgw_tunnel_t* tunnel,
+                                      gateway::spgw::MmeSgwTunnel* proto);
+
+  /**
+   * Converts mme proto to sgw tunnel struct
+   * @param proto
+   * @param tunnel
+   */
+  static void proto_to_mme_sgw_tunnel(
+      const gateway::spgw::MmeSgwTunnel &proto,
+      mme_sgw_tunnel_t *tunnel);
+
+  /**
+   * Converts spgw bearer context struct to proto, memory is owned by the caller
+   * @param spgw_bearer_state
+   * @param spgw_bearer_proto
+   */
+  static void spgw_bearer_context_to_proto(
+      const s_plus_p_gw_eps_bearer_context_information_t* spgw_bearer_state,
+      gateway::spgw::S11BearerContext* spgw_bearer_proto);
+
+  /**
+   * Converts proto to spgw bearer context struct
+   * @param spgw_bearer_proto
+   * @param spgw_bearer_state
+   */
+  static void proto_to_spgw_bearer_context(
+      const gateway::spgw::S11BearerContext &spgw_bearer_proto,
+      s_plus_p_gw_eps_bearer_context_information_t *spgw_bearer_state);
+
  private:
   SpgwStateConverter();
   ~SpgwStateConverter();
@@ -81,6 +126,15 @@ class SpgwStateConverter : StateConverter {
   static void sgw_state_to_proto(const sgw_state_t* sgw_state,
                                  gateway::spgw::SgwState* proto);
 
+  /**
+   * Converts the SGW state fields which are not hashtables to proto
+   * @param sgw_state sgw state struct
+   * @param proto object to write to
+   */
+  static void sgw_global_state_to_proto(
+    const sgw_state_t* sgw_state,
+    gateway::spgw::SgwState* proto);
+
   /**
    * Converts SGW proto to stater
    * @param proto object to read from
@@ -128,41 +182,6 @@ class SpgwStateConverter : StateConverter {
       google::protobuf::Map<unsigned int, gateway::spgw::S11BearerContext>*
           proto_map);
 
-  /**
-   * Converts mme sgw tunnel struct to proto, memory is owned by the caller
-   * @param tunnel
-   * @param proto
-   */
-  static void mme_sgw_tunnel_to_proto(const mme_sgw_tunnel_t* tunnel,
-                                      gateway::spgw::MmeSgwTunnel* proto);
-
-  /**
-   * Converts mme proto to sgw tunnel struct
-   * @param proto
-   * @param tunnel
-   */
-  static void proto_to_mme_sgw_tunnel(
-      const gateway::spgw::MmeSgwTunnel &proto,
-      mme_sgw_tunnel_t *tunnel);
-
-  /**
-   * Converts spgw bearer context struct to proto, memory is owned by the caller
-   * @param spgw_bearer_state
-   * @param spgw_bearer_proto
-   */
-  static void spgw_bearer_context_to_proto(
-      const s_plus_p_gw_eps_bearer_context_information_t* spgw_bearer_state,
-      gateway::spgw::S11BearerContext* spgw_bearer_proto);
-
-  /**
-   * Converts proto to spgw bearer context struct
-   * @param spgw_bearer_proto
-   * @param spgw_bearer_state
-   */
-  static void proto_to_spgw_bearer_context(
-      const gateway::spgw::S11BearerContext &spgw_bearer_proto,
-      s_plus_p_gw_eps_bearer_context_information_t *spgw_bearer_state);
-
   /**
    * Converts sgw eps bearer struct to proto, memory is owned by the caller
    * @param eps_bearer
@@ -21,6 +21,9 @@
 
 #include "spgw_state_manager.h"
 
+#include <string.h>
+#include <string>
+
 extern "C" {
 #include <dynamic_memory_check.h>
 }
@@ -46,11 +49,18 @@ SpgwStateManager& SpgwStateManager::getInstance()
   return instance;
 }
 
-void SpgwStateManager::init(bool persist_state, const spgw_config_t* config)
+void SpgwStateManager::init(
+  bool persist_state,
+  bool persist_records,
+  uint32_t write_behind_window_ms,
+  const spgw_config_t* config)
 {
   log_task = LOG_SPGW_APP;
   table_key = SPGW_STATE_TABLE_NAME;
+  records_table_key = SPGW_STATE_RECORDS_TABLE_NAME;
   persist_state_enabled = persist_state;
+  persist_records_enabled = persist_records;
+  this->write_behind_window_ms = write_behind_window_ms;
   config_ = config;
   create_state();
   init_db_connection(LOCALHOST);
@@ -132,5 +142,106 @@ void SpgwStateManager::free_state()
   free(state_cache_p);
 }
 
+void SpgwStateManager::mark_s11_tunnel_dirty(teid_t teid)
+{
+  mark_record_dirty(S11_TUNNEL_RECORD_PREFIX + std::to_string(teid));
+}
+
+void SpgwStateManager::mark_bearer_context_dirty(teid_t teid)
+{
+  mark_record_dirty(S11_BEARER_CONTEXT_RECORD_PREFIX + std::to_string(teid));
+}
+
+void SpgwStateManager::global_state_to_proto(SpgwState* state_proto)
+{
+  SpgwStateConverter::global_state_to_proto(state_cache_p, state_proto);
+}
+
+bool SpgwStateManager::serialize_record(
+  const std::string& record_key,
+  std::string* serialized_record)
+{
+  bool serialized = false;
+  if (record_key.rfind(S11_TUNNEL_RECORD_PREFIX, 0) == 0) {
+    teid_t teid = std::stoul(
+      record_key.substr(strlen(S11_TUNNEL_RECORD_PREFIX)));
+    mme_sgw_tunnel_t* tunnel = nullptr;
+    if (
+      hashtable_ts_get(
+        state_cache_p->sgw_state.s11teid2mme,
+        (const hash_key_t) teid,
+        (void**) &tunnel) != HASH_TABLE_OK) {
+      return false;
+    }
+    MmeSgwTunnel tunnel_proto;
+    SpgwStateConverter::mme_sgw_tunnel_to_proto(tunnel, &tunnel_proto);
+    serialized = tunnel_proto.SerializeToString(serialized_record);
+  } else if (record_key.rfind(S11_BEARER_CONTEXT_RECORD_PREFIX, 0) == 0) {
+    teid_t teid = std::stoul(
+      record_key.substr(strlen(S11_BEARER_CONTEXT_RECORD_PREFIX)));
+    s_plus_p_gw_eps_bearer_context_information_t* bearer_context = nullptr;
+    if (
+      hashtable_ts_get(
+        state_cache_p->sgw_state.s11_bearer_context_information,
+        (const hash_key_t) teid,
+        (void**) &bearer_context) != HASH_TABLE_OK) {
+      return false;
+    }
+    S11BearerContext bearer_context_proto;
+    SpgwStateConverter::spgw_bearer_context_to_proto(
+      bearer_context, &bearer_context_proto);
+    serialized = bearer_context_proto.SerializeToString(serialized_record);
+  } else {
+    OAILOG_ERROR(log_task, "Unknown SPGW record %s", record_key.c_str());
+    return false;
+  }
+  AssertFatal(serialized, "Failed to serialize SPGW record");
+  return true;
+}
+
+void SpgwStateManager::deserialize_record(
+  const std::string& record_key,
+  const std::string& serialized_record)
+{
+  hash_table_ts_t* state_ht = nullptr;
+  void* node = nullptr;
+  teid_t teid;
+  if (record_key.rfind(S11_TUNNEL_RECORD_PREFIX, 0) == 0) {
+    MmeSgwTunnel tunnel_proto;
+    if (!tunnel_proto.ParseFromString(serialized_record)) {
+      OAILOG_ERROR(log_task, "Failed to parse record %s", record_key.c_str());
+      return;
+    }
+    teid = std::stoul(record_key.substr(strlen(S11_TUNNEL_RECORD_PREFIX)));
+    auto tunnel = (mme_sgw_tunnel_t*) calloc(1, sizeof(mme_sgw_tunnel_t));
+    SpgwStateConverter::proto_to_mme_sgw_tunnel(tunnel_proto, tunnel);
+    state_ht = state_cache_p->sgw_state.s11teid2mme;
+    node = tunnel;
+  } else if (record_key.rfind(S11_BEARER_CONTEXT_RECORD_PREFIX, 0) == 0) {
+    S11BearerContext bearer_context_proto;
+    if (!bearer_context_proto.ParseFromString(serialized_record)) {
+      OAILOG_ERROR(log_task, "Failed to parse record %s", record_key.c_str());
+      return;
+    }
+    teid = std::stoul(
+      record_key.substr(strlen(S11_BEARER_CONTEXT_RECORD_PREFIX)));
+    auto bearer_context = (s_plus_p_gw_eps_bearer_context_information_t*)
+      calloc(1, sizeof(s_plus_p_gw_eps_bearer_context_information_t));
+    SpgwStateConverter::proto_to_spgw_bearer_context(
+      bearer_context_proto, bearer_context);
+    state_ht = state_cache_p->sgw_state.s11_bearer_context_information;
+    node = bearer_context;
+  } else {
+    OAILOG_ERROR(log_task, "Unknown SPGW record %s", record_key.c_str());
+    return;
+  }
+
+  if (
+    hashtable_ts_insert(state_ht, (const hash_key_t) teid, node) !=
+    HASH_TABLE_OK) {
+    OAILOG_ERROR(log_task, "Failed to insert record %s", record_key.c_str());
+  }
+}
+
 } // namespace lte
 } // namespace magma
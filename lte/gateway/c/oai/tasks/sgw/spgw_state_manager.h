@@ -32,8 +32,13 @@ constexpr char SGW_S11_TEID_MME_HT_NAME[] = "sgw_s11_teid2mme_htbl";
 constexpr char S11_BEARER_CONTEXT_INFO_HT_NAME[] =
   "s11_bearer_context_information_htbl";
 constexpr char SPGW_STATE_TABLE_NAME[] = "spgw_state";
+constexpr char SPGW_STATE_RECORDS_TABLE_NAME[] = "spgw_state_records";
+constexpr char S11_TUNNEL_RECORD_PREFIX[] = "tunnel:";
+constexpr char S11_BEARER_CONTEXT_RECORD_PREFIX[] = "bearer:";
 } // namespace
 
+using magma::lte::gateway::spgw::MmeSgwTunnel;
+using magma::lte::gateway::spgw::S11BearerContext;
 using magma::lte::gateway::spgw::SpgwState;
 
 namespace magma {
@@ -56,9 +61,29 @@ class SpgwStateManager :
   /**
    * Initialization function to initialize member variables.
    * @param persist_state should read and write state from db
+   * @param persist_records persists each S11 tunnel and bearer context as a
+   * separate record, only writing the modified ones to db
+   * @param write_behind_window_ms coalescing window of the write-behind
+   * flusher, writes are synchronous when 0
    * @param config SPGW config struct
    */
-  void init(bool persist_state, const spgw_config_t* config);
+  void init(
+    bool persist_state,
+    bool persist_records,
+    uint32_t write_behind_window_ms,
+    const spgw_config_t* config);
+
+  /**
+   * Marks the S11 tunnel of teid as modified
+   * @param teid local S11 teid of the tunnel
+   */
+  void mark_s11_tunnel_dirty(teid_t teid);
+
+  /**
+   * Marks the S11 bearer context of teid as modified
+   * @param teid local S11 teid of the bearer context
+   */
+  void mark_bearer_context_dirty(teid_t teid);
 
   /**
    * Singleton class, copy constructor and assignment operator are marked
@@ -83,6 +108,16 @@ class SpgwStateManager :
    */
   void create_state() override;
 
+  void global_state_to_proto(SpgwState* state_proto) override;
+
+  bool serialize_record(
+    const std::string& record_key,
+    std::string* serialized_record) override;
+
+  void deserialize_record(
+    const std::string& record_key,
+    const std::string& serialized_record) override;
+
   const spgw_config_t* config_;
 };
 
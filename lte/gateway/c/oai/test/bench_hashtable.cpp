@@ -0,0 +1,636 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*
+ * Measures insert, get, remove and iteration over 1k to 1M keys on the open
+ * addressing hashtables against the chained hashtables they replaced. Integer
+ * keys follow the patterns the MME uses: IMSI64 of a single PLMN, TEIDs
+ * handed out in sequence and enb_ue_s1ap_ids spread over eNBs. Object keys
+ * are IMSI strings. Tables are sized for all their keys at init, as the MME
+ * sizes them from its config. The process fails if an operation returned a
+ * wrong result.
+ *    hashtable_bench [--benchmark_filter=<regex>]
+ */
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+extern "C" {
+#include "bstrlib.h"
+#include "hashtable.h"
+#include "obj_hashtable.h"
+}
+
+namespace {
+
+enum KeyPattern { IMSI64, TEID, ENB_UE_S1AP_ID, KEY_PATTERNS };
+
+// Operations which returned a wrong result, fail the process
+long wrong_results = 0;
+
+hash_key_t integer_key(int pattern, long i)
+{
+  switch (pattern) {
+    case IMSI64: return 310150000000000ULL + (hash_key_t) i;
+    case TEID: return (hash_key_t) i + 1;
+    default:
+      // enb_s1ap_id_key layout, eNB id above the 24 bit enb_ue_s1ap_id
+      return ((hash_key_t)(i % 256) << 24) | (hash_key_t)(i / 256);
+  }
+}
+
+hash_size_t round_up_power_of_two(hash_size_t size)
+{
+  hash_size_t rounded = 1;
+  while (rounded < size) {
+    rounded <<= 1;
+  }
+  return rounded;
+}
+
+/*
+ * The chained hashtable_ts replaced by the open addressing one, reduced to
+ * what is measured: a fixed bucket array sized at init, a mutex per bucket,
+ * a node allocated per element and the key itself as hash.
+ */
+class LegacyTable {
+ public:
+  typedef hash_key_t Key;
+
+  explicit LegacyTable(hash_size_t size):
+    size_(round_up_power_of_two(size)),
+    nodes_(size_, nullptr),
+    locks_(size_)
+  {
+    for (auto& lock : locks_) {
+      pthread_mutex_init(&lock, nullptr);
+    }
+  }
+
+  ~LegacyTable()
+  {
+    for (hash_size_t i = 0; i < size_; i++) {
+      while (nodes_[i]) {
+        Node* next = nodes_[i]->next;
+        free(nodes_[i]);
+        nodes_[i] = next;
+      }
+      pthread_mutex_destroy(&locks_[i]);
+    }
+  }
+
+  static Key make_key(int pattern, long i) { return integer_key(pattern, i); }
+
+  bool insert(Key key, void* data)
+  {
+    hash_size_t hash = key % size_;
+    pthread_mutex_lock(&locks_[hash]);
+    for (Node* node = nodes_[hash]; node; node = node->next) {
+      if (node->key == key) {
+        node->data = data;
+        pthread_mutex_unlock(&locks_[hash]);
+        return true;
+      }
+    }
+    Node* node = (Node*) malloc(sizeof(Node));
+    node->key = key;
+    node->data = data;
+    node->next = nodes_[hash];
+    nodes_[hash] = node;
+    __sync_fetch_and_add(&num_elements_, 1);
+    pthread_mutex_unlock(&locks_[hash]);
+    return true;
+  }
+
+  bool get(Key key, void** data)
+  {
+    hash_size_t hash = key % size_;
+    pthread_mutex_lock(&locks_[hash]);
+    for (Node* node = nodes_[hash]; node; node = node->next) {
+      if (node->key == key) {
+        *data = node->data;
+        pthread_mutex_unlock(&locks_[hash]);
+        return true;
+      }
+    }
+    pthread_mutex_unlock(&locks_[hash]);
+    return false;
+  }
+
+  bool remove(Key key)
+  {
+    hash_size_t hash = key % size_;
+    pthread_mutex_lock(&locks_[hash]);
+    for (Node **prev = &nodes_[hash], *node = *prev; node;
+         prev = &node->next, node = node->next) {
+      if (node->key == key) {
+        *prev = node->next;
+        free(node);
+        __sync_fetch_and_sub(&num_elements_, 1);
+        pthread_mutex_unlock(&locks_[hash]);
+        return true;
+      }
+    }
+    pthread_mutex_unlock(&locks_[hash]);
+    return false;
+  }
+
+  // Walks the buckets like hashtable_ts_apply_callback_on_elements did
+  long iterate()
+  {
+    long visited = 0;
+    for (hash_size_t i = 0; i < size_ && visited < (long) num_elements_; i++) {
+      pthread_mutex_lock(&locks_[i]);
+      for (Node* node = nodes_[i]; node; node = node->next) {
+        benchmark::DoNotOptimize(node->data);
+        visited++;
+      }
+      pthread_mutex_unlock(&locks_[i]);
+    }
+    return visited;
+  }
+
+ private:
+  struct Node {
+    hash_key_t key;
+    void* data;
+    Node* next;
+  };
+  hash_size_t size_;
+  hash_size_t num_elements_ = 0;
+  std::vector<Node*> nodes_;
+  std::vector<pthread_mutex_t> locks_;
+};
+
+/*
+ * The chained obj_hashtable_ts replaced by the open addressing one, reduced
+ * like LegacyTable, with its copied keys and its XOR of the key bytes as hash
+ */
+class LegacyObjTable {
+ public:
+  typedef std::string Key;
+
+  explicit LegacyObjTable(hash_size_t size):
+    size_(round_up_power_of_two(size)),
+    nodes_(size_, nullptr),
+    locks_(size_)
+  {
+    for (auto& lock : locks_) {
+      pthread_mutex_init(&lock, nullptr);
+    }
+  }
+
+  ~LegacyObjTable()
+  {
+    for (hash_size_t i = 0; i < size_; i++) {
+      while (nodes_[i]) {
+        Node* next = nodes_[i]->next;
+        free(nodes_[i]->key);
+        free(nodes_[i]);
+        nodes_[i] = next;
+      }
+      pthread_mutex_destroy(&locks_[i]);
+    }
+  }
+
+  static Key make_key(int, long i)
+  {
+    return std::to_string(310150000000000 + i);
+  }
+
+  bool insert(const Key& key, void* data)
+  {
+    hash_size_t hash = hash_bytes(key) % size_;
+    pthread_mutex_lock(&locks_[hash]);
+    Node* node = find(hash, key);
+    if (node) {
+      node->data = data;
+      pthread_mutex_unlock(&locks_[hash]);
+      return true;
+    }
+    node = (Node*) calloc(1, sizeof(Node));
+    node->key = calloc(1, key.size());
+    memcpy(node->key, key.data(), key.size());
+    node->key_size = key.size();
+    node->data = data;
+    node->next = nodes_[hash];
+    nodes_[hash] = node;
+    __sync_fetch_and_add(&num_elements_, 1);
+    pthread_mutex_unlock(&locks_[hash]);
+    return true;
+  }
+
+  bool get(const Key& key, void** data)
+  {
+    hash_size_t hash = hash_bytes(key) % size_;
+    pthread_mutex_lock(&locks_[hash]);
+    Node* node = find(hash, key);
+    if (node) {
+      *data = node->data;
+    }
+    pthread_mutex_unlock(&locks_[hash]);
+    return node != nullptr;
+  }
+
+  bool remove(const Key& key)
+  {
+    hash_size_t hash = hash_bytes(key) % size_;
+    pthread_mutex_lock(&locks_[hash]);
+    for (Node **prev = &nodes_[hash], *node = *prev; node;
+         prev = &node->next, node = node->next) {
+      if (
+        node->key_size == (int) key.size() &&
+        memcmp(node->key, key.data(), key.size()) == 0) {
+        *prev = node->next;
+        free(node->key);
+        free(node);
+        __sync_fetch_and_sub(&num_elements_, 1);
+        pthread_mutex_unlock(&locks_[hash]);
+        return true;
+      }
+    }
+    pthread_mutex_unlock(&locks_[hash]);
+    return false;
+  }
+
+  // Walks the buckets like obj_hashtable_ts_get_keys did
+  long iterate()
+  {
+    long visited = 0;
+    for (hash_size_t i = 0; i < size_; i++) {
+      pthread_mutex_lock(&locks_[i]);
+      for (Node* node = nodes_[i]; node; node = node->next) {
+        benchmark::DoNotOptimize(node->key);
+        visited++;
+      }
+      pthread_mutex_unlock(&locks_[i]);
+    }
+    return visited;
+  }
+
+ private:
+  struct Node {
+    int key_size;
+    void* key;
+    void* data;
+    Node* next;
+  };
+
+  static hash_size_t hash_bytes(const Key& key)
+  {
+    hash_size_t hash = 0;
+    int key_size = key.size();
+    while (key_size > 0) {
+      uint32_t val = 0;
+      for (int size = sizeof(val); size > 0 && key_size > 0; size--) {
+        val = (val << 8) | (uint8_t) key[--key_size];
+      }
+      hash ^= val;
+    }
+    return hash;
+  }
+
+  Node* find(hash_size_t hash, const Key& key)
+  {
+    for (Node* node = nodes_[hash]; node; node = node->next) {
+      if (
+        node->key_size == (int) key.size() &&
+        memcmp(node->key, key.data(), key.size()) == 0) {
+        return node;
+      }
+    }
+    return nullptr;
+  }
+
+  hash_size_t size_;
+  hash_size_t num_elements_ = 0;
+  std::vector<Node*> nodes_;
+  std::vector<pthread_mutex_t> locks_;
+};
+
+bool count_element_cb(
+  const hash_key_t key,
+  void* const element,
+  void* parameter,
+  void** result)
+{
+  benchmark::DoNotOptimize(element);
+  (*(long*) parameter)++;
+  return false;
+}
+
+bool count_uint64_element_cb(
+  const hash_key_t key,
+  const uint64_t element,
+  void* parameter,
+  void** result)
+{
+  benchmark::DoNotOptimize(element);
+  (*(long*) parameter)++;
+  return false;
+}
+
+template<bool single_owner>
+class Table {
+ public:
+  typedef hash_key_t Key;
+
+  explicit Table(hash_size_t size)
+  {
+    hashtable_ts_init(&table_, size, nullptr, hash_free_int_func, nullptr);
+    hashtable_ts_set_single_owner(&table_, single_owner);
+  }
+
+  ~Table() { hashtable_ts_destroy(&table_); }
+
+  static Key make_key(int pattern, long i) { return integer_key(pattern, i); }
+
+  bool insert(Key key, void* data)
+  {
+    return hashtable_ts_insert(&table_, key, data) == HASH_TABLE_OK;
+  }
+
+  bool get(Key key, void** data)
+  {
+    return hashtable_ts_get(&table_, key, data) == HASH_TABLE_OK;
+  }
+
+  bool remove(Key key)
+  {
+    void* data;
+    return hashtable_ts_remove(&table_, key, &data) == HASH_TABLE_OK;
+  }
+
+  long iterate()
+  {
+    long visited = 0;
+    hashtable_ts_apply_callback_on_elements(
+      &table_, count_element_cb, &visited, nullptr);
+    return visited;
+  }
+
+ private:
+  hash_table_ts_t table_;
+};
+
+class Uint64Table {
+ public:
+  typedef hash_key_t Key;
+
+  explicit Uint64Table(hash_size_t size)
+  {
+    hashtable_uint64_ts_init(&table_, size, nullptr, nullptr);
+  }
+
+  ~Uint64Table() { hashtable_uint64_ts_destroy(&table_); }
+
+  static Key make_key(int pattern, long i) { return integer_key(pattern, i); }
+
+  bool insert(Key key, void* data)
+  {
+    return hashtable_uint64_ts_insert(&table_, key, (uintptr_t) data) ==
+           HASH_TABLE_OK;
+  }
+
+  bool get(Key key, void** data)
+  {
+    uint64_t value;
+    hashtable_rc_t rc = hashtable_uint64_ts_get(&table_, key, &value);
+    *data = (void*) (uintptr_t) value;
+    return rc == HASH_TABLE_OK;
+  }
+
+  bool remove(Key key)
+  {
+    return hashtable_uint64_ts_free(&table_, key) == HASH_TABLE_OK;
+  }
+
+  long iterate()
+  {
+    long visited = 0;
+    hashtable_uint64_ts_apply_callback_on_elements(
+      &table_, count_uint64_element_cb, &visited, nullptr);
+    return visited;
+  }
+
+ private:
+  hash_table_uint64_ts_t table_;
+};
+
+class ObjTable {
+ public:
+  typedef std::string Key;
+
+  // obj_hashtable_ts_destroy releases the table itself
+  explicit ObjTable(hash_size_t size):
+    table_(obj_hashtable_ts_create(
+      size, nullptr, nullptr, hash_free_int_func, nullptr))
+  {
+  }
+
+  ~ObjTable() { obj_hashtable_ts_destroy(table_); }
+
+  static Key make_key(int, long i)
+  {
+    return std::to_string(310150000000000 + i);
+  }
+
+  bool insert(const Key& key, void* data)
+  {
+    return obj_hashtable_ts_insert(table_, key.data(), key.size(), data) ==
+           HASH_TABLE_OK;
+  }
+
+  bool get(const Key& key, void** data)
+  {
+    return obj_hashtable_ts_get(table_, key.data(), key.size(), data) ==
+           HASH_TABLE_OK;
+  }
+
+  bool remove(const Key& key)
+  {
+    void* data;
+    return obj_hashtable_ts_remove(
+             table_, key.data(), key.size(), &data) == HASH_TABLE_OK;
+  }
+
+  long iterate()
+  {
+    unsigned int num_keys;
+    obj_hashtable_ts_get_keys(table_, nullptr, &num_keys);
+    keys_.resize(num_keys);
+    obj_hashtable_ts_get_keys(table_, keys_.data(), &num_keys);
+    return num_keys;
+  }
+
+ private:
+  obj_hash_table_t* table_;
+  std::vector<void*> keys_;
+};
+
+template<typename T>
+std::vector<typename T::Key> make_keys(const benchmark::State& state)
+{
+  std::vector<typename T::Key> keys;
+  keys.reserve(state.range(0));
+  for (long i = 0; i < state.range(0); i++) {
+    keys.push_back(T::make_key(state.range(1), i));
+  }
+  return keys;
+}
+
+template<typename T>
+void fill(T* table, const std::vector<typename T::Key>& keys)
+{
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (!table->insert(keys[i], (void*) (uintptr_t) i)) {
+      wrong_results++;
+    }
+  }
+}
+
+template<typename T>
+void BM_Insert(benchmark::State& state)
+{
+  auto keys = make_keys<T>(state);
+  for (auto _ : state) {
+    state.PauseTiming();
+    T* table = new T(keys.size());
+    state.ResumeTiming();
+    fill(table, keys);
+    state.PauseTiming();
+    delete table;
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+template<typename T>
+void BM_Get(benchmark::State& state)
+{
+  auto keys = make_keys<T>(state);
+  T table(keys.size());
+  fill(&table, keys);
+  for (auto _ : state) {
+    // Prime stride, lookups don't follow the insertion order
+    for (size_t n = 0; n < keys.size(); n++) {
+      size_t i = (n * 7919) % keys.size();
+      void* data;
+      if (!table.get(keys[i], &data) || (uintptr_t) data != i) {
+        wrong_results++;
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+template<typename T>
+void BM_Remove(benchmark::State& state)
+{
+  auto keys = make_keys<T>(state);
+  for (auto _ : state) {
+    state.PauseTiming();
+    T* table = new T(keys.size());
+    fill(table, keys);
+    state.ResumeTiming();
+    for (const auto& key : keys) {
+      if (!table->remove(key)) {
+        wrong_results++;
+      }
+    }
+    state.PauseTiming();
+    delete table;
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+template<typename T>
+void BM_Iterate(benchmark::State& state)
+{
+  auto keys = make_keys<T>(state);
+  T table(keys.size());
+  fill(&table, keys);
+  for (auto _ : state) {
+    if (table.iterate() != (long) keys.size()) {
+      wrong_results++;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+void integer_key_args(benchmark::internal::Benchmark* bench)
+{
+  bench->ArgNames({"keys", "pattern"});
+  for (long keys = 1000; keys <= 1000000; keys *= 10) {
+    for (int pattern = IMSI64; pattern < KEY_PATTERNS; pattern++) {
+      bench->Args({keys, pattern});
+    }
+  }
+}
+
+void object_key_args(benchmark::internal::Benchmark* bench)
+{
+  bench->ArgNames({"keys", "pattern"});
+  for (long keys = 1000; keys <= 1000000; keys *= 10) {
+    bench->Args({keys, 0});
+  }
+}
+
+typedef Table<false> LockedTable;
+typedef Table<true> SingleOwnerTable;
+
+#define HASHTABLE_BENCHMARKS(T, args)                                          \
+  BENCHMARK_TEMPLATE(BM_Insert, T)->Apply(args);                               \
+  BENCHMARK_TEMPLATE(BM_Get, T)->Apply(args);                                  \
+  BENCHMARK_TEMPLATE(BM_Remove, T)->Apply(args);                               \
+  BENCHMARK_TEMPLATE(BM_Iterate, T)->Apply(args)
+
+HASHTABLE_BENCHMARKS(LegacyTable, integer_key_args);
+HASHTABLE_BENCHMARKS(LockedTable, integer_key_args);
+HASHTABLE_BENCHMARKS(SingleOwnerTable, integer_key_args);
+HASHTABLE_BENCHMARKS(Uint64Table, integer_key_args);
+HASHTABLE_BENCHMARKS(LegacyObjTable, object_key_args);
+HASHTABLE_BENCHMARKS(ObjTable, object_key_args);
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return EXIT_FAILURE;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  if (wrong_results) {
+    printf("%ld operations returned a wrong result\n", wrong_results);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,190 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*
+ * Measures put_mme_nas_state after a message that touched a few UEs, through
+ * MmeNasStateManager and its redis client, in the three persistence modes:
+ * the whole state blob (USE_STATELESS), the MME-global state and the dirty UE
+ * contexts (USE_STATELESS_PER_UE), and the latter with the write-behind
+ * flusher. Redis is replaced by an in-memory server listening on the redis
+ * port of the gateway config, so redis must not be running. Every mode runs
+ * in its own process, as the state manager is a singleton.
+ *    mme_nas_state_bench [UEs] [dirty UEs per write] [writes]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+
+extern "C" {
+#include "mme_app_state.h"
+#include "mme_app_ue_context.h"
+#include "mme_config.h"
+}
+
+#include "ServiceConfigLoader.h"
+#include "in_memory_redis.h"
+
+namespace {
+const char* MME_NAS_STATE_KEY = "mme_nas_state";
+const char* MME_NAS_UE_STATE_KEY = "mme_nas_ue_state";
+// Write-behind window of the flusher mode
+const uint32_t WRITE_BEHIND_WINDOW_MS = 1;
+} // namespace
+
+using magma::lte::InMemoryRedis;
+
+typedef enum {
+  WHOLE_STATE,
+  PER_UE,
+  PER_UE_WRITE_BEHIND,
+} persist_mode_t;
+
+static const char* mode_names[] = {
+  "whole state", "dirty UEs only", "dirty UEs write-behind"};
+
+static void add_ue_contexts(mme_app_desc_t* state, int ues)
+{
+  for (int i = 0; i < ues; i++) {
+    ue_mm_context_t* ue_context = mme_create_new_ue_context();
+    ue_context->enb_ue_s1ap_id = i;
+    ue_context->enb_s1ap_id_key = i;
+    ue_context->mme_ue_s1ap_id = i + 1;
+    ue_context->mme_teid_s11 = i + 1;
+    ue_context->emm_context._imsi64 = 1010000000000 + i;
+    mme_insert_ue_context(&state->mme_ue_contexts, ue_context);
+    unlock_ue_contexts(ue_context);
+    mme_nas_state_mark_ue_dirty(ue_context->mme_ue_s1ap_id);
+  }
+}
+
+/*
+ * Runs the writes of one mode in the calling process and checks what landed
+ * in the in-memory redis
+ * @return exit status of the mode
+ */
+static int run(
+  persist_mode_t mode,
+  uint16_t port,
+  int ues,
+  int dirty,
+  int writes)
+{
+  InMemoryRedis redis;
+  if (!redis.start(port)) {
+    fprintf(stderr, "Cannot listen on redis port %u, stop redis first\n", port);
+    return EXIT_FAILURE;
+  }
+  mme_config.max_ues = ues;
+  mme_config.use_stateless = true;
+  mme_config.use_stateless_per_ue = mode != WHOLE_STATE;
+  mme_config.state_write_behind_window_ms =
+    mode == PER_UE_WRITE_BEHIND ? WRITE_BEHIND_WINDOW_MS : 0;
+  if (mme_nas_state_init(&mme_config) != RETURNok) {
+    return EXIT_FAILURE;
+  }
+  mme_app_desc_t* state = get_locked_mme_nas_state(false);
+  add_ue_contexts(state, ues);
+  put_mme_nas_state(&state);
+  state = get_locked_mme_nas_state(false);
+  mme_nas_state_sync_to_db();
+  put_mme_nas_state(&state);
+
+  int touched_ues = 0;
+  size_t start_bytes = redis.received_bytes();
+  auto start = std::chrono::steady_clock::now();
+  for (int write = 0; write < writes; write++) {
+    state = get_locked_mme_nas_state(false);
+    // A message locks the UE contexts it handles, which marks them dirty
+    for (int i = 0; i < dirty; i++) {
+      mme_ue_s1ap_id_t mme_ue_s1ap_id = (write * dirty + i) % ues + 1;
+      ue_mm_context_t* ue_context = mme_ue_context_exists_mme_ue_s1ap_id(
+        &state->mme_ue_contexts, mme_ue_s1ap_id);
+      if (ue_context) {
+        ue_context->mme_teid_s11 = write;
+        unlock_ue_contexts(ue_context);
+        touched_ues++;
+      }
+    }
+    put_mme_nas_state(&state);
+  }
+  // Write-behind writes are only done once committed
+  state = get_locked_mme_nas_state(false);
+  int rc = mme_nas_state_sync_to_db();
+  put_mme_nas_state(&state);
+  std::chrono::duration<double, std::micro> elapsed =
+    std::chrono::steady_clock::now() - start;
+
+  printf(
+    "%-22s: %8.1f usec/write, %9.0f bytes/write to redis\n",
+    mode_names[mode],
+    elapsed.count() / writes,
+    (double) (redis.received_bytes() - start_bytes) / writes);
+
+  // Every UE context must be in redis, as a record or in the blob
+  bool stored = mode == WHOLE_STATE ?
+                  redis.has_key(MME_NAS_STATE_KEY) :
+                  redis.hash_size(MME_NAS_UE_STATE_KEY) == (size_t) ues;
+  if (rc != RETURNok || !stored || touched_ues != writes * dirty) {
+    printf(
+      "%s: sync rc %d, %d of %d UE contexts touched, state %s in redis\n",
+      mode_names[mode],
+      rc,
+      touched_ues,
+      writes * dirty,
+      stored ? "complete" : "incomplete");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv)
+{
+  int ues = argc > 1 ? atoi(argv[1]) : 10000;
+  int dirty = argc > 2 ? atoi(argv[2]) : 4;
+  int writes = argc > 3 ? atoi(argv[3]) : 100;
+
+  if (ues < 1 || dirty < 1 || dirty > ues || writes < 1) {
+    fprintf(stderr, "mme_nas_state_bench [UEs] [dirty UEs] [writes]\n");
+    return EXIT_FAILURE;
+  }
+  magma::ServiceConfigLoader loader;
+  uint16_t port = loader.load_service_config("redis")["port"].as<uint32_t>();
+
+  int exit_status = EXIT_SUCCESS;
+  for (int mode = WHOLE_STATE; mode <= PER_UE_WRITE_BEHIND; mode++) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+      exit(run((persist_mode_t) mode, port, ues, dirty, writes));
+    }
+    int status;
+    if (
+      pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != EXIT_SUCCESS) {
+      exit_status = EXIT_FAILURE;
+    }
+  }
+  printf("%d UEs, %d dirty UEs per write\n", ues, dirty);
+  return exit_status;
+}
@@ -0,0 +1,159 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*
+ * Measures the NAS messages/sec of each security algorithm, for message
+ * sizes from a NAS header to an attach accept. EEA2 and EIA2 run with the
+ * per UE key cache of emm_security_context_t and without it, which expands
+ * the AES key for every message.
+ *    nas_stream_cipher_bench [messages]
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "secu_defs.h"
+
+#define MESSAGE_SIZE_MAX 256
+
+typedef int (*nas_stream_function_t)(
+  nas_stream_cipher_t *const stream_cipher,
+  uint8_t *const out);
+
+static const size_t message_sizes[] = {8, 64, 256};
+
+/* The integrity functions write the 4 byte MAC to out */
+static int eia1(nas_stream_cipher_t *const stream_cipher, uint8_t *const out)
+{
+  return nas_stream_encrypt_eia1(stream_cipher, out);
+}
+
+static int eia2(nas_stream_cipher_t *const stream_cipher, uint8_t *const out)
+{
+  return nas_stream_encrypt_eia2(stream_cipher, out);
+}
+
+static double elapsed_sec(const struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static double messages_per_sec(
+  nas_stream_function_t function,
+  nas_stream_cipher_t *stream_cipher,
+  long messages)
+{
+  uint8_t out[MESSAGE_SIZE_MAX];
+  struct timespec start;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (long i = 0; i < messages; i++) {
+    stream_cipher->count = i;
+    function(stream_cipher, out);
+  }
+  return messages / elapsed_sec(&start);
+}
+
+/* Ciphering the ciphered message again must give back the message */
+static bool check_round_trip(
+  nas_stream_function_t function,
+  nas_stream_cipher_t *stream_cipher,
+  size_t size)
+{
+  uint8_t *message = stream_cipher->message;
+  uint8_t ciphered[MESSAGE_SIZE_MAX];
+  uint8_t deciphered[MESSAGE_SIZE_MAX];
+
+  function(stream_cipher, ciphered);
+  stream_cipher->message = ciphered;
+  function(stream_cipher, deciphered);
+  stream_cipher->message = message;
+  return memcmp(deciphered, message, size) == 0 &&
+         memcmp(ciphered, message, size) != 0;
+}
+
+int main(int argc, char **argv)
+{
+  long messages = argc > 1 ? atol(argv[1]) : 200000;
+  uint8_t key[16];
+  uint8_t message[MESSAGE_SIZE_MAX];
+  uint8_t mac[4];
+  uint8_t cached_mac[4];
+  nas_aes128_key_t key_cache = {0};
+  bool ok = true;
+
+  if (messages < 1) {
+    fprintf(stderr, "nas_stream_cipher_bench [messages]\n");
+    return EXIT_FAILURE;
+  }
+  for (size_t i = 0; i < sizeof(key); i++) {
+    key[i] = i * 17 + 3;
+  }
+  for (size_t i = 0; i < sizeof(message); i++) {
+    message[i] = i * 31 + 7;
+  }
+
+  for (size_t i = 0; i < sizeof(message_sizes) / sizeof(message_sizes[0]);
+       i++) {
+    size_t size = message_sizes[i];
+    nas_stream_cipher_t stream_cipher = {0};
+    nas_stream_cipher_t cached_stream_cipher;
+
+    stream_cipher.key = key;
+    stream_cipher.key_length = sizeof(key);
+    stream_cipher.bearer = 0;
+    stream_cipher.direction = 1;
+    stream_cipher.message = message;
+    stream_cipher.blength = size * 8;
+    cached_stream_cipher = stream_cipher;
+    cached_stream_cipher.key_cache = &key_cache;
+
+    printf(
+      "%3zu bytes: EEA1 %8.0f  EIA1 %8.0f  EEA2 %8.0f (uncached %8.0f)  "
+      "EIA2 %8.0f (uncached %8.0f) msg/s\n",
+      size,
+      messages_per_sec(nas_stream_encrypt_eea1, &stream_cipher, messages),
+      messages_per_sec(eia1, &stream_cipher, messages),
+      messages_per_sec(
+        nas_stream_encrypt_eea2, &cached_stream_cipher, messages),
+      messages_per_sec(nas_stream_encrypt_eea2, &stream_cipher, messages),
+      messages_per_sec(eia2, &cached_stream_cipher, messages),
+      messages_per_sec(eia2, &stream_cipher, messages));
+
+    ok &= check_round_trip(nas_stream_encrypt_eea1, &stream_cipher, size);
+    ok &= check_round_trip(
+      nas_stream_encrypt_eea2, &cached_stream_cipher, size);
+    nas_stream_encrypt_eia2(&stream_cipher, mac);
+    nas_stream_encrypt_eia2(&cached_stream_cipher, cached_mac);
+    ok &= memcmp(mac, cached_mac, sizeof(mac)) == 0;
+  }
+  if (!ok) {
+    printf("ciphering or integrity check results do not match\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
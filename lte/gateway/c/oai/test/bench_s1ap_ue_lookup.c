@@ -0,0 +1,165 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*
+ * Measures looking up S1AP UE descriptions by mme_ue_s1ap_id, as every
+ * downlink NAS transport and UE context release does: the mmeid2ue index
+ * behind s1ap_state_get_ue_mmeid() against walking the ue_coll of every eNB.
+ *    s1ap_ue_lookup_bench [eNBs] [UEs per eNB] [lookups]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "common_defs.h"
+#include "hashtable.h"
+#include "mme_config.h"
+#include "s1ap_mme.h"
+#include "s1ap_state.h"
+
+static bool ue_has_mme_ue_s1ap_id_cb(
+  __attribute__((unused)) const hash_key_t keyP,
+  void *const elementP,
+  void *parameterP,
+  void **resultP)
+{
+  if (
+    ((ue_description_t *) elementP)->mme_ue_s1ap_id ==
+    *(mme_ue_s1ap_id_t *) parameterP) {
+    *resultP = elementP;
+    return true;
+  }
+  return false;
+}
+
+static bool enb_has_mme_ue_s1ap_id_cb(
+  __attribute__((unused)) const hash_key_t keyP,
+  void *const elementP,
+  void *parameterP,
+  void **resultP)
+{
+  hashtable_ts_apply_callback_on_elements(
+    &((enb_description_t *) elementP)->ue_coll,
+    ue_has_mme_ue_s1ap_id_cb,
+    parameterP,
+    resultP);
+  return *resultP != NULL;
+}
+
+static ue_description_t *scan_ue_mmeid(
+  s1ap_state_t *state,
+  mme_ue_s1ap_id_t mme_ue_s1ap_id)
+{
+  ue_description_t *ue = NULL;
+
+  hashtable_ts_apply_callback_on_elements(
+    &state->enbs, enb_has_mme_ue_s1ap_id_cb, &mme_ue_s1ap_id, (void **) &ue);
+  return ue;
+}
+
+static void add_enbs(s1ap_state_t *state, int enbs, int ues_per_enb)
+{
+  mme_ue_s1ap_id_t mme_ue_s1ap_id = 1;
+
+  for (sctp_assoc_id_t assoc_id = 1; assoc_id <= enbs; assoc_id++) {
+    enb_description_t *enb = s1ap_new_enb(state);
+
+    enb->sctp_assoc_id = assoc_id;
+    enb->enb_id = assoc_id;
+    hashtable_ts_insert(&state->enbs, (const hash_key_t) assoc_id, enb);
+    for (enb_ue_s1ap_id_t enb_ue_s1ap_id = 0; enb_ue_s1ap_id < ues_per_enb;
+         enb_ue_s1ap_id++) {
+      ue_description_t *ue = s1ap_new_ue(state, assoc_id, enb_ue_s1ap_id);
+
+      ue->mme_ue_s1ap_id = mme_ue_s1ap_id++;
+      s1ap_state_add_ue_mmeid(state, ue);
+    }
+  }
+}
+
+static double elapsed_usec(const struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) * 1e6 +
+         (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+int main(int argc, char **argv)
+{
+  int enbs = argc > 1 ? atoi(argv[1]) : 100;
+  int ues_per_enb = argc > 2 ? atoi(argv[2]) : 100;
+  long lookups = argc > 3 ? atol(argv[3]) : 10000;
+  int ues = enbs * ues_per_enb;
+  long mismatches = 0;
+  struct timespec start;
+
+  if (enbs < 1 || ues_per_enb < 1 || lookups < 1) {
+    fprintf(stderr, "s1ap_ue_lookup_bench [eNBs] [UEs per eNB] [lookups]\n");
+    return EXIT_FAILURE;
+  }
+  mme_config.max_enbs = enbs;
+  mme_config.max_ues = ues;
+  mme_config.use_stateless = false;
+  mme_config.use_stateless_per_ue = false;
+  if (s1ap_state_init() != RETURNok) {
+    return EXIT_FAILURE;
+  }
+  s1ap_state_t *state = s1ap_state_get();
+  add_enbs(state, enbs, ues_per_enb);
+
+  // Spread the ids so the scan does not always stop early
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (long i = 0; i < lookups; i++) {
+    mme_ue_s1ap_id_t mme_ue_s1ap_id = (i * 7919) % ues + 1;
+    ue_description_t *ue = s1ap_state_get_ue_mmeid(state, mme_ue_s1ap_id);
+
+    if (!ue || ue->mme_ue_s1ap_id != mme_ue_s1ap_id) {
+      mismatches++;
+    }
+  }
+  double index_usec = elapsed_usec(&start) / lookups;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (long i = 0; i < lookups; i++) {
+    mme_ue_s1ap_id_t mme_ue_s1ap_id = (i * 7919) % ues + 1;
+    ue_description_t *ue = scan_ue_mmeid(state, mme_ue_s1ap_id);
+
+    if (!ue || ue->mme_ue_s1ap_id != mme_ue_s1ap_id) {
+      mismatches++;
+    }
+  }
+  double scan_usec = elapsed_usec(&start) / lookups;
+
+  printf(
+    "mmeid2ue index: %.3f usec/lookup (%d eNBs, %d UEs)\n",
+    index_usec,
+    enbs,
+    ues);
+  printf("eNB scan: %.3f usec/lookup\n", scan_usec);
+  s1ap_state_put(state);
+  if (mismatches) {
+    printf("%ld lookups did not find their UE\n", mismatches);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
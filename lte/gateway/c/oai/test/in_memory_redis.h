@@ -0,0 +1,211 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+#pragma once
+
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace magma {
+namespace lte {
+
+/*
+ * Redis server keeping keys and hashes in memory. It speaks just enough RESP
+ * for the commands of the state manager and its flusher, and counts the
+ * bytes received, i.e. what a write costs on the wire. Used by tests and
+ * benchmarks of the state managers in place of redis.
+ */
+class InMemoryRedis {
+ public:
+  bool start(uint16_t port)
+  {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (
+      bind(listen_fd_, (struct sockaddr*) &addr, sizeof(addr)) < 0 ||
+      listen(listen_fd_, 4) < 0) {
+      return false;
+    }
+    std::thread(&InMemoryRedis::accept_loop, this).detach();
+    return true;
+  }
+
+  size_t received_bytes() const { return received_bytes_; }
+
+  size_t hash_size(const std::string& key)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hashes_[key].size();
+  }
+
+  bool has_key(const std::string& key)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return keys_.count(key) > 0;
+  }
+
+  // Returns the value of a hash field, empty if there is none
+  std::string hget(const std::string& key, const std::string& field)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& hash = hashes_[key];
+    auto it = hash.find(field);
+    return it == hash.end() ? std::string() : it->second;
+  }
+
+ private:
+  void accept_loop()
+  {
+    // The state manager and the flusher have their own connection
+    for (;;) {
+      int fd = accept(listen_fd_, nullptr, nullptr);
+      if (fd < 0) {
+        return;
+      }
+      std::thread(&InMemoryRedis::serve, this, fd).detach();
+    }
+  }
+
+  void serve(int fd)
+  {
+    std::string buffer;
+    char chunk[64 * 1024];
+    ssize_t n;
+    while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+      received_bytes_ += n;
+      buffer.append(chunk, n);
+      std::string replies;
+      std::vector<std::string> command;
+      size_t consumed;
+      while ((consumed = parse_command(buffer, &command)) > 0) {
+        buffer.erase(0, consumed);
+        replies += execute(command);
+      }
+      if (!replies.empty() && write(fd, replies.data(), replies.size()) < 0) {
+        break;
+      }
+    }
+    close(fd);
+  }
+
+  // Returns the length of the first complete command in buffer, or 0
+  static size_t parse_command(
+    const std::string& buffer,
+    std::vector<std::string>* command)
+  {
+    command->clear();
+    if (buffer.empty() || buffer[0] != '*') {
+      return 0;
+    }
+    size_t pos = buffer.find("\r\n");
+    if (pos == std::string::npos) {
+      return 0;
+    }
+    long args = atol(buffer.c_str() + 1);
+    pos += 2;
+    for (long i = 0; i < args; i++) {
+      size_t end = buffer.find("\r\n", pos);
+      if (end == std::string::npos || buffer[pos] != '$') {
+        return 0;
+      }
+      size_t length = atol(buffer.c_str() + pos + 1);
+      pos = end + 2;
+      if (buffer.size() < pos + length + 2) {
+        return 0;
+      }
+      command->push_back(buffer.substr(pos, length));
+      pos += length + 2;
+    }
+    return pos;
+  }
+
+  static std::string bulk(const std::string& value)
+  {
+    return "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+  }
+
+  std::string execute(const std::vector<std::string>& command)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::string& name = command[0];
+    if (name == "SET" && command.size() == 3) {
+      keys_[command[1]] = command[2];
+      return "+OK\r\n";
+    }
+    if (name == "GET" && command.size() == 2) {
+      auto it = keys_.find(command[1]);
+      return it == keys_.end() ? "$-1\r\n" : bulk(it->second);
+    }
+    if (name == "HSET" && command.size() == 4) {
+      bool added = hashes_[command[1]].count(command[2]) == 0;
+      hashes_[command[1]][command[2]] = command[3];
+      return ":" + std::to_string(added) + "\r\n";
+    }
+    if (name == "HDEL" && command.size() >= 3) {
+      size_t removed = 0;
+      for (size_t i = 2; i < command.size(); i++) {
+        removed += hashes_[command[1]].erase(command[i]);
+      }
+      return ":" + std::to_string(removed) + "\r\n";
+    }
+    if (name == "DEL" && command.size() >= 2) {
+      size_t removed = 0;
+      for (size_t i = 1; i < command.size(); i++) {
+        removed += keys_.erase(command[i]) + hashes_.erase(command[i]);
+      }
+      return ":" + std::to_string(removed) + "\r\n";
+    }
+    if (name == "HSCAN" && command.size() >= 3) {
+      // The whole hash fits in one scan
+      const auto& hash = hashes_[command[1]];
+      std::string fields;
+      for (const auto& field : hash) {
+        fields += bulk(field.first) + bulk(field.second);
+      }
+      return "*2\r\n" + bulk("0") + "*" + std::to_string(hash.size() * 2) +
+             "\r\n" + fields;
+    }
+    return "-ERR unsupported command " + name + "\r\n";
+  }
+
+  int listen_fd_;
+  std::atomic<size_t> received_bytes_{0};
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::string> keys_;
+  std::unordered_map<std::string, std::map<std::string, std::string>> hashes_;
+};
+
+} // namespace lte
+} // namespace magma
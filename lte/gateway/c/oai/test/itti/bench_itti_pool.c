@@ -0,0 +1,188 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*
+ * Measures the itti_malloc/itti_free pairs per second of 1, 2, 4... threads
+ * on the default message pools, with sizes spread over the three small
+ * pools. Each thread keeps a window of messages in flight and frees either
+ * its own messages or, like a receiving task, those of another thread.
+ * malloc/free of the same sizes is the baseline.
+ *    itti_pool_bench [rounds] [max threads]
+ */
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "common_defs.h"
+#include "intertask_interface.h"
+#include "intertask_interface_init.h"
+#include "log.h"
+#include "shared_ts_log.h"
+
+#define THREADS_MAX 64
+#define ITEMS_IN_FLIGHT 64
+
+typedef enum {
+  FREE_OWN_ITEMS,
+  FREE_OTHER_THREAD_ITEMS,
+  MALLOC_BASELINE,
+} bench_mode_t;
+
+typedef struct item_stamp_s {
+  uint32_t thread_index;
+  uint32_t round;
+} item_stamp_t;
+
+typedef struct bench_thread_s {
+  pthread_t thread;
+  uint32_t index;
+  item_stamp_t *items[ITEMS_IN_FLIGHT];
+  uint64_t bad_stamps;
+} bench_thread_t;
+
+static const char *mode_names[] = {"own items", "other thread", "malloc"};
+/* Spread over the 50, 100 and 1000 byte pools of itti_init */
+static const size_t item_sizes[] = {40, 90, 900};
+#define ITEM_SIZES_NUMBER (sizeof(item_sizes) / sizeof(item_sizes[0]))
+
+static bench_thread_t threads[THREADS_MAX];
+static int threads_number;
+static long rounds;
+static bench_mode_t mode;
+static pthread_barrier_t barrier;
+
+static void *bench_thread(void *args_p)
+{
+  bench_thread_t *self = (bench_thread_t *) args_p;
+  bench_thread_t *owner = self;
+
+  if (mode == FREE_OTHER_THREAD_ITEMS) {
+    owner = &threads[(self->index + 1) % threads_number];
+  }
+  for (long round = 0; round < rounds; round++) {
+    for (int i = 0; i < ITEMS_IN_FLIGHT; i++) {
+      size_t size = item_sizes[i % ITEM_SIZES_NUMBER];
+
+      self->items[i] = (mode == MALLOC_BASELINE) ?
+                         malloc(size) :
+                         itti_malloc(TASK_SCTP, TASK_S1AP, size);
+      self->items[i]->thread_index = self->index;
+      self->items[i]->round = round;
+    }
+    if (mode == FREE_OTHER_THREAD_ITEMS) {
+      pthread_barrier_wait(&barrier);
+    }
+    /* An item handed out twice carries the stamp of another thread */
+    for (int i = 0; i < ITEMS_IN_FLIGHT; i++) {
+      item_stamp_t *item = owner->items[i];
+
+      if (item->thread_index != owner->index || item->round != round) {
+        self->bad_stamps++;
+      }
+      if (mode == MALLOC_BASELINE) {
+        free(item);
+      } else {
+        itti_free(TASK_S1AP, item);
+      }
+    }
+    if (mode == FREE_OTHER_THREAD_ITEMS) {
+      pthread_barrier_wait(&barrier);
+    }
+  }
+  return NULL;
+}
+
+static double elapsed_sec(const struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* Returns the alloc/free pairs per second of all the threads */
+static double run(bench_mode_t run_mode, int run_threads_number)
+{
+  struct timespec start;
+
+  mode = run_mode;
+  threads_number = run_threads_number;
+  pthread_barrier_init(&barrier, NULL, threads_number);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < threads_number; i++) {
+    threads[i].index = i;
+    pthread_create(&threads[i].thread, NULL, bench_thread, &threads[i]);
+  }
+  for (int i = 0; i < threads_number; i++) {
+    pthread_join(threads[i].thread, NULL);
+  }
+  double seconds = elapsed_sec(&start);
+  pthread_barrier_destroy(&barrier);
+  return (double) rounds * ITEMS_IN_FLIGHT * threads_number / seconds;
+}
+
+int main(int argc, char **argv)
+{
+  int max_threads = argc > 2 ? atoi(argv[2]) : 8;
+  uint64_t bad_stamps = 0;
+
+  rounds = argc > 1 ? atol(argv[1]) : 20000;
+  if (rounds < 1 || max_threads < 1 || max_threads > THREADS_MAX) {
+    fprintf(stderr, "itti_pool_bench [rounds] [max threads]\n");
+    return EXIT_FAILURE;
+  }
+  if (
+    log_init("itti_pool_bench", OAILOG_LEVEL_ERROR, MAX_LOG_PROTOS) !=
+      RETURNok ||
+    shared_log_init(MAX_LOG_PROTOS) != RETURNok ||
+    itti_init(
+      TASK_MAX,
+      THREAD_MAX,
+      MESSAGES_ID_MAX,
+      tasks_info,
+      messages_info,
+      NULL,
+      NULL) != RETURNok) {
+    return EXIT_FAILURE;
+  }
+  // Every thread caches a magazine per pool on top of its messages
+  itti_configure_memory_pools(NULL, 0, true);
+
+  for (int n = 1; n <= max_threads; n *= 2) {
+    printf("%2d threads:", n);
+    for (int m = FREE_OWN_ITEMS; m <= MALLOC_BASELINE; m++) {
+      printf("  %s %9.0f", mode_names[m], run(m, n));
+      for (int i = 0; i < n; i++) {
+        bad_stamps += threads[i].bad_stamps;
+        threads[i].bad_stamps = 0;
+      }
+    }
+    printf(" alloc/free per sec\n");
+  }
+  if (bad_stamps > 0) {
+    printf("%" PRIu64 " items were handed out twice\n", bad_stamps);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
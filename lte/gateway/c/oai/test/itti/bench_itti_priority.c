@@ -0,0 +1,213 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*
+ * Measures the queueing latency of a high priority message behind bulk
+ * traffic. Each round queues a backlog of SCTP_DATA_IND to TASK_S1AP, which
+ * spends some work on each of them, then one S1AP_PAGING_REQUEST on the
+ * high lane and one SCTP_DATA_IND probe on the normal lane. The latency of
+ * both probes is the time from their send to their receive.
+ *    itti_priority_bench [rounds] [backlog] [work nsec per message]
+ */
+#include <inttypes.h>
+#include <semaphore.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "common_defs.h"
+#include "intertask_interface.h"
+#include "intertask_interface_init.h"
+#include "log.h"
+#include "shared_ts_log.h"
+
+/* assoc_id of the bulk SCTP_DATA_IND, the normal lane probe has another */
+#define BULK_ASSOC_ID 0
+#define PROBE_ASSOC_ID 1
+
+typedef struct round_s {
+  uint64_t high_sent_nsec;
+  uint64_t normal_sent_nsec;
+  uint64_t high_latency_nsec;
+  uint64_t normal_latency_nsec;
+  /* Bulk messages received after the high lane probe */
+  long overtaken;
+  /* Bulk messages received after the normal lane probe, breaks FIFO */
+  long reordered;
+} round_t;
+
+static round_t *rounds;
+static long rounds_number;
+static long backlog;
+static uint64_t work_nsec;
+static sem_t round_done;
+
+static uint64_t now_nsec(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/* What S1AP would spend decoding and handling the message */
+static void work(void)
+{
+  uint64_t end = now_nsec() + work_nsec;
+
+  while (now_nsec() < end) {
+  }
+}
+
+static void *s1ap_task(void *args_p)
+{
+  MessageDef *received_message;
+
+  itti_mark_task_ready(TASK_S1AP);
+  for (long r = 0; r < rounds_number; r++) {
+    round_t *round = &rounds[r];
+    bool high_received = false;
+    bool normal_received = false;
+
+    for (long received = 0; received < backlog + 2; received++) {
+      itti_receive_msg(TASK_S1AP, &received_message);
+      if (ITTI_MSG_ID(received_message) == S1AP_PAGING_REQUEST) {
+        round->high_latency_nsec = now_nsec() - round->high_sent_nsec;
+        high_received = true;
+      } else if (
+        SCTP_DATA_IND(received_message).assoc_id == PROBE_ASSOC_ID) {
+        round->normal_latency_nsec = now_nsec() - round->normal_sent_nsec;
+        normal_received = true;
+      } else {
+        work();
+        round->overtaken += high_received;
+        round->reordered += normal_received;
+      }
+      itti_free(ITTI_MSG_ORIGIN_ID(received_message), received_message);
+    }
+    sem_post(&round_done);
+  }
+  itti_exit_task();
+  return NULL;
+}
+
+static void send_data_ind(sctp_assoc_id_t assoc_id)
+{
+  MessageDef *message = itti_alloc_new_message(TASK_SCTP, SCTP_DATA_IND);
+
+  SCTP_DATA_IND(message).assoc_id = assoc_id;
+  itti_send_msg_to_task(TASK_S1AP, INSTANCE_DEFAULT, message);
+}
+
+static int compare_uint64(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *) a;
+  uint64_t y = *(const uint64_t *) b;
+
+  return (x > y) - (x < y);
+}
+
+static void print_latency(const char *name, size_t offset)
+{
+  uint64_t *latencies = calloc(rounds_number, sizeof(uint64_t));
+
+  for (long r = 0; r < rounds_number; r++) {
+    latencies[r] = *(uint64_t *) ((char *) &rounds[r] + offset);
+  }
+  qsort(latencies, rounds_number, sizeof(uint64_t), compare_uint64);
+  printf(
+    "%s: p50 %8.1f  p99 %8.1f  max %8.1f usec\n",
+    name,
+    latencies[rounds_number / 2] / 1e3,
+    latencies[rounds_number * 99 / 100] / 1e3,
+    latencies[rounds_number - 1] / 1e3);
+  free(latencies);
+}
+
+int main(int argc, char **argv)
+{
+  long overtaken = 0;
+  long reordered = 0;
+
+  rounds_number = argc > 1 ? atol(argv[1]) : 1000;
+  backlog = argc > 2 ? atol(argv[2]) : 1000;
+  work_nsec = argc > 3 ? strtoull(argv[3], NULL, 10) : 1000;
+  if (rounds_number < 1 || backlog < 0) {
+    fprintf(
+      stderr,
+      "itti_priority_bench [rounds] [backlog] [work nsec per message]\n");
+    return EXIT_FAILURE;
+  }
+  if (
+    log_init("itti_priority_bench", OAILOG_LEVEL_ERROR, MAX_LOG_PROTOS) !=
+      RETURNok ||
+    shared_log_init(MAX_LOG_PROTOS) != RETURNok ||
+    itti_init(
+      TASK_MAX,
+      THREAD_MAX,
+      MESSAGES_ID_MAX,
+      tasks_info,
+      messages_info,
+      NULL,
+      NULL) != RETURNok) {
+    return EXIT_FAILURE;
+  }
+  // The backlog is queued faster than the task works through it
+  itti_configure_memory_pools(NULL, 0, true);
+
+  rounds = calloc(rounds_number, sizeof(round_t));
+  sem_init(&round_done, 0, 0);
+  itti_create_task(TASK_S1AP, s1ap_task, NULL);
+
+  for (long r = 0; r < rounds_number; r++) {
+    MessageDef *message;
+
+    for (long i = 0; i < backlog; i++) {
+      send_data_ind(BULK_ASSOC_ID);
+    }
+    message = itti_alloc_new_message(TASK_MME_APP, S1AP_PAGING_REQUEST);
+    rounds[r].high_sent_nsec = now_nsec();
+    itti_send_msg_to_task(TASK_S1AP, INSTANCE_DEFAULT, message);
+    rounds[r].normal_sent_nsec = now_nsec();
+    send_data_ind(PROBE_ASSOC_ID);
+    sem_wait(&round_done);
+    overtaken += rounds[r].overtaken;
+    reordered += rounds[r].reordered;
+  }
+
+  printf(
+    "%ld rounds of %ld bulk messages, %" PRIu64 " nsec of work each\n",
+    rounds_number,
+    backlog,
+    work_nsec);
+  print_latency("high lane  ", offsetof(round_t, high_latency_nsec));
+  print_latency("normal lane", offsetof(round_t, normal_latency_nsec));
+  printf(
+    "high lane probe overtook %.1f bulk messages per round\n",
+    (double) overtaken / rounds_number);
+  if (reordered > 0) {
+    printf("%ld bulk messages overtook the normal lane probe\n", reordered);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,290 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*
+ * Measures the messages per second producer threads get through to a task,
+ * and how many messages the task gets per wakeup. TASK_S1AP receives one
+ * message per call with itti_receive_msg, TASK_MME_APP drains batches with
+ * itti_receive_msg_batch and wakeup coalescing. Both dequeue from the task
+ * queues linked through the message headers, and only block on the eventfd
+ * once those are empty. The baseline is the task queue ITTI used before: a
+ * bounded lfds ring of list elements allocated per send, with one eventfd
+ * write per message and one eventfd read per batch of pending events.
+ *    itti_receive_bench [messages per producer] [producers]
+ */
+#include <inttypes.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdint.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <time.h>
+
+#include <liblfds710.h>
+
+#include "common_defs.h"
+#include "intertask_interface.h"
+#include "intertask_interface_init.h"
+#include "log.h"
+#include "shared_ts_log.h"
+
+#define PRODUCERS_MAX 16
+
+/* List element the baseline allocates for every message it sends */
+typedef struct legacy_message_list_s {
+  MessageDef *msg;
+  message_number_t message_number;
+  uint32_t message_priority;
+} legacy_message_list_t;
+
+typedef struct legacy_queue_s {
+  struct lfds710_queue_bmm_state message_queue
+    __attribute__((aligned(LFDS710_PAL_ATOMIC_ISOLATION_IN_BYTES)));
+  struct lfds710_queue_bmm_element *qbmme;
+  int event_fd;
+  eventfd_t pending_events;
+  message_number_t message_number;
+} legacy_queue_t;
+
+typedef struct consumer_s {
+  task_id_t task_id;
+  bool is_batch;
+  bool is_legacy;
+  uint64_t expected;
+  uint64_t received;
+  uint64_t receive_calls;
+  sem_t done;
+} consumer_t;
+
+typedef struct producer_s {
+  task_id_t destination;
+  bool is_legacy;
+  long messages;
+  pthread_t thread;
+} producer_t;
+
+static consumer_t consumers[] = {
+  {.task_id = TASK_S1AP, .is_batch = false, .is_legacy = true},
+  {.task_id = TASK_S1AP, .is_batch = false},
+  {.task_id = TASK_MME_APP, .is_batch = true},
+};
+
+static legacy_queue_t legacy_queue;
+
+static void legacy_queue_init(task_id_t task_id)
+{
+  uint32_t queue_size = tasks_info[task_id].queue_size;
+
+  legacy_queue.qbmme =
+    calloc(queue_size, sizeof(struct lfds710_queue_bmm_element));
+  lfds710_queue_bmm_init_valid_on_current_logical_core(
+    &legacy_queue.message_queue, legacy_queue.qbmme, queue_size, NULL);
+  legacy_queue.event_fd = eventfd(0, 0);
+}
+
+/*
+ * The old itti_send_msg_to_task. It dropped messages when the ring was full,
+ * the baseline waits for room instead so that every message is counted.
+ */
+static void legacy_send(MessageDef *message)
+{
+  legacy_message_list_t *new = itti_malloc(
+    ITTI_MSG_ORIGIN_ID(message), TASK_S1AP, sizeof(legacy_message_list_t));
+
+  new->msg = message;
+  new->message_number =
+    __sync_fetch_and_add(&legacy_queue.message_number, 1);
+  new->message_priority = MESSAGE_PRIORITY_MED;
+  while (lfds710_queue_bmm_enqueue(&legacy_queue.message_queue, NULL, new) ==
+         0) {
+    sched_yield();
+  }
+  eventfd_write(legacy_queue.event_fd, 1);
+}
+
+/* The old itti_receive_msg: every message is matched by an eventfd event */
+static MessageDef *legacy_receive(void)
+{
+  legacy_message_list_t *message = NULL;
+  MessageDef *received_message;
+
+  if (legacy_queue.pending_events == 0) {
+    eventfd_read(legacy_queue.event_fd, &legacy_queue.pending_events);
+  }
+  lfds710_queue_bmm_dequeue(
+    &legacy_queue.message_queue, NULL, (void **) &message);
+  legacy_queue.pending_events--;
+  received_message = message->msg;
+  itti_free(ITTI_MSG_ORIGIN_ID(received_message), message);
+  return received_message;
+}
+
+static void *legacy_consumer_thread(void *args_p)
+{
+  consumer_t *consumer = (consumer_t *) args_p;
+  MessageDef *received_message;
+
+  LFDS710_MISC_MAKE_VALID_ON_CURRENT_LOGICAL_CORE_INITS_COMPLETED_BEFORE_NOW_ON_ANY_OTHER_LOGICAL_CORE;
+  while (consumer->received < consumer->expected) {
+    received_message = legacy_receive();
+    itti_free(ITTI_MSG_ORIGIN_ID(received_message), received_message);
+    consumer->received++;
+    consumer->receive_calls++;
+  }
+  sem_post(&consumer->done);
+  return NULL;
+}
+
+static void *consumer_task(void *args_p)
+{
+  consumer_t *consumer = (consumer_t *) args_p;
+  MessageDef *received_messages[ITTI_RECEIVE_BATCH_MAX];
+  size_t n_received;
+
+  itti_mark_task_ready(consumer->task_id);
+  while (consumer->received < consumer->expected) {
+    if (consumer->is_batch) {
+      n_received = itti_receive_msg_batch(
+        consumer->task_id, received_messages, ITTI_RECEIVE_BATCH_MAX);
+    } else {
+      itti_receive_msg(consumer->task_id, &received_messages[0]);
+      n_received = 1;
+    }
+    for (size_t i = 0; i < n_received; i++) {
+      itti_free(ITTI_MSG_ORIGIN_ID(received_messages[i]), received_messages[i]);
+    }
+    consumer->received += n_received;
+    consumer->receive_calls++;
+  }
+  sem_post(&consumer->done);
+  itti_exit_task();
+  return NULL;
+}
+
+static void *producer_thread(void *args_p)
+{
+  producer_t *producer = (producer_t *) args_p;
+
+  if (producer->is_legacy) {
+    LFDS710_MISC_MAKE_VALID_ON_CURRENT_LOGICAL_CORE_INITS_COMPLETED_BEFORE_NOW_ON_ANY_OTHER_LOGICAL_CORE;
+  }
+  for (long i = 0; i < producer->messages; i++) {
+    MessageDef *message = itti_alloc_new_message(TASK_SCTP, MESSAGE_TEST);
+    if (producer->is_legacy) {
+      legacy_send(message);
+    } else {
+      itti_send_msg_to_task(producer->destination, INSTANCE_DEFAULT, message);
+    }
+  }
+  return NULL;
+}
+
+static double elapsed_sec(const struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static double run(consumer_t *consumer, long messages, int producers_number)
+{
+  producer_t producers[PRODUCERS_MAX];
+  struct timespec start;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < producers_number; i++) {
+    producers[i].destination = consumer->task_id;
+    producers[i].is_legacy = consumer->is_legacy;
+    producers[i].messages = messages;
+    pthread_create(&producers[i].thread, NULL, producer_thread, &producers[i]);
+  }
+  for (int i = 0; i < producers_number; i++) {
+    pthread_join(producers[i].thread, NULL);
+  }
+  sem_wait(&consumer->done);
+  return consumer->received / elapsed_sec(&start);
+}
+
+int main(int argc, char **argv)
+{
+  long messages = argc > 1 ? atol(argv[1]) : 1000000;
+  int producers_number = argc > 2 ? atoi(argv[2]) : 4;
+  int rc = EXIT_SUCCESS;
+
+  if (producers_number < 1 || producers_number > PRODUCERS_MAX) {
+    fprintf(stderr, "1 to %d producers\n", PRODUCERS_MAX);
+    return EXIT_FAILURE;
+  }
+  if (
+    log_init("itti_receive_bench", OAILOG_LEVEL_ERROR, MAX_LOG_PROTOS) !=
+      RETURNok ||
+    shared_log_init(MAX_LOG_PROTOS) != RETURNok ||
+    itti_init(
+      TASK_MAX,
+      THREAD_MAX,
+      MESSAGES_ID_MAX,
+      tasks_info,
+      messages_info,
+      NULL,
+      NULL) != RETURNok) {
+    return EXIT_FAILURE;
+  }
+  // Messages pile up when the producers are faster than the task
+  itti_configure_memory_pools(NULL, 0, true);
+
+  for (size_t i = 0; i < sizeof(consumers) / sizeof(consumers[0]); i++) {
+    consumer_t *consumer = &consumers[i];
+
+    consumer->expected = (uint64_t) messages * producers_number;
+    sem_init(&consumer->done, 0, 0);
+    if (consumer->is_legacy) {
+      pthread_t thread;
+
+      legacy_queue_init(consumer->task_id);
+      pthread_create(&thread, NULL, legacy_consumer_thread, consumer);
+      pthread_detach(thread);
+    } else {
+      itti_set_wakeup_coalescing(consumer->task_id, consumer->is_batch);
+      itti_create_task(consumer->task_id, consumer_task, consumer);
+    }
+
+    double rate = run(consumer, messages, producers_number);
+    printf(
+      "%s: %.0f messages/sec, %.1f messages per receive (%d producers)\n",
+      consumer->is_legacy ?
+        "baseline lfds queue" :
+        consumer->is_batch ? "itti_receive_msg_batch" : "itti_receive_msg",
+      rate,
+      (double) consumer->received / consumer->receive_calls,
+      producers_number);
+    if (consumer->received != consumer->expected) {
+      printf(
+        "received %" PRIu64 " messages, expected %" PRIu64 "\n",
+        consumer->received,
+        consumer->expected);
+      rc = EXIT_FAILURE;
+    }
+  }
+  return rc;
+}
@@ -0,0 +1,219 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*
+ * Measures the ITTI timer wheel with per-UE NAS timer counts. First it arms
+ * and cancels timers of 60 seconds to an hour that never fire, as most NAS
+ * timers are stopped by the answer they guard. Then it arms short one shot
+ * timers for TASK_S1AP and reports how late their TIMER_HAS_EXPIRED
+ * messages arrive.
+ *    itti_timers_bench [armed timers] [expiring timers]
+ */
+#include <semaphore.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "common_defs.h"
+#include "intertask_interface.h"
+#include "intertask_interface_init.h"
+#include "log.h"
+#include "shared_ts_log.h"
+#include "timer.h"
+
+typedef struct expiring_timer_s {
+  struct timespec deadline;
+} expiring_timer_t;
+
+static long expiring;
+static long expired;
+static long unknown_expired;
+static double lateness_usec_sum;
+static double lateness_usec_max;
+static sem_t expiries_done;
+
+static double elapsed_usec(const struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) * 1e6 +
+         (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+static void *expiry_task(void *args_p)
+{
+  MessageDef *received_message;
+
+  itti_mark_task_ready(TASK_S1AP);
+  while (expired < expiring) {
+    itti_receive_msg(TASK_S1AP, &received_message);
+    if (ITTI_MSG_ID(received_message) == TIMER_HAS_EXPIRED) {
+      expiring_timer_t *timer =
+        (expiring_timer_t *) TIMER_HAS_EXPIRED(received_message).arg;
+      double lateness_usec = elapsed_usec(&timer->deadline);
+
+      lateness_usec_sum += lateness_usec;
+      if (lateness_usec > lateness_usec_max) {
+        lateness_usec_max = lateness_usec;
+      }
+      if (
+        timer_handle_expired(TIMER_HAS_EXPIRED(received_message).timer_id) !=
+        TIMER_OK) {
+        unknown_expired++;
+      }
+      expired++;
+    }
+    itti_free(ITTI_MSG_ORIGIN_ID(received_message), received_message);
+  }
+  sem_post(&expiries_done);
+  itti_exit_task();
+  return NULL;
+}
+
+static long bench_arm_and_cancel(long timers)
+{
+  long *timer_ids = calloc(timers, sizeof(long));
+  struct timespec start;
+  long errors = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (long i = 0; i < timers; i++) {
+    if (
+      timer_setup(
+        60 + i % 3600,
+        0,
+        TASK_MME_APP,
+        INSTANCE_DEFAULT,
+        TIMER_ONE_SHOT,
+        NULL,
+        0,
+        &timer_ids[i]) != TIMER_OK) {
+      errors++;
+    }
+  }
+  double setup_usec = elapsed_usec(&start) / timers;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (long i = 0; i < timers; i++) {
+    if (!timer_exists(timer_ids[i])) {
+      errors++;
+    }
+  }
+  double exists_usec = elapsed_usec(&start) / timers;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (long i = 0; i < timers; i++) {
+    if (timer_remove(timer_ids[i], NULL) != TIMER_OK) {
+      errors++;
+    }
+  }
+  double remove_usec = elapsed_usec(&start) / timers;
+
+  printf(
+    "timer_setup %.3f usec, timer_exists %.3f usec, timer_remove %.3f usec "
+    "(%ld timers)\n",
+    setup_usec,
+    exists_usec,
+    remove_usec,
+    timers);
+  free(timer_ids);
+  return errors;
+}
+
+static long bench_expiry(long timers)
+{
+  expiring_timer_t timer;
+  long timer_id;
+  long errors = 0;
+
+  for (long i = 0; i < timers; i++) {
+    // 50 to 549 ms, several wheel ticks apart
+    uint32_t interval_us = 50000 + (i % 500) * 1000;
+
+    clock_gettime(CLOCK_MONOTONIC, &timer.deadline);
+    timer.deadline.tv_nsec += (long) interval_us * 1000;
+    timer.deadline.tv_sec += timer.deadline.tv_nsec / 1000000000;
+    timer.deadline.tv_nsec %= 1000000000;
+    if (
+      timer_setup(
+        0,
+        interval_us,
+        TASK_S1AP,
+        INSTANCE_DEFAULT,
+        TIMER_ONE_SHOT,
+        &timer,
+        sizeof(timer),
+        &timer_id) != TIMER_OK) {
+      errors++;
+    }
+  }
+  // The task would wait forever for the timers that were not armed
+  if (errors) {
+    return errors;
+  }
+  sem_wait(&expiries_done);
+  printf(
+    "expiry lateness: %.0f usec average, %.0f usec max (%ld timers)\n",
+    lateness_usec_sum / expired,
+    lateness_usec_max,
+    expired);
+  return errors + unknown_expired;
+}
+
+int main(int argc, char **argv)
+{
+  long armed = argc > 1 ? atol(argv[1]) : 100000;
+  long expiring_timers = argc > 2 ? atol(argv[2]) : 10000;
+  long errors = 0;
+
+  if (armed < 1 || expiring_timers < 1) {
+    fprintf(stderr, "itti_timers_bench [armed timers] [expiring timers]\n");
+    return EXIT_FAILURE;
+  }
+  if (
+    log_init("itti_timers_bench", OAILOG_LEVEL_ERROR, MAX_LOG_PROTOS) !=
+      RETURNok ||
+    shared_log_init(MAX_LOG_PROTOS) != RETURNok ||
+    itti_init(
+      TASK_MAX,
+      THREAD_MAX,
+      MESSAGES_ID_MAX,
+      tasks_info,
+      messages_info,
+      NULL,
+      NULL) != RETURNok) {
+    return EXIT_FAILURE;
+  }
+  itti_configure_memory_pools(NULL, 0, true);
+  sem_init(&expiries_done, 0, 0);
+  expiring = expiring_timers;
+  itti_create_task(TASK_S1AP, expiry_task, NULL);
+
+  errors += bench_arm_and_cancel(armed);
+  errors += bench_expiry(expiring_timers);
+  if (errors) {
+    printf("%ld timer operations failed\n", errors);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
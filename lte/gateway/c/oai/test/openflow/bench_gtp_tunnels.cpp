@@ -0,0 +1,357 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+
+/*
+ * Measures the GTP tunnels/sec the openflow controller installs on a mock
+ * switch connected over TCP. The switch answers the handshake and the
+ * barriers, and counts the flow mods. Tunnels are added the way SGW adds
+ * them, by injecting AddGTPTunnelEvent: all at once, so that the controller
+ * batches them, and one at a time, waiting for the flows of each. A last
+ * run has the switch reject 1% of the flow mods, which the GTP application
+ * retries.
+ *    gtp_tunnels_bench [tunnels] [controller port]
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <fluid/of13msg.hh>
+
+#include "GTPApplication.h"
+#include "OpenflowController.h"
+
+using namespace fluid_msg;
+using std::chrono::steady_clock;
+
+namespace {
+
+const char *BENCH_GTP_MAC = "1.2.3.4.5.6";
+const uint32_t BENCH_GTP_PORT = 123;
+const uint8_t OF_13_VERSION = 4;
+const auto FLOWS_TIMEOUT = std::chrono::seconds(30);
+
+openflow::OpenflowController *bench_ctrl;
+
+// Called from the event loop, like the SGW callback of ControllerMain
+void *external_event_callback(std::shared_ptr<void> data)
+{
+  bench_ctrl->dispatch_event(
+    *std::static_pointer_cast<openflow::ExternalEvent>(data));
+  return NULL;
+}
+
+struct SwitchCounters {
+  uint64_t flow_mods;
+  uint64_t barriers;
+  uint64_t rejected;
+};
+
+/**
+ * Switch speaking just enough OpenFlow 1.3 for the controller, on its own
+ * thread. Every reject_every-th flow mod is answered by an OFPT_ERROR.
+ */
+class MockSwitch {
+ public:
+  MockSwitch(): fd_(-1), reject_every_(0), counters_() {}
+
+  ~MockSwitch()
+  {
+    if (fd_ >= 0) {
+      shutdown(fd_, SHUT_RDWR);
+    }
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  bool connect_to(int port)
+  {
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    if (
+      fd_ < 0 ||
+      connect(fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) <
+        0) {
+      return false;
+    }
+    send_message(of13::OFPT_HELLO, 0, nullptr, 0);
+    thread_ = std::thread(&MockSwitch::serve, this);
+    return true;
+  }
+
+  void set_reject_every(uint64_t reject_every)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    reject_every_ = reject_every;
+  }
+
+  SwitchCounters get_counters()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return counters_;
+  }
+
+  // The controller dispatches the switch up event, which ends with a barrier
+  bool wait_for_switch_up()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(
+      lock, FLOWS_TIMEOUT, [this]() { return counters_.barriers > 0; });
+  }
+
+  /**
+   * Wait for the flow mods of tunnels since start, and for those retried
+   * after a rejection
+   */
+  bool wait_for_tunnels(const SwitchCounters &start, uint64_t tunnels)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cv_.wait_for(lock, FLOWS_TIMEOUT, [&]() {
+      uint64_t rejected = counters_.rejected - start.rejected;
+      return counters_.flow_mods - start.flow_mods >= 2 * (tunnels + rejected);
+    });
+  }
+
+ private:
+  void send_message(
+    uint8_t type,
+    uint32_t xid,
+    const void *body,
+    size_t body_length)
+  {
+    std::vector<uint8_t> message(sizeof(struct ofp_header) + body_length);
+    auto header = reinterpret_cast<struct ofp_header *>(message.data());
+    header->version = OF_13_VERSION;
+    header->type = type;
+    header->length = htons(message.size());
+    header->xid = htonl(xid);
+    if (body_length > 0) {
+      memcpy(&message[sizeof(struct ofp_header)], body, body_length);
+    }
+    if (write(fd_, message.data(), message.size()) < 0) {
+      perror("mock switch write");
+    }
+  }
+
+  void handle_message(const uint8_t *data, size_t length)
+  {
+    auto header = reinterpret_cast<const struct ofp_header *>(data);
+    uint32_t xid = ntohl(header->xid);
+    switch (header->type) {
+      case of13::OFPT_ECHO_REQUEST:
+        send_message(
+          of13::OFPT_ECHO_REPLY,
+          xid,
+          data + sizeof(struct ofp_header),
+          length - sizeof(struct ofp_header));
+        break;
+      case of13::OFPT_FEATURES_REQUEST: {
+        // datapath_id, n_buffers, n_tables, auxiliary_id, capabilities
+        uint8_t features[24] = {};
+        features[7] = 1;
+        features[12] = 1;
+        send_message(
+          of13::OFPT_FEATURES_REPLY, xid, features, sizeof(features));
+        break;
+      }
+      case of13::OFPT_FLOW_MOD: {
+        std::lock_guard<std::mutex> lock(mutex_);
+        counters_.flow_mods++;
+        if (reject_every_ > 0 && counters_.flow_mods % reject_every_ == 0) {
+          counters_.rejected++;
+          reject(xid, data, length);
+        }
+        cv_.notify_all();
+        break;
+      }
+      case of13::OFPT_BARRIER_REQUEST: {
+        send_message(of13::OFPT_BARRIER_REPLY, xid, nullptr, 0);
+        std::lock_guard<std::mutex> lock(mutex_);
+        counters_.barriers++;
+        cv_.notify_all();
+        break;
+      }
+      default: break;
+    }
+  }
+
+  // The error echoes the xid and the first 64 bytes of the flow mod
+  void reject(uint32_t xid, const uint8_t *data, size_t length)
+  {
+    uint8_t error[4 + 64];
+    size_t data_length = std::min(length, sizeof(error) - 4);
+    uint16_t type = htons(of13::OFPET_FLOW_MOD_FAILED);
+    uint16_t code = htons(of13::OFPFMFC_TABLE_FULL);
+    memcpy(&error[0], &type, sizeof(type));
+    memcpy(&error[2], &code, sizeof(code));
+    memcpy(&error[4], data, data_length);
+    send_message(of13::OFPT_ERROR, xid, error, 4 + data_length);
+  }
+
+  void serve()
+  {
+    std::vector<uint8_t> buffer;
+    uint8_t chunk[65536];
+    ssize_t n;
+    while ((n = read(fd_, chunk, sizeof(chunk))) > 0) {
+      buffer.insert(buffer.end(), chunk, chunk + n);
+      size_t offset = 0;
+      while (buffer.size() - offset >= sizeof(struct ofp_header)) {
+        auto header =
+          reinterpret_cast<const struct ofp_header *>(&buffer[offset]);
+        size_t length = ntohs(header->length);
+        if (length < sizeof(struct ofp_header)) {
+          fprintf(stderr, "mock switch got a malformed message\n");
+          return;
+        }
+        if (buffer.size() - offset < length) {
+          break;
+        }
+        handle_message(&buffer[offset], length);
+        offset += length;
+      }
+      buffer.erase(buffer.begin(), buffer.begin() + offset);
+    }
+  }
+
+  int fd_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  uint64_t reject_every_;
+  SwitchCounters counters_;
+};
+
+void inject_tunnel(uint32_t tei)
+{
+  struct in_addr ue_ip;
+  struct in_addr enb_ip;
+  char imsi[16];
+  ue_ip.s_addr = htonl(0x0a000000 + tei);
+  enb_ip.s_addr = htonl(0xc0a80001);
+  snprintf(imsi, sizeof(imsi), "00101%010u", tei);
+  bench_ctrl->inject_external_event(
+    std::make_shared<openflow::AddGTPTunnelEvent>(
+      ue_ip, enb_ip, tei, tei + 1, imsi),
+    external_event_callback);
+}
+
+/**
+ * Add tunnels, with new teis from first_tei, and print the tunnels/sec.
+ * Returns false if the switch did not get all their flows.
+ */
+bool bench_tunnels(
+  const char *name,
+  MockSwitch &mock_switch,
+  uint32_t first_tei,
+  int tunnels,
+  bool one_at_a_time)
+{
+  SwitchCounters start = mock_switch.get_counters();
+  auto start_time = steady_clock::now();
+  bool ok = true;
+  for (int i = 0; i < tunnels && ok; i++) {
+    inject_tunnel(first_tei + 2 * i);
+    if (one_at_a_time) {
+      ok = mock_switch.wait_for_tunnels(start, i + 1);
+    }
+  }
+  ok = ok && mock_switch.wait_for_tunnels(start, tunnels);
+  double sec =
+    std::chrono::duration<double>(steady_clock::now() - start_time).count();
+  SwitchCounters end = mock_switch.get_counters();
+
+  if (!ok) {
+    printf(
+      "%s: the switch got %lu of the flow mods of %d tunnels\n",
+      name,
+      (unsigned long) (end.flow_mods - start.flow_mods),
+      tunnels);
+    return false;
+  }
+  printf(
+    "%-13s: %8.0f tunnels/sec, %6.1f tunnels per barrier, %lu rejected\n",
+    name,
+    tunnels / sec,
+    (double) tunnels / std::max<uint64_t>(1, end.barriers - start.barriers),
+    (unsigned long) (end.rejected - start.rejected));
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  int tunnels = argc > 1 ? std::atoi(argv[1]) : 10000;
+  int port = argc > 2 ? std::atoi(argv[2]) : 6666;
+  if (tunnels < 1 || port < 1) {
+    fprintf(stderr, "gtp_tunnels_bench [tunnels] [controller port]\n");
+    return EXIT_FAILURE;
+  }
+
+  openflow::GTPApplication gtp_app(BENCH_GTP_MAC, BENCH_GTP_PORT);
+  openflow::OpenflowController ctrl("127.0.0.1", port, 1, false);
+  bench_ctrl = &ctrl;
+  ctrl.register_for_event(&gtp_app, openflow::EVENT_ADD_GTP_TUNNEL);
+  ctrl.register_for_event(&gtp_app, openflow::EVENT_ERROR);
+  ctrl.register_for_event(&gtp_app, openflow::EVENT_SWITCH_UP);
+  if (!ctrl.start(false)) {
+    fprintf(stderr, "cannot start the controller on port %d\n", port);
+    return EXIT_FAILURE;
+  }
+
+  bool ok = true;
+  {
+    MockSwitch mock_switch;
+    if (!mock_switch.connect_to(port) || !mock_switch.wait_for_switch_up()) {
+      fprintf(stderr, "mock switch cannot connect to the controller\n");
+      ctrl.stop();
+      return EXIT_FAILURE;
+    }
+    // Teis are odd in, even out, and new for every run
+    ok &= bench_tunnels("batched", mock_switch, 1, tunnels, false);
+    ok &= bench_tunnels(
+      "one at a time", mock_switch, 1 + 2 * tunnels, tunnels, true);
+    mock_switch.set_reject_every(100);
+    ok &= bench_tunnels(
+      "1% rejected", mock_switch, 1 + 4 * tunnels, tunnels, false);
+  }
+  ctrl.stop();
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -55,4 +55,8 @@ class MockMessenger : public OpenflowMessenger {
   MOCK_CONST_METHOD2(
     send_of_msg,
     void(fluid_msg::OFMsg &of_msg, fluid_base::OFConnection *ofconn));
+
+  MOCK_CONST_METHOD2(
+    call_after_barrier,
+    void(fluid_base::OFConnection *ofconn, std::function<void()> callback));
 };
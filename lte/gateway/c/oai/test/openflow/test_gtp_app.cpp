@@ -27,12 +27,28 @@
 
 using ::testing::_;
 using ::testing::AllOf;
+using ::testing::Invoke;
+using ::testing::InvokeArgument;
 using ::testing::Test;
 using namespace fluid_msg;
 using namespace openflow;
 
 namespace {
 
+/*
+ * Returns an action keeping the packed message sent, as the messenger does for
+ * the messages of an external event
+ */
+static std::function<void(OFMsg &, OFConnection *)> save_msg(
+  std::vector<uint8_t> *msg)
+{
+  return [msg](OFMsg &of_msg, OFConnection *ofconn) {
+    uint8_t *buffer = of_msg.pack();
+    msg->assign(buffer, buffer + of_msg.length());
+    OFMsg::free_buffer(buffer);
+  };
+}
+
 /**
 * Test fixture that instantiates an openflow controller for testing.
 */
@@ -51,6 +67,12 @@ class GTPApplicationTest : public ::testing::Test {
       new OpenflowController("127.0.0.1", 6666, 2, false, messenger));
     controller->register_for_event(gtp_app, openflow::EVENT_ADD_GTP_TUNNEL);
     controller->register_for_event(gtp_app, openflow::EVENT_DELETE_GTP_TUNNEL);
+    controller->register_for_event(gtp_app, openflow::EVENT_ERROR);
+    controller->register_for_event(
+      gtp_app, openflow::EVENT_DISCARD_DATA_ON_GTP_TUNNEL);
+    controller->register_for_event(
+      gtp_app, openflow::EVENT_FORWARD_DATA_ON_GTP_TUNNEL);
+    controller->register_for_event(gtp_app, openflow::EVENT_SWITCH_UP);
   }
 
   virtual void TearDown()
@@ -327,6 +349,217 @@ TEST_F(GTPApplicationTest, TestDeleteTunnelDlFlow)
 
   controller->dispatch_event(del_tunnel);
 }
+/*
+ * Test that the flow of a tunnel event rejected by the switch is sent again,
+ * alone, until the retries run out
+ */
+TEST_F(GTPApplicationTest, TestRetryTunnelOnError)
+{
+  struct in_addr ue_ip;
+  ue_ip.s_addr = inet_addr("0.0.0.1");
+  struct in_addr enb_ip;
+  enb_ip.s_addr = inet_addr("0.0.0.2");
+  uint32_t in_tei = 1;
+  uint32_t out_tei = 2;
+  char imsi[] = "001010000000013";
+  auto add_tunnel = std::make_shared<AddGTPTunnelEvent>(
+    ue_ip, enb_ip, in_tei, out_tei, imsi);
+  std::vector<uint8_t> uplink_msg;
+
+  // Uplink flow, once and then once per retry
+  EXPECT_CALL(
+    *messenger,
+    send_of_msg(
+      AllOf(
+        CheckTableId(0),
+        CheckInPort(TEST_GTP_PORT),
+        CheckTunnelId(in_tei),
+        CheckCommandType(of13::OFPFC_ADD)),
+      _))
+    .Times(4)
+    .WillRepeatedly(Invoke(save_msg(&uplink_msg)));
+  // Downlink flow, never rejected
+  EXPECT_CALL(
+    *messenger,
+    send_of_msg(
+      AllOf(
+        CheckTableId(0),
+        CheckInPort(of13::OFPP_LOCAL),
+        CheckIPv4Dst(ue_ip),
+        CheckCommandType(of13::OFPFC_ADD)),
+      _))
+    .Times(1);
+  controller->dispatch_event(*add_tunnel);
+  ASSERT_FALSE(uplink_msg.empty());
+
+  struct ofp_error_msg error_msg;
+  memset(&error_msg, 0, sizeof(error_msg));
+  error_msg.type = htons(of13::OFPET_FLOW_MOD_FAILED);
+  error_msg.code = htons(of13::OFPFMFC_TABLE_FULL);
+  ErrorEvent error(NULL, &error_msg, add_tunnel, uplink_msg);
+  ErrorEvent unrelated_error(NULL, &error_msg);
+
+  for (int i = 0; i < 4; i++) {
+    controller->dispatch_event(error);
+  }
+  controller->dispatch_event(unrelated_error);
+  EXPECT_EQ(add_tunnel->get_retries(), 3);
+  ::testing::Mock::VerifyAndClearExpectations(messenger.get());
+}
+
+/*
+ * Test that a rejected flow is not sent again once a later event deleted its
+ * tunnel, which stays out of the shadow table
+ */
+TEST_F(GTPApplicationTest, TestDropRetryAfterDelete)
+{
+  struct in_addr ue_ip;
+  ue_ip.s_addr = inet_addr("0.0.0.1");
+  struct in_addr enb_ip;
+  enb_ip.s_addr = inet_addr("0.0.0.2");
+  uint32_t in_tei = 1;
+  uint32_t out_tei = 2;
+  char imsi[] = "001010000000013";
+  auto add_tunnel = std::make_shared<AddGTPTunnelEvent>(
+    ue_ip, enb_ip, in_tei, out_tei, imsi);
+  DeleteGTPTunnelEvent del_tunnel(ue_ip, in_tei);
+  std::vector<uint8_t> uplink_msg;
+
+  // The uplink flow is only sent by the add tunnel event
+  EXPECT_CALL(
+    *messenger,
+    send_of_msg(
+      AllOf(
+        CheckInPort(TEST_GTP_PORT),
+        CheckTunnelId(in_tei),
+        CheckCommandType(of13::OFPFC_ADD)),
+      _))
+    .WillOnce(Invoke(save_msg(&uplink_msg)));
+  EXPECT_CALL(
+    *messenger,
+    send_of_msg(
+      AllOf(CheckInPort(of13::OFPP_LOCAL), CheckCommandType(of13::OFPFC_ADD)),
+      _))
+    .Times(1);
+  EXPECT_CALL(
+    *messenger, send_of_msg(CheckCommandType(of13::OFPFC_DELETE), _))
+    .Times(2);
+  EXPECT_CALL(*messenger, call_after_barrier(_, _)).Times(1);
+
+  controller->dispatch_event(*add_tunnel);
+  controller->dispatch_event(del_tunnel);
+
+  struct ofp_error_msg error_msg;
+  memset(&error_msg, 0, sizeof(error_msg));
+  error_msg.type = htons(of13::OFPET_FLOW_MOD_FAILED);
+  error_msg.code = htons(of13::OFPFMFC_TABLE_FULL);
+  ErrorEvent error(NULL, &error_msg, add_tunnel, uplink_msg);
+  controller->dispatch_event(error);
+  EXPECT_EQ(add_tunnel->get_retries(), 0);
+
+  // Nothing left to reinstall
+  SwitchUpEvent switch_up(NULL, *controller, NULL, 0);
+  controller->dispatch_event(switch_up);
+}
+
+/*
+ * Test that the tunnels still installed are reinstalled when the switch comes
+ * back up, including their discard flows
+ */
+TEST_F(GTPApplicationTest, TestReinstallTunnelsOnSwitchUp)
+{
+  struct in_addr ue_ip;
+  ue_ip.s_addr = inet_addr("0.0.0.1");
+  struct in_addr enb_ip;
+  enb_ip.s_addr = inet_addr("0.0.0.2");
+  char imsi[] = "001010000000013";
+  AddGTPTunnelEvent add_tunnel1(ue_ip, enb_ip, 1, 11, imsi);
+  AddGTPTunnelEvent add_tunnel2(ue_ip, enb_ip, 2, 12, imsi);
+  AddGTPTunnelEvent add_tunnel3(ue_ip, enb_ip, 3, 13, imsi);
+  DeleteGTPTunnelEvent del_tunnel2(ue_ip, 2);
+  HandleDataOnGTPTunnelEvent discard_tunnel3(
+    ue_ip, 3, EVENT_DISCARD_DATA_ON_GTP_TUNNEL);
+
+  EXPECT_CALL(*messenger, send_of_msg(_, _)).Times(10);
+  controller->dispatch_event(add_tunnel1);
+  controller->dispatch_event(add_tunnel2);
+  controller->dispatch_event(add_tunnel3);
+  controller->dispatch_event(del_tunnel2);
+  controller->dispatch_event(discard_tunnel3);
+  ::testing::Mock::VerifyAndClearExpectations(messenger.get());
+
+  // Uplink flows of the remaining tunnels
+  EXPECT_CALL(
+    *messenger,
+    send_of_msg(
+      AllOf(
+        CheckInPort(TEST_GTP_PORT),
+        CheckTunnelId(1),
+        CheckCommandType(of13::OFPFC_ADD)),
+      _))
+    .Times(1);
+  EXPECT_CALL(
+    *messenger,
+    send_of_msg(
+      AllOf(
+        CheckInPort(TEST_GTP_PORT),
+        CheckTunnelId(2),
+        CheckCommandType(of13::OFPFC_ADD)),
+      _))
+    .Times(0);
+  // Tunnel 3 gets its uplink flow and its uplink discard flow
+  EXPECT_CALL(
+    *messenger,
+    send_of_msg(
+      AllOf(
+        CheckInPort(TEST_GTP_PORT),
+        CheckTunnelId(3),
+        CheckCommandType(of13::OFPFC_ADD)),
+      _))
+    .Times(2);
+  // Downlink flows, with one discard flow for tunnel 3
+  EXPECT_CALL(
+    *messenger,
+    send_of_msg(
+      AllOf(
+        CheckInPort(of13::OFPP_LOCAL),
+        CheckIPv4Dst(ue_ip),
+        CheckCommandType(of13::OFPFC_ADD)),
+      _))
+    .Times(3);
+  // Reconciliation is timed until the barrier after the flows is answered
+  EXPECT_CALL(*messenger, call_after_barrier(_, _))
+    .WillOnce(InvokeArgument<1>());
+
+  SwitchUpEvent switch_up(NULL, *controller, NULL, 0);
+  controller->dispatch_event(switch_up);
+}
+
+/*
+ * Test reinstalling a large number of tunnels against the mock switch
+ */
+TEST_F(GTPApplicationTest, TestReinstallManyTunnels)
+{
+  const uint32_t tunnels_number = 50000;
+  struct in_addr enb_ip;
+  enb_ip.s_addr = inet_addr("0.0.0.2");
+  char imsi[] = "001010000000013";
+
+  EXPECT_CALL(*messenger, send_of_msg(_, _)).Times(2 * tunnels_number);
+  for (uint32_t i = 1; i <= tunnels_number; i++) {
+    struct in_addr ue_ip;
+    ue_ip.s_addr = htonl(0x0a000000 + i);
+    AddGTPTunnelEvent add_tunnel(ue_ip, enb_ip, i, i, imsi);
+    controller->dispatch_event(add_tunnel);
+  }
+  ::testing::Mock::VerifyAndClearExpectations(messenger.get());
+
+  EXPECT_CALL(*messenger, send_of_msg(_, _)).Times(2 * tunnels_number);
+  EXPECT_CALL(*messenger, call_after_barrier(_, _)).Times(1);
+  SwitchUpEvent switch_up(NULL, *controller, NULL, 0);
+  controller->dispatch_event(switch_up);
+}
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,95 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include "RecentPagingSet.h"
+
+using ::testing::Test;
+using namespace openflow;
+
+namespace {
+
+const int WINDOW = 30; // seconds
+
+class RecentPagingSetTest : public ::testing::Test {
+ protected:
+  RecentPagingSetTest(): pagings(std::chrono::seconds(WINDOW)) {}
+
+  RecentPagingSet pagings;
+};
+
+/*
+ * Test a packet-in flood: only the first packet-in of each UE is paged
+ */
+TEST_F(RecentPagingSetTest, TestPacketInFlood)
+{
+  const uint32_t ues_number = 1000;
+  const uint32_t packet_ins_number = 100000;
+  auto now = RecentPagingSet::clock::now();
+  uint32_t paged = 0;
+  for (uint32_t i = 0; i < packet_ins_number; i++) {
+    uint32_t ue_ip = htonl(0x0a000000 + i % ues_number);
+    if (pagings.add(ue_ip, now + std::chrono::microseconds(i))) {
+      paged++;
+    }
+  }
+  EXPECT_EQ(paged, ues_number);
+  EXPECT_EQ(pagings.size(), ues_number);
+}
+
+/*
+ * Test that a UE is paged again once the clamping window is over, and that
+ * the expired UEs are forgotten
+ */
+TEST_F(RecentPagingSetTest, TestWindowExpiry)
+{
+  uint32_t ue_ip1 = inet_addr("10.0.0.1");
+  uint32_t ue_ip2 = inet_addr("10.0.0.2");
+  auto now = RecentPagingSet::clock::now();
+
+  EXPECT_TRUE(pagings.add(ue_ip1, now));
+  EXPECT_FALSE(pagings.add(ue_ip1, now + std::chrono::seconds(WINDOW - 1)));
+  EXPECT_TRUE(pagings.add(ue_ip1, now + std::chrono::seconds(WINDOW)));
+
+  EXPECT_TRUE(pagings.add(ue_ip2, now + std::chrono::seconds(3 * WINDOW)));
+  EXPECT_EQ(pagings.size(), 1u);
+}
+
+/*
+ * Test that clearing the set lets all the UEs be paged again
+ */
+TEST_F(RecentPagingSetTest, TestClear)
+{
+  uint32_t ue_ip = inet_addr("10.0.0.1");
+  auto now = RecentPagingSet::clock::now();
+
+  EXPECT_TRUE(pagings.add(ue_ip, now));
+  pagings.clear();
+  EXPECT_TRUE(pagings.add(ue_ip, now));
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+} // namespace
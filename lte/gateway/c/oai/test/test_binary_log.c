@@ -0,0 +1,375 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+#include <check.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+/* The rings and the argument encoding are static, test them in place */
+#include "binary_log.c"
+
+#define MAX_OUTPUTS 8192
+#define MAX_OUTPUT_SIZE 256
+
+static char outputs[MAX_OUTPUTS][MAX_OUTPUT_SIZE];
+static uint32_t outputs_dropped[MAX_OUTPUTS];
+static uint64_t outputs_format_id[MAX_OUTPUTS];
+static int outputs_number = 0;
+
+static void collect_output(
+  const binary_log_record_t *record,
+  const char *message)
+{
+  if (outputs_number < MAX_OUTPUTS) {
+    snprintf(outputs[outputs_number], MAX_OUTPUT_SIZE, "%s", message);
+    outputs_dropped[outputs_number] = record->dropped;
+    outputs_format_id[outputs_number] = record->format_id;
+  }
+  outputs_number++;
+}
+
+/* Ring of the calling thread, drained into outputs, without the background
+ * thread. Positions are free running, start is where the ring head is. */
+static binary_log_ring_t *create_ring(uint64_t start)
+{
+  binary_log_ring_t *ring = calloc(1, sizeof(binary_log_ring_t));
+
+  ck_assert_ptr_ne(ring, NULL);
+  ring->head = start;
+  ring->tail = start;
+  ring->next = g_binary_log.rings;
+  g_binary_log.rings = ring;
+  g_binary_log.output_cb = collect_output;
+  tls_ring = ring;
+  return ring;
+}
+
+static void destroy_rings(void)
+{
+  while (g_binary_log.rings) {
+    binary_log_ring_t *ring = g_binary_log.rings;
+    g_binary_log.rings = ring->next;
+    free(ring);
+  }
+  tls_ring = NULL;
+  outputs_number = 0;
+}
+
+static void log_message(const char *format, ...)
+{
+  va_list args;
+
+  va_start(args, format);
+  binary_log_record(1, 2, __FILE__, __LINE__, format, args);
+  va_end(args);
+}
+
+/* Spin until the clock moves, so that records get distinct timestamps */
+static void wait_clock_tick(void)
+{
+  struct timespec start;
+  struct timespec now;
+
+  clock_gettime(CLOCK_REALTIME, &start);
+  do {
+    clock_gettime(CLOCK_REALTIME, &now);
+  } while ((now.tv_sec == start.tv_sec) && (now.tv_nsec == start.tv_nsec));
+}
+
+/* Encode the arguments, format them back, and compare with vsnprintf */
+static void check_format(size_t message_size, const char *format, ...)
+{
+  uint64_t buf[BINARY_LOG_MAX_RECORD_SIZE / sizeof(uint64_t)] = {0};
+  binary_log_record_t *record = (binary_log_record_t *) buf;
+  size_t offset = sizeof(binary_log_record_t);
+  char message[BINARY_LOG_MAX_MESSAGE_SIZE];
+  char expected[BINARY_LOG_MAX_MESSAGE_SIZE];
+  int expected_length;
+  va_list args;
+
+  va_start(args, format);
+  ck_assert(encode_args((uint8_t *) buf, sizeof(buf), &offset, format, args));
+  record->size = (uint32_t) offset;
+  expected_length = vsnprintf(expected, message_size, format, args);
+  va_end(args);
+
+  ck_assert_int_eq(
+    binary_log_format(record, format, message, message_size),
+    expected_length);
+  ck_assert_str_eq(message, expected);
+}
+
+START_TEST(format_integers_test)
+{
+  check_format(
+    BINARY_LOG_MAX_MESSAGE_SIZE,
+    "%d %i %u %x %X %o",
+    -42,
+    7,
+    4000000000u,
+    0xbeef,
+    0xbeef,
+    8);
+  check_format(
+    BINARY_LOG_MAX_MESSAGE_SIZE,
+    "%hhd %hhu %hd %hu %ld %lu %lld %llu",
+    300,
+    300,
+    -70000,
+    70000,
+    -1L,
+    ULONG_MAX,
+    LLONG_MIN,
+    ULLONG_MAX);
+  check_format(
+    BINARY_LOG_MAX_MESSAGE_SIZE,
+    "%zu %zd %jd %ju %td",
+    (size_t) 123,
+    (ssize_t) -5,
+    INTMAX_MIN,
+    UINTMAX_MAX,
+    (ptrdiff_t) -9);
+  check_format(
+    BINARY_LOG_MAX_MESSAGE_SIZE,
+    "%#x %#o %+d % d %-+5d| %05d %.3d",
+    255,
+    8,
+    3,
+    4,
+    5,
+    -6,
+    7);
+}
+END_TEST
+
+START_TEST(format_mixed_test)
+{
+  check_format(
+    BINARY_LOG_MAX_MESSAGE_SIZE,
+    "%f %.2f %10.3e %-8g| %G %a %Lf",
+    3.14159,
+    2.5,
+    12345.678,
+    0.0001,
+    1e20,
+    1.5,
+    (long double) 2.25);
+  check_format(
+    BINARY_LOG_MAX_MESSAGE_SIZE,
+    "%c%c %s %.3s %-6s| %6s| %s",
+    'o',
+    'k',
+    "string",
+    "truncated",
+    "left",
+    "right",
+    (char *) NULL);
+  check_format(
+    BINARY_LOG_MAX_MESSAGE_SIZE,
+    "%*d|%-*d|%*d|%.*s|%*.*f|%.*d",
+    6,
+    42,
+    6,
+    42,
+    -6,
+    42,
+    2,
+    "abc",
+    8,
+    3,
+    1.23456,
+    -1,
+    5);
+  check_format(
+    BINARY_LOG_MAX_MESSAGE_SIZE,
+    "%p %p %s 100%% %%d",
+    (void *) 0x1234,
+    NULL,
+    "done");
+  check_format(BINARY_LOG_MAX_MESSAGE_SIZE, "no conversion");
+}
+END_TEST
+
+START_TEST(format_truncation_test)
+{
+  check_format(10, "%s and %d", "a long string", 12345);
+  check_format(4, "%d%d%d", 123, 456, 789);
+  check_format(1, "%s", "nothing fits");
+}
+END_TEST
+
+START_TEST(preformatted_test)
+{
+  char expected[MAX_OUTPUT_SIZE];
+
+  create_ring(0);
+  /* Wide strings aren't recorded, the message is formatted right away */
+  log_message("%d %ls", 12, L"wide");
+  snprintf(expected, sizeof(expected), "%d %ls", 12, L"wide");
+  ck_assert_uint_eq(drain_rings(), 1);
+  ck_assert_str_eq(outputs[0], expected);
+  ck_assert_uint_eq(
+    outputs_format_id[0], (uint64_t)(uintptr_t) BINARY_LOG_PREFORMATTED);
+  destroy_rings();
+}
+END_TEST
+
+START_TEST(ring_wrap_test)
+{
+  binary_log_ring_t *ring = create_ring(BINARY_LOG_RING_SIZE - 16);
+  uint32_t padding = 0;
+
+  /* 72 bytes record, doesn't fit in the last 16 bytes of the ring */
+  log_message("wrapped %d %s", 1, "record");
+  memcpy(&padding, &ring->data[BINARY_LOG_RING_SIZE - 16], sizeof(padding));
+  ck_assert_uint_eq(padding, 16 | BINARY_LOG_PADDING);
+  ck_assert_uint_eq(((binary_log_record_t *) ring->data)->size, 72);
+  ck_assert_uint_eq(ring->head, BINARY_LOG_RING_SIZE + 72);
+
+  ck_assert_uint_eq(drain_rings(), 1);
+  ck_assert_str_eq(outputs[0], "wrapped 1 record");
+  ck_assert_uint_eq(ring->tail, ring->head);
+  ck_assert_uint_eq(binary_log_dropped_records(), 0);
+  destroy_rings();
+}
+END_TEST
+
+START_TEST(ring_many_wraps_test)
+{
+  binary_log_ring_t *ring = create_ring(0);
+  static const char *names[] = {"a", "bbbbbbbbbb", "cccccccccccccccccccc"};
+  char expected[MAX_OUTPUT_SIZE];
+  int logged = 0;
+
+  /* Records of different sizes, so that wraps leave padding of any size */
+  while (ring->head < 4 * BINARY_LOG_RING_SIZE) {
+    for (int i = 0; i < 100; i++, logged++) {
+      log_message("record %d %s", logged, names[logged % 3]);
+    }
+    ck_assert_uint_eq(drain_rings(), 100);
+  }
+  ck_assert_int_eq(outputs_number, logged);
+  for (int i = 0; (i < logged) && (i < MAX_OUTPUTS); i++) {
+    snprintf(expected, sizeof(expected), "record %d %s", i, names[i % 3]);
+    ck_assert_str_eq(outputs[i], expected);
+    ck_assert_uint_eq(outputs_dropped[i], 0);
+  }
+  ck_assert_uint_eq(binary_log_dropped_records(), 0);
+  destroy_rings();
+}
+END_TEST
+
+START_TEST(rings_merge_test)
+{
+  binary_log_ring_t *first = create_ring(0);
+  binary_log_ring_t *second = create_ring(0);
+  char expected[MAX_OUTPUT_SIZE];
+
+  /* Records of both threads are output by order of timestamp */
+  for (int i = 0; i < 10; i++) {
+    tls_ring = (i % 3) ? first : second;
+    log_message("message %d", i);
+    wait_clock_tick();
+  }
+  ck_assert_uint_eq(drain_rings(), 10);
+  for (int i = 0; i < 10; i++) {
+    snprintf(expected, sizeof(expected), "message %d", i);
+    ck_assert_str_eq(outputs[i], expected);
+  }
+  destroy_rings();
+}
+END_TEST
+
+START_TEST(drop_accounting_test)
+{
+  binary_log_ring_t *ring = create_ring(0);
+  int logged = 0;
+
+  /* Fill the ring, then drop 5 records */
+  while (binary_log_dropped_records() == 0) {
+    log_message("fill %d", logged++);
+  }
+  int written = logged - 1;
+  for (int i = 0; i < 4; i++) {
+    log_message("dropped %d", i);
+  }
+  ck_assert_uint_eq(binary_log_dropped_records(), 5);
+  ck_assert_uint_eq(ring->dropped, 5);
+  ck_assert_uint_eq(written, BINARY_LOG_RING_SIZE / 56);
+
+  ck_assert_uint_eq(drain_rings(), written);
+  ck_assert_str_eq(outputs[written - 1], "fill 4680");
+  ck_assert_uint_eq(outputs_dropped[written - 1], 0);
+
+  /* The next record carries the count of records dropped before it */
+  log_message("after %d drops", 5);
+  ck_assert_uint_eq(drain_rings(), 1);
+  ck_assert_str_eq(outputs[written], "after 5 drops");
+  ck_assert_uint_eq(outputs_dropped[written], 5);
+  ck_assert_uint_eq(ring->dropped, 0);
+  ck_assert_uint_eq(binary_log_dropped_records(), 5);
+  destroy_rings();
+}
+END_TEST
+
+Suite *binary_log_suite(void)
+{
+  Suite *s;
+  TCase *tc_format;
+  TCase *tc_ring;
+
+  s = suite_create("Binary log tests");
+
+  tc_format = tcase_create("Format");
+  tcase_add_test(tc_format, format_integers_test);
+  tcase_add_test(tc_format, format_mixed_test);
+  tcase_add_test(tc_format, format_truncation_test);
+  tcase_add_test(tc_format, preformatted_test);
+  suite_add_tcase(s, tc_format);
+
+  tc_ring = tcase_create("Ring");
+  tcase_add_test(tc_ring, ring_wrap_test);
+  tcase_add_test(tc_ring, ring_many_wraps_test);
+  tcase_add_test(tc_ring, rings_merge_test);
+  tcase_add_test(tc_ring, drop_accounting_test);
+  suite_add_tcase(s, tc_ring);
+
+  return s;
+}
+
+int main(void)
+{
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = binary_log_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,142 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "hashtable.h"
+
+#define TEST_KEYS 100
+
+/* Removes the odd keys and reinserts them shifted, from within the walk */
+static bool move_odd_keys_cb(
+  const hash_key_t key,
+  void *const element,
+  void *parameter,
+  void **result)
+{
+  hash_table_ts_t *table = parameter;
+  void *removed;
+
+  if (key % 2 && key < TEST_KEYS) {
+    ck_assert_int_eq(hashtable_ts_remove(table, key, &removed), HASH_TABLE_OK);
+    ck_assert_int_eq(
+      hashtable_ts_insert(table, key + TEST_KEYS, element), HASH_TABLE_OK);
+  }
+  return false;
+}
+
+static bool move_odd_uint64_keys_cb(
+  const hash_key_t key,
+  const uint64_t element,
+  void *parameter,
+  void **result)
+{
+  hash_table_uint64_ts_t *table = parameter;
+
+  if (key % 2 && key < TEST_KEYS) {
+    ck_assert_int_eq(hashtable_uint64_ts_free(table, key), HASH_TABLE_OK);
+    ck_assert_int_eq(
+      hashtable_uint64_ts_insert(table, key + TEST_KEYS, element),
+      HASH_TABLE_OK);
+  }
+  return false;
+}
+
+START_TEST(callback_modifies_table_test)
+{
+  hash_table_ts_t table;
+  void *element;
+
+  hashtable_ts_init(&table, 16, NULL, hash_free_int_func, NULL);
+  for (hash_key_t key = 0; key < TEST_KEYS; key++) {
+    hashtable_ts_insert(&table, key, (void *) (uintptr_t) key);
+  }
+  ck_assert_int_eq(
+    hashtable_ts_apply_callback_on_elements(
+      &table, move_odd_keys_cb, &table, NULL),
+    HASH_TABLE_OK);
+  for (hash_key_t key = 0; key < TEST_KEYS; key++) {
+    hash_key_t moved_key = key % 2 ? key + TEST_KEYS : key;
+
+    ck_assert_int_eq(
+      hashtable_ts_get(&table, moved_key, &element), HASH_TABLE_OK);
+    ck_assert_uint_eq((uintptr_t) element, key);
+  }
+  hashtable_ts_destroy(&table);
+}
+END_TEST
+
+START_TEST(uint64_callback_modifies_table_test)
+{
+  hash_table_uint64_ts_t table;
+  uint64_t element;
+
+  hashtable_uint64_ts_init(&table, 16, NULL, NULL);
+  for (hash_key_t key = 0; key < TEST_KEYS; key++) {
+    hashtable_uint64_ts_insert(&table, key, key);
+  }
+  ck_assert_int_eq(
+    hashtable_uint64_ts_apply_callback_on_elements(
+      &table, move_odd_uint64_keys_cb, &table, NULL),
+    HASH_TABLE_OK);
+  for (hash_key_t key = 0; key < TEST_KEYS; key++) {
+    hash_key_t moved_key = key % 2 ? key + TEST_KEYS : key;
+
+    ck_assert_int_eq(
+      hashtable_uint64_ts_get(&table, moved_key, &element), HASH_TABLE_OK);
+    ck_assert_uint_eq(element, key);
+  }
+  hashtable_uint64_ts_destroy(&table);
+}
+END_TEST
+
+Suite *hashtable_suite(void)
+{
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Hashtable tests");
+
+  /* Core test case */
+  tc_core = tcase_create("Callbacks");
+  tcase_add_test(tc_core, callback_modifies_table_test);
+  tcase_add_test(tc_core, uint64_callback_modifies_table_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void)
+{
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = hashtable_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,291 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+#include <check.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "memory_pools.h"
+
+#define THREADS_NUMBER 4
+#define ROUNDS_NUMBER 20000
+#define ITEMS_IN_FLIGHT 64
+#define IDLE_THREADS_NUMBER 7
+
+static memory_pool_statistics_t pool_statistics(
+  memory_pools_handle_t memory_pools,
+  uint32_t pool)
+{
+  memory_pool_statistics_t statistics[MEMORY_POOLS_MAX_NUMBER];
+
+  ck_assert_uint_gt(
+    memory_pools_get_statistics(
+      memory_pools, statistics, MEMORY_POOLS_MAX_NUMBER),
+    pool);
+  return statistics[pool];
+}
+
+START_TEST(size_class_test)
+{
+  memory_pools_handle_t memory_pools = memory_pools_create(3);
+  uint8_t *small;
+  uint8_t *large;
+  memory_pool_statistics_t statistics;
+
+  /* Added out of order on purpose */
+  memory_pools_add_pool(memory_pools, 10, 1000);
+  memory_pools_add_pool(memory_pools, 10, 48);
+  memory_pools_add_pool(memory_pools, 10, 96);
+
+  small = memory_pools_allocate(memory_pools, 60, 0, 0);
+  ck_assert_ptr_ne(small, NULL);
+  ck_assert_uint_eq((uintptr_t) small % 8, 0);
+  memset(small, 0xff, 60);
+  /* Served by the smallest fitting pool */
+  statistics = pool_statistics(memory_pools, 2);
+  ck_assert_uint_eq(statistics.item_size, 96);
+  ck_assert_uint_gt(statistics.high_water_mark, 0);
+  ck_assert_uint_eq(pool_statistics(memory_pools, 1).high_water_mark, 0);
+
+  large = memory_pools_allocate(memory_pools, 1000, 0, 0);
+  ck_assert_ptr_ne(large, NULL);
+  ck_assert_uint_gt(pool_statistics(memory_pools, 0).high_water_mark, 0);
+  ck_assert_ptr_eq(memory_pools_allocate(memory_pools, 1001, 0, 0), NULL);
+
+  ck_assert_int_eq(memory_pools_free(memory_pools, small, 0), EXIT_SUCCESS);
+  ck_assert_int_eq(memory_pools_free(memory_pools, large, 0), EXIT_SUCCESS);
+}
+END_TEST
+
+START_TEST(exhaustion_and_growth_test)
+{
+  memory_pools_handle_t memory_pools = memory_pools_create(2);
+  void *items[41];
+  memory_pool_statistics_t statistics;
+  int i;
+
+  memory_pools_add_pool(memory_pools, 20, 64);
+  memory_pools_add_pool(memory_pools, 20, 128);
+
+  /* The larger pool takes over when the smaller one is empty */
+  for (i = 0; i < 40; i++) {
+    items[i] = memory_pools_allocate(memory_pools, 64, 0, 0);
+    ck_assert_ptr_ne(items[i], NULL);
+  }
+  ck_assert_ptr_eq(memory_pools_allocate(memory_pools, 64, 0, 0), NULL);
+  statistics = pool_statistics(memory_pools, 0);
+  ck_assert_uint_gt(statistics.misses, 0);
+  ck_assert_uint_eq(statistics.high_water_mark, 20);
+
+  memory_pools_set_growth(memory_pools, true);
+  items[40] = memory_pools_allocate(memory_pools, 64, 0, 0);
+  ck_assert_ptr_ne(items[40], NULL);
+  statistics = pool_statistics(memory_pools, 0);
+  ck_assert_uint_gt(statistics.grown_items_number, 0);
+  ck_assert_uint_eq(
+    statistics.items_number, 20 + statistics.grown_items_number);
+
+  for (i = 0; i < 41; i++) {
+    ck_assert_int_eq(
+      memory_pools_free(memory_pools, items[i], 0), EXIT_SUCCESS);
+  }
+}
+END_TEST
+
+START_TEST(retire_test)
+{
+  memory_pools_handle_t memory_pools = memory_pools_create(2);
+  void *old_item;
+  void *new_item;
+
+  memory_pools_add_pool(memory_pools, 10, 100);
+  old_item = memory_pools_allocate(memory_pools, 100, 0, 0);
+  memory_pools_add_pool(memory_pools, 10, 200);
+  memory_pools_retire_pools(memory_pools, 1);
+
+  new_item = memory_pools_allocate(memory_pools, 100, 0, 0);
+  ck_assert_ptr_ne(new_item, NULL);
+  ck_assert_uint_gt(pool_statistics(memory_pools, 1).high_water_mark, 0);
+  ck_assert(pool_statistics(memory_pools, 0).retired);
+
+  /* Items of retired pools can still be freed */
+  ck_assert_int_eq(memory_pools_free(memory_pools, old_item, 0), EXIT_SUCCESS);
+  ck_assert_int_eq(memory_pools_free(memory_pools, new_item, 0), EXIT_SUCCESS);
+}
+END_TEST
+
+static memory_pools_handle_t shared_memory_pools;
+
+static void *alloc_free_thread(void *args)
+{
+  uint32_t seed = (uint32_t)(uintptr_t) args;
+  uint8_t *items[ITEMS_IN_FLIGHT] = {NULL};
+  uint32_t sizes[ITEMS_IN_FLIGHT] = {0};
+  uint32_t slot;
+  uint32_t i;
+  int round;
+
+  for (round = 0; round < ROUNDS_NUMBER; round++) {
+    slot = rand_r(&seed) % ITEMS_IN_FLIGHT;
+
+    if (items[slot] != NULL) {
+      for (i = 0; i < sizes[slot]; i++) {
+        ck_assert_uint_eq(items[slot][i], (uint8_t) slot);
+      }
+      memory_pools_free(shared_memory_pools, items[slot], 0);
+    }
+
+    sizes[slot] = 1 + rand_r(&seed) % 1000;
+    items[slot] =
+      memory_pools_allocate(shared_memory_pools, sizes[slot], 0, 0);
+    ck_assert_ptr_ne(items[slot], NULL);
+    ck_assert_uint_eq((uintptr_t) items[slot] % 8, 0);
+    memset(items[slot], slot, sizes[slot]);
+  }
+
+  for (slot = 0; slot < ITEMS_IN_FLIGHT; slot++) {
+    memory_pools_free(shared_memory_pools, items[slot], 0);
+  }
+
+  return NULL;
+}
+
+START_TEST(threads_test)
+{
+  pthread_t threads[THREADS_NUMBER];
+  memory_pool_statistics_t statistics[MEMORY_POOLS_MAX_NUMBER];
+  uint32_t pools_number;
+  uint32_t pool;
+  int i;
+
+  shared_memory_pools = memory_pools_create(3);
+  memory_pools_add_pool(shared_memory_pools, 2000, 100);
+  memory_pools_add_pool(shared_memory_pools, 2000, 500);
+  memory_pools_add_pool(shared_memory_pools, 2000, 1000);
+
+  for (i = 0; i < THREADS_NUMBER; i++) {
+    pthread_create(
+      &threads[i], NULL, alloc_free_thread, (void *) (uintptr_t)(i + 1));
+  }
+  for (i = 0; i < THREADS_NUMBER; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  /* Exited threads gave their cached items back */
+  pools_number = memory_pools_get_statistics(
+    shared_memory_pools, statistics, MEMORY_POOLS_MAX_NUMBER);
+  ck_assert_uint_eq(pools_number, 3);
+  for (pool = 0; pool < pools_number; pool++) {
+    ck_assert_uint_eq(
+      statistics[pool].free_items_number, statistics[pool].items_number);
+  }
+}
+END_TEST
+
+static pthread_barrier_t idle_barrier;
+
+/* Allocates and frees one item of each size, then idles until released */
+static void *alloc_free_idle_thread(void *args)
+{
+  uint32_t *sizes = args;
+  void *item;
+  int i;
+
+  for (i = 0; i < 2; i++) {
+    item = memory_pools_allocate(shared_memory_pools, sizes[i], 0, 0);
+    ck_assert_ptr_ne(item, NULL);
+    memory_pools_free(shared_memory_pools, item, 0);
+  }
+  pthread_barrier_wait(&idle_barrier);
+  pthread_barrier_wait(&idle_barrier);
+  return NULL;
+}
+
+/* Items cached by idle threads must not leave a small pool empty */
+START_TEST(small_pools_test)
+{
+  pthread_t threads[IDLE_THREADS_NUMBER];
+  uint32_t sizes[2] = {20000, 30000};
+  void *item;
+  int i;
+
+  shared_memory_pools = memory_pools_create(2);
+  memory_pools_add_pool(shared_memory_pools, 400, 20050);
+  memory_pools_add_pool(shared_memory_pools, 100, 30050);
+  pthread_barrier_init(&idle_barrier, NULL, IDLE_THREADS_NUMBER + 1);
+
+  for (i = 0; i < IDLE_THREADS_NUMBER; i++) {
+    pthread_create(&threads[i], NULL, alloc_free_idle_thread, sizes);
+  }
+  pthread_barrier_wait(&idle_barrier);
+
+  ck_assert_uint_eq(
+    pool_statistics(shared_memory_pools, 1).free_items_number, 100);
+  ck_assert_uint_ge(
+    pool_statistics(shared_memory_pools, 0).free_items_number, 400 * 7 / 8);
+  item = memory_pools_allocate(shared_memory_pools, 30000, 0, 0);
+  ck_assert_ptr_ne(item, NULL);
+  ck_assert_int_eq(
+    memory_pools_free(shared_memory_pools, item, 0), EXIT_SUCCESS);
+
+  pthread_barrier_wait(&idle_barrier);
+  for (i = 0; i < IDLE_THREADS_NUMBER; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  pthread_barrier_destroy(&idle_barrier);
+}
+END_TEST
+
+Suite *memory_pools_suite(void)
+{
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Memory pools tests");
+
+  /* Core test case */
+  tc_core = tcase_create("Allocation");
+  tcase_add_test(tc_core, size_class_test);
+  tcase_add_test(tc_core, exhaustion_and_growth_test);
+  tcase_add_test(tc_core, retire_test);
+  tcase_add_test(tc_core, threads_test);
+  tcase_add_test(tc_core, small_pools_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void)
+{
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = memory_pools_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
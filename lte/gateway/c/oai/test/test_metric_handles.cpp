@@ -0,0 +1,106 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+#include <check.h>
+#include <stdlib.h>
+#include <string>
+
+#include "service303.h"
+#include "MetricsSingleton.h"
+
+using magma::service303::MetricsSingleton;
+
+static double collected_value(const std::string &name)
+{
+  for (const auto &family : MetricsSingleton::Instance().Collect()) {
+    if (family.name() != name) {
+      continue;
+    }
+    const auto &metric = family.metric(0);
+    return metric.has_counter() ? metric.counter().value() :
+                                  metric.gauge().value();
+  }
+  return -1;
+}
+
+/* The C handles update the same timeseries as the C functions */
+START_TEST(c_handles_test)
+{
+  counter_handle_t *counter = get_counter_handle("c_counter", 1, "k", "v");
+  gauge_handle_t *gauge = get_gauge_handle("c_gauge", NO_LABELS);
+  ck_assert_ptr_eq(counter, get_counter_handle("c_counter", 1, "k", "v"));
+
+  counter_handle_increment(counter, 2);
+  increment_counter("c_counter", 3, 1, "k", "v");
+  gauge_handle_increment(gauge, 5);
+  gauge_handle_decrement(gauge, 1);
+  ck_assert(collected_value("c_counter") == 5);
+  ck_assert(collected_value("c_gauge") == 4);
+}
+END_TEST
+
+/* Handles kept in statics are still collected after a flush */
+START_TEST(c_handles_flush_test)
+{
+  counter_handle_t *counter = get_counter_handle("c_flushed", NO_LABELS);
+  gauge_handle_t *gauge = get_gauge_handle("c_flushed_gauge", NO_LABELS);
+  counter_handle_increment(counter, 2);
+  gauge_handle_set(gauge, 2);
+
+  MetricsSingleton::flush();
+  counter_handle_increment(counter, 1);
+  gauge_handle_set(gauge, 1);
+  ck_assert(collected_value("c_flushed") == 1);
+  ck_assert(collected_value("c_flushed_gauge") == 1);
+  ck_assert_ptr_eq(counter, get_counter_handle("c_flushed", NO_LABELS));
+}
+END_TEST
+
+Suite *metric_handles_suite(void)
+{
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("Metric handles tests");
+
+  /* Core test case */
+  tc_core = tcase_create("Handles");
+  tcase_add_test(tc_core, c_handles_test);
+  tcase_add_test(tc_core, c_handles_flush_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void)
+{
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = metric_handles_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
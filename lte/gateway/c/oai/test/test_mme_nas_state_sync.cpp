@@ -0,0 +1,117 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+#include <check.h>
+#include <stdlib.h>
+#include <string>
+
+extern "C" {
+#include "mme_app_state.h"
+#include "mme_app_ue_context.h"
+#include "mme_config.h"
+}
+
+#include "mme_nas_state.pb.h"
+#include "ServiceConfigLoader.h"
+#include "in_memory_redis.h"
+
+#define TEST_MME_UE_S1AP_ID 7
+#define TEST_OLD_TEID 1
+#define TEST_NEW_TEID 2
+
+static const char* MME_NAS_UE_STATE_KEY = "mme_nas_ue_state";
+
+/*
+ * A sync in the middle of a message, e.g. after removing a UE context, must
+ * not drop the UE contexts the message still holds locked from the dirty
+ * set, or their later changes are never written.
+ */
+START_TEST(sync_keeps_locked_ue_dirty_test)
+{
+  magma::ServiceConfigLoader loader;
+  magma::lte::InMemoryRedis redis;
+  ck_assert(redis.start(loader.load_service_config("redis")["port"].as<int>()));
+
+  mme_config.max_ues = 16;
+  mme_config.use_stateless = true;
+  mme_config.use_stateless_per_ue = true;
+  // Only syncs flush within the test
+  mme_config.state_write_behind_window_ms = 10000;
+  ck_assert_int_eq(mme_nas_state_init(&mme_config), RETURNok);
+
+  mme_app_desc_t* state = get_locked_mme_nas_state(false);
+  ue_mm_context_t* ue_context = mme_create_new_ue_context();
+  ue_context->mme_ue_s1ap_id = TEST_MME_UE_S1AP_ID;
+  ue_context->mme_teid_s11 = TEST_OLD_TEID;
+  mme_insert_ue_context(&state->mme_ue_contexts, ue_context);
+  unlock_ue_contexts(ue_context);
+  mme_nas_state_mark_ue_dirty(TEST_MME_UE_S1AP_ID);
+  put_mme_nas_state(&state);
+
+  state = get_locked_mme_nas_state(false);
+  ue_context = mme_ue_context_exists_mme_ue_s1ap_id(
+    &state->mme_ue_contexts, TEST_MME_UE_S1AP_ID);
+  ck_assert_ptr_ne(ue_context, NULL);
+  ck_assert_int_eq(mme_nas_state_sync_to_db(), RETURNok);
+  ue_context->mme_teid_s11 = TEST_NEW_TEID;
+  unlock_ue_contexts(ue_context);
+  put_mme_nas_state(&state);
+
+  state = get_locked_mme_nas_state(false);
+  ck_assert_int_eq(mme_nas_state_sync_to_db(), RETURNok);
+  put_mme_nas_state(&state);
+
+  magma::lte::UeContext ue_context_proto;
+  ck_assert(ue_context_proto.ParseFromString(redis.hget(
+    MME_NAS_UE_STATE_KEY, std::to_string(TEST_MME_UE_S1AP_ID))));
+  ck_assert_uint_eq(ue_context_proto.mme_teid_s11(), TEST_NEW_TEID);
+}
+END_TEST
+
+Suite* mme_nas_state_sync_suite(void)
+{
+  Suite* s;
+  TCase* tc_core;
+
+  s = suite_create("MME NAS state sync tests");
+
+  /* Core test case */
+  tc_core = tcase_create("Sync");
+  tcase_add_test(tc_core, sync_keeps_locked_ue_dirty_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void)
+{
+  int number_failed;
+  Suite* s;
+  SRunner* sr;
+
+  s = mme_nas_state_sync_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,327 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+#include <check.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "secu_defs.h"
+
+/* 3GPP TS 33.401 Annex C, 128-EEA2 and 128-EEA1 test set 1 */
+static uint8_t eea_key[16] = {0xd3, 0xc5, 0xd5, 0x92, 0x32, 0x7f, 0xb1, 0x1c,
+                              0x40, 0x35, 0xc6, 0x68, 0x0a, 0xf8, 0xc6, 0xd1};
+static uint8_t eea_plaintext[32] = {
+  0x98, 0x1b, 0xa6, 0x82, 0x4c, 0x1b, 0xfb, 0x1a, 0xb4, 0x85, 0x47,
+  0x20, 0x29, 0xb7, 0x1d, 0x80, 0x8c, 0xe3, 0x3e, 0x2c, 0xc3, 0xc0,
+  0xb5, 0xfc, 0x1f, 0x3d, 0xe8, 0xa6, 0xdc, 0x66, 0xb1, 0xf0};
+static uint8_t eea2_ciphertext[32] = {
+  0xe9, 0xfe, 0xd8, 0xa6, 0x3d, 0x15, 0x53, 0x04, 0xd7, 0x1d, 0xf2,
+  0x0b, 0xf3, 0xe8, 0x22, 0x14, 0xb2, 0x0e, 0xd7, 0xda, 0xd2, 0xf2,
+  0x33, 0xdc, 0x3c, 0x22, 0xd7, 0xbd, 0xee, 0xed, 0x8e, 0x78};
+static uint8_t eea1_ciphertext[32] = {
+  0x5d, 0x5b, 0xfe, 0x75, 0xeb, 0x04, 0xf6, 0x8c, 0xe0, 0xa1, 0x23,
+  0x77, 0xea, 0x00, 0xb3, 0x7d, 0x47, 0xc6, 0xa0, 0xba, 0x06, 0x30,
+  0x91, 0x55, 0x08, 0x6a, 0x85, 0x9c, 0x43, 0x41, 0xb3, 0x78};
+
+/* 3GPP TS 33.401 Annex C, 128-EIA2 test set 1 */
+static uint8_t eia_key[16] = {0x2b, 0xd6, 0x45, 0x9f, 0x82, 0xc5, 0xb3, 0x00,
+                              0x95, 0x2c, 0x49, 0x10, 0x48, 0x81, 0xff, 0x48};
+static uint8_t eia2_message[8] = {0x33, 0x32, 0x34, 0x62,
+                                  0x63, 0x39, 0x38, 0x40};
+static uint8_t eia2_mac[4] = {0x11, 0x8c, 0x6e, 0xb8};
+
+/* 3GPP TS 33.401 Annex C, 128-EIA2 test set 2, with the key of the 128-EEA
+ * test set 1 */
+static uint8_t eia2_message_2[8] = {0x48, 0x45, 0x83, 0xd5,
+                                    0xaf, 0xe0, 0x82, 0xae};
+static uint8_t eia2_mac_2[4] = {0xb9, 0x37, 0x87, 0xe6};
+
+/* 3GPP TS 33.401 Annex C, 128-EIA1 test set 1 */
+static uint8_t eia1_message[11] = {
+  0x33, 0x32, 0x34, 0x62, 0x63, 0x39, 0x38, 0x61, 0x37, 0x34, 0x79};
+static uint8_t eia1_mac[4] = {0x73, 0x1f, 0x11, 0x65};
+
+/* 3GPP TS 33.401 Annex C, 128-EEA1 and 128-EEA2 test sets 2 and 3, which
+ * share their input */
+typedef struct {
+  uint8_t key[16];
+  uint32_t count;
+  uint8_t bearer;
+  uint8_t direction;
+  uint32_t blength;
+  uint8_t plaintext[100];
+  uint8_t eea1_ciphertext[100];
+  uint8_t eea2_ciphertext[100];
+} eea_test_set_t;
+
+static eea_test_set_t eea_test_sets[] = {
+  {{0x2b, 0xd6, 0x45, 0x9f, 0x82, 0xc4, 0x40, 0xe0, 0x95, 0x2c, 0x49, 0x10,
+    0x48, 0x05, 0xff, 0x48},
+   0xc675a64b,
+   0x0c,
+   1,
+   798,
+   {0x7e, 0xc6, 0x12, 0x72, 0x74, 0x3b, 0xf1, 0x61, 0x47, 0x26, 0x44, 0x6a,
+    0x6c, 0x38, 0xce, 0xd1, 0x66, 0xf6, 0xca, 0x76, 0xeb, 0x54, 0x30, 0x04,
+    0x42, 0x86, 0x34, 0x6c, 0xef, 0x13, 0x0f, 0x92, 0x92, 0x2b, 0x03, 0x45,
+    0x0d, 0x3a, 0x99, 0x75, 0xe5, 0xbd, 0x2e, 0xa0, 0xeb, 0x55, 0xad, 0x8e,
+    0x1b, 0x19, 0x9e, 0x3e, 0xc4, 0x31, 0x60, 0x20, 0xe9, 0xa1, 0xb2, 0x85,
+    0xe7, 0x62, 0x79, 0x53, 0x59, 0xb7, 0xbd, 0xfd, 0x39, 0xbe, 0xf4, 0xb2,
+    0x48, 0x45, 0x83, 0xd5, 0xaf, 0xe0, 0x82, 0xae, 0xe6, 0x38, 0xbf, 0x5f,
+    0xd5, 0xa6, 0x06, 0x19, 0x39, 0x01, 0xa0, 0x8f, 0x4a, 0xb4, 0x1a, 0xab,
+    0x9b, 0x13, 0x48, 0x80},
+   {0x3f, 0x67, 0x85, 0x07, 0x14, 0xb8, 0xda, 0x69, 0xef, 0xb7, 0x27, 0xed,
+    0x7a, 0x6c, 0x0c, 0x50, 0x71, 0x4a, 0xd7, 0x36, 0xc4, 0xf5, 0x60, 0x00,
+    0x06, 0xe3, 0x52, 0x5b, 0xe8, 0x07, 0xc4, 0x67, 0xc6, 0x77, 0xff, 0x86,
+    0x4a, 0xf4, 0x5f, 0xba, 0x09, 0xc2, 0x7c, 0xde, 0x38, 0xf8, 0x7a, 0x1f,
+    0x84, 0xd5, 0x9a, 0xb2, 0x55, 0x40, 0x8f, 0x2c, 0x7b, 0x82, 0xf9, 0xea,
+    0xd4, 0x1a, 0x1f, 0xe6, 0x5e, 0xab, 0xeb, 0xfb, 0xc1, 0xf3, 0xa4, 0xc5,
+    0x6c, 0x9a, 0x26, 0xfc, 0xf7, 0xb3, 0xd6, 0x6d, 0x02, 0x20, 0xee, 0x47,
+    0x75, 0xbc, 0x58, 0x17, 0x0a, 0x2b, 0x12, 0xf3, 0x43, 0x1d, 0x11, 0xb3,
+    0x44, 0xd6, 0xe3, 0x6c},
+   {0x59, 0x61, 0x60, 0x53, 0x53, 0xc6, 0x4b, 0xdc, 0xa1, 0x5b, 0x19, 0x5e,
+    0x28, 0x85, 0x53, 0xa9, 0x10, 0x63, 0x25, 0x06, 0xd6, 0x20, 0x0a, 0xa7,
+    0x90, 0xc4, 0xc8, 0x06, 0xc9, 0x99, 0x04, 0xcf, 0x24, 0x45, 0xcc, 0x50,
+    0xbb, 0x1c, 0xf1, 0x68, 0xa4, 0x96, 0x73, 0x73, 0x4e, 0x08, 0x1b, 0x57,
+    0xe3, 0x24, 0xce, 0x52, 0x59, 0xc0, 0xe7, 0x8d, 0x4c, 0xd9, 0x7b, 0x87,
+    0x09, 0x76, 0x50, 0x3c, 0x09, 0x43, 0xf2, 0xcb, 0x5a, 0xe8, 0xf0, 0x52,
+    0xc7, 0xb7, 0xd3, 0x92, 0x23, 0x95, 0x87, 0xb8, 0x95, 0x60, 0x86, 0xbc,
+    0xab, 0x18, 0x83, 0x60, 0x42, 0xe2, 0xe6, 0xce, 0x42, 0x43, 0x2a, 0x17,
+    0x10, 0x5c, 0x53, 0xd0}},
+  {{0x0a, 0x8b, 0x6b, 0xd8, 0xd9, 0xb0, 0x8b, 0x08, 0xd6, 0x4e, 0x32, 0xd1,
+    0x81, 0x77, 0x77, 0xfb},
+   0x544d49cd,
+   0x04,
+   0,
+   310,
+   {0xfd, 0x40, 0xa4, 0x1d, 0x37, 0x0a, 0x1f, 0x65, 0x74, 0x50, 0x95, 0x68,
+    0x7d, 0x47, 0xba, 0x1d, 0x36, 0xd2, 0x34, 0x9e, 0x23, 0xf6, 0x44, 0x39,
+    0x2c, 0x8e, 0xa9, 0xc4, 0x9d, 0x40, 0xc1, 0x32, 0x71, 0xaf, 0xf2, 0x64,
+    0xd0, 0xf2, 0x48},
+   {0x48, 0x14, 0x8e, 0x54, 0x52, 0xa2, 0x10, 0xc0, 0x5f, 0x46, 0xbc, 0x80,
+    0xdc, 0x6f, 0x73, 0x49, 0x5b, 0x02, 0x04, 0x8c, 0x1b, 0x95, 0x8b, 0x02,
+    0x61, 0x02, 0xca, 0x97, 0x28, 0x02, 0x79, 0xa4, 0xc1, 0x8d, 0x2e, 0xe3,
+    0x08, 0x92, 0x1c},
+   {0x75, 0x75, 0x0d, 0x37, 0xb4, 0xbb, 0xa2, 0xa4, 0xde, 0xdb, 0x34, 0x23,
+    0x5b, 0xd6, 0x8c, 0x66, 0x45, 0xac, 0xda, 0xac, 0xa4, 0x81, 0x38, 0xa3,
+    0xb0, 0xc4, 0x71, 0xe2, 0xa7, 0x04, 0x1a, 0x57, 0x64, 0x23, 0xd2, 0x92,
+    0x72, 0x87, 0xf0}},
+};
+
+static void eea_test_set_1(nas_stream_cipher_t *stream_cipher, uint8_t *message)
+{
+  memset(stream_cipher, 0, sizeof(*stream_cipher));
+  memcpy(message, eea_plaintext, sizeof(eea_plaintext));
+  stream_cipher->key = eea_key;
+  stream_cipher->key_length = sizeof(eea_key);
+  stream_cipher->count = 0x398a59b4;
+  stream_cipher->bearer = 0x15;
+  stream_cipher->direction = 1;
+  stream_cipher->message = message;
+  stream_cipher->blength = 253;
+}
+
+/* Compares the blength bits of a ciphered message, the bits past blength in
+ * the last byte are not part of the output */
+static bool eea_output_matches(
+  const uint8_t *out,
+  const uint8_t *expected,
+  uint32_t blength)
+{
+  uint32_t bytes = blength / 8;
+  uint8_t last_mask = (uint8_t)(0xff << (8 - blength % 8));
+
+  if (memcmp(out, expected, bytes) != 0) {
+    return false;
+  }
+  return blength % 8 == 0 ||
+         (out[bytes] & last_mask) == (expected[bytes] & last_mask);
+}
+
+START_TEST(eea1_test_set_1_test)
+{
+  nas_stream_cipher_t stream_cipher;
+  uint8_t message[32];
+  uint8_t out[32];
+
+  eea_test_set_1(&stream_cipher, message);
+  nas_stream_encrypt_eea1(&stream_cipher, out);
+  ck_assert(memcmp(out, eea1_ciphertext, sizeof(out)) == 0);
+  /* The message is left untouched */
+  ck_assert(memcmp(message, eea_plaintext, sizeof(message)) == 0);
+
+  /* In place */
+  nas_stream_encrypt_eea1(&stream_cipher, message);
+  ck_assert(memcmp(message, eea1_ciphertext, sizeof(message)) == 0);
+}
+END_TEST
+
+START_TEST(eea2_test_set_1_test)
+{
+  nas_stream_cipher_t stream_cipher;
+  nas_aes128_key_t key_cache = {0};
+  uint8_t message[32];
+  uint8_t out[32];
+
+  eea_test_set_1(&stream_cipher, message);
+  nas_stream_encrypt_eea2(&stream_cipher, out);
+  ck_assert(memcmp(out, eea2_ciphertext, sizeof(out)) == 0);
+
+  /* Expanded in the cache, then reused */
+  stream_cipher.key_cache = &key_cache;
+  nas_stream_encrypt_eea2(&stream_cipher, out);
+  ck_assert(key_cache.is_set == true);
+  ck_assert(memcmp(out, eea2_ciphertext, sizeof(out)) == 0);
+  nas_stream_encrypt_eea2(&stream_cipher, out);
+  ck_assert(memcmp(out, eea2_ciphertext, sizeof(out)) == 0);
+
+  /* In place */
+  nas_stream_encrypt_eea2(&stream_cipher, message);
+  ck_assert(memcmp(message, eea2_ciphertext, sizeof(message)) == 0);
+}
+END_TEST
+
+START_TEST(eea_test_sets_test)
+{
+  nas_stream_cipher_t stream_cipher;
+  uint8_t out[100];
+  size_t i;
+
+  for (i = 0; i < sizeof(eea_test_sets) / sizeof(eea_test_sets[0]); i++) {
+    eea_test_set_t *test_set = &eea_test_sets[i];
+
+    memset(&stream_cipher, 0, sizeof(stream_cipher));
+    stream_cipher.key = test_set->key;
+    stream_cipher.key_length = sizeof(test_set->key);
+    stream_cipher.count = test_set->count;
+    stream_cipher.bearer = test_set->bearer;
+    stream_cipher.direction = test_set->direction;
+    stream_cipher.message = test_set->plaintext;
+    stream_cipher.blength = test_set->blength;
+
+    nas_stream_encrypt_eea1(&stream_cipher, out);
+    ck_assert(
+      eea_output_matches(out, test_set->eea1_ciphertext, test_set->blength));
+    nas_stream_encrypt_eea2(&stream_cipher, out);
+    ck_assert(
+      eea_output_matches(out, test_set->eea2_ciphertext, test_set->blength));
+  }
+}
+END_TEST
+
+START_TEST(eia1_test_set_1_test)
+{
+  nas_stream_cipher_t stream_cipher = {0};
+  uint8_t mac[4] = {0};
+
+  stream_cipher.key = eia_key;
+  stream_cipher.key_length = sizeof(eia_key);
+  stream_cipher.count = 0x38a6f056;
+  stream_cipher.bearer = 0x1f;
+  stream_cipher.direction = 0;
+  stream_cipher.message = eia1_message;
+  stream_cipher.blength = 88;
+  nas_stream_encrypt_eia1(&stream_cipher, mac);
+  ck_assert(memcmp(mac, eia1_mac, sizeof(mac)) == 0);
+}
+END_TEST
+
+START_TEST(eia2_test_set_1_test)
+{
+  nas_stream_cipher_t stream_cipher = {0};
+  nas_aes128_key_t key_cache = {0};
+  uint8_t other_key[16] = {0};
+  uint8_t mac[4] = {0};
+
+  stream_cipher.key = eia_key;
+  stream_cipher.key_length = sizeof(eia_key);
+  stream_cipher.count = 0x38a6f056;
+  stream_cipher.bearer = 0x18;
+  stream_cipher.direction = 0;
+  stream_cipher.message = eia2_message;
+  stream_cipher.blength = 58;
+  nas_stream_encrypt_eia2(&stream_cipher, mac);
+  ck_assert(memcmp(mac, eia2_mac, sizeof(mac)) == 0);
+
+  /* A cache filled with another key is expanded again */
+  stream_cipher.key_cache = &key_cache;
+  stream_cipher.key = other_key;
+  nas_stream_encrypt_eia2(&stream_cipher, mac);
+  stream_cipher.key = eia_key;
+  nas_stream_encrypt_eia2(&stream_cipher, mac);
+  ck_assert(memcmp(key_cache.key, eia_key, sizeof(eia_key)) == 0);
+  ck_assert(memcmp(mac, eia2_mac, sizeof(mac)) == 0);
+}
+END_TEST
+
+START_TEST(eia2_test_set_2_test)
+{
+  nas_stream_cipher_t stream_cipher = {0};
+  uint8_t mac[4] = {0};
+
+  stream_cipher.key = eea_key;
+  stream_cipher.key_length = sizeof(eea_key);
+  stream_cipher.count = 0x398a59b4;
+  stream_cipher.bearer = 0x1a;
+  stream_cipher.direction = 1;
+  stream_cipher.message = eia2_message_2;
+  stream_cipher.blength = 64;
+  nas_stream_encrypt_eia2(&stream_cipher, mac);
+  ck_assert(memcmp(mac, eia2_mac_2, sizeof(mac)) == 0);
+}
+END_TEST
+
+Suite *nas_stream_cipher_suite(void)
+{
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("NAS stream cipher tests");
+
+  /* Core test case */
+  tc_core = tcase_create("3GPP test sets");
+  tcase_add_test(tc_core, eea1_test_set_1_test);
+  tcase_add_test(tc_core, eea2_test_set_1_test);
+  tcase_add_test(tc_core, eea_test_sets_test);
+  tcase_add_test(tc_core, eia1_test_set_1_test);
+  tcase_add_test(tc_core, eia2_test_set_1_test);
+  tcase_add_test(tc_core, eia2_test_set_2_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void)
+{
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = nas_stream_cipher_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
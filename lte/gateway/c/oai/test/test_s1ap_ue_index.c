@@ -0,0 +1,145 @@
+/*
+ * Licensed to the OpenAirInterface (OAI) Software Alliance under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The OpenAirInterface Software Alliance licenses this file to You under
+ * the Apache License, Version 2.0  (the "License"); you may not use this file
+ * except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *-------------------------------------------------------------------------------
+ * For more information about the OpenAirInterface (OAI) Software Alliance:
+ *      contact@openairinterface.org
+ */
+#include <check.h>
+#include <stdlib.h>
+
+#include "common_defs.h"
+#include "hashtable.h"
+#include "mme_config.h"
+#include "s1ap_mme.h"
+#include "s1ap_mme_nas_procedures.h"
+#include "s1ap_state.h"
+
+#define SOURCE_ASSOC_ID 1
+#define TARGET_ASSOC_ID 2
+#define TEST_MME_UE_S1AP_ID 7
+
+static s1ap_state_t *state;
+
+static void setup(void)
+{
+  mme_config.max_enbs = 2;
+  mme_config.max_ues = 8;
+  mme_config.use_stateless = false;
+  mme_config.use_stateless_per_ue = false;
+  ck_assert_int_eq(s1ap_state_init(), RETURNok);
+  state = s1ap_state_get();
+  for (sctp_assoc_id_t assoc_id = SOURCE_ASSOC_ID; assoc_id <= TARGET_ASSOC_ID;
+       assoc_id++) {
+    enb_description_t *enb = s1ap_new_enb(state);
+
+    enb->sctp_assoc_id = assoc_id;
+    enb->enb_id = assoc_id;
+    hashtable_ts_insert(&state->enbs, (const hash_key_t) assoc_id, enb);
+  }
+}
+
+static void teardown(void)
+{
+  s1ap_state_put(state);
+  s1ap_state_exit();
+}
+
+static ue_description_t *new_indexed_ue(
+  sctp_assoc_id_t assoc_id,
+  enb_ue_s1ap_id_t enb_ue_s1ap_id)
+{
+  ue_description_t *ue = s1ap_new_ue(state, assoc_id, enb_ue_s1ap_id);
+
+  ck_assert_ptr_ne(ue, NULL);
+  ue->mme_ue_s1ap_id = TEST_MME_UE_S1AP_ID;
+  s1ap_state_add_ue_mmeid(state, ue);
+  return ue;
+}
+
+/* Path switch indexes the target UE before it removes the source UE */
+START_TEST(path_switch_test)
+{
+  ue_description_t *source_ue = new_indexed_ue(SOURCE_ASSOC_ID, 1);
+  ue_description_t *target_ue = s1ap_new_ue(state, TARGET_ASSOC_ID, 2);
+
+  target_ue->mme_ue_s1ap_id = source_ue->mme_ue_s1ap_id;
+  s1ap_state_add_ue_mmeid(state, target_ue);
+  ck_assert_ptr_eq(
+    s1ap_state_get_ue_mmeid(state, TEST_MME_UE_S1AP_ID), target_ue);
+  s1ap_remove_ue(state, source_ue);
+  ck_assert_ptr_eq(
+    s1ap_state_get_ue_mmeid(state, TEST_MME_UE_S1AP_ID), target_ue);
+  s1ap_remove_ue(state, target_ue);
+  ck_assert_ptr_eq(s1ap_state_get_ue_mmeid(state, TEST_MME_UE_S1AP_ID), NULL);
+}
+END_TEST
+
+/*
+ * A UE re-attaching on another eNB gets the mme_ue_s1ap_id of its old UE
+ * description, which is only released later
+ */
+START_TEST(reattach_reuse_test)
+{
+  ue_description_t *old_ue = new_indexed_ue(SOURCE_ASSOC_ID, 1);
+  ue_description_t *new_ue = s1ap_new_ue(state, TARGET_ASSOC_ID, 2);
+  itti_mme_app_s1ap_mme_ue_id_notification_t notification = {
+    .enb_ue_s1ap_id = 2,
+    .mme_ue_s1ap_id = TEST_MME_UE_S1AP_ID,
+    .sctp_assoc_id = TARGET_ASSOC_ID,
+  };
+
+  s1ap_handle_mme_ue_id_notification(state, &notification);
+  ck_assert_ptr_eq(
+    s1ap_state_get_ue_mmeid(state, TEST_MME_UE_S1AP_ID), new_ue);
+  s1ap_remove_ue(state, old_ue);
+  ck_assert_ptr_eq(
+    s1ap_state_get_ue_mmeid(state, TEST_MME_UE_S1AP_ID), new_ue);
+}
+END_TEST
+
+Suite *s1ap_ue_index_suite(void)
+{
+  Suite *s;
+  TCase *tc_core;
+
+  s = suite_create("S1AP UE index tests");
+
+  /* Core test case */
+  tc_core = tcase_create("Reuse");
+  tcase_add_checked_fixture(tc_core, setup, teardown);
+  tcase_add_test(tc_core, path_switch_test);
+  tcase_add_test(tc_core, reattach_reuse_test);
+
+  suite_add_tcase(s, tc_core);
+
+  return s;
+}
+
+int main(void)
+{
+  int number_failed;
+  Suite *s;
+  SRunner *sr;
+
+  s = s1ap_ue_index_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  number_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+  return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
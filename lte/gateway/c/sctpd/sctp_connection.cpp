@@ -20,6 +20,8 @@
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #include "sctpd.h"
 #include "util.h"
 
@@ -27,6 +29,12 @@ namespace magma {
 namespace sctpd {
 
 const int NUM_EPOLL_EVENTS = 10;
+// Upper bound on the number of receive workers
+const uint32_t MAX_WORKERS = 64;
+// Consecutive read failures after which a socket is no longer drained
+const int MAX_RECV_FAILURES = 16;
+// Interval between two logs of the receive worker counters
+const std::chrono::seconds STATS_LOG_INTERVAL(60);
 
 SctpConnection::SctpConnection(const InitReq &req, SctpEventHandler &handler):
   _done(false),
@@ -39,6 +47,19 @@ SctpConnection::SctpConnection(const InitReq &req, SctpEventHandler &handler):
   if (sock < 0) throw std::exception();
 
   _sctp_desc = SctpDesc(sock);
+
+  auto num_workers = std::min(std::max(req.recv_workers(), 1u), MAX_WORKERS);
+  for (uint32_t i = 0; i < num_workers; i++) {
+    auto worker = std::make_unique<RecvWorker>();
+    worker->epoll_fd = epoll_create(1);
+    if (worker->epoll_fd < 0) {
+      MLOG_perror("epoll_create");
+      for (auto &w : _workers) close(w->epoll_fd);
+      close(sock);
+      throw std::exception();
+    }
+    _workers.push_back(std::move(worker));
+  }
 }
 
 void SctpConnection::Start()
@@ -46,6 +67,10 @@ void SctpConnection::Start()
   assert(_done == false);
   assert(_thread == nullptr);
 
+  for (auto &worker : _workers) {
+    worker->thread = std::make_unique<std::thread>(
+      &SctpConnection::RecvLoop, this, std::ref(*worker));
+  }
   _thread = std::make_unique<std::thread>(&SctpConnection::Listen, this);
 }
 
@@ -56,6 +81,10 @@ void SctpConnection::Close()
 
   _done = true;
   _thread->join();
+  for (auto &worker : _workers) {
+    worker->thread->join();
+    close(worker->epoll_fd);
+  }
 
   for (auto kv : _sctp_desc) {
     auto assoc = kv.second;
@@ -69,16 +98,27 @@ void SctpConnection::Send(
   uint32_t assoc_id,
   uint32_t stream,
   const std::string &msg)
+{
+  Send(assoc_id, stream, msg.c_str(), msg.size());
+}
+
+void SctpConnection::Send(
+  uint32_t assoc_id,
+  uint32_t stream,
+  const char *buf,
+  size_t len)
 {
   assert(_thread != nullptr);
 
-  auto assoc = _sctp_desc.getAssoc(assoc_id);
+  SctpAssoc assoc;
+  {
+    std::shared_lock<std::shared_timed_mutex> lock(_sctp_desc_mutex);
+    assoc = _sctp_desc.getAssoc(assoc_id);
+  }
   assert(assoc.sd >= 0);
 
-  auto buf = msg.c_str();
-  auto n = msg.size();
-  auto rc =
-    sctp_sendmsg(assoc.sd, buf, n, NULL, 0, htonl(assoc.ppid), 0, stream, 0, 0);
+  auto rc = sctp_sendmsg(
+    assoc.sd, buf, len, NULL, 0, htonl(assoc.ppid), 0, stream, 0, 0);
 
   if (rc < 0) {
     MLOG_perror("sctp_sendmsg");
@@ -86,11 +126,25 @@ void SctpConnection::Send(
   }
 }
 
+std::vector<SctpRecvStats> SctpConnection::GetRecvStats() const
+{
+  std::vector<SctpRecvStats> stats;
+
+  for (auto &worker : _workers) {
+    stats.push_back({worker->messages.load(),
+                     worker->bytes.load(),
+                     worker->delay_us.load(),
+                     worker->max_delay_us.load()});
+  }
+  return stats;
+}
+
 void SctpConnection::Listen()
 {
   int server_fd = _sctp_desc.sd();
   MLOG(MINFO) << "starting sctp connection listener sd = "
-              << std::to_string(server_fd);
+              << std::to_string(server_fd) << " with "
+              << std::to_string(_workers.size()) << " receive workers";
 
   int epoll_fd = epoll_create(1);
   if (epoll_fd < 0) {
@@ -108,11 +162,17 @@ void SctpConnection::Listen()
   }
 
   struct epoll_event events[NUM_EPOLL_EVENTS];
+  auto next_stats = std::chrono::steady_clock::now() + STATS_LOG_INTERVAL;
 
   while (!_done) {
     int timeout = 100; // milliseconds = .1s
     int num_events = epoll_wait(epoll_fd, events, NUM_EPOLL_EVENTS, timeout);
 
+    if (std::chrono::steady_clock::now() >= next_stats) {
+      LogRecvStats();
+      next_stats += STATS_LOG_INTERVAL;
+    }
+
     switch (num_events) {
       case -1: { // errored
         if (errno == EINTR) continue;
@@ -128,40 +188,142 @@ void SctpConnection::Listen()
     }
 
     for (int i = 0; i < num_events; i++) {
-      if (events[i].data.fd == server_fd) {
-        // new connection
-        int client_sd = accept(server_fd, NULL, NULL);
-        if (client_sd < 0) {
-          if (errno == ECONNABORTED || errno == EINTR) continue;
-          MLOG_perror("accept");
-          std::terminate();
-        }
+      // new connection
+      int client_sd = accept(server_fd, NULL, NULL);
+      if (client_sd < 0) {
+        if (errno == ECONNABORTED || errno == EINTR) continue;
+        MLOG_perror("accept");
+        std::terminate();
+      }
+
+      Dispatch(client_sd);
+    }
+  }
+
+  close(epoll_fd);
+}
+
+void SctpConnection::Dispatch(int sd)
+{
+  // One-to-one sockets carry a single association, known once accepted
+  struct sctp_status status;
+  socklen_t len = sizeof(status);
+  uint32_t key = sd;
+
+  memset(&status, 0, sizeof(status));
+  if (getsockopt(sd, IPPROTO_SCTP, SCTP_STATUS, &status, &len) == 0) {
+    key = status.sstat_assoc_id;
+  } else {
+    MLOG_perror("getsockopt");
+  }
+
+  auto &worker = *_workers[key % _workers.size()];
+
+  struct epoll_event event;
+  event.events = EPOLLIN | EPOLLET;
+  event.data.fd = sd;
+
+  if (epoll_ctl(worker.epoll_fd, EPOLL_CTL_ADD, sd, &event) < 0) {
+    MLOG_perror("epoll_ctl");
+    std::terminate();
+  }
+}
+
+void SctpConnection::RecvLoop(RecvWorker &worker)
+{
+  struct epoll_event events[NUM_EPOLL_EVENTS];
+
+  while (!_done) {
+    int timeout = 100; // milliseconds = .1s
+    int num_events =
+      epoll_wait(worker.epoll_fd, events, NUM_EPOLL_EVENTS, timeout);
+
+    if (num_events < 0) {
+      if (errno == EINTR) continue;
+      MLOG_perror("epoll_wait");
+      std::terminate();
+    }
 
-        struct epoll_event event;
-        event.events = EPOLLIN;
-        event.data.fd = client_sd;
+    auto wakeup = std::chrono::steady_clock::now();
 
-        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_sd, &event) < 0) {
+    for (int i = 0; i < num_events; i++) {
+      int client_sd = events[i].data.fd;
+
+      auto status = DrainClientSock(worker, client_sd, wakeup);
+
+      if (status == SctpStatus::DISCONNECT) {
+        if (epoll_ctl(worker.epoll_fd, EPOLL_CTL_DEL, client_sd, nullptr) < 0) {
           MLOG_perror("epoll_ctl");
           std::terminate();
         }
-      } else {
-        int client_sd = events[i].data.fd;
-
-        auto status = HandleClientSock(client_sd);
+      }
+    }
+  }
+}
 
-        if (status == SctpStatus::DISCONNECT) {
-          if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client_sd, nullptr) < 0) {
-            MLOG_perror("epoll_ctl");
-            std::terminate();
-          }
+SctpStatus SctpConnection::DrainClientSock(
+  RecvWorker &worker,
+  int sd,
+  std::chrono::steady_clock::time_point wakeup)
+{
+  int failures = 0;
+
+  // Sockets are edge triggered, read until there is nothing left
+  while (true) {
+    auto status = HandleClientSock(worker, sd, wakeup);
+
+    switch (status) {
+      case SctpStatus::OK: {
+        failures = 0;
+      } break;
+      case SctpStatus::FAILURE: {
+        // Do not spin on a socket that keeps failing. Failures also include
+        // dropped messages, more may be pending: re-arm the socket so that
+        // epoll reports it again if it is still readable
+        if (++failures >= MAX_RECV_FAILURES) {
+          RearmClientSock(worker, sd);
+          return status;
         }
+      } break;
+      default: {
+        return status;
       }
     }
   }
 }
 
-SctpStatus SctpConnection::HandleClientSock(int sd)
+void SctpConnection::RearmClientSock(RecvWorker &worker, int sd)
+{
+  struct epoll_event event;
+  event.events = EPOLLIN | EPOLLET;
+  event.data.fd = sd;
+
+  if (epoll_ctl(worker.epoll_fd, EPOLL_CTL_MOD, sd, &event) < 0) {
+    MLOG_perror("epoll_ctl");
+    std::terminate();
+  }
+}
+
+void SctpConnection::LogRecvStats() const
+{
+  auto stats = GetRecvStats();
+
+  for (size_t i = 0; i < stats.size(); i++) {
+    auto avg_delay_us =
+      stats[i].messages > 0 ? stats[i].delay_us / stats[i].messages : 0;
+
+    MLOG(MINFO) << "sctp recv worker " << std::to_string(i)
+                << ": messages = " << std::to_string(stats[i].messages)
+                << ", bytes = " << std::to_string(stats[i].bytes)
+                << ", avg delay us = " << std::to_string(avg_delay_us)
+                << ", max delay us = " << std::to_string(stats[i].max_delay_us);
+  }
+}
+
+SctpStatus SctpConnection::HandleClientSock(
+  RecvWorker &worker,
+  int sd,
+  std::chrono::steady_clock::time_point wakeup)
 {
   assert(sd >= 0);
 
@@ -169,11 +331,13 @@ SctpStatus SctpConnection::HandleClientSock(int sd)
 
   char msg[SCTP_RECV_BUFFER_SIZE];
   struct sctp_sndrcvinfo sinfo;
-  int flags;
+  // Passed down to recvmsg, the socket itself stays blocking for senders
+  int flags = MSG_DONTWAIT;
 
   int n = sctp_recvmsg(sd, msg, sizeof(msg), nullptr, nullptr, &sinfo, &flags);
 
   if (n < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) return SctpStatus::EMPTY;
     MLOG_perror("sctp_recvmsg");
     return SctpStatus::FAILURE;
   }
@@ -198,8 +362,9 @@ SctpStatus SctpConnection::HandleClientSock(int sd)
     }
   } else {
     // Data payload received
-    SctpAssoc &&assoc = SctpAssoc();
+    SctpAssoc assoc;
     try {
+      std::shared_lock<std::shared_timed_mutex> lock(_sctp_desc_mutex);
       assoc = _sctp_desc.getAssoc(sinfo.sinfo_assoc_id);
     } catch (std::out_of_range) {
       MLOG(MERROR) << "Received sctp msg for untracked assoc: "
@@ -223,6 +388,16 @@ SctpStatus SctpConnection::HandleClientSock(int sd)
                  << std::to_string(sinfo.sinfo_assoc_id) << ":"
                  << std::to_string(sinfo.sinfo_stream);
 
+    auto delay_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::steady_clock::now() - wakeup)
+                      .count();
+    worker.messages++;
+    worker.bytes += n;
+    worker.delay_us += delay_us;
+    if ((uint64_t) delay_us > worker.max_delay_us) {
+      worker.max_delay_us = delay_us;
+    }
+
     _handler.HandleRecv(
       sinfo.sinfo_assoc_id, sinfo.sinfo_stream, std::string(msg, n));
 
@@ -263,7 +438,10 @@ SctpStatus SctpConnection::HandleComUp(int sd, struct sctp_assoc_change *change)
   assoc.instreams = change->sac_inbound_streams;
   assoc.outstreams = change->sac_outbound_streams;
 
-  _sctp_desc.addAssoc(assoc);
+  {
+    std::unique_lock<std::shared_timed_mutex> lock(_sctp_desc_mutex);
+    _sctp_desc.addAssoc(assoc);
+  }
 
   _handler.HandleNewAssoc(
     change->sac_assoc_id,
@@ -278,7 +456,10 @@ SctpStatus SctpConnection::HandleComDown(uint32_t assoc_id)
   MLOG(MDEBUG) << "Sending close connection for assoc_id "
                << std::to_string(assoc_id);
 
-  _sctp_desc.delAssoc(assoc_id);
+  {
+    std::unique_lock<std::shared_timed_mutex> lock(_sctp_desc_mutex);
+    _sctp_desc.delAssoc(assoc_id);
+  }
 
   _handler.HandleCloseAssoc(assoc_id, false);
 
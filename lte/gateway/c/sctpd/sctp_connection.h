@@ -10,9 +10,12 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <memory>
+#include <shared_mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <lte/protos/sctpd.grpc.pb.h>
 
@@ -28,6 +31,15 @@ enum class SctpStatus {
   OK,         // Sctp event was ok
   FAILURE,    // General failure - nonfatal
   DISCONNECT, // Sctp assoc disconnected
+  EMPTY,      // No more data to read on the Sctp socket
+};
+
+// Receive counters of a receive worker
+struct SctpRecvStats {
+  uint64_t messages;     // Data messages relayed upstream
+  uint64_t bytes;        // Payload bytes relayed upstream
+  uint64_t delay_us;     // Total time messages waited between wakeup and relay
+  uint64_t max_delay_us; // Longest time a message waited before relay
 };
 
 // Interface for upstream Sctp event handling
@@ -50,6 +62,11 @@ class SctpEventHandler {
 };
 
 // Manages Sctp connection including setup/teardown and send/recv
+//
+// A listener thread accepts new associations and shards them by assoc_id
+// over req.recv_workers() receive workers. Each worker owns the sockets of its
+// associations and drains them fully on every wakeup, so the events of an
+// association are relayed in order while associations are served in parallel.
 class SctpConnection {
  public:
   // Construct as per the InitReq and sending upstream events to handler
@@ -62,12 +79,43 @@ class SctpConnection {
 
   // Send a message on the Sctp connection to (assoc_id, stream)
   void Send(uint32_t assoc_id, uint32_t stream, const std::string &msg);
+  // Send len bytes of buf on the Sctp connection to (assoc_id, stream)
+  void Send(uint32_t assoc_id, uint32_t stream, const char *buf, size_t len);
+
+  // Return a snapshot of the counters of every receive worker
+  std::vector<SctpRecvStats> GetRecvStats() const;
 
  private:
+  // State of a receive worker, see RecvLoop
+  struct RecvWorker {
+    int epoll_fd = -1;
+    std::unique_ptr<std::thread> thread;
+    std::atomic<uint64_t> messages{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> delay_us{0};
+    std::atomic<uint64_t> max_delay_us{0};
+  };
+
   // Listener loop run in separate thread by Start
   void Listen();
+  // Hand a newly accepted client socket over to its receive worker
+  void Dispatch(int sd);
+  // Receive loop of worker run in separate thread by Start
+  void RecvLoop(RecvWorker &worker);
+  // Read every pending message of client socket sd, woken up at wakeup
+  SctpStatus DrainClientSock(
+    RecvWorker &worker,
+    int sd,
+    std::chrono::steady_clock::time_point wakeup);
+  // Have epoll report client socket sd again if it is readable
+  void RearmClientSock(RecvWorker &worker, int sd);
+  // Log the counters of every receive worker
+  void LogRecvStats() const;
   // Handle an event on a client socket
-  SctpStatus HandleClientSock(int sd);
+  SctpStatus HandleClientSock(
+    RecvWorker &worker,
+    int sd,
+    std::chrono::steady_clock::time_point wakeup);
   // Handle an association change event for an association sd/change
   SctpStatus HandleAssocChange(int sd, struct sctp_assoc_change *change);
   // Handle a comup event on an association sd/change
@@ -85,6 +133,10 @@ class SctpConnection {
   int _ppid;
   // Keeps track of sctp and assocation info
   SctpDesc _sctp_desc;
+  // Guards _sctp_desc, shared by the workers and the senders
+  mutable std::shared_timed_mutex _sctp_desc_mutex;
+  // Receive workers, associations are sharded by assoc_id
+  std::vector<std::unique_ptr<RecvWorker>> _workers;
   // Thread for sctp listener to run on
   std::unique_ptr<std::thread> _thread;
 };
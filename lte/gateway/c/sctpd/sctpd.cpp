@@ -15,14 +15,18 @@
 
 #include "sctpd_downlink_impl.h"
 #include "sctpd_event_handler.h"
+#include "sctpd_ring_transport.h"
 #include "sctpd_uplink_client.h"
+#include "sctpd_uplink_stream.h"
 #include "util.h"
 
 using grpc::Server;
 using grpc::ServerBuilder;
 using magma::sctpd::SctpdDownlinkImpl;
 using magma::sctpd::SctpdEventHandler;
+using magma::sctpd::SctpdRingTransport;
 using magma::sctpd::SctpdUplinkClient;
+using magma::sctpd::SctpdUplinkStream;
 
 
 int signalMask(void)
@@ -86,18 +90,30 @@ int main()
     grpc::CreateChannel(UPSTREAM_SOCK, grpc::InsecureChannelCredentials());
 
   SctpdUplinkClient client(channel);
-  SctpdEventHandler handler(client);
+  SctpdUplinkStream stream(channel, client);
+  // The ring sends downlink packets through the service created below
+  SctpdDownlinkImpl *downlink = nullptr;
+  SctpdRingTransport ring(
+    [&downlink](uint32_t assoc_id, uint32_t stream, const char *buf, size_t len) {
+      return downlink->SendRaw(assoc_id, stream, buf, len);
+    });
+  SctpdEventHandler handler(client, &stream, &ring);
   SctpdDownlinkImpl service(handler);
+  downlink = &service;
 
   ServerBuilder builder;
   builder.AddListeningPort(DOWNSTREAM_SOCK, grpc::InsecureServerCredentials());
   builder.RegisterService(&service);
 
+  stream.Start();
+  ring.Start();
   std::unique_ptr<Server> sctpd_dl_server = builder.BuildAndStart();
 
   int end = 0;
   while (end == 0) {
     signalHandler(&end, sctpd_dl_server, service);
   }
+  ring.Stop();
+  stream.Stop();
   return 0;
 }
@@ -68,9 +68,7 @@ Status SctpdDownlinkImpl::SendDl(
 {
   MLOG(MDEBUG) << "SctpdDownlinkImpl::SendDl starting";
 
-  try {
-    _sctp_connection->Send(req->assoc_id(), req->stream(), req->payload());
-  } catch (...) {
+  if (!SendPdu(*req)) {
     res->set_result(SendDlRes::SEND_DL_FAIL);
     return Status::OK;
   }
@@ -79,6 +77,57 @@ Status SctpdDownlinkImpl::SendDl(
   return Status::OK;
 }
 
+Status SctpdDownlinkImpl::SendDlStream(
+  ServerContext *context,
+  ServerReaderWriter<SendDlBatchRes, SendDlBatch> *stream)
+{
+  MLOG(MDEBUG) << "SctpdDownlinkImpl::SendDlStream starting";
+
+  SendDlBatch batch;
+  while (stream->Read(&batch)) {
+    SendDlBatchRes res;
+
+    res.set_first_seq(batch.first_seq());
+    res.set_count(batch.pdus_size());
+    for (int i = 0; i < batch.pdus_size(); i++) {
+      if (!SendPdu(batch.pdus(i))) {
+        res.add_failed_seqs(batch.first_seq() + i);
+      }
+    }
+
+    if (!stream->Write(res)) break;
+  }
+
+  MLOG(MDEBUG) << "SctpdDownlinkImpl::SendDlStream done";
+  return Status::OK;
+}
+
+bool SctpdDownlinkImpl::SendPdu(const SendDlReq &req)
+{
+  return SendRaw(
+    req.assoc_id(), req.stream(), req.payload().data(), req.payload().size());
+}
+
+bool SctpdDownlinkImpl::SendRaw(
+  uint32_t assoc_id,
+  uint32_t stream,
+  const char *buf,
+  size_t len)
+{
+  if (_sctp_connection == nullptr) {
+    MLOG(MERROR) << "SctpdDownlinkImpl::SendRaw sctp not initialized";
+    return false;
+  }
+
+  try {
+    _sctp_connection->Send(assoc_id, stream, buf, len);
+  } catch (...) {
+    return false;
+  }
+
+  return true;
+}
+
 void SctpdDownlinkImpl::stop()
 {
   if (_sctp_connection != nullptr) {
@@ -23,6 +23,7 @@ namespace magma {
 namespace sctpd {
 
 using grpc::ServerContext;
+using grpc::ServerReaderWriter;
 using grpc::Status;
 
 // Implements the sctpd downlink server
@@ -41,10 +42,23 @@ class SctpdDownlinkImpl final : public SctpdDownlink::Service {
     const SendDlReq *request,
     SendDlRes *response) override;
 
+  // Implementation of SctpdDownlink.SendDlStream method (see sctpd.proto for
+  // more info)
+  Status SendDlStream(
+    ServerContext *context,
+    ServerReaderWriter<SendDlBatchRes, SendDlBatch> *stream) override;
+
+  // Send a downlink packet received outside of GRPC, returns false if it
+  // could not be sent
+  bool SendRaw(uint32_t assoc_id, uint32_t stream, const char *buf, size_t len);
+
   // Close SCTP connection for this SctpdDownlink.
   void stop();
 
  private:
+  // Send a downlink packet, returns false if it could not be sent
+  bool SendPdu(const SendDlReq &req);
+
   SctpEventHandler &_uplink_handler;
   std::unique_ptr<SctpConnection> _sctp_connection;
 };
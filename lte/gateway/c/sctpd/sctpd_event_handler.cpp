@@ -14,7 +14,18 @@
 namespace magma {
 namespace sctpd {
 
-SctpdEventHandler::SctpdEventHandler(SctpdUplinkClient &client): _client(client)
+SctpdEventHandler::SctpdEventHandler(SctpdUplinkClient &client):
+  SctpdEventHandler(client, nullptr)
+{
+}
+
+SctpdEventHandler::SctpdEventHandler(
+  SctpdUplinkClient &client,
+  SctpdUplinkStream *stream,
+  SctpdRingTransport *ring):
+  _client(client),
+  _stream(stream),
+  _ring(ring)
 {
 }
 
@@ -23,6 +34,10 @@ void SctpdEventHandler::HandleNewAssoc(
   uint32_t instreams,
   uint32_t outstreams)
 {
+  if (_ring != nullptr && _ring->PushNewAssoc(assoc_id, instreams, outstreams)) {
+    return;
+  }
+
   NewAssocReq req;
   NewAssocRes res;
 
@@ -30,17 +45,33 @@ void SctpdEventHandler::HandleNewAssoc(
   req.set_instreams(instreams);
   req.set_outstreams(outstreams);
 
+  if (_stream != nullptr) {
+    UlEvent event;
+    event.mutable_new_assoc()->Swap(&req);
+    _stream->Push(std::move(event));
+    return;
+  }
+
   _client.newAssoc(req, &res);
 }
 
 void SctpdEventHandler::HandleCloseAssoc(uint32_t assoc_id, bool reset)
 {
+  if (_ring != nullptr && _ring->PushCloseAssoc(assoc_id, reset)) return;
+
   CloseAssocReq req;
   CloseAssocRes res;
 
   req.set_assoc_id(assoc_id);
   req.set_is_reset(reset);
 
+  if (_stream != nullptr) {
+    UlEvent event;
+    event.mutable_close_assoc()->Swap(&req);
+    _stream->Push(std::move(event));
+    return;
+  }
+
   _client.closeAssoc(req, &res);
 }
 
@@ -49,6 +80,8 @@ void SctpdEventHandler::HandleRecv(
   uint32_t stream,
   const std::string &payload)
 {
+  if (_ring != nullptr && _ring->PushData(assoc_id, stream, payload)) return;
+
   SendUlReq req;
   SendUlRes res;
 
@@ -56,6 +89,13 @@ void SctpdEventHandler::HandleRecv(
   req.set_stream(stream);
   req.set_payload(payload);
 
+  if (_stream != nullptr) {
+    UlEvent event;
+    event.mutable_send_ul()->Swap(&req);
+    _stream->Push(std::move(event));
+    return;
+  }
+
   _client.sendUl(req, &res);
 }
 
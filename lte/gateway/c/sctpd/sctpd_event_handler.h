@@ -11,7 +11,9 @@
 
 #include "sctp_connection.h"
 
+#include "sctpd_ring_transport.h"
 #include "sctpd_uplink_client.h"
+#include "sctpd_uplink_stream.h"
 
 namespace magma {
 namespace sctpd {
@@ -21,6 +23,12 @@ class SctpdEventHandler : public SctpEventHandler {
  public:
   // Construct SctpdEventHandler that communicates to MME over client
   explicit SctpdEventHandler(SctpdUplinkClient &client);
+  // Construct SctpdEventHandler that pipelines events to MME over stream, or
+  // writes them to the shared memory ring while MME is attached to it
+  SctpdEventHandler(
+    SctpdUplinkClient &client,
+    SctpdUplinkStream *stream,
+    SctpdRingTransport *ring = nullptr);
 
   // Relay new assocation to MME over GRPC
   void HandleNewAssoc(
@@ -39,6 +47,8 @@ class SctpdEventHandler : public SctpEventHandler {
 
  private:
   SctpdUplinkClient &_client;
+  SctpdUplinkStream *_stream;
+  SctpdRingTransport *_ring;
 };
 
 } // namespace sctpd
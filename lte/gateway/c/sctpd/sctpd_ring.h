@@ -0,0 +1,253 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Shared memory transport between sctpd and MME
+//
+// MME creates a memfd holding an uplink ring (sctpd -> MME) followed by a
+// downlink ring (MME -> sctpd), plus one eventfd per ring, and hands them to
+// sctpd over SCTPD_RING_SOCK. Each ring has a single producer and a single
+// consumer, the producer only signals the eventfd while the consumer sleeps.
+// Association events are carried in-band so that they stay ordered with the
+// packets of the association.
+
+#define SCTPD_RING_SOCK "/tmp/sctpd_ring.sock"
+
+namespace magma {
+namespace sctpd {
+
+static_assert(
+  ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+  "ring atomics must be lock free to be shared between processes");
+
+constexpr uint32_t kRingMagic = 0x53435250; // "SCRP"
+constexpr uint32_t kRingVersion = 1;
+constexpr uint64_t kRingCapacity = 4 << 20;
+
+enum class RingRecordType : uint16_t {
+  PAD = 0,          // Filler up to the end of the ring, skipped
+  DATA = 1,         // S1AP packet of an association stream
+  NEW_ASSOC = 2,    // New association, see instreams/outstreams
+  CLOSE_ASSOC = 3,  // Association shutdown
+  RESET_ASSOC = 4,  // Association reset
+  SEND_FAILED = 5,  // Downlink packet tagged origin/tag could not be sent
+};
+
+// Record header, followed by length bytes of payload
+struct RingRecord {
+  uint32_t length;
+  RingRecordType type;
+  uint16_t stream;
+  uint32_t assoc_id;
+  uint32_t instreams;
+  uint32_t outstreams;
+  // Opaque to sctpd, echoed back in SEND_FAILED records
+  uint32_t origin;
+  uint32_t tag;
+  uint32_t reserved;
+
+  const char *payload() const
+  {
+    return reinterpret_cast<const char *>(this + 1);
+  }
+  char *payload() { return reinterpret_cast<char *>(this + 1); }
+};
+
+static_assert(sizeof(RingRecord) == 32, "records are 32 bytes aligned");
+
+// Head of a ring in shared memory, followed by capacity bytes of records
+struct RingHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t capacity;
+  // Bytes consumed, only written by the consumer
+  alignas(64) std::atomic<uint64_t> head;
+  // Bytes produced, only written by the producer
+  alignas(64) std::atomic<uint64_t> tail;
+  // Set by the consumer before sleeping on the eventfd
+  alignas(64) std::atomic<uint32_t> consumer_waiting;
+};
+
+// Handoff message sent along with the memfd and eventfds
+struct RingHandoff {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t capacity;
+};
+
+// View of a single producer single consumer ring mapped in this process
+class SpscRing {
+ public:
+  // Size of the shared memory used by a ring of capacity bytes
+  static size_t RegionSize(uint64_t capacity)
+  {
+    return sizeof(RingHeader) + capacity;
+  }
+
+  // Initialize a ring in freshly mapped memory
+  static void Format(void *base, uint64_t capacity)
+  {
+    auto header = new (base) RingHeader();
+    header->magic = kRingMagic;
+    header->version = kRingVersion;
+    header->capacity = capacity;
+    header->head.store(0);
+    header->tail.store(0);
+    header->consumer_waiting.store(0);
+  }
+
+  SpscRing(): _header(nullptr), _data(nullptr), _mask(0) {}
+
+  // Map the ring formatted at base, returns false if it is not a valid ring
+  bool Attach(void *base, uint64_t capacity)
+  {
+    auto header = static_cast<RingHeader *>(base);
+    if (
+      header->magic != kRingMagic || header->version != kRingVersion ||
+      header->capacity != capacity || (capacity & (capacity - 1)) != 0) {
+      return false;
+    }
+    _header = header;
+    _data = reinterpret_cast<char *>(header + 1);
+    _mask = capacity - 1;
+    _pending_pad = 0;
+    _peeked_size = 0;
+    _corrupted = false;
+    return true;
+  }
+
+  // Largest payload a record can carry
+  uint32_t MaxPayload() const
+  {
+    return static_cast<uint32_t>((_mask + 1) / 4 - sizeof(RingRecord));
+  }
+
+  // Producer: reserve room for a record of length bytes of payload, returns
+  // nullptr while the ring is full. The record is published by Commit
+  RingRecord *Reserve(uint32_t length)
+  {
+    uint64_t capacity = _mask + 1;
+    uint64_t size = RecordSize(length);
+    uint64_t tail = _header->tail.load(std::memory_order_relaxed);
+    uint64_t head = _header->head.load(std::memory_order_acquire);
+    uint64_t to_end = capacity - (tail & _mask);
+    // Records never wrap, skip the end of the ring when it is too short
+    uint64_t needed = size <= to_end ? size : size + to_end;
+
+    if (length > MaxPayload() || capacity - (tail - head) < needed) {
+      return nullptr;
+    }
+    if (size > to_end) {
+      auto pad = reinterpret_cast<RingRecord *>(_data + (tail & _mask));
+      memset(pad, 0, sizeof(RingRecord));
+      pad->type = RingRecordType::PAD;
+      pad->length = static_cast<uint32_t>(to_end - sizeof(RingRecord));
+      _pending_pad = to_end;
+      tail += to_end;
+    } else {
+      _pending_pad = 0;
+    }
+    auto record = reinterpret_cast<RingRecord *>(_data + (tail & _mask));
+    memset(record, 0, sizeof(RingRecord));
+    record->length = length;
+    return record;
+  }
+
+  // Producer: publish the record returned by Reserve, returns whether the
+  // consumer sleeps and needs to be woken up
+  bool Commit(const RingRecord *record)
+  {
+    uint64_t tail = _header->tail.load(std::memory_order_relaxed) +
+                    _pending_pad + RecordSize(record->length);
+    _header->tail.store(tail, std::memory_order_seq_cst);
+    return _header->consumer_waiting.load(std::memory_order_seq_cst) != 0;
+  }
+
+  // Consumer: next record, or nullptr if the ring is empty or corrupted. PAD
+  // records are skipped. The record stays valid until Release, its length is
+  // checked to lie within the produced bytes
+  const RingRecord *Peek()
+  {
+    while (!_corrupted) {
+      uint64_t head = _header->head.load(std::memory_order_relaxed);
+      uint64_t tail = _header->tail.load(std::memory_order_acquire);
+      if (head == tail) return nullptr;
+      auto record = reinterpret_cast<const RingRecord *>(_data + (head & _mask));
+      // The producer shares the memory, read the length once
+      uint32_t length = record->length;
+      uint64_t size = RecordSize(length);
+      uint64_t to_end = _mask + 1 - (head & _mask);
+      if (
+        tail - head > _mask + 1 || size > tail - head || size > to_end ||
+        (record->type != RingRecordType::PAD && length > MaxPayload())) {
+        _corrupted = true;
+        return nullptr;
+      }
+      _peeked_size = size;
+      if (record->type != RingRecordType::PAD) return record;
+      Release(record);
+    }
+    return nullptr;
+  }
+
+  // Consumer: free the record returned by Peek
+  void Release(const RingRecord *record)
+  {
+    uint64_t head = _header->head.load(std::memory_order_relaxed);
+    _header->head.store(head + _peeked_size, std::memory_order_release);
+  }
+
+  // Consumer: whether Peek found a record overflowing the ring, after which
+  // the ring is not read anymore
+  bool Corrupted() const { return _corrupted; }
+
+  // Consumer: announce that it is about to sleep, returns false if records
+  // were produced meanwhile and the consumer should not sleep
+  bool PrepareWait()
+  {
+    _header->consumer_waiting.store(1, std::memory_order_seq_cst);
+    if (
+      _header->tail.load(std::memory_order_seq_cst) !=
+      _header->head.load(std::memory_order_relaxed)) {
+      _header->consumer_waiting.store(0, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  // Consumer: done sleeping
+  void FinishWait()
+  {
+    _header->consumer_waiting.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  static uint64_t RecordSize(uint32_t length)
+  {
+    return (sizeof(RingRecord) + length + sizeof(RingRecord) - 1) &
+           ~(uint64_t)(sizeof(RingRecord) - 1);
+  }
+
+  RingHeader *_header;
+  char *_data;
+  uint64_t _mask;
+  uint64_t _pending_pad = 0;
+  uint64_t _peeked_size = 0;
+  bool _corrupted = false;
+};
+
+} // namespace sctpd
+} // namespace magma
@@ -0,0 +1,334 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "sctpd_ring_transport.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "util.h"
+
+namespace magma {
+namespace sctpd {
+
+// Time waited between two attempts to write to a full uplink ring
+const int RING_FULL_SLEEP_US = 50;
+// Number of fds handed over by MME: memfd, uplink and downlink eventfds
+const int RING_HANDOFF_FDS = 3;
+
+SctpdRingTransport::SctpdRingTransport(SendDlHandler send_dl):
+  _send_dl(std::move(send_dl)),
+  _attached(false),
+  _done(false),
+  _base(nullptr),
+  _size(0),
+  _ul_efd(-1),
+  _dl_efd(-1),
+  _conn_sd(-1),
+  _thread(nullptr)
+{
+}
+
+SctpdRingTransport::~SctpdRingTransport()
+{
+  Stop();
+}
+
+void SctpdRingTransport::Start()
+{
+  assert(_thread == nullptr);
+
+  _done = false;
+  _thread = std::make_unique<std::thread>(&SctpdRingTransport::Run, this);
+}
+
+void SctpdRingTransport::Stop()
+{
+  if (_thread == nullptr) return;
+
+  _done = true;
+  _thread->join();
+  _thread = nullptr;
+}
+
+bool SctpdRingTransport::PushData(
+  uint32_t assoc_id,
+  uint32_t stream,
+  const std::string &payload)
+{
+  RingRecord header = {};
+
+  header.length = payload.size();
+  header.type = RingRecordType::DATA;
+  header.stream = stream;
+  header.assoc_id = assoc_id;
+
+  return Push(header, payload.data(), true);
+}
+
+bool SctpdRingTransport::PushNewAssoc(
+  uint32_t assoc_id,
+  uint32_t instreams,
+  uint32_t outstreams)
+{
+  RingRecord header = {};
+
+  header.type = RingRecordType::NEW_ASSOC;
+  header.assoc_id = assoc_id;
+  header.instreams = instreams;
+  header.outstreams = outstreams;
+
+  return Push(header, nullptr, true);
+}
+
+bool SctpdRingTransport::PushCloseAssoc(uint32_t assoc_id, bool reset)
+{
+  RingRecord header = {};
+
+  header.type =
+    reset ? RingRecordType::RESET_ASSOC : RingRecordType::CLOSE_ASSOC;
+  header.assoc_id = assoc_id;
+
+  return Push(header, nullptr, true);
+}
+
+bool SctpdRingTransport::Push(
+  const RingRecord &header,
+  const char *payload,
+  bool wait)
+{
+  if (!_attached) return false;
+
+  std::unique_lock<std::mutex> lock(_ul_mutex);
+  RingRecord *record;
+
+  // Wait for MME to make room, unless it goes away meanwhile. Detach unmaps
+  // the rings under the lock, so check again every time it is taken
+  while (true) {
+    if (!_attached) return false;
+    record = _ul_ring.Reserve(header.length);
+    if (record != nullptr) break;
+    if (!wait || header.length > _ul_ring.MaxPayload()) return false;
+    lock.unlock();
+    usleep(RING_FULL_SLEEP_US);
+    lock.lock();
+  }
+
+  *record = header;
+  if (header.length > 0) {
+    memcpy(record->payload(), payload, header.length);
+  }
+  if (_ul_ring.Commit(record)) {
+    uint64_t one = 1;
+    if (write(_ul_efd, &one, sizeof(one)) < 0) {
+      MLOG_perror("write eventfd");
+    }
+  }
+  return true;
+}
+
+void SctpdRingTransport::Run()
+{
+  struct sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, SCTPD_RING_SOCK, sizeof(addr.sun_path) - 1);
+
+  int listen_sd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (listen_sd < 0) {
+    MLOG_perror("socket");
+    return;
+  }
+  unlink(SCTPD_RING_SOCK);
+  if (
+    bind(listen_sd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+    listen(listen_sd, 1) < 0) {
+    MLOG_perror("bind");
+    close(listen_sd);
+    return;
+  }
+
+  MLOG(MINFO) << "waiting for MME rings on " << SCTPD_RING_SOCK;
+
+  while (!_done) {
+    struct pollfd fds[3];
+    int nfds = 0;
+    int timeout = 100; // milliseconds = .1s
+
+    fds[nfds++] = {listen_sd, POLLIN, 0};
+    if (_attached) {
+      fds[nfds++] = {_conn_sd, POLLIN, 0};
+      fds[nfds++] = {_dl_efd, POLLIN, 0};
+      // Only sleep once the downlink ring is known to be empty
+      if (!_dl_ring.PrepareWait()) timeout = 0;
+    }
+
+    int rc = poll(fds, nfds, timeout);
+    if (_attached) _dl_ring.FinishWait();
+    if (rc < 0) {
+      if (errno == EINTR) continue;
+      MLOG_perror("poll");
+      break;
+    }
+
+    if (_attached && (fds[2].revents & POLLIN)) {
+      uint64_t count;
+      if (read(_dl_efd, &count, sizeof(count)) < 0) {
+        MLOG_perror("read eventfd");
+      }
+    }
+    if (_attached) DrainDownlink();
+
+    if (_attached && (fds[1].revents & (POLLIN | POLLHUP | POLLERR))) {
+      // MME only ever closes the handoff socket
+      MLOG(MINFO) << "MME closed its rings, relaying over GRPC";
+      Detach();
+    }
+
+    if (fds[0].revents & POLLIN) {
+      int conn_sd = accept4(listen_sd, nullptr, nullptr, SOCK_CLOEXEC);
+      if (conn_sd < 0) {
+        MLOG_perror("accept");
+        continue;
+      }
+      if (_attached) Detach();
+      if (!Attach(conn_sd)) close(conn_sd);
+    }
+  }
+
+  if (_attached) Detach();
+  close(listen_sd);
+  unlink(SCTPD_RING_SOCK);
+}
+
+bool SctpdRingTransport::Attach(int conn_sd)
+{
+  RingHandoff handoff;
+  struct iovec iov = {&handoff, sizeof(handoff)};
+  char control[CMSG_SPACE(RING_HANDOFF_FDS * sizeof(int))];
+  struct msghdr msg = {};
+  int fds[RING_HANDOFF_FDS];
+
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  if (recvmsg(conn_sd, &msg, MSG_CMSG_CLOEXEC) != sizeof(handoff)) {
+    MLOG_perror("recvmsg");
+    return false;
+  }
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  if (
+    cmsg == nullptr || cmsg->cmsg_type != SCM_RIGHTS ||
+    cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+    MLOG(MERROR) << "ring handoff without fds";
+    return false;
+  }
+  memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+
+  if (
+    handoff.magic != kRingMagic || handoff.version != kRingVersion ||
+    handoff.capacity != kRingCapacity) {
+    MLOG(MERROR) << "ring handoff of unsupported version "
+                 << std::to_string(handoff.version);
+    for (auto fd : fds) close(fd);
+    return false;
+  }
+
+  size_t size = 2 * SpscRing::RegionSize(handoff.capacity);
+  void *base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+  close(fds[0]);
+  if (base == MAP_FAILED) {
+    MLOG_perror("mmap");
+    close(fds[1]);
+    close(fds[2]);
+    return false;
+  }
+
+  auto dl_base =
+    static_cast<char *>(base) + SpscRing::RegionSize(handoff.capacity);
+  std::lock_guard<std::mutex> lock(_ul_mutex);
+  if (
+    !_ul_ring.Attach(base, handoff.capacity) ||
+    !_dl_ring.Attach(dl_base, handoff.capacity)) {
+    MLOG(MERROR) << "ring handoff with invalid rings";
+    munmap(base, size);
+    close(fds[1]);
+    close(fds[2]);
+    return false;
+  }
+
+  _base = base;
+  _size = size;
+  _ul_efd = fds[1];
+  _dl_efd = fds[2];
+  _conn_sd = conn_sd;
+  _attached = true;
+
+  MLOG(MINFO) << "MME attached its rings, relaying over shared memory";
+  return true;
+}
+
+void SctpdRingTransport::Detach()
+{
+  // Release the uplink producers waiting for room first
+  _attached = false;
+
+  std::lock_guard<std::mutex> lock(_ul_mutex);
+  munmap(_base, _size);
+  close(_ul_efd);
+  close(_dl_efd);
+  close(_conn_sd);
+  _base = nullptr;
+  _size = 0;
+  _ul_efd = -1;
+  _dl_efd = -1;
+  _conn_sd = -1;
+}
+
+void SctpdRingTransport::DrainDownlink()
+{
+  const RingRecord *record;
+
+  while ((record = _dl_ring.Peek()) != nullptr) {
+    if (record->type == RingRecordType::DATA) {
+      if (!_send_dl(
+            record->assoc_id,
+            record->stream,
+            record->payload(),
+            record->length)) {
+        RingRecord failed = *record;
+        failed.type = RingRecordType::SEND_FAILED;
+        failed.length = 0;
+        // Never block here, this thread is the one noticing MME leaving
+        if (!Push(failed, nullptr, false)) {
+          MLOG(MERROR) << "dropping send failure of assoc "
+                       << std::to_string(record->assoc_id);
+        }
+      }
+    } else {
+      MLOG(MERROR) << "unexpected downlink record type "
+                   << std::to_string(static_cast<int>(record->type));
+    }
+    _dl_ring.Release(record);
+  }
+  if (_dl_ring.Corrupted()) {
+    MLOG(MERROR) << "downlink record overflowing the ring, relaying over GRPC";
+    Detach();
+  }
+}
+
+} // namespace sctpd
+} // namespace magma
@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "sctpd_ring.h"
+
+namespace magma {
+namespace sctpd {
+
+// Shared memory transport to MME (see sctpd_ring.h)
+//
+// Waits for MME to hand over its rings on SCTPD_RING_SOCK. While MME is
+// attached, uplink events are written to the uplink ring and the packets of
+// the downlink ring are sent by a separate thread. The transport detaches
+// when MME closes the handoff socket, events are then relayed over GRPC.
+class SctpdRingTransport {
+ public:
+  // Sends a downlink packet, returns false if it could not be sent
+  using SendDlHandler = std::function<
+    bool(uint32_t assoc_id, uint32_t stream, const char *buf, size_t len)>;
+
+  // Construct SctpdRingTransport sending downlink packets with send_dl
+  explicit SctpdRingTransport(SendDlHandler send_dl);
+  ~SctpdRingTransport();
+
+  // Start waiting for MME on SCTPD_RING_SOCK
+  void Start();
+  // Detach from MME and stop the transport thread - blocking call
+  void Stop();
+
+  // Relay an uplink packet, returns false if MME is not attached
+  bool PushData(
+    uint32_t assoc_id,
+    uint32_t stream,
+    const std::string &payload);
+  // Relay a new association, returns false if MME is not attached
+  bool PushNewAssoc(uint32_t assoc_id, uint32_t instreams, uint32_t outstreams);
+  // Relay a closing association, returns false if MME is not attached
+  bool PushCloseAssoc(uint32_t assoc_id, bool reset);
+
+ private:
+  // Transport loop run in separate thread by Start
+  void Run();
+  // Map the rings handed over on conn_sd
+  bool Attach(int conn_sd);
+  // Unmap the rings and close the handoff socket
+  void Detach();
+  // Send the packets queued on the downlink ring
+  void DrainDownlink();
+  // Write a record to the uplink ring, waiting for room if wait is set
+  bool Push(const RingRecord &header, const char *payload, bool wait);
+
+  SendDlHandler _send_dl;
+
+  // Serializes the uplink producers, and them with Detach
+  std::mutex _ul_mutex;
+  std::atomic<bool> _attached;
+  std::atomic<bool> _done;
+
+  void *_base;
+  size_t _size;
+  SpscRing _ul_ring;
+  SpscRing _dl_ring;
+  int _ul_efd;
+  int _dl_efd;
+  int _conn_sd;
+
+  std::unique_ptr<std::thread> _thread;
+};
+
+} // namespace sctpd
+} // namespace magma
@@ -0,0 +1,225 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include "sctpd_uplink_stream.h"
+
+#include <random>
+
+#include "util.h"
+
+namespace magma {
+namespace sctpd {
+
+constexpr int SctpdUplinkStream::kMaxBatchEvents;
+constexpr size_t SctpdUplinkStream::kMaxQueuedEvents;
+constexpr std::chrono::seconds SctpdUplinkStream::kStreamRetryInterval;
+
+SctpdUplinkStream::SctpdUplinkStream(
+  std::shared_ptr<Channel> channel,
+  SctpdUplinkClient &fallback):
+  _stub(SctpdUplink::NewStub(channel)),
+  _fallback(fallback),
+  _done(false),
+  _broken(false),
+  _session_id(
+    (uint64_t) std::random_device{}() << 32 | std::random_device{}()),
+  _next_seq(0),
+  _stream_supported(true),
+  _thread(nullptr)
+{
+}
+
+SctpdUplinkStream::~SctpdUplinkStream()
+{
+  Stop();
+}
+
+void SctpdUplinkStream::Start()
+{
+  assert(_thread == nullptr);
+
+  _done = false;
+  _thread = std::make_unique<std::thread>(&SctpdUplinkStream::Run, this);
+}
+
+void SctpdUplinkStream::Stop()
+{
+  if (_thread == nullptr) return;
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _done = true;
+  }
+  _not_empty.notify_one();
+  _thread->join();
+  _thread = nullptr;
+}
+
+void SctpdUplinkStream::Push(UlEvent &&event)
+{
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _not_full.wait(lock, [this] { return _queue.size() < kMaxQueuedEvents; });
+    _queue.push_back(std::move(event));
+  }
+  _not_empty.notify_one();
+}
+
+void SctpdUplinkStream::Run()
+{
+  while (true) {
+    auto batch = std::make_shared<SendUlBatch>();
+    bool broken;
+    bool done;
+
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _not_empty.wait(
+        lock, [this] { return _done || _broken || !_queue.empty(); });
+      broken = _broken;
+      while (!_queue.empty() && batch->events_size() < kMaxBatchEvents) {
+        batch->add_events()->Swap(&_queue.front());
+        _queue.pop_front();
+      }
+      done = _done && _queue.empty();
+    }
+    _not_full.notify_all();
+
+    // The batches a broken stream did not acknowledge go first
+    if (broken) CloseStream();
+    if (batch->events_size() > 0) {
+      batch->set_session_id(_session_id);
+      batch->set_first_seq(_next_seq);
+      _next_seq += batch->events_size();
+      _pending.push_back(std::move(batch));
+    }
+    // Stop only once every queued event has been relayed
+    if (_pending.empty() && done) break;
+    SendPending();
+  }
+
+  // The stream can't be opened again right after it is closed, so events MME
+  // did not acknowledge are relayed with unary calls
+  CloseStream();
+  SendPending();
+}
+
+void SctpdUplinkStream::SendPending()
+{
+  while (!_pending.empty()) {
+    if (_writer == nullptr) OpenStream();
+    if (_writer == nullptr) break;
+
+    auto batch = _pending.front();
+    _pending.pop_front();
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _unacked.push_back(batch);
+    }
+    // A failed batch is sent again with the other unacknowledged ones
+    if (!_writer->Write(*batch)) CloseStream();
+  }
+
+  // MME can't skip events sent again over unary calls, they may be relayed
+  // twice if MME relayed them but its acknowledgement was lost
+  for (const auto &batch : _pending) {
+    for (const auto &event : batch->events()) {
+      SendUnary(event);
+    }
+  }
+  _pending.clear();
+}
+
+void SctpdUplinkStream::ReadAcks(
+  ClientReaderWriter<SendUlBatch, SendUlBatchRes> *stream)
+{
+  SendUlBatchRes res;
+
+  while (stream->Read(&res)) {
+    uint64_t acked_seq = res.first_seq() + res.count();
+    std::lock_guard<std::mutex> lock(_mutex);
+    while (!_unacked.empty() &&
+           _unacked.front()->first_seq() + _unacked.front()->events_size() <=
+             acked_seq) {
+      _unacked.pop_front();
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _broken = true;
+  }
+  _not_empty.notify_one();
+}
+
+void SctpdUplinkStream::OpenStream()
+{
+  if (!_stream_supported) return;
+  if (std::chrono::steady_clock::now() < _retry_at) return;
+
+  _context = std::make_unique<ClientContext>();
+  _writer = _stub->SendUlStream(_context.get());
+  _reader = std::make_unique<std::thread>(
+    &SctpdUplinkStream::ReadAcks, this, _writer.get());
+}
+
+void SctpdUplinkStream::CloseStream()
+{
+  if (_writer == nullptr) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _broken = false;
+    return;
+  }
+
+  _writer->WritesDone();
+  _reader->join();
+  auto status = _writer->Finish();
+
+  if (status.error_code() == grpc::StatusCode::UNIMPLEMENTED) {
+    MLOG(MINFO) << "sctpul.sendulstream unsupported, using unary calls";
+    _stream_supported = false;
+  } else if (!status.ok()) {
+    MLOG(MERROR) << "sctpul.sendulstream error";
+    MLOG_grpcerr(status);
+  }
+
+  _reader = nullptr;
+  _writer = nullptr;
+  _context = nullptr;
+  _retry_at = std::chrono::steady_clock::now() + kStreamRetryInterval;
+
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _pending.insert(_pending.begin(), _unacked.begin(), _unacked.end());
+    _unacked.clear();
+    _broken = false;
+  }
+}
+
+void SctpdUplinkStream::SendUnary(const UlEvent &event)
+{
+  switch (event.event_case()) {
+    case UlEvent::kSendUl: {
+      SendUlRes res;
+      _fallback.sendUl(event.send_ul(), &res);
+    } break;
+    case UlEvent::kNewAssoc: {
+      NewAssocRes res;
+      _fallback.newAssoc(event.new_assoc(), &res);
+    } break;
+    case UlEvent::kCloseAssoc: {
+      CloseAssocRes res;
+      _fallback.closeAssoc(event.close_assoc(), &res);
+    } break;
+    default: MLOG(MERROR) << "sctpul.sendunary empty event"; break;
+  }
+}
+
+} // namespace sctpd
+} // namespace magma
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <grpcpp/grpcpp.h>
+
+#include <lte/protos/sctpd.grpc.pb.h>
+
+#include "sctpd_uplink_client.h"
+
+namespace magma {
+namespace sctpd {
+
+using grpc::Channel;
+using grpc::ClientContext;
+using grpc::ClientReaderWriter;
+
+// Relays eNB events to MME over a SctpdUplink.SendUlStream call
+//
+// Events are queued by the sctp listener and written by a separate thread, the
+// events queued while a batch is being written make up the next batch. Events
+// are relayed in the order they are queued. Events are numbered and MME
+// acknowledges each batch once relayed, the batches not acknowledged when the
+// stream breaks are sent again. While the stream is down, or if MME does not
+// implement it, events are relayed with the unary calls of the fallback
+// client.
+class SctpdUplinkStream {
+ public:
+  // Construct SctpdUplinkStream relaying over channel, or fallback when needed
+  SctpdUplinkStream(
+    std::shared_ptr<Channel> channel,
+    SctpdUplinkClient &fallback);
+  ~SctpdUplinkStream();
+
+  // Start the writer thread
+  void Start();
+  // Relay the queued events and stop the writer thread - blocking call
+  void Stop();
+
+  // Queue an event, blocks while the queue is full
+  void Push(UlEvent &&event);
+
+ private:
+  // Writer loop run in separate thread by Start
+  void Run();
+  // Write the pending batches in order, or relay them with unary calls
+  void SendPending();
+  // Ack reader loop run in separate thread while the stream is open
+  void ReadAcks(ClientReaderWriter<SendUlBatch, SendUlBatchRes> *stream);
+  // Open the stream unless it is unsupported or was closed recently
+  void OpenStream();
+  // Close the stream, record whether MME supports it and queue the batches
+  // not acknowledged to be sent again
+  void CloseStream();
+  // Relay an event with the matching unary call
+  void SendUnary(const UlEvent &event);
+
+  // Maximum number of events written in a single batch
+  static constexpr int kMaxBatchEvents = 64;
+  // Maximum number of events waiting to be written
+  static constexpr size_t kMaxQueuedEvents = 65536;
+  // Delay before a failed stream is opened again
+  static constexpr std::chrono::seconds kStreamRetryInterval =
+    std::chrono::seconds(1);
+
+  std::unique_ptr<SctpdUplink::Stub> _stub;
+  SctpdUplinkClient &_fallback;
+
+  std::mutex _mutex;
+  std::condition_variable _not_empty;
+  std::condition_variable _not_full;
+  std::deque<UlEvent> _queue;
+  // Batches written and not acknowledged yet, in order
+  std::deque<std::shared_ptr<SendUlBatch>> _unacked;
+  bool _done;
+  // Set by the ack reader once the stream is closed by MME
+  bool _broken;
+
+  // Stream state, only used by the writer thread
+  std::unique_ptr<ClientContext> _context;
+  std::unique_ptr<ClientReaderWriter<SendUlBatch, SendUlBatchRes>> _writer;
+  std::unique_ptr<std::thread> _reader;
+  // Numbered batches waiting to be written, sent again batches first
+  std::deque<std::shared_ptr<SendUlBatch>> _pending;
+  // Lets MME tell a restarted numbering from sent again batches
+  const uint64_t _session_id;
+  uint64_t _next_seq;
+  bool _stream_supported;
+  std::chrono::steady_clock::time_point _retry_at;
+
+  std::unique_ptr<std::thread> _thread;
+};
+
+} // namespace sctpd
+} // namespace magma
@@ -0,0 +1,196 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+// Load generator for the sctpd uplink. A listener thread relays S1AP sized
+// PDUs through SctpdEventHandler to an in-process MME, once with a unary
+// SendUl call per PDU and once pipelined over SendUlStream. It prints the
+// PDUs/sec relayed and the p50/p99 latency from HandleRecv to MME.
+//    sctpd_uplink_bench [PDUs] [offered PDUs/sec, 0 for as fast as possible]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <grpc++/grpc++.h>
+
+#include <lte/protos/sctpd.grpc.pb.h>
+
+#include "sctpd_event_handler.h"
+#include "sctpd_uplink_client.h"
+#include "sctpd_uplink_stream.h"
+
+using grpc::Server;
+using grpc::ServerBuilder;
+using grpc::ServerContext;
+using grpc::ServerReaderWriter;
+using grpc::Status;
+using std::chrono::steady_clock;
+
+namespace magma {
+namespace sctpd {
+
+// Typical size of an uplink S1AP message carrying NAS
+constexpr size_t kPayloadSize = 120;
+constexpr uint32_t kAssocs = 16;
+
+static int64_t now_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           steady_clock::now().time_since_epoch())
+    .count();
+}
+
+// MME end of the uplink, records the latency of every PDU it receives
+class LatencyMmeUplink final : public SctpdUplink::Service {
+ public:
+  Status SendUl(ServerContext *context, const SendUlReq *req, SendUlRes *res)
+    override
+  {
+    Record(req->payload());
+    return Status::OK;
+  }
+
+  Status SendUlStream(
+    ServerContext *context,
+    ServerReaderWriter<SendUlBatchRes, SendUlBatch> *stream) override
+  {
+    SendUlBatch batch;
+
+    while (stream->Read(&batch)) {
+      for (const auto &event : batch.events()) {
+        Record(event.send_ul().payload());
+      }
+      SendUlBatchRes res;
+      res.set_first_seq(batch.first_seq());
+      res.set_count(batch.events_size());
+      stream->Write(res);
+    }
+    return Status::OK;
+  }
+
+  void Record(const std::string &payload)
+  {
+    int64_t sent_ns;
+
+    std::memcpy(&sent_ns, payload.data(), sizeof(sent_ns));
+    std::lock_guard<std::mutex> lock(mutex);
+    latencies_ns.push_back(now_ns() - sent_ns);
+  }
+
+  std::mutex mutex;
+  std::vector<int64_t> latencies_ns;
+};
+
+// Relay pdus through handler like the sctpd listener, at rate PDUs/sec
+static double relay(SctpdEventHandler &handler, long pdus, long rate)
+{
+  std::string payload(kPayloadSize, 'x');
+  auto start = steady_clock::now();
+
+  for (long i = 0; i < pdus; i++) {
+    if (rate > 0) {
+      std::this_thread::sleep_until(
+        start + std::chrono::nanoseconds(i * 1000000000 / rate));
+    }
+    int64_t sent_ns = now_ns();
+    std::memcpy(&payload[0], &sent_ns, sizeof(sent_ns));
+    handler.HandleRecv(i % kAssocs + 1, i % 2, payload);
+  }
+  return std::chrono::duration<double>(steady_clock::now() - start).count();
+}
+
+static bool report(
+  const char *name,
+  LatencyMmeUplink &mme,
+  long pdus,
+  double elapsed_sec)
+{
+  std::lock_guard<std::mutex> lock(mme.mutex);
+  auto &latencies = mme.latencies_ns;
+  size_t received = latencies.size();
+
+  std::sort(latencies.begin(), latencies.end());
+  if (received == 0) {
+    printf("%s: no PDU received\n", name);
+    return false;
+  }
+  printf(
+    "%s: %.0f PDUs/sec, latency p50 %.1f usec, p99 %.1f usec\n",
+    name,
+    received / elapsed_sec,
+    latencies[received / 2] / 1e3,
+    latencies[received * 99 / 100] / 1e3);
+  latencies.clear();
+  if ((long) received != pdus) {
+    printf("%s: MME received %zu PDUs, expected %ld\n", name, received, pdus);
+    return false;
+  }
+  return true;
+}
+
+} // namespace sctpd
+} // namespace magma
+
+using namespace magma::sctpd;
+
+int main(int argc, char **argv)
+{
+  long pdus = argc > 1 ? std::atol(argv[1]) : 100000;
+  long rate = argc > 2 ? std::atol(argv[2]) : 0;
+  bool ok = true;
+
+  if (pdus < 1 || rate < 0) {
+    fprintf(stderr, "sctpd_uplink_bench [PDUs] [offered PDUs/sec]\n");
+    return EXIT_FAILURE;
+  }
+
+  LatencyMmeUplink mme;
+  int port = 0;
+  ServerBuilder builder;
+  builder.AddListeningPort(
+    "127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+  builder.RegisterService(&mme);
+  auto server = builder.BuildAndStart();
+  if (port == 0) {
+    fprintf(stderr, "failed to start the MME uplink server\n");
+    return EXIT_FAILURE;
+  }
+  auto channel = grpc::CreateChannel(
+    "127.0.0.1:" + std::to_string(port), grpc::InsecureChannelCredentials());
+  SctpdUplinkClient client(channel);
+
+  {
+    SctpdEventHandler handler(client);
+    double elapsed_sec = relay(handler, pdus, rate);
+    ok &= report("unary SendUl", mme, pdus, elapsed_sec);
+  }
+
+  {
+    SctpdUplinkStream stream(channel, client);
+    SctpdEventHandler handler(client, &stream);
+    auto start = steady_clock::now();
+    stream.Start();
+    relay(handler, pdus, rate);
+    // Stop returns once every PDU is acknowledged by MME
+    stream.Stop();
+    double elapsed_sec =
+      std::chrono::duration<double>(steady_clock::now() - start).count();
+    ok &= report("SendUlStream", mme, pdus, elapsed_sec);
+  }
+
+  server->Shutdown();
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
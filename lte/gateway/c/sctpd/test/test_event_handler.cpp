@@ -8,6 +8,8 @@
  */
 
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include <glog/logging.h>
 #include <gmock/gmock.h>
@@ -18,10 +20,17 @@
 
 #include "sctpd_event_handler.h"
 #include "sctpd_uplink_client.h"
+#include "sctpd_uplink_stream.h"
 
+using grpc::Server;
+using grpc::ServerBuilder;
+using grpc::ServerContext;
+using grpc::ServerReaderWriter;
+using grpc::Status;
 using ::testing::_;
 using ::testing::AllOf;
 using ::testing::Eq;
+using ::testing::InSequence;
 using ::testing::NotNull;
 using ::testing::Property;
 using ::testing::Return;
@@ -45,6 +54,41 @@ class MockSctpdUplinkClient final : public SctpdUplinkClient {
   MOCK_METHOD2(closeAssoc, int(const CloseAssocReq &, CloseAssocRes *));
 };
 
+// MME end of the uplink stream, records the events it relays
+class FakeMmeUplink final : public SctpdUplink::Service {
+ public:
+  Status SendUlStream(
+    ServerContext *context,
+    ServerReaderWriter<SendUlBatchRes, SendUlBatch> *stream) override
+  {
+    SendUlBatch batch;
+
+    while (stream->Read(&batch)) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        seqs.push_back(batch.first_seq());
+        for (const auto &event : batch.events()) {
+          events.push_back(event);
+        }
+        if (break_stream) {
+          // The batch is relayed but the acknowledgement is lost
+          return Status(grpc::UNAVAILABLE, "stream broken");
+        }
+      }
+      SendUlBatchRes res;
+      res.set_first_seq(batch.first_seq());
+      res.set_count(batch.events_size());
+      stream->Write(res);
+    }
+    return Status::OK;
+  }
+
+  std::mutex mutex;
+  std::vector<UlEvent> events;
+  std::vector<uint64_t> seqs;
+  bool break_stream = false;
+};
+
 class EventHandlerTest : public ::testing::Test {
  protected:
   virtual void SetUp()
@@ -125,6 +169,147 @@ TEST_F(EventHandlerTest, test_event_handler_send_ul)
     send_ul_req.assoc_id(), send_ul_req.stream(), send_ul_req.payload());
 }
 
+TEST_F(EventHandlerTest, test_event_handler_stream_fallback)
+{
+  // Without an MME to stream to, events are relayed in order by unary calls
+  auto channel = grpc::CreateChannel("", grpc::InsecureChannelCredentials());
+  SctpdUplinkStream stream(channel, *_uplink_client);
+  SctpdEventHandler handler(*_uplink_client, &stream);
+
+  {
+    InSequence s;
+    EXPECT_CALL(
+      *_uplink_client,
+      newAssoc(
+        Property(&NewAssocReq::assoc_id, Eq(new_assoc_req.assoc_id())),
+        NotNull()))
+      .Times(1);
+    EXPECT_CALL(
+      *_uplink_client,
+      sendUl(
+        Property(&SendUlReq::payload, Eq(send_ul_req.payload())), NotNull()))
+      .Times(1);
+    EXPECT_CALL(
+      *_uplink_client,
+      closeAssoc(
+        Property(&CloseAssocReq::assoc_id, Eq(close_assoc_req.assoc_id())),
+        NotNull()))
+      .Times(1);
+  }
+
+  stream.Start();
+  handler.HandleNewAssoc(
+    new_assoc_req.assoc_id(),
+    new_assoc_req.instreams(),
+    new_assoc_req.outstreams());
+  handler.HandleRecv(
+    send_ul_req.assoc_id(), send_ul_req.stream(), send_ul_req.payload());
+  handler.HandleCloseAssoc(
+    close_assoc_req.assoc_id(), close_assoc_req.is_reset());
+  stream.Stop();
+}
+
+class UplinkStreamTest : public EventHandlerTest {
+ protected:
+  virtual void SetUp()
+  {
+    EventHandlerTest::SetUp();
+
+    int port = 0;
+    ServerBuilder builder;
+    builder.AddListeningPort(
+      "127.0.0.1:0", grpc::InsecureServerCredentials(), &port);
+    builder.RegisterService(&_mme);
+    _server = builder.BuildAndStart();
+    ASSERT_NE(0, port);
+
+    auto channel = grpc::CreateChannel(
+      "127.0.0.1:" + std::to_string(port), grpc::InsecureChannelCredentials());
+    _stream = std::make_unique<SctpdUplinkStream>(channel, *_uplink_client);
+    _stream_handler =
+      std::make_unique<SctpdEventHandler>(*_uplink_client, _stream.get());
+  }
+
+  virtual void TearDown()
+  {
+    _stream = nullptr;
+    _server->Shutdown();
+  }
+
+  void HandleEvents()
+  {
+    _stream_handler->HandleNewAssoc(
+      new_assoc_req.assoc_id(),
+      new_assoc_req.instreams(),
+      new_assoc_req.outstreams());
+    _stream_handler->HandleRecv(
+      send_ul_req.assoc_id(), send_ul_req.stream(), send_ul_req.payload());
+    _stream_handler->HandleCloseAssoc(
+      close_assoc_req.assoc_id(), close_assoc_req.is_reset());
+  }
+
+  FakeMmeUplink _mme;
+  std::unique_ptr<Server> _server;
+  std::unique_ptr<SctpdUplinkStream> _stream;
+  std::unique_ptr<SctpdEventHandler> _stream_handler;
+};
+
+TEST_F(UplinkStreamTest, test_uplink_stream)
+{
+  // Every event is acknowledged, none goes over unary calls
+  EXPECT_CALL(*_uplink_client, newAssoc(_, _)).Times(0);
+  EXPECT_CALL(*_uplink_client, sendUl(_, _)).Times(0);
+  EXPECT_CALL(*_uplink_client, closeAssoc(_, _)).Times(0);
+
+  _stream->Start();
+  HandleEvents();
+  _stream->Stop();
+
+  ASSERT_EQ(3, _mme.events.size());
+  EXPECT_EQ(
+    new_assoc_req.assoc_id(), _mme.events[0].new_assoc().assoc_id());
+  EXPECT_EQ(send_ul_req.payload(), _mme.events[1].send_ul().payload());
+  EXPECT_EQ(
+    close_assoc_req.assoc_id(), _mme.events[2].close_assoc().assoc_id());
+  // Batches are numbered by event
+  ASSERT_FALSE(_mme.seqs.empty());
+  EXPECT_EQ(0, _mme.seqs[0]);
+}
+
+TEST_F(UplinkStreamTest, test_uplink_stream_resend)
+{
+  // The batch is not acknowledged before the stream breaks, it is sent again
+  // in order over unary calls
+  _mme.break_stream = true;
+  {
+    InSequence s;
+    EXPECT_CALL(
+      *_uplink_client,
+      newAssoc(
+        Property(&NewAssocReq::assoc_id, Eq(new_assoc_req.assoc_id())),
+        NotNull()))
+      .Times(1);
+    EXPECT_CALL(
+      *_uplink_client,
+      sendUl(
+        Property(&SendUlReq::payload, Eq(send_ul_req.payload())), NotNull()))
+      .Times(1);
+    EXPECT_CALL(
+      *_uplink_client,
+      closeAssoc(
+        Property(&CloseAssocReq::assoc_id, Eq(close_assoc_req.assoc_id())),
+        NotNull()))
+      .Times(1);
+  }
+
+  // Queued before the writer starts, the events make up a single batch
+  HandleEvents();
+  _stream->Start();
+  _stream->Stop();
+
+  EXPECT_EQ(3, _mme.events.size());
+}
+
 } // namespace sctpd
 } // namespace magma
 
@@ -0,0 +1,149 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/sctp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <lte/protos/sctpd.grpc.pb.h>
+
+#include "sctp_connection.h"
+
+namespace magma {
+namespace sctpd {
+
+const uint16_t TEST_PORT = 36999;
+const uint32_t S1AP_PPID = 18;
+const uint32_t OTHER_PPID = 46;
+// More than a socket drain tolerates in a row
+const int DROPPED_MESSAGES = 64;
+const std::chrono::seconds RECV_TIMEOUT(5);
+
+// Holds the receive worker in HandleNewAssoc until released, so that every
+// message sent meanwhile is pending on the next drain of the socket
+class BlockingHandler final : public SctpEventHandler {
+ public:
+  void HandleNewAssoc(
+    uint32_t assoc_id,
+    uint32_t instreams,
+    uint32_t outstreams) override
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [this] { return released; });
+  }
+
+  void HandleCloseAssoc(uint32_t assoc_id, bool reset) override {}
+
+  void HandleRecv(
+    uint32_t assoc_id,
+    uint32_t stream,
+    const std::string &payload) override
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    payloads.push_back(payload);
+    cond.notify_all();
+  }
+
+  void Release()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    released = true;
+    cond.notify_all();
+  }
+
+  bool WaitRecv(size_t count)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    return cond.wait_for(
+      lock, RECV_TIMEOUT, [this, count] { return payloads.size() >= count; });
+  }
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool released = false;
+  std::vector<std::string> payloads;
+};
+
+static int connect_client()
+{
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(TEST_PORT);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  int sd = socket(AF_INET, SOCK_STREAM, IPPROTO_SCTP);
+  if (sd < 0) return -1;
+  if (connect(sd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+    close(sd);
+    return -1;
+  }
+  return sd;
+}
+
+static bool send_msg(int sd, const std::string &msg, uint32_t ppid)
+{
+  return sctp_sendmsg(
+           sd, msg.data(), msg.size(), nullptr, 0, htonl(ppid), 0, 0, 0, 0) ==
+         (int) msg.size();
+}
+
+// Dropped messages must not stop the socket from being drained: it is edge
+// triggered and would not be reported again for the messages behind them
+TEST(SctpConnectionTest, TestRecvAfterDroppedMessages)
+{
+  InitReq req;
+  req.set_use_ipv4(true);
+  req.add_ipv4_addrs("127.0.0.1");
+  req.set_port(TEST_PORT);
+  req.set_ppid(S1AP_PPID);
+
+  BlockingHandler handler;
+  SctpConnection conn(req, handler);
+  conn.Start();
+
+  int sd = connect_client();
+  ASSERT_GE(sd, 0);
+  for (int i = 0; i < DROPPED_MESSAGES; i++) {
+    EXPECT_TRUE(send_msg(sd, "dropped", OTHER_PPID));
+  }
+  EXPECT_TRUE(send_msg(sd, "relayed", S1AP_PPID));
+  handler.Release();
+
+  EXPECT_TRUE(handler.WaitRecv(1));
+  {
+    std::lock_guard<std::mutex> lock(handler.mutex);
+    ASSERT_EQ(1, handler.payloads.size());
+    EXPECT_EQ("relayed", handler.payloads[0]);
+  }
+
+  close(sd);
+  conn.Close();
+}
+
+} // namespace sctpd
+} // namespace magma
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  FLAGS_logtostderr = 1;
+  FLAGS_v = 10;
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,168 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "sctpd_ring.h"
+
+using ::testing::Test;
+
+namespace magma {
+namespace sctpd {
+
+const uint64_t TEST_CAPACITY = 1024;
+
+class SctpdRingTest : public ::testing::Test {
+ protected:
+  virtual void SetUp()
+  {
+    memory.resize(SpscRing::RegionSize(TEST_CAPACITY) / sizeof(uint64_t));
+    SpscRing::Format(memory.data(), TEST_CAPACITY);
+    ASSERT_TRUE(producer.Attach(memory.data(), TEST_CAPACITY));
+    ASSERT_TRUE(consumer.Attach(memory.data(), TEST_CAPACITY));
+  }
+
+  RingHeader *header() { return reinterpret_cast<RingHeader *>(memory.data()); }
+
+  bool push(uint32_t assoc_id, const std::string &payload)
+  {
+    RingRecord *record = producer.Reserve(payload.size());
+    if (record == nullptr) return false;
+    record->type = RingRecordType::DATA;
+    record->assoc_id = assoc_id;
+    memcpy(record->payload(), payload.data(), payload.size());
+    producer.Commit(record);
+    return true;
+  }
+
+  void pop(uint32_t assoc_id, const std::string &payload)
+  {
+    const RingRecord *record = consumer.Peek();
+    ASSERT_NE(nullptr, record);
+    EXPECT_EQ(RingRecordType::DATA, record->type);
+    EXPECT_EQ(assoc_id, record->assoc_id);
+    EXPECT_EQ(payload, std::string(record->payload(), record->length));
+    consumer.Release(record);
+  }
+
+  // Backing memory, 8 bytes aligned for the atomics
+  std::vector<uint64_t> memory;
+  SpscRing producer;
+  SpscRing consumer;
+};
+
+TEST_F(SctpdRingTest, test_attach)
+{
+  SpscRing ring;
+
+  EXPECT_FALSE(ring.Attach(memory.data(), TEST_CAPACITY / 2));
+  header()->magic = 0;
+  EXPECT_FALSE(ring.Attach(memory.data(), TEST_CAPACITY));
+}
+
+TEST_F(SctpdRingTest, test_reserve_commit)
+{
+  EXPECT_EQ(nullptr, consumer.Peek());
+
+  EXPECT_TRUE(push(1, "first"));
+  EXPECT_TRUE(push(2, ""));
+  EXPECT_TRUE(push(3, std::string(100, 'x')));
+
+  pop(1, "first");
+  pop(2, "");
+  pop(3, std::string(100, 'x'));
+  EXPECT_EQ(nullptr, consumer.Peek());
+  EXPECT_EQ(header()->head.load(), header()->tail.load());
+}
+
+TEST_F(SctpdRingTest, test_full)
+{
+  // Payloads over a quarter of the ring are refused
+  EXPECT_EQ(nullptr, producer.Reserve(producer.MaxPayload() + 1));
+
+  // 4 records of 256 bytes fill the ring
+  std::string payload(256 - sizeof(RingRecord), 'a');
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(push(i, payload));
+  }
+  EXPECT_FALSE(push(4, ""));
+
+  pop(0, payload);
+  EXPECT_TRUE(push(4, ""));
+}
+
+TEST_F(SctpdRingTest, test_pad_wraparound)
+{
+  // Leave 64 bytes before the end of the ring
+  std::string payload(256 - sizeof(RingRecord), 'a');
+  std::string last(192 - sizeof(RingRecord), 'b');
+  for (int i = 0; i < 3; i++) {
+    EXPECT_TRUE(push(i, payload));
+  }
+  EXPECT_TRUE(push(3, last));
+  for (int i = 0; i < 3; i++) {
+    pop(i, payload);
+  }
+
+  // Too long for the end of the ring, goes to the start after a PAD
+  std::string wrapped(100, 'c');
+  EXPECT_TRUE(push(4, wrapped));
+  const RingRecord *pad = reinterpret_cast<const RingRecord *>(
+    reinterpret_cast<const char *>(header() + 1) + TEST_CAPACITY - 64);
+  EXPECT_EQ(RingRecordType::PAD, pad->type);
+  EXPECT_EQ(64 - sizeof(RingRecord), pad->length);
+  EXPECT_EQ(TEST_CAPACITY + 160, header()->tail.load());
+
+  pop(3, last);
+  // The PAD is skipped
+  pop(4, wrapped);
+  EXPECT_EQ(nullptr, consumer.Peek());
+  EXPECT_EQ(header()->head.load(), header()->tail.load());
+}
+
+TEST_F(SctpdRingTest, test_consumer_waiting)
+{
+  EXPECT_TRUE(consumer.PrepareWait());
+  RingRecord *record = producer.Reserve(0);
+  ASSERT_NE(nullptr, record);
+  // The consumer sleeps and must be woken up
+  EXPECT_TRUE(producer.Commit(record));
+  consumer.FinishWait();
+
+  // Records are pending, the consumer must not sleep
+  EXPECT_FALSE(consumer.PrepareWait());
+  record = producer.Reserve(0);
+  EXPECT_FALSE(producer.Commit(record));
+}
+
+TEST_F(SctpdRingTest, test_corrupted_length)
+{
+  EXPECT_TRUE(push(1, "first"));
+  EXPECT_TRUE(push(2, "second"));
+
+  // A record claiming more bytes than were produced
+  auto record = const_cast<RingRecord *>(consumer.Peek());
+  ASSERT_NE(nullptr, record);
+  record->length = TEST_CAPACITY;
+  EXPECT_EQ(nullptr, consumer.Peek());
+  EXPECT_TRUE(consumer.Corrupted());
+  EXPECT_EQ(0, header()->head.load());
+}
+
+} // namespace sctpd
+} // namespace magma
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -25,6 +25,7 @@ bool ChargingCreditPool::add_used_credit(
     return false;
   }
   it->second->add_used_credit(used_tx, used_rx);
+  check_pending_update(key, *it->second);
   return true;
 }
 
@@ -37,6 +38,7 @@ bool ChargingCreditPool::reset_reporting_credit(const uint32_t &key)
     return false;
   }
   it->second->reset_reporting_credit();
+  check_pending_update(key, *it->second);
   return true;
 }
 
@@ -88,21 +90,28 @@ void ChargingCreditPool::get_updates(
   std::vector<CreditUsage> *updates_out,
   std::vector<std::unique_ptr<ServiceAction>> *actions_out)
 {
-  for (auto &credit_pair : credit_map_) {
-    auto &credit = *(credit_pair.second);
+  // Idle credits have nothing to report, only visit the pending ones
+  std::vector<uint32_t> keys(pending_keys_.begin(), pending_keys_.end());
+  for (auto key : keys) {
+    auto it = credit_map_.find(key);
+    if (it == credit_map_.end()) {
+      pending_keys_.erase(key);
+      continue;
+    }
+    auto &credit = *(it->second);
     auto action_type = credit.get_action();
     if (action_type != CONTINUE_SERVICE) {
       MLOG(MDEBUG) << "Subscriber " << imsi_ << " rating group "
-                   << credit_pair.first << " action type " << action_type;
+                   << key << " action type " << action_type;
       auto action = std::make_unique<ServiceAction>(action_type);
       if (action_type == REDIRECT) {
-        action->set_rating_group(credit_pair.first);
+        action->set_rating_group(key);
         action->set_redirect_server(credit.get_redirect_server());
       }
       populate_output_actions(
         imsi,
         ip_addr,
-        credit_pair.first,
+        key,
         session_rules,
         action,
         actions_out);
@@ -110,14 +119,15 @@ void ChargingCreditPool::get_updates(
       auto update_type = credit.get_update_type();
       if (update_type != CREDIT_NO_UPDATE) {
         MLOG(MDEBUG) << "Subscriber " << imsi_ << " rating group "
-                     << credit_pair.first << " updating due to type "
+                     << key << " updating due to type "
                      << update_type;
         updates_out->push_back(get_usage_proto_from_struct(
           credit.get_usage_for_reporting(false /* no termination */),
           convert_update_type_to_proto(update_type),
-          credit_pair.first));
+          key));
       }
     }
+    check_pending_update(key, credit);
   }
 }
 
@@ -193,6 +203,7 @@ bool ChargingCreditPool::init_new_credit(const CreditUpdateResponse &update)
     update.credit().granted_units(),
     default_volume,
     update.credit());
+  check_pending_update(update.charging_key(), *credit);
   credit_map_[update.charging_key()] = std::move(credit);
   return true;
 }
@@ -208,6 +219,7 @@ bool ChargingCreditPool::receive_credit(const CreditUpdateResponse &update)
     // update unsuccessful, reset credit and return
     MLOG(MDEBUG) << "Rececive_Credit_Update: Unsuccessfull";
     it->second->mark_failure(update.result_code());
+    check_pending_update(update.charging_key(), *it->second);
     return false;
   }
   const auto &gsu = update.credit().granted_units();
@@ -222,6 +234,7 @@ bool ChargingCreditPool::receive_credit(const CreditUpdateResponse &update)
     gsu,
     default_volume,
     update.credit());
+  check_pending_update(update.charging_key(), *it->second);
   return true;
 }
 
@@ -234,6 +247,41 @@ uint64_t ChargingCreditPool::get_credit(const uint32_t &key, Bucket bucket)
   return it->second->get_credit(bucket);
 }
 
+bool ChargingCreditPool::has_pending_updates() const
+{
+  return !pending_keys_.empty();
+}
+
+void ChargingCreditPool::check_pending_updates()
+{
+  for (auto &credit_pair : credit_map_) {
+    check_pending_update(credit_pair.first, *credit_pair.second);
+  }
+}
+
+std::vector<std::time_t> ChargingCreditPool::get_expiry_times() const
+{
+  std::vector<std::time_t> expiry_times;
+  for (const auto &credit_pair : credit_map_) {
+    auto expiry_time = credit_pair.second->get_expiry_time();
+    if (expiry_time != std::numeric_limits<std::time_t>::max()) {
+      expiry_times.push_back(expiry_time);
+    }
+  }
+  return expiry_times;
+}
+
+void ChargingCreditPool::check_pending_update(
+  uint32_t key,
+  SessionCredit &credit)
+{
+  if (credit.has_pending_update()) {
+    pending_keys_.insert(key);
+  } else {
+    pending_keys_.erase(key);
+  }
+}
+
 ChargingReAuthAnswer::Result ChargingCreditPool::reauth_key(
   uint32_t charging_key)
 {
@@ -244,11 +292,13 @@ ChargingReAuthAnswer::Result ChargingCreditPool::reauth_key(
       return ChargingReAuthAnswer::UPDATE_NOT_NEEDED;
     }
     it->second->reauth();
+    check_pending_update(charging_key, *it->second);
     return ChargingReAuthAnswer::UPDATE_INITIATED;
   }
   // charging_key cannot be found, initialize credit and engage reauth
   auto credit = std::make_unique<SessionCredit>(CreditType::CHARGING, SERVICE_DISABLED);
   credit->reauth();
+  check_pending_update(charging_key, *credit);
   credit_map_[charging_key] = std::move(credit);
   return ChargingReAuthAnswer::UPDATE_INITIATED;
 }
@@ -260,12 +310,32 @@ ChargingReAuthAnswer::Result ChargingCreditPool::reauth_all()
     // Only update credits that aren't reporting
     if (!credit_pair.second->is_reporting()) {
       credit_pair.second->reauth();
+      check_pending_update(credit_pair.first, *credit_pair.second);
       res = ChargingReAuthAnswer::UPDATE_INITIATED;
     }
   }
   return res;
 }
 
+void ChargingCreditPool::marshal(StoredSessionState &marshaled) const
+{
+  auto &credits = *marshaled.mutable_charging_credits();
+  for (auto &credit_pair : credit_map_) {
+    credits[credit_pair.first] = credit_pair.second->marshal();
+  }
+}
+
+void ChargingCreditPool::unmarshal(const StoredSessionState &marshaled)
+{
+  credit_map_.clear();
+  for (const auto &credit_pair : marshaled.charging_credits()) {
+    credit_map_[credit_pair.first] =
+      SessionCredit::unmarshal(credit_pair.second);
+  }
+  pending_keys_.clear();
+  check_pending_updates();
+}
+
 UsageMonitoringCreditPool::UsageMonitoringCreditPool(const std::string &imsi):
   imsi_(imsi),
   session_level_key_(nullptr)
@@ -297,6 +367,7 @@ bool UsageMonitoringCreditPool::add_used_credit(
     return false;
   }
   it->second->credit.add_used_credit(used_tx, used_rx);
+  check_pending_update(key, it->second->credit);
   return true;
 }
 
@@ -309,6 +380,7 @@ bool UsageMonitoringCreditPool::reset_reporting_credit(const std::string &key)
     return false;
   }
   it->second->credit.reset_reporting_credit();
+  check_pending_update(key, it->second->credit);
   return true;
 }
 
@@ -332,15 +404,22 @@ void UsageMonitoringCreditPool::get_updates(
   std::vector<UsageMonitorUpdate> *updates_out,
   std::vector<std::unique_ptr<ServiceAction>> *actions_out)
 {
-  for (auto &monitor_pair : monitor_map_) {
-    auto &credit = monitor_pair.second->credit;
+  // Idle monitors have nothing to report, only visit the pending ones
+  std::vector<std::string> keys(pending_keys_.begin(), pending_keys_.end());
+  for (const auto &key : keys) {
+    auto it = monitor_map_.find(key);
+    if (it == monitor_map_.end()) {
+      pending_keys_.erase(key);
+      continue;
+    }
+    auto &credit = it->second->credit;
     auto action_type = credit.get_action();
     if (action_type != CONTINUE_SERVICE) {
       auto action = std::make_unique<ServiceAction>(action_type);
       populate_output_actions(
         imsi,
         ip_addr,
-        monitor_pair.first,
+        key,
         session_rules,
         action,
         actions_out);
@@ -348,13 +427,14 @@ void UsageMonitoringCreditPool::get_updates(
     auto update_type = credit.get_update_type();
     if (update_type != CREDIT_NO_UPDATE) {
       MLOG(MDEBUG) << "Subscriber " << imsi_ << " monitoring key "
-                   << monitor_pair.first << " updating due to type "
+                   << key << " updating due to type "
                    << update_type;
       updates_out->push_back(get_monitor_update_from_struct(
         credit.get_usage_for_reporting(false /* no termination */),
-        monitor_pair.first,
-        monitor_pair.second->level));
+        key,
+        it->second->level));
     }
+    check_pending_update(key, credit);
   }
 }
 
@@ -409,6 +489,7 @@ bool UsageMonitoringCreditPool::init_new_credit(
   uint64_t default_volume = std::numeric_limits<uint64_t>::max();
   receive_monitoring_credit_with_default(
     monitor->credit, update.credit().granted_units(), default_volume);
+  check_pending_update(update.credit().monitoring_key(), monitor->credit);
   monitor_map_[update.credit().monitoring_key()] = std::move(monitor);
   return true;
 }
@@ -426,6 +507,7 @@ bool UsageMonitoringCreditPool::receive_credit(
   }
   if (!update.success()) {
     it->second->credit.mark_failure(update.result_code());
+    check_pending_update(it->first, it->second->credit);
     return false;
   }
   const auto &gsu = update.credit().granted_units();
@@ -439,7 +521,9 @@ bool UsageMonitoringCreditPool::receive_credit(
     it->second->credit,
     update.credit().granted_units(),
     default_volume);
+  check_pending_update(it->first, it->second->credit);
   if (update.credit().action() == UsageMonitoringCredit::DISABLE) {
+    pending_keys_.erase(update.credit().monitoring_key());
     monitor_map_.erase(update.credit().monitoring_key());
   }
   return true;
@@ -456,10 +540,65 @@ uint64_t UsageMonitoringCreditPool::get_credit(
   return it->second->credit.get_credit(bucket);
 }
 
+bool UsageMonitoringCreditPool::has_pending_updates() const
+{
+  return !pending_keys_.empty();
+}
+
+void UsageMonitoringCreditPool::check_pending_updates()
+{
+  for (auto &monitor_pair : monitor_map_) {
+    check_pending_update(monitor_pair.first, monitor_pair.second->credit);
+  }
+}
+
+void UsageMonitoringCreditPool::check_pending_update(
+  const std::string &key,
+  SessionCredit &credit)
+{
+  if (credit.has_pending_update()) {
+    pending_keys_.insert(key);
+  } else {
+    pending_keys_.erase(key);
+  }
+}
+
 std::unique_ptr<std::string> UsageMonitoringCreditPool::get_session_level_key()
 {
   if (session_level_key_ == nullptr) return nullptr;
   return std::make_unique<std::string>(*session_level_key_);
 }
 
+void UsageMonitoringCreditPool::marshal(StoredSessionState &marshaled) const
+{
+  auto &monitors = *marshaled.mutable_monitors();
+  for (auto &monitor_pair : monitor_map_) {
+    StoredMonitor monitor;
+    monitor.mutable_credit()->CopyFrom(monitor_pair.second->credit.marshal());
+    monitor.set_level(monitor_pair.second->level);
+    monitors[monitor_pair.first] = monitor;
+  }
+  if (session_level_key_ != nullptr) {
+    marshaled.set_session_level_key(*session_level_key_);
+  }
+}
+
+void UsageMonitoringCreditPool::unmarshal(const StoredSessionState &marshaled)
+{
+  monitor_map_.clear();
+  for (const auto &monitor_pair : marshaled.monitors()) {
+    auto monitor = std::make_unique<Monitor>();
+    monitor->credit = *SessionCredit::unmarshal(monitor_pair.second.credit());
+    monitor->level = monitor_pair.second.level();
+    monitor_map_[monitor_pair.first] = std::move(monitor);
+  }
+  session_level_key_ = nullptr;
+  if (!marshaled.session_level_key().empty()) {
+    session_level_key_ =
+      std::make_unique<std::string>(marshaled.session_level_key());
+  }
+  pending_keys_.clear();
+  check_pending_updates();
+}
+
 } // namespace magma
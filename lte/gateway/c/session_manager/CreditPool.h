@@ -9,6 +9,8 @@
 
 #pragma once
 
+#include <unordered_set>
+
 #include "SessionCredit.h"
 #include "SessionRules.h"
 
@@ -37,7 +39,8 @@ class CreditPool {
   virtual bool reset_reporting_credit(const KeyType &key) = 0;
 
   /**
-   * get_updates gets any usage updates required by the credits in the pool
+   * get_updates gets any usage updates required by the credits in the pool.
+   * Only the credits marked as pending by the other calls are visited.
    */
   virtual void get_updates(
     std::string imsi,
@@ -62,6 +65,18 @@ class CreditPool {
    * get_credit is a helper function to return the bytes in a credit bucket
    */
   virtual uint64_t get_credit(const KeyType &key, Bucket bucket) = 0;
+
+  /**
+   * has_pending_updates returns true if some credits have an action to take
+   * or usage to report, and get_updates would output something
+   */
+  virtual bool has_pending_updates() const = 0;
+
+  /**
+   * check_pending_updates checks every credit of the pool again, for updates
+   * that are only due to time passing, such as an expired validity timer
+   */
+  virtual void check_pending_updates() = 0;
 };
 
 /**
@@ -93,16 +108,39 @@ class ChargingCreditPool :
 
   uint64_t get_credit(const uint32_t &key, Bucket bucket) override;
 
+  bool has_pending_updates() const override;
+
+  void check_pending_updates() override;
+
+  /**
+   * get_expiry_times returns the validity timer expiry of every credit that
+   * has a validity time
+   */
+  std::vector<std::time_t> get_expiry_times() const;
+
   ChargingReAuthAnswer::Result reauth_key(uint32_t charging_key);
 
   ChargingReAuthAnswer::Result reauth_all();
 
+  /**
+   * marshal saves the credits of the pool into the stored session
+   */
+  void marshal(StoredSessionState &marshaled) const;
+
+  /**
+   * unmarshal restores the credits saved by marshal
+   */
+  void unmarshal(const StoredSessionState &marshaled);
+
  private:
   std::unordered_map<uint32_t, std::unique_ptr<SessionCredit>> credit_map_;
+  // Keys of the credits that get_updates needs to visit
+  std::unordered_set<uint32_t> pending_keys_;
   std::string imsi_;
 
  private:
   bool init_new_credit(const CreditUpdateResponse &update);
+  void check_pending_update(uint32_t key, SessionCredit &credit);
 };
 
 /**
@@ -139,8 +177,22 @@ class UsageMonitoringCreditPool :
 
   uint64_t get_credit(const std::string &key, Bucket bucket) override;
 
+  bool has_pending_updates() const override;
+
+  void check_pending_updates() override;
+
   std::unique_ptr<std::string> get_session_level_key();
 
+  /**
+   * marshal saves the monitors of the pool into the stored session
+   */
+  void marshal(StoredSessionState &marshaled) const;
+
+  /**
+   * unmarshal restores the monitors saved by marshal
+   */
+  void unmarshal(const StoredSessionState &marshaled);
+
  private:
   struct Monitor {
     SessionCredit credit;
@@ -150,12 +202,15 @@ class UsageMonitoringCreditPool :
   };
 
   std::unordered_map<std::string, std::unique_ptr<Monitor>> monitor_map_;
+  // Keys of the monitors that get_updates needs to visit
+  std::unordered_set<std::string> pending_keys_;
   std::string imsi_;
   std::unique_ptr<std::string> session_level_key_;
 
  private:
   void update_session_level_key(const UsageMonitoringUpdateResponse &update);
   bool init_new_credit(const UsageMonitoringUpdateResponse &update);
+  void check_pending_update(const std::string &key, SessionCredit &credit);
 };
 
 } // namespace magma
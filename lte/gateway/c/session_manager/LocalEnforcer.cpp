@@ -22,6 +22,28 @@
 
 namespace {
 
+// Pack the digits of an IMSI, with or without its "IMSI" prefix, into an
+// integer. The digit count and prefix are kept so that distinct IMSI strings
+// never share an IMSI64
+bool imsi_to_imsi64(const std::string &imsi, uint64_t *imsi64)
+{
+  bool has_prefix = imsi.compare(0, 4, "IMSI") == 0;
+  size_t start = has_prefix ? 4 : 0;
+  size_t digits = imsi.size() - start;
+  if (digits == 0 || digits > 15) {
+    return false;
+  }
+  uint64_t value = 0;
+  for (size_t i = start; i < imsi.size(); i++) {
+    if (imsi[i] < '0' || imsi[i] > '9') {
+      return false;
+    }
+    value = value * 10 + (imsi[i] - '0');
+  }
+  *imsi64 = value | ((uint64_t) digits << 56) | ((uint64_t) has_prefix << 60);
+  return true;
+}
+
 std::chrono::milliseconds time_difference_from_now(
   const google::protobuf::Timestamp &timestamp)
 {
@@ -109,6 +131,117 @@ folly::EventBase &LocalEnforcer::get_event_base()
   return *evb_;
 }
 
+void LocalEnforcer::attach_session_store(
+  std::shared_ptr<SessionStore> session_store,
+  uint32_t write_interval_ms)
+{
+  session_store_ = session_store;
+  session_store_write_interval_ = std::chrono::milliseconds(write_interval_ms);
+  evb_->runInEventBaseThread([this] {
+    evb_->timer().scheduleTimeoutFn(
+      std::move([this] { flush_dirty_sessions(); }),
+      session_store_write_interval_);
+  });
+}
+
+void LocalEnforcer::flush_dirty_sessions()
+{
+  for (const auto &imsi : dirty_sessions_) {
+    auto it = session_map_.find(imsi);
+    if (it != session_map_.end()) {
+      session_store_->write_session(imsi, it->second->marshal());
+    }
+  }
+  dirty_sessions_.clear();
+  evb_->timer().scheduleTimeoutFn(
+    std::move([this] { flush_dirty_sessions(); }),
+    session_store_write_interval_);
+}
+
+bool LocalEnforcer::restore_sessions()
+{
+  auto start = std::chrono::steady_clock::now();
+  std::vector<StoredSessionState> stored_sessions;
+  if (!session_store_->read_sessions(stored_sessions)) {
+    MLOG(MERROR) << "Failed to read the stored sessions";
+    return false;
+  }
+
+  auto now = time(NULL);
+  for (const auto &stored_session : stored_sessions) {
+    const auto &imsi = stored_session.imsi();
+    auto session = SessionState::unmarshal(stored_session, *rule_store_);
+    auto session_state = session.get();
+    session_map_[imsi] = std::move(session);
+    uint64_t imsi64;
+    if (imsi_to_imsi64(imsi, &imsi64)) {
+      sessions_by_imsi64_[imsi64] = session_state;
+    }
+
+    if (session_state->is_terminating()) {
+      resume_termination(imsi);
+    }
+    const auto &revalidation_time = session_state->get_revalidation_time();
+    if (TimeUtil::TimestampToSeconds(revalidation_time) > now) {
+      schedule_revalidation(revalidation_time);
+    }
+    // Validity timers don't survive a restart, so schedule them again.
+    // Credits that expired while sessiond was down are flagged for update
+    // right away below
+    auto &charging_pool = session_state->get_charging_pool();
+    for (auto expiry_time : charging_pool.get_expiry_times()) {
+      if (expiry_time > now) {
+        schedule_validity_timer(imsi, expiry_time - now);
+      }
+    }
+    charging_pool.check_pending_updates();
+    if (session_state->has_pending_updates()) {
+      sessions_with_updates_.insert(imsi);
+    }
+  }
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - start);
+  MLOG(MINFO) << "Restored " << stored_sessions.size() << " sessions in "
+              << elapsed.count() << " ms";
+  return true;
+}
+
+void LocalEnforcer::resume_termination(const std::string &imsi)
+{
+  auto it = session_map_.find(imsi);
+  if (it == session_map_.end()) {
+    return;
+  }
+  auto reporter = reporter_;
+  it->second->start_termination([reporter](SessionTerminateRequest term_req) {
+    // report to cloud
+    reporter->report_terminate_session(
+      term_req,
+      [term_req](Status status, SessionTerminateResponse response) {
+        if (!status.ok()) {
+          MLOG(MERROR)
+            << "Failed to terminate restored session in controller for "
+            << "subscriber " << term_req.sid() << ": "
+            << status.error_message();
+        } else {
+          MLOG(MDEBUG)
+            << "Termination successful in controller for subscriber "
+            << term_req.sid();
+        }
+      });
+  });
+
+  std::string session_id = it->second->get_session_id();
+  evb_->runAfterDelay(
+    [this, imsi, session_id] {
+      MLOG(MDEBUG) << "Completing forced termination for restored IMSI "
+                   << imsi;
+      complete_termination(imsi, session_id);
+    },
+    session_force_termination_timeout_ms_);
+}
+
 bool LocalEnforcer::setup(
   const std::uint64_t &epoch,
   std::function<void(Status status, SetupFlowsResult)> callback)
@@ -127,8 +260,8 @@ void LocalEnforcer::aggregate_records(const RuleRecordTable &records)
 {
   new_report(); // unmark all credits
   for (const RuleRecord &record : records.records()) {
-    auto it = session_map_.find(record.sid());
-    if (it == session_map_.end()) {
+    auto session = find_session(record.sid());
+    if (session == nullptr) {
       MLOG(MERROR) << "Could not find session for IMSI " << record.sid()
                    << " during record aggregation";
       continue;
@@ -138,8 +271,14 @@ void LocalEnforcer::aggregate_records(const RuleRecordTable &records)
                    << record.bytes_tx() << " tx bytes and " << record.bytes_rx()
                    << " rx bytes for rule " << record.rule_id();
     }
-    it->second->add_used_credit(
-      record.rule_id(), record.bytes_tx(), record.bytes_rx());
+    auto rule_index = rule_ids_.intern(record.rule_id());
+    session->add_used_credit(
+      record.rule_id(),
+      rule_index,
+      rule_ids_.get_generation(),
+      record.bytes_tx(),
+      record.bytes_rx());
+    on_session_updated(record.sid(), *session);
   }
   finish_report();
 }
@@ -186,6 +325,7 @@ void LocalEnforcer::terminate_service(
     return;
   }
 
+  on_session_updated(imsi, *it->second);
   it->second->start_termination([this](SessionTerminateRequest term_req) {
     // report to cloud
     reporter_->report_terminate_session(
@@ -277,8 +417,16 @@ UpdateSessionRequest LocalEnforcer::collect_updates()
 {
   UpdateSessionRequest request;
   std::vector<std::unique_ptr<ServiceAction>> actions;
-  for (auto &session_pair : session_map_) {
-    session_pair.second->get_updates(request, &actions);
+  std::vector<std::string> imsis(
+    sessions_with_updates_.begin(), sessions_with_updates_.end());
+  for (const auto &imsi : imsis) {
+    auto it = session_map_.find(imsi);
+    if (it == session_map_.end()) {
+      sessions_with_updates_.erase(imsi);
+      continue;
+    }
+    it->second->get_updates(request, &actions);
+    on_session_updated(imsi, *it->second);
   }
   execute_actions(actions);
   return request;
@@ -295,6 +443,7 @@ void LocalEnforcer::reset_updates(const UpdateSessionRequest &failed_request)
     }
     it->second->get_charging_pool().reset_reporting_credit(
       update.usage().charging_key());
+    on_session_updated(update.sid(), *it->second);
   }
   for (const auto &update : failed_request.usage_monitors()) {
     auto it = session_map_.find(update.sid());
@@ -305,6 +454,7 @@ void LocalEnforcer::reset_updates(const UpdateSessionRequest &failed_request)
     }
     it->second->get_monitor_pool().reset_reporting_credit(
       update.update().monitoring_key());
+    on_session_updated(update.sid(), *it->second);
   }
 }
 
@@ -353,6 +503,7 @@ void LocalEnforcer::schedule_static_rule_activation(
                          << static_rule.rule_id();
         } else {
           it->second->activate_static_rule(static_rule.rule_id());
+          on_session_updated(imsi, *it->second);
         }
       }),
       delta);
@@ -383,6 +534,7 @@ void LocalEnforcer::schedule_dynamic_rule_activation(
                          << dynamic_rule.policy_rule().id();
         } else {
           it->second->insert_dynamic_rule(dynamic_rule.policy_rule());
+          on_session_updated(imsi, *it->second);
         }
       }),
       delta);
@@ -415,6 +567,7 @@ void LocalEnforcer::schedule_static_rule_deactivation(
             MLOG(MWARNING) << "Could not find rule " << static_rule.rule_id()
                            << "for IMSI " << imsi
                            << " during static rule removal";
+          on_session_updated(imsi, *it->second);
         }
       }),
       delta);
@@ -446,6 +599,7 @@ void LocalEnforcer::schedule_dynamic_rule_deactivation(
           PolicyRule rule_dont_care;
           it->second->remove_dynamic_rule(
             dynamic_rule.policy_rule().id(), &rule_dont_care);
+          on_session_updated(imsi, *it->second);
         }
       }),
       delta);
@@ -538,11 +692,19 @@ bool LocalEnforcer::init_session_credit(
     if (credit.success() && contains_credit(credit.credit().granted_units())) {
       successful_credits.insert(credit.charging_key());
     }
+    if (credit.success() && credit.credit().validity_time() > 0) {
+      schedule_validity_timer(imsi, credit.credit().validity_time());
+    }
   }
   for (const auto &monitor : response.usage_monitors()) {
     session_state->get_monitor_pool().receive_credit(monitor);
   }
   session_map_[imsi] = std::unique_ptr<SessionState>(session_state);
+  uint64_t imsi64;
+  if (imsi_to_imsi64(imsi, &imsi64)) {
+    sessions_by_imsi64_[imsi64] = session_state;
+  }
+  on_session_updated(imsi, *session_state);
 
   if (session_state->is_radius_cwf_session()) {
     MLOG(MDEBUG) << "Adding UE MAC flow for subscriber " << imsi;
@@ -626,6 +788,15 @@ void LocalEnforcer::complete_termination(
   // Complete session termination and remove session from session_map_.
   it->second->complete_termination();
   session_map_.erase(imsi);
+  sessions_with_updates_.erase(imsi);
+  if (session_store_ != nullptr) {
+    dirty_sessions_.erase(imsi);
+    session_store_->remove_session(imsi);
+  }
+  uint64_t imsi64;
+  if (imsi_to_imsi64(imsi, &imsi64)) {
+    sessions_by_imsi64_.erase(imsi64);
+  }
   MLOG(MDEBUG) << "Successfully terminated session for IMSI " << imsi
                << "session ID " << session_id;
 }
@@ -641,21 +812,32 @@ void LocalEnforcer::update_session_credit(const UpdateSessionResponse &response)
     }
     if (credit_update_resp.success()) {
         it->second->get_charging_pool().receive_credit(credit_update_resp);
+        if (credit_update_resp.credit().validity_time() > 0) {
+          schedule_validity_timer(
+            credit_update_resp.sid(),
+            credit_update_resp.credit().validity_time());
+        }
     }
+    on_session_updated(credit_update_resp.sid(), *it->second);
   }
 
   for (const auto &usage_monitor_resp : response.usage_monitor_responses()) {
+    const std::string imsi = usage_monitor_resp.sid();
+    auto it = session_map_.find(imsi);
     if (revalidation_required(usage_monitor_resp.event_triggers())) {
       schedule_revalidation(usage_monitor_resp.revalidation_time());
+      if (it != session_map_.end()) {
+        it->second->set_revalidation_time(
+          usage_monitor_resp.revalidation_time());
+      }
     }
-    const std::string imsi = usage_monitor_resp.sid();
-    auto it = session_map_.find(imsi);
     if (it == session_map_.end()) {
       MLOG(MERROR) << "Could not find session for IMSI "
                    << imsi << " during update";
       return;
     }
     it->second->get_monitor_pool().receive_credit(usage_monitor_resp);
+    on_session_updated(imsi, *it->second);
 
     RulesToProcess rules_to_deactivate;
     process_rules_to_remove(
@@ -692,6 +874,7 @@ void LocalEnforcer::terminate_subscriber(
     throw SessionNotFound();
   }
   it->second->start_termination(on_termination_callback);
+  on_session_updated(imsi, *it->second);
 
   if (!pipelined_client_->deactivate_all_flows(imsi)) {
     MLOG(MERROR) << "Could not deactivate flows for IMSI " << imsi
@@ -742,14 +925,18 @@ ChargingReAuthAnswer::Result LocalEnforcer::init_charging_reauth(
                  << " during reauth";
     return ChargingReAuthAnswer::SESSION_NOT_FOUND;
   }
+  ChargingReAuthAnswer::Result res;
   if (request.type() == ChargingReAuthRequest::SINGLE_SERVICE) {
     MLOG(MDEBUG) << "Initiating reauth of key " << request.charging_key()
                  << " for subscriber " << request.sid();
-    return it->second->get_charging_pool().reauth_key(request.charging_key());
+    res = it->second->get_charging_pool().reauth_key(request.charging_key());
+  } else {
+    MLOG(MDEBUG) << "Initiating reauth of all keys for subscriber "
+                 << request.sid();
+    res = it->second->get_charging_pool().reauth_all();
   }
-  MLOG(MDEBUG) << "Initiating reauth of all keys for subscriber "
-               << request.sid();
-  return it->second->get_charging_pool().reauth_all();
+  on_session_updated(request.sid(), *it->second);
+  return res;
 }
 
 void LocalEnforcer::init_policy_reauth(
@@ -765,6 +952,7 @@ void LocalEnforcer::init_policy_reauth(
   }
 
   receive_monitoring_credit_from_rar(request, it->second);
+  on_session_updated(request.imsi(), *it->second);
 
   RulesToProcess rules_to_activate;
   RulesToProcess rules_to_deactivate;
@@ -849,6 +1037,7 @@ void LocalEnforcer::get_rules_from_policy_reauth_request(
   MLOG(MDEBUG) << "Processing policy reauth for subscriber " << request.imsi();
   if (revalidation_required(request.event_triggers())) {
     schedule_revalidation(request.revalidation_time());
+    session->set_revalidation_time(request.revalidation_time());
   }
 
   std::time_t current_time = time(NULL);
@@ -927,6 +1116,52 @@ void LocalEnforcer::schedule_revalidation(
   });
 }
 
+SessionState *LocalEnforcer::find_session(const std::string &imsi)
+{
+  uint64_t imsi64;
+  if (imsi_to_imsi64(imsi, &imsi64)) {
+    auto it = sessions_by_imsi64_.find(imsi64);
+    return it == sessions_by_imsi64_.end() ? nullptr : it->second;
+  }
+  auto it = session_map_.find(imsi);
+  return it == session_map_.end() ? nullptr : it->second.get();
+}
+
+void LocalEnforcer::on_session_updated(
+  const std::string &imsi,
+  SessionState &session)
+{
+  if (session.has_pending_updates()) {
+    sessions_with_updates_.insert(imsi);
+  } else {
+    sessions_with_updates_.erase(imsi);
+  }
+  if (session_store_ != nullptr) {
+    dirty_sessions_.insert(imsi);
+  }
+}
+
+void LocalEnforcer::schedule_validity_timer(
+  const std::string &imsi,
+  uint32_t validity_time)
+{
+  std::chrono::seconds delta(validity_time);
+  evb_->runInEventBaseThread([=] {
+    evb_->timer().scheduleTimeoutFn(
+      std::move([=] {
+        auto it = session_map_.find(imsi);
+        if (it == session_map_.end()) {
+          return;
+        }
+        MLOG(MDEBUG) << "Validity timer expired for subscriber " << imsi;
+        // Expired credits report on the next usage collection
+        it->second->get_charging_pool().check_pending_updates();
+        on_session_updated(imsi, *it->second);
+      }),
+      delta);
+  });
+}
+
 void LocalEnforcer::create_bearer(
   const bool &activate_success,
   const std::unique_ptr<SessionState> &session,
@@ -16,6 +16,7 @@
 #include "PipelinedClient.h"
 #include "RuleStore.h"
 #include "SessionState.h"
+#include "SessionStore.h"
 #include "SpgwServiceClient.h"
 
 namespace magma {
@@ -50,6 +51,22 @@ class LocalEnforcer {
 
   folly::EventBase &get_event_base();
 
+  /**
+   * Persist the sessions in the session store, writing the changed ones every
+   * write_interval_ms. Must be called after attachEventBase
+   */
+  void attach_session_store(
+    std::shared_ptr<SessionStore> session_store,
+    uint32_t write_interval_ms);
+
+  /**
+   * Restore the sessions persisted in the attached session store, before
+   * serving any request. Sessions that were terminating resume their
+   * termination.
+   * @return true if the sessions could be read
+   */
+  bool restore_sessions();
+
   /**
    * Setup rules for all sessions in pipelined, used whenever pipelined
    * restarts and needs to recover state
@@ -153,6 +170,18 @@ class LocalEnforcer {
   std::shared_ptr<SpgwServiceClient> spgw_client_;
   std::shared_ptr<aaa::AAAClient> aaa_client_;
   std::unordered_map<std::string, std::unique_ptr<SessionState>> session_map_;
+  // Index of session_map_ by IMSI64, to find the sessions of usage records
+  // without hashing IMSI strings
+  std::unordered_map<uint64_t, SessionState *> sessions_by_imsi64_;
+  // Dense indexes of the rule ids found in usage records
+  RuleIdInterner rule_ids_;
+  // IMSIs of the sessions with credits to report or actions to take, the
+  // only ones visited by collect_updates
+  std::unordered_set<std::string> sessions_with_updates_;
+  std::shared_ptr<SessionStore> session_store_;
+  // IMSIs of the sessions changed since the last write to session_store_
+  std::unordered_set<std::string> dirty_sessions_;
+  std::chrono::milliseconds session_store_write_interval_;
   folly::EventBase *evb_;
   long session_force_termination_timeout_ms_;
 
@@ -268,6 +297,39 @@ class LocalEnforcer {
   void schedule_revalidation(
     const google::protobuf::Timestamp &revalidation_time);
 
+  /**
+   * Must be called after any change to a session. Marks the session for the
+   * next collect_updates if any of its credits has an update pending, and
+   * for the next write to the session store
+   */
+  void on_session_updated(const std::string &imsi, SessionState &session);
+
+  /**
+   * Write the sessions changed since the last flush to the session store,
+   * then schedule the next flush
+   */
+  void flush_dirty_sessions();
+
+  /**
+   * Resume the termination of a session restored from the session store,
+   * since its termination callback could not be stored
+   */
+  void resume_termination(const std::string &imsi);
+
+  /**
+   * Find a session by IMSI through the IMSI64 index
+   * @returns nullptr if there is no session for the IMSI
+   */
+  SessionState *find_session(const std::string &imsi);
+
+  /**
+   * Schedule a check of the session credits once validity_time seconds have
+   * passed, so that credits expiring without any usage still get reported
+   */
+  void schedule_validity_timer(
+    const std::string &imsi,
+    uint32_t validity_time);
+
   void check_usage_for_reporting();
 
   void execute_actions(
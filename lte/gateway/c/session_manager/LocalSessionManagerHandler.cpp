@@ -34,16 +34,19 @@ LocalSessionManagerHandlerImpl::LocalSessionManagerHandlerImpl(
 
 void LocalSessionManagerHandlerImpl::ReportRuleStats(
   ServerContext* context,
-  const RuleRecordTable* request,
+  RuleRecordTable* request,
   std::function<void(Status, Void)> response_callback)
 {
-  auto &request_cpy = *request;
-  MLOG(MDEBUG) << "Aggregating " << request_cpy.records_size() << " records";
-  enforcer_->get_event_base().runInEventBaseThread([this, request_cpy]() {
-    enforcer_->aggregate_records(request_cpy);
+  // Take the records rather than copying them into the event base, the
+  // request is done with once the response is sent
+  auto records = std::make_shared<RuleRecordTable>();
+  records->Swap(request);
+  MLOG(MDEBUG) << "Aggregating " << records->records_size() << " records";
+  reported_epoch_ = records->epoch();
+  enforcer_->get_event_base().runInEventBaseThread([this, records]() {
+    enforcer_->aggregate_records(*records);
     check_usage_for_reporting();
   });
-  reported_epoch_ = request_cpy.epoch();
   if (is_pipelined_restarted()) {
     MLOG(MDEBUG) << "Pipelined has been restarted, attempting to sync flows";
     restart_pipelined(reported_epoch_);
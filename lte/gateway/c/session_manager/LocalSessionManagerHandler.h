@@ -29,11 +29,12 @@ class LocalSessionManagerHandler {
   virtual ~LocalSessionManagerHandler() {}
 
   /**
-   * Report flow stats from pipelined and track the usage per rule
+   * Report flow stats from pipelined and track the usage per rule. The
+   * records are moved out of request
    */
   virtual void ReportRuleStats(
     ServerContext *context,
-    const RuleRecordTable *request,
+    RuleRecordTable *request,
     std::function<void(Status, Void)> response_callback) = 0;
 
   /**
@@ -68,11 +69,12 @@ class LocalSessionManagerHandlerImpl : public LocalSessionManagerHandler {
 
   ~LocalSessionManagerHandlerImpl() {}
   /**
-   * Report flow stats from pipelined and track the usage per rule
+   * Report flow stats from pipelined and track the usage per rule. The
+   * records are moved out of request
    */
   void ReportRuleStats(
     ServerContext* context,
-    const RuleRecordTable* request,
+    RuleRecordTable* request,
     std::function<void(Status, Void)> response_callback);
 
   /**
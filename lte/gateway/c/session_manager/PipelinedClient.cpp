@@ -7,12 +7,16 @@
  * of patent rights can be found in the PATENTS file in the same directory.
  */
 
+#include <algorithm>
+
 #include "PipelinedClient.h"
 
+#include "MetricsSingleton.h"
 #include "ServiceRegistrySingleton.h"
 #include "magma_logging.h"
 
 using grpc::Status;
+using magma::service303::MetricsSingleton;
 
 namespace { // anonymous
 
@@ -33,23 +37,35 @@ magma::DeactivateFlowsRequest create_deactivate_req(
   return req;
 }
 
-magma::ActivateFlowsRequest create_activate_req(
+void fill_activate_req(
   const std::string &imsi,
   const std::string &ip_addr,
   const std::vector<std::string> &static_rules,
-  const std::vector<magma::PolicyRule> &dynamic_rules)
+  const std::vector<magma::PolicyRule> &dynamic_rules,
+  magma::ActivateFlowsRequest *req)
 {
-  magma::ActivateFlowsRequest req;
-  req.mutable_sid()->set_id(imsi);
-  req.set_ip_addr(ip_addr);
-  auto ids = req.mutable_rule_ids();
+  req->mutable_sid()->set_id(imsi);
+  req->set_ip_addr(ip_addr);
+  auto ids = req->mutable_rule_ids();
+  ids->Reserve(static_rules.size());
   for (const auto &id : static_rules) {
     ids->Add()->assign(id);
   }
-  auto mut_dyn_rules = req.mutable_dynamic_rules();
+  auto mut_dyn_rules = req->mutable_dynamic_rules();
+  mut_dyn_rules->Reserve(dynamic_rules.size());
   for (const auto &dyn_rule : dynamic_rules) {
     mut_dyn_rules->Add()->CopyFrom(dyn_rule);
   }
+}
+
+magma::ActivateFlowsRequest create_activate_req(
+  const std::string &imsi,
+  const std::string &ip_addr,
+  const std::vector<std::string> &static_rules,
+  const std::vector<magma::PolicyRule> &dynamic_rules)
+{
+  magma::ActivateFlowsRequest req;
+  fill_activate_req(imsi, ip_addr, static_rules, dynamic_rules, &req);
   return req;
 }
 
@@ -63,23 +79,28 @@ magma::UEMacFlowRequest create_add_ue_mac_flow_req(
   return req;
 }
 
+// Build the setup chunk holding the sessions of infos in [begin, end)
 magma::SetupFlowsRequest create_setup_flows_req(
   const std::vector<magma::SessionState::SessionInfo> &infos,
-  const std::uint64_t &epoch)
+  size_t begin,
+  size_t end,
+  const std::uint64_t &epoch,
+  uint32_t chunk_seq)
 {
   magma::SetupFlowsRequest req;
-  std::vector<magma::ActivateFlowsRequest> activation_reqs;
-  for(auto it = infos.begin(); it != infos.end(); it++ )
-  {
-    auto activate_req = create_activate_req(it->imsi, it->ip_addr,
-      it->static_rules, it->dynamic_rules);
-    activation_reqs.push_back(activate_req);
-  }
   auto mut_rules = req.mutable_rules();
-  for (const auto &rule : activation_reqs) {
-    mut_rules->Add()->CopyFrom(rule);
+  mut_rules->Reserve(end - begin);
+  for (size_t i = begin; i < end; i++) {
+    fill_activate_req(
+      infos[i].imsi,
+      infos[i].ip_addr,
+      infos[i].static_rules,
+      infos[i].dynamic_rules,
+      mut_rules->Add());
   }
   req.set_epoch(epoch);
+  req.set_chunk_seq(chunk_seq);
+  req.set_last_chunk(end == infos.size());
   return req;
 }
 
@@ -88,15 +109,19 @@ magma::SetupFlowsRequest create_setup_flows_req(
 namespace magma {
 
 AsyncPipelinedClient::AsyncPipelinedClient(
-  std::shared_ptr<grpc::Channel> channel):
-  stub_(Pipelined::NewStub(channel))
+  std::shared_ptr<grpc::Channel> channel,
+  uint32_t setup_chunk_size):
+  stub_(Pipelined::NewStub(channel)),
+  setup_chunk_size_(setup_chunk_size)
 {
 }
 
-AsyncPipelinedClient::AsyncPipelinedClient():
-  AsyncPipelinedClient(ServiceRegistrySingleton::Instance()->GetGrpcChannel(
-    "pipelined",
-    ServiceRegistrySingleton::LOCAL))
+AsyncPipelinedClient::AsyncPipelinedClient(uint32_t setup_chunk_size):
+  AsyncPipelinedClient(
+    ServiceRegistrySingleton::Instance()->GetGrpcChannel(
+      "pipelined",
+      ServiceRegistrySingleton::LOCAL),
+    setup_chunk_size)
 {
 }
 
@@ -105,11 +130,64 @@ bool AsyncPipelinedClient::setup(
    const std::uint64_t &epoch,
    std::function<void(Status status, SetupFlowsResult)> callback)
 {
-  SetupFlowsRequest setup_req = create_setup_flows_req(infos, epoch);
-  setup_flows_rpc(setup_req, callback);
+  auto shared_infos =
+    std::make_shared<const std::vector<SessionState::SessionInfo>>(infos);
+  MLOG(MDEBUG) << "Setting up flows of " << infos.size()
+               << " sessions in pipelined for epoch " << epoch;
+  auto& metrics = MetricsSingleton::Instance();
+  metrics.GetGauge("pipelined_setup_sessions_total", {}).Set(infos.size());
+  metrics.GetGauge("pipelined_setup_sessions_done", {}).Set(0);
+  setup_chunk(shared_infos, 0, epoch, 0, callback);
   return true;
 }
 
+void AsyncPipelinedClient::setup_chunk(
+  std::shared_ptr<const std::vector<SessionState::SessionInfo>> infos,
+  size_t begin,
+  std::uint64_t epoch,
+  uint32_t attempt,
+  std::function<void(Status status, SetupFlowsResult)> callback)
+{
+  // Chunks are built one at a time, only once the previous one is accepted
+  size_t end = infos->size();
+  uint32_t chunk_seq = 0;
+  if (setup_chunk_size_ > 0) {
+    end = std::min(end, begin + setup_chunk_size_);
+    chunk_seq = begin / setup_chunk_size_;
+  }
+  auto req = create_setup_flows_req(*infos, begin, end, epoch, chunk_seq);
+  MetricsSingleton::Instance()
+    .GetCounter("pipelined_setup_chunks_sent", {})
+    .Increment();
+  setup_flows_rpc(
+    req,
+    [this, infos, begin, end, epoch, attempt, chunk_seq, callback](
+      Status status, SetupFlowsResult resp) {
+      bool failed = !status.ok() || resp.result() == SetupFlowsResult::FAILURE;
+      if (failed && attempt < SETUP_CHUNK_MAX_RETRIES) {
+        MLOG(MWARNING) << "Retrying pipelined setup chunk " << chunk_seq
+                       << " for epoch " << epoch;
+        MetricsSingleton::Instance()
+          .GetCounter("pipelined_setup_chunk_retries", {})
+          .Increment();
+        setup_chunk(infos, begin, epoch, attempt + 1, callback);
+        return;
+      }
+      if (failed || resp.result() == SetupFlowsResult::OUTDATED_EPOCH) {
+        callback(status, resp);
+        return;
+      }
+      MetricsSingleton::Instance()
+        .GetGauge("pipelined_setup_sessions_done", {})
+        .Set(end);
+      if (end == infos->size()) {
+        callback(status, resp);
+        return;
+      }
+      setup_chunk(infos, end, epoch, 0, callback);
+    });
+}
+
 bool AsyncPipelinedClient::deactivate_all_flows(const std::string &imsi)
 {
   DeactivateFlowsRequest req;
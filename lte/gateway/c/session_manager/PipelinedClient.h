@@ -81,12 +81,20 @@ class PipelinedClient {
  */
 class AsyncPipelinedClient : public GRPCReceiver, public PipelinedClient {
  public:
-  AsyncPipelinedClient();
+  // Maximum number of sessions per setup request, 0 to send them all at once
+  static const uint32_t DEFAULT_SETUP_CHUNK_SIZE = 1000;
 
-  AsyncPipelinedClient(std::shared_ptr<grpc::Channel> pipelined_channel);
+  explicit AsyncPipelinedClient(
+    uint32_t setup_chunk_size = DEFAULT_SETUP_CHUNK_SIZE);
+
+  AsyncPipelinedClient(
+    std::shared_ptr<grpc::Channel> pipelined_channel,
+    uint32_t setup_chunk_size = DEFAULT_SETUP_CHUNK_SIZE);
 
   /**
-   * Activates all rules for provided SessionInfos
+   * Activates all rules for provided SessionInfos. The sessions are sent in
+   * chunks of setup_chunk_size, one chunk after the other, and the callback
+   * is called once with the result of the last chunk or of the first failure
    * @param infos - list of SessionInfos to setup flows for
    * @return true if the operation was successful
    */
@@ -128,9 +136,18 @@ class AsyncPipelinedClient : public GRPCReceiver, public PipelinedClient {
 
  private:
   static const uint32_t RESPONSE_TIMEOUT = 6; // seconds
+  static const uint32_t SETUP_CHUNK_MAX_RETRIES = 3;
   std::unique_ptr<Pipelined::Stub> stub_;
+  const uint32_t setup_chunk_size_;
 
  private:
+  void setup_chunk(
+    std::shared_ptr<const std::vector<SessionState::SessionInfo>> infos,
+    size_t begin,
+    std::uint64_t epoch,
+    uint32_t attempt,
+    std::function<void(Status status, SetupFlowsResult)> callback);
+
   void setup_flows_rpc(
     const SetupFlowsRequest &request,
     std::function<void(Status, SetupFlowsResult)> callback);
@@ -38,7 +38,7 @@ void PoliciesByKeyMap<KeyType>::remove(
     return;
   }
 
-  auto rules = iter->second;
+  auto &rules = iter->second;
   auto found = std::find(rules.begin(), rules.end(), rule_p);
   if (found == rules.end()) {
     return;
@@ -93,6 +93,7 @@ static bool should_track_monitoring_key(PolicyRule::TrackingType tracking_type)
 void PolicyRuleBiMap::sync_rules(const std::vector<PolicyRule> &rules)
 {
   std::lock_guard<std::mutex> lock(map_mutex_);
+  version_++;
   rules_by_rule_id_.clear();
   rules_by_charging_key_ = PoliciesByKeyMap<uint32_t>();
   rules_by_monitoring_key_ = PoliciesByKeyMap<std::string>();
@@ -110,8 +111,33 @@ void PolicyRuleBiMap::sync_rules(const std::vector<PolicyRule> &rules)
 
 void PolicyRuleBiMap::insert_rule(const PolicyRule &rule)
 {
-  auto rule_p = std::make_shared<PolicyRule>(rule);
   std::lock_guard<std::mutex> lock(map_mutex_);
+  version_++;
+  insert_rule_locked(rule);
+}
+
+void PolicyRuleBiMap::apply_updates(
+  const std::vector<PolicyRule> &changed_rules,
+  const std::vector<std::string> &removed_rule_ids)
+{
+  if (changed_rules.empty() && removed_rule_ids.empty()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(map_mutex_);
+  version_++;
+  for (const auto &rule_id : removed_rule_ids) {
+    remove_rule_locked(rule_id);
+  }
+  for (const auto &rule : changed_rules) {
+    insert_rule_locked(rule);
+  }
+}
+
+void PolicyRuleBiMap::insert_rule_locked(const PolicyRule &rule)
+{
+  // Drop the old definition first so that it isn't left in the key indices
+  remove_rule_locked(rule.id());
+  auto rule_p = std::make_shared<PolicyRule>(rule);
   rules_by_rule_id_[rule.id()] = rule_p;
   if (should_track_charging_key(rule.tracking_type())) {
     rules_by_charging_key_.insert(rule.rating_group(), rule_p);
@@ -121,6 +147,24 @@ void PolicyRuleBiMap::insert_rule(const PolicyRule &rule)
   }
 }
 
+std::shared_ptr<PolicyRule> PolicyRuleBiMap::remove_rule_locked(
+  const std::string &rule_id)
+{
+  auto it = rules_by_rule_id_.find(rule_id);
+  if (it == rules_by_rule_id_.end()) {
+    return nullptr;
+  }
+  auto rule_ptr = it->second;
+  rules_by_rule_id_.erase(it);
+  if (should_track_charging_key(rule_ptr->tracking_type())) {
+    rules_by_charging_key_.remove(rule_ptr->rating_group(), rule_ptr);
+  }
+  if (should_track_monitoring_key(rule_ptr->tracking_type())) {
+    rules_by_monitoring_key_.remove(rule_ptr->monitoring_key(), rule_ptr);
+  }
+  return rule_ptr;
+}
+
 bool PolicyRuleBiMap::get_rule(const std::string &rule_id, PolicyRule *rule)
 {
   std::lock_guard<std::mutex> lock(map_mutex_);
@@ -137,23 +181,12 @@ bool PolicyRuleBiMap::remove_rule(
   PolicyRule *rule_out)
 {
   std::lock_guard<std::mutex> lock(map_mutex_);
-  auto it = rules_by_rule_id_.find(rule_id);
-  if (it == rules_by_rule_id_.end()) {
+  auto rule_ptr = remove_rule_locked(rule_id);
+  if (rule_ptr == nullptr) {
     return false;
   }
-
-  auto rule_ptr = it->second;
+  version_++;
   rule_out->CopyFrom(*rule_ptr);
-
-  // Remove the rule from all mappings
-  rules_by_rule_id_.erase(it);
-  if (should_track_charging_key(rule_ptr->tracking_type())) {
-    rules_by_charging_key_.remove(rule_ptr->rating_group(), rule_ptr);
-  }
-  if (should_track_monitoring_key(rule_ptr->tracking_type())) {
-    rules_by_monitoring_key_.remove(rule_ptr->monitoring_key(), rule_ptr);
-  }
-
   return true;
 }
 
@@ -249,4 +282,38 @@ bool PolicyRuleBiMap::get_rules(
   return true;
 }
 
+uint64_t PolicyRuleBiMap::get_version() const
+{
+  return version_.load();
+}
+
+const size_t RuleIdInterner::DEFAULT_MAX_RULE_IDS;
+
+RuleIdInterner::RuleIdInterner(size_t max_rule_ids):
+  max_rule_ids_(max_rule_ids),
+  generation_(0)
+{
+}
+
+uint32_t RuleIdInterner::intern(const std::string &rule_id)
+{
+  auto it = index_by_rule_id_.find(rule_id);
+  if (it != index_by_rule_id_.end()) {
+    return it->second;
+  }
+  if (index_by_rule_id_.size() >= max_rule_ids_) {
+    // Rule ids of removed dynamic rules are never released, start over
+    index_by_rule_id_.clear();
+    generation_++;
+  }
+  uint32_t index = index_by_rule_id_.size();
+  index_by_rule_id_[rule_id] = index;
+  return index;
+}
+
+uint64_t RuleIdInterner::get_generation() const
+{
+  return generation_;
+}
+
 } // namespace magma
@@ -8,6 +8,7 @@
  */
 #pragma once
 
+#include <atomic>
 #include <mutex>
 #include <unordered_map>
 
@@ -56,6 +57,14 @@ class PolicyRuleBiMap {
 
   virtual void insert_rule(const PolicyRule &rule);
 
+  /**
+   * Apply an incremental update from policydb: insert or replace the changed
+   * rules and remove the given rule ids, as a single new version
+   */
+  virtual void apply_updates(
+    const std::vector<PolicyRule> &changed_rules,
+    const std::vector<std::string> &removed_rule_ids);
+
   virtual bool get_rule(const std::string &rule_id, PolicyRule *rule);
 
   // Remove a rule from the store by ID. Returns true if the rule ID was found.
@@ -105,7 +114,18 @@ class PolicyRuleBiMap {
     std::vector<PolicyRule> &rules_out
   );
 
+  /**
+   * Get the version of the rules, which changes whenever a rule is added,
+   * removed or the rules are synced. Used to invalidate cached rule lookups
+   */
+  uint64_t get_version() const;
+
  protected:
+  // Both helpers expect map_mutex_ to be held
+  void insert_rule_locked(const PolicyRule &rule);
+  std::shared_ptr<PolicyRule> remove_rule_locked(const std::string &rule_id);
+
+  std::atomic<uint64_t> version_ {0};
   std::mutex map_mutex_;
   // rule_id -> PolicyRule
   std::unordered_map<std::string, std::shared_ptr<PolicyRule>>
@@ -128,4 +148,35 @@ class StaticRuleStore : public PolicyRuleBiMap {
 class DynamicRuleStore : public PolicyRuleBiMap {
 };
 
+/**
+ * RuleIdInterner assigns dense indexes to the rule ids found in usage
+ * reports, so that sessions can cache the keys of a rule in a vector instead
+ * of looking the rule id up in the rule stores for every record.
+ * It is not thread safe, and only used from the event base thread.
+ */
+class RuleIdInterner {
+ public:
+  RuleIdInterner(size_t max_rule_ids = DEFAULT_MAX_RULE_IDS);
+
+  /**
+   * Get the index of a rule id, assigning the next free one to new rule ids.
+   * Once max_rule_ids rule ids are interned, every index is reassigned and the
+   * generation changes
+   */
+  uint32_t intern(const std::string &rule_id);
+
+  /**
+   * Get the generation of the indexes, indexes of different generations must
+   * not be mixed
+   */
+  uint64_t get_generation() const;
+
+  static const size_t DEFAULT_MAX_RULE_IDS = 65536;
+
+ private:
+  size_t max_rule_ids_;
+  uint64_t generation_;
+  std::unordered_map<std::string, uint32_t> index_by_rule_id_;
+};
+
 } // namespace magma
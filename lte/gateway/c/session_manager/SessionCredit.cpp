@@ -29,9 +29,13 @@ const std::set<uint32_t> SessionCredit::transient_result_codes_ = {
 SessionCredit::SessionCredit(CreditType credit_type, ServiceState start_state):
   credit_type_(credit_type),
   reporting_(false),
+  is_final_(false),
+  final_action_info_ {},
   reauth_state_(REAUTH_NOT_NEEDED),
   service_state_(start_state),
-  buckets_ {}
+  expiry_time_(std::numeric_limits<std::time_t>::max()),
+  buckets_ {},
+  usage_reporting_limit_(0)
 {
 }
 
@@ -41,6 +45,44 @@ SessionCredit::SessionCredit(CreditType credit_type):
 {
 }
 
+std::unique_ptr<SessionCredit> SessionCredit::unmarshal(
+  const StoredSessionCredit &marshaled)
+{
+  auto credit = std::make_unique<SessionCredit>(
+    static_cast<CreditType>(marshaled.credit_type()),
+    static_cast<ServiceState>(marshaled.service_state()));
+  credit->reporting_ = marshaled.reporting();
+  credit->is_final_ = marshaled.is_final();
+  credit->final_action_info_.final_action = marshaled.final_action();
+  credit->final_action_info_.redirect_server = marshaled.redirect_server();
+  credit->reauth_state_ = static_cast<ReAuthState>(marshaled.reauth_state());
+  credit->expiry_time_ = marshaled.expiry_time();
+  for (int i = 0; i < marshaled.buckets_size() && i < MAX_VALUES; i++) {
+    credit->buckets_[i] = marshaled.buckets(i);
+  }
+  credit->usage_reporting_limit_ = marshaled.usage_reporting_limit();
+  return credit;
+}
+
+StoredSessionCredit SessionCredit::marshal() const
+{
+  StoredSessionCredit marshaled;
+  marshaled.set_credit_type(credit_type_);
+  marshaled.set_reporting(reporting_);
+  marshaled.set_is_final(is_final_);
+  marshaled.set_final_action(final_action_info_.final_action);
+  marshaled.mutable_redirect_server()->CopyFrom(
+    final_action_info_.redirect_server);
+  marshaled.set_reauth_state(reauth_state_);
+  marshaled.set_service_state(service_state_);
+  marshaled.set_expiry_time(expiry_time_);
+  for (int i = 0; i < MAX_VALUES; i++) {
+    marshaled.add_buckets(buckets_[i]);
+  }
+  marshaled.set_usage_reporting_limit(usage_reporting_limit_);
+  return marshaled;
+}
+
 void SessionCredit::set_expiry_time(uint32_t validity_time)
 {
   if (validity_time == 0) {
@@ -291,11 +333,23 @@ bool SessionCredit::is_reporting()
   return reporting_;
 }
 
+bool SessionCredit::has_pending_update()
+{
+  return service_state_ == SERVICE_NEEDS_DEACTIVATION ||
+    service_state_ == SERVICE_NEEDS_ACTIVATION ||
+    get_update_type() != CREDIT_NO_UPDATE;
+}
+
 uint64_t SessionCredit::get_credit(Bucket bucket) const
 {
   return buckets_[bucket];
 }
 
+std::time_t SessionCredit::get_expiry_time() const
+{
+  return expiry_time_;
+}
+
 bool SessionCredit::is_reauth_required()
 {
   return reauth_state_ == REAUTH_REQUIRED;
@@ -13,6 +13,7 @@
 #include <memory>
 
 #include <lte/protos/session_manager.grpc.pb.h>
+#include <lte/protos/session_store.pb.h>
 
 #include "ServiceAction.h"
 
@@ -82,6 +83,17 @@ class SessionCredit {
 
   SessionCredit(CreditType credit_type, ServiceState start_state);
 
+  /**
+   * unmarshal creates a credit from its stored form, see marshal
+   */
+  static std::unique_ptr<SessionCredit> unmarshal(
+    const StoredSessionCredit &marshaled);
+
+  /**
+   * marshal saves the credit to be stored in the session store
+   */
+  StoredSessionCredit marshal() const;
+
   /**
    * add_used_credit increments USED_TX and USED_RX
    * as being recently updated
@@ -137,11 +149,23 @@ class SessionCredit {
    */
   bool is_reporting();
 
+  /**
+   * Returns true if the credit has an action to take or usage to report, ie.
+   * if get_action or get_update_type would not return their no-op value
+   */
+  bool has_pending_update();
+
   /**
    * Helper function to get the credit in a particular bucket
    */
   uint64_t get_credit(Bucket bucket) const;
 
+  /**
+   * Returns the time at which the validity timer of the credit expires, or
+   * the max time_t if the credit has no validity time
+   */
+  std::time_t get_expiry_time() const;
+
   /**
    * Mark the credit to be in the REAUTH_REQUIRED state. The next time
    * get_update is called, this credit will report its usage.
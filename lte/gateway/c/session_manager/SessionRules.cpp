@@ -11,10 +11,45 @@
 namespace magma {
 
 SessionRules::SessionRules(StaticRuleStore &static_rule_ref):
-  static_rules_(static_rule_ref)
+  static_rules_(static_rule_ref),
+  keys_generation_(0),
+  keys_static_version_(static_rule_ref.get_version()),
+  keys_dynamic_version_(dynamic_rules_.get_version())
 {
 }
 
+const SessionRules::RuleKeys &SessionRules::get_keys_for_rule(
+  const std::string &rule_id,
+  uint32_t rule_index,
+  uint64_t generation)
+{
+  // Read the versions before any lookup, so that a concurrent sync of the
+  // static rules invalidates the keys cached below
+  auto static_version = static_rules_.get_version();
+  auto dynamic_version = dynamic_rules_.get_version();
+  if (
+    generation != keys_generation_ ||
+    static_version != keys_static_version_ ||
+    dynamic_version != keys_dynamic_version_) {
+    keys_by_rule_index_.clear();
+    keys_generation_ = generation;
+    keys_static_version_ = static_version;
+    keys_dynamic_version_ = dynamic_version;
+  }
+  for (const auto &keys_pair : keys_by_rule_index_) {
+    if (keys_pair.first == rule_index) {
+      return keys_pair.second;
+    }
+  }
+  RuleKeys keys;
+  keys.has_charging_key =
+    get_charging_key_for_rule_id(rule_id, &keys.charging_key);
+  keys.has_monitoring_key =
+    get_monitoring_key_for_rule_id(rule_id, &keys.monitoring_key);
+  keys_by_rule_index_.emplace_back(rule_index, std::move(keys));
+  return keys_by_rule_index_.back().second;
+}
+
 bool SessionRules::get_charging_key_for_rule_id(
   const std::string &rule_id,
   uint32_t *charging_key)
@@ -104,4 +139,25 @@ DynamicRuleStore &SessionRules::get_dynamic_rules()
   return dynamic_rules_;
 }
 
+void SessionRules::marshal(StoredSessionState &marshaled)
+{
+  for (const auto &rule_id : active_static_rules_) {
+    marshaled.add_static_rule_ids(rule_id);
+  }
+  std::vector<PolicyRule> dynamic_rules;
+  dynamic_rules_.get_rules(dynamic_rules);
+  for (const auto &rule : dynamic_rules) {
+    marshaled.add_dynamic_rules()->CopyFrom(rule);
+  }
+}
+
+void SessionRules::unmarshal(const StoredSessionState &marshaled)
+{
+  active_static_rules_.assign(
+    marshaled.static_rule_ids().begin(), marshaled.static_rule_ids().end());
+  std::vector<PolicyRule> dynamic_rules(
+    marshaled.dynamic_rules().begin(), marshaled.dynamic_rules().end());
+  dynamic_rules_.sync_rules(dynamic_rules);
+}
+
 } // namespace magma
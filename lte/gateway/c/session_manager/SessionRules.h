@@ -8,6 +8,8 @@
  */
 #pragma once
 
+#include <lte/protos/session_store.pb.h>
+
 #include "RuleStore.h"
 #include "ServiceAction.h"
 
@@ -18,8 +20,28 @@ namespace magma {
  */
 class SessionRules {
  public:
+  /**
+   * Keys tracking the usage of a rule
+   */
+  struct RuleKeys {
+    bool has_charging_key;
+    uint32_t charging_key;
+    bool has_monitoring_key;
+    std::string monitoring_key;
+  };
+
   SessionRules(StaticRuleStore &static_rule_ref);
 
+  /**
+   * Get the keys of a rule interned as rule_index by a RuleIdInterner of the
+   * given generation. The keys are cached until the rules change, so that
+   * usage reports don't go through the rule stores for every record.
+   */
+  const RuleKeys &get_keys_for_rule(
+    const std::string &rule_id,
+    uint32_t rule_index,
+    uint64_t generation);
+
   bool get_charging_key_for_rule_id(
     const std::string &rule_id,
     uint32_t *charging_key);
@@ -42,10 +64,25 @@ class SessionRules {
   std::vector<std::string> &get_static_rule_ids();
   DynamicRuleStore &get_dynamic_rules();
 
+  /**
+   * marshal saves the active rules into the stored session
+   */
+  void marshal(StoredSessionState &marshaled);
+
+  /**
+   * unmarshal restores the active rules saved by marshal
+   */
+  void unmarshal(const StoredSessionState &marshaled);
+
  private:
   StaticRuleStore &static_rules_;
   std::vector<std::string> active_static_rules_;
   DynamicRuleStore dynamic_rules_;
+  // Sessions only report a handful of rules, a linear scan beats hashing
+  std::vector<std::pair<uint32_t, RuleKeys>> keys_by_rule_index_;
+  uint64_t keys_generation_;
+  uint64_t keys_static_version_;
+  uint64_t keys_dynamic_version_;
 };
 
 } // namespace magma
@@ -34,6 +34,76 @@ SessionState::SessionState(
 {
 }
 
+std::unique_ptr<SessionState> SessionState::unmarshal(
+  const StoredSessionState& marshaled,
+  StaticRuleStore& rule_store)
+{
+  const auto& stored_cfg = marshaled.config();
+  Config cfg;
+  cfg.ue_ipv4 = stored_cfg.ue_ipv4();
+  cfg.spgw_ipv4 = stored_cfg.spgw_ipv4();
+  cfg.msisdn = stored_cfg.msisdn();
+  cfg.apn = stored_cfg.apn();
+  cfg.imei = stored_cfg.imei();
+  cfg.plmn_id = stored_cfg.plmn_id();
+  cfg.imsi_plmn_id = stored_cfg.imsi_plmn_id();
+  cfg.user_location = stored_cfg.user_location();
+  cfg.rat_type = stored_cfg.rat_type();
+  cfg.mac_addr = stored_cfg.mac_addr();
+  cfg.hardware_addr = stored_cfg.hardware_addr();
+  cfg.radius_session_id = stored_cfg.radius_session_id();
+  cfg.bearer_id = stored_cfg.bearer_id();
+  cfg.qos_info.enabled = stored_cfg.qos_enabled();
+  cfg.qos_info.qci = stored_cfg.qci();
+
+  auto session = std::make_unique<SessionState>(
+    marshaled.imsi(),
+    marshaled.session_id(),
+    marshaled.core_session_id(),
+    cfg,
+    rule_store);
+  session->request_number_ = marshaled.request_number();
+  session->curr_state_ = static_cast<State>(marshaled.state());
+  session->revalidation_time_ = marshaled.revalidation_time();
+  session->session_rules_.unmarshal(marshaled);
+  session->charging_pool_.unmarshal(marshaled);
+  session->monitor_pool_.unmarshal(marshaled);
+  return session;
+}
+
+StoredSessionState SessionState::marshal()
+{
+  StoredSessionState marshaled;
+  marshaled.set_imsi(imsi_);
+  marshaled.set_session_id(session_id_);
+  marshaled.set_core_session_id(core_session_id_);
+  marshaled.set_request_number(request_number_);
+  marshaled.set_state(curr_state_);
+
+  auto stored_cfg = marshaled.mutable_config();
+  stored_cfg->set_ue_ipv4(config_.ue_ipv4);
+  stored_cfg->set_spgw_ipv4(config_.spgw_ipv4);
+  stored_cfg->set_msisdn(config_.msisdn);
+  stored_cfg->set_apn(config_.apn);
+  stored_cfg->set_imei(config_.imei);
+  stored_cfg->set_plmn_id(config_.plmn_id);
+  stored_cfg->set_imsi_plmn_id(config_.imsi_plmn_id);
+  stored_cfg->set_user_location(config_.user_location);
+  stored_cfg->set_rat_type(config_.rat_type);
+  stored_cfg->set_mac_addr(config_.mac_addr);
+  stored_cfg->set_hardware_addr(config_.hardware_addr);
+  stored_cfg->set_radius_session_id(config_.radius_session_id);
+  stored_cfg->set_bearer_id(config_.bearer_id);
+  stored_cfg->set_qos_enabled(config_.qos_info.enabled);
+  stored_cfg->set_qci(config_.qos_info.qci);
+
+  marshaled.mutable_revalidation_time()->CopyFrom(revalidation_time_);
+  session_rules_.marshal(marshaled);
+  charging_pool_.marshal(marshaled);
+  monitor_pool_.marshal(marshaled);
+  return marshaled;
+}
+
 void SessionState::new_report()
 {
   if (curr_state_ == SESSION_TERMINATING_FLOW_ACTIVE) {
@@ -57,17 +127,46 @@ void SessionState::add_used_credit(
     curr_state_ = SESSION_TERMINATING_FLOW_ACTIVE;
   }
 
-  uint32_t charging_key;
-  if (session_rules_.get_charging_key_for_rule_id(rule_id, &charging_key)) {
-    charging_pool_.add_used_credit(charging_key, used_tx, used_rx);
+  SessionRules::RuleKeys keys;
+  keys.has_charging_key =
+    session_rules_.get_charging_key_for_rule_id(rule_id, &keys.charging_key);
+  keys.has_monitoring_key = session_rules_.get_monitoring_key_for_rule_id(
+    rule_id, &keys.monitoring_key);
+  add_used_credit_for_keys(keys, used_tx, used_rx);
+}
+
+void SessionState::add_used_credit(
+  const std::string& rule_id,
+  uint32_t rule_index,
+  uint64_t generation,
+  uint64_t used_tx,
+  uint64_t used_rx)
+{
+  if (curr_state_ == SESSION_TERMINATING_AGGREGATING_STATS) {
+    curr_state_ = SESSION_TERMINATING_FLOW_ACTIVE;
+  }
+
+  add_used_credit_for_keys(
+    session_rules_.get_keys_for_rule(rule_id, rule_index, generation),
+    used_tx,
+    used_rx);
+}
+
+void SessionState::add_used_credit_for_keys(
+  const SessionRules::RuleKeys& keys,
+  uint64_t used_tx,
+  uint64_t used_rx)
+{
+  if (keys.has_charging_key) {
+    charging_pool_.add_used_credit(keys.charging_key, used_tx, used_rx);
   }
-  std::string monitoring_key;
-  if (session_rules_.get_monitoring_key_for_rule_id(rule_id, &monitoring_key)) {
-    monitor_pool_.add_used_credit(monitoring_key, used_tx, used_rx);
+  if (keys.has_monitoring_key) {
+    monitor_pool_.add_used_credit(keys.monitoring_key, used_tx, used_rx);
   }
   auto session_level_key_p = monitor_pool_.get_session_level_key();
   if (
-    session_level_key_p != nullptr && monitoring_key != *session_level_key_p) {
+    session_level_key_p != nullptr &&
+    keys.monitoring_key != *session_level_key_p) {
     // Update session level key if its different
     monitor_pool_.add_used_credit(*session_level_key_p, used_tx, used_rx);
   }
@@ -140,6 +239,12 @@ void SessionState::get_updates(
   get_updates_from_monitor_pool(update_request_out, actions_out);
 }
 
+bool SessionState::has_pending_updates()
+{
+  return charging_pool_.has_pending_updates() ||
+    monitor_pool_.has_pending_updates();
+}
+
 void SessionState::start_termination(
   std::function<void(SessionTerminateRequest)> on_termination_callback)
 {
@@ -295,4 +400,20 @@ bool SessionState::qos_enabled()
   return config_.qos_info.enabled;
 }
 
+bool SessionState::is_terminating()
+{
+  return curr_state_ != SESSION_ACTIVE;
+}
+
+void SessionState::set_revalidation_time(
+  const google::protobuf::Timestamp& time)
+{
+  revalidation_time_ = time;
+}
+
+const google::protobuf::Timestamp& SessionState::get_revalidation_time()
+{
+  return revalidation_time_;
+}
+
 } // namespace magma
@@ -60,6 +60,20 @@ class SessionState {
     const SessionState::Config& cfg,
     StaticRuleStore& rule_store);
 
+  /**
+   * unmarshal creates a session from its stored form, see marshal. A
+   * terminating session needs start_termination to be called again, the
+   * termination callback is not stored
+   */
+  static std::unique_ptr<SessionState> unmarshal(
+    const StoredSessionState& marshaled,
+    StaticRuleStore& rule_store);
+
+  /**
+   * marshal saves the session to be stored in the session store
+   */
+  StoredSessionState marshal();
+
   /**
    * new_report sets the state of terminating session to aggregating, to tell if
    * flows for the terminating session is in the latest report.
@@ -82,6 +96,17 @@ class SessionState {
     uint64_t used_tx,
     uint64_t used_rx);
 
+  /**
+   * add_used_credit for a rule interned as rule_index by a RuleIdInterner of
+   * the given generation, which caches the keys of the rule in the session
+   */
+  void add_used_credit(
+    const std::string& rule_id,
+    uint32_t rule_index,
+    uint64_t generation,
+    uint64_t used_tx,
+    uint64_t used_rx);
+
   /**
    * get_updates collects updates and adds them to a UpdateSessionRequest
    * for reporting.
@@ -92,6 +117,12 @@ class SessionState {
     UpdateSessionRequest& update_request_out,
     std::vector<std::unique_ptr<ServiceAction>>* actions_out);
 
+  /**
+   * has_pending_updates returns whether any credit of the session has an
+   * update or a service action to be collected by get_updates.
+   */
+  bool has_pending_updates();
+
   /**
    * start_termination starts the termination process for the session.
    * The session state transitions from SESSION_ACTIVE to
@@ -160,6 +191,19 @@ class SessionState {
 
   bool qos_enabled();
 
+  /**
+   * Returns true once start_termination has been called
+   */
+  bool is_terminating();
+
+  /**
+   * Record the time of a revalidation requested for the session, so that it
+   * can be scheduled again after a restart
+   */
+  void set_revalidation_time(const google::protobuf::Timestamp& time);
+
+  const google::protobuf::Timestamp& get_revalidation_time();
+
  private:
   /**
    * State transitions of a session:
@@ -199,6 +243,7 @@ class SessionState {
   SessionState::State curr_state_;
   SessionState::Config config_;
   std::function<void(SessionTerminateRequest)> on_termination_callback_;
+  google::protobuf::Timestamp revalidation_time_;
 
  private:
   void get_updates_from_charging_pool(
@@ -208,6 +253,11 @@ class SessionState {
   void get_updates_from_monitor_pool(
     UpdateSessionRequest& update_request_out,
     std::vector<std::unique_ptr<ServiceAction>>* actions_out);
+
+  void add_used_credit_for_keys(
+    const SessionRules::RuleKeys& keys,
+    uint64_t used_tx,
+    uint64_t used_rx);
 };
 
 } // namespace magma
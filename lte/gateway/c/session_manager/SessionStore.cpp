@@ -0,0 +1,168 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+#include <chrono>
+#include <thread>
+
+#include "SessionStore.h"
+#include "PolicyLoader.h"
+#include "Serializers.h"
+#include "magma_logging.h"
+
+namespace magma {
+
+// Time waited before retrying writes after redis could not be reached
+const auto SESSION_STORE_RETRY_INTERVAL = std::chrono::seconds(1);
+
+SessionStore::SessionStore():
+  client_(std::make_shared<cpp_redis::client>()),
+  session_map_(
+    client_,
+    "sessiond:sessions",
+    get_proto_serializer(),
+    get_proto_deserializer()),
+  stop_requested_(false)
+{
+}
+
+bool SessionStore::ensure_connected()
+{
+  if (client_->is_connected()) {
+    return true;
+  }
+  if (!try_redis_connect(*client_)) {
+    return false;
+  }
+  MLOG(MINFO) << "Session store connected to redis server";
+  return true;
+}
+
+bool SessionStore::read_sessions(std::vector<StoredSessionState> &sessions_out)
+{
+  if (!ensure_connected()) {
+    return false;
+  }
+  std::vector<std::string> failed_keys;
+  auto result = session_map_.getall(sessions_out, &failed_keys);
+  if (result != SUCCESS) {
+    MLOG(MERROR) << "Failed to read sessions because map error " << result;
+    return false;
+  }
+  for (const auto &imsi : failed_keys) {
+    MLOG(MERROR) << "Dropping unreadable stored session for IMSI " << imsi;
+    session_map_.remove(imsi);
+  }
+  return true;
+}
+
+void SessionStore::write_session(
+  const std::string &imsi,
+  StoredSessionState session)
+{
+  queue_write(
+    imsi, std::make_unique<StoredSessionState>(std::move(session)));
+}
+
+void SessionStore::remove_session(const std::string &imsi)
+{
+  queue_write(imsi, nullptr);
+}
+
+void SessionStore::queue_write(
+  const std::string &imsi,
+  std::unique_ptr<StoredSessionState> session)
+{
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    pending_writes_[imsi] = std::move(session);
+  }
+  pending_cv_.notify_one();
+}
+
+void SessionStore::apply_writes(
+  std::unordered_map<std::string, std::unique_ptr<StoredSessionState>> &writes,
+  std::vector<std::string> &failed_imsis)
+{
+  std::unordered_map<std::string, StoredSessionState> sessions;
+  std::vector<std::string> removed_imsis;
+  for (auto &write : writes) {
+    if (write.second == nullptr) {
+      removed_imsis.push_back(write.first);
+    } else {
+      sessions[write.first] = std::move(*write.second);
+    }
+  }
+
+  std::vector<std::string> failed_sets;
+  session_map_.multi_set(sessions, &failed_sets);
+  for (const auto &imsi : failed_sets) {
+    // Hand the session back so that it can be retried
+    *writes[imsi] = std::move(sessions[imsi]);
+    failed_imsis.push_back(imsi);
+  }
+  if (session_map_.multi_delete(removed_imsis) != SUCCESS) {
+    failed_imsis.insert(
+      failed_imsis.end(), removed_imsis.begin(), removed_imsis.end());
+  }
+}
+
+void SessionStore::start_loop()
+{
+  while (true) {
+    std::unordered_map<std::string, std::unique_ptr<StoredSessionState>>
+      writes;
+    {
+      std::unique_lock<std::mutex> lock(pending_mutex_);
+      pending_cv_.wait(
+        lock, [this] { return stop_requested_ || !pending_writes_.empty(); });
+      if (pending_writes_.empty()) {
+        break; // stopped with nothing left to write
+      }
+      writes.swap(pending_writes_);
+    }
+
+    std::vector<std::string> failed_imsis;
+    if (ensure_connected()) {
+      apply_writes(writes, failed_imsis);
+    } else {
+      for (const auto &write : writes) {
+        failed_imsis.push_back(write.first);
+      }
+    }
+    if (failed_imsis.empty()) {
+      continue;
+    }
+
+    MLOG(MERROR) << "Failed to store " << failed_imsis.size()
+                 << " sessions, retrying";
+    {
+      // Retry the failed writes, unless a newer one was queued meanwhile
+      std::lock_guard<std::mutex> lock(pending_mutex_);
+      for (const auto &imsi : failed_imsis) {
+        if (pending_writes_.find(imsi) == pending_writes_.end()) {
+          pending_writes_[imsi] = std::move(writes[imsi]);
+        }
+      }
+    }
+    if (stop_requested_) {
+      break;
+    }
+    std::this_thread::sleep_for(SESSION_STORE_RETRY_INTERVAL);
+  }
+}
+
+void SessionStore::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    stop_requested_ = true;
+  }
+  pending_cv_.notify_one();
+}
+
+} // namespace magma
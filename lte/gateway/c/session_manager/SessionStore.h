@@ -0,0 +1,92 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <cpp_redis/cpp_redis>
+#include <lte/protos/session_store.pb.h>
+
+#include "RedisMap.hpp"
+
+namespace magma {
+using namespace lte;
+
+/**
+ * SessionStore persists the sessions of sessiond in redis, so that they can be
+ * restored when sessiond restarts. Writes are applied asynchronously by the
+ * writer loop, and consecutive writes of a session are coalesced so that only
+ * its latest state is sent to redis.
+ */
+class SessionStore {
+ public:
+  SessionStore();
+
+  /**
+   * read_sessions connects to redis and reads all the stored sessions. It
+   * blocks, and is meant to be called once before serving any request
+   * @return true if the sessions could be read
+   */
+  bool read_sessions(std::vector<StoredSessionState> &sessions_out);
+
+  /**
+   * write_session queues the latest state of the session of an IMSI
+   */
+  void write_session(const std::string &imsi, StoredSessionState session);
+
+  /**
+   * remove_session queues the removal of the session of an IMSI
+   */
+  void remove_session(const std::string &imsi);
+
+  /**
+   * start_loop applies the queued writes until stop is called, possibly
+   * before start_loop. It blocks
+   */
+  void start_loop();
+
+  /**
+   * Stop the writer loop once the queued writes are applied
+   */
+  void stop();
+
+ private:
+  std::shared_ptr<cpp_redis::client> client_;
+  RedisMap<StoredSessionState> session_map_;
+  // Set once by stop, start_loop then returns when the queue is empty
+  std::atomic<bool> stop_requested_;
+  std::mutex pending_mutex_;
+  std::condition_variable pending_cv_;
+  // Latest state of the sessions to write, nullptr for the ones to remove
+  std::unordered_map<std::string, std::unique_ptr<StoredSessionState>>
+    pending_writes_;
+
+ private:
+  bool ensure_connected();
+  void queue_write(
+    const std::string &imsi,
+    std::unique_ptr<StoredSessionState> session);
+  /**
+   * Write a batch of sessions and removals in one round trip per command.
+   * The IMSIs whose write failed are added to failed_imsis, and their
+   * sessions are left in writes to be retried
+   */
+  void apply_writes(
+    std::unordered_map<std::string, std::unique_ptr<StoredSessionState>>
+      &writes,
+    std::vector<std::string> &failed_imsis);
+};
+
+} // namespace magma
@@ -20,6 +20,7 @@
 #include "MConfigLoader.h"
 #include "magma_logging.h"
 #include "SessionCredit.h"
+#include "SessionStore.h"
 
 #define SESSIOND_SERVICE "sessiond"
 #define SESSION_PROXY_SERVICE "session_proxy"
@@ -128,16 +129,41 @@ int main(int argc, char *argv[])
   // prep rule manager and rule update loop
   auto rule_store = std::make_shared<magma::StaticRuleStore>();
   magma::PolicyLoader policy_loader;
+  auto incremental_rule_sync =
+    config["enable_incremental_rule_sync"].IsDefined() &&
+    config["enable_incremental_rule_sync"].as<bool>();
+  uint32_t full_rule_sync_interval_sec = 300;
+  if (config["full_rule_sync_interval_sec"].IsDefined()) {
+    full_rule_sync_interval_sec =
+      config["full_rule_sync_interval_sec"].as<uint32_t>();
+  }
   std::thread policy_loader_thread([&]() {
-    policy_loader.start_loop(
-      [&](std::vector<magma::PolicyRule> rules) {
-        rule_store->sync_rules(rules);
-      },
-      config["rule_update_inteval_sec"].as<uint32_t>());
+    if (incremental_rule_sync) {
+      policy_loader.start_incremental_loop(
+        [&](
+          const std::vector<magma::PolicyRule> &changed_rules,
+          const std::vector<std::string> &removed_rule_ids) {
+          rule_store->apply_updates(changed_rules, removed_rule_ids);
+        },
+        config["rule_update_inteval_sec"].as<uint32_t>(),
+        full_rule_sync_interval_sec);
+    } else {
+      policy_loader.start_loop(
+        [&](std::vector<magma::PolicyRule> rules) {
+          rule_store->sync_rules(rules);
+        },
+        config["rule_update_inteval_sec"].as<uint32_t>());
+    }
     policy_loader.stop();
   });
 
-  auto pipelined_client = std::make_shared<magma::AsyncPipelinedClient>();
+  uint32_t setup_chunk_size =
+    magma::AsyncPipelinedClient::DEFAULT_SETUP_CHUNK_SIZE;
+  if (config["pipelined_setup_chunk_size"].IsDefined()) {
+    setup_chunk_size = config["pipelined_setup_chunk_size"].as<uint32_t>();
+  }
+  auto pipelined_client =
+    std::make_shared<magma::AsyncPipelinedClient>(setup_chunk_size);
   std::thread rule_manager_thread([&]() {
     MLOG(MINFO) << "Started pipelined response thread";
     pipelined_client->rpc_response_loop();
@@ -194,6 +220,25 @@ int main(int argc, char *argv[])
     spgw_client,
     aaa_client,
     config["session_force_termination_timeout_ms"].as<long>());
+  monitor.attachEventBase(evb);
+
+  // Restore the sessions persisted before a restart, before serving requests
+  std::shared_ptr<magma::SessionStore> session_store;
+  std::thread session_store_thread;
+  if (
+    config["enable_session_persistence"].IsDefined() &&
+    config["enable_session_persistence"].as<bool>()) {
+    session_store = std::make_shared<magma::SessionStore>();
+    monitor.attach_session_store(
+      session_store, config["session_store_write_interval_ms"].as<uint32_t>());
+    if (!monitor.restore_sessions()) {
+      MLOG(MERROR) << "Starting without the sessions stored before restart";
+    }
+    session_store_thread = std::thread([&]() {
+      MLOG(MINFO) << "Started session store thread";
+      session_store->start_loop();
+    });
+  }
 
   magma::service303::MagmaService server(SESSIOND_SERVICE, SESSIOND_VERSION);
   auto local_handler = std::make_unique<magma::LocalSessionManagerHandlerImpl>(
@@ -221,9 +266,12 @@ int main(int argc, char *argv[])
   });
 
   // Block on main monitor (to keep evb in this thread)
-  monitor.attachEventBase(evb);
   monitor.start();
   server.Stop();
+  if (session_store != nullptr) {
+    session_store->stop();
+    session_store_thread.join();
+  }
 
   reporter_thread.join();
   local_thread.join();
@@ -146,7 +146,7 @@ class MockSessionHandler final : public LocalSessionManagerHandler {
     ReportRuleStats,
     void(
       grpc::ServerContext *,
-      const RuleRecordTable *,
+      RuleRecordTable *,
       std::function<void(Status, Void)>));
 
   MOCK_METHOD3(
@@ -0,0 +1,245 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+// Replays ReportRuleStats tables with a record per session and rule, 100k
+// records by default. Measures handing the table to the event base by copy
+// and by swap, resolving the rule of each record by rule id and by interned
+// index, and the whole LocalEnforcer::aggregate_records ingestion.
+//    rule_stats_bench [sessions] [rules per session] [replays]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/io/async/EventBaseManager.h>
+#include <gmock/gmock.h>
+
+#include "LocalEnforcer.h"
+#include "ProtobufCreators.h"
+#include "RuleStore.h"
+#include "SessionState.h"
+#include "SessiondMocks.h"
+
+using ::testing::NiceMock;
+using std::chrono::steady_clock;
+
+namespace magma {
+
+const SessionState::Config bench_cfg = {.ue_ipv4 = "127.0.0.1",
+                                        .spgw_ipv4 = "128.0.0.1"};
+// Enough credit that no record crosses a reporting threshold
+const uint64_t bench_grant = 1ULL << 50;
+const uint64_t bench_used_tx = 1000;
+const uint64_t bench_used_rx = 2000;
+
+static double elapsed_usec(steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::micro>(
+           steady_clock::now() - start)
+    .count();
+}
+
+static std::string bench_imsi(int i)
+{
+  char imsi[32];
+  snprintf(imsi, sizeof(imsi), "IMSI00101%010d", i);
+  return imsi;
+}
+
+static std::string bench_rule_id(int r)
+{
+  return "rule" + std::to_string(r);
+}
+
+class RuleStatsBench {
+ public:
+  RuleStatsBench(int sessions, int rules): sessions_(sessions), rules_(rules)
+  {
+    rule_store_ = std::make_shared<StaticRuleStore>();
+    for (int r = 0; r < rules; r++) {
+      PolicyRule rule;
+      rule.set_id(bench_rule_id(r));
+      rule.set_rating_group(r + 1);
+      rule.set_tracking_type(PolicyRule::ONLY_OCS);
+      rule_store_->insert_rule(rule);
+    }
+    for (int i = 0; i < sessions; i++) {
+      for (int r = 0; r < rules; r++) {
+        create_rule_record(
+          bench_imsi(i),
+          bench_rule_id(r),
+          bench_used_rx,
+          bench_used_tx,
+          table_.mutable_records()->Add());
+      }
+    }
+  }
+
+  // ReportRuleStats used to copy the table into the event base, it now
+  // swaps it out of the request
+  void bench_hand_off(int replays)
+  {
+    auto start = steady_clock::now();
+    for (int i = 0; i < replays; i++) {
+      auto records = std::make_shared<RuleRecordTable>(table_);
+    }
+    double copy_usec = elapsed_usec(start) / replays;
+
+    RuleRecordTable request = table_;
+    start = steady_clock::now();
+    for (int i = 0; i < replays; i++) {
+      auto records = std::make_shared<RuleRecordTable>();
+      records->Swap(&request);
+      request.Swap(records.get());
+    }
+    double swap_usec = elapsed_usec(start) / replays;
+
+    printf(
+      "hand off %d records: copy %.1f usec, swap %.1f usec\n",
+      table_.records_size(),
+      copy_usec,
+      swap_usec);
+  }
+
+  // Per record rule resolution on the sessions, without the session lookup
+  bool bench_rule_resolution(int replays)
+  {
+    std::vector<std::unique_ptr<SessionState>> sessions;
+    for (int i = 0; i < sessions_; i++) {
+      sessions.push_back(std::make_unique<SessionState>(
+        bench_imsi(i), "session", "", bench_cfg, *rule_store_));
+      for (int r = 0; r < rules_; r++) {
+        CreditUpdateResponse credit;
+        create_credit_update_response(
+          bench_imsi(i), r + 1, bench_grant, &credit);
+        sessions.back()->get_charging_pool().receive_credit(credit);
+      }
+    }
+
+    auto start = steady_clock::now();
+    for (int i = 0; i < replays; i++) {
+      int record_index = 0;
+      for (const auto &record : table_.records()) {
+        sessions[record_index++ / rules_]->add_used_credit(
+          record.rule_id(), record.bytes_tx(), record.bytes_rx());
+      }
+    }
+    double rule_id_nsec = elapsed_usec(start) * 1000 / replays /
+                          table_.records_size();
+
+    RuleIdInterner rule_ids;
+    start = steady_clock::now();
+    for (int i = 0; i < replays; i++) {
+      int record_index = 0;
+      for (const auto &record : table_.records()) {
+        sessions[record_index++ / rules_]->add_used_credit(
+          record.rule_id(),
+          rule_ids.intern(record.rule_id()),
+          rule_ids.get_generation(),
+          record.bytes_tx(),
+          record.bytes_rx());
+      }
+    }
+    double interned_nsec = elapsed_usec(start) * 1000 / replays /
+                           table_.records_size();
+
+    printf(
+      "rule resolution: by rule id %.1f nsec/record, interned %.1f "
+      "nsec/record\n",
+      rule_id_nsec,
+      interned_nsec);
+    return check_used_tx(
+      "add_used_credit",
+      sessions.back()->get_charging_pool().get_credit(rules_, USED_TX),
+      2 * replays);
+  }
+
+  // The whole ingestion of a table, session lookup included
+  bool bench_aggregate_records(int replays)
+  {
+    LocalEnforcer local_enforcer(
+      std::make_shared<NiceMock<MockSessionCloudReporter>>(),
+      rule_store_,
+      std::make_shared<NiceMock<MockPipelinedClient>>(),
+      std::make_shared<NiceMock<MockSpgwServiceClient>>(),
+      std::make_shared<NiceMock<MockAAAClient>>(),
+      0);
+    local_enforcer.attachEventBase(
+      folly::EventBaseManager::get()->getEventBase());
+    for (int i = 0; i < sessions_; i++) {
+      CreateSessionResponse response;
+      for (int r = 0; r < rules_; r++) {
+        create_credit_update_response(
+          bench_imsi(i), r + 1, bench_grant, response.mutable_credits()->Add());
+      }
+      local_enforcer.init_session_credit(
+        bench_imsi(i), "session" + std::to_string(i), bench_cfg, response);
+    }
+
+    auto start = steady_clock::now();
+    for (int i = 0; i < replays; i++) {
+      local_enforcer.aggregate_records(table_);
+    }
+    double usec = elapsed_usec(start) / replays;
+
+    printf(
+      "aggregate_records: %.1f msec/table, %.0f records/sec\n",
+      usec / 1000,
+      table_.records_size() / usec * 1e6);
+    folly::EventBaseManager::get()->clearEventBase();
+    return check_used_tx(
+      "aggregate_records",
+      local_enforcer.get_charging_credit(
+        bench_imsi(sessions_ - 1), rules_, USED_TX),
+      replays);
+  }
+
+ private:
+  bool check_used_tx(const char *name, uint64_t used_tx, int replays)
+  {
+    if (used_tx != replays * bench_used_tx) {
+      printf(
+        "%s: used tx %lu, expected %lu\n",
+        name,
+        (unsigned long) used_tx,
+        (unsigned long) (replays * bench_used_tx));
+      return false;
+    }
+    return true;
+  }
+
+  int sessions_;
+  int rules_;
+  std::shared_ptr<StaticRuleStore> rule_store_;
+  RuleRecordTable table_;
+};
+
+} // namespace magma
+
+int main(int argc, char **argv)
+{
+  int sessions = argc > 1 ? std::atoi(argv[1]) : 10000;
+  int rules = argc > 2 ? std::atoi(argv[2]) : 10;
+  int replays = argc > 3 ? std::atoi(argv[3]) : 10;
+  bool ok = true;
+
+  if (sessions < 1 || rules < 1 || replays < 1) {
+    fprintf(
+      stderr, "rule_stats_bench [sessions] [rules per session] [replays]\n");
+    return EXIT_FAILURE;
+  }
+  magma::RuleStatsBench bench(sessions, rules);
+  bench.bench_hand_off(replays);
+  ok &= bench.bench_rule_resolution(replays);
+  ok &= bench.bench_aggregate_records(replays);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+// Measures sessiond restart-to-ready with persisted sessions: the time to
+// store N sessions through SessionStore, and the time LocalEnforcer takes to
+// restore them before serving requests, for 10k and 50k sessions by default.
+// It runs against the local redis server of the gateway and clears the
+// sessiond:sessions hash, so it must not run next to a live sessiond.
+//    session_restore_bench [sessions...]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cpp_redis/cpp_redis>
+#include <folly/io/async/EventBaseManager.h>
+#include <gmock/gmock.h>
+
+#include "LocalEnforcer.h"
+#include "PolicyLoader.h"
+#include "ProtobufCreators.h"
+#include "SessionState.h"
+#include "SessionStore.h"
+#include "SessiondMocks.h"
+
+using ::testing::NiceMock;
+using std::chrono::steady_clock;
+
+namespace magma {
+
+const SessionState::Config bench_cfg = {.ue_ipv4 = "127.0.0.1",
+                                        .spgw_ipv4 = "128.0.0.1"};
+const std::string SESSIONS_HASH = "sessiond:sessions";
+const int CHARGING_KEYS = 4;
+const uint64_t GRANT = 1ULL << 30;
+
+static double elapsed_msec(steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(
+           steady_clock::now() - start)
+    .count();
+}
+
+static std::string bench_imsi(int i)
+{
+  char imsi[32];
+  snprintf(imsi, sizeof(imsi), "IMSI00101%010d", i);
+  return imsi;
+}
+
+static bool clear_sessions(cpp_redis::client &client)
+{
+  auto del_future = client.del({SESSIONS_HASH});
+  client.sync_commit();
+  return !del_future.get().is_error();
+}
+
+// Store sessions the way a running sessiond does, returns the time until
+// every write is applied
+static double store_sessions(int sessions, StaticRuleStore &rule_store)
+{
+  auto session_store = std::make_shared<SessionStore>();
+  auto start = steady_clock::now();
+  std::thread writer([&]() { session_store->start_loop(); });
+  for (int i = 0; i < sessions; i++) {
+    SessionState session(
+      bench_imsi(i), "session" + std::to_string(i), "", bench_cfg, rule_store);
+    for (int key = 1; key <= CHARGING_KEYS; key++) {
+      CreditUpdateResponse credit;
+      create_credit_update_response(bench_imsi(i), key, GRANT, &credit);
+      session.get_charging_pool().receive_credit(credit);
+    }
+    session_store->write_session(bench_imsi(i), session.marshal());
+  }
+  // stop returns the loop once the queued writes are applied
+  session_store->stop();
+  writer.join();
+  return elapsed_msec(start);
+}
+
+static bool bench_restore(int sessions, cpp_redis::client &client)
+{
+  auto rule_store = std::make_shared<StaticRuleStore>();
+  if (!clear_sessions(client)) {
+    printf("failed to clear %s\n", SESSIONS_HASH.c_str());
+    return false;
+  }
+  double store_msec = store_sessions(sessions, *rule_store);
+
+  LocalEnforcer local_enforcer(
+    std::make_shared<NiceMock<MockSessionCloudReporter>>(),
+    rule_store,
+    std::make_shared<NiceMock<MockPipelinedClient>>(),
+    std::make_shared<NiceMock<MockSpgwServiceClient>>(),
+    std::make_shared<NiceMock<MockAAAClient>>(),
+    0);
+  local_enforcer.attachEventBase(
+    folly::EventBaseManager::get()->getEventBase());
+  local_enforcer.attach_session_store(std::make_shared<SessionStore>(), 1000);
+
+  auto start = steady_clock::now();
+  bool restored = local_enforcer.restore_sessions();
+  double restore_msec = elapsed_msec(start);
+
+  printf(
+    "%6d sessions: stored in %.0f msec, restored in %.0f msec\n",
+    sessions,
+    store_msec,
+    restore_msec);
+  folly::EventBaseManager::get()->clearEventBase();
+  clear_sessions(client);
+  if (!restored) {
+    printf("restore_sessions failed\n");
+    return false;
+  }
+  // The last session written must come back with its credit
+  auto allowed = local_enforcer.get_charging_credit(
+    bench_imsi(sessions - 1), CHARGING_KEYS, ALLOWED_TOTAL);
+  if (allowed != GRANT) {
+    printf(
+      "restored session has %lu allowed bytes, expected %lu\n",
+      (unsigned long) allowed,
+      (unsigned long) GRANT);
+    return false;
+  }
+  return true;
+}
+
+} // namespace magma
+
+int main(int argc, char **argv)
+{
+  std::vector<int> session_counts;
+  for (int i = 1; i < argc; i++) {
+    session_counts.push_back(std::atoi(argv[i]));
+  }
+  if (session_counts.empty()) {
+    session_counts = {10000, 50000};
+  }
+
+  cpp_redis::client client;
+  if (!magma::try_redis_connect(client)) {
+    fprintf(stderr, "session_restore_bench needs the gateway redis server\n");
+    return EXIT_FAILURE;
+  }
+  bool ok = true;
+  for (int sessions : session_counts) {
+    if (sessions < 1) {
+      fprintf(stderr, "session_restore_bench [sessions...]\n");
+      return EXIT_FAILURE;
+    }
+    ok &= magma::bench_restore(sessions, client);
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
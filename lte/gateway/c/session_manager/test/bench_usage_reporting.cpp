@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+// Measures a usage reporting cycle against the number of sessions, with a
+// fixed fraction of them crossing their reporting threshold: the time to
+// aggregate the rule records of the active sessions and the time
+// collect_updates takes to build the update request.
+//    usage_reporting_bench [max sessions] [active percent]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include <folly/io/async/EventBaseManager.h>
+#include <gmock/gmock.h>
+
+#include "LocalEnforcer.h"
+#include "ProtobufCreators.h"
+#include "SessiondMocks.h"
+
+using ::testing::NiceMock;
+using std::chrono::steady_clock;
+
+namespace magma {
+
+const SessionState::Config bench_cfg = {.ue_ipv4 = "127.0.0.1",
+                                        .spgw_ipv4 = "128.0.0.1"};
+
+static double elapsed_usec(steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::micro>(
+           steady_clock::now() - start)
+    .count();
+}
+
+// Run one reporting cycle over sessions, returns false if the update request
+// does not hold exactly the active sessions
+static bool bench_cycle(int sessions, int active)
+{
+  auto rule_store = std::make_shared<StaticRuleStore>();
+  LocalEnforcer local_enforcer(
+    std::make_shared<NiceMock<MockSessionCloudReporter>>(),
+    rule_store,
+    std::make_shared<NiceMock<MockPipelinedClient>>(),
+    std::make_shared<NiceMock<MockSpgwServiceClient>>(),
+    std::make_shared<NiceMock<MockAAAClient>>(),
+    0);
+  local_enforcer.attachEventBase(
+    folly::EventBaseManager::get()->getEventBase());
+
+  PolicyRule rule;
+  rule.set_id("rule1");
+  rule.set_rating_group(1);
+  rule.set_tracking_type(PolicyRule::ONLY_OCS);
+  rule_store->insert_rule(rule);
+
+  for (int i = 0; i < sessions; i++) {
+    std::string imsi = "IMSI" + std::to_string(i);
+    CreateSessionResponse response;
+    create_credit_update_response(
+      imsi, 1, 3072, response.mutable_credits()->Add());
+    local_enforcer.init_session_credit(
+      imsi, "session" + std::to_string(i), bench_cfg, response);
+  }
+
+  // The active sessions are spread over the session map
+  RuleRecordTable table;
+  int stride = sessions / active;
+  for (int i = 0; i < active; i++) {
+    create_rule_record(
+      "IMSI" + std::to_string(i * stride),
+      "rule1",
+      1024,
+      2048,
+      table.mutable_records()->Add());
+  }
+
+  auto start = steady_clock::now();
+  local_enforcer.aggregate_records(table);
+  double aggregate_usec = elapsed_usec(start);
+
+  start = steady_clock::now();
+  auto request = local_enforcer.collect_updates();
+  double collect_usec = elapsed_usec(start);
+
+  printf(
+    "%7d sessions, %5d active: aggregate_records %9.1f usec, "
+    "collect_updates %9.1f usec\n",
+    sessions,
+    active,
+    aggregate_usec,
+    collect_usec);
+  folly::EventBaseManager::get()->clearEventBase();
+  if (request.updates_size() != active) {
+    printf(
+      "collect_updates returned %d updates, expected %d\n",
+      request.updates_size(),
+      active);
+    return false;
+  }
+  return true;
+}
+
+} // namespace magma
+
+int main(int argc, char **argv)
+{
+  int max_sessions = argc > 1 ? std::atoi(argv[1]) : 100000;
+  double active_percent = argc > 2 ? std::atof(argv[2]) : 1.0;
+  bool ok = true;
+
+  if (max_sessions < 1 || active_percent <= 0 || active_percent > 100) {
+    fprintf(stderr, "usage_reporting_bench [max sessions] [active percent]\n");
+    return EXIT_FAILURE;
+  }
+  for (int sessions = 1000; sessions <= max_sessions; sessions *= 10) {
+    int active = std::max(1, (int) (sessions * active_percent / 100));
+    ok &= magma::bench_cycle(sessions, active);
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
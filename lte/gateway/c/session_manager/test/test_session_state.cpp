@@ -165,6 +165,109 @@ TEST_F(SessionStateTest, test_add_used_credit)
   EXPECT_EQ(update.usage_monitors_size(), 2);
 }
 
+TEST_F(SessionStateTest, test_add_used_credit_interned)
+{
+  RuleIdInterner rule_ids;
+  insert_rule(1, "m1", "rule1", true);
+
+  receive_credit_from_ocs(1, 3000);
+  receive_credit_from_ocs(2, 6000);
+  receive_credit_from_pcrf("m1", 3000, MonitoringLevel::PCC_RULE_LEVEL);
+
+  auto index = rule_ids.intern("rule1");
+  EXPECT_EQ(rule_ids.intern("rule1"), index);
+  session_state->add_used_credit(
+    "rule1", index, rule_ids.get_generation(), 1000, 500);
+  EXPECT_EQ(session_state->get_charging_pool().get_credit(1, USED_TX), 1000);
+  EXPECT_EQ(session_state->get_monitor_pool().get_credit("m1", USED_RX), 500);
+
+  // a dynamic rule of the same id takes precedence once installed
+  insert_rule(2, "", "rule1", false);
+  session_state->add_used_credit(
+    "rule1", index, rule_ids.get_generation(), 1000, 500);
+  EXPECT_EQ(session_state->get_charging_pool().get_credit(1, USED_TX), 1000);
+  EXPECT_EQ(session_state->get_charging_pool().get_credit(2, USED_TX), 1000);
+
+  // unknown rules are not tracked
+  auto unknown_index = rule_ids.intern("rule2");
+  EXPECT_NE(unknown_index, index);
+  session_state->add_used_credit(
+    "rule2", unknown_index, rule_ids.get_generation(), 1000, 500);
+  EXPECT_EQ(session_state->get_charging_pool().get_credit(2, USED_TX), 1000);
+}
+
+TEST_F(SessionStateTest, test_pending_updates)
+{
+  insert_rule(1, "m1", "rule1", true);
+
+  receive_credit_from_ocs(1, 3000);
+  receive_credit_from_pcrf("m1", 3000, MonitoringLevel::PCC_RULE_LEVEL);
+  EXPECT_FALSE(session_state->has_pending_updates());
+
+  // usage below the quota threshold has nothing to report
+  session_state->add_used_credit("rule1", 100, 100);
+  EXPECT_FALSE(session_state->has_pending_updates());
+
+  session_state->add_used_credit("rule1", 2000, 500);
+  EXPECT_TRUE(session_state->has_pending_updates());
+
+  UpdateSessionRequest update;
+  std::vector<std::unique_ptr<ServiceAction>> actions;
+  session_state->get_updates(update, &actions);
+  EXPECT_EQ(update.updates_size(), 1);
+  EXPECT_EQ(update.usage_monitors_size(), 1);
+  // credits are now reporting until the response comes back
+  EXPECT_FALSE(session_state->has_pending_updates());
+
+  session_state->get_charging_pool().reauth_all();
+  EXPECT_FALSE(session_state->has_pending_updates());
+  session_state->get_charging_pool().reset_reporting_credit(1);
+  EXPECT_TRUE(session_state->has_pending_updates());
+}
+
+TEST_F(SessionStateTest, test_marshal_unmarshal)
+{
+  insert_rule(1, "m1", "rule1", true);
+  insert_rule(2, "m2", "dyn_rule1", false);
+  session_state->activate_static_rule("rule1");
+
+  receive_credit_from_ocs(1, 3000);
+  receive_credit_from_pcrf("m2", 6000, MonitoringLevel::SESSION_LEVEL);
+  CreditUpdateResponse timed_resp;
+  create_credit_update_response("IMSI1", 3, 1000, &timed_resp);
+  timed_resp.mutable_credit()->set_validity_time(60);
+  session_state->get_charging_pool().receive_credit(timed_resp);
+  session_state->add_used_credit("rule1", 2000, 500);
+  session_state->add_used_credit("dyn_rule1", 100, 100);
+  session_state->start_termination([](SessionTerminateRequest term_req) {});
+
+  auto marshaled = session_state->marshal();
+  auto restored = SessionState::unmarshal(marshaled, *rule_store);
+
+  EXPECT_EQ(restored->get_session_id(), "session");
+  EXPECT_EQ(restored->get_subscriber_ip_addr(), "127.0.0.1");
+  EXPECT_TRUE(restored->is_terminating());
+  EXPECT_EQ(restored->get_charging_pool().get_credit(1, ALLOWED_TOTAL), 3000);
+  EXPECT_EQ(restored->get_charging_pool().get_credit(1, USED_TX), 2000);
+  EXPECT_EQ(restored->get_charging_pool().get_credit(1, USED_RX), 500);
+  // the session level monitor tracks the usage of all rules
+  EXPECT_EQ(restored->get_monitor_pool().get_credit("m2", USED_TX), 2100);
+  EXPECT_EQ(*restored->get_monitor_pool().get_session_level_key(), "m2");
+  EXPECT_EQ(
+    restored->has_pending_updates(), session_state->has_pending_updates());
+  // only the credit with a validity time has a timer to restore
+  auto expiry_times = restored->get_charging_pool().get_expiry_times();
+  EXPECT_EQ(expiry_times.size(), 1);
+  EXPECT_EQ(
+    expiry_times, session_state->get_charging_pool().get_expiry_times());
+
+  // restored rules keep tracking usage
+  restored->add_used_credit("rule1", 500, 0);
+  restored->add_used_credit("dyn_rule1", 100, 0);
+  EXPECT_EQ(restored->get_charging_pool().get_credit(1, USED_TX), 2500);
+  EXPECT_EQ(restored->get_monitor_pool().get_credit("m2", USED_TX), 2700);
+}
+
 TEST_F(SessionStateTest, test_mixed_tracking_rules)
 {
   insert_rule(0, "m1", "dyn_rule1", false);
@@ -300,6 +403,36 @@ TEST_F(SessionStateTest, test_reauth_all)
   EXPECT_EQ(reauth_res, ChargingReAuthAnswer::UPDATE_NOT_NEEDED);
 }
 
+TEST_F(SessionStateTest, test_rule_store_apply_updates)
+{
+  insert_rule(1, "", "rule1", true);
+  insert_rule(2, "m1", "rule2", true);
+  auto version = rule_store->get_version();
+
+  // rule1 moves to another rating group and rule2 is removed
+  PolicyRule changed;
+  changed.set_id("rule1");
+  changed.set_rating_group(3);
+  changed.set_tracking_type(PolicyRule::ONLY_OCS);
+  rule_store->apply_updates({changed}, {"rule2"});
+  EXPECT_EQ(rule_store->get_version(), version + 1);
+
+  std::vector<std::string> rule_ids;
+  EXPECT_TRUE(rule_store->get_rule_ids_for_charging_key(3, rule_ids));
+  EXPECT_EQ(rule_ids, std::vector<std::string>({"rule1"}));
+  rule_ids.clear();
+  rule_store->get_rule_ids_for_charging_key(1, rule_ids);
+  EXPECT_TRUE(rule_ids.empty());
+  rule_store->get_rule_ids_for_monitoring_key("m1", rule_ids);
+  EXPECT_TRUE(rule_ids.empty());
+  PolicyRule rule_out;
+  EXPECT_FALSE(rule_store->get_rule("rule2", &rule_out));
+
+  // Empty updates don't invalidate cached lookups
+  rule_store->apply_updates({}, {});
+  EXPECT_EQ(rule_store->get_version(), version + 1);
+}
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -23,6 +23,7 @@ class PolicyRuleDict(RedisHashDict):
     """
     _DICT_HASH = "policydb:rules"
     _NOTIFY_CHANNEL = "policydb:rules:stream_update"
+    _CHANGES_CHANNEL = "policydb:rules:changes"
 
     def __init__(self):
         client = get_default_client()
@@ -39,6 +40,13 @@ class PolicyRuleDict(RedisHashDict):
         """
         self.redis.publish(self._NOTIFY_CHANNEL, "Stream Update")
 
+    def send_rule_change_notification(self, rule_id):
+        """
+        Publish the id of a rule that was set or deleted, so that subscribers
+        like sessiond only need to reload that rule
+        """
+        self.redis.publish(self._CHANGES_CHANNEL, rule_id)
+
     def __missing__(self, key):
         """Instead of throwing a key error, return None when key not found"""
         return None
@@ -45,7 +45,12 @@ class PolicyDBStreamerCallback(StreamerClient.Callback):
             pass
 
     def _store_policy_rule(self, policy):
+        # A resync sends every rule, so skip the unchanged ones to avoid
+        # waking up the subscribers for nothing
+        if self._policy_dict[policy.id] == policy:
+            return
         self._policy_dict[policy.id] = policy
+        self._policy_dict.send_rule_change_notification(policy.id)
 
     def _remove_old_policies(self, id_set):
         """
@@ -55,3 +60,4 @@ class PolicyDBStreamerCallback(StreamerClient.Callback):
         missing_rules = set(self._policy_dict.keys()) - id_set
         for rule in missing_rules:
             del self._policy_dict[rule]
+            self._policy_dict.send_rule_change_notification(rule)
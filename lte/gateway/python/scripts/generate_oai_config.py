@@ -133,6 +133,10 @@ def _get_context():
     context["csfb_mnc"] = _get_csfb_mnc()
     context["lac"] = _get_lac()
     context["use_stateless"] = get_service_config_value("mme", "use_stateless", "")
+    context["use_stateless_per_ue"] = get_service_config_value(
+        "mme", "use_stateless_per_ue", "")
+    context["state_write_behind_window_ms"] = get_service_config_value(
+        "mme", "state_write_behind_window_ms", 0)
     context["attached_enodeb_tacs"] = _get_attached_enodeb_tacs()
     # set ovs params
     for key in (
@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+
+"""
+Copyright (c) 2016-present, Facebook, Inc.
+All rights reserved.
+
+This source code is licensed under the BSD-style license found in the
+LICENSE file in the root directory of this source tree. An additional grant
+of patent rights can be found in the PATENTS file in the same directory.
+"""
+
+import argparse
+import re
+import struct
+import sys
+import time
+
+# Layout of the dump written by lte/gateway/c/oai/common/binary_log.c
+DUMP_MAGIC = b'OAIBLOG1'
+DUMP_STRING = 1
+DUMP_RECORD = 2
+STRING_HEADER = struct.Struct('<QI')
+RECORD_HEADER = struct.Struct('<IIBBHIQQQQ')
+SLOT = struct.Struct('<Q')
+
+# log_level_t and log_proto_t of common/log.h
+LEVELS = ['EMERGENCY', 'ALERT', 'CRITICAL', 'ERROR', 'WARNING', 'NOTICE',
+          'INFO', 'DEBUG', 'TRACE']
+PROTOS = ['UDP', 'GTPv1-U', 'GTPv2-C', 'SCTP', 'S1AP', 'MME-APP', 'NAS',
+          'NAS-EMM', 'NAS-ESM', 'SPGW-APP', 'PGW-APP', 'S11', 'S6A', 'SECU',
+          'UTIL', 'CONFIG', 'MSC', 'ITTI', 'SGS', 'CMD']
+REPO_ROOT = '/oai/'
+
+CONVERSION = re.compile(
+    r"%([-+ #0']*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|q|j|z|t|L)?"
+    r"([diouxXcfFeEgGaAsp%])")
+
+
+def _signed(value):
+    return value - (1 << 64) if value >= (1 << 63) else value
+
+
+def _format_message(fmt, args):
+    """
+    Format the arguments of a record like printf, args being the raw bytes
+    following the record header
+    """
+    offset = 0
+
+    def next_slot():
+        nonlocal offset
+        value, = SLOT.unpack_from(args, offset)
+        offset += SLOT.size
+        return value
+
+    def next_string():
+        nonlocal offset
+        length, = struct.unpack_from('<I', args, offset)
+        value = args[offset + 4:offset + 4 + length]
+        offset += (4 + length + 1 + 7) & ~7
+        return value.decode('utf-8', 'replace')
+
+    def convert(match):
+        flags, width, precision, _, conversion = match.groups()
+        if conversion == '%':
+            return '%'
+        flags = flags.replace("'", '')
+        if width == '*':
+            width = _signed(next_slot())
+            if width < 0:
+                flags += '-'
+                width = -width
+        if precision == '*':
+            precision = _signed(next_slot())
+            precision = None if precision < 0 else precision
+        spec = '%' + flags
+        if width is not None:
+            spec += str(width)
+        if precision is not None:
+            spec += '.' + str(precision or 0)
+        if conversion == 's':
+            return (spec + 's') % next_string()
+        value = next_slot()
+        if conversion in 'di':
+            return (spec + 'd') % _signed(value)
+        if conversion in 'ouxX':
+            return (spec + conversion) % value
+        if conversion == 'c':
+            return (spec + 'c') % chr(value & 0xff)
+        if conversion == 'p':
+            return (spec + 's') % hex(value)
+        number, = struct.unpack('<d', SLOT.pack(value))
+        if conversion in 'aA':
+            return number.hex()
+        return (spec + conversion) % number
+
+    try:
+        return CONVERSION.sub(convert, fmt)
+    except struct.error:
+        return fmt
+
+
+def _short_file_name(file_name):
+    pos = file_name.find(REPO_ROOT)
+    return file_name if pos < 0 else file_name[pos + len(REPO_ROOT):]
+
+
+def _read_entries(dump):
+    if dump.read(len(DUMP_MAGIC)) != DUMP_MAGIC:
+        raise ValueError('Not an OAI binary log dump')
+    strings = {}
+    while True:
+        entry_type = dump.read(1)
+        if not entry_type:
+            return
+        if entry_type[0] == DUMP_STRING:
+            string_id, length = STRING_HEADER.unpack(
+                dump.read(STRING_HEADER.size))
+            strings[string_id] = dump.read(length).decode('utf-8', 'replace')
+        elif entry_type[0] == DUMP_RECORD:
+            header = dump.read(RECORD_HEADER.size)
+            if len(header) < RECORD_HEADER.size:
+                return
+            fields = RECORD_HEADER.unpack(header)
+            args = dump.read(fields[0] - RECORD_HEADER.size)
+            yield fields, args, strings
+        else:
+            raise ValueError('Corrupted OAI binary log dump')
+
+
+def decode(dump, out):
+    """
+    Print the records of a dump with the layout of the formatted log lines
+    """
+    message_number = 0
+    for fields, args, strings in _read_entries(dump):
+        (_, line, level, proto, indent, dropped, timestamp_ns, tid,
+         format_id, file_id) = fields
+        seconds = timestamp_ns // 1000000000
+        if dropped:
+            out.write('%06d %s %08X %-5.5s %-6.6s %u log records dropped\n' % (
+                message_number, time.ctime(seconds), tid, 'WARNI', 'UTIL',
+                dropped))
+            message_number += 1
+        level_name = LEVELS[level] if level < len(LEVELS) else str(level)
+        proto_name = PROTOS[proto] if proto < len(PROTOS) else str(proto)
+        out.write('%06d %s %08X %-5.5s %-6.6s %-32.32s:%04u   %*s%s' % (
+            message_number, time.ctime(seconds), tid, level_name, proto_name,
+            _short_file_name(strings.get(file_id, '?')), line, indent, ' ',
+            _format_message(strings.get(format_id, ''), args)))
+        message_number += 1
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Decode a binary log dump of the MME, see BINARY_DUMP in '
+                    'the LOGGING section of mme.conf')
+    parser.add_argument('dump', help='Path of the binary log dump')
+    args = parser.parse_args()
+    with open(args.dump, 'rb') as dump:
+        decode(dump, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -54,6 +54,7 @@ setup(
         'scripts/generate_oai_config.py',
         'scripts/hello_cli.py',
         'scripts/mobility_cli.py',
+        'scripts/oai_log_decoder.py',
         'scripts/ocs_cli.py',
         'scripts/packet_ryu_cli.py',
         'scripts/pcrf_cli.py',
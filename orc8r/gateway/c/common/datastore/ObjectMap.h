@@ -8,6 +8,9 @@
  */
 #pragma once
 
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include <cpp_redis/cpp_redis>
 
 namespace magma {
@@ -36,6 +39,21 @@ class ObjectMap {
     ObjectType& object_out) = 0;
 
   virtual ObjectMapResult getall(std::vector<ObjectType>& values_out) = 0;
+
+  virtual ObjectMapResult remove(const std::string& key) = 0;
+
+  /**
+   * Batched versions of get, set and remove, which handle all the keys in a
+   * single round trip. Keys that are not found are left out of values_out
+   */
+  virtual ObjectMapResult multi_get(
+    const std::vector<std::string>& keys,
+    std::unordered_map<std::string, ObjectType>& values_out) = 0;
+
+  virtual ObjectMapResult multi_set(
+    const std::unordered_map<std::string, ObjectType>& objects) = 0;
+
+  virtual ObjectMapResult multi_delete(const std::vector<std::string>& keys) = 0;
 };
 
 }
@@ -35,28 +35,18 @@ public:
 
   /**
    * set serializes the object passed into a string and stores it at the key.
+   * The version of the value is incremented on the redis server, so the write
+   * takes a single round trip and can't race with other writers.
    * Returns false if the operation was unsuccessful
    */
   ObjectMapResult set(
       const std::string& key,
       const ObjectType& object) override {
-    uint64_t version;
-    auto res = this->get_version(key, version);
-    if (res != SUCCESS) {
-      MLOG(MERROR) << "Unable to get version for key successfully " << key;
-      return res;
-    }
     std::string value;
-    auto new_version = version + (uint64_t) 1u;
-    if (!serializer_(object, value, new_version)) {
-      MLOG(MERROR) << "Unable to serialize value for key " << key;
+    if (!serialize_unversioned(key, object, value)) {
       return SERIALIZE_FAIL;
     }
-    auto hset_future = client_->hset(hash_, key, value);
-    client_->sync_commit();
-    bool is_error = hset_future.get().is_error();
-    if (is_error) {
-      MLOG(MERROR) << "Error setting value in redis for key " << key;
+    if (!commit_versioned_sets({{key, value}}).empty()) {
       return CLIENT_ERROR;
     }
     return SUCCESS;
@@ -137,55 +127,290 @@ public:
     return SUCCESS;
   }
 
-private:
-  /*
-   * Return the version of the value for key *key*. Returns 0 if
-   * key is not in the map
+  /**
+   * remove deletes the object located at key. Removing a key that is not in
+   * the map is not an error
    */
-  ObjectMapResult get_version(const std::string& key, uint64_t& version) {
-    auto redis_state = RedisState();
-    auto res = this->get_redis_state(key, redis_state);
-    if (res == KEY_NOT_FOUND) {
-      version = (uint64_t) 0u;
-      return SUCCESS;
-    } else if (res != SUCCESS) {
-      return res;
+  ObjectMapResult remove(const std::string& key) override {
+    auto hdel_future = client_->hdel(hash_, {key});
+    client_->sync_commit();
+    if (hdel_future.get().is_error()) {
+      MLOG(MERROR) << "Error removing value in redis for key " << key;
+      return CLIENT_ERROR;
     }
-    version = redis_state.version();
-    return res;
+    return SUCCESS;
   }
 
   /**
-   * Gets the RedisState result that stores the actual value we want
+   * multi_get fetches the objects at all the given keys with a single HMGET.
+   * Keys that are not found are left out of values_out
    */
-  ObjectMapResult get_redis_state(
-      const std::string& key,
-      RedisState& redis_state) {
-    auto hget_future = client_->hget(hash_, key);
+  ObjectMapResult multi_get(
+      const std::vector<std::string>& keys,
+      std::unordered_map<std::string, ObjectType>& values_out) override {
+    return multi_get(keys, values_out, nullptr);
+  }
+
+  /**
+   * multi_get is overloaded to also return the keys of values that failed to
+   * be deserialized
+   */
+  ObjectMapResult multi_get(
+      const std::vector<std::string>& keys,
+      std::unordered_map<std::string, ObjectType>& values_out,
+      std::vector<std::string>* failed_keys) {
+    if (keys.empty()) {
+      return SUCCESS;
+    }
+    auto hmget_future = client_->hmget(hash_, keys);
     client_->sync_commit();
-    auto reply = hget_future.get();
-    if (reply.is_null()) {
-      // value just doesn't exist
-      return KEY_NOT_FOUND;
-    } else if (reply.is_error()) {
-      MLOG(MERROR) << "Unable to get value for key " << key;
+    auto reply = hmget_future.get();
+    if (reply.is_error() || !reply.is_array() ||
+        reply.as_array().size() != keys.size()) {
+      MLOG(MERROR) << "Unable to get values for " << keys.size() << " keys";
       return CLIENT_ERROR;
-    } else if (!reply.is_string()) {
-      MLOG(MERROR) << "Value was not string for key " << key;
-      return INCORRECT_VALUE_TYPE;
     }
-    if (!redis_state.ParseFromString(reply.as_string())) {
-      MLOG(MERROR) << "Failed to deserialize key " << key
-                   << " with value " << reply.as_string();
-      return DESERIALIZE_FAIL;
+    const auto& array = reply.as_array();
+    for (size_t i = 0; i < keys.size(); i++) {
+      if (array[i].is_null()) {
+        continue;
+      }
+      ObjectType obj;
+      if (!array[i].is_string() ||
+          !deserializer_(array[i].as_string(), obj)) {
+        MLOG(MERROR) << "Unable to deserialize value for key " << keys[i];
+        if (failed_keys != nullptr) failed_keys->push_back(keys[i]);
+        continue;
+      }
+      values_out[keys[i]] = std::move(obj);
+    }
+    return SUCCESS;
+  }
+
+  /**
+   * multi_set stores all the objects like set, pipelining the writes so that
+   * they are sent in a single commit
+   */
+  ObjectMapResult multi_set(
+      const std::unordered_map<std::string, ObjectType>& objects) override {
+    return multi_set(objects, nullptr);
+  }
+
+  /**
+   * multi_set is overloaded to also return the keys that failed to be set.
+   * The other keys are still written if some fail
+   */
+  ObjectMapResult multi_set(
+      const std::unordered_map<std::string, ObjectType>& objects,
+      std::vector<std::string>* failed_keys) {
+    auto result = SUCCESS;
+    std::vector<std::pair<std::string, std::string>> values;
+    values.reserve(objects.size());
+    for (const auto& entry : objects) {
+      std::string value;
+      if (!serialize_unversioned(entry.first, entry.second, value)) {
+        if (failed_keys != nullptr) failed_keys->push_back(entry.first);
+        result = SERIALIZE_FAIL;
+        continue;
+      }
+      values.emplace_back(entry.first, std::move(value));
+    }
+    if (values.empty()) {
+      return result;
+    }
+    auto failed_sets = commit_versioned_sets(values);
+    if (!failed_sets.empty()) {
+      if (failed_keys != nullptr) {
+        failed_keys->insert(
+          failed_keys->end(), failed_sets.begin(), failed_sets.end());
+      }
+      result = CLIENT_ERROR;
+    }
+    return result;
+  }
+
+  /**
+   * multi_delete removes all the keys with a single HDEL. Removing keys that
+   * are not in the map is not an error
+   */
+  ObjectMapResult multi_delete(const std::vector<std::string>& keys) override {
+    if (keys.empty()) {
+      return SUCCESS;
+    }
+    auto hdel_future = client_->hdel(hash_, keys);
+    client_->sync_commit();
+    if (hdel_future.get().is_error()) {
+      MLOG(MERROR) << "Error removing " << keys.size() << " values in redis";
+      return CLIENT_ERROR;
     }
     return SUCCESS;
   }
 
+private:
+  /**
+   * Serialize the object with version 0, which leaves the version field out
+   * of the RedisState, so that the versioned set script can append it
+   */
+  bool serialize_unversioned(
+      const std::string& key,
+      const ObjectType& object,
+      std::string& value_out) {
+    uint64_t version = 0;
+    if (!serializer_(object, value_out, version)) {
+      MLOG(MERROR) << "Unable to serialize value for key " << key;
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Queue a versioned set for each (key, unversioned value) pair and commit
+   * them together. Sets that fail with NOSCRIPT, because redis restarted or
+   * its script cache was flushed, are retried once after reloading the
+   * script. Returns the keys that could not be set
+   */
+  std::vector<std::string> commit_versioned_sets(
+      const std::vector<std::pair<std::string, std::string>>& values) {
+    std::vector<std::string> failed_keys;
+    std::vector<size_t> pending(values.size());
+    for (size_t i = 0; i < values.size(); i++) {
+      pending[i] = i;
+    }
+    for (int attempt = 0; attempt < 2 && !pending.empty(); attempt++) {
+      if (!load_versioned_set_script()) {
+        break;
+      }
+      std::vector<std::future<cpp_redis::reply>> set_futures;
+      set_futures.reserve(pending.size());
+      for (auto i : pending) {
+        set_futures.push_back(versioned_set(values[i].first, values[i].second));
+      }
+      client_->sync_commit();
+      std::vector<size_t> noscript;
+      for (size_t j = 0; j < pending.size(); j++) {
+        auto reply = set_futures[j].get();
+        if (!reply.is_error()) {
+          continue;
+        }
+        if (reply.error().compare(0, 8, "NOSCRIPT") == 0) {
+          noscript.push_back(pending[j]);
+          continue;
+        }
+        MLOG(MERROR) << "Error setting value in redis for key "
+                     << values[pending[j]].first << ": " << reply.error();
+        failed_keys.push_back(values[pending[j]].first);
+      }
+      if (!noscript.empty()) {
+        MLOG(MINFO) << "Versioned set script not cached in redis, reloading";
+        script_sha_.clear();
+      }
+      pending = std::move(noscript);
+    }
+    for (auto i : pending) {
+      MLOG(MERROR) << "Error setting value in redis for key "
+                   << values[i].first;
+      failed_keys.push_back(values[i].first);
+    }
+    return failed_keys;
+  }
+
+  /**
+   * Load the versioned set script into the redis script cache with SCRIPT
+   * LOAD, if it isn't loaded yet, and keep its SHA1 for EVALSHA
+   */
+  bool load_versioned_set_script() {
+    if (!script_sha_.empty()) {
+      return true;
+    }
+    auto load_future = client_->script_load(versioned_set_script());
+    client_->sync_commit();
+    auto reply = load_future.get();
+    if (reply.is_error() || !reply.is_string()) {
+      MLOG(MERROR) << "Unable to load versioned set script in redis";
+      return false;
+    }
+    script_sha_ = reply.as_string();
+    return true;
+  }
+
+  /**
+   * Queue the versioned set script for the key with EVALSHA. The future
+   * resolves to the new version. Needs a commit to be sent
+   */
+  std::future<cpp_redis::reply> versioned_set(
+      const std::string& key,
+      const std::string& unversioned_value) {
+    return client_->evalsha(
+      script_sha_, 1, {hash_}, {key, unversioned_value});
+  }
+
+  /**
+   * The versioned set script reads the version of the current RedisState,
+   * and stores the new value with the version field (field 2, varint, tag
+   * 0x10) appended with the incremented version. It returns the new version
+   */
+  static const std::string& versioned_set_script() {
+    static const std::string script = R"lua(
+local function read_varint(s, pos)
+  local result, mult = 0, 1
+  while true do
+    local b = string.byte(s, pos)
+    if b == nil then return nil, pos end
+    result = result + (b % 128) * mult
+    pos = pos + 1
+    if b < 128 then return result, pos end
+    mult = mult * 128
+  end
+end
+local function write_varint(n)
+  local bytes = {}
+  repeat
+    local b = n % 128
+    n = (n - b) / 128
+    if n > 0 then b = b + 128 end
+    bytes[#bytes + 1] = string.char(b)
+  until n == 0
+  return table.concat(bytes)
+end
+local version = 0
+local old = redis.call('HGET', KEYS[1], ARGV[1])
+if old then
+  local pos = 1
+  while pos <= #old do
+    local tag, value
+    tag, pos = read_varint(old, pos)
+    if tag == nil then break end
+    local wire_type = tag % 8
+    if wire_type == 0 then
+      value, pos = read_varint(old, pos)
+      if value == nil then break end
+      if tag == 16 then version = value end
+    elseif wire_type == 2 then
+      value, pos = read_varint(old, pos)
+      if value == nil then break end
+      pos = pos + value
+    elseif wire_type == 1 then
+      pos = pos + 8
+    elseif wire_type == 5 then
+      pos = pos + 4
+    else
+      break
+    end
+  end
+end
+version = version + 1
+local value = ARGV[2] .. string.char(16) .. write_varint(version)
+redis.call('HSET', KEYS[1], ARGV[1], value)
+return version
+)lua";
+    return script;
+  }
+
   std::shared_ptr<cpp_redis::client> client_;
   std::string hash_;
   std::function<bool(const ObjectType&, std::string&, uint64_t&)> serializer_;
   std::function<bool(const std::string&, ObjectType&)> deserializer_;
+  std::string script_sha_;
 };
 
 }
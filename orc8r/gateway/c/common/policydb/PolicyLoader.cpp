@@ -6,14 +6,25 @@
  * LICENSE file in the root directory of this source tree. An additional grant
  * of patent rights can be found in the PATENTS file in the same directory.
  */
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 #include "RedisMap.hpp"
 #include "Serializers.h"
 #include "PolicyLoader.h"
 #include "ServiceConfigLoader.h"
+#include "MetricsSingleton.h"
 #include "magma_logging.h"
 
+using magma::service303::MetricsSingleton;
+
 namespace magma {
 
+const std::string POLICYDB_RULES_HASH = "policydb:rules";
+// Channel on which writers publish the id of every rule they set or delete
+const std::string POLICYDB_CHANGES_CHANNEL = "policydb:rules:changes";
+
 bool try_redis_connect(cpp_redis::client& client)
 {
   ServiceConfigLoader loader;
@@ -38,6 +49,42 @@ bool try_redis_connect(cpp_redis::client& client)
   }
 }
 
+bool try_redis_subscribe(
+  cpp_redis::subscriber& subscriber,
+  const std::string& channel,
+  std::function<void(const std::string&)> on_message,
+  std::function<void()> on_dropped)
+{
+  ServiceConfigLoader loader;
+  auto config = loader.load_service_config("redis");
+  auto port = config["port"].as<uint32_t>();
+  try {
+    subscriber.connect(
+      "127.0.0.1",
+      port,
+      [on_dropped](
+        const std::string& host,
+        std::size_t port,
+        cpp_redis::subscriber::connect_state status) {
+        if (status == cpp_redis::subscriber::connect_state::dropped) {
+          MLOG(MERROR) << "Subscriber disconnected from " << host << ":"
+                       << port;
+          on_dropped();
+        }
+      });
+    subscriber.subscribe(
+      channel,
+      [on_message](const std::string& chan, const std::string& msg) {
+        on_message(msg);
+      });
+    subscriber.commit();
+    return subscriber.is_connected();
+  } catch (const cpp_redis::redis_error& e) {
+    MLOG(MERROR) << "Could not subscribe to redis: " << e.what();
+    return false;
+  }
+}
+
 bool do_loop(
   cpp_redis::client& client,
   RedisMap<PolicyRule>& policy_map,
@@ -67,16 +114,242 @@ void PolicyLoader::start_loop(
   is_running_ = true;
   auto client = std::make_shared<cpp_redis::client>();
   auto policy_map = RedisMap<PolicyRule>(
-    client, "policydb:rules", get_proto_serializer(), get_proto_deserializer());
+    client,
+    POLICYDB_RULES_HASH,
+    get_proto_serializer(),
+    get_proto_deserializer());
   while (is_running_) {
     do_loop(*client, policy_map, processor);
     std::this_thread::sleep_for(std::chrono::seconds(loop_interval_seconds));
   }
 }
 
+static void report_sync(
+  const std::string& sync_type,
+  std::chrono::steady_clock::time_point start,
+  size_t rules_changed,
+  size_t rules_removed)
+{
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - start);
+  auto& metrics = MetricsSingleton::Instance();
+  std::map<std::string, std::string> labels = {{"sync_type", sync_type}};
+  metrics
+    .GetHistogram(
+      "policydb_sync_latency_ms", labels, {1.0, 10.0, 100.0, 1000.0, 10000.0})
+    .Observe(elapsed.count());
+  metrics.GetCounter("policydb_rules_changed", labels).Increment(rules_changed);
+  metrics.GetCounter("policydb_rules_removed", labels).Increment(rules_removed);
+  MLOG(MDEBUG) << "Rules synced (" << sync_type << "), " << rules_changed
+               << " changed and " << rules_removed << " removed in "
+               << elapsed.count() << " ms";
+}
+
+bool PolicyLoader::diff_rule(
+  const std::string& rule_id,
+  const std::string& value,
+  std::vector<PolicyRule>& changed_rules)
+{
+  RedisState state;
+  if (!state.ParseFromString(value)) {
+    MLOG(MERROR) << "Unable to deserialize value of rule " << rule_id;
+    return false;
+  }
+  // The version is bumped on every write, so only compare the rule itself
+  auto it = rule_values_.find(rule_id);
+  if (it != rule_values_.end() && it->second == state.serialized_msg()) {
+    return true;
+  }
+  PolicyRule rule;
+  if (!rule.ParseFromString(state.serialized_msg())) {
+    MLOG(MERROR) << "Unable to deserialize rule " << rule_id;
+    return false;
+  }
+  changed_rules.push_back(std::move(rule));
+  rule_values_[rule_id] = state.serialized_msg();
+  return true;
+}
+
+bool PolicyLoader::full_sync(
+  cpp_redis::client& client,
+  const RuleUpdateProcessor& processor)
+{
+  auto start = std::chrono::steady_clock::now();
+  auto hgetall_future = client.hgetall(POLICYDB_RULES_HASH);
+  client.sync_commit();
+  auto reply = hgetall_future.get();
+  if (reply.is_error()) {
+    MLOG(MERROR) << "Failed to get rules from redis: " << reply.error();
+    return false;
+  }
+
+  std::vector<PolicyRule> changed_rules;
+  std::unordered_set<std::string> rule_ids;
+  if (reply.is_array()) {
+    const auto& array = reply.as_array();
+    for (size_t i = 0; i + 1 < array.size(); i += 2) {
+      if (!array[i].is_string()) {
+        MLOG(MERROR) << "Non string rule id found in redis";
+        continue;
+      }
+      // The rule is still in redis even if its value can't be read, so keep
+      // the copy loaded before rather than reporting it as removed
+      const auto& rule_id = array[i].as_string();
+      rule_ids.insert(rule_id);
+      if (!array[i + 1].is_string()) {
+        MLOG(MERROR) << "Non string value found in redis for rule " << rule_id;
+        continue;
+      }
+      diff_rule(rule_id, array[i + 1].as_string(), changed_rules);
+    }
+  }
+
+  std::vector<std::string> removed_rule_ids;
+  for (auto it = rule_values_.begin(); it != rule_values_.end();) {
+    if (rule_ids.find(it->first) == rule_ids.end()) {
+      removed_rule_ids.push_back(it->first);
+      it = rule_values_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (!changed_rules.empty() || !removed_rule_ids.empty()) {
+    processor(changed_rules, removed_rule_ids);
+  }
+  report_sync("full", start, changed_rules.size(), removed_rule_ids.size());
+  return true;
+}
+
+bool PolicyLoader::incremental_sync(
+  cpp_redis::client& client,
+  const std::unordered_set<std::string>& rule_ids,
+  const RuleUpdateProcessor& processor)
+{
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::string> fields(rule_ids.begin(), rule_ids.end());
+  auto hmget_future = client.hmget(POLICYDB_RULES_HASH, fields);
+  client.sync_commit();
+  auto reply = hmget_future.get();
+  if (reply.is_error() || !reply.is_array() ||
+      reply.as_array().size() != fields.size()) {
+    MLOG(MERROR) << "Failed to get changed rules from redis";
+    return false;
+  }
+
+  std::vector<PolicyRule> changed_rules;
+  std::vector<std::string> removed_rule_ids;
+  const auto& array = reply.as_array();
+  for (size_t i = 0; i < fields.size(); i++) {
+    if (array[i].is_null()) {
+      if (rule_values_.erase(fields[i]) > 0) {
+        removed_rule_ids.push_back(fields[i]);
+      }
+    } else if (array[i].is_string()) {
+      diff_rule(fields[i], array[i].as_string(), changed_rules);
+    }
+  }
+  if (!changed_rules.empty() || !removed_rule_ids.empty()) {
+    processor(changed_rules, removed_rule_ids);
+  }
+  report_sync(
+    "incremental", start, changed_rules.size(), removed_rule_ids.size());
+  return true;
+}
+
+void PolicyLoader::start_incremental_loop(
+  RuleUpdateProcessor processor,
+  uint32_t loop_interval_seconds,
+  uint32_t full_sync_interval_seconds)
+{
+  is_running_ = true;
+  auto client = std::make_shared<cpp_redis::client>();
+  cpp_redis::subscriber subscriber;
+  auto interval = std::chrono::seconds(loop_interval_seconds);
+  auto full_sync_interval = std::chrono::seconds(full_sync_interval_seconds);
+  auto next_full_sync = std::chrono::steady_clock::now();
+  bool needs_full_sync = true;
+  bool is_subscribed = false;
+  {
+    std::lock_guard<std::mutex> lock(changes_mutex_);
+    subscription_dropped_ = false;
+  }
+
+  while (is_running_) {
+    // Subscribe before loading the rules, so that no change is missed in
+    // between. Changes published while unsubscribed are caught up by a full
+    // sync
+    if (!is_subscribed) {
+      is_subscribed = try_redis_subscribe(
+        subscriber,
+        POLICYDB_CHANGES_CHANNEL,
+        [this](const std::string& rule_id) {
+          {
+            std::lock_guard<std::mutex> lock(changes_mutex_);
+            changed_rule_ids_.insert(rule_id);
+          }
+          changes_cv_.notify_one();
+        },
+        [this]() {
+          {
+            std::lock_guard<std::mutex> lock(changes_mutex_);
+            subscription_dropped_ = true;
+          }
+          changes_cv_.notify_one();
+        });
+      needs_full_sync = true;
+    }
+    if (!client->is_connected()) {
+      if (!try_redis_connect(*client)) {
+        std::this_thread::sleep_for(interval);
+        continue;
+      }
+      MLOG(MINFO) << "Connected to redis server";
+      needs_full_sync = true;
+    }
+
+    std::unordered_set<std::string> rule_ids;
+    bool subscription_lost = false;
+    // Without a subscription, changes are only seen by full syncs, so keep
+    // doing them, and retrying to subscribe, on the loop interval
+    auto wake_up = next_full_sync;
+    if (!is_subscribed) {
+      wake_up = std::min(wake_up, std::chrono::steady_clock::now() + interval);
+    }
+    {
+      std::unique_lock<std::mutex> lock(changes_mutex_);
+      changes_cv_.wait_until(lock, wake_up, [this] {
+        return !is_running_ || subscription_dropped_ ||
+               !changed_rule_ids_.empty();
+      });
+      rule_ids.swap(changed_rule_ids_);
+      if (subscription_dropped_) {
+        subscription_dropped_ = false;
+        subscription_lost = is_subscribed;
+        is_subscribed = false;
+      }
+    }
+    if (!is_running_) {
+      break;
+    }
+    if (!is_subscribed && subscription_lost) {
+      continue; // resubscribe first, which also triggers a full sync
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (!is_subscribed || needs_full_sync || now >= next_full_sync) {
+      needs_full_sync = !full_sync(*client, processor);
+      // Retry a failed full sync on the loop interval
+      next_full_sync = now + (needs_full_sync ? interval : full_sync_interval);
+    } else if (!rule_ids.empty()) {
+      needs_full_sync = !incremental_sync(*client, rule_ids, processor);
+    }
+  }
+}
+
 void PolicyLoader::stop()
 {
   is_running_ = false;
+  changes_cv_.notify_one();
 }
 
 }
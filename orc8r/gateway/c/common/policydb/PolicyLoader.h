@@ -6,18 +6,50 @@
  * LICENSE file in the root directory of this source tree. An additional grant
  * of patent rights can be found in the PATENTS file in the same directory.
  */
+#pragma once
+
 #include <atomic>
+#include <condition_variable>
 #include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <cpp_redis/cpp_redis>
 #include <lte/protos/policydb.pb.h>
 
 namespace magma {
 using namespace lte;
+
+/**
+ * try_redis_connect connects the client to the local redis server, whose port
+ * is read from the redis service config
+ */
+bool try_redis_connect(cpp_redis::client& client);
+
+/**
+ * try_redis_subscribe connects the subscriber to the local redis server and
+ * subscribes it to the channel. on_dropped is called if the connection drops
+ */
+bool try_redis_subscribe(
+  cpp_redis::subscriber& subscriber,
+  const std::string& channel,
+  std::function<void(const std::string&)> on_message,
+  std::function<void()> on_dropped);
+
 /**
  * PolicyLoader is used to sync policies with Redis every so often
  */
 class PolicyLoader {
 public:
+  /**
+   * Callback for incremental updates, taking the new or changed rules and the
+   * ids of the removed rules
+   */
+  using RuleUpdateProcessor = std::function<void(
+    const std::vector<PolicyRule>&,
+    const std::vector<std::string>&)>;
 
   /**
    * start_loop is the main function to call to initiate a load loop. Based on
@@ -28,11 +60,55 @@ public:
     std::function<void(std::vector<PolicyRule>)> processor,
     uint32_t loop_interval_seconds);
 
+  /**
+   * start_incremental_loop keeps the policies in sync with redis without
+   * reloading all of them on every interval. Writers publish the ids of the
+   * rules they change on the policydb:rules:changes channel, and only those
+   * rules are fetched and passed to the processor as changed or removed.
+   * A full load, diffed against the previously loaded rules, is done after
+   * (re)connecting and as a safety resync every full_sync_interval_seconds,
+   * so that changes from writers which don't publish, or published while
+   * disconnected, are picked up. The loop interval is the retry delay while
+   * redis is unreachable.
+   */
+  void start_incremental_loop(
+    RuleUpdateProcessor processor,
+    uint32_t loop_interval_seconds,
+    uint32_t full_sync_interval_seconds);
+
   /**
    * Stop the config loop on the next loop
    */
   void stop();
+private:
+  bool full_sync(
+    cpp_redis::client& client,
+    const RuleUpdateProcessor& processor);
+
+  bool incremental_sync(
+    cpp_redis::client& client,
+    const std::unordered_set<std::string>& rule_ids,
+    const RuleUpdateProcessor& processor);
+
+  /**
+   * Compare a serialized rule read from redis with the one loaded before, and
+   * add it to changed_rules if it is new or different. Returns false if the
+   * value couldn't be deserialized, in which case the rule loaded before is
+   * kept
+   */
+  bool diff_rule(
+    const std::string& rule_id,
+    const std::string& value,
+    std::vector<PolicyRule>& changed_rules);
+
 private:
   std::atomic<bool> is_running_;
+  // Rule ids published on the changes channel since the last sync
+  std::mutex changes_mutex_;
+  std::condition_variable changes_cv_;
+  std::unordered_set<std::string> changed_rule_ids_;
+  bool subscription_dropped_;
+  // rule id -> serialized PolicyRule, as of the last sync
+  std::unordered_map<std::string, std::string> rule_values_;
 };
 }
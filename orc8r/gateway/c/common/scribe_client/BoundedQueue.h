@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace magma {
+
+/**
+ * BoundedQueue is a fixed capacity lock-free queue that any number of threads
+ * can push to and pop from. Each slot carries a sequence number telling
+ * whether it is free for the producer or filled for the consumer at the
+ * current position, so a push or pop only contends on a single CAS of the
+ * position. The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity):
+    mask_(round_up_pow2(capacity) - 1),
+    slots_(new Slot[mask_ + 1]),
+    push_pos_(0),
+    pop_pos_(0)
+  {
+    for (size_t i = 0; i <= mask_; i++) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  /**
+   * Move the item into the queue.
+   * @return false if the queue is full, in which case item is left untouched
+   */
+  bool push(T& item)
+  {
+    Slot* slot;
+    size_t pos = push_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      slot = &slots_[pos & mask_];
+      size_t seq = slot->sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+      if (diff == 0) {
+        if (push_pos_.compare_exchange_weak(
+              pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = push_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    slot->item = std::move(item);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Move the oldest item out of the queue.
+   * @return false if the queue is empty
+   */
+  bool pop(T& item_out)
+  {
+    Slot* slot;
+    size_t pos = pop_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      slot = &slots_[pos & mask_];
+      size_t seq = slot->sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t) seq - (intptr_t)(pos + 1);
+      if (diff == 0) {
+        if (pop_pos_.compare_exchange_weak(
+              pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = pop_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    item_out = std::move(slot->item);
+    slot->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Number of items in the queue. Only a snapshot while other threads push
+   * or pop
+   */
+  size_t size() const
+  {
+    size_t pushed = push_pos_.load(std::memory_order_relaxed);
+    size_t popped = pop_pos_.load(std::memory_order_relaxed);
+    return pushed > popped ? pushed - popped : 0;
+  }
+
+  size_t capacity() const
+  {
+    return mask_ + 1;
+  }
+
+ private:
+  static size_t round_up_pow2(size_t n)
+  {
+    size_t pow2 = 2;
+    while (pow2 < n) {
+      pow2 <<= 1;
+    }
+    return pow2;
+  }
+
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T item;
+  };
+
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  // Producers and consumers update different positions, keep them apart
+  std::atomic<size_t> push_pos_;
+  char padding_[64];
+  std::atomic<size_t> pop_pos_;
+};
+
+} // namespace magma
@@ -9,12 +9,14 @@
 
 #include <ctime>
 #include <iostream>
+#include <random>
 #include <thread>
 #include <utility>
 
 #include <orc8r/protos/logging_service.grpc.pb.h>
 
 #include "ScribeClient.h"
+#include "MetricsSingleton.h"
 #include "ServiceRegistrySingleton.h"
 
 
@@ -26,10 +28,19 @@ using magma::LoggingServiceClient;
 using magma::Void;
 using magma::LogRequest;
 using magma::LoggerDestination;
+using magma::service303::MetricsSingleton;
 using magma::LogEntry;
 
-LoggingServiceClient::LoggingServiceClient() {
+const uint32_t LoggingServiceClient::MAX_QUEUED_ENTRIES;
+const uint32_t LoggingServiceClient::MAX_BATCH_SIZE;
+const uint32_t LoggingServiceClient::MAX_BATCHES_IN_FLIGHT;
+const uint32_t LoggingServiceClient::FLUSH_INTERVAL_MS;
+
+LoggingServiceClient::LoggingServiceClient():
+  pending_entries_(MAX_QUEUED_ENTRIES), batches_in_flight_(0) {
   initializeClient();
+  std::thread flush_thread([this]() { flush_loop(); });
+  flush_thread.detach();
 }
 
 LoggingServiceClient &LoggingServiceClient::get_instance() {
@@ -45,15 +56,126 @@ void LoggingServiceClient::initializeClient() {
       ->GetGrpcChannel("logger", ServiceRegistrySingleton::CLOUD);
   // Create stub for LoggingService gRPC service
   stub_ = LoggingService::NewStub(channel);
-  stub_ == nullptr;
-  std::cerr << "Unable to create LoggingServiceClient " << std::endl;
+  if (stub_ == nullptr) {
+    std::cerr << "Unable to create LoggingServiceClient " << std::endl;
+    return;
+  }
   std::thread resp_loop_thread([&]() { rpc_response_loop(); });
   resp_loop_thread.detach();
 }
 
 bool LoggingServiceClient::shouldLog(float samplingRate) {
-  srand(time(0));
-  return (rand() / (RAND_MAX)) < samplingRate;
+  // Entries are logged from many threads, give each its own generator
+  thread_local std::mt19937 generator(std::random_device{}());
+  std::uniform_real_distribution<float> die(0, 1);
+  return die(generator) < samplingRate;
+}
+
+void LoggingServiceClient::enqueue(PendingEntry& pending) {
+  if (!pending_entries_.push(pending)) {
+    MetricsSingleton::Instance()
+      .GetCounter("scribe_entries_dropped", {{"reason", "queue_full"}})
+      .Increment();
+    if (pending.callback != nullptr) {
+      pending.callback(
+        Status(grpc::RESOURCE_EXHAUSTED, "scribe log queue is full"), Void());
+    }
+    return;
+  }
+  // Flush early once a full batch is queued. A missed wakeup only delays the
+  // flush until the interval
+  if (pending_entries_.size() >= MAX_BATCH_SIZE) {
+    flush_cv_.notify_one();
+  }
+}
+
+void LoggingServiceClient::flush_loop() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(flush_mutex_);
+      // A full batch can't be sent while too many are in flight, wait for
+      // a response instead of spinning
+      flush_cv_.wait_for(
+        lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS), [this]() {
+          return pending_entries_.size() >= MAX_BATCH_SIZE &&
+                 batches_in_flight_ < MAX_BATCHES_IN_FLIGHT;
+        });
+    }
+    flush();
+  }
+}
+
+void LoggingServiceClient::flush() {
+  MetricsSingleton::Instance()
+    .GetGauge("scribe_queue_depth", {})
+    .Set(pending_entries_.size());
+  while (batches_in_flight_ < MAX_BATCHES_IN_FLIGHT) {
+    std::vector<PendingEntry> batch;
+    PendingEntry pending;
+    while (batch.size() < MAX_BATCH_SIZE && pending_entries_.pop(pending)) {
+      batch.push_back(std::move(pending));
+    }
+    if (batch.empty()) {
+      return;
+    }
+    send_batch(batch);
+    if (batch.size() < MAX_BATCH_SIZE) {
+      return; // the queue is drained
+    }
+  }
+}
+
+void LoggingServiceClient::send_batch(std::vector<PendingEntry>& batch) {
+  LogRequest request;
+  LoggerDestination dest;
+  if (LoggerDestination_Parse("SCRIBE", &dest)) {
+    request.set_destination(dest);
+  }
+  auto callbacks =
+    std::make_shared<std::vector<std::function<void(Status, Void)>>>();
+  for (auto& pending : batch) {
+    request.add_entries()->Swap(&pending.entry);
+    if (pending.callback != nullptr) {
+      callbacks->push_back(std::move(pending.callback));
+    }
+  }
+  auto batch_size = request.entries_size();
+  MetricsSingleton::Instance()
+    .GetHistogram(
+      "scribe_batch_size", {}, {1.0, 8.0, 32.0, 128.0, (double) MAX_BATCH_SIZE})
+    .Observe(batch_size);
+
+  batches_in_flight_++;
+  // Create a raw response pointer that stores a callback to be called when the
+  // gRPC call is answered
+  auto local_response = new AsyncLocalResponse<Void>(
+    [this, callbacks, batch_size](Status status, Void response) {
+      {
+        // Queued full batches may wait for this response, decrement under
+        // the lock so that the flusher doesn't miss the wakeup
+        std::lock_guard<std::mutex> lock(flush_mutex_);
+        batches_in_flight_--;
+      }
+      flush_cv_.notify_one();
+      if (!status.ok()) {
+        MetricsSingleton::Instance()
+          .GetCounter("scribe_entries_dropped", {{"reason", "rpc_failed"}})
+          .Increment(batch_size);
+      }
+      for (const auto& callback : *callbacks) {
+        callback(status, response);
+      }
+    },
+    RESPONSE_TIMEOUT);
+  // Create a response reader for the `Log` RPC call. This reader
+  // stores the client context, the request to pass in, and the queue to add
+  // the response to when done
+  auto response_reader = stub_->AsyncLog(
+      local_response->get_context(), request, &queue_);
+  // Set the reader for the local response. This executes the `Log`
+  // response using the response reader. When it is done, the callback stored in
+  // `local_response` will be called
+  local_response->set_response_reader(std::move(response_reader));
 }
 
 int LoggingServiceClient::log_to_scribe(
@@ -67,13 +189,8 @@ int LoggingServiceClient::log_to_scribe(
     std::function<void(Status, Void)> callback) {
   LoggingServiceClient &client = get_instance();
   if (client.stub_ == nullptr || !client.shouldLog(sampling_rate)) return 0;
-  LogRequest request;
-  Void response;
-  LoggerDestination dest;
-  if (LoggerDestination_Parse("SCRIBE", &dest)) {
-    request.set_destination(dest);
-  }
-  LogEntry *entry = request.add_entries();
+  PendingEntry pending;
+  LogEntry *entry = &pending.entry;
   entry->set_category(category);
   entry->set_time(time);
   auto strMap = entry->mutable_normal_map();
@@ -88,19 +205,8 @@ int LoggingServiceClient::log_to_scribe(
     int val = int_params[i].val;
     (*intMap)[key] = val;
   }
-  // Create a raw response pointer that stores a callback to be called when the
-  // gRPC call is answered
-  auto local_response = new AsyncLocalResponse<Void>(
-      std::move(callback), RESPONSE_TIMEOUT);
-  // Create a response reader for the `Log` RPC call. This reader
-  // stores the client context, the request to pass in, and the queue to add
-  // the response to when done
-  auto response_reader = client.stub_->AsyncLog(
-      local_response->get_context(), request, &client.queue_);
-  // Set the reader for the local response. This executes the `Log`
-  // response using the response reader. When it is done, the callback stored in
-  // `local_response` will be called
-  local_response->set_response_reader(std::move(response_reader));
+  pending.callback = std::move(callback);
+  client.enqueue(pending);
   return 0;
 }
 
@@ -113,13 +219,8 @@ void LoggingServiceClient::log_to_scribe(
     std::function<void(Status, Void)> callback) {
   LoggingServiceClient &client = get_instance();
   if (client.stub_ == nullptr || !client.shouldLog(sampling_rate)) return;
-  LogRequest request;
-  Void response;
-  LoggerDestination dest;
-  if (LoggerDestination_Parse("SCRIBE", &dest)) {
-    request.set_destination(dest);
-  }
-  LogEntry *entry = request.add_entries();
+  PendingEntry pending;
+  LogEntry *entry = &pending.entry;
   entry->set_category(category);
   entry->set_time(time);
   auto strMap = entry->mutable_normal_map();
@@ -130,17 +231,6 @@ void LoggingServiceClient::log_to_scribe(
   for (const auto &pair : int_params) {
     (*intMap)[pair.first] = pair.second;
   }
-  // Create a raw response pointer that stores a callback to be called when the
-  // gRPC call is answered
-  auto local_response = new AsyncLocalResponse<Void>(
-      std::move(callback), RESPONSE_TIMEOUT);
-  // Create a response reader for the `Log` RPC call. This reader
-  // stores the client context, the request to pass in, and the queue to add
-  // the response to when done
-  auto response_reader = client.stub_->AsyncLog(
-      local_response->get_context(), request, &client.queue_);
-  // Set the reader for the local response. This executes the `Log`
-  // response using the response reader. When it is done, the callback stored in
-  // `local_response` will be called
-  local_response->set_response_reader(std::move(response_reader));
+  pending.callback = std::move(callback);
+  client.enqueue(pending);
 }
@@ -8,12 +8,20 @@
  */
  #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
 #include <grpc++/grpc++.h>
 
 #include <orc8r/protos/logging_service.grpc.pb.h>
 
 #include "scribe_rpc_client.h"
 
+#include "BoundedQueue.h"
 #include "GRPCReceiver.h"
 
 using grpc::Status;
@@ -30,7 +38,10 @@ using magma::orc8r::LoggerDestination;
 namespace magma {
 using namespace orc8r;
 /*
- * gRPC client for LoggingService
+ * gRPC client for LoggingService. Entries are queued and shipped in batches
+ * by a flusher thread, once enough entries are queued or after the flush
+ * interval. Entries are dropped when the queue is full, which happens when
+ * the cloud can't keep up or is unreachable.
  */
 class LoggingServiceClient : public GRPCReceiver{
  public:
@@ -49,7 +60,8 @@ class LoggingServiceClient : public GRPCReceiver{
    * samplingRate of the log. The ScribeClient will throw a die with value in
    * [0, 1) and drop the attempt to log the entry if the result of the die is
    * larger than the samplingRate.
-   * @param callback: callback function is called when LogToScribe returns
+   * @param callback: callback function is called when the batch containing the
+   * entry is logged, or with RESOURCE_EXHAUSTED if the entry is dropped
    */
   static int log_to_scribe(
       char const *category,
@@ -71,7 +83,8 @@ class LoggingServiceClient : public GRPCReceiver{
    * sampling_rate of the log. The ScribeClient will throw a die with value in
    * [0, 1) and drop the attempt to log the entry if the result of the die is
    * larger than the sampling_rate.
-   * @param callback callback function is called when LogToScribe returns
+   * @param callback callback function is called when the batch containing the
+   * entry is logged, or with RESOURCE_EXHAUSTED if the entry is dropped
    */
   static void log_to_scribe(
       std::string category,
@@ -86,12 +99,34 @@ class LoggingServiceClient : public GRPCReceiver{
   void operator=(LoggingServiceClient const&) = delete;
 
  private:
+  struct PendingEntry {
+    LogEntry entry;
+    std::function<void(Status, Void)> callback;
+  };
+
   explicit LoggingServiceClient();
   static LoggingServiceClient& get_instance();
   std::shared_ptr<LoggingService::Stub> stub_;
   bool shouldLog(float samplingRate);
   void initializeClient();
+  // Queue the entry to be shipped by the flusher thread
+  void enqueue(PendingEntry& pending);
+  // Wait for a batch to fill up or the flush interval, and flush, forever
+  void flush_loop();
+  // Send all the queued entries, as long as not too many batches are in flight
+  void flush();
+  void send_batch(std::vector<PendingEntry>& batch);
+
+  BoundedQueue<PendingEntry> pending_entries_;
+  std::atomic<uint32_t> batches_in_flight_;
+  std::mutex flush_mutex_;
+  std::condition_variable flush_cv_;
+
   static const uint32_t RESPONSE_TIMEOUT = 3; // seconds
+  static const uint32_t MAX_QUEUED_ENTRIES = 4096;
+  static const uint32_t MAX_BATCH_SIZE = 256;
+  static const uint32_t MAX_BATCHES_IN_FLIGHT = 4;
+  static const uint32_t FLUSH_INTERVAL_MS = 500;
 };
 
 } // namespace magma
@@ -101,7 +101,9 @@ void log_to_scribe(
 }
 
 static void log_to_scribe_done(const grpc::Status& status) {
-  if (!status.ok()) {
+  // Entries dropped because the queue is full are only counted, printing
+  // each of them would flood the output while the cloud is unreachable
+  if (!status.ok() && status.error_code() != grpc::RESOURCE_EXHAUSTED) {
     std::cerr << "log_to_scribe fails with code " << status.error_code()
               << ", msg: " << status.error_message() << std::endl;
   }
@@ -133,7 +133,7 @@ Status MagmaService::GetMetrics(
   setSharedMetrics();
 
   MetricsSingleton& instance = MetricsSingleton::Instance();
-  const std::vector<MetricFamily>& collected = instance.registry_->Collect();
+  const std::vector<MetricFamily>& collected = instance.Collect();
   for (auto it = collected.begin(); it != collected.end(); it++) {
     MetricFamily* family = response->add_family();
     family->CopyFrom(*it);
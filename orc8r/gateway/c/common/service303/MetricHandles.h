@@ -0,0 +1,170 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <prometheus/counter.h>
+#include <prometheus/gauge.h>
+#include <prometheus/histogram.h>
+
+namespace magma { namespace service303 {
+
+/*
+ * ShardedCell accumulates updates in a fixed number of atomic shards, each
+ * on its own cache line. Every thread always adds to the same shard, so
+ * threads updating the same metric rarely contend. The shards are drained
+ * into the prometheus metric when the metrics are collected.
+ */
+class ShardedCell {
+  public:
+    static const size_t NUM_SHARDS = 16;
+
+    ShardedCell() {
+      for (auto& shard : shards_) {
+        shard.value.store(0, std::memory_order_relaxed);
+      }
+    }
+
+    void Add(double value) {
+      auto& cell = shards_[ShardIndex()].value;
+      double current = cell.load(std::memory_order_relaxed);
+      while (!cell.compare_exchange_weak(
+          current, current + value, std::memory_order_relaxed)) {}
+    }
+
+    // Return the sum of the shards and reset them
+    double Drain() {
+      double sum = 0;
+      for (auto& shard : shards_) {
+        sum += shard.value.exchange(0, std::memory_order_relaxed);
+      }
+      return sum;
+    }
+
+  private:
+    // Shard of the calling thread, assigned round robin on first use
+    static size_t ShardIndex();
+
+    struct Shard {
+      std::atomic<double> value;
+      // Keep the next shard off this cache line
+      char padding[64 - sizeof(std::atomic<double>)];
+    };
+    Shard shards_[NUM_SHARDS];
+};
+
+/*
+ * A prometheus metric with the updates that haven't been applied to it yet.
+ * The mutex is the one of MetricsSingleton, which guards the metric itself.
+ * The name and labels let MetricsSingleton::flush rebind the metric into a
+ * new registry.
+ */
+template <typename T>
+struct ShardedMetric {
+  ShardedMetric(T& metric, std::mutex& mutex, const std::string& name,
+      const std::map<std::string, std::string>& labels):
+    metric(&metric), mutex(mutex), name(name), labels(labels) {}
+
+  T* metric;
+  std::mutex& mutex;
+  const std::string name;
+  const std::map<std::string, std::string> labels;
+  ShardedCell pending;
+};
+
+/*
+ * A prometheus histogram, with what MetricsSingleton::flush needs to rebind
+ * it into a new registry
+ */
+struct HistogramMetric {
+  HistogramMetric(prometheus::Histogram& histogram, std::mutex& mutex,
+      const std::string& name,
+      const std::map<std::string, std::string>& labels,
+      const std::vector<double>& boundaries):
+    histogram(&histogram), mutex(mutex), name(name), labels(labels),
+    boundaries(boundaries) {}
+
+  prometheus::Histogram* histogram;
+  std::mutex& mutex;
+  const std::string name;
+  const std::map<std::string, std::string> labels;
+  const std::vector<double> boundaries;
+};
+
+/*
+ * Handles are resolved once from a name and label set with
+ * MetricsSingleton::GetCounter/GetGauge/GetHistogram, and can then be updated
+ * from any thread without looking the metric up again. They stay valid for
+ * the life of the process, MetricsSingleton::flush rebinds them.
+ */
+class CounterHandle {
+  public:
+    explicit CounterHandle(ShardedMetric<prometheus::Counter>* metric):
+      metric_(metric) {}
+
+    void Increment(double increment = 1) {
+      // prometheus counters ignore negative increments as well
+      if (increment > 0) {
+        metric_->pending.Add(increment);
+      }
+    }
+
+    ShardedMetric<prometheus::Counter>* get() const { return metric_; }
+
+  private:
+    ShardedMetric<prometheus::Counter>* metric_;
+};
+
+class GaugeHandle {
+  public:
+    explicit GaugeHandle(ShardedMetric<prometheus::Gauge>* metric):
+      metric_(metric) {}
+
+    void Increment(double increment = 1) {
+      metric_->pending.Add(increment);
+    }
+
+    void Decrement(double decrement = 1) {
+      metric_->pending.Add(-decrement);
+    }
+
+    // Setting overrides any update that hasn't been collected yet
+    void Set(double value) {
+      std::lock_guard<std::mutex> lock(metric_->mutex);
+      metric_->pending.Drain();
+      metric_->metric->Set(value);
+    }
+
+    ShardedMetric<prometheus::Gauge>* get() const { return metric_; }
+
+  private:
+    ShardedMetric<prometheus::Gauge>* metric_;
+};
+
+class HistogramHandle {
+  public:
+    explicit HistogramHandle(HistogramMetric* metric): metric_(metric) {}
+
+    // Observations are rare enough to go to the histogram directly
+    void Observe(double observation) {
+      std::lock_guard<std::mutex> lock(metric_->mutex);
+      metric_->histogram->Observe(observation);
+    }
+
+  private:
+    HistogramMetric* metric_;
+};
+
+}}
@@ -49,6 +49,12 @@ class MetricsRegistry {
            const std::map<std::string, std::string>& labels,
            Args&&... args);
 
+    // Forget the families and metrics, e.g. before replacing the registry
+    void Clear() {
+      families_.clear();
+      metrics_.clear();
+    }
+
     const std::size_t SizeFamilies() {
       return families_.size();
     }
@@ -14,19 +14,53 @@ using prometheus::BuildCounter;
 using prometheus::BuildGauge;
 using prometheus::BuildHistogram;
 using magma::service303::MetricsSingleton;
+using magma::service303::ShardedCell;
+using magma::service303::ShardedMetric;
+using magma::service303::CounterHandle;
+using magma::service303::GaugeHandle;
+using magma::service303::HistogramHandle;
+using magma::service303::HistogramMetric;
 
 MetricsSingleton* MetricsSingleton::instance_ = NULL;
 
 MetricsSingleton& MetricsSingleton::Instance() {
-  if (instance_ == NULL) {
-    instance_ = new MetricsSingleton();
-  }
+  // Metrics are updated from many threads, so only create the instance once
+  static std::once_flag init_flag;
+  std::call_once(init_flag, []() {
+    if (instance_ == NULL) {
+      instance_ = new MetricsSingleton();
+    }
+  });
   return *instance_;
 }
 
 void MetricsSingleton::flush() {
-  delete instance_;
-  instance_ = new MetricsSingleton();
+  // Cached handles point into the instance, so it is reset in place
+  Instance().Reset();
+}
+
+void MetricsSingleton::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // The metrics registries still point into the registry being replaced
+  counters_.Clear();
+  gauges_.Clear();
+  histograms_.Clear();
+  registry_ = std::make_shared<Registry>();
+  for (auto& entry : counter_handles_) {
+    auto& metric = *entry.second;
+    metric.pending.Drain();
+    metric.metric = &counters_.Get(metric.name, metric.labels);
+  }
+  for (auto& entry : gauge_handles_) {
+    auto& metric = *entry.second;
+    metric.pending.Drain();
+    metric.metric = &gauges_.Get(metric.name, metric.labels);
+  }
+  for (auto& entry : histogram_handles_) {
+    auto& metric = *entry.second;
+    metric.histogram = &histograms_.Get(metric.name, metric.labels,
+      Histogram::BucketBoundaries(metric.boundaries));
+  }
 }
 
 MetricsSingleton::MetricsSingleton() :
@@ -43,40 +77,129 @@ void MetricsSingleton::args_to_map(std::map<std::string, std::string>& labels, s
   }
 }
 
-void MetricsSingleton::IncrementCounter(const char* name,
-  double increment,
+std::string MetricsSingleton::metric_key(const std::string& name,
+  const std::map<std::string, std::string>& labels) {
+  // Separate the parts with a character that doesn't appear in names
+  std::string key = name;
+  for (const auto& label : labels) {
+    key.append(1, '\x1f').append(label.first);
+    key.append(1, '\x1f').append(label.second);
+  }
+  return key;
+}
+
+size_t ShardedCell::ShardIndex() {
+  static std::atomic<size_t> next_shard(0);
+  thread_local size_t shard = next_shard++ % NUM_SHARDS;
+  return shard;
+}
+
+CounterHandle MetricsSingleton::GetCounter(const std::string& name,
+  const std::map<std::string, std::string>& labels) {
+  auto key = metric_key(name, labels);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = counter_handles_.find(key);
+  if (it == counter_handles_.end()) {
+    auto metric = std::unique_ptr<ShardedMetric<Counter>>(
+      new ShardedMetric<Counter>(
+        counters_.Get(name, labels), mutex_, name, labels));
+    it = counter_handles_.insert({key, std::move(metric)}).first;
+  }
+  return CounterHandle(it->second.get());
+}
+
+GaugeHandle MetricsSingleton::GetGauge(const std::string& name,
+  const std::map<std::string, std::string>& labels) {
+  auto key = metric_key(name, labels);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = gauge_handles_.find(key);
+  if (it == gauge_handles_.end()) {
+    auto metric = std::unique_ptr<ShardedMetric<Gauge>>(
+      new ShardedMetric<Gauge>(
+        gauges_.Get(name, labels), mutex_, name, labels));
+    it = gauge_handles_.insert({key, std::move(metric)}).first;
+  }
+  return GaugeHandle(it->second.get());
+}
+
+CounterHandle MetricsSingleton::GetCounter(const char* name,
   size_t label_count,
   va_list& args) {
   std::map<std::string, std::string> labels;
   args_to_map(labels, label_count, args);
-  counters_.Get(name, labels).Increment(increment);
+  return GetCounter(name, labels);
 }
 
-void MetricsSingleton::IncrementGauge(const char* name,
-  double increment,
+GaugeHandle MetricsSingleton::GetGauge(const char* name,
   size_t label_count,
   va_list& args) {
   std::map<std::string, std::string> labels;
   args_to_map(labels, label_count, args);
-  gauges_.Get(name, labels).Increment(increment);
+  return GetGauge(name, labels);
+}
+
+HistogramHandle MetricsSingleton::GetHistogram(const std::string& name,
+  const std::map<std::string, std::string>& labels,
+  const std::vector<double>& boundaries) {
+  auto key = metric_key(name, labels);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = histogram_handles_.find(key);
+  if (it == histogram_handles_.end()) {
+    // Like the registry, keep the boundaries the histogram was created with
+    auto& histogram = histograms_.Get(
+      name, labels, Histogram::BucketBoundaries(boundaries));
+    auto metric = std::unique_ptr<HistogramMetric>(
+      new HistogramMetric(histogram, mutex_, name, labels, boundaries));
+    it = histogram_handles_.insert({key, std::move(metric)}).first;
+  }
+  return HistogramHandle(it->second.get());
+}
+
+std::vector<io::prometheus::client::MetricFamily> MetricsSingleton::Collect() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& entry : counter_handles_) {
+    auto increment = entry.second->pending.Drain();
+    if (increment > 0) {
+      entry.second->metric->Increment(increment);
+    }
+  }
+  for (auto& entry : gauge_handles_) {
+    auto change = entry.second->pending.Drain();
+    if (change > 0) {
+      entry.second->metric->Increment(change);
+    } else if (change < 0) {
+      entry.second->metric->Decrement(-change);
+    }
+  }
+  return registry_->Collect();
+}
+
+void MetricsSingleton::IncrementCounter(const char* name,
+  double increment,
+  size_t label_count,
+  va_list& args) {
+  GetCounter(name, label_count, args).Increment(increment);
+}
+
+void MetricsSingleton::IncrementGauge(const char* name,
+  double increment,
+  size_t label_count,
+  va_list& args) {
+  GetGauge(name, label_count, args).Increment(increment);
 }
 
 void MetricsSingleton::DecrementGauge(const char* name,
   double decrement,
   size_t label_count,
   va_list& args) {
-  std::map<std::string, std::string> labels;
-  args_to_map(labels, label_count, args);
-  gauges_.Get(name, labels).Decrement(decrement);
+  GetGauge(name, label_count, args).Decrement(decrement);
 }
 
 void MetricsSingleton::SetGauge(const char* name,
   double value,
   size_t label_count,
   va_list& args) {
-  std::map<std::string, std::string> labels;
-  args_to_map(labels, label_count, args);
-  gauges_.Get(name, labels).Set(value);
+  GetGauge(name, label_count, args).Set(value);
 }
 
 void MetricsSingleton::ObserveHistogram(const char* name,
@@ -91,5 +214,5 @@ void MetricsSingleton::ObserveHistogram(const char* name,
   for (size_t i = 0; i < boundary_count; i++) {
     boundaries.push_back(va_arg(args, double));
   }
-  histograms_.Get(name, labels, Histogram::BucketBoundaries(boundaries)).Observe(observation);
+  GetHistogram(name, labels, boundaries).Observe(observation);
 }
@@ -10,9 +10,17 @@
 
 #include <stdarg.h>
 
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include <prometheus/registry.h>
 #include <grpc++/grpc++.h>
 
+#include "MetricHandles.h"
 #include "MetricsRegistry.h"
 
 using magma::service303::MetricsRegistry;
@@ -34,12 +42,20 @@ class MetricsSingleton;
  * MetricsSingleton is a singleton used to contain metrics registries and
  * interfaces to interact with unique prometheus timeseries each uniquely
  * defined by a family name, and a set of labels.
+ *
+ * Hot paths should resolve their timeseries once into a handle with
+ * GetCounter/GetGauge/GetHistogram. The variadic functions look the handle
+ * up on every call.
+ *
+ * flush() replaces the registry and rebinds the handles to new timeseries
+ * in it, so handles that callers cached in statics stay valid and their
+ * updates are collected again from zero. flush is only meant for tests.
  */
 class MetricsSingleton {
   friend class MagmaService;
   public:
     static MetricsSingleton& Instance();
-    static void flush(); // destroy instance
+    static void flush(); // reset all the metrics, see above
     void IncrementCounter(const char* name,
       double increment,
       size_t label_count,
@@ -60,17 +76,49 @@ class MetricsSingleton {
       double observation,
       size_t label_count,
       va_list& args);
+
+    CounterHandle GetCounter(const std::string& name,
+      const std::map<std::string, std::string>& labels);
+    CounterHandle GetCounter(const char* name,
+      size_t label_count,
+      va_list& args);
+    GaugeHandle GetGauge(const std::string& name,
+      const std::map<std::string, std::string>& labels);
+    GaugeHandle GetGauge(const char* name,
+      size_t label_count,
+      va_list& args);
+    HistogramHandle GetHistogram(const std::string& name,
+      const std::map<std::string, std::string>& labels,
+      const std::vector<double>& boundaries);
+
+    /*
+     * Apply the pending updates of all the handles to their metrics, and
+     * collect the metric families of the registry
+     */
+    std::vector<io::prometheus::client::MetricFamily> Collect();
   private:
     MetricsSingleton(); // Prevent construction
     MetricsSingleton(const MetricsSingleton&); // Prevent construction by copying
     MetricsSingleton& operator=(const MetricsSingleton&); // Prevent assignment
     void args_to_map(std::map<std::string, std::string>& labels, size_t label_count, va_list& args); // Helper to convert variadic labels to map
+    void Reset(); // Implements flush
+    static std::string metric_key(const std::string& name,
+      const std::map<std::string, std::string>& labels);
+    // Guards the registries, the handle maps and the prometheus metrics
+    std::mutex mutex_;
     // Shared registry to store all our metrics
     std::shared_ptr<prometheus::Registry> registry_;
     // Dictionaries to store instances of our metrics and intialize new ones
     MetricsRegistry<Counter, CounterBuilder (&)()> counters_;
     MetricsRegistry<Gauge, GaugeBuilder (&)()> gauges_;
     MetricsRegistry<Histogram, HistogramBuilder (&)()> histograms_;
+    // Handles by name and labels, see metric_key
+    std::unordered_map<std::string, std::unique_ptr<ShardedMetric<Counter>>>
+      counter_handles_;
+    std::unordered_map<std::string, std::unique_ptr<ShardedMetric<Gauge>>>
+      gauge_handles_;
+    std::unordered_map<std::string, std::unique_ptr<HistogramMetric>>
+      histogram_handles_;
     static MetricsSingleton* instance_;
 };
 
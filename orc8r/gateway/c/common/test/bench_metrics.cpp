@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+/**
+ * Measures counter increments per second from 8 threads, through the
+ * variadic IncrementCounter the C increment_counter wraps and through a
+ * cached counter handle.
+ *    metrics_bench [increments per thread]
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MetricsSingleton.h"
+
+using magma::service303::MetricsSingleton;
+
+#define NUM_THREADS 8
+
+static void increment_counter(const char* name, double increment,
+    size_t n_labels, ...) {
+  va_list ap;
+  va_start(ap, n_labels);
+  MetricsSingleton::Instance().IncrementCounter(name, increment, n_labels, ap);
+  va_end(ap);
+}
+
+template <typename F>
+static double increments_per_sec(long per_thread, F increment) {
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < NUM_THREADS; i++) {
+    threads.emplace_back([per_thread, &increment]() {
+      for (long j = 0; j < per_thread; j++) {
+        increment();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  return NUM_THREADS * per_thread / elapsed.count();
+}
+
+static double collected_value(const std::string& name) {
+  for (const auto& family : MetricsSingleton::Instance().Collect()) {
+    if (family.name() == name) {
+      return family.metric(0).counter().value();
+    }
+  }
+  return -1;
+}
+
+int main(int argc, char** argv) {
+  long per_thread = argc > 1 ? atol(argv[1]) : 1000000;
+
+  double varargs = increments_per_sec(per_thread, []() {
+    increment_counter("bench_counter", 1, 1, "result", "success");
+  });
+  printf("increment_counter: %.0f increments/sec (%d threads)\n",
+    varargs, NUM_THREADS);
+
+  auto handle = MetricsSingleton::Instance().GetCounter(
+    "bench_counter", {{"result", "success"}});
+  double cached = increments_per_sec(
+    per_thread, [&handle]() { handle.Increment(1); });
+  printf("CounterHandle: %.0f increments/sec (%d threads)\n",
+    cached, NUM_THREADS);
+
+  // Both paths update the same timeseries, nothing may be lost
+  double expected = 2.0 * NUM_THREADS * per_thread;
+  double value = collected_value("bench_counter");
+  if (value != expected) {
+    printf("collected %.0f increments, expected %.0f\n", value, expected);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
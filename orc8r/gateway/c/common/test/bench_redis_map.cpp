@@ -0,0 +1,160 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+
+/**
+ * Measures RedisMap ops/sec against a local redis server, on the port from
+ * the REDIS_PORT environment variable or the gateway redis port. For batches
+ * of 1, 100 and 10k keys it compares a set, get or remove call per key with
+ * the pipelined multi_set, multi_get and multi_delete.
+ *    redis_map_bench [rounds]
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <cpp_redis/cpp_redis>
+#include <orc8r/protos/common.pb.h>
+
+#include "RedisMap.hpp"
+#include "Serializers.h"
+
+using magma::orc8r::NetworkID;
+using std::chrono::steady_clock;
+
+namespace magma {
+
+const std::string BENCH_HASH = "bench:redis_map";
+
+static double ops_per_sec(steady_clock::time_point start, size_t ops)
+{
+  return ops /
+         std::chrono::duration<double>(steady_clock::now() - start).count();
+}
+
+static bool bench_batch(
+  RedisMap<NetworkID> &map,
+  size_t batch_size,
+  int rounds)
+{
+  std::vector<std::string> keys;
+  std::unordered_map<std::string, NetworkID> objects;
+  for (size_t i = 0; i < batch_size; i++) {
+    keys.push_back("key" + std::to_string(i));
+    objects[keys.back()].set_id("net" + std::to_string(i));
+  }
+  size_t ops = batch_size * rounds;
+  bool ok = true;
+
+  auto start = steady_clock::now();
+  for (int round = 0; round < rounds; round++) {
+    for (const auto &object : objects) {
+      ok &= map.set(object.first, object.second) == SUCCESS;
+    }
+  }
+  double set_rate = ops_per_sec(start, ops);
+
+  start = steady_clock::now();
+  for (int round = 0; round < rounds; round++) {
+    ok &= map.multi_set(objects) == SUCCESS;
+  }
+  double multi_set_rate = ops_per_sec(start, ops);
+
+  NetworkID value;
+  start = steady_clock::now();
+  for (int round = 0; round < rounds; round++) {
+    for (const auto &key : keys) {
+      ok &= map.get(key, value) == SUCCESS;
+    }
+  }
+  double get_rate = ops_per_sec(start, ops);
+
+  std::unordered_map<std::string, NetworkID> values;
+  start = steady_clock::now();
+  for (int round = 0; round < rounds; round++) {
+    values.clear();
+    ok &= map.multi_get(keys, values) == SUCCESS;
+  }
+  double multi_get_rate = ops_per_sec(start, ops);
+  ok &= values.size() == batch_size &&
+        values[keys.back()].id() == objects[keys.back()].id();
+
+  // Removal needs the keys to be set again before each round
+  double remove_sec = 0;
+  double multi_delete_sec = 0;
+  for (int round = 0; round < rounds; round++) {
+    map.multi_set(objects);
+    start = steady_clock::now();
+    for (const auto &key : keys) {
+      ok &= map.remove(key) == SUCCESS;
+    }
+    remove_sec +=
+      std::chrono::duration<double>(steady_clock::now() - start).count();
+
+    map.multi_set(objects);
+    start = steady_clock::now();
+    ok &= map.multi_delete(keys) == SUCCESS;
+    multi_delete_sec +=
+      std::chrono::duration<double>(steady_clock::now() - start).count();
+  }
+
+  printf(
+    "%5zu keys: set %8.0f  multi_set %8.0f  get %8.0f  multi_get %8.0f  "
+    "remove %8.0f  multi_delete %8.0f ops/sec\n",
+    batch_size,
+    set_rate,
+    multi_set_rate,
+    get_rate,
+    multi_get_rate,
+    ops / remove_sec,
+    ops / multi_delete_sec);
+  if (!ok) {
+    printf(
+      "%zu keys: an operation failed or returned a wrong value\n",
+      batch_size);
+  }
+  return ok;
+}
+
+} // namespace magma
+
+int main(int argc, char **argv)
+{
+  int rounds = argc > 1 ? std::atoi(argv[1]) : 10;
+  if (rounds < 1) {
+    fprintf(stderr, "redis_map_bench [rounds]\n");
+    return EXIT_FAILURE;
+  }
+
+  auto port_env = std::getenv("REDIS_PORT");
+  auto port = port_env != nullptr ? std::atoi(port_env) : 6380;
+  auto client = std::make_shared<cpp_redis::client>();
+  client->connect("127.0.0.1", port);
+  if (!client->is_connected()) {
+    fprintf(stderr, "redis-server must be running on port %d\n", port);
+    return EXIT_FAILURE;
+  }
+  magma::RedisMap<NetworkID> map(
+    client,
+    magma::BENCH_HASH,
+    magma::get_proto_serializer(),
+    magma::get_proto_deserializer());
+
+  bool ok = true;
+  for (size_t batch_size : {1, 100, 10000}) {
+    ok &= magma::bench_batch(map, batch_size, rounds);
+  }
+  auto del_future = client->del({magma::BENCH_HASH});
+  client->sync_commit();
+  del_future.get();
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
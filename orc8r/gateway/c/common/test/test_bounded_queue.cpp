@@ -0,0 +1,122 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BoundedQueue.h"
+
+using ::testing::Test;
+
+namespace magma {
+
+TEST(test_full_and_empty, test_bounded_queue) {
+  BoundedQueue<std::string> queue(3);
+  EXPECT_EQ(4, queue.capacity());
+
+  std::string item;
+  EXPECT_FALSE(queue.pop(item));
+  for (int i = 0; i < 4; i++) {
+    item = std::to_string(i);
+    EXPECT_TRUE(queue.push(item));
+  }
+  EXPECT_EQ(4, queue.size());
+
+  // A failed push leaves the item untouched
+  item = "overflow";
+  EXPECT_FALSE(queue.push(item));
+  EXPECT_EQ("overflow", item);
+
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(queue.pop(item));
+    EXPECT_EQ(std::to_string(i), item);
+  }
+  EXPECT_FALSE(queue.pop(item));
+  EXPECT_EQ(0, queue.size());
+}
+
+TEST(test_wraparound, test_bounded_queue) {
+  BoundedQueue<int> queue(4);
+  int item;
+  for (int i = 0; i < 100; i++) {
+    item = i;
+    EXPECT_TRUE(queue.push(item));
+    item = i + 1000;
+    EXPECT_TRUE(queue.push(item));
+    EXPECT_TRUE(queue.pop(item));
+    EXPECT_EQ(i, item);
+    EXPECT_TRUE(queue.pop(item));
+    EXPECT_EQ(i + 1000, item);
+  }
+  EXPECT_FALSE(queue.pop(item));
+}
+
+// Producers push into a small queue while consumers pop, so that the queue
+// is alternately full and empty. Every pushed item must be popped exactly
+// once.
+TEST(test_concurrent_push_pop, test_bounded_queue) {
+  const int PRODUCERS = 4;
+  const int CONSUMERS = 4;
+  const int ITEMS_PER_PRODUCER = 50000;
+  BoundedQueue<int> queue(16);
+  std::atomic<int> producers_done(0);
+  std::vector<std::atomic<int>> seen(PRODUCERS * ITEMS_PER_PRODUCER);
+  for (auto& count : seen) {
+    count = 0;
+  }
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < PRODUCERS; p++) {
+    threads.emplace_back([&, p]() {
+      for (int i = 0; i < ITEMS_PER_PRODUCER; i++) {
+        int item = p * ITEMS_PER_PRODUCER + i;
+        while (!queue.push(item)) {
+          std::this_thread::yield();
+        }
+      }
+      producers_done++;
+    });
+  }
+  for (int c = 0; c < CONSUMERS; c++) {
+    threads.emplace_back([&]() {
+      int item;
+      while (true) {
+        if (queue.pop(item)) {
+          seen[item]++;
+        } else if (producers_done == PRODUCERS) {
+          // All pushes happened before, an empty pop means drained
+          if (!queue.pop(item)) {
+            return;
+          }
+          seen[item]++;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < seen.size(); i++) {
+    ASSERT_EQ(1, seen[i]) << "item " << i;
+  }
+  EXPECT_EQ(0, queue.size());
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+}
@@ -0,0 +1,153 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+#include <gtest/gtest.h>
+#include <stdarg.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <prometheus/registry.h>
+
+#include "MetricsRegistry.h"
+#include "MetricsSingleton.h"
+
+using io::prometheus::client::MetricFamily;
+using magma::service303::MetricsRegistry;
+using magma::service303::MetricsSingleton;
+using prometheus::BuildCounter;
+using prometheus::Registry;
+using prometheus::detail::CounterBuilder;
+using ::testing::Test;
+
+namespace magma {
+
+// Same as the C increment_counter of the gateways
+static void increment_counter(const char* name, double increment,
+    size_t n_labels, ...) {
+  va_list ap;
+  va_start(ap, n_labels);
+  service303::MetricsSingleton::Instance().IncrementCounter(
+    name, increment, n_labels, ap);
+  va_end(ap);
+}
+
+// Value of the first timeseries of a family, -1 if it wasn't collected
+static double collected_value(const std::string& name) {
+  for (const auto& family : MetricsSingleton::Instance().Collect()) {
+    if (family.name() != name) {
+      continue;
+    }
+    const auto& metric = family.metric(0);
+    if (metric.has_counter()) {
+      return metric.counter().value();
+    } else if (metric.has_gauge()) {
+      return metric.gauge().value();
+    }
+    return metric.histogram().sample_count();
+  }
+  return -1;
+}
+
+// Tests the MetricsRegistry properly initializes and retrieves metrics
+TEST(test_metrics_registry, test_metrics) {
+  auto prometheus_registry = std::make_shared<Registry>();
+  auto registry = MetricsRegistry<prometheus::Counter, CounterBuilder (&)()>(
+    prometheus_registry, BuildCounter);
+  EXPECT_EQ(registry.SizeFamilies(), 0);
+  EXPECT_EQ(registry.SizeMetrics(), 0);
+
+  // Create two new timeseries that will construct two families and metrics
+  registry.Get("test", {});
+  registry.Get("another", {{"key", "value"}});
+  EXPECT_EQ(registry.SizeFamilies(), 2);
+  EXPECT_EQ(registry.SizeMetrics(), 2);
+
+  // This should retrieve the previously constructed family
+  registry.Get("test", {});
+  EXPECT_EQ(registry.SizeFamilies(), 2);
+  EXPECT_EQ(registry.SizeMetrics(), 2);
+
+  // Add new unique timeseries to an existing family
+  registry.Get("test", {{"key", "value1"}});
+  registry.Get("test", {{"key", "value2"}});
+  EXPECT_EQ(registry.SizeFamilies(), 2);
+  EXPECT_EQ(registry.SizeMetrics(), 4);
+
+  registry.Clear();
+  EXPECT_EQ(registry.SizeFamilies(), 0);
+  EXPECT_EQ(registry.SizeMetrics(), 0);
+}
+
+// Tests that handle updates from many threads are all applied on collection
+TEST(test_metric_handles, test_metrics) {
+  MetricsSingleton::flush();
+  auto& instance = MetricsSingleton::Instance();
+  auto counter = instance.GetCounter("handle_counter", {{"key", "value"}});
+  auto gauge = instance.GetGauge("handle_gauge", {});
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([&counter, &gauge]() {
+      for (int j = 0; j < 1000; j++) {
+        counter.Increment();
+        gauge.Increment(2);
+        gauge.Decrement();
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  // The variadic functions update the same timeseries
+  increment_counter("handle_counter", 10, 1, "key", "value");
+  EXPECT_EQ(collected_value("handle_counter"), 8010);
+  EXPECT_EQ(collected_value("handle_gauge"), 8000);
+
+  // Setting a gauge discards the updates that weren't collected yet
+  gauge.Increment(5);
+  gauge.Set(3);
+  EXPECT_EQ(collected_value("handle_gauge"), 3);
+}
+
+// Tests that handles resolved before a flush keep updating the new metrics
+TEST(test_handles_across_flush, test_metrics) {
+  auto& instance = MetricsSingleton::Instance();
+  auto counter = instance.GetCounter("flushed_counter", {});
+  auto gauge = instance.GetGauge("flushed_gauge", {});
+  auto histogram = instance.GetHistogram("flushed_histogram", {}, {1, 10});
+  counter.Increment(2);
+  gauge.Set(4);
+  histogram.Observe(1);
+  EXPECT_EQ(collected_value("flushed_counter"), 2);
+
+  // Updates that weren't collected yet are dropped with the old metrics
+  counter.Increment(3);
+  MetricsSingleton::flush();
+  EXPECT_EQ(collected_value("flushed_counter"), 0);
+  EXPECT_EQ(collected_value("flushed_gauge"), 0);
+  EXPECT_EQ(collected_value("flushed_histogram"), 0);
+
+  counter.Increment(1);
+  gauge.Increment(2);
+  histogram.Observe(1);
+  EXPECT_EQ(collected_value("flushed_counter"), 1);
+  EXPECT_EQ(collected_value("flushed_gauge"), 2);
+  EXPECT_EQ(collected_value("flushed_histogram"), 1);
+  // Looking the metric up again still finds the same timeseries
+  instance.GetCounter("flushed_counter", {}).Increment(1);
+  EXPECT_EQ(collected_value("flushed_counter"), 2);
+}
+
+} // namespace magma
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,191 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the BSD-style license found in the
+ * LICENSE file in the root directory of this source tree. An additional grant
+ * of patent rights can be found in the PATENTS file in the same directory.
+ */
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <cpp_redis/cpp_redis>
+#include <orc8r/protos/common.pb.h>
+
+#include "RedisMap.hpp"
+#include "Serializers.h"
+
+using magma::orc8r::NetworkID;
+using ::testing::Test;
+
+namespace magma {
+
+const std::string TEST_HASH = "test:redis_map";
+
+/**
+ * These tests run against a local redis server, on the port from the
+ * REDIS_PORT environment variable or the gateway redis port
+ */
+class RedisMapTest : public ::testing::Test {
+ protected:
+  virtual void SetUp()
+  {
+    auto port_env = std::getenv("REDIS_PORT");
+    auto port = port_env != nullptr ? std::atoi(port_env) : 6380;
+    client_ = std::make_shared<cpp_redis::client>();
+    client_->connect("127.0.0.1", port);
+    ASSERT_TRUE(client_->is_connected())
+      << "redis-server must be running on port " << port;
+    clear_hash();
+    map_ = std::make_unique<RedisMap<NetworkID>>(
+      client_, TEST_HASH, get_proto_serializer(), get_proto_deserializer());
+  }
+
+  virtual void TearDown()
+  {
+    if (client_->is_connected()) {
+      clear_hash();
+    }
+  }
+
+  void clear_hash()
+  {
+    auto del_future = client_->del({TEST_HASH});
+    client_->sync_commit();
+    del_future.get();
+  }
+
+  NetworkID network(const std::string& id)
+  {
+    NetworkID obj;
+    obj.set_id(id);
+    return obj;
+  }
+
+  RedisState get_raw_state(const std::string& key)
+  {
+    auto hget_future = client_->hget(TEST_HASH, key);
+    client_->sync_commit();
+    RedisState state;
+    EXPECT_TRUE(state.ParseFromString(hget_future.get().as_string()));
+    return state;
+  }
+
+  void hset_raw(const std::string& key, const std::string& value)
+  {
+    auto hset_future = client_->hset(TEST_HASH, key, value);
+    client_->sync_commit();
+    EXPECT_FALSE(hset_future.get().is_error());
+  }
+
+  std::shared_ptr<cpp_redis::client> client_;
+  std::unique_ptr<RedisMap<NetworkID>> map_;
+};
+
+TEST_F(RedisMapTest, test_set_increments_version)
+{
+  EXPECT_EQ(SUCCESS, map_->set("key1", network("net1")));
+  EXPECT_EQ(1, get_raw_state("key1").version());
+
+  EXPECT_EQ(SUCCESS, map_->set("key1", network("net2")));
+  auto state = get_raw_state("key1");
+  EXPECT_EQ(2, state.version());
+  NetworkID stored;
+  EXPECT_TRUE(stored.ParseFromString(state.serialized_msg()));
+  EXPECT_EQ("net2", stored.id());
+
+  NetworkID obj;
+  EXPECT_EQ(SUCCESS, map_->get("key1", obj));
+  EXPECT_EQ("net2", obj.id());
+  EXPECT_EQ(KEY_NOT_FOUND, map_->get("key2", obj));
+}
+
+TEST_F(RedisMapTest, test_set_keeps_version_of_other_writers)
+{
+  // A value written by another serializer, with a multi byte version varint
+  uint64_t version = 300;
+  std::string value;
+  EXPECT_TRUE(get_proto_serializer()(network("net1"), value, version));
+  hset_raw("key1", value);
+
+  EXPECT_EQ(SUCCESS, map_->set("key1", network("net2")));
+  EXPECT_EQ(301, get_raw_state("key1").version());
+}
+
+TEST_F(RedisMapTest, test_set_reloads_flushed_script)
+{
+  EXPECT_EQ(SUCCESS, map_->set("key1", network("net1")));
+
+  auto flush_future = client_->send({"SCRIPT", "FLUSH"});
+  client_->sync_commit();
+  EXPECT_FALSE(flush_future.get().is_error());
+
+  EXPECT_EQ(SUCCESS, map_->set("key1", network("net2")));
+  EXPECT_EQ(2, get_raw_state("key1").version());
+
+  std::unordered_map<std::string, NetworkID> objects = {
+    {"key1", network("net3")}, {"key2", network("net4")}};
+  flush_future = client_->send({"SCRIPT", "FLUSH"});
+  client_->sync_commit();
+  flush_future.get();
+  EXPECT_EQ(SUCCESS, map_->multi_set(objects));
+  EXPECT_EQ(3, get_raw_state("key1").version());
+  EXPECT_EQ(1, get_raw_state("key2").version());
+}
+
+TEST_F(RedisMapTest, test_multi_set_and_multi_get)
+{
+  std::unordered_map<std::string, NetworkID> objects;
+  for (int i = 0; i < 10; i++) {
+    objects["key" + std::to_string(i)] = network("net" + std::to_string(i));
+  }
+  EXPECT_EQ(SUCCESS, map_->multi_set(objects));
+  EXPECT_EQ(SUCCESS, map_->multi_set(objects));
+  EXPECT_EQ(2, get_raw_state("key0").version());
+  EXPECT_EQ(2, get_raw_state("key9").version());
+
+  // A value that can't be deserialized is reported, a missing key is skipped
+  hset_raw("bad", "\x0a\x05" "ab");
+  std::unordered_map<std::string, NetworkID> values;
+  std::vector<std::string> failed_keys;
+  EXPECT_EQ(
+    SUCCESS,
+    map_->multi_get({"key0", "key5", "missing", "bad"}, values, &failed_keys));
+  EXPECT_EQ(2, values.size());
+  EXPECT_EQ("net0", values["key0"].id());
+  EXPECT_EQ("net5", values["key5"].id());
+  EXPECT_EQ(std::vector<std::string>({"bad"}), failed_keys);
+
+  values.clear();
+  EXPECT_EQ(SUCCESS, map_->multi_get({}, values));
+  EXPECT_TRUE(values.empty());
+}
+
+TEST_F(RedisMapTest, test_multi_delete)
+{
+  std::unordered_map<std::string, NetworkID> objects = {
+    {"key1", network("net1")},
+    {"key2", network("net2")},
+    {"key3", network("net3")}};
+  EXPECT_EQ(SUCCESS, map_->multi_set(objects));
+
+  EXPECT_EQ(SUCCESS, map_->multi_delete({"key1", "key3", "missing"}));
+  EXPECT_EQ(SUCCESS, map_->multi_delete({}));
+
+  std::vector<NetworkID> values;
+  EXPECT_EQ(SUCCESS, map_->getall(values));
+  ASSERT_EQ(1, values.size());
+  EXPECT_EQ("net2", values[0].id());
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+}